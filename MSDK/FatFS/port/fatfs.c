@@ -995,10 +995,10 @@ int fs_flash_write(LBA_t sector, const BYTE *buff, UINT count)
 
     sys_mutex_put(&fs_mutex);
 #else
-    if (raw_flash_erase((sector * FATFS_SECTOR_SIZE + FATFS_FLASH_START_ADDR), (count * FATFS_SECTOR_SIZE)))
+    if (raw_flash_sliced_op(RAW_FLASH_OP_ERASE, (sector * FATFS_SECTOR_SIZE + FATFS_FLASH_START_ADDR), NULL, (count * FATFS_SECTOR_SIZE)))
         return RES_ERROR;
 
-    if (raw_flash_write((sector * FATFS_SECTOR_SIZE + FATFS_FLASH_START_ADDR), (uint8_t *)buff, (count * FATFS_SECTOR_SIZE)))
+    if (raw_flash_sliced_op(RAW_FLASH_OP_WRITE, (sector * FATFS_SECTOR_SIZE + FATFS_FLASH_START_ADDR), (uint8_t *)buff, (count * FATFS_SECTOR_SIZE)))
         return RES_ERROR;
 #endif
 #endif
@@ -1041,7 +1041,7 @@ int fs_flash_read(LBA_t sector, BYTE *buff, UINT count)
 
     sys_mutex_put(&fs_mutex);
 #else
-    if (raw_flash_read((sector * FATFS_SECTOR_SIZE + FATFS_FLASH_START_ADDR), buff, (count * FATFS_SECTOR_SIZE))) {
+    if (raw_flash_sliced_op(RAW_FLASH_OP_READ, (sector * FATFS_SECTOR_SIZE + FATFS_FLASH_START_ADDR), buff, (count * FATFS_SECTOR_SIZE))) {
         app_print("FATFS_ERROR: read from flash error!\r\n");
         return RES_ERROR;
     }
@@ -65,7 +65,7 @@ static int wl_flash_write_int(uint32_t offset, uint8_t *data, int len)
 
     return res;
 #else
-    return raw_flash_write(offset, data, len);
+    return raw_flash_sliced_op(RAW_FLASH_OP_WRITE, offset, data, len);
 #endif
 }
 
@@ -85,7 +85,7 @@ static int wl_flash_read_int(uint32_t offset, uint8_t *data, int len)
 
     return res;
 #else
-    return raw_flash_read(offset, data, len);
+    return raw_flash_sliced_op(RAW_FLASH_OP_READ, offset, data, len);
 #endif
 
 }
@@ -191,7 +191,7 @@ static int wl_flash_erase_raw(wl_flash_t *wl_flash, uint32_t start_address, uint
         }
         sys_mutex_put(&fs_mutex);
 #else
-        ERR_CHECK(raw_flash_erase((start_address + (i * wl_flash->cfg.sector_size)), wl_flash->cfg.sector_size))
+        ERR_CHECK(raw_flash_sliced_op(RAW_FLASH_OP_ERASE, (start_address + (i * wl_flash->cfg.sector_size)), NULL, wl_flash->cfg.sector_size))
 #endif
     }
     return result;
@@ -268,7 +268,7 @@ static int wl_flash_erase_sector(wl_flash_t *wl_flash, uint32_t sector)
 
     sys_mutex_put(&fs_mutex);
 #else
-    ERR_CHECK(raw_flash_erase(wl_flash->cfg.start_addr + virt_addr, wl_flash->cfg.sector_size))
+    ERR_CHECK(raw_flash_sliced_op(RAW_FLASH_OP_ERASE, wl_flash->cfg.start_addr + virt_addr, NULL, wl_flash->cfg.sector_size))
 #endif
 
     return result;
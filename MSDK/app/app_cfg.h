@@ -108,6 +108,18 @@ OF SUCH DAMAGE.
 
 // #define CONFIG_TINY_WEBSOCKETS
 
+// #define CONFIG_WIFI_CAPTURE
+
+// #define CONFIG_WIFI_ROAM_SCAN
+
+// #define CONFIG_WIFI_STA_TABLE
+
+// #define CONFIG_LWIP_MEM_TELEMETRY
+
+// #define CONFIG_LWIP_MCAST_FILTER
+
+// #define CONFIG_NVDS_GC_TASK
+
 #ifdef CFG_MATTER
     #undef CONFIG_BASECMD
     #undef CONFIG_ATCMD
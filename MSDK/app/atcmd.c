@@ -46,6 +46,10 @@ OF SUCH DAMAGE.
 #include "wifi_management.h"
 #include "wifi_export.h"
 #include "wifi_init.h"
+#ifdef CONFIG_WIFI_STA_TABLE
+#include "wifi_sta_table.h"
+#include "dhcpd.h"
+#endif
 #include "cmd_shell.h"
 #include "dbg_print.h"
 #include "uart.h"
@@ -130,7 +134,13 @@ static void at_hw_dma_receive(uint32_t address, uint32_t num);
 static void at_hw_send(char *data, int size);
 
 #ifdef CONFIG_ATCMD_SPI
+/* data mode command being executed, its response is followed by data transfers */
+#define AT_SPI_CMD_OTHER        0
+#define AT_SPI_CMD_CIPSEND      1
+#define AT_SPI_CMD_CIPSDFILE    2
+
 struct spi_manager_s spi_manager;
+static volatile uint8_t at_spi_cur_cmd = AT_SPI_CMD_OTHER;
 void at_spi_rcv_atcmd_config(bool from_isr);
 static void at_spi_dma_receive_config(void);
 static void at_spi_irq_receive_config(void);
@@ -788,6 +798,9 @@ static const struct atcmd_entry atcmd_table[] = {
     {"AT+CWQAP", at_cw_ap_quit},
     {"AT+CWSAP_CUR", at_cw_ap_cur_start},
     {"AT+CWLIF", at_cw_ap_client_list},
+#ifdef CONFIG_WIFI_STA_TABLE
+    {"AT+CWLIFSTAT", at_cw_ap_client_stat},
+#endif
     {"AT+CWAUTOCONN", at_cw_auto_connect},
     /* ====== TCPIP ====== */
     {"AT+PING", at_cip_ping},
@@ -831,6 +844,7 @@ static const struct atcmd_entry atcmd_table[] = {
     {"AT+MQTTSUB", at_mqtt_sub},
     {"AT+MQTTUNSUB", at_mqtt_unsub},
     {"AT+MQTTCLEAN", at_mqtt_clean},
+    {"AT+MQTTQUEUE", at_mqtt_queue},
 #endif /* CONFIG_MQTT */
 
 #ifdef CONFIG_ATCMD_OTA_DEMO
@@ -954,6 +968,9 @@ static const struct atcmd_entry atcmd_table[] = {
 };
 const uint32_t AT_CMD_TABLE_SZ = (sizeof(atcmd_table) / sizeof(atcmd_table[0]));
 
+/* Hash index of atcmd_table, built once at init */
+static struct atcmd_hash_slot atcmd_hash[AT_CMD_HASH_SIZE];
+
 #ifdef CONFIG_ATCMD_SPI
 
 #if 0
@@ -1058,13 +1075,15 @@ void at_spi_send_with_handshake(char *data, int size)
 
     /* 6 update spi_manager state */
     AT_TRACE("send, s:%d, rx:%s, dir:%d\r\n", spi_manager.stat, at_hw_rx_buf, spi_manager.direction);
-    if (spi_manager.stat == SPI_Slave_AT_ACK && (strncmp(at_hw_rx_buf, "AT+CIPSEND", 10) == 0)) {
+    if (spi_manager.stat == SPI_Slave_AT_ACK && at_spi_cur_cmd == AT_SPI_CMD_CIPSEND) {
         at_cmd_received = 0;
 		spi_manager.stat = SPI_Slave_Data_Recv;
         sys_memset(at_hw_rx_buf, 0, ATCMD_FIXED_LEN);
-    } else if (spi_manager.stat == SPI_Slave_AT_ACK && (strncmp(at_hw_rx_buf, "AT+CIPSDFILE", 12) == 0)) {
+        at_spi_cur_cmd = AT_SPI_CMD_OTHER;
+    } else if (spi_manager.stat == SPI_Slave_AT_ACK && at_spi_cur_cmd == AT_SPI_CMD_CIPSDFILE) {
         spi_manager.stat = SPI_Slave_File_Recv;
         sys_memset(at_hw_rx_buf, 0, ATCMD_FIXED_LEN);
+        at_spi_cur_cmd = AT_SPI_CMD_OTHER;
     } else if (spi_manager.stat == SPI_Slave_File_ACK || spi_manager.stat == SPI_Slave_File_Recv ||
             spi_manager.stat == SPI_Slave_File_Done) {
         //TODO
@@ -1159,9 +1178,9 @@ static void at_spi_reconfig_from_isr(void)
         sys_sema_up_from_isr(&at_hw_dma_sema);
 
         if ((spi_manager.stat == SPI_Slave_File_ACK) ||
-                ((spi_manager.stat == SPI_Slave_AT_ACK) && (strncmp(at_hw_rx_buf, "AT+CIPSDFILE", 12) == 0))) {
+                ((spi_manager.stat == SPI_Slave_AT_ACK) && (at_spi_cur_cmd == AT_SPI_CMD_CIPSDFILE))) {
             goto exit;
-        } else if ((spi_manager.stat == SPI_Slave_AT_ACK) && (strncmp(at_hw_rx_buf, "AT+CIPSEND", 10) == 0)) {
+        } else if ((spi_manager.stat == SPI_Slave_AT_ACK) && (at_spi_cur_cmd == AT_SPI_CMD_CIPSEND)) {
             goto exit;
         }
 
@@ -1235,9 +1254,9 @@ void at_spi_rx_dma_irq_hdl(uint32_t dma_channel)
             sys_sema_up_from_isr(&at_hw_dma_sema);
 
             if (spi_manager.stat == SPI_Slave_File_ACK ||
-                (spi_manager.stat == SPI_Slave_AT_ACK && (strncmp(at_hw_rx_buf, "AT+CIPSDFILE", 12) == 0))) {
+                (spi_manager.stat == SPI_Slave_AT_ACK && at_spi_cur_cmd == AT_SPI_CMD_CIPSDFILE)) {
                     goto exit;
-            } else if (spi_manager.stat == SPI_Slave_AT_ACK && (strncmp(at_hw_rx_buf, "AT+CIPSEND", 10) == 0)) {
+            } else if (spi_manager.stat == SPI_Slave_AT_ACK && at_spi_cur_cmd == AT_SPI_CMD_CIPSEND) {
                 goto exit;
             }
 
@@ -1767,7 +1786,8 @@ Exit:
 
 static void atcmd_task(void *param)
 {
-    int argc = 0, i = 0;
+    const struct atcmd_entry *entry;
+    int argc = 0;
     char *argv[AT_MAX_ARGC];
 
 #ifdef CFG_WLAN_SUPPORT
@@ -1807,21 +1827,20 @@ static void atcmd_task(void *param)
             if (argc == 0)
                 goto cont;
         }
-        for (i = 0; i < AT_CMD_TABLE_SZ - 1; i++) {
-            if ((strcmp(argv[0], atcmd_table[i].name) == 0) ||
-                (strncmp(argv[0], atcmd_table[i].name, strlen(atcmd_table[i].name)) == 0
-                && argv[0][strlen(argv[0]) - 1] == AT_QUESTION
-                && (strlen(argv[0]) == strlen(atcmd_table[i].name) + 1))) {
-                if (atcmd_table[i].exec) {
-                    atcmd_table[i].exec(argc, argv);
-                }
-                break;
-            }
-        }
-
-        if (i == AT_CMD_TABLE_SZ - 1) {//not found
+        entry = atcmd_hash_lookup(atcmd_hash, atcmd_table, argv[0]);
+        if (entry == NULL) {//not found
             AT_TRACE("Invalid atcmd, %s\r\n", at_hw_rx_buf);
             AT_RSP_DIRECT("ERROR\r\n", 7);
+        } else {
+#if defined(CONFIG_ATCMD_SPI) && defined(CFG_WLAN_SUPPORT)
+            if (entry->exec == at_cip_send)
+                at_spi_cur_cmd = AT_SPI_CMD_CIPSEND;
+            else if (entry->exec == at_cip_send_file)
+                at_spi_cur_cmd = AT_SPI_CMD_CIPSDFILE;
+            else
+                at_spi_cur_cmd = AT_SPI_CMD_OTHER;
+#endif
+            entry->exec(argc, argv);
         }
 cont:
         AT_TRACE("# ");
@@ -1848,6 +1867,12 @@ int atcmd_init(void)
 #endif
     at_cmd_received = 0;
 
+    if (atcmd_hash_build(atcmd_hash, atcmd_table, AT_CMD_TABLE_SZ - 1)) {
+        AT_TRACE("AT command table too large for the hash index.\r\n");
+        ret = -6;
+        goto Exit;
+    }
+
     at_hw_init();
     cip_info_init();
 
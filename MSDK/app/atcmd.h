@@ -116,6 +116,7 @@ OF SUCH DAMAGE.
 #define AT_HW_RX_BUF_SIZE     128
 #endif
 #define AT_MAX_ARGC             15
+#define AT_CMD_HASH_SIZE        256     // power of 2, about twice the number of commands
 #define AT_MAX_STATION_NUM      CFG_STA_NUM
 #define AT_ETH_ALEN             3
 
@@ -176,6 +177,19 @@ struct atcmd_entry {
     void (*exec) (int, char **);
 };
 
+/* Slot of the command table hash index. It holds the table index plus 1 (0 for an
+   empty slot), the name length and the hash top byte so that most probes are
+   rejected without touching the name. */
+struct atcmd_hash_slot {
+    uint8_t idx;
+    uint8_t len;
+    uint8_t tag;
+};
+
+int atcmd_hash_build(struct atcmd_hash_slot *hash, const struct atcmd_entry *table, uint32_t num);
+const struct atcmd_entry *atcmd_hash_lookup(const struct atcmd_hash_slot *hash,
+                                            const struct atcmd_entry *table, const char *name);
+
 int atcmd_init(void);
 void atcmd_deinit(void);
 int at_print(const char *format, ...);
@@ -0,0 +1,118 @@
+/*!
+    \file    atcmd_hash.c
+    \brief   Hash index of the AT command table.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#include "app_cfg.h"
+#include "wrapper_os.h"
+#include "atcmd.h"
+
+#ifdef CONFIG_ATCMD
+#define AT_CMD_HASH_MASK        (AT_CMD_HASH_SIZE - 1)
+/* FNV-1a */
+#define AT_CMD_HASH_INIT        2166136261u
+#define AT_CMD_HASH_PRIME       16777619u
+
+/*!
+    \brief      build the hash index of an AT command table
+    \param[in]  table: command table
+    \param[in]  num: number of commands in the table
+    \param[out] hash: hash index, AT_CMD_HASH_SIZE slots
+    \retval     0 on success, -1 if the table does not fit in the index
+*/
+int atcmd_hash_build(struct atcmd_hash_slot *hash, const struct atcmd_entry *table, uint32_t num)
+{
+    uint32_t h, pos, len, i;
+    const char *name;
+
+    /* an empty slot must remain to end the probes */
+    if (num > 255 || num >= AT_CMD_HASH_SIZE)
+        return -1;
+
+    sys_memset(hash, 0, AT_CMD_HASH_SIZE * sizeof(struct atcmd_hash_slot));
+    for (i = 0; i < num; i++) {
+        name = table[i].name;
+        h = AT_CMD_HASH_INIT;
+        for (len = 0; name[len] != '\0'; len++)
+            h = (h ^ (uint8_t)name[len]) * AT_CMD_HASH_PRIME;
+        if (len > 255)
+            return -1;
+
+        /* a duplicated name stays behind the first one, which keeps the priority */
+        pos = h & AT_CMD_HASH_MASK;
+        while (hash[pos].idx != 0)
+            pos = (pos + 1) & AT_CMD_HASH_MASK;
+        hash[pos].idx = i + 1;
+        hash[pos].len = len;
+        hash[pos].tag = h >> 24;
+    }
+
+    return 0;
+}
+
+/*!
+    \brief      find the AT command entry of a command name
+                Note: "AT+XXX?" resolves to the entry of "AT+XXX", the handler
+                still gets the full name in argv[0].
+    \param[in]  hash: hash index built by atcmd_hash_build
+    \param[in]  table: command table of the index
+    \param[in]  name: command name, argv[0] of the command line
+    \param[out] none
+    \retval     the command entry, NULL if not found
+*/
+const struct atcmd_entry *atcmd_hash_lookup(const struct atcmd_hash_slot *hash,
+                                            const struct atcmd_entry *table, const char *name)
+{
+    uint32_t h = AT_CMD_HASH_INIT, prev = h;
+    uint32_t pos, len;
+
+    for (len = 0; name[len] != '\0'; len++) {
+        prev = h;
+        h = (h ^ (uint8_t)name[len]) * AT_CMD_HASH_PRIME;
+    }
+    if (len > 0 && name[len - 1] == AT_QUESTION) {
+        h = prev;
+        len--;
+    }
+
+    pos = h & AT_CMD_HASH_MASK;
+    while (hash[pos].idx != 0) {
+        if (hash[pos].len == len && hash[pos].tag == (uint8_t)(h >> 24)
+            && memcmp(name, table[hash[pos].idx - 1].name, len) == 0)
+            return &table[hash[pos].idx - 1];
+        pos = (pos + 1) & AT_CMD_HASH_MASK;
+    }
+
+    return NULL;
+}
+#endif /* CONFIG_ATCMD */
@@ -39,6 +39,7 @@ OF SUCH DAMAGE.
 #include "mqtt_client_config.h"
 #include "mqtt5_client_config.h"
 #include "co_utils.h"
+#include "mqtt_pub_queue.h"
 
 static bool mqtt_usercfg_setted = false;
 
@@ -1252,4 +1253,70 @@ Usage:
     AT_RSP_OK();
     return;
 }
+
+/*!
+    \brief      the AT command publish queue statistics and drain rate
+    \param[in]  argc: number of parameters
+    \param[in]  argv: the pointer to the array that holds the parameters
+    \param[out] none
+    \retval     none
+*/
+void at_mqtt_queue(int argc, char **argv)
+{
+    mqtt_pubq_stats_t stats;
+    uint32_t rate, op = 0;
+    char *endptr = NULL;
+
+    AT_RSP_START(256);
+    if (argc == 1) {
+        if (argv[0][strlen(argv[0]) - 1] == AT_QUESTION) {
+            mqtt_pubq_stats_get(&stats, false);
+            AT_RSP("+MQTTQUEUE:%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\r\n",
+                   stats.depth, stats.peak_depth, stats.ram_bytes, stats.file_bytes,
+                   stats.enqueue_cnt, stats.sent_cnt, stats.sent_bytes, stats.batch_cnt, stats.spill_cnt,
+                   stats.wait_cnt, stats.retry_cnt, stats.drop_full_cnt, stats.drop_err_cnt,
+                   stats.drain_rate, stats.drain_pps, stats.drain_bps);
+        } else {
+            AT_TRACE("MQTT: wrong parameter counts, ERR CODE:0x%08x\r\n", AT_MQTT_PARAMETER_COUNTS_IS_WRONG);
+            goto Error;
+        }
+    } else if ((argc == 2) && (argv[1][0] == AT_QUESTION)) {
+        goto Usage;
+    } else if ((argc == 2) || (argc == 3)) {
+        rate = (uint32_t)strtoul((const char *)argv[1], &endptr, 10);
+        if ((*endptr != '\0')) {
+            AT_TRACE("invalid MQTT queue drain rate\r\n");
+            goto Error;
+        }
+        if (argc == 3) {
+            op = (uint32_t)strtoul((const char *)argv[2], &endptr, 10);
+            if ((*endptr != '\0') || (op > 2)) {
+                AT_TRACE("invalid MQTT queue operation\r\n");
+                goto Error;
+            }
+        }
+        mqtt_pubq_rate_set(rate);
+        if (op == 1) {
+            mqtt_pubq_stats_get(&stats, true);
+        } else if (op == 2) {
+            mqtt_pubq_flush();
+        }
+        mqtt_task_resume(false);
+    } else {
+        AT_TRACE("MQTT: wrong parameter counts, ERR CODE:0x%08x\r\n", AT_MQTT_PARAMETER_COUNTS_IS_WRONG);
+        goto Error;
+    }
+
+    AT_RSP_OK();
+    return;
+
+Error:
+    AT_RSP_ERR();
+    return;
+
+Usage:
+    AT_RSP("+MQTTQUEUE=<drain_rate>[,<operation: 0-none; 1-reset statistics; 2-flush queue>]\r\n");
+    AT_RSP_OK();
+    return;
+}
 #endif
\ No newline at end of file
@@ -59,5 +59,6 @@ void at_mqtt_pub_raw(int argc, char **argv);
 void at_mqtt_sub(int argc, char **argv);
 void at_mqtt_unsub(int argc, char **argv);
 void at_mqtt_clean(int argc, char **argv);
+void at_mqtt_queue(int argc, char **argv);
 
 #endif /* _ATCMD_MQTT_H_ */
\ No newline at end of file
@@ -144,7 +144,7 @@ void at_dfu_verify_image(unsigned char *output, mbedtls_md_type_t md_type)
 
     for (offset = 0; offset < at_dfu_ctx->current_size; offset += AT_DFU_SEGMENT_LEN) {
         read_size = (at_dfu_ctx->current_size - offset) < AT_DFU_SEGMENT_LEN ? (at_dfu_ctx->current_size - offset) : AT_DFU_SEGMENT_LEN;
-        err  = raw_flash_read(at_dfu_ctx->start_address + offset, (void *)p_buf, read_size);
+        err  = raw_flash_sliced_op(RAW_FLASH_OP_READ, at_dfu_ctx->start_address + offset, (void *)p_buf, read_size);
         if (err) {
             AT_TRACE("Flash read failed %d\r\n", err);
         }
@@ -163,7 +163,7 @@ int at_dfu_write_image(uint8_t *p_buf, uint32_t size)
 
     if (at_dfu_ctx->start_address + at_dfu_ctx->current_size + size > at_dfu_ctx->erase_address) {
         erase_size = MAX(AT_DFU_SEGMENT_LEN, ROUND_UP(size, AT_DFU_SEGMENT_LEN));
-        len = raw_flash_erase(at_dfu_ctx->erase_address, erase_size);
+        len = raw_flash_sliced_op(RAW_FLASH_OP_ERASE, at_dfu_ctx->erase_address, NULL, erase_size);
         if (len != 0) {
             AT_TRACE("dfu flash erase failed!\r\n");
             return len;
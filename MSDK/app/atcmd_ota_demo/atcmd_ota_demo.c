@@ -87,6 +87,7 @@ OF SUCH DAMAGE.
 #include "cJSON.h"
 #include "atcmd_mqtt.h"
 #include "mqtt_cmd.h"
+#include "tls_session.h"
 
 /*==========Please set the correct AP information ========*/
 //#define SSID                                    "Testing-WiFi"
@@ -244,6 +245,29 @@ static int my_random(void *p_rng, unsigned char *output, size_t output_len)
     return 0;
 }
 
+/*!
+    \brief      read application data, keeping the TLS 1.3 session tickets received meanwhile
+    \param[in]  ssl: ssl context
+    \param[in]  len: size of the buffer
+    \param[out] buf: buffer to fill with the data
+    \retval     same as mbedtls_ssl_read
+*/
+static int at_ota_demo_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+{
+    int ret;
+
+    while (1) {
+        ret = mbedtls_ssl_read(ssl, buf, len);
+#if defined(CFG_TLS_SESSION_CACHE) && defined(TLS_SESSION_TLS13_TICKET)
+        if (ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
+            tls_session_ticket(ssl);
+            continue;
+        }
+#endif
+        return ret;
+    }
+}
+
 
 static void print_hex_array(const uint8_t* arr, size_t len)
 {
@@ -660,6 +684,9 @@ void at_ota_demo_ssl_client_disconnect(ota_ssl_wrapper_t *ota_ssl)
 #if TLS_VERIFY_CLI_CERT
     mbedtls_x509_crt_free(&ota_ssl->cli_cert);
     mbedtls_pk_free(&ota_ssl->cli_key);
+#endif
+#ifdef CFG_TLS_SESSION_CACHE
+    tls_session_end(&ota_ssl->ssl_ctx);
 #endif
     mbedtls_ssl_free(&ota_ssl->ssl_ctx);
     mbedtls_ssl_config_free(&ota_ssl->ssl_conf);
@@ -775,6 +802,9 @@ int at_ota_demo_ssl_client(ota_ssl_wrapper_t *ota_ssl, int verify_server)
                 MBEDTLS_SSL_TRANSPORT_STREAM,
                 MBEDTLS_SSL_PRESET_DEFAULT);
     mbedtls_ssl_conf_read_timeout(&ota_ssl->ssl_conf, 10000); //10s
+#if defined(CFG_TLS_SESSION_CACHE) && defined(TLS_SESSION_TLS13_TICKET)
+    mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets(&ota_ssl->ssl_conf, MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED);
+#endif
 
     /* Setup random number generator */
     mbedtls_ssl_conf_rng(&ota_ssl->ssl_conf, my_random, NULL);
@@ -819,7 +849,13 @@ int at_ota_demo_ssl_client(ota_ssl_wrapper_t *ota_ssl, int verify_server)
 
     /* SSL/TLS handshake */
     AT_TRACE("Performing the SSL/TLS handshake...\n");
+#ifdef CFG_TLS_SESSION_CACHE
+    /* resume the session of the previous download from this server */
+    tls_session_begin(&ota_ssl->ssl_ctx, ota_ssl->server_host, (uint16_t)atoi(ota_ssl->server_port));
+    ret = tls_session_handshake(&ota_ssl->ssl_ctx);
+#else
     ret = mbedtls_ssl_handshake(&ota_ssl->ssl_ctx);
+#endif
     if (ret != 0) {
         AT_TRACE("AT+CIUPDATE: SSL handshake failed: -0x%x\n", -ret);
         ret = OTA_SERVER_ACCESS_ERR;
@@ -891,7 +927,7 @@ int at_fw_url_query(ota_ctx_t *ota_ctx, ota_ssl_wrapper_t *ota_ssl, char *http_r
     }
     AT_TRACE("Receiving server response...\n");
 
-    if ((len = mbedtls_ssl_read(&ota_ssl->ssl_ctx, ota_ctx->buf, ota_ctx->buf_len)) > 0) {
+    if ((len = at_ota_demo_ssl_read(&ota_ssl->ssl_ctx, ota_ctx->buf, ota_ctx->buf_len)) > 0) {
         err = parse_http_response((const char *)ota_ctx->buf, http_response);
         if (err) {
             AT_TRACE("AT+CIUPDATE: failed to parse http response\r\n");
@@ -1030,7 +1066,7 @@ static void at_ota_demo_task(void *param)
         sys_timer_stop(&ctx->ota_tmr, 0);
         sys_timer_start(&ctx->ota_tmr, 0);
 
-        if ((real_len = mbedtls_ssl_read(&ota_ssl->ssl_ctx, ctx->buf, ctx->segment_length)) > 0) {
+        if ((real_len = at_ota_demo_ssl_read(&ota_ssl->ssl_ctx, ctx->buf, ctx->segment_length)) > 0) {
             if (http_rsp_header_parsed == 0) {
                 http_rsp_header_parsed = 1;
                 int ret = parse_http_response((const char *)ctx->buf, http_response);
@@ -1095,12 +1095,13 @@ static void tcp_udp_server_stop(void)
     \brief      process recieved data from socket server and
                 list the data in the client_info_t.
     \param[in]  idx:    index of which client in cip_info
-    \param[in]  rx_buf: buffer that stored recieved data
+    \param[in]  rx_buf: buffer that stored recieved data, unused if rx_p is set
+    \param[in]  rx_p:   borrowed pbuf chain that holds the recieved data, or NULL
     \param[in]  recv_sz: recieved data length
     \param[out] none
     \retval     none
 */
-static void at_spi_recv_data_process(int idx, uint8_t *rx_buf, int recv_sz)
+static void at_spi_recv_data_process(int idx, uint8_t *rx_buf, struct pbuf *rx_p, int recv_sz)
 {
     int recv_processed = 0, currentdatasize = 0;
     struct recv_data_node *recv_data_node = NULL;
@@ -1123,10 +1124,17 @@ static void at_spi_recv_data_process(int idx, uint8_t *rx_buf, int recv_sz)
         data_recv = sys_malloc(currentdatasize);// for data
         if (data_recv == NULL) {
             AT_TRACE("Allocate data_recv failed (len = %u).\r\n", currentdatasize);
+            sys_mfree(recv_data_node);
             break;
         }
 
-        sys_memcpy(data_recv, rx_buf + recv_processed, currentdatasize);// copy payload
+        // copy payload, the segments of a pbuf chain are gathered into full size nodes
+#if LWIP_SOCKET_RECV_PBUF
+        if (rx_p)
+            pbuf_copy_partial(rx_p, data_recv, currentdatasize, recv_processed);
+        else
+#endif
+        sys_memcpy(data_recv, rx_buf + recv_processed, currentdatasize);
 
         recv_data_node->data = data_recv;
         recv_data_node->data_len = currentdatasize;
@@ -1150,6 +1158,44 @@ static void at_spi_recv_data_process(int idx, uint8_t *rx_buf, int recv_sz)
 }
 #endif /* CONFIG_ATCMD_SPI */
 
+#if LWIP_SOCKET_RECV_PBUF && !defined(CONFIG_ATCMD_SPI)
+/*!
+    \brief      output a borrowed pbuf chain as +IPD messages of at most max_len bytes each,
+                the length a copy into the receive buffer used to give
+    \param[in]  fd: socket the data was received on
+    \param[in]  rx_p: received pbuf chain
+    \param[in]  max_len: largest data length of one +IPD message
+    \param[out] none
+    \retval     none
+*/
+static void cip_ipd_pbuf_send(int fd, struct pbuf *rx_p, uint16_t max_len)
+{
+    char *rsp_buf;
+    int rsp_buf_idx, rsp_buf_len;
+    uint16_t offset = 0, len;
+
+    while (offset < rx_p->tot_len) {
+        len = ((rx_p->tot_len - offset) > max_len) ? max_len : (rx_p->tot_len - offset);
+        rsp_buf_len = 64 + len;
+        rsp_buf = sys_malloc(rsp_buf_len);
+        if (rsp_buf == NULL) {
+            AT_TRACE("Allocate +IPD buffer failed (len = %d), %u bytes dropped.\r\n",
+                     rsp_buf_len, rx_p->tot_len - offset);
+            return;
+        }
+
+        rsp_buf_idx = co_snprintf(rsp_buf, rsp_buf_len, "+IPD,%d,%d: ", fd, len);
+        pbuf_copy_partial(rx_p, rsp_buf + rsp_buf_idx, len, offset);
+        rsp_buf_idx += len;
+        rsp_buf_idx += co_snprintf(rsp_buf + rsp_buf_idx, rsp_buf_len - rsp_buf_idx, "\r\nOK\r\n");
+        at_hw_send(rsp_buf, rsp_buf_idx);
+        sys_mfree(rsp_buf);
+
+        offset += len;
+    }
+}
+#endif
+
 extern int dhcpd_ipaddr_is_valid(uint32_t ipaddr);
 /*!
     \brief      receive task
@@ -1163,6 +1209,9 @@ static void cip_recv_task(void *param)
     int max_fd_num = 0;
     int cli_fd, i, j, recv_sz;
     char *rx_buf;
+#if LWIP_SOCKET_RECV_PBUF
+    struct pbuf *rx_p, *q;
+#endif
     uint32_t rx_len = PASSTH_START_TRANSFER_LEN;
     struct sockaddr_in saddr;
     int addr_sz = sizeof(saddr);
@@ -1441,10 +1490,19 @@ UDP_RETRY_SEND:
 
         for (i = 0; i < MAX_CLIENT_NUM; i++) {
             if ((cip_info.cli[i].fd >= 0) && FD_ISSET(cip_info.cli[i].fd, &read_set)) {
-                sys_memset(rx_buf, 0, rx_len);
+#if LWIP_SOCKET_RECV_PBUF
+                rx_p = NULL;
+#endif
                 if (cip_info.cli[i].type == CIP_TYPE_TCP) {
+#if LWIP_SOCKET_RECV_PBUF
+                    /* Borrow the received segment instead of copying it into rx_buf,
+                       the TCP window is opened again once it has been output */
+                    recv_sz = lwip_recv_pbuf(cip_info.cli[i].fd, &rx_p, 0);
+#else
                     recv_sz = recv(cip_info.cli[i].fd, rx_buf, rx_len, 0);
+#endif
                 } else {
+                    sys_memset(rx_buf, 0, rx_len);
                     sys_memset(&saddr, 0, sizeof(saddr));
                     recv_sz = recvfrom(cip_info.cli[i].fd, rx_buf, rx_len,
                                         0, (struct sockaddr *)&saddr, (socklen_t*)&addr_sz);
@@ -1477,27 +1535,53 @@ UDP_RETRY_SEND:
 #ifdef CONFIG_ATCMD_SPI
                     // Discard packets during file transfer
                     if (cip_info.trans_mode == CIP_TRANS_MODE_FILE_TRANSFER &&
-                        cip_file_trans_info.terminate == 1)
+                        cip_file_trans_info.terminate == 1) {
+#if LWIP_SOCKET_RECV_PBUF
+                        lwip_recv_pbuf_free(cip_info.cli[i].fd, rx_p);
+#endif
                         break;
+                    }
 #else
                     if (cip_info.trans_mode == CIP_TRANS_MODE_PASSTHROUGH &&
                             cip_passth_info.passth_fd_idx == i) {
+#if LWIP_SOCKET_RECV_PBUF
+                        if (rx_p) {
+                            for (q = rx_p; q != NULL; q = q->next)
+                                AT_RSP_DIRECT(q->payload, q->len);
+                        } else
+#endif
                         AT_RSP_DIRECT(rx_buf, recv_sz);
                     }
 #endif
                     if (cip_info.trans_mode == CIP_TRANS_MODE_NORMAL) {
 #ifdef CONFIG_ATCMD_SPI
-                        at_spi_recv_data_process(i, (uint8_t *)rx_buf, recv_sz);
+#if LWIP_SOCKET_RECV_PBUF
+                        at_spi_recv_data_process(i, (uint8_t *)rx_buf, rx_p, recv_sz);
+#else
+                        at_spi_recv_data_process(i, (uint8_t *)rx_buf, NULL, recv_sz);
+#endif
 #else
-                        AT_RSP_START(64 + recv_sz);
-                        AT_RSP("+IPD,%d,%d: ", cip_info.cli[i].fd, recv_sz);
-                        for (j = 0; j < recv_sz; j++)
-                            AT_RSP("%c", rx_buf[j]);
-                        AT_RSP("\r\n");
-                        AT_RSP_OK();
+#if LWIP_SOCKET_RECV_PBUF
+                        /* a borrowed chain can hold up to a window of merged segments */
+                        if (rx_p) {
+                            cip_ipd_pbuf_send(cip_info.cli[i].fd, rx_p, rx_len);
+                        } else
+#endif
+                        {
+                            AT_RSP_START(64 + recv_sz);
+                            AT_RSP("+IPD,%d,%d: ", cip_info.cli[i].fd, recv_sz);
+                            sys_memcpy(rsp_buf + rsp_buf_idx, rx_buf, recv_sz);
+                            rsp_buf_idx += recv_sz;
+                            AT_RSP("\r\n");
+                            AT_RSP_OK();
+                        }
 #endif
                     }
                 }
+#if LWIP_SOCKET_RECV_PBUF
+                if (rx_p)
+                    lwip_recv_pbuf_free(cip_info.cli[i].fd, rx_p);
+#endif
             }
             if ((cip_info.cli[i].fd >= 0) && (FD_ISSET(cip_info.cli[i].fd, &except_set) ||
                 (wifi_vif_is_softap(vif_idx) && !dhcpd_ipaddr_is_valid(cip_info.cli[i].remote_ip)))) {
@@ -1566,9 +1650,11 @@ Exit:
 void at_cip_ping(int argc, char **argv)
 {
     struct ping_info_t *ping_info = NULL;
+    char *endptr = NULL;
+    uint32_t count = 5, size = 120, interval_us = 1000 * 1000, flood = 0;
 
-    AT_RSP_START(128);
-    if (argc == 2) {
+    AT_RSP_START(256);
+    if ((argc >= 2) && (argc <= 6)) {
         if (argv[1][0] == AT_QUESTION) {
             goto Usage;
         } else {
@@ -1583,6 +1669,23 @@ void at_cip_ping(int argc, char **argv)
             if (domain == NULL) {
                 goto Error;
             }
+            if (argc > 2) {
+                count = (uint32_t)strtoul((const char *)argv[2], &endptr, 10);
+                if ((*endptr != '\0') || (count == 0))
+                    goto Error;
+            }
+            if (argc > 3) {
+                size = (uint32_t)strtoul((const char *)argv[3], &endptr, 10);
+                if ((*endptr != '\0') || (size > (IP_REASS_MAX_PBUFS * 1480 - 8)))
+                    goto Error;
+            }
+            if ((argc > 4) && ping_interval_parse(argv[4], &interval_us))
+                goto Error;
+            if (argc > 5) {
+                flood = (uint32_t)strtoul((const char *)argv[5], &endptr, 10);
+                if ((*endptr != '\0') || (flood > 1))
+                    goto Error;
+            }
 
             memset(&hints, 0, sizeof(hints));
             if (getaddrinfo(domain, NULL, &hints, &res) != 0) {
@@ -1606,12 +1709,25 @@ void at_cip_ping(int argc, char **argv)
             inet_ntop(res->ai_family, ptr, ip_addr, sizeof(ip_addr));
             freeaddrinfo(res);
             memcpy(ping_info->ping_ip, ip_addr, sizeof(ping_info->ping_ip));
-            ping_info->ping_cnt = 5;
-            ping_info->ping_size = 120;
-            ping_info->ping_interval = 1000;
+            ping_info->ping_cnt = count;
+            ping_info->ping_size = size;
+            ping_info->ping_interval_us = interval_us;
+            ping_info->ping_flood = flood;
+            ping_info->at_rsp_send = at_hw_send;
             if (ping(ping_info) != ERR_OK)
                 goto Error;
-            AT_RSP("%s", ping_info->ping_res);
+            /* delays in us */
+            AT_RSP("+PINGSTAT:%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\r\n",
+                   ping_info->ping_send_count, ping_info->ping_recv_count,
+                   ping_info->ping_recv_count ? ping_info->ping_min_delay : 0,
+                   ping_info->ping_recv_count ?
+                        (uint32_t)(ping_info->ping_total_delay / ping_info->ping_recv_count) : 0,
+                   ping_info->ping_max_delay,
+                   ping_percentile(ping_info, 50), ping_percentile(ping_info, 90),
+                   ping_percentile(ping_info, 99),
+                   ping_info->ping_jitter_cnt ?
+                        (uint32_t)(ping_info->ping_jitter_total / ping_info->ping_jitter_cnt) : 0,
+                   ping_info->ping_loss_bursts, ping_info->ping_loss_burst_max);
         }
     } else {
         goto Error;
@@ -1629,7 +1745,7 @@ Error:
     AT_RSP_ERR();
     return;
 Usage:
-    AT_RSP("+PING=<ip or domain name>\r\n");
+    AT_RSP("+PING=<ip or domain name>[,<count>[,<size>[,<interval ms>[,<flood>]]]]\r\n");
     AT_RSP_OK();
     return;
 }
@@ -2837,6 +2953,7 @@ void at_cip_sntp_update_time_succ(void)
 void at_cip_sntp_get_time(int argc, char **argv)
 {
     char buf[32] = {0};
+    uint32_t err_us;
 
     AT_RSP_START(256);
     if (argc == 1) {
@@ -2844,6 +2961,9 @@ void at_cip_sntp_get_time(int argc, char **argv)
             AT_RSP("Please start the SNTP or wait for the SNTP time update.\r\n");
         } else {
             AT_RSP("SNTP time: %s\n", buf);
+            if (sntp_get_error_bound_us(&err_us) == 0) {
+                AT_RSP("+CIPSNTPERR:%u\r\n", err_us);
+            }
         }
     } else {
         goto Error;
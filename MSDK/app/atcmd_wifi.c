@@ -496,6 +496,58 @@ Error:
     return;
 }
 
+#ifdef CONFIG_WIFI_STA_TABLE
+/*!
+    \brief      the AT command show the traffic counters of the stations connected to the softAP
+    \param[in]  argc: number of parameters
+    \param[in]  argv: the pointer to the array that holds the parameters
+    \param[out] none
+    \retval     none
+*/
+void at_cw_ap_client_stat(int argc, char **argv)
+{
+    struct wifi_sta_info *info = NULL;
+    uint32_t now, last;
+    int num, i;
+
+    AT_RSP_START(256);
+    if (argc == 1) {
+        info = sys_malloc(AT_MAX_STATION_NUM * sizeof(struct wifi_sta_info));
+        if (info == NULL) {
+            goto Error;
+        }
+        num = wifi_sta_table_list(-1, info, AT_MAX_STATION_NUM);
+        now = sys_current_time_get();
+        for (i = 0; i < num; i++) {
+            last = info[i].last_rx ? info[i].last_rx : info[i].assoc_time;
+            AT_RSP("+CWLIFSTAT: %d,"MAC_FMT","IP_FMT",%u,%u,%u,%u,%u,%u,%u\r\n",
+                   info[i].aid, MAC_ARG_UINT8(info[i].mac),
+                   IP_ARG(dhcpd_find_ipaddr_by_macaddr(info[i].mac)),
+                   info[i].rx_pkts, (uint32_t)(info[i].rx_bytes >> 10),
+                   info[i].tx_pkts, (uint32_t)(info[i].tx_bytes >> 10),
+                   info[i].tx_fail, (now - last) / 1000, info[i].listen_interval);
+            AT_RSP_IMMEDIATE();
+        }
+        sys_mfree(info);
+    } else if ((argc == 2) && (argv[1][0] == AT_QUESTION)) {
+        goto Usage;
+    } else {
+        goto Error;
+    }
+
+    AT_RSP_OK();
+    return;
+
+Error:
+    AT_RSP_ERR();
+    return;
+Usage:
+    AT_RSP("+CWLIFSTAT: <aid>,<mac>,<ip>,<rx_pkts>,<rx_kbytes>,<tx_pkts>,<tx_kbytes>,<tx_fail>,<idle_s>,<listen_interval>\r\n");
+    AT_RSP_OK();
+    return;
+}
+#endif /* CONFIG_WIFI_STA_TABLE */
+
 /*!
     \brief      the AT command configure whether to connect AP automatically after power on
     \param[in]  argc: number of parameters
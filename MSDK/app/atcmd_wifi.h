@@ -42,6 +42,9 @@ void at_cw_status(int argc, char **argv);
 void at_cw_ap_quit(int argc, char **argv);
 void at_cw_ap_cur_start(int argc, char **argv);
 void at_cw_ap_client_list(int argc, char **argv);
+#ifdef CONFIG_WIFI_STA_TABLE
+void at_cw_ap_client_stat(int argc, char **argv);
+#endif
 void at_cw_auto_connect(int argc, char **argv);
 
 #endif //_ATCMD_WIFI_H_
@@ -39,12 +39,28 @@ OF SUCH DAMAGE.
 #include "gd32vw55x.h"
 #include "lwip/igmp.h"
 #include "lwip/inet.h"
+#include "lwip/ip4_frag.h"
 #include "lwip/sockets.h"
 #include "wifi_vif.h"
 #include "wifi_net_ip.h"
 #include "wifi_management.h"
 #include "wifi_export.h"
 #include "wifi_init.h"
+#ifdef CONFIG_WIFI_CAPTURE
+#include "wifi_capture.h"
+#endif
+#ifdef CONFIG_WIFI_ROAM_SCAN
+#include "wifi_roam_scan.h"
+#endif
+#ifdef CONFIG_WIFI_STA_TABLE
+#include "wifi_sta_table.h"
+#endif
+#ifdef CONFIG_LWIP_MEM_TELEMETRY
+#include "mem_telemetry.h"
+#endif
+#ifdef CONFIG_LWIP_MCAST_FILTER
+#include "net_mcast_filter.h"
+#endif
 #include "cmd_shell.h"
 #include "dbg_print.h"
 #include "uart.h"
@@ -56,6 +72,7 @@ OF SUCH DAMAGE.
 #include "log_uart.h"
 #include "wakelock.h"
 #include "trace_uart.h"
+#include "raw_flash_api.h"
 #ifdef CONFIG_OTA_DEMO_SUPPORT
 #include "ota_demo.h"
 #endif
@@ -67,6 +84,8 @@ OF SUCH DAMAGE.
 #include "trace_ext.h"
 #endif
 
+#include "tls_session.h"
+
 #if defined(CONFIG_RF_TEST_SUPPORT) || defined(CONFIG_INTERNAL_DEBUG)
 #include "cmd_rftest.h"
 #endif
@@ -404,6 +423,40 @@ static void cmd_free(int argc, char **argv)
     return;
 }
 
+#ifdef CFG_HEAP_PROFILE
+static void cmd_heap_prof(int argc, char **argv)
+{
+    sys_heap_site_t sites[HEAP_PROF_SITE_NUM + 1];
+    sys_heap_frag_t frag;
+    uint32_t live, peak, fail_cnt;
+    int num, i;
+
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        sys_heap_prof_reset();
+        return;
+    } else if (argc != 1) {
+        goto Usage;
+    }
+
+    sys_heap_prof_info(&live, &peak, &fail_cnt);
+    sys_heap_frag_get(&frag);
+    app_print("live %u peak %u, failed %u\r\n", live, peak, fail_cnt);
+    app_print("free %u in %u blocks, largest %u, frag %u.%u%%\r\n", frag.free_bytes,
+              frag.free_blocks, frag.largest_free, frag.frag_permille / 10, frag.frag_permille % 10);
+
+    num = sys_heap_prof_sites_get(sites, HEAP_PROF_SITE_NUM + 1);
+    app_print("ra\t\tlive\tpeak\tblocks\tallocs\r\n");
+    for (i = 0; i < num; i++) {
+        app_print("0x%08x\t%u\t%u\t%u\t%u\r\n", sites[i].ra, sites[i].live_bytes,
+                  sites[i].peak_bytes, sites[i].live_cnt, sites[i].alloc_cnt);
+    }
+    return;
+
+Usage:
+    app_print("Usage: heap_prof [reset]\n\r");
+}
+#endif
+
 static void cmd_sys_ps(int argc, char **argv)
 {
     uint8_t ps_mode;
@@ -463,6 +516,126 @@ Usage:
     app_print("Usage: ps_stats\n\r");
 }
 
+static void cmd_sleep_stats(int argc, char **argv)
+{
+    static const char *state_name[SYS_SLEEP_STATE_NUM] = {"wfi", "light", "deep"};
+    sys_sleep_stats_t stats;
+    int reset = 0;
+    int i;
+
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        reset = 1;
+    } else if (argc != 1) {
+        goto Usage;
+    }
+
+    sys_sleep_stats_get(&stats, reset);
+    app_print("stats_time: %u ms\r\n", stats.stats_ms);
+    for (i = 0; i < SYS_SLEEP_STATE_NUM; i++) {
+        app_print("%-6s enter: %u residency: %u ms\r\n", state_name[i], stats.enter_cnt[i],
+                  (uint32_t)(stats.residency_us[i] / 1000));
+    }
+    app_print("wakeup timer: %u irq: %u abort: %u\r\n", stats.wake_timer_cnt,
+              stats.wake_irq_cnt, stats.abort_cnt);
+    app_print("timer coalesced: %u\r\n", stats.timer_coalesced);
+    return;
+
+Usage:
+    app_print("Usage: sleep_stats [reset]\n\r");
+}
+
+static void cmd_flash_stats(int argc, char **argv)
+{
+    raw_flash_stats_t stats;
+    uint32_t bound;
+    int reset = 0;
+    int i;
+
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        reset = 1;
+    } else if (argc != 1) {
+        goto Usage;
+    }
+
+    raw_flash_stats_get(&stats, reset);
+    app_print("requests: read %u write %u erase %u, failed %u, suspended %u\r\n",
+              stats.req_cnt[RAW_FLASH_OP_READ], stats.req_cnt[RAW_FLASH_OP_WRITE],
+              stats.req_cnt[RAW_FLASH_OP_ERASE], stats.fail_cnt, stats.suspend_cnt);
+    app_print("queue: depth %u max %u\r\n", stats.queue_depth, stats.queue_max);
+
+    app_print("latency (ms, max %u):\r\n", stats.lat_max_ms);
+    for (i = 0, bound = RAW_FLASH_LAT_HIST_BASE_MS; i < RAW_FLASH_HIST_BINS - 1; i++, bound <<= 2)
+        app_print("\t< %u: %u\r\n", bound, stats.lat_hist[i]);
+    app_print("\t>= %u: %u\r\n", bound >> 2, stats.lat_hist[i]);
+
+    app_print("irq off (us, max %u):\r\n", stats.irq_off_max_us);
+    for (i = 0, bound = RAW_FLASH_IRQ_HIST_BASE_US; i < RAW_FLASH_HIST_BINS - 1; i++, bound <<= 2)
+        app_print("\t< %u: %u\r\n", bound, stats.irq_off_hist[i]);
+    app_print("\t>= %u: %u\r\n", bound >> 2, stats.irq_off_hist[i]);
+    return;
+
+Usage:
+    app_print("Usage: flash_stats [reset]\n\r");
+}
+
+#ifdef CFG_TLS_SESSION_CACHE
+static void cmd_tls_sess(int argc, char **argv)
+{
+    static const char *type_name[TLS_HS_TYPE_NUM] = {"full", "resumed"};
+    tls_session_stats_t stats;
+    tls_hs_stats_t *hs;
+    int reset = 0;
+    int i;
+
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        reset = 1;
+    } else if (argc == 2 && !strcmp(argv[1], "flush")) {
+        tls_session_flush();
+        return;
+    } else if (argc != 1) {
+        goto Usage;
+    }
+
+    tls_session_stats_get(&stats, reset);
+    app_print("stats_time: %u ms\r\n", stats.stats_ms);
+    for (i = 0; i < TLS_HS_TYPE_NUM; i++) {
+        hs = &stats.hs[i];
+        app_print("%-7s handshakes: %u time avg %u max %u ms, heap avg %u max %u\r\n", type_name[i], hs->cnt,
+                  hs->cnt ? hs->time_sum_ms / hs->cnt : 0, hs->time_max_ms,
+                  hs->cnt ? hs->heap_sum / hs->cnt : 0, hs->heap_max);
+    }
+    app_print("failed: %u\r\n", stats.fail_cnt);
+    app_print("cache hit: %u miss: %u rejected: %u expired: %u stored: %u\r\n", stats.hit_cnt,
+              stats.miss_cnt, stats.reject_cnt, stats.expire_cnt, stats.store_cnt);
+    return;
+
+Usage:
+    app_print("Usage: tls_sess [reset | flush]\n\r");
+}
+#endif /* CFG_TLS_SESSION_CACHE */
+
+#ifdef CONFIG_PRINT_DEFERRED
+static void cmd_log_bench(int argc, char **argv)
+{
+    char *endptr = NULL;
+    uint32_t count = 100;
+
+    if (argc > 2)
+        goto Usage;
+    if (argc == 2) {
+        count = (uint32_t)strtoul((const char *)argv[1], &endptr, 0);
+        if (*endptr != '\0' || count == 0)
+            goto Usage;
+    }
+
+    co_printf_bench(count);
+    return;
+
+Usage:
+    app_print("Usage: log_bench [count]\n\r");
+}
+#endif
+
 /**
  ****************************************************************************************
  * @brief Process function for 'cpu_stats' command
@@ -476,6 +649,56 @@ static void cmd_cpu_stats(int argc, char **argv)
     sys_cpu_stats();
 }
 
+#ifdef CFG_OS_PROFILE
+static void os_prof_hist_print(const char *title, uint32_t *hist, uint32_t max_us)
+{
+    uint32_t bound;
+    int i;
+
+    app_print("%s (us, max %u):\r\n", title, max_us);
+    for (i = 0, bound = OS_PROF_HIST_BASE_US; i < OS_PROF_HIST_BINS - 1; i++, bound <<= 2)
+        app_print("\t< %u: %u\r\n", bound, hist[i]);
+    app_print("\t>= %u: %u\r\n", bound >> 2, hist[i]);
+}
+
+static void cmd_os_prof(int argc, char **argv)
+{
+    sys_prof_task_t tasks[OS_PROF_TASK_NUM + 1];
+    sys_prof_stats_t stats;
+    uint32_t permille;
+    int reset = 0;
+    int num, i;
+
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        reset = 1;
+    } else if (argc != 1) {
+        goto Usage;
+    }
+
+    num = sys_prof_task_get(tasks, OS_PROF_TASK_NUM + 1);
+    sys_prof_stats_get(&stats, reset);
+
+    app_print("TaskName\tRun(ms)\tCPU\tSwitch\tReadyMax(us)\r\n");
+    for (i = 0; i < num; i++) {
+        permille = stats.stats_us ? (uint32_t)((tasks[i].run_us * 1000) / stats.stats_us) : 0;
+        app_print("%-12s\t%u\t%u.%u%%\t%u\t%u\r\n", tasks[i].name, (uint32_t)(tasks[i].run_us / 1000),
+                  permille / 10, permille % 10, tasks[i].switch_cnt, tasks[i].ready_max_us);
+    }
+    app_print("time %u ms, switches %u, isr %u in %u ms\r\n", stats.stats_us / 1000,
+              stats.switch_cnt, stats.isr_cnt, (uint32_t)(stats.isr_total_us / 1000));
+    app_print("longest irq off window from ra 0x%08x\r\n", stats.irq_off_max_ra);
+
+    os_prof_hist_print("run", stats.run_hist, stats.run_max_us);
+    os_prof_hist_print("ready", stats.ready_hist, stats.ready_max_us);
+    os_prof_hist_print("isr", stats.isr_hist, stats.isr_max_us);
+    os_prof_hist_print("irq off", stats.irq_off_hist, stats.irq_off_max_us);
+    return;
+
+Usage:
+    app_print("Usage: os_prof [reset]\n\r");
+}
+#endif
+
 static void cmd_read_memory(int argc, char **argv)
 {
     char *endptr = NULL;
@@ -514,6 +737,55 @@ exit:
 #if LWIP_STATS && LWIP_STATS_DISPLAY
 static void cmd_lwip_stats(int argc, char **argv)
 {
+#if IP_REASSEMBLY
+    if ((argc >= 2) && !strcmp(argv[1], "reass")) {
+        struct ip_reass_stats st;
+
+        ip_reass_stats_get(&st, (argc == 3) && !strcmp(argv[2], "reset"));
+        app_print("reass: pbufs %u/%u, rx buffers %u/%u (peak %u)\r\n",
+                  st.pbufs, IP_REASS_MAX_PBUFS, st.custom, IP_REASS_MAX_CUSTOM_PBUFS, st.custom_peak);
+        app_print("    copied %u, source quota drop %u, pressure drop %u, copy fail %u\r\n",
+                  st.copied, st.src_drop, st.pressure_drop, st.copy_fail);
+        return;
+    }
+#endif
+#ifdef CONFIG_LWIP_MCAST_FILTER
+    if ((argc >= 2) && !strcmp(argv[1], "mcast")) {
+        net_mcast_filter_dump();
+        if ((argc == 3) && !strcmp(argv[2], "reset"))
+            net_mcast_filter_stats_get(NULL, 1);
+        return;
+    }
+#endif
+#ifdef CONFIG_LWIP_MEM_TELEMETRY
+    if ((argc == 2) && !strcmp(argv[1], "mem")) {
+        mem_tlm_report();
+        return;
+    } else if ((argc >= 3) && !strcmp(argv[1], "trace")) {
+        if (!strcmp(argv[2], "start") && (argc <= 4)) {
+            if (mem_tlm_start((argc == 4) ? (uint32_t)atoi(argv[3]) : 0))
+                app_print("lwip_stats: start trace failed\r\n");
+            return;
+        } else if (!strcmp(argv[2], "stop") && (argc == 3)) {
+            mem_tlm_stop();
+            return;
+        } else if (!strcmp(argv[2], "reset") && (argc == 3)) {
+            mem_tlm_reset();
+            return;
+        } else if (!strcmp(argv[2], "dump") && (argc == 3)) {
+            mem_tlm_trace_dump();
+            return;
+        }
+    }
+    if (argc > 1) {
+        app_print("Usage: lwip_stats [mem | trace <start [interval ms] | stop | reset | dump> | reass [reset] | mcast [reset]]\r\n");
+        app_print("    mem: pool high water marks and allocation failures\r\n");
+        app_print("    trace: sample the pools, dump the samples for the lwipopts.h sizing tool\r\n");
+        app_print("    reass: IP reassembly queue usage and drops\r\n");
+        app_print("    mcast: joined multicast MAC addresses and filtered frames\r\n");
+        return;
+    }
+#endif
     stats_display();
 }
 #endif
@@ -1013,6 +1285,7 @@ Usage:
  *
    @verbatim
       wifi_roaming 1/0 rss_threshold or wifi_roaming
+      wifi_roaming stats [reset]
    @endverbatim
  *
  * @param[in] [enable] [rssi_threshold]
@@ -1031,6 +1304,15 @@ static void cmd_wifi_roaming(int argc, char **argv)
         return;
     }
 
+#ifdef CONFIG_WIFI_ROAM_SCAN
+    if ((argc >= 2) && (strcmp(argv[1], "stats") == 0)) {
+        wifi_roam_scan_dump();
+        if ((argc >= 3) && (strcmp(argv[2], "reset") == 0))
+            wifi_roam_scan_stats_get(NULL, true);
+        return;
+    }
+#endif
+
     if (argc >= 3) {
         rssi_th = atoi(argv[2]);
         if (rssi_th >= 0) {
@@ -1055,6 +1337,9 @@ static void cmd_wifi_roaming(int argc, char **argv)
 Usage:
     app_print("Usage: wifi_roaming [enable] [rssi_threshold]\r\n");
     app_print("Example: wifi_roaming 1 -70\r\n");
+#ifdef CONFIG_WIFI_ROAM_SCAN
+    app_print("       wifi_roaming stats [reset]\r\n");
+#endif
 }
 
 /**
@@ -1274,6 +1559,40 @@ static void cmd_wifi_ap_stop(int argc, char **argv)
 {
     wifi_management_ap_stop();
 }
+
+#ifdef CONFIG_WIFI_STA_TABLE
+/*!
+    \brief      show the clients of the softap with their traffic counters
+    \param[in]  argc: number of parameters
+    \param[in]  argv: the pointer to the array that holds the parameters
+    \param[out] none
+    \retval     none
+*/
+static void cmd_wifi_ap_client_list(int argc, char **argv)
+{
+    char *endptr = NULL;
+    uint32_t timeout;
+
+    if (argc == 1) {
+        wifi_sta_table_dump(-1);
+    } else if ((argc == 2) && (strcmp(argv[1], "reset") == 0)) {
+        wifi_sta_table_stats_get(NULL, true);
+    } else if ((argc == 3) && (strcmp(argv[1], "idle") == 0)) {
+        timeout = (uint32_t)strtoul(argv[2], &endptr, 10);
+        if (*endptr != '\0')
+            goto Usage;
+        wifi_sta_table_idle_timeout_set(timeout);
+    } else {
+        goto Usage;
+    }
+    return;
+
+Usage:
+    app_print("Usage: wifi_ap_client_list [reset | idle <seconds>]\r\n");
+    app_print("    idle 0 disables the eviction of inactive clients, current %u s\r\n",
+              wifi_sta_table_idle_timeout_get());
+}
+#endif /* CONFIG_WIFI_STA_TABLE */
 #endif // CFG_SOFTAP
 
 #ifdef CONFIG_SOFTAP_PROVISIONING
@@ -1439,6 +1758,9 @@ static void cmd_wifi_monitor(int argc, char **argv)
                 return;
             }
 
+#ifdef CONFIG_WIFI_CAPTURE
+            wifi_capture_stop();
+#endif
             /* stop monitor first, if the monitor is already started */
             wifi_management_sta_start();
             return;
@@ -1452,6 +1774,103 @@ usage:
     app_print("stop: stop the monitor mode.\r\n");
 }
 
+#ifdef CONFIG_WIFI_CAPTURE
+/**
+ ****************************************************************************************
+ * @brief Process function for 'wifi_capture' command
+ *
+ * Start monitor mode and stream the frames passing the filter as pcap with radiotap
+ * headers, or only count them.
+ *
+   @verbatim
+     wifi_capture start <channel> [snap <len>] [uart | tcp <ip> <port>] [filter <expr>]
+     wifi_capture stop
+     wifi_capture stats [reset]
+   @endverbatim
+ *
+ * @param[in] params capture start/stop/stats commands above
+ ****************************************************************************************
+ */
+static void cmd_wifi_capture(int argc, char **argv)
+{
+    struct wifi_capture_cfg cfg;
+    struct wifi_capture_stats *stats;
+    char expr[128];
+    int i, len = 0, ret;
+
+    if ((argc >= 3) && !strcmp(argv[1], "start")) {
+        sys_memset(&cfg, 0, sizeof(cfg));
+        cfg.channel = atoi(argv[2]);
+        cfg.sink = WIFI_CAPTURE_SINK_NONE;
+        expr[0] = '\0';
+        for (i = 3; i < argc; i++) {
+            if (!strcmp(argv[i], "snap") && (i + 1 < argc)) {
+                cfg.snap_len = atoi(argv[++i]);
+            } else if (!strcmp(argv[i], "uart")) {
+                cfg.sink = WIFI_CAPTURE_SINK_UART;
+            } else if (!strcmp(argv[i], "tcp") && (i + 2 < argc)) {
+                if (inet_aton(argv[i + 1], (struct in_addr *)&cfg.ip) == 0)
+                    goto usage;
+                cfg.port = atoi(argv[i + 2]);
+                cfg.sink = WIFI_CAPTURE_SINK_TCP;
+                i += 2;
+            } else if (!strcmp(argv[i], "filter")) {
+                /* the filter takes the rest of the line */
+                for (i++; (i < argc) && (len + strlen(argv[i]) + 2 <= sizeof(expr)); i++)
+                    len += sprintf(expr + len, "%s ", argv[i]);
+                if (i < argc)
+                    goto usage;
+            } else {
+                goto usage;
+            }
+        }
+
+        if (wifi_capture_filter_compile(expr, &cfg.filter)) {
+            app_print("wifi_capture: invalid filter\r\n");
+            return;
+        }
+        ret = wifi_capture_start(&cfg);
+        if (ret == WIFI_CAPTURE_ERR_UART_SHARED)
+            app_print("wifi_capture: the capture UART is used by the console, use tcp\r\n");
+        else if (ret)
+            app_print("wifi_capture: start failed %d\r\n", ret);
+        return;
+    } else if ((argc == 2) && !strcmp(argv[1], "stop")) {
+        wifi_capture_stop();
+        if (wifi_vif_tab[WIFI_VIF_INDEX_DEFAULT].wvif_type == WVIF_MONITOR)
+            wifi_management_sta_start();
+        return;
+    } else if ((argc >= 2) && !strcmp(argv[1], "stats")) {
+        stats = sys_malloc(sizeof(*stats));
+        if (stats == NULL)
+            return;
+        wifi_capture_stats_get(stats, (argc == 3) && !strcmp(argv[2], "reset"));
+        app_print("chan        rx  filtered  captured   dropped\r\n");
+        for (i = 0; i <= WIFI_CAPTURE_CHANNEL_NUM; i++) {
+            if (stats->chan[i].rx == 0)
+                continue;
+            app_print("%4d %9u %9u %9u %9u\r\n", i, stats->chan[i].rx, stats->chan[i].filtered,
+                      stats->chan[i].captured, stats->chan[i].dropped);
+        }
+        app_print("sent %u frames %u bytes, sink errors %u, ring high watermark %u/%u\r\n",
+                  stats->sent, stats->sent_bytes, stats->sink_err, stats->ring_hwm,
+                  WIFI_CAPTURE_RING_SIZE);
+        sys_mfree(stats);
+        return;
+    }
+
+usage:
+    app_print("Usage: wifi_capture start <channel> [snap <len>] [uart | tcp <ip> <port>] [filter <expr>]\r\n");
+    app_print("       wifi_capture stop | stats [reset]\r\n");
+    app_print("<len>: bytes kept from each frame, default %d, max %d.\r\n",
+              WIFI_CAPTURE_SNAP_LEN_DEFAULT, WIFI_CAPTURE_SNAP_LEN_MAX);
+    app_print("uart | tcp: pcap stream output, only count frames if not set.\r\n");
+    app_print("<expr>: frame types (mgmt ctrl data beacon probe_req probe_resp auth deauth\r\n");
+    app_print("        assoc_req assoc_resp action rts cts ack qos_data null ...),\r\n");
+    app_print("        bssid <xx:xx:xx:xx:xx:xx>, rssi <min dBm>.\r\n");
+}
+#endif /* CONFIG_WIFI_CAPTURE */
+
 #ifdef CFG_WPS
 /**
  ****************************************************************************************
@@ -1793,12 +2212,33 @@ static void cmd_nvds_handle(int argc, char **argv)
                 }
             }
         }
+    } else if (!strcmp("gc", option)) {
+        struct nvds_gc_stats stats;
+
+        if (argc > 2) {
+            ret = nvds_gc_watermark_set(NULL, (uint8_t)atoi(argv[2]));
+            if (ret) {
+                app_print("NVDS gc set watermark failed, error code:%d\r\n", ret);
+                goto usage;
+            }
+        }
+
+        ret = nvds_gc_stats_get(NULL, &stats, 0);
+        if (ret) {
+            app_print("NVDS gc get statistics failed, error code:%d\r\n", ret);
+            return;
+        }
+        app_print("free pages: %u, watermark: %u\r\n", stats.free_pages, stats.watermark);
+        app_print("gc steps: %u, pages reclaimed: %u, pages erased: %u, entries relocated: %u\r\n",
+                  stats.steps, stats.pages_reclaimed, stats.pages_erased, stats.entries_relocated);
+        app_print("inline erase: %u, inline compaction: %u, max inline latency: %u ms\r\n",
+                  stats.fg_erase_cnt, stats.fg_gc_cnt, stats.fg_max_ms);
     } else {
         goto usage;
     }
     return;
 usage:
-    app_print("Usage: nvds clean | add | del | dump [options]\r\n");
+    app_print("Usage: nvds clean | add | del | dump | gc [options]\r\n");
     app_print("     : nvds clean : Erase internal nvds flash.\r\n");
     app_print("     : nvds add <namespace> <key> <value> : Save data to nvds flash.\r\n");
     app_print("     : nvds del <namespace> <key> : Delete data in nvds flash.\r\n");
@@ -1807,6 +2247,7 @@ usage:
     app_print("     : nvds dump verbose : Show all data include invalid stored in nvds flash.\r\n");
     app_print("     : nvds dump <namespace> : Show all data in the specified namespace.\r\n");
     app_print("     : nvds dump <namespace> <key> : Show data by specified namespace and key.\r\n");
+    app_print("     : nvds gc [watermark] : Show gc statistics, set the free page watermark if given.\r\n");
     app_print("     : Hexadecimals parmeter starts with 0x, else string.\r\n");
     app_print("Example:\r\n");
     app_print("     : nvds add wifi ip 0xc0a80064\r\n");
@@ -1850,10 +2291,24 @@ static const struct cmd_entry cmd_table[] =
 #ifdef CONFIG_BASECMD
     {"tasks", cmd_task_list},
     {"free", cmd_free},
+#ifdef CFG_HEAP_PROFILE
+    {"heap_prof", cmd_heap_prof},
+#endif
     {"sys_ps", cmd_sys_ps},
     {"cpu_stats", cmd_cpu_stats},
+#ifdef CFG_OS_PROFILE
+    {"os_prof", cmd_os_prof},
+#endif
     {"rmem", cmd_read_memory},
     {"ps_stats", cmd_ps_stats},
+    {"sleep_stats", cmd_sleep_stats},
+    {"flash_stats", cmd_flash_stats},
+#ifdef CFG_TLS_SESSION_CACHE
+    {"tls_sess", cmd_tls_sess},
+#endif
+#ifdef CONFIG_PRINT_DEFERRED
+    {"log_bench", cmd_log_bench},
+#endif
 #ifdef CFG_WLAN_SUPPORT
     {"ping", cmd_ping},
     {"join_group", cmd_group_join},
@@ -1902,9 +2357,15 @@ static const struct cmd_entry cmd_table[] =
 #endif
 
     {"wifi_monitor", cmd_wifi_monitor},
+#ifdef CONFIG_WIFI_CAPTURE
+    {"wifi_capture", cmd_wifi_capture},
+#endif
 #ifdef CFG_SOFTAP
     {"wifi_ap", cmd_wifi_ap},
     {"wifi_ap_client_delete", cmd_wifi_ap_client_delete},
+#ifdef CONFIG_WIFI_STA_TABLE
+    {"wifi_ap_client_list", cmd_wifi_ap_client_list},
+#endif
     {"wifi_stop_ap", cmd_wifi_ap_stop},
 #endif /* CFG_SOFTAP */
 #ifdef CONFIG_SOFTAP_PROVISIONING
@@ -45,6 +45,7 @@ OF SUCH DAMAGE.
 #include "lwip/netdb.h"
 #include "lwip/tcpip.h"
 #include "co_utils.h"
+#include "mqtt_pub_queue.h"
 
 #include "mqtt_ssl_config.c"
 
@@ -71,8 +72,6 @@ uint16_t mqtt_scheme;
 
 int16_t connect_fail_reason = -1;
 
-static cmd_msg_pub_t msg_pub_list;
-
 static cmd_msg_sub_t msg_sub_list;
 cmd_msg_sub_t at_topic_sub_list;
 
@@ -182,39 +181,6 @@ extern void at_mqtt_pub_err_print(publish_msg_t *pub_msg, err_t status);
 extern void at_mqtt_sub_or_unsub_err_print(sub_msg_t *sub_msg, err_t status);
 #endif
 
-static publish_msg_t* publish_msg_mem_malloc(uint16_t input_topic_len, uint16_t input_msg_len)
-{
-    publish_msg_t *pub_msg = sys_calloc(1, sizeof(publish_msg_t));
-    if (pub_msg == NULL) {
-        return NULL;
-    }
-
-    pub_msg->topic = (char*)sys_malloc(input_topic_len);
-    if (pub_msg->topic == NULL) {
-        sys_mfree(pub_msg);
-        return NULL;
-    }
-
-    pub_msg->msg = (char*)sys_malloc(input_msg_len);
-    if (pub_msg->msg == NULL) {
-        sys_mfree(pub_msg->topic);
-        sys_mfree(pub_msg);
-        return NULL;
-    }
-    return pub_msg;
-}
-
-static void publish_msg_mem_free(publish_msg_t *pub_msg)
-{
-    if (pub_msg == NULL) {
-        return;
-    }
-    sys_mfree(pub_msg->topic);
-    sys_mfree(pub_msg->msg);
-    sys_mfree(pub_msg);
-    return;
-}
-
 static sub_msg_t* sub_msg_mem_malloc(uint16_t input_topic_len)
 {
     sub_msg_t *sub_msg = sys_calloc(1, sizeof(sub_msg_t));
@@ -263,6 +229,14 @@ void mqtt_task_suspend(void)
     return;
 }
 
+static void mqtt_task_wait(int timeout)
+{
+    mqtt_task_suspended = true;
+    sys_task_wait_notification(timeout);
+    mqtt_task_suspended = false;
+    return;
+}
+
 void mqtt_task_resume(bool isr)
 {
     if (!mqtt_task_suspended) {
@@ -293,45 +267,41 @@ static void mqtt_info_free(void)
     return;
 }
 
-void mqtt_publish_msg_handle(void)
+static err_t mqtt_pubq_publish(mqtt_client_t *client, const mqtt_pubq_msg_t *msg, bool last_try)
 {
-    publish_msg_t *pub_msg = NULL;
-
-    while (!co_list_is_empty(&(msg_pub_list.cmd_msg_pub_list))) {
-        sys_sched_lock();
-        pub_msg = (publish_msg_t *)co_list_pop_front(&(msg_pub_list.cmd_msg_pub_list));
-        sys_sched_unlock();
-
-        LOCK_TCPIP_CORE();
-        if (mqtt_mode_type_get() == MODE_TYPE_MQTT5) {
+    err_t res;
 #ifndef CONFIG_ATCMD
-            mqtt5_msg_publish(mqtt_client, pub_msg->topic, pub_msg->msg, pub_msg->msg_len, pub_msg->qos, pub_msg->retain,
-                            mqtt_pub_cb, (void *)pub_msg, mqtt_client->mqtt5_config->publish_property_info,
-                            mqtt_client->mqtt5_config->server_resp_property_info.response_info);
+    mqtt_request_cb_t cb = mqtt_pub_cb;
 #else
-            int res = mqtt5_msg_publish(mqtt_client, pub_msg->topic, pub_msg->msg, pub_msg->msg_len, pub_msg->qos, pub_msg->retain,
-                            at_mqtt_pub_result_cb, (void *)pub_msg, mqtt_client->mqtt5_config->publish_property_info,
-                            mqtt_client->mqtt5_config->server_resp_property_info.response_info);
-            if (res != ERR_OK) {
-                at_mqtt_pub_err_print(pub_msg, res);
-            }
+    mqtt_request_cb_t cb = at_mqtt_pub_result_cb;
 #endif
-        } else {
-#ifndef CONFIG_ATCMD
-            mqtt_msg_publish(mqtt_client, pub_msg->topic, pub_msg->msg, pub_msg->msg_len,
-                            pub_msg->qos, pub_msg->retain, mqtt_pub_cb, (void *)pub_msg);
-#else
-            int res = mqtt_msg_publish(mqtt_client, pub_msg->topic, pub_msg->msg, pub_msg->msg_len,
-                            pub_msg->qos, pub_msg->retain, at_mqtt_pub_result_cb, (void *)pub_msg);
-            if (res != ERR_OK) {
-                at_mqtt_pub_err_print(pub_msg, res);
-            }
+
+    if (mqtt_mode_type_get() == MODE_TYPE_MQTT5) {
+        res = mqtt5_msg_publish(client, msg->topic, msg->payload, msg->payload_len, msg->qos, msg->retain,
+                            cb, NULL, client->mqtt5_config->publish_property_info,
+                            client->mqtt5_config->server_resp_property_info.response_info);
+    } else {
+        res = mqtt_msg_publish(client, msg->topic, msg->payload, msg->payload_len,
+                            msg->qos, msg->retain, cb, NULL);
+    }
+#ifdef CONFIG_ATCMD
+    /* the queue keeps the publish on a lost link and retries it while the client is busy */
+    if ((res != ERR_OK) && (res != ERR_CONN) && ((res != ERR_MEM) || last_try)) {
+        publish_msg_t pub_msg = {0};
+
+        pub_msg.topic = (char *)msg->topic;
+        at_mqtt_pub_err_print(&pub_msg, res);
+    }
 #endif
-        }
-        UNLOCK_TCPIP_CORE();
-        publish_msg_mem_free(pub_msg);
+    return res;
+}
+
+int mqtt_publish_msg_handle(void)
+{
+    if (mqtt_client_is_connected(mqtt_client) == false) {
+        return -1;
     }
-    return;
+    return mqtt_pubq_drain(mqtt_client, mqtt_pubq_publish);
 }
 
 bool at_topic_exist(const char *topic)
@@ -692,6 +662,7 @@ static void mqtt_task(void *param)
 {
     uint16_t res = 0;
     bool mqtt_run_flag = false;
+    int pub_delay;
 
     if (mqtt5_param_cfg(mqtt_client)) {
         app_print("MQTT: Configuration parameters failed, stop connection\r\n");
@@ -709,7 +680,7 @@ connect:
 
     while (mqtt_client->run) {
         mqtt_run_flag = true;
-        mqtt_publish_msg_handle();
+        pub_delay = mqtt_publish_msg_handle();
         mqtt_subscribe_or_unsubscribe_msg_handle();
 
         if (mqtt_client_is_connected(mqtt_client) == false) {
@@ -733,7 +704,8 @@ connect:
                 break;
             }
         }
-        mqtt_task_suspend();
+        /* wake up for the publishes left in the queue */
+        mqtt_task_wait(pub_delay);
     }
 
     mqtt_connect_free();
@@ -942,16 +914,18 @@ usage:
 
 static int mqtt_msg_pub_func(const char *topic, const char *data, uint32_t data_len, uint8_t qos, uint8_t retain)
 {
-    publish_msg_t *cmd_msg_pub = NULL;
-    uint32_t input_topic_len, input_data_len;
+    bool connected;
+    int res;
 
-    if ((mqtt_client == NULL) || mqtt_client_is_connected(mqtt_client) == false) {
+    connected = (mqtt_client != NULL) && mqtt_client_is_connected(mqtt_client);
+    if (!connected) {
 #ifndef CONFIG_ATCMD
         app_print("MQTT at_mqtt_msg_pub: client is disconnected, please connect it\r\n");
 #else
         app_print("MQTT at_mqtt_msg_pub: client is disconnected, please connect it, ERR CODE:0x%08x\r\n", AT_MQTT_IN_DISCONNECTED_STATE);
 #endif
-        if ((auto_reconnect != true) || (auto_reconnect_num >= AUTO_RECONNECT_LIMIT)) {
+        /* as before the queue, only a client being reconnected keeps the publishes for later */
+        if ((mqtt_client == NULL) || (auto_reconnect != true) || (auto_reconnect_num >= AUTO_RECONNECT_LIMIT)) {
             return -1;
         }
     }
@@ -974,27 +948,23 @@ static int mqtt_msg_pub_func(const char *topic, const char *data, uint32_t data_
         return -2;
     }
 
-    input_topic_len = strlen((const char *)topic) + 1;
-    input_data_len = data_len + 1;
-    cmd_msg_pub = publish_msg_mem_malloc(input_topic_len, input_data_len);
-    if (cmd_msg_pub == NULL) {
+    /* waits while the queue is above its high water mark and the link drains it */
+    res = mqtt_pubq_push(topic, (const uint8_t *)data, data_len, qos, retain, connected);
+    if (res == MQTT_PUBQ_ERR_LEN) {
+#ifndef CONFIG_ATCMD
+        app_print("MQTT at_mqtt_msg_pub: message is too long\r\n");
+#else
+        app_print("MQTT at_mqtt_msg_pub: message is too long, ERR CODE:0x%08x\r\n", AT_MQTT_DATA_IS_OVERLENGTH);
+#endif
+        return -1;
+    } else if (res != MQTT_PUBQ_OK) {
 #ifndef CONFIG_ATCMD
-        app_print("MQTT at_mqtt_msg_pub: rtos malloc publish msg fail\r\n");
+        app_print("MQTT at_mqtt_msg_pub: publish queue is full\r\n");
 #else
-        app_print("MQTT at_mqtt_msg_pub: rtos malloc publish msg fail, ERR CODE:0x%08x\r\n", AT_MQTT_MALLOC_FAILED);
+        app_print("MQTT at_mqtt_msg_pub: publish queue is full, ERR CODE:0x%08x\r\n", AT_MQTT_PUBLISH_QUEUE_FULL);
 #endif
         return -1;
     }
-    memcpy(cmd_msg_pub->topic, topic, input_topic_len);
-    memcpy(cmd_msg_pub->msg, data, input_data_len);
-
-    cmd_msg_pub->qos = qos;
-    cmd_msg_pub->retain = retain;
-    cmd_msg_pub->msg_len = data_len;
-
-    sys_sched_lock();
-    co_list_push_back(&(msg_pub_list.cmd_msg_pub_list), &(cmd_msg_pub->hdr));
-    sys_sched_unlock();
     mqtt_task_resume(false);
     return 0;
 }
@@ -1136,6 +1106,42 @@ usage:
     return;
 }
 
+void mqtt_pub_queue_info(int argc, char **argv)
+{
+    mqtt_pubq_stats_t stats;
+
+    if (argc == 2) {
+        mqtt_pubq_stats_get(&stats, false);
+    } else if ((argc == 3) && (strcmp(argv[2], "reset") == 0)) {
+        mqtt_pubq_stats_get(&stats, true);
+    } else if ((argc == 3) && (strcmp(argv[2], "flush") == 0)) {
+        mqtt_pubq_flush();
+        app_print("MQTT: publish queue flushed\r\n");
+        return;
+    } else if ((argc == 4) && (strcmp(argv[2], "rate") == 0)) {
+        mqtt_pubq_rate_set((uint32_t)atoi(argv[3]));
+        app_print("MQTT: publish queue drain rate = %d\r\n", atoi(argv[3]));
+        mqtt_task_resume(false);
+        return;
+    } else {
+        goto usage;
+    }
+
+    app_print("MQTT publish queue:\r\n");
+    app_print("    depth %u (peak %u), ram %u bytes, file %u bytes\r\n",
+              stats.depth, stats.peak_depth, stats.ram_bytes, stats.file_bytes);
+    app_print("    enqueued %u, sent %u (%u bytes) in %u batches, spilled %u\r\n",
+              stats.enqueue_cnt, stats.sent_cnt, stats.sent_bytes, stats.batch_cnt, stats.spill_cnt);
+    app_print("    back-pressure waits %u, retries %u, drops: full %u error %u\r\n",
+              stats.wait_cnt, stats.retry_cnt, stats.drop_full_cnt, stats.drop_err_cnt);
+    app_print("    drain rate %u/s, last drain %u msg/s %u B/s\r\n",
+              stats.drain_rate, stats.drain_pps, stats.drain_bps);
+    return;
+usage:
+    app_print("MQTT Usage: mqtt queue [reset | flush | rate <publishes per second, 0: no limit>]\r\n");
+    return;
+}
+
 void mqtt_client_disconnect(int argc, char **argv)
 {
     if (mqtt_client != NULL) {
@@ -1170,6 +1176,8 @@ void cmd_mqtt(int argc, char **argv)
         mqtt_auto_reconnect_set(argc, argv);
     } else if (strcmp(argv[1], "client_id") == 0) {
         mqtt_client_info_set(argc, argv);
+    } else if (strcmp(argv[1], "queue") == 0) {
+        mqtt_pub_queue_info(argc, argv);
     } else if (strcmp(argv[1], "help") == 0) {
         goto usage;
     } else {
@@ -1189,6 +1197,7 @@ usage:
     app_print("         disconnect               --disconnect with server\r\n");
     app_print("         auto_reconnect           --set auto reconnect to server\r\n");
     app_print("         client_id [gigadevice2]  --check or change client_id\r\n");
+    app_print("         queue [reset | flush | rate <n>] --publish queue statistics and drain rate\r\n");
     app_print("eg1.\r\n");
     app_print("    mqtt connect 192.168.3.101 8885 2 vic 123\r\n");
     app_print("eg2.\r\n");
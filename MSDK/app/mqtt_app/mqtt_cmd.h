@@ -126,6 +126,7 @@ OF SUCH DAMAGE.
 #define AT_MQTT_URI_PARSE_FAILED                        0x6050
 #define AT_MQTT_IN_DISCONNECTED_STATE                   0x6051
 #define AT_MQTT_HOSTNAME_VERIFY_FAILED                  0x6052
+#define AT_MQTT_PUBLISH_QUEUE_FULL                      0x6053
 #endif
 
 enum mqtt_mode {
@@ -149,11 +150,6 @@ typedef struct sub_msg {
     bool sub_or_unsub;
 } sub_msg_t;
 
-typedef struct cmd_msg_pub
-{
-    struct co_list cmd_msg_pub_list;
-} cmd_msg_pub_t;
-
 typedef struct cmd_msg_sub
 {
     struct co_list cmd_msg_sub_list;
@@ -179,6 +175,7 @@ void mqtt_msg_pub(int argc, char **argv);
 void mqtt_msg_sub(int argc, char **argv);
 void mqtt_client_disconnect(int argc, char **argv);
 void mqtt_auto_reconnect_set(int argc, char **argv);
+void mqtt_pub_queue_info(int argc, char **argv);
 void mqtt_task_resume(bool isr);
 int at_mqtt_connect_server(const char *host, uint16_t at_port, uint8_t reconnect);
 int at_mqtt_msg_pub(const char *topic, const char *data, uint32_t data_len, uint8_t qos, uint8_t retain);
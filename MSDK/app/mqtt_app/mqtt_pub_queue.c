@@ -0,0 +1,670 @@
+/*!
+    \file    mqtt_pub_queue.c
+    \brief   MQTT publish queue for GD32VW55x SDK.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "mqtt_pub_queue.h"
+
+#ifdef CONFIG_MQTT
+#include <string.h>
+#include "wrapper_os.h"
+#include "lwip/tcpip.h"
+#ifdef CONFIG_FATFS_SUPPORT
+#include "fatfs.h"
+#endif
+
+/* record header, in the RAM ring and in the spill file */
+typedef struct {
+    uint16_t topic_len;             // including the terminating null, 0 marks the unused end of the ring
+    uint16_t payload_len;
+    uint8_t qos;
+    uint8_t retain;
+    uint16_t rsvd;
+} mqtt_pubq_hdr_t;
+
+#define PUBQ_HDR_LEN                sizeof(mqtt_pubq_hdr_t)
+#define PUBQ_REC_LEN(hdr)           ((PUBQ_HDR_LEN + (hdr)->topic_len + (hdr)->payload_len + 3) & ~3U)
+
+static struct {
+    /* RAM ring, records are contiguous and 4 bytes aligned */
+    uint32_t ram[MQTT_PUBQ_RAM_SIZE / 4];
+    uint32_t head;                  // oldest record
+    uint32_t tail;                  // end of the newest record
+    uint32_t used;                  // bytes in use, with the unused end of the ring
+    uint32_t ram_cnt;               // records in the ring
+#ifdef CONFIG_FATFS_SUPPORT
+    /* spill file, holds the records newer than the ones of the ring */
+    uint32_t file_rd;               // oldest record not in the ring
+    uint32_t file_wr;               // end of the newest record
+    uint32_t file_cnt;              // records not in the ring
+    bool file_scanned;              // records left by a previous run were counted
+#endif
+    os_mutex_t lock;
+    os_sema_t room;                 // given when the queue goes under its high water mark
+    uint32_t waiters;               // publishes waiting for room
+    bool init;
+    uint32_t rate;                  // publishes per second, 0 for no limit
+    uint32_t tokens;                // publishes allowed now, in thousandths
+    uint32_t token_ms;              // time of the last token refill
+    uint32_t retry;                 // refused attempts on the oldest record
+    uint32_t drain_ms;              // start of the current drain
+    uint32_t drain_cnt;             // publishes of the current drain
+    uint32_t drain_bytes;           // payload bytes of the current drain
+    mqtt_pubq_stats_t stats;
+} pubq;
+
+static void pubq_init(void)
+{
+    if (pubq.init) {
+        return;
+    }
+    sys_sched_lock();
+    if (!pubq.init) {
+        sys_mutex_init(&pubq.lock);
+        sys_sema_init_ext(&pubq.room, 1, 0);
+        pubq.rate = MQTT_PUBQ_DRAIN_RATE;
+        pubq.init = true;
+    }
+    sys_sched_unlock();
+}
+
+/* reserve len contiguous bytes at the end of the ring, NULL if there is no room */
+static uint8_t *pubq_ram_alloc(uint32_t len)
+{
+    uint8_t *base = (uint8_t *)pubq.ram;
+
+    if (MQTT_PUBQ_RAM_SIZE - pubq.used < len) {
+        return NULL;
+    }
+    if (pubq.used == 0) {
+        pubq.head = pubq.tail = 0;
+    }
+    if (pubq.tail >= pubq.head) {
+        if (MQTT_PUBQ_RAM_SIZE - pubq.tail >= len) {
+            return base + pubq.tail;
+        }
+        if (pubq.head < len) {
+            return NULL;
+        }
+        /* skip the end of the ring, the reader recognizes a short end or a zero topic length */
+        if (MQTT_PUBQ_RAM_SIZE - pubq.tail >= PUBQ_HDR_LEN) {
+            ((mqtt_pubq_hdr_t *)(base + pubq.tail))->topic_len = 0;
+        }
+        pubq.used += MQTT_PUBQ_RAM_SIZE - pubq.tail;
+        pubq.tail = 0;
+    } else if (pubq.head - pubq.tail < len) {
+        return NULL;
+    }
+    return base + pubq.tail;
+}
+
+static void pubq_ram_commit(uint32_t len)
+{
+    pubq.tail += len;
+    if (pubq.tail == MQTT_PUBQ_RAM_SIZE) {
+        pubq.tail = 0;
+    }
+    pubq.used += len;
+    pubq.ram_cnt++;
+}
+
+static mqtt_pubq_hdr_t *pubq_ram_head(void)
+{
+    uint8_t *base = (uint8_t *)pubq.ram;
+
+    if (pubq.ram_cnt == 0) {
+        return NULL;
+    }
+    if ((MQTT_PUBQ_RAM_SIZE - pubq.head < PUBQ_HDR_LEN) ||
+        (((mqtt_pubq_hdr_t *)(base + pubq.head))->topic_len == 0)) {
+        pubq.used -= MQTT_PUBQ_RAM_SIZE - pubq.head;
+        pubq.head = 0;
+    }
+    return (mqtt_pubq_hdr_t *)(base + pubq.head);
+}
+
+static void pubq_ram_pop(mqtt_pubq_hdr_t *hdr)
+{
+    uint32_t len = PUBQ_REC_LEN(hdr);
+
+    pubq.head += len;
+    if (pubq.head == MQTT_PUBQ_RAM_SIZE) {
+        pubq.head = 0;
+    }
+    pubq.used -= len;
+    if (--pubq.ram_cnt == 0) {
+        pubq.head = pubq.tail = pubq.used = 0;
+    }
+}
+
+#ifdef CONFIG_FATFS_SUPPORT
+static int pubq_file_write(FIL *fil, const void *data, uint32_t len)
+{
+    UINT written = 0;
+
+    if ((len == 0) || ((f_write(fil, data, len, &written) == FR_OK) && (written == len))) {
+        return 0;
+    }
+    return -1;
+}
+
+static int pubq_file_read(FIL *fil, void *data, uint32_t len)
+{
+    UINT read_len = 0;
+
+    if ((f_read(fil, data, len, &read_len) == FR_OK) && (read_len == len)) {
+        return 0;
+    }
+    return -1;
+}
+
+static void pubq_file_reset(void)
+{
+    if (pubq.file_wr) {
+        f_unlink(MQTT_PUBQ_FILE);
+    }
+    pubq.file_rd = pubq.file_wr = pubq.file_cnt = 0;
+}
+
+/* the file system is mounted, count the records left by a previous run */
+static bool pubq_file_ready(void)
+{
+    mqtt_pubq_hdr_t hdr;
+    FIL *fil;
+    uint32_t size;
+
+    if (fatfs_get_fs() == NULL) {
+        return false;
+    }
+    if (pubq.file_scanned) {
+        return true;
+    }
+    pubq.file_scanned = true;
+
+    fil = (FIL *)sys_malloc(sizeof(FIL));
+    if (fil == NULL) {
+        return true;
+    }
+    if (f_open(fil, MQTT_PUBQ_FILE, FA_READ) == FR_OK) {
+        size = f_size(fil);
+        /* a record cut by a reset ends the file */
+        while ((pubq.file_wr + PUBQ_HDR_LEN <= size) && (pubq_file_read(fil, &hdr, PUBQ_HDR_LEN) == 0) &&
+               (hdr.topic_len != 0) && (pubq.file_wr + PUBQ_REC_LEN(&hdr) <= size)) {
+            pubq.file_wr += PUBQ_REC_LEN(&hdr);
+            pubq.file_cnt++;
+            if (f_lseek(fil, pubq.file_wr) != FR_OK) {
+                break;
+            }
+        }
+        f_close(fil);
+    }
+    sys_mfree(fil);
+
+    if (pubq.file_cnt == 0) {
+        pubq_file_reset();
+    } else {
+        pubq.stats.peak_depth = pubq.ram_cnt + pubq.file_cnt;
+    }
+    return true;
+}
+
+static int pubq_file_push(const mqtt_pubq_hdr_t *hdr, const char *topic, const uint8_t *payload)
+{
+    static const uint8_t pad[4] = {0};
+    uint32_t len = PUBQ_REC_LEN(hdr);
+    FIL *fil;
+    int res = -1;
+
+    if (pubq.file_wr + len > MQTT_PUBQ_FILE_MAX) {
+        return -1;
+    }
+    fil = (FIL *)sys_malloc(sizeof(FIL));
+    if (fil == NULL) {
+        return -1;
+    }
+    if (f_open(fil, MQTT_PUBQ_FILE, FA_WRITE | FA_OPEN_ALWAYS) == FR_OK) {
+        if ((f_lseek(fil, pubq.file_wr) == FR_OK) &&
+            (pubq_file_write(fil, hdr, PUBQ_HDR_LEN) == 0) &&
+            (pubq_file_write(fil, topic, hdr->topic_len) == 0) &&
+            (pubq_file_write(fil, payload, hdr->payload_len) == 0) &&
+            (pubq_file_write(fil, pad, len - PUBQ_HDR_LEN - hdr->topic_len - hdr->payload_len) == 0)) {
+            res = 0;
+        }
+        if (f_close(fil) != FR_OK) {
+            res = -1;
+        }
+    }
+    sys_mfree(fil);
+
+    if (res == 0) {
+        pubq.file_wr += len;
+        pubq.file_cnt++;
+        pubq.stats.spill_cnt++;
+    }
+    return res;
+}
+
+/* move the oldest records of the file to the ring, the file is removed once all are moved */
+static void pubq_file_refill(void)
+{
+    mqtt_pubq_hdr_t hdr;
+    uint8_t *rec;
+    FIL *fil;
+    bool corrupt = false;
+
+    fil = (FIL *)sys_malloc(sizeof(FIL));
+    if (fil == NULL) {
+        return;
+    }
+    if (f_open(fil, MQTT_PUBQ_FILE, FA_READ) != FR_OK) {
+        sys_mfree(fil);
+        corrupt = true;
+    } else {
+        if (f_lseek(fil, pubq.file_rd) != FR_OK) {
+            corrupt = true;
+        }
+        while (!corrupt && (pubq.file_cnt > 0)) {
+            if ((pubq_file_read(fil, &hdr, PUBQ_HDR_LEN) != 0) || (hdr.topic_len == 0) ||
+                (PUBQ_REC_LEN(&hdr) > MQTT_PUBQ_RAM_SIZE)) {
+                corrupt = true;
+                break;
+            }
+            rec = pubq_ram_alloc(PUBQ_REC_LEN(&hdr));
+            if (rec == NULL) {
+                break;
+            }
+            memcpy(rec, &hdr, PUBQ_HDR_LEN);
+            if (pubq_file_read(fil, rec + PUBQ_HDR_LEN, PUBQ_REC_LEN(&hdr) - PUBQ_HDR_LEN) != 0) {
+                corrupt = true;
+                break;
+            }
+            pubq_ram_commit(PUBQ_REC_LEN(&hdr));
+            pubq.file_rd += PUBQ_REC_LEN(&hdr);
+            pubq.file_cnt--;
+        }
+        f_close(fil);
+        sys_mfree(fil);
+    }
+
+    if (corrupt) {
+        pubq.stats.drop_err_cnt += pubq.file_cnt;
+        pubq.file_cnt = 0;
+    }
+    if (pubq.file_cnt == 0) {
+        pubq_file_reset();
+    }
+}
+#endif /* CONFIG_FATFS_SUPPORT */
+
+static uint32_t pubq_depth(void)
+{
+#ifdef CONFIG_FATFS_SUPPORT
+    return pubq.ram_cnt + pubq.file_cnt;
+#else
+    return pubq.ram_cnt;
+#endif
+}
+
+/* filling of the queue, in percent */
+static uint32_t pubq_level(void)
+{
+#ifdef CONFIG_FATFS_SUPPORT
+    if (fatfs_get_fs() != NULL) {
+        return (pubq.used + pubq.file_wr - pubq.file_rd) * 100 / (MQTT_PUBQ_RAM_SIZE + MQTT_PUBQ_FILE_MAX);
+    }
+#endif
+    return pubq.used * 100 / MQTT_PUBQ_RAM_SIZE;
+}
+
+/* wake up a publish waiting for room, called with the lock held */
+static void pubq_room_signal(void)
+{
+    if ((pubq.waiters > 0) && (pubq_level() < MQTT_PUBQ_HIGH_WATER)) {
+        sys_sema_up(&pubq.room);
+    }
+}
+
+/*!
+    \brief      queue a publish, waiting for room while the queue is above its high water mark
+    \param[in]  topic: null terminated topic
+    \param[in]  payload: payload of the publish
+    \param[in]  payload_len: length of the payload
+    \param[in]  qos: quality of service, 0 to 2
+    \param[in]  retain: retain flag
+    \param[in]  draining: the client is connected and drains the queue, a publish may wait for room
+    \param[out] none
+    \retval     MQTT_PUBQ_OK, MQTT_PUBQ_ERR_FULL or MQTT_PUBQ_ERR_LEN
+*/
+int mqtt_pubq_push(const char *topic, const uint8_t *payload, uint32_t payload_len,
+                   uint8_t qos, uint8_t retain, bool draining)
+{
+    mqtt_pubq_hdr_t hdr;
+    uint32_t topic_len = strlen(topic) + 1, len, start, waited;
+    uint8_t *rec = NULL;
+    int res = MQTT_PUBQ_OK;
+    bool counted = false;
+
+    /* the whole publish must fit in the ring and in the MQTT output buffer */
+    if ((payload_len > 0xFFFF) || (topic_len + payload_len + 7 > MQTT_OUTPUT_RINGBUF_SIZE)) {
+        return MQTT_PUBQ_ERR_LEN;
+    }
+    hdr.topic_len = (uint16_t)topic_len;
+    hdr.payload_len = (uint16_t)payload_len;
+    hdr.qos = qos;
+    hdr.retain = retain;
+    hdr.rsvd = 0;
+    len = PUBQ_REC_LEN(&hdr);
+    if (len > MQTT_PUBQ_RAM_SIZE) {
+        return MQTT_PUBQ_ERR_LEN;
+    }
+
+    pubq_init();
+
+    sys_mutex_get(&pubq.lock);
+    /* back-pressure: let the connection catch up before taking more, the drain signals the room */
+    start = sys_current_time_get();
+    while (draining && (pubq_level() >= MQTT_PUBQ_HIGH_WATER)) {
+        waited = sys_current_time_get() - start;
+        if (waited >= MQTT_PUBQ_BP_TIMEOUT) {
+            break;
+        }
+        if (!counted) {
+            pubq.stats.wait_cnt++;
+            counted = true;
+        }
+        pubq.waiters++;
+        sys_mutex_put(&pubq.lock);
+        sys_sema_down(&pubq.room, MQTT_PUBQ_BP_TIMEOUT - waited);
+        sys_mutex_get(&pubq.lock);
+        pubq.waiters--;
+    }
+
+#ifdef CONFIG_FATFS_SUPPORT
+    /* keep the order: once publishes spilled, the new ones follow them in the file */
+    if (!pubq_file_ready() || (pubq.file_cnt == 0)) {
+        rec = pubq_ram_alloc(len);
+    }
+    if ((rec == NULL) && (!pubq_file_ready() || (pubq_file_push(&hdr, topic, payload) != 0))) {
+        res = MQTT_PUBQ_ERR_FULL;
+    }
+#else
+    rec = pubq_ram_alloc(len);
+    if (rec == NULL) {
+        res = MQTT_PUBQ_ERR_FULL;
+    }
+#endif
+    if (rec != NULL) {
+        memcpy(rec, &hdr, PUBQ_HDR_LEN);
+        memcpy(rec + PUBQ_HDR_LEN, topic, topic_len);
+        memcpy(rec + PUBQ_HDR_LEN + topic_len, payload, payload_len);
+        pubq_ram_commit(len);
+    }
+
+    if (res == MQTT_PUBQ_OK) {
+        pubq.stats.enqueue_cnt++;
+        if (pubq_depth() > pubq.stats.peak_depth) {
+            pubq.stats.peak_depth = pubq_depth();
+        }
+    } else {
+        pubq.stats.drop_full_cnt++;
+    }
+    /* the next waiting publish may fit as well */
+    pubq_room_signal();
+    sys_mutex_put(&pubq.lock);
+
+    return res;
+}
+
+/* publishes allowed by the drain rate, in thousandths */
+static void pubq_tokens_refill(uint32_t now)
+{
+    uint32_t max = pubq.rate * 1000;
+
+    if (pubq.rate == 0) {
+        return;
+    }
+    /* bursts of one second at most */
+    if ((now - pubq.token_ms) >= 1000) {
+        pubq.tokens = max;
+    } else {
+        pubq.tokens += (now - pubq.token_ms) * pubq.rate;
+    }
+    if (pubq.tokens > max) {
+        pubq.tokens = max;
+    }
+    pubq.token_ms = now;
+}
+
+/*!
+    \brief      hand the queued publishes to a connected client, in order and at the drain rate
+                Note: runs in the MQTT task, it takes the TCPIP core lock around the publishes.
+    \param[in]  client: connected MQTT client
+    \param[in]  publish: function publishing one message
+    \param[out] none
+    \retval     delay before the next call in ms, -1 if the queue is empty
+*/
+int mqtt_pubq_drain(mqtt_client_t *client, mqtt_pubq_publish_fn publish)
+{
+    mqtt_pubq_hdr_t *hdr = NULL;
+    mqtt_pubq_msg_t msg;
+    uint32_t now, batch = 0, elapsed;
+    int delay = -1;
+    err_t err;
+
+    if (!pubq.init) {
+        return -1;
+    }
+
+    sys_mutex_get(&pubq.lock);
+    now = sys_current_time_get();
+    pubq_tokens_refill(now);
+
+    while (delay < 0) {
+#ifdef CONFIG_FATFS_SUPPORT
+        /* file accesses stay out of the core lock */
+        if (pubq_file_ready() && (pubq.file_cnt > 0)) {
+            pubq_file_refill();
+        }
+#endif
+        hdr = pubq_ram_head();
+        if (hdr == NULL) {
+            break;
+        }
+
+        LOCK_TCPIP_CORE();
+        mqtt_output_hold(client, 1);
+        while ((hdr != NULL) && (delay < 0)) {
+            if ((pubq.rate != 0) && (pubq.tokens < 1000)) {
+                delay = (1000 - pubq.tokens + pubq.rate - 1) / pubq.rate;
+                break;
+            }
+            msg.topic = (const char *)hdr + PUBQ_HDR_LEN;
+            msg.payload = (const uint8_t *)hdr + PUBQ_HDR_LEN + hdr->topic_len;
+            msg.payload_len = hdr->payload_len;
+            msg.qos = hdr->qos;
+            msg.retain = hdr->retain;
+
+            err = publish(client, &msg, (pubq.retry + 1) >= MQTT_PUBQ_RETRY_MAX);
+            if ((err == ERR_MEM) && (batch > 0)) {
+                /* the held publishes fill the output buffer, send them and try again */
+                mqtt_output_hold(client, 0);
+                mqtt_output_hold(client, 1);
+                pubq.stats.batch_cnt++;
+                batch = 0;
+                err = publish(client, &msg, (pubq.retry + 1) >= MQTT_PUBQ_RETRY_MAX);
+            }
+            if (err == ERR_CONN) {
+                /* link lost, the reconnection drains the queue again */
+                break;
+            }
+            if ((err == ERR_MEM) && (++pubq.retry < MQTT_PUBQ_RETRY_MAX)) {
+                /* no room in the client until the in-flight publishes complete */
+                pubq.stats.retry_cnt++;
+                delay = MQTT_PUBQ_RETRY_MS;
+                break;
+            }
+            pubq.retry = 0;
+
+            if (err == ERR_OK) {
+                if (pubq.drain_cnt++ == 0) {
+                    pubq.drain_ms = now;
+                }
+                pubq.drain_bytes += hdr->payload_len;
+                pubq.stats.sent_cnt++;
+                pubq.stats.sent_bytes += hdr->payload_len;
+                batch += PUBQ_REC_LEN(hdr);
+            } else {
+                pubq.stats.drop_err_cnt++;
+            }
+            if (pubq.rate != 0) {
+                pubq.tokens -= 1000;
+            }
+            pubq_ram_pop(hdr);
+
+            if (batch >= MQTT_PUBQ_BATCH_SIZE) {
+                mqtt_output_hold(client, 0);
+                mqtt_output_hold(client, 1);
+                pubq.stats.batch_cnt++;
+                batch = 0;
+            }
+            hdr = pubq_ram_head();
+        }
+        mqtt_output_hold(client, 0);
+        UNLOCK_TCPIP_CORE();
+        if (batch > 0) {
+            pubq.stats.batch_cnt++;
+            batch = 0;
+        }
+        if (hdr != NULL) {
+            break;
+        }
+    }
+
+    if (pubq_depth() == 0) {
+        /* end of a drain, its throughput */
+        if (pubq.drain_cnt > 1) {
+            elapsed = sys_current_time_get() - pubq.drain_ms;
+            if (elapsed == 0) {
+                elapsed = 1;
+            }
+            pubq.stats.drain_bps = (uint32_t)((uint64_t)pubq.drain_bytes * 1000 / elapsed);
+            pubq.stats.drain_pps = (uint32_t)((uint64_t)pubq.drain_cnt * 1000 / elapsed);
+        }
+        pubq.drain_cnt = 0;
+        pubq.drain_bytes = 0;
+        delay = -1;
+    } else if ((delay < 0) && (hdr == NULL)) {
+        /* the rest is in the file but the ring is still full */
+        delay = MQTT_PUBQ_RETRY_MS;
+    }
+    pubq_room_signal();
+    sys_mutex_put(&pubq.lock);
+
+    return delay;
+}
+
+/*!
+    \brief      check if publishes are queued
+    \param[in]  none
+    \param[out] none
+    \retval     true if the queue is empty
+*/
+bool mqtt_pubq_is_empty(void)
+{
+    return (pubq_depth() == 0);
+}
+
+/*!
+    \brief      drop all the queued publishes, in RAM and in the spill file
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void mqtt_pubq_flush(void)
+{
+    pubq_init();
+    sys_mutex_get(&pubq.lock);
+    pubq.head = pubq.tail = pubq.used = pubq.ram_cnt = 0;
+#ifdef CONFIG_FATFS_SUPPORT
+    if (pubq_file_ready()) {
+        pubq_file_reset();
+    }
+#endif
+    pubq.retry = 0;
+    pubq.drain_cnt = 0;
+    pubq.drain_bytes = 0;
+    pubq_room_signal();
+    sys_mutex_put(&pubq.lock);
+}
+
+/*!
+    \brief      set the drain rate
+    \param[in]  rate: publishes per second, 0 for no limit
+    \param[out] none
+    \retval     none
+*/
+void mqtt_pubq_rate_set(uint32_t rate)
+{
+    pubq_init();
+    sys_mutex_get(&pubq.lock);
+    pubq.rate = rate;
+    pubq.tokens = 1000;
+    pubq.token_ms = sys_current_time_get();
+    sys_mutex_put(&pubq.lock);
+}
+
+/*!
+    \brief      get the queue statistics
+    \param[in]  reset: restart the counters after reading them
+    \param[out] stats: the statistics
+    \retval     none
+*/
+void mqtt_pubq_stats_get(mqtt_pubq_stats_t *stats, bool reset)
+{
+    pubq_init();
+    sys_mutex_get(&pubq.lock);
+    *stats = pubq.stats;
+    stats->depth = pubq_depth();
+    stats->ram_bytes = pubq.used;
+#ifdef CONFIG_FATFS_SUPPORT
+    stats->file_bytes = pubq.file_wr - pubq.file_rd;
+#else
+    stats->file_bytes = 0;
+#endif
+    stats->drain_rate = pubq.rate;
+    if (reset) {
+        memset(&pubq.stats, 0, sizeof(pubq.stats));
+        pubq.stats.peak_depth = pubq_depth();
+    }
+    sys_mutex_put(&pubq.lock);
+}
+#endif /* CONFIG_MQTT */
@@ -0,0 +1,162 @@
+/*!
+    \file    mqtt_pub_queue.h
+    \brief   Declaration for MQTT outbound publish queue.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+
+#ifndef _MQTT_PUB_QUEUE_H_
+#define _MQTT_PUB_QUEUE_H_
+
+#include "app_cfg.h"
+
+#ifdef CONFIG_MQTT
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/apps/mqtt.h"
+
+/* Size of the RAM ring holding the queued publishes, a publish must fit in it */
+#define MQTT_PUBQ_RAM_SIZE              4096
+#ifdef CONFIG_FATFS_SUPPORT
+/* Publishes which do not fit in RAM spill to this file, it is kept across resets */
+#define MQTT_PUBQ_FILE                  "mqtt_pubq.bin"
+/* Maximum size of the spill file */
+#define MQTT_PUBQ_FILE_MAX              (64 * 1024)
+#endif
+/* Above this filling, in percent, a publish waits for the queue to drain */
+#define MQTT_PUBQ_HIGH_WATER            75
+/* Longest wait of a publish for the queue to drain, in ms */
+#define MQTT_PUBQ_BP_TIMEOUT            2000
+/* Publishes held in the MQTT output buffer before one write to the connection, in bytes */
+#define MQTT_PUBQ_BATCH_SIZE            512
+/* Default drain rate in publishes per second, 0 for no limit */
+#define MQTT_PUBQ_DRAIN_RATE            0
+/* Delay before a new attempt when the MQTT client has no room, in ms */
+#define MQTT_PUBQ_RETRY_MS              20
+/* A publish the MQTT client keeps refusing for lack of room is dropped after this number of attempts */
+#define MQTT_PUBQ_RETRY_MAX             250
+
+/* mqtt_pubq_push results */
+#define MQTT_PUBQ_OK                    0
+#define MQTT_PUBQ_ERR_FULL              -3
+#define MQTT_PUBQ_ERR_LEN               -4
+
+/* a queued publish, the pointers stay valid until mqtt_pubq_drain returns */
+typedef struct {
+    const char *topic;              // null terminated
+    const uint8_t *payload;
+    uint16_t payload_len;
+    uint8_t qos;
+    uint8_t retain;
+} mqtt_pubq_msg_t;
+
+/* hand one publish to the MQTT client, returns the mqtt_msg_publish result,
+   last_try is set when the queue drops the publish on a failure */
+typedef err_t (*mqtt_pubq_publish_fn)(mqtt_client_t *client, const mqtt_pubq_msg_t *msg, bool last_try);
+
+/* queue statistics */
+typedef struct {
+    uint32_t depth;                 // publishes queued
+    uint32_t ram_bytes;             // RAM ring in use
+    uint32_t file_bytes;            // spill file in use
+    uint32_t peak_depth;            // highest depth
+    uint32_t enqueue_cnt;           // publishes accepted
+    uint32_t sent_cnt;              // publishes handed to the MQTT client
+    uint32_t sent_bytes;            // payload bytes handed to the MQTT client
+    uint32_t batch_cnt;             // writes of the MQTT output buffer
+    uint32_t spill_cnt;             // publishes written to the spill file
+    uint32_t wait_cnt;              // publishes which waited for the queue to drain
+    uint32_t retry_cnt;             // attempts refused by the client for lack of room
+    uint32_t drop_full_cnt;         // publishes rejected, queue full
+    uint32_t drop_err_cnt;          // publishes dropped, refused by the client
+    uint32_t drain_rate;            // configured drain rate, publishes per second
+    uint32_t drain_bps;             // payload throughput of the last drain, bytes per second
+    uint32_t drain_pps;             // publishes per second of the last drain
+} mqtt_pubq_stats_t;
+
+/*!
+    \brief      queue a publish, waiting for room while the queue is above its high water mark
+    \param[in]  topic: null terminated topic
+    \param[in]  payload: payload of the publish
+    \param[in]  payload_len: length of the payload
+    \param[in]  qos: quality of service, 0 to 2
+    \param[in]  retain: retain flag
+    \param[in]  draining: the client is connected and drains the queue, a publish may wait for room
+    \param[out] none
+    \retval     MQTT_PUBQ_OK, MQTT_PUBQ_ERR_FULL or MQTT_PUBQ_ERR_LEN
+*/
+int mqtt_pubq_push(const char *topic, const uint8_t *payload, uint32_t payload_len,
+                   uint8_t qos, uint8_t retain, bool draining);
+
+/*!
+    \brief      hand the queued publishes to a connected client, in order and at the drain rate
+                Note: runs in the MQTT task, it takes the TCPIP core lock around the publishes.
+    \param[in]  client: connected MQTT client
+    \param[in]  publish: function publishing one message
+    \param[out] none
+    \retval     delay before the next call in ms, -1 if the queue is empty
+*/
+int mqtt_pubq_drain(mqtt_client_t *client, mqtt_pubq_publish_fn publish);
+
+/*!
+    \brief      check if publishes are queued
+    \param[in]  none
+    \param[out] none
+    \retval     true if the queue is empty
+*/
+bool mqtt_pubq_is_empty(void);
+
+/*!
+    \brief      drop all the queued publishes, in RAM and in the spill file
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void mqtt_pubq_flush(void);
+
+/*!
+    \brief      set the drain rate
+    \param[in]  rate: publishes per second, 0 for no limit
+    \param[out] none
+    \retval     none
+*/
+void mqtt_pubq_rate_set(uint32_t rate);
+
+/*!
+    \brief      get the queue statistics
+    \param[in]  reset: restart the counters after reading them
+    \param[out] stats: the statistics
+    \retval     none
+*/
+void mqtt_pubq_stats_get(mqtt_pubq_stats_t *stats, bool reset);
+#endif /* CONFIG_MQTT */
+
+#endif /* _MQTT_PUB_QUEUE_H_ */
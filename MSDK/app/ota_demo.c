@@ -345,7 +345,7 @@ static int32_t http_rsp_image(int32_t sid, uint32_t running_idx)
             }
 
             while(offset + new_img_addr + recv_len > erase_start_addr) {
-                ret = raw_flash_erase(erase_start_addr, 0x1000);
+                ret = raw_flash_sliced_op(RAW_FLASH_OP_ERASE, erase_start_addr, NULL, 0x1000);
                 if (ret != 0) {
                     goto Exit;
                 } else {
@@ -353,7 +353,7 @@ static int32_t http_rsp_image(int32_t sid, uint32_t running_idx)
                 }
             }
             app_print("Write to 0x%x with len %d\r\n", offset + new_img_addr, recv_len);
-            ret = raw_flash_write((new_img_addr + offset), buf, recv_len);
+            ret = raw_flash_sliced_op(RAW_FLASH_OP_WRITE, (new_img_addr + offset), buf, recv_len);
             if (ret != 0) {
                 goto Exit;
             }
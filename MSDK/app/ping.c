@@ -47,6 +47,7 @@ OF SUCH DAMAGE.
 #include "lwip/netdb.h"
 #include "ping.h"
 #include "dbg_print.h"
+#include "systime.h"
 
 #ifdef CONFIG_ATCMD
 #include "cmd_shell.h"
@@ -55,6 +56,8 @@ OF SUCH DAMAGE.
 
 /** ping receive timeout - in milliseconds */
 #define PING_RCV_TIMEO  2000
+/** ping receive timeout in flood mode - in milliseconds */
+#define PING_FLOOD_RCV_TIMEO  200
 /** ping delay - in milliseconds */
 #define PING_DELAY      10 //100
 
@@ -77,9 +80,197 @@ struct _ip_addr {
 static uint8_t ping_terminate;
 static os_task_t ping_task_hdl = NULL;
 
-static uint32_t my_time_get()
+#define PING_US_FMT     "%u.%03u"
+#define PING_US_ARG(us) (unsigned int)((us) / 1000), (unsigned int)((us) % 1000)
+
+static uint64_t ping_time_us(void)
+{
+    return get_sys_local_time_us();
+}
+
+/* Sleep when the interval is one tick or more, sys_ms_sleep has tick granularity. Shorter
+   intervals spin on the clock with the scheduler running, yielding to the ready tasks of the
+   same priority */
+static void ping_wait_until(uint64_t t, uint32_t interval_us)
+{
+    uint64_t now = ping_time_us();
+
+    if (now >= t)
+        return;
+
+    if (interval_us >= 1000 * OS_MS_PER_TICK) {
+        sys_ms_sleep((t - now + 999) / 1000);
+        return;
+    }
+
+    while (ping_time_us() < t)
+        sys_yield();
+}
+
+static uint32_t ping_hist_index(uint32_t us)
+{
+    uint32_t msb;
+
+    if (us < (1 << PING_HIST_SUB_BITS))
+        return us;
+    if (us >= (1 << PING_HIST_MAX_BITS))
+        return PING_HIST_BUCKETS - 1;
+
+    msb = 31 - __builtin_clz(us);
+    return ((msb - PING_HIST_SUB_BITS + 1) << PING_HIST_SUB_BITS) +
+           ((us >> (msb - PING_HIST_SUB_BITS)) & ((1 << PING_HIST_SUB_BITS) - 1));
+}
+
+/* lowest value of a bucket, the bucket width is returned in width */
+static uint32_t ping_hist_low(uint32_t idx, uint32_t *width)
+{
+    uint32_t group = idx >> PING_HIST_SUB_BITS;
+    uint32_t sub = idx & ((1 << PING_HIST_SUB_BITS) - 1);
+
+    if (group == 0) {
+        *width = 1;
+        return sub;
+    }
+    *width = 1 << (group - 1);
+    return ((1 << PING_HIST_SUB_BITS) + sub) << (group - 1);
+}
+
+/*!
+    \brief      get a percentile of the round trip time
+    \param[in]  ping_info: ping information after ping() returned
+    \param[in]  pct: percentile, 1 to 100
+    \param[out] none
+    \retval     round trip time in us, middle of the histogram bucket, 0 if nothing received
+*/
+u32_t ping_percentile(struct ping_info_t *ping_info, u32_t pct)
+{
+    uint32_t rank, cum = 0, i, low, width, val;
+
+    if (ping_info->ping_recv_count == 0)
+        return 0;
+
+    rank = (ping_info->ping_recv_count * pct + 99) / 100;
+    if (rank == 0)
+        rank = 1;
+
+    for (i = 0; i < PING_HIST_BUCKETS; i++) {
+        cum += ping_info->ping_hist[i];
+        if (cum >= rank)
+            break;
+    }
+    /* the last bucket takes the rest, it has no upper bound */
+    if (i >= PING_HIST_BUCKETS - 1)
+        return ping_info->ping_max_delay;
+
+    low = ping_hist_low(i, &width);
+    val = low + width / 2;
+    if (val < ping_info->ping_min_delay)
+        val = ping_info->ping_min_delay;
+    if (val > ping_info->ping_max_delay)
+        val = ping_info->ping_max_delay;
+
+    return val;
+}
+
+/*!
+    \brief      parse an interval in milliseconds, with up to 3 decimals ("0.25" is 250us)
+    \param[in]  str: interval string
+    \param[out] interval_us: interval in us
+    \retval     0 on success, -1 on error
+*/
+int ping_interval_parse(const char *str, u32_t *interval_us)
 {
-    return (sys_os_now(false) * OS_MS_PER_TICK);
+    uint32_t ms = 0, frac = 0, digits = 0;
+
+    if (*str == '\0')
+        return -1;
+
+    while (*str >= '0' && *str <= '9') {
+        ms = ms * 10 + (*str++ - '0');
+        if (ms > 3600 * 1000)
+            return -1;
+    }
+    if (*str == '.') {
+        str++;
+        while (*str >= '0' && *str <= '9' && digits < 3) {
+            frac = frac * 10 + (*str++ - '0');
+            digits++;
+        }
+        /* below 1us */
+        while (*str >= '0' && *str <= '9')
+            str++;
+        while (digits++ < 3)
+            frac *= 10;
+    }
+    if (*str != '\0')
+        return -1;
+
+    *interval_us = ms * 1000 + frac;
+    return 0;
+}
+
+static void ping_stats_reply(struct ping_info_t *ping_info, uint32_t delay)
+{
+    uint32_t diff;
+
+    if (ping_info->ping_recv_count && (ping_info->ping_loss_run == 0)) {
+        /* jitter: mean delay variation between consecutive replies */
+        diff = delay > ping_info->ping_last_delay ? delay - ping_info->ping_last_delay :
+                                                    ping_info->ping_last_delay - delay;
+        ping_info->ping_jitter_total += diff;
+        ping_info->ping_jitter_cnt++;
+    }
+    if (ping_info->ping_loss_run) {
+        ping_info->ping_loss_bursts++;
+        if (ping_info->ping_loss_run > ping_info->ping_loss_burst_max)
+            ping_info->ping_loss_burst_max = ping_info->ping_loss_run;
+        ping_info->ping_loss_run = 0;
+    }
+
+    ping_info->ping_recv_count++;
+    ping_info->ping_last_delay = delay;
+    if (delay > ping_info->ping_max_delay) ping_info->ping_max_delay = delay;
+    if (delay < ping_info->ping_min_delay) ping_info->ping_min_delay = delay;
+    ping_info->ping_total_delay += delay;
+    ping_info->ping_hist[ping_hist_index(delay)]++;
+}
+
+static void ping_stats_print(struct ping_info_t *ping_info)
+{
+    uint32_t i, low, width;
+
+    app_print("[ping_test] %d packets transmitted, %d received, %d%% packet loss\n\r",
+        ping_info->ping_send_count, ping_info->ping_recv_count,
+        (ping_info->ping_send_count - ping_info->ping_recv_count) * 100 / ping_info->ping_send_count);
+
+    if (ping_info->ping_loss_bursts)
+        app_print("[ping_test] loss bursts %u, max burst %u, avg burst " PING_US_FMT "\n\r",
+            ping_info->ping_loss_bursts, ping_info->ping_loss_burst_max,
+            PING_US_ARG((ping_info->ping_send_count - ping_info->ping_recv_count) * 1000 /
+                        ping_info->ping_loss_bursts));
+
+    if (ping_info->ping_recv_count == 0)
+        return;
+
+    app_print("[ping_test] delay: min " PING_US_FMT " ms, max " PING_US_FMT " ms, avg " PING_US_FMT " ms\n\r",
+        PING_US_ARG(ping_info->ping_min_delay), PING_US_ARG(ping_info->ping_max_delay),
+        PING_US_ARG((uint32_t)(ping_info->ping_total_delay / ping_info->ping_recv_count)));
+    app_print("[ping_test] p50 " PING_US_FMT " ms, p90 " PING_US_FMT " ms, p99 " PING_US_FMT " ms, jitter " PING_US_FMT " ms\n\r",
+        PING_US_ARG(ping_percentile(ping_info, 50)), PING_US_ARG(ping_percentile(ping_info, 90)),
+        PING_US_ARG(ping_percentile(ping_info, 99)),
+        PING_US_ARG(ping_info->ping_jitter_cnt ?
+                    (uint32_t)(ping_info->ping_jitter_total / ping_info->ping_jitter_cnt) : 0));
+
+    if (!ping_info->ping_hist_show)
+        return;
+
+    for (i = 0; i < PING_HIST_BUCKETS; i++) {
+        if (ping_info->ping_hist[i] == 0)
+            continue;
+        low = ping_hist_low(i, &width);
+        app_print("[ping_test] " PING_US_FMT " - " PING_US_FMT " ms: %u\n\r",
+            PING_US_ARG(low), PING_US_ARG(low + width), ping_info->ping_hist[i]);
+    }
 }
 
 /** Prepare a echo ICMP request */
@@ -140,6 +331,8 @@ static err_t ping_send(struct ping_info_t *ping_info, int s, ip_addr_t *addr, si
     ping_prepare_echo(ping_info, (u16_t)ping_size);
 
     iecho = (struct icmp_echo_hdr *)ping_info->send_buf;
+    /* the send path through the stack is part of the round trip */
+    ping_info->ping_time = ping_time_us();
 
 #if LWIP_IPV6
     if (ping_info->ip_type == IPADDR_TYPE_V6) {
@@ -164,9 +357,9 @@ static err_t ping_send(struct ping_info_t *ping_info, int s, ip_addr_t *addr, si
     return (err ? ERR_OK : ERR_VAL);
 }
 
-static void ping_recv(struct ping_info_t *ping_info, int s)
+static void ping_recv(struct ping_info_t *ping_info, int s, uint32_t rcv_timeo)
 {
-    uint32_t reply_time;
+    uint64_t reply_time;
     int len;
     struct sockaddr *from;
     struct sockaddr_in from_ip4;
@@ -181,7 +374,7 @@ static void ping_recv(struct ping_info_t *ping_info, int s)
     uint32_t delay;
     //struct _ip_addr *addr;
     //static uint32_t ping_recv_count = 0;
-    uint32_t start_time = 0;
+    uint64_t start_time = 0;
     uint32_t recv_size;
 
 #if LWIP_IPV6
@@ -203,15 +396,15 @@ static void ping_recv(struct ping_info_t *ping_info, int s)
         recv_size = (ping_info->ping_size + sizeof(struct icmp_echo_hdr) + ip_hdr_len);
     else
         recv_size = BUF_SIZE;
-    start_time = my_time_get();
+    start_time = ping_time_us();
 
     while ((len = lwip_recvfrom(s, ping_info->reply_buf, recv_size, 0, from, (socklen_t*)&fromlen)) > 0) {
         if (len >= (ip_hdr_len + sizeof(struct icmp_echo_hdr))) {
             //addr = (struct _ip_addr *)&(from.sin_addr);
             //app_print("@@@ping: recv %d.%d.%d.%d, len = %d, count = %d\n",
             //             addr->addr0, addr->addr1, addr->addr2, addr->addr3, len, ++ping_recv_count));
-            reply_time = my_time_get();
-            delay = reply_time - ping_info->ping_time;
+            reply_time = ping_time_us();
+            delay = (uint32_t)(reply_time - ping_info->ping_time);
 
 #if LWIP_IPV6
             if (ping_info->ip_type == IPADDR_TYPE_V6) {
@@ -225,30 +418,27 @@ static void ping_recv(struct ping_info_t *ping_info, int s)
 
             if ((iecho->id == PING_ID) && (iecho->seqno == htons(ping_info->ping_seq_num))) {
 #ifdef CONFIG_ATCMD
-                //if (cmd_mode_type_get() == CMD_MODE_TYPE_AT)
-                ping_info->ping_res_len += co_snprintf((ping_info->ping_res + ping_info->ping_res_len),
-                                                        (sizeof(ping_info->ping_res) - ping_info->ping_res_len),
-                                                        "+%d\r\n", delay);
-                //else
+                if (ping_info->at_rsp_send && !ping_info->ping_flood) {
+                    char line[16];
+                    int line_len = co_snprintf(line, sizeof(line), "+%u\r\n", delay / 1000);
+                    ping_info->at_rsp_send(line, line_len);
+                }
 #endif
-                {
+                if (!ping_info->ping_flood) {
 #if LWIP_IPV6
                     if (ping_info->ip_type == IPADDR_TYPE_V6) {
-                        app_print("[ping_test] %d bytes from %s: icmp_seq=%d time=%d ms\n\r",
+                        app_print("[ping_test] %d bytes from %s: icmp_seq=%d time=" PING_US_FMT " ms\n\r",
                             len - sizeof(struct ip6_hdr) - sizeof(struct icmp_echo_hdr), inet6_ntoa(from_ip6->sin6_addr),
-                            htons(iecho->seqno), delay);
+                            htons(iecho->seqno), PING_US_ARG(delay));
                     } else
 #endif
                     {
-                        app_print("[ping_test] %d bytes from %s: icmp_seq=%d time=%d ms\n\r",
+                        app_print("[ping_test] %d bytes from %s: icmp_seq=%d time=" PING_US_FMT " ms\n\r",
                             len - sizeof(struct ip_hdr) - sizeof(struct icmp_echo_hdr), inet_ntoa(from_ip4.sin_addr),
-                            htons(iecho->seqno), delay);
+                            htons(iecho->seqno), PING_US_ARG(delay));
                     }
                 }
-                ping_info->ping_recv_count++;
-                if (delay > ping_info->ping_max_delay) ping_info->ping_max_delay = delay;
-                if (delay < ping_info->ping_min_delay) ping_info->ping_min_delay = delay;
-                ping_info->ping_avg_delay += delay;
+                ping_stats_reply(ping_info, delay);
                 if (ping_info->send_buf != NULL) {
                     sys_mfree(ping_info->send_buf);
                     ping_info->send_buf = NULL;
@@ -256,8 +446,7 @@ static void ping_recv(struct ping_info_t *ping_info, int s)
 
                 return;
             } else {
-                if (my_time_get() - start_time > PING_RCV_TIMEO) {
-                    // app_print("my_time_get() %d\n\r", my_time_get());
+                if (ping_time_us() - start_time > rcv_timeo * 1000) {
 
                     len = -1;
                     break;
@@ -282,14 +471,13 @@ static void ping_recv(struct ping_info_t *ping_info, int s)
     }
 
     if (len <= 0) {
+        ping_info->ping_loss_run++;
 #ifdef CONFIG_ATCMD
-    //if (cmd_mode_type_get() == CMD_MODE_TYPE_AT)
-    ping_info->ping_res_len += co_snprintf((ping_info->ping_res + ping_info->ping_res_len),
-                                            (sizeof(ping_info->ping_res) - ping_info->ping_res_len),
-                                            "+timeout\r\n");
-    //else
+        if (ping_info->at_rsp_send && !ping_info->ping_flood)
+            ping_info->at_rsp_send("+timeout\r\n", 10);
 #endif
-        app_print("[ping_test] timeout\n\r");
+        if (!ping_info->ping_flood)
+            app_print("[ping_test] timeout\n\r");
         if (ping_info->send_buf != NULL) {
             sys_mfree(ping_info->send_buf);
             ping_info->send_buf = NULL;
@@ -301,13 +489,18 @@ static void ping_recv(struct ping_info_t *ping_info, int s)
 err_t ping(struct ping_info_t *ping_info)
 {
     int s;
-    int timeout = PING_RCV_TIMEO;
+    uint32_t rcv_timeo = ping_info->ping_flood ? PING_FLOOD_RCV_TIMEO : PING_RCV_TIMEO;
+#if LWIP_SO_SNDRCVTIMEO_NONSTANDARD
+    int timeout = rcv_timeo;
+#else
+    struct timeval timeout = {rcv_timeo / 1000, (rcv_timeo % 1000) * 1000};
+#endif
     ip_addr_t ping_target;
-    uint32_t send_count;
     char *target = ping_info->ping_ip;
     uint32_t count = ping_info->ping_cnt;
     size_t size = ping_info->ping_size;
-    uint32_t interval = ping_info->ping_interval;
+    uint32_t interval = ping_info->ping_flood ? 0 : ping_info->ping_interval_us;
+    uint64_t next_send;
     //static uint32_t ping_send_count = 0;
     //uint16_t size_random; //add for random size ping test
     uint32_t recv_size;
@@ -315,10 +508,16 @@ err_t ping(struct ping_info_t *ping_info)
 
     ping_info->ping_seq_num = 0;
     ping_info->ping_max_delay = 0;
-    ping_info->ping_min_delay = (u16_t)-1;
-    ping_info->ping_avg_delay = 0;
+    ping_info->ping_min_delay = (u32_t)-1;
+    ping_info->ping_total_delay = 0;
+    ping_info->ping_send_count = 0;
     ping_info->ping_recv_count = 0;
-    send_count = 0;
+    ping_info->ping_jitter_total = 0;
+    ping_info->ping_jitter_cnt = 0;
+    ping_info->ping_loss_run = 0;
+    ping_info->ping_loss_bursts = 0;
+    ping_info->ping_loss_burst_max = 0;
+    memset(ping_info->ping_hist, 0, sizeof(ping_info->ping_hist));
 
 #if LWIP_IPV6
     ping_target.type = 0;
@@ -376,6 +575,8 @@ err_t ping(struct ping_info_t *ping_info)
             app_print("[ping_test] PING %s %d bytes of data\n\r",
                 inet_ntoa(ping_target), size);
     }
+    /* requests are sent on a fixed schedule, or right after the reply if it came late */
+    next_send = ping_time_us();
     while (1) {
         //add for random size ping test
         //size_random = 32 + rand()%(1460-32+1);
@@ -387,33 +588,36 @@ err_t ping(struct ping_info_t *ping_info)
         if (ping_send(ping_info, s, &ping_target, size) == ERR_OK) {
             //app_print("@@@ping: send %d.%d.%d.%d, size = %d, count = %d\n",
             //            addr->addr0, addr->addr1, addr->addr2, addr->addr3, size, ++ping_send_count);
-            ping_info->ping_time = my_time_get();
-            ping_recv(ping_info, s);
+            ping_recv(ping_info, s, rcv_timeo);
 
         } else {
+            ping_info->ping_loss_run++;
             if (ping_info->send_buf) {
                 sys_mfree(ping_info->send_buf);
                 ping_info->send_buf = NULL;
             }
         }
 
-        send_count ++;
-        if (send_count >= count) break; /* send ping times reached, stop */
+        ping_info->ping_send_count++;
+        if (ping_info->ping_send_count >= count) break; /* send ping times reached, stop */
+
+        next_send += interval;
+        if (next_send < ping_info->ping_time)
+            next_send = ping_info->ping_time;
+        ping_wait_until(next_send, interval); /* take a delay */
+    }
 
-        sys_ms_sleep(interval); /* take a delay */
+    /* a loss burst still running at the end */
+    if (ping_info->ping_loss_run) {
+        ping_info->ping_loss_bursts++;
+        if (ping_info->ping_loss_run > ping_info->ping_loss_burst_max)
+            ping_info->ping_loss_burst_max = ping_info->ping_loss_run;
     }
 #ifdef CONFIG_ATCMD
     //if (cmd_mode_type_get() != CMD_MODE_TYPE_AT)
 #endif
-    {
-        app_print("[ping_test] %d packets transmitted, %d received, %d%% packet loss\n\r",
-            send_count, ping_info->ping_recv_count, (send_count-ping_info->ping_recv_count) * 100 / send_count);
-
-        if (ping_info->ping_recv_count != 0) {
-            app_print("[ping_test] delay: min %u ms, max %u ms, avg %u ms\n\r",
-                ping_info->ping_min_delay, ping_info->ping_max_delay, ping_info->ping_avg_delay / ping_info->ping_recv_count);
-        }
-    }
+    if (ping_info->ping_send_count)
+        ping_stats_print(ping_info);
     lwip_close(s);
 
     sys_mfree(ping_info->reply_buf);
@@ -481,7 +685,7 @@ static int ping_parse_arguments(struct ping_info_t *ping_info, int argc, char **
 
     ping_info->ping_cnt = 5;
     ping_info->ping_size = 120;
-    ping_info->ping_interval = 10;
+    ping_info->ping_interval_us = 10 * 1000;
 
     while (arg_cnt < argc) {
         if (strcmp(argv[arg_cnt], "-n") == 0) {
@@ -517,20 +721,27 @@ static int ping_parse_arguments(struct ping_info_t *ping_info, int argc, char **
         } else if (strcmp(argv[arg_cnt], "-i") == 0) {
             if (argc <= (arg_cnt + 1))
                 goto Exit;
-            ping_info->ping_interval = (uint32_t)atoi(argv[arg_cnt + 1]);
+            if (ping_interval_parse(argv[arg_cnt + 1], &ping_info->ping_interval_us))
+                goto Exit;
             arg_cnt += 2;
         } else if (strcmp(argv[arg_cnt], "-t") == 0) {
             if (argc <= (arg_cnt + 1))
                 goto Exit;
             ping_time = (uint32_t)atoi(argv[arg_cnt + 1]);
             if (ping_time > 0) {
-                ping_info->ping_interval = 1000;
+                ping_info->ping_interval_us = 1000 * 1000;
                 ping_info->ping_cnt = ping_time;
             } else {
                 app_print("invalid run time \r\n");
                 goto Usage;
             }
             arg_cnt += 2;
+        } else if (strcmp(argv[arg_cnt], "-f") == 0) {
+            ping_info->ping_flood = 1;
+            arg_cnt++;
+        } else if (strcmp(argv[arg_cnt], "-h") == 0) {
+            ping_info->ping_hist_show = 1;
+            arg_cnt++;
         }
         else {
             goto Exit;
@@ -542,13 +753,15 @@ Exit:
     app_print("\rping: ping test command format error!\r\n");
 Usage:
     app_print("\rUsage:\r\n");
-    app_print("ping <target_ip | stop> [-n count] [-l size] [-i interval] [-t total time]\r\n");
+    app_print("ping <target_ip | stop> [-n count] [-l size] [-i interval] [-t total time] [-f] [-h]\r\n");
     app_print("    target_ip <ipv4_addr> or <-6 ipv6_addr>(if IPV6 support)\r\n");
     app_print("    stop ping stop\r\n");
     app_print("    -n   number of echo request to run(default 5)\r\n");
     app_print("    -l   ping size of single ping test(default 120B)\r\n");
-    app_print("    -i   time interval between single echo request(unit:ms) (default 10ms)\r\n");
+    app_print("    -i   time interval between single echo request(unit:ms, 0.001 resolution) (default 10ms)\r\n");
     app_print("    -t   total run time(unit:second) (default not use)\r\n");
+    app_print("    -f   flood, send the next request as soon as the reply is received\r\n");
+    app_print("    -h   print the round trip time histogram\r\n");
     app_print("Note: when -t option is enabled, time interval's default value is 1000ms,"\
                 "and ping test number equals to time\r\n");
     return 0;
@@ -41,6 +41,12 @@ OF SUCH DAMAGE.
 #define PING_TASK_STACK_SIZE                   512
 #define PING_TASK_PRIO                         OS_TASK_PRIORITY(1)
 
+/* Log-linear RTT histogram: 2^PING_HIST_SUB_BITS buckets per power of 2 (6% precision),
+   up to 2^PING_HIST_MAX_BITS us */
+#define PING_HIST_SUB_BITS                     4
+#define PING_HIST_MAX_BITS                     22
+#define PING_HIST_BUCKETS                      ((PING_HIST_MAX_BITS - PING_HIST_SUB_BITS + 1) << PING_HIST_SUB_BITS)
+
 struct ping_info_t {
     /* ping parameters */
 #if LWIP_IPV6
@@ -51,24 +57,35 @@ struct ping_info_t {
 #endif
     u32_t ping_cnt;
     size_t ping_size;
-    u32_t ping_interval;
+    u32_t ping_interval_us;
+    u8_t ping_flood;        /* send as soon as the reply is received, no per-packet output */
+    u8_t ping_hist_show;    /* print the histogram buckets */
 
-    /* ping variables */
+    /* ping variables, delays in us */
     u16_t ping_seq_num;
-    u16_t ping_max_delay;
-    u16_t ping_min_delay;
-    u32_t ping_avg_delay;
-    u32_t ping_time;
+    u32_t ping_max_delay;
+    u32_t ping_min_delay;
+    u64_t ping_total_delay;
+    u64_t ping_time;
+    u32_t ping_send_count;
     u32_t ping_recv_count;
+    u32_t ping_last_delay;
+    u64_t ping_jitter_total;
+    u32_t ping_jitter_cnt;
+    u32_t ping_loss_run;
+    u32_t ping_loss_bursts;
+    u32_t ping_loss_burst_max;
+    u32_t ping_hist[PING_HIST_BUCKETS];
     u8_t *reply_buf;
     u8_t *send_buf; /* will not be released until recv echo reply or timeout*/
 #ifdef CONFIG_ATCMD
-    char ping_res[512];
-    u32_t ping_res_len;
+    void (*at_rsp_send)(char *data, int size);  /* AT+PING: sends each reply line as it arrives */
 #endif
 };
 
 err_t ping(struct ping_info_t *ping_info);
+u32_t ping_percentile(struct ping_info_t *ping_info, u32_t pct);
+int ping_interval_parse(const char *str, u32_t *interval_us);
 void cmd_ping(int argc, char **argv);
 
 #endif /* _PING_H_ */
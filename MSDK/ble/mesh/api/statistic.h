@@ -24,6 +24,34 @@
 extern "C" {
 #endif
 
+/** Advertising scheduler classes reported in @ref bt_mesh_statistic. */
+enum bt_mesh_stat_adv_class {
+	/** Locally originated and provisioning frames. */
+	BT_MESH_STAT_ADV_LOCAL,
+	/** Frames relayed from the advertising or proxy bearer. */
+	BT_MESH_STAT_ADV_RELAY,
+	/** Frames sent from the Friend queue. */
+	BT_MESH_STAT_ADV_FRIEND,
+
+	BT_MESH_STAT_ADV_CLASS_NUM,
+};
+
+/** Advertising queue telemetry of one scheduler class. */
+struct bt_mesh_stat_adv_queue {
+	/** Frames currently waiting in the queue. */
+	uint16_t depth;
+	/** Highest number of frames seen waiting in the queue. */
+	uint16_t depth_max;
+	/** Frames taken from the queue for transmission. */
+	uint32_t sent;
+	/** Frames dropped from the queue because it was full or they were stale. */
+	uint32_t dropped;
+	/** Sum of the time spent in the queue by sent frames, in milliseconds. */
+	uint32_t wait_total_ms;
+	/** Longest time spent in the queue by a sent frame, in milliseconds. */
+	uint32_t wait_max_ms;
+};
+
 /** The structure that keeps statistics of mesh frames handling. */
 struct bt_mesh_statistic {
 	/** All received frames passed basic validation and decryption. */
@@ -47,6 +75,8 @@ struct bt_mesh_statistic {
 	uint32_t tx_friend_planned;
 	/** Counter of frames that succeeded to send over friend bearer. */
 	uint32_t tx_friend_succeeded;
+	/** Advertising queue telemetry, indexed by @ref bt_mesh_stat_adv_class. */
+	struct bt_mesh_stat_adv_queue adv_queue[BT_MESH_STAT_ADV_CLASS_NUM];
 };
 
 /** @brief Get mesh frame handling statistic.
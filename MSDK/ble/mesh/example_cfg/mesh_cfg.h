@@ -116,6 +116,20 @@
 /// can send simultaneously.
 #define CONFIG_BT_MESH_ADV_BUF_COUNT                                6   // range 1 ~ 256
 
+/// Relative share of advertising slots given to each class of the advertising
+/// scheduler when several classes have frames waiting. Locally originated
+/// messages (including provisioning), friend queue traffic and relayed
+/// messages are queued separately and served by weighted round robin,
+/// friend traffic first, then local, then relay.
+#define CONFIG_BT_MESH_ADV_LOCAL_WEIGHT                             4   // range 1 ~ 255
+#define CONFIG_BT_MESH_ADV_FRIEND_WEIGHT                            2   // range 1 ~ 255
+#define CONFIG_BT_MESH_ADV_RELAY_WEIGHT                             2   // range 1 ~ 255
+
+/// Relayed messages that waited longer than this in the advertising queue
+/// are dropped from the head of the queue instead of being sent late, in
+/// milliseconds. Set to 0 to never drop stale relayed messages.
+#define CONFIG_BT_MESH_ADV_RELAY_STALE_TIMEOUT                      500 // range 0 ~ 10000
+
 /// This option forces the usage of the local identity address for
 /// all advertising. This can be a help for debugging (analyzing
 /// traces), however it should never be enabled for a production
@@ -9,15 +9,18 @@
 #include <string.h>
 
 #include "mesh_kernel.h"
+#include "mesh_util.h"
 #include "sys/byteorder.h"
 #include "bluetooth/bt_crypto.h"
 
+#include <tinycrypt/constants.h>
+#include <tinycrypt/aes.h>
+
 #include "bluetooth/bt_str.h"
 
 #define LOG_LEVEL CONFIG_BT_MEHS_AES_CCM_LOG_LEVEL
 #include "api/mesh_log.h"
 
-
 static inline void xor16(uint8_t *dst, const uint8_t *a, const uint8_t *b)
 {
 	dst[0] = a[0] ^ b[0];
@@ -38,172 +41,134 @@ static inline void xor16(uint8_t *dst, const uint8_t *a, const uint8_t *b)
 	dst[15] = a[15] ^ b[15];
 }
 
-/* b field is assumed to have the nonce already present in bytes 1-13 */
-static int ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, uint8_t aad_len,
-			    size_t mic_size, uint16_t msg_len, uint8_t b[16],
-			    uint8_t X0[16])
+/* Initialize the CBC-MAC state X with B_0 and the encoded additional data */
+static void ccm_mac_init(TCAesKeySched_t s, const uint8_t nonce[13],
+			 const uint8_t *aad, uint16_t aad_len, size_t mic_size,
+			 uint16_t msg_len, uint8_t X[16])
 {
-	int i, j, err;
+	uint8_t i;
 
 	/* X_0 = e(AppKey, flags || nonce || length) */
-	b[0] = (((mic_size - 2) / 2) << 3) | ((!!aad_len) << 6) | 0x01;
+	X[0] = (((mic_size - 2) / 2) << 3) | ((!!aad_len) << 6) | 0x01;
+	memcpy(&X[1], nonce, 13);
+	sys_put_be16(msg_len, &X[14]);
 
-	sys_put_be16(msg_len, b + 14);
+	tc_aes_encrypt(X, X, s);
 
-	err = bt_encrypt_be(key, b, X0);
-	if (err) {
-		return err;
+	if (!aad_len) {
+		return;
 	}
 
-	/* If AAD is being used to authenticate, include it here */
-	if (aad_len) {
-		sys_put_be16(aad_len, b);
-
-		for (i = 0; i < sizeof(uint16_t); i++) {
-			b[i] = X0[i] ^ b[i];
-		}
+	/* The AAD is prefixed with its 16-bit length and zero padded */
+	X[0] ^= aad_len >> 8;
+	X[1] ^= aad_len & 0xff;
+	i = 2;
 
-		j = 0;
-		aad_len += sizeof(uint16_t);
-		while (aad_len > 16) {
-			do {
-				b[i] = X0[i] ^ aad[j];
-				i++, j++;
-			} while (i < 16);
+	while (aad_len) {
+		X[i++] ^= *aad++;
+		aad_len--;
 
-			aad_len -= 16;
+		if (i == 16 || !aad_len) {
+			tc_aes_encrypt(X, X, s);
 			i = 0;
-
-			err = bt_encrypt_be(key, b, X0);
-			if (err) {
-				return err;
-			}
-		}
-
-		for (; i < aad_len; i++, j++) {
-			b[i] = X0[i] ^ aad[j];
-		}
-
-		for (i = aad_len; i < 16; i++) {
-			b[i] = X0[i];
-		}
-
-		err = bt_encrypt_be(key, b, X0);
-		if (err) {
-			return err;
 		}
 	}
-
-	return 0;
 }
 
-static int ccm_auth(const uint8_t key[16], uint8_t nonce[13],
-		    const uint8_t *cleartext_msg, uint16_t msg_len, const uint8_t *aad,
-		    size_t aad_len, uint8_t *mic, size_t mic_size)
+/* Single pass CTR + CBC-MAC. The payload is authenticated as cleartext,
+ * which is the input when encrypting and the output when decrypting.
+ * Input and output may overlap completely.
+ */
+static void ccm_process(TCAesKeySched_t s, const uint8_t nonce[13],
+			const uint8_t *in, uint8_t *out, uint16_t msg_len,
+			const uint8_t *aad, uint16_t aad_len, uint8_t *mic,
+			size_t mic_size, bool decrypt)
 {
-	uint8_t b[16], Xn[16], s0[16];
-	uint16_t blk_cnt, last_blk;
-	int err, j, i;
-
-	last_blk = msg_len % 16;
-	blk_cnt = (msg_len + 15) / 16;
-	if (!last_blk) {
-		last_blk = 16U;
-	}
+	uint8_t a_i[16], s_i[16], X[16];
+	uint16_t blk_len, j;
+	size_t i;
 
-	b[0] = 0x01;
-	memcpy(b + 1, nonce, 13);
+	ccm_mac_init(s, nonce, aad, aad_len, mic_size, msg_len, X);
 
-	/* S[0] = e(AppKey, 0x01 || nonce || 0x0000) */
-	sys_put_be16(0x0000, &b[14]);
+	a_i[0] = 0x01;
+	memcpy(&a_i[1], nonce, 13);
 
-	err = bt_encrypt_be(key, b, s0);
-	if (err) {
-		return err;
-	}
+	for (j = 1; msg_len; j++) {
+		/* S_j = e(AppKey, 0x01 || nonce || j) */
+		sys_put_be16(j, &a_i[14]);
+		tc_aes_encrypt(s_i, a_i, s);
 
-	ccm_calculate_X0(key, aad, aad_len, mic_size, msg_len, b, Xn);
+		blk_len = MIN(msg_len, 16);
 
-	for (j = 0; j < blk_cnt; j++) {
-		/* X_1 = e(AppKey, X_0 ^ Payload[0-15]) */
-		if (j + 1 == blk_cnt) {
-			for (i = 0; i < last_blk; i++) {
-				b[i] = Xn[i] ^ cleartext_msg[(j * 16) + i];
+		if (blk_len == 16) {
+			if (decrypt) {
+				xor16(out, in, s_i);
+				xor16(X, X, out);
+			} else {
+				xor16(X, X, in);
+				xor16(out, in, s_i);
 			}
-
-			memcpy(&b[i], &Xn[i], 16 - i);
 		} else {
-			xor16(b, Xn, &cleartext_msg[j * 16]);
-		}
+			for (i = 0; i < blk_len; i++) {
+				uint8_t c = in[i];
 
-		err = bt_encrypt_be(key, b, Xn);
-		if (err) {
-			return err;
+				out[i] = c ^ s_i[i];
+				X[i] ^= decrypt ? out[i] : c;
+			}
 		}
+
+		/* X_j+1 = e(AppKey, X_j ^ Payload[j]) */
+		tc_aes_encrypt(X, X, s);
+
+		in += blk_len;
+		out += blk_len;
+		msg_len -= blk_len;
 	}
 
-	/* MIC = C_mic ^ X_1 */
+	/* MIC = S_0 ^ X_n, with S_0 = e(AppKey, 0x01 || nonce || 0x0000) */
+	sys_put_be16(0x0000, &a_i[14]);
+	tc_aes_encrypt(s_i, a_i, s);
+
 	for (i = 0; i < mic_size; i++) {
-		mic[i] = s0[i] ^ Xn[i];
+		mic[i] = s_i[i] ^ X[i];
 	}
-
-	return 0;
 }
 
-static int ccm_crypt(const uint8_t key[16], const uint8_t nonce[13],
-		     const uint8_t *in_msg, uint8_t *out_msg, uint16_t msg_len)
+static bool ccm_mic_equal(const uint8_t *a, const uint8_t *b, size_t len)
 {
-	uint8_t a_i[16], s_i[16];
-	uint16_t last_blk, blk_cnt;
-	size_t i, j;
-	int err;
-
-	last_blk = msg_len % 16;
-	blk_cnt = (msg_len + 15) / 16;
-	if (!last_blk) {
-		last_blk = 16U;
-	}
+	uint8_t diff = 0;
 
-	a_i[0] = 0x01;
-	memcpy(&a_i[1], nonce, 13);
-
-	for (j = 0; j < blk_cnt; j++) {
-		/* S_1 = e(AppKey, 0x01 || nonce || 0x0001) */
-		sys_put_be16(j + 1, &a_i[14]);
+	while (len--) {
+		diff |= *a++ ^ *b++;
+	}
 
-		err = bt_encrypt_be(key, a_i, s_i);
-		if (err) {
-			return err;
-		}
+	return !diff;
+}
 
-		/* Encrypted = Payload[0-15] ^ C_1 */
-		if (j < blk_cnt - 1) {
-			xor16(&out_msg[j * 16], s_i, &in_msg[j * 16]);
-		} else {
-			for (i = 0; i < last_blk; i++) {
-				out_msg[(j * 16) + i] =
-					in_msg[(j * 16) + i] ^ s_i[i];
-			}
-		}
-	}
-	return 0;
+static bool ccm_params_valid(size_t len, size_t aad_len, size_t mic_size)
+{
+	return aad_len < 0xff00 && mic_size <= 16 && len <= UINT16_MAX;
 }
 
 int bt_ccm_decrypt(const uint8_t key[16], uint8_t nonce[13],
 		   const uint8_t *enc_data, size_t len, const uint8_t *aad,
 		   size_t aad_len, uint8_t *plaintext, size_t mic_size)
 {
+	struct tc_aes_key_sched_struct s;
 	uint8_t mic[16];
 
-	if (aad_len >= 0xff00 || mic_size > sizeof(mic) || len > UINT16_MAX) {
+	if (!ccm_params_valid(len, aad_len, mic_size)) {
 		return -EINVAL;
 	}
 
-	ccm_crypt(key, nonce, enc_data, plaintext, len);
+	if (tc_aes128_set_encrypt_key(&s, key) == TC_CRYPTO_FAIL) {
+		return -EINVAL;
+	}
 
-	ccm_auth(key, nonce, plaintext, len, aad, aad_len, mic, mic_size);
+	ccm_process(&s, nonce, enc_data, plaintext, len, aad, aad_len, mic,
+		    mic_size, true);
 
-	if (memcmp(mic, enc_data + len, mic_size)) {
+	if (!ccm_mic_equal(mic, enc_data + len, mic_size)) {
 		return -EBADMSG;
 	}
 
@@ -214,6 +179,7 @@ int bt_ccm_encrypt(const uint8_t key[16], uint8_t nonce[13],
 		   const uint8_t *plaintext, size_t len, const uint8_t *aad,
 		   size_t aad_len, uint8_t *enc_data, size_t mic_size)
 {
+	struct tc_aes_key_sched_struct s;
 	uint8_t *mic = enc_data + len;
 
 	LOG_DBG("key %s", bt_hex(key, 16));
@@ -222,13 +188,16 @@ int bt_ccm_encrypt(const uint8_t key[16], uint8_t nonce[13],
 	LOG_DBG("aad_len %zu mic_size %zu", aad_len, mic_size);
 
 	/* Unsupported AAD size */
-	if (aad_len >= 0xff00 || mic_size > 16 || len > UINT16_MAX) {
+	if (!ccm_params_valid(len, aad_len, mic_size)) {
 		return -EINVAL;
 	}
 
-	ccm_auth(key, nonce, plaintext, len, aad, aad_len, mic, mic_size);
+	if (tc_aes128_set_encrypt_key(&s, key) == TC_CRYPTO_FAIL) {
+		return -EINVAL;
+	}
 
-	ccm_crypt(key, nonce, plaintext, enc_data, len);
+	ccm_process(&s, nonce, plaintext, enc_data, len, aad, aad_len, mic,
+		    mic_size, false);
 
 	return 0;
 }
@@ -34,6 +34,10 @@
 
 #define MESH_FIFI_QUEUE_SIZE      50
 
+/* delayed work of at least MESH_WORK_SLACK_MIN_MS may expire up to 1/32 of its delay late */
+#define MESH_WORK_SLACK_MIN_MS    1000
+#define MESH_WORK_SLACK_SHIFT     5
+
 typedef struct mesh_kernel_msg
 {
     uint16_t      id;
@@ -311,6 +315,13 @@ static void work_timeout(void *p_tmr, void *p_arg)
     }
 }
 
+static void work_timer_start(struct k_work_delayable *dwork, uint32_t delay_ms)
+{
+    // beacons, heartbeats and polls share the wakeups of the other timers
+    sys_timer_slack_set(&dwork->timer, (delay_ms >= MESH_WORK_SLACK_MIN_MS) ? (delay_ms >> MESH_WORK_SLACK_SHIFT) : 0);
+    sys_timer_start_ext(&dwork->timer, delay_ms, false);
+}
+
 void k_work_init_delayable(struct k_work_delayable *dwork, k_work_handler_t handler)
 {
     dwork->work.handler = handler;
@@ -357,7 +368,7 @@ int k_work_schedule(struct k_work_delayable *dwork, k_timeout_t delay)
             }
         } else {
             flag_set(&dwork->work.flags, K_WORK_DELAYED_BIT);
-            sys_timer_start_ext(&dwork->timer, delay.ticks * MS_PER_TICKS, false);
+            work_timer_start(dwork, delay.ticks * MS_PER_TICKS);
         }
 
     }
@@ -392,7 +403,7 @@ int k_work_reschedule(struct k_work_delayable *dwork, k_timeout_t delay)
         }
     } else {
         flag_set(&dwork->work.flags, K_WORK_DELAYED_BIT);
-        sys_timer_start_ext(&dwork->timer, delay.ticks * MS_PER_TICKS, false);
+        work_timer_start(dwork, delay.ticks * MS_PER_TICKS);
     }
 
     sys_mutex_put(&mesh_kernel.mutex);
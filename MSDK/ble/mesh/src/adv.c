@@ -77,6 +77,56 @@ struct ble_mesh_adv_env {
 
 #define BLE_MESH_ADV_QUEUE_SIZE     16
 
+/* Message posted to the adv queue to signal that the scheduler has new frames */
+#define BLE_MESH_ADV_SCHED_KICK     ((void *)&adv_sched)
+
+#if (CONFIG_BT_MESH_RELAY)
+#define BLE_MESH_ADV_RELAY_QUEUE_LIMIT      CONFIG_BT_MESH_RELAY_BUF_COUNT
+#else
+#define BLE_MESH_ADV_RELAY_QUEUE_LIMIT      BLE_MESH_ADV_QUEUE_SIZE
+#endif
+
+#if (CONFIG_BT_MESH_ADV_LOCAL_WEIGHT < 1) || (CONFIG_BT_MESH_ADV_FRIEND_WEIGHT < 1) || \
+    (CONFIG_BT_MESH_ADV_RELAY_WEIGHT < 1)
+#error "BT mesh advertising scheduler weights must be at least 1"
+#endif
+
+/* Scheduler classes, same order as enum bt_mesh_stat_adv_class */
+enum ble_mesh_adv_class {
+    BLE_MESH_ADV_CLASS_LOCAL,
+    BLE_MESH_ADV_CLASS_RELAY,
+    BLE_MESH_ADV_CLASS_FRIEND,
+
+    BLE_MESH_ADV_CLASS_NUM,
+};
+
+struct ble_mesh_adv_sched_queue {
+    sys_slist_t         list;
+    uint16_t            depth;
+    uint8_t             weight;
+    uint8_t             credit;
+};
+
+struct ble_mesh_adv_sched {
+    struct ble_mesh_adv_sched_queue queue[BLE_MESH_ADV_CLASS_NUM];
+    bool                kick_pending;
+};
+
+/* Order in which classes with remaining credit are served */
+static const uint8_t ble_mesh_adv_class_order[BLE_MESH_ADV_CLASS_NUM] = {
+    BLE_MESH_ADV_CLASS_FRIEND,
+    BLE_MESH_ADV_CLASS_LOCAL,
+    BLE_MESH_ADV_CLASS_RELAY,
+};
+
+static struct ble_mesh_adv_sched adv_sched = {
+    .queue = {
+        [BLE_MESH_ADV_CLASS_LOCAL]  = { .weight = CONFIG_BT_MESH_ADV_LOCAL_WEIGHT },
+        [BLE_MESH_ADV_CLASS_RELAY]  = { .weight = CONFIG_BT_MESH_ADV_RELAY_WEIGHT },
+        [BLE_MESH_ADV_CLASS_FRIEND] = { .weight = CONFIG_BT_MESH_ADV_FRIEND_WEIGHT },
+    },
+};
+
 const uint8_t bt_mesh_adv_type[BT_MESH_ADV_TYPES] = {
     [BT_MESH_ADV_PROV]   = BLE_AD_TYPE_MESH_PROV,
     [BT_MESH_ADV_DATA]   = BLE_AD_TYPE_MESH_MESSAGE,
@@ -179,9 +229,182 @@ struct bt_mesh_adv *bt_mesh_adv_create(enum bt_mesh_adv_type type, enum bt_mesh_
     return adv;
 }
 
+static uint8_t ble_mesh_adv_class_get(struct bt_mesh_adv_ctx *ctx)
+{
+    switch (ctx->tag) {
+    case BT_MESH_ADV_TAG_RELAY:
+    case BT_MESH_ADV_TAG_PROXY:
+        return BLE_MESH_ADV_CLASS_RELAY;
+    case BT_MESH_ADV_TAG_FRIEND:
+        return BLE_MESH_ADV_CLASS_FRIEND;
+    default:
+        return BLE_MESH_ADV_CLASS_LOCAL;
+    }
+}
+
+/** @brief Release frames dropped by the scheduler, must not be called in a critical section.
+ */
+static void bt_mesh_adv_sched_release(sys_slist_t *dropped)
+{
+    sys_snode_t *node;
+    struct bt_mesh_adv *adv;
+
+    while ((node = sys_slist_get(dropped)) != NULL) {
+        adv = CONTAINER_OF(node, struct bt_mesh_adv, node);
+
+        LOG_DBG("drop tag %u queued %u ms", adv->ctx.tag, k_uptime_get_32() - adv->timestamp);
+
+        adv->ctx.busy = 0U;
+        bt_mesh_adv_send_start(0, -ENOBUFS, &adv->ctx);
+        bt_mesh_adv_unref(adv);
+    }
+}
+
+/** @brief Take the head frame of a class, called in a critical section.
+ */
+static struct bt_mesh_adv *bt_mesh_adv_sched_pop(uint8_t cls)
+{
+    struct ble_mesh_adv_sched_queue *queue = &adv_sched.queue[cls];
+    sys_snode_t *node = sys_slist_get(&queue->list);
+
+    if (node == NULL) {
+        return NULL;
+    }
+
+    queue->depth--;
+
+    return CONTAINER_OF(node, struct bt_mesh_adv, node);
+}
+
+/** @brief Allow the next queued frame to kick the adv thread again.
+ *
+ *  Cleared with the scheduler locked: a frame queued concurrently either
+ *  sees the kick still pending and is found by the next pick, or sends a
+ *  new kick.
+ */
+static void bt_mesh_adv_sched_kick_clear(void)
+{
+    sys_enter_critical();
+    adv_sched.kick_pending = false;
+    sys_exit_critical();
+}
+
+/** @brief Queue a frame in its class and wake up the adv thread if needed.
+ */
+static void bt_mesh_adv_sched_put(struct bt_mesh_adv *adv)
+{
+    struct ble_mesh_adv_msg msg = {
+        .arg = BLE_MESH_ADV_SCHED_KICK
+    };
+    uint8_t cls = ble_mesh_adv_class_get(&adv->ctx);
+    struct ble_mesh_adv_sched_queue *queue = &adv_sched.queue[cls];
+    struct bt_mesh_adv *old;
+    sys_slist_t dropped;
+    bool kick;
+
+    sys_slist_init(&dropped);
+    adv->timestamp = k_uptime_get_32();
+
+    sys_enter_critical();
+
+    /* Relay queue full: drop the oldest relayed frame rather than the newest */
+    if (cls == BLE_MESH_ADV_CLASS_RELAY && queue->depth >= BLE_MESH_ADV_RELAY_QUEUE_LIMIT) {
+        old = bt_mesh_adv_sched_pop(cls);
+        sys_slist_append(&dropped, &old->node);
+
+        if (IS_ENABLED(CONFIG_BT_MESH_STATISTIC)) {
+            bt_mesh_stat_adv_drop(cls, queue->depth);
+        }
+    }
+
+    sys_slist_append(&queue->list, &adv->node);
+    queue->depth++;
+
+    if (IS_ENABLED(CONFIG_BT_MESH_STATISTIC)) {
+        bt_mesh_stat_adv_enqueue(cls, queue->depth);
+    }
+
+    kick = !adv_sched.kick_pending;
+    adv_sched.kick_pending = true;
+
+    sys_exit_critical();
+
+    bt_mesh_adv_sched_release(&dropped);
+
+    if (kick && sys_queue_write(&bt_mesh_adv_queue, &msg, 0, false)) {
+        /* The adv thread is busy and will find the frame before it blocks */
+        bt_mesh_adv_sched_kick_clear();
+    }
+}
+
+/** @brief Pick the next frame to send by weighted round robin over the classes.
+ */
+static struct bt_mesh_adv *bt_mesh_adv_sched_get(void)
+{
+    struct ble_mesh_adv_sched_queue *queue;
+    struct bt_mesh_adv *adv = NULL;
+    sys_snode_t *node;
+    sys_slist_t dropped;
+    uint32_t now = k_uptime_get_32();
+    uint8_t cls = 0;
+    int i, round;
+
+    sys_slist_init(&dropped);
+
+    sys_enter_critical();
+
+    /* Head-of-line drop of relayed frames that are too old to be useful */
+    queue = &adv_sched.queue[BLE_MESH_ADV_CLASS_RELAY];
+    while (CONFIG_BT_MESH_ADV_RELAY_STALE_TIMEOUT &&
+           (node = sys_slist_peek_head(&queue->list)) != NULL) {
+        adv = CONTAINER_OF(node, struct bt_mesh_adv, node);
+        if (now - adv->timestamp <= CONFIG_BT_MESH_ADV_RELAY_STALE_TIMEOUT) {
+            break;
+        }
+
+        bt_mesh_adv_sched_pop(BLE_MESH_ADV_CLASS_RELAY);
+        sys_slist_append(&dropped, node);
+
+        if (IS_ENABLED(CONFIG_BT_MESH_STATISTIC)) {
+            bt_mesh_stat_adv_drop(BLE_MESH_ADV_CLASS_RELAY, queue->depth);
+        }
+    }
+
+    adv = NULL;
+
+    /* Serve the first non-empty class that still has credit, refill once all are spent */
+    for (round = 0; round < 2 && adv == NULL; round++) {
+        for (i = 0; i < BLE_MESH_ADV_CLASS_NUM; i++) {
+            cls = ble_mesh_adv_class_order[i];
+            queue = &adv_sched.queue[cls];
+
+            if (queue->credit && !sys_slist_is_empty(&queue->list)) {
+                queue->credit--;
+                adv = bt_mesh_adv_sched_pop(cls);
+                break;
+            }
+        }
+
+        if (adv == NULL) {
+            for (i = 0; i < BLE_MESH_ADV_CLASS_NUM; i++) {
+                adv_sched.queue[i].credit = adv_sched.queue[i].weight;
+            }
+        }
+    }
+
+    if (adv != NULL && IS_ENABLED(CONFIG_BT_MESH_STATISTIC)) {
+        bt_mesh_stat_adv_dequeue(cls, adv_sched.queue[cls].depth, now - adv->timestamp);
+    }
+
+    sys_exit_critical();
+
+    bt_mesh_adv_sched_release(&dropped);
+
+    return adv;
+}
+
 void bt_mesh_adv_send(struct bt_mesh_adv *adv, const struct bt_mesh_send_cb *cb, void *cb_data)
 {
-    struct ble_mesh_adv_msg msg;
     LOG_DUMP("send type 0x%02x len %u: %s", adv->ctx.type, adv->b.len, bt_hex(adv->b.data, adv->b.len));
 
     if (atomic_test_bit(bt_mesh.flags, BT_MESH_SUSPENDED)) {
@@ -196,9 +419,7 @@ void bt_mesh_adv_send(struct bt_mesh_adv *adv, const struct bt_mesh_send_cb *cb,
         bt_mesh_stat_planned_count(&adv->ctx);
     }
 
-    msg.arg = (void *)bt_mesh_adv_ref(adv);
-
-    sys_queue_write(&bt_mesh_adv_queue, &msg, 0, false);
+    bt_mesh_adv_sched_put(bt_mesh_adv_ref(adv));
 }
 
 /** @brief If supported proxy server or pb-gatt server, will send connectable advertising.
@@ -484,39 +705,42 @@ static int bt_mesh_adv_gatt_stop(void)
 static void bt_mesh_adv_thread(void *param)
 {
     struct ble_mesh_adv_msg msg = {0};
-    struct bt_mesh_adv **adv = (struct bt_mesh_adv **)&msg.arg;
+    struct bt_mesh_adv *adv;
     int timeout;
 
     ble_wait_ready();
 
     for (;;) {
-        *adv = NULL;
+        if (sys_queue_read(&bt_mesh_adv_queue, &msg, 0, false) == 0 &&
+            msg.arg == BLE_MESH_ADV_SCHED_KICK) {
+            bt_mesh_adv_sched_kick_clear();
+        }
 
-        sys_queue_read(&bt_mesh_adv_queue, &msg, 0, false);
-        while (!(*adv)) {
+        adv = bt_mesh_adv_sched_get();
+        while (adv == NULL) {
             timeout = bt_mesh_adv_gatt_send();
-            sys_queue_read(&bt_mesh_adv_queue, &msg, timeout, false);
+            if (sys_queue_read(&bt_mesh_adv_queue, &msg, timeout, false) == 0 &&
+                msg.arg == BLE_MESH_ADV_SCHED_KICK) {
+                bt_mesh_adv_sched_kick_clear();
+            }
             bt_mesh_adv_gatt_stop();
-        }
-
-        if (*adv == NULL) {
-            continue;
+            adv = bt_mesh_adv_sched_get();
         }
 
         if (!bt_adv_enabled) {
-            bt_mesh_adv_unref(*adv);
+            bt_mesh_adv_unref(adv);
             continue;
         }
 
         /* busy == 0 means this was canceled */
-        if (!(*adv)->ctx.busy) {
-            bt_mesh_adv_unref(*adv);
+        if (!adv->ctx.busy) {
+            bt_mesh_adv_unref(adv);
             continue;
         }
 
-        (*adv)->ctx.busy = 0U;
-        bt_adv_send(*adv);
-        bt_mesh_adv_unref(*adv);
+        adv->ctx.busy = 0U;
+        bt_adv_send(adv);
+        bt_mesh_adv_unref(adv);
     }
 }
 
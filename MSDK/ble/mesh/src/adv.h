@@ -83,6 +83,9 @@ struct bt_mesh_adv {
 
     struct net_buf_simple b;
 
+    /* Time the message was queued for sending, in ms */
+    uint32_t timestamp;
+
     uint8_t __ref;
 
     uint8_t __bufs[BT_MESH_ADV_DATA_SIZE];
@@ -21,7 +21,20 @@ void bt_mesh_stat_get(struct bt_mesh_statistic *st)
 
 void bt_mesh_stat_reset(void)
 {
+	uint16_t depth[BT_MESH_STAT_ADV_CLASS_NUM];
+	int i;
+
+	/* Queue depth is live state rather than a counter, keep it */
+	for (i = 0; i < BT_MESH_STAT_ADV_CLASS_NUM; i++) {
+		depth[i] = stat.adv_queue[i].depth;
+	}
+
 	memset(&stat, 0, sizeof(struct bt_mesh_statistic));
+
+	for (i = 0; i < BT_MESH_STAT_ADV_CLASS_NUM; i++) {
+		stat.adv_queue[i].depth = depth[i];
+		stat.adv_queue[i].depth_max = depth[i];
+	}
 }
 
 void bt_mesh_stat_planned_count(struct bt_mesh_adv_ctx *ctx)
@@ -65,4 +78,34 @@ void bt_mesh_stat_rx(enum bt_mesh_net_if net_if)
 	}
 }
 
+void bt_mesh_stat_adv_enqueue(uint8_t cls, uint16_t depth)
+{
+	struct bt_mesh_stat_adv_queue *q = &stat.adv_queue[cls];
+
+	q->depth = depth;
+	if (depth > q->depth_max) {
+		q->depth_max = depth;
+	}
+}
+
+void bt_mesh_stat_adv_dequeue(uint8_t cls, uint16_t depth, uint32_t wait_ms)
+{
+	struct bt_mesh_stat_adv_queue *q = &stat.adv_queue[cls];
+
+	q->depth = depth;
+	q->sent++;
+	q->wait_total_ms += wait_ms;
+	if (wait_ms > q->wait_max_ms) {
+		q->wait_max_ms = wait_ms;
+	}
+}
+
+void bt_mesh_stat_adv_drop(uint8_t cls, uint16_t depth)
+{
+	struct bt_mesh_stat_adv_queue *q = &stat.adv_queue[cls];
+
+	q->depth = depth;
+	q->dropped++;
+}
+
 #endif // CONFIG_BT_MESH_STATISTIC
\ No newline at end of file
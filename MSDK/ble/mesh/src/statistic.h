@@ -10,5 +10,8 @@
 void bt_mesh_stat_planned_count(struct bt_mesh_adv_ctx *ctx);
 void bt_mesh_stat_succeeded_count(struct bt_mesh_adv_ctx *ctx);
 void bt_mesh_stat_rx(enum bt_mesh_net_if net_if);
+void bt_mesh_stat_adv_enqueue(uint8_t cls, uint16_t depth);
+void bt_mesh_stat_adv_dequeue(uint8_t cls, uint16_t depth, uint32_t wait_ms);
+void bt_mesh_stat_adv_drop(uint8_t cls, uint16_t depth);
 
 #endif /* ZEPHYR_SUBSYS_BLUETOOTH_MESH_STATISTIC_H_ */
@@ -532,7 +532,7 @@ void app_mesh_dfu_cli_init(void)
 
     // Before DFU start, load image to image0 or image1 regision firstly
     for (i = 0; i < (size / READ_IMG_SIZE); i++) {
-        err = raw_flash_read(dfu_backup_img_offset + i * READ_IMG_SIZE, data, READ_IMG_SIZE);
+        err = raw_flash_sliced_op(RAW_FLASH_OP_READ, dfu_backup_img_offset + i * READ_IMG_SIZE, data, READ_IMG_SIZE);
         if (err < 0) {
             app_print("raw_flash_read fail\r\n");
         }
@@ -542,7 +542,7 @@ void app_mesh_dfu_cli_init(void)
     }
 
     if (left_size) {
-        err = raw_flash_read(dfu_backup_img_offset + size - left_size, data, left_size);
+        err = raw_flash_sliced_op(RAW_FLASH_OP_READ, dfu_backup_img_offset + size - left_size, data, left_size);
         if (err < 0) {
             app_print("raw_flash_read fail\r\n");
         }
@@ -15,6 +15,10 @@ extern "C" {
 #define CONFIG_BT_EXT_ADV_MAX_ADV_SET 4
 #define CONFIG_BT_MESH_RELAY_ADV_SETS 0
 #define CONFIG_BT_MESH_ADV_BUF_COUNT 6
+#define CONFIG_BT_MESH_ADV_LOCAL_WEIGHT 4
+#define CONFIG_BT_MESH_ADV_FRIEND_WEIGHT 2
+#define CONFIG_BT_MESH_ADV_RELAY_WEIGHT 2
+#define CONFIG_BT_MESH_ADV_RELAY_STALE_TIMEOUT 500
 #define CONFIG_BT_MESH_PB_ADV 1
 #define CONFIG_BT_MESH_UNPROV_BEACON_INT 5
 #define CONFIG_BT_MESH_PB_ADV_TRANS_PDU_RETRANSMIT_COUNT 0
@@ -131,7 +131,7 @@ static int app_dfu_srv_blob_io_open(const struct bt_mesh_blob_io *io,
         dfu_img_offset = RE_IMG_0_OFFSET;
     }
 
-    err = raw_flash_erase(dfu_img_offset, image_total_size);
+    err = raw_flash_sliced_op(RAW_FLASH_OP_ERASE, dfu_img_offset, NULL, image_total_size);
     if (err < 0) {
         app_print("app_dfu_srv_blob_io_open raw_flash_erase fail\r\n");
     }
@@ -167,14 +167,14 @@ static int app_dfu_srv_blob_chunk_wr(const struct bt_mesh_blob_io *io,
                                        (chunk->size - copy_image_size);
         app_print("chunk wr number: %u, chunk size: %u, copy_image_size %u, copy_checkdata_size %u\r\n",
                   block->number, chunk->size, copy_image_size, copy_checkdata_size);
-        ret = raw_flash_write(offset, chunk->data, copy_image_size);
+        ret = raw_flash_sliced_op(RAW_FLASH_OP_WRITE, offset, (void *)chunk->data, copy_image_size);
         if (ret < 0) {
             app_print("app_dfu_srv_blob_chunk_wr fail\r\n");
         }
 
         memcpy(checkdata, &chunk->data[copy_image_size], copy_checkdata_size);
     } else {
-        ret = raw_flash_write(offset, chunk->data, chunk->size);
+        ret = raw_flash_sliced_op(RAW_FLASH_OP_WRITE, offset, (void *)chunk->data, chunk->size);
         if (ret < 0) {
             app_print("app_dfu_srv_blob_chunk_wr fail\r\n");
         }
@@ -227,7 +227,7 @@ static void app_dfu_end(struct bt_mesh_dfu_srv *srv,
     mbedtls_sha256_starts(&sha256_context, 0);
 
     for (i = 0; i < (image_total_size / READ_IMG_SIZE); i++) {
-        err = raw_flash_read(dfu_img_offset + i * READ_IMG_SIZE, data, READ_IMG_SIZE);
+        err = raw_flash_sliced_op(RAW_FLASH_OP_READ, dfu_img_offset + i * READ_IMG_SIZE, data, READ_IMG_SIZE);
         if (err < 0) {
             app_print("raw_flash_read fail\r\n");
         }
@@ -236,7 +236,7 @@ static void app_dfu_end(struct bt_mesh_dfu_srv *srv,
     }
 
     if (left_size > 0) {
-        err = raw_flash_read(dfu_img_offset + image_total_size - left_size, data, left_size);
+        err = raw_flash_sliced_op(RAW_FLASH_OP_READ, dfu_img_offset + image_total_size - left_size, data, left_size);
         if (err < 0) {
             app_print("raw_flash_read fail\r\n");
         }
@@ -73,6 +73,9 @@
 #include <mbedtls/oid.h>
 #include <mbedtls/debug.h>
 #include <mbedtls/sha256.h>
+/* GD MODIFY */
+#include "tls_session.h"
+/* GD MODIFY */
 #if defined(ESPIDF_VERSION) && defined(CONFIG_MBEDTLS_DEBUG)
 #include <mbedtls/esp_debug.h>
 #endif /* ESPIDF_VERSION && CONFIG_MBEDTLS_DEBUG */
@@ -1298,6 +1301,14 @@ setup_client_ssl_session(coap_session_t *c_session,
                  -ret, get_error_string(ret));
     goto fail;
   }
+/* GD MODIFY */
+#if defined(CFG_TLS_SESSION_CACHE) && defined(TLS_SESSION_TLS13_TICKET)
+  /* report the TLS 1.3 tickets so that they can be kept for resumption */
+  if (c_session->proto != COAP_PROTO_DTLS)
+    mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets(&m_env->conf,
+        MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED);
+#endif /* CFG_TLS_SESSION_CACHE && TLS_SESSION_TLS13_TICKET */
+/* GD MODIFY */
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
   mbedtls_ssl_conf_handshake_timeout(&m_env->conf, COAP_DTLS_RETRANSMIT_MS,
@@ -1422,6 +1433,11 @@ coap_dtls_free_mbedtls_env(coap_mbedtls_env_t *m_env) {
   if (m_env) {
     if (!m_env->sent_alert)
       mbedtls_ssl_close_notify(&m_env->ssl);
+/* GD MODIFY */
+#ifdef CFG_TLS_SESSION_CACHE
+    tls_session_end(&m_env->ssl);
+#endif /* CFG_TLS_SESSION_CACHE */
+/* GD MODIFY */
     mbedtls_cleanup(m_env);
     mbedtls_free(m_env);
   }
@@ -1464,7 +1480,13 @@ do_mbedtls_handshake(coap_session_t *c_session,
   int ret;
   int alert;
 
+/* GD MODIFY */
+#ifdef CFG_TLS_SESSION_CACHE
+  ret = tls_session_handshake(&m_env->ssl);
+#else /* ! CFG_TLS_SESSION_CACHE */
   ret = mbedtls_ssl_handshake(&m_env->ssl);
+#endif /* ! CFG_TLS_SESSION_CACHE */
+/* GD MODIFY */
   switch (ret) {
   case 0:
     m_env->established = 1;
@@ -1846,6 +1868,18 @@ coap_dtls_new_mbedtls_env(coap_session_t *c_session,
                            mbedtls_timing_get_delay);
 
   mbedtls_ssl_conf_dbg(&m_env->conf, mbedtls_debug_out, stdout);
+/* GD MODIFY */
+#if defined(CFG_TLS_SESSION_CACHE) && COAP_CLIENT_SUPPORT
+  if (role == COAP_DTLS_ROLE_CLIENT) {
+    const coap_address_t *remote = coap_session_get_addr_remote(c_session);
+    char host[TLS_SESSION_HOST_LEN];
+
+    /* offer the session of a previous connection to the same server */
+    coap_print_ip_addr(remote, host, sizeof(host));
+    tls_session_begin(&m_env->ssl, host, coap_address_get_port(remote));
+  }
+#endif /* CFG_TLS_SESSION_CACHE && COAP_CLIENT_SUPPORT */
+/* GD MODIFY */
   return m_env;
 
 fail:
@@ -2725,6 +2759,12 @@ coap_tls_read(coap_session_t *c_session, uint8_t *data, size_t data_len) {
         break;
 #if MBEDTLS_VERSION_NUMBER >= 0x03060000
       case MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET:
+/* GD MODIFY */
+#if defined(CFG_TLS_SESSION_CACHE) && defined(TLS_SESSION_TLS13_TICKET)
+        tls_session_ticket(&m_env->ssl);
+#endif /* CFG_TLS_SESSION_CACHE && TLS_SESSION_TLS13_TICKET */
+/* GD MODIFY */
+        /* Fall through */
 #endif /* MBEDTLS_VERSION_NUMBER >= 0x03060000 */
       case MBEDTLS_ERR_SSL_WANT_READ:
         errno = EAGAIN;
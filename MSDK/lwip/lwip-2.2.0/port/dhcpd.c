@@ -43,6 +43,10 @@ OF SUCH DAMAGE.
 #include "dbg_print.h"
 #include "lwip/tcpip.h"
 #include "lwip/etharp.h"
+#include "app_cfg.h"
+#ifdef CONFIG_WIFI_STA_TABLE
+#include "wifi_sta_table.h"
+#endif
 
 #if LWIP_DHCPD
 
@@ -239,8 +243,20 @@ static struct dhcpOfferedAddr *DHCPD_FindLeaseByChaddr(uint8_t *chaddr)
 {
     unsigned int i;
 
+#if defined(CONFIG_WIFI_STA_TABLE) && defined(CFG_SOFTAP)
+    // lease index cached in the station table, the lease may have been reused since
+    int idx = wifi_sta_table_lease_get(chaddr);
+
+    if ((idx >= 0) && (idx < server_config.max_leases) && (memcmp(leases[idx].chaddr, chaddr, 6) == 0)) {
+        return &(leases[idx]);
+    }
+#endif
+
     for (i = 0; i < server_config.max_leases; i++) {
         if (memcmp(leases[i].chaddr, chaddr, 6) == 0) {
+#if defined(CONFIG_WIFI_STA_TABLE) && defined(CFG_SOFTAP)
+            wifi_sta_table_lease_set(chaddr, i);
+#endif
             return &(leases[i]);
         }
     }
@@ -381,6 +397,9 @@ static int discover(struct dhcpd *packetinfo)
         MEMCPY(leases[idx].chaddr,packetinfo->chaddr,6);
         leases[idx].yiaddr = addr;
         lease = &(leases[idx]);
+#if defined(CONFIG_WIFI_STA_TABLE) && defined(CFG_SOFTAP)
+        wifi_sta_table_lease_set(packetinfo->chaddr, idx);
+#endif
     }
 
     memset(&payload_out, 0, sizeof(struct dhcpd));
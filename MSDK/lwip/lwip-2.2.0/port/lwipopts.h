@@ -89,11 +89,17 @@ extern "C" {
 #define PBUF_LINK_ENCAPSULATION_HLEN  348
 
 #define IP_REASS_MAX_PBUFS            (MACIF_RX_BUF_CNT - 2)
+/* one sender can not hold more than half of the reassembly queue while others use it */
+#define IP_REASS_MAX_PBUFS_PER_SRC    (IP_REASS_MAX_PBUFS / 2)
+/* RX buffers the reassembly queue can pin, fragments are copied beyond that */
+#define IP_REASS_MAX_CUSTOM_PBUFS     ((MACIF_RX_BUF_CNT) / 4)
 
 #define MEMP_NUM_NETBUF               34
 #define MEMP_NUM_NETCONN              12 // 10 // 8
 
 #define MEMP_NUM_UDP_PCB              16
+/* drop broadcast/multicast to ports nobody is bound to before the pcb scan */
+#define UDP_PORT_HASH_SIZE            32
 #define MEMP_NUM_REASSDATA            LWIP_MIN((IP_REASS_MAX_PBUFS), 5)
 
 #define MEMP_NUM_TCP_PCB              6 //5//
@@ -142,7 +148,9 @@ extern "C" {
 
 #define TCP_WND                       (MAC_RXQ_DEPTH * TCP_MSS)
 #define TCP_QUEUE_OOSEQ               1
-#define TCP_OOSEQ_MAX_PBUFS           (MACIF_RX_BUF_CNT - 1)
+// With LWIP_SOCKET_RECV_PBUF_LENT_MAX buffers lent, one RX buffer stays free for the segment
+// that fills the hole, else the out-of-sequence queue and the lent chains can hold all of them
+#define TCP_OOSEQ_MAX_PBUFS           (MACIF_RX_BUF_CNT - LWIP_SOCKET_RECV_PBUF_LENT_MAX - 1)
 #define LWIP_TCP_SACK_OUT             1
 
 #define TCP_SND_BUF                   (MAC_TXQ_DEPTH * TCP_MSS)  // (4 * MAC_TXQ_DEPTH * TCP_MSS)
@@ -173,6 +181,7 @@ extern "C" {
 #define LWIP_DHCP_DOES_ACD_CHECK      0
 #define LWIP_DHCP                     1
 #define LWIP_DNS                      1
+#define LWIP_NETIF_EXT_STATUS_CALLBACK  1   // address changes are posted to the wifi management
 #define LWIP_IGMP                     1
 #define LWIP_SO_RCVTIMEO              1
 
@@ -181,12 +190,47 @@ extern "C" {
 #define LWIP_PING                     1
 #define LWIP_SO_SNDRCVTIMEO_NONSTANDARD     1
 
+// Borrowed-buffer socket receive (lwip_recv_pbuf), at most half of the MAC RX buffers may be lent
+#define LWIP_SOCKET_RECV_PBUF         1
+#define LWIP_SOCKET_RECV_PBUF_LENT_MAX  ((MACIF_RX_BUF_CNT) / 2)
+
 #define SO_REUSE                      1
 
+// Cyclic timers expire on multiples of their interval so that the tcpip thread wakes up once for
+// all the timers due at the same time, the first expiry after start may be up to one interval early
+#define LWIP_TIMERS_CYCLIC_ALIGN      1
+
 #define LWIP_GRATUITOUS_ARP           1
 
+#ifdef CONFIG_LWIP_MEM_TELEMETRY
+/* Only the memory statistics are kept, they feed the pool telemetry (mem_telemetry.c) */
+#define LWIP_STATS                    1
+#define LWIP_STATS_DISPLAY            1
+#define MEM_STATS                     1
+#define MEMP_STATS                    1
+#define SYS_STATS                     0
+#define LINK_STATS                    0
+#define ETHARP_STATS                  0
+#define IP_STATS                      0
+#define IPFRAG_STATS                  0
+#define ICMP_STATS                    0
+#define IGMP_STATS                    0
+#define UDP_STATS                     0
+#define TCP_STATS                     0
+#define IP6_STATS                     0
+#define ICMP6_STATS                   0
+#define IP6_FRAG_STATS                0
+#define MLD6_STATS                    0
+#define ND6_STATS                     0
+#define MIB2_STATS                    0
+void mem_tlm_memp_alloc(int type, void *mem, void *caller);
+void mem_tlm_heap_alloc(uint32_t size, void *mem, void *caller);
+#define LWIP_HOOK_MEMP_MALLOC(type, mem)    mem_tlm_memp_alloc((type), (mem), __builtin_return_address(0))
+#define LWIP_HOOK_MEM_MALLOC(size, mem)     mem_tlm_heap_alloc((size), (mem), __builtin_return_address(0))
+#else
 #define LWIP_STATS                    0
 #define LWIP_STATS_DISPLAY            0
+#endif
 
 #ifdef CONFIG_AZURE_IOT_SUPPORT
 #define LWIP_SO_SNDTIMEO              1
@@ -215,8 +259,14 @@ uint32_t sntp_get_update_intv(void);
 #define SNTP_UPDATE_DELAY             (sntp_get_update_intv())
 #define LWIP_DHCP_MAX_NTP_SERVERS     4
 #define SYS_TIMER_BUF_FOR_SNTP        1
-void sntp_set_system_time(uint32_t sec);
-#define SNTP_SET_SYSTEM_TIME( sec )   sntp_set_system_time( sec )
+#define SNTP_CHECK_RESPONSE           2
+#define SNTP_COMP_ROUNDTRIP           1
+void sntp_set_system_time_ntp(int32_t sec, uint32_t frac);
+void sntp_get_system_time_ntp(int32_t *sec, uint32_t *frac);
+void sntp_set_roundtrip_delay(int64_t delay);
+#define SNTP_SET_SYSTEM_TIME_NTP(sec, frac)   sntp_set_system_time_ntp((sec), (frac))
+#define SNTP_GET_SYSTEM_TIME_NTP(sec, frac)   sntp_get_system_time_ntp(&(sec), &(frac))
+#define SNTP_SET_ROUNDTRIP_DELAY(delay)       sntp_set_roundtrip_delay(delay)
 #endif
 
 #ifdef CONFIG_ATCMD
@@ -308,8 +358,11 @@ void sntp_set_system_time(uint32_t sec);
 
 /**
  * Maximum number of pending subscribe, unsubscribe and publish requests to server .
+ * QoS 0 publishes hold one until their write is acknowledged, it bounds the publishes
+ * coalesced in one write by the publish queue (mqtt_pub_queue.c): with 4, a burst of 40 small
+ * publishes takes 10 writes instead of 5. Each request is 24 bytes of the MQTT client.
  */
-#define MQTT_REQ_MAX_IN_FLIGHT 4
+#define MQTT_REQ_MAX_IN_FLIGHT 16
 
 /**
  * Seconds between each cyclic timer call.
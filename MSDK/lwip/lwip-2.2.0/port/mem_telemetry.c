@@ -0,0 +1,371 @@
+/*!
+    \file    mem_telemetry.c
+    \brief   lwIP memory pool telemetry: interval peaks, allocation failures and trace dump.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * INCLUDE FILES
+ ****************************************************************************************
+ */
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/priv/memp_priv.h"
+
+#include "app_cfg.h"
+#include "wrapper_os.h"
+#include "dbg_print.h"
+#include "mem_telemetry.h"
+
+#ifdef CONFIG_LWIP_MEM_TELEMETRY
+
+#if !LWIP_STATS || !MEMP_STATS || !MEM_STATS || !LWIP_STATS_DISPLAY
+#error "CONFIG_LWIP_MEM_TELEMETRY needs LWIP_STATS, MEMP_STATS, MEM_STATS and LWIP_STATS_DISPLAY"
+#endif
+
+struct mem_tlm {
+    os_timer_t timer;
+    uint32_t intv_ms;
+    /* Peaks of the running interval, updated on every allocation */
+    uint32_t heap_peak;
+    uint16_t peak[MEMP_MAX];
+    /* Time series */
+    uint8_t sample_idx;
+    uint8_t sample_num;
+    struct mem_tlm_sample sample[MEM_TLM_SAMPLE_NUM];
+    /* Failure log */
+    uint32_t fail_cnt;
+    struct mem_tlm_fail fail[MEM_TLM_FAIL_NUM];
+};
+
+static struct mem_tlm mem_tlm;
+
+/*!
+    \brief      record an allocation failure
+    \param[in]  pool: memp_t or MEM_TLM_HEAP
+    \param[in]  size: requested size, heap only
+    \param[in]  caller: return address into the caller of the allocator
+    \param[out] none
+    \retval     none
+*/
+static void mem_tlm_fail_add(uint16_t pool, uint32_t size, void *caller)
+{
+    struct mem_tlm_fail *fail;
+
+    sys_enter_critical();
+    fail = &mem_tlm.fail[mem_tlm.fail_cnt % MEM_TLM_FAIL_NUM];
+    mem_tlm.fail_cnt++;
+    sys_exit_critical();
+
+    fail->time_ms = sys_current_time_get();
+    fail->caller = caller;
+    fail->task = sys_current_task_handle_get();
+    fail->pool = pool;
+    fail->size = (size > 0xffff) ? 0xffff : (uint16_t)size;
+}
+
+/*!
+    \brief      lwIP hook called by memp_malloc
+    \param[in]  type: pool the element was taken from
+    \param[in]  mem: allocated element, NULL on failure
+    \param[in]  caller: return address into the caller of memp_malloc
+    \param[out] none
+    \retval     none
+*/
+void mem_tlm_memp_alloc(int type, void *mem, void *caller)
+{
+    uint16_t used;
+
+    if (mem == NULL) {
+        mem_tlm_fail_add((uint16_t)type, 0, caller);
+        return;
+    }
+
+    /* pools are used from several tasks, keep the compare and the store together */
+    sys_enter_critical();
+    used = lwip_stats.memp[type]->used;
+    if (used > mem_tlm.peak[type]) {
+        mem_tlm.peak[type] = used;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      lwIP hook called by mem_malloc
+    \param[in]  size: requested size
+    \param[in]  mem: allocated memory, NULL on failure
+    \param[in]  caller: return address into the caller of mem_malloc
+    \param[out] none
+    \retval     none
+*/
+void mem_tlm_heap_alloc(uint32_t size, void *mem, void *caller)
+{
+    uint32_t used;
+
+    if (mem == NULL) {
+        mem_tlm_fail_add(MEM_TLM_HEAP, size, caller);
+        return;
+    }
+
+    sys_enter_critical();
+    used = lwip_stats.mem.used;
+    if (used > mem_tlm.heap_peak) {
+        mem_tlm.heap_peak = used;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      sampling timer, closes the running interval
+    \param[in]  p_tmr: pointer to the timer
+    \param[in]  p_arg: not used
+    \param[out] none
+    \retval     none
+*/
+static void mem_tlm_timer_cb(void *p_tmr, void *p_arg)
+{
+    struct mem_tlm_sample *sample;
+    int i;
+
+    sys_enter_critical();
+    sample = &mem_tlm.sample[mem_tlm.sample_idx];
+    sample->time_ms = sys_current_time_get();
+    for (i = 0; i < MEMP_MAX; i++) {
+        sample->peak[i] = mem_tlm.peak[i];
+        mem_tlm.peak[i] = lwip_stats.memp[i]->used;
+    }
+    sample->heap_peak = mem_tlm.heap_peak;
+    mem_tlm.heap_peak = lwip_stats.mem.used;
+
+    mem_tlm.sample_idx = (mem_tlm.sample_idx + 1) % MEM_TLM_SAMPLE_NUM;
+    if (mem_tlm.sample_num < MEM_TLM_SAMPLE_NUM) {
+        mem_tlm.sample_num++;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      start sampling the pools
+    \param[in]  intv_ms: sampling interval in milliseconds, 0 for the default
+    \param[out] none
+    \retval     0 on success, -1 on error
+*/
+int mem_tlm_start(uint32_t intv_ms)
+{
+    if (intv_ms == 0) {
+        intv_ms = MEM_TLM_INTV_MS_DEFAULT;
+    }
+    if (intv_ms < MEM_TLM_INTV_MS_MIN) {
+        return -1;
+    }
+
+    mem_tlm_stop();
+    mem_tlm.intv_ms = intv_ms;
+    sys_timer_init(&mem_tlm.timer, (const uint8_t *)"mem_tlm", intv_ms, 1, mem_tlm_timer_cb, NULL);
+    if (mem_tlm.timer == NULL) {
+        return -1;
+    }
+    // a late sample does not matter, share the wakeups of the other timers
+    sys_timer_slack_set(&mem_tlm.timer, intv_ms / 8);
+    sys_timer_start(&mem_tlm.timer, 0);
+
+    return 0;
+}
+
+/*!
+    \brief      stop sampling the pools, the collected samples are kept
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void mem_tlm_stop(void)
+{
+    if (mem_tlm.timer) {
+        sys_timer_delete(&mem_tlm.timer);
+        mem_tlm.timer = NULL;
+    }
+}
+
+/*!
+    \brief      clear the samples, the failure log and the lwIP high water marks
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void mem_tlm_reset(void)
+{
+    int i;
+
+    sys_enter_critical();
+    for (i = 0; i < MEMP_MAX; i++) {
+        lwip_stats.memp[i]->max = lwip_stats.memp[i]->used;
+        lwip_stats.memp[i]->err = 0;
+        mem_tlm.peak[i] = lwip_stats.memp[i]->used;
+    }
+    lwip_stats.mem.max = lwip_stats.mem.used;
+    lwip_stats.mem.err = 0;
+    mem_tlm.heap_peak = lwip_stats.mem.used;
+    mem_tlm.sample_idx = 0;
+    mem_tlm.sample_num = 0;
+    mem_tlm.fail_cnt = 0;
+    sys_exit_critical();
+}
+
+/*!
+    \brief      name of a pool index
+    \param[in]  pool: memp_t or MEM_TLM_HEAP
+    \param[out] none
+    \retval     name of the pool
+*/
+static const char *mem_tlm_pool_name(uint16_t pool)
+{
+    if (pool >= MEMP_MAX) {
+        return "HEAP";
+    }
+    return lwip_stats.memp[pool]->name;
+}
+
+/*!
+    \brief      print the failure log
+    \param[in]  prefix: prefix of every line
+    \param[out] none
+    \retval     none
+*/
+static void mem_tlm_fail_print(const char *prefix)
+{
+    struct mem_tlm_fail *fail;
+    uint32_t i, start, num;
+    char *task;
+
+    num = (mem_tlm.fail_cnt < MEM_TLM_FAIL_NUM) ? mem_tlm.fail_cnt : MEM_TLM_FAIL_NUM;
+    start = mem_tlm.fail_cnt - num;
+    for (i = start; i < start + num; i++) {
+        fail = &mem_tlm.fail[i % MEM_TLM_FAIL_NUM];
+        task = fail->task ? sys_task_name_get(fail->task) : NULL;
+        app_print("%s%u,%s,%u,%p,%s\r\n", prefix, fail->time_ms, mem_tlm_pool_name(fail->pool),
+                  fail->size, fail->caller, task ? task : "-");
+    }
+}
+
+/*!
+    \brief      print the pools with their high water marks and the failure log
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void mem_tlm_report(void)
+{
+    struct stats_mem *st;
+    uint32_t peak, j;
+    int i;
+
+    app_print("%-16s %5s %5s %5s %5s %5s %6s\r\n", "pool", "size", "avail", "used", "max", "err", "recent");
+    for (i = 0; i < MEMP_MAX; i++) {
+        st = lwip_stats.memp[i];
+        /* Highest interval peak in the time series */
+        peak = mem_tlm.peak[i];
+        for (j = 0; j < mem_tlm.sample_num; j++) {
+            if (mem_tlm.sample[j].peak[i] > peak) {
+                peak = mem_tlm.sample[j].peak[i];
+            }
+        }
+        app_print("%-16s %5u %5u %5u %5u %5u %6u\r\n", st->name, memp_pools[i]->size,
+                  (uint32_t)st->avail, (uint32_t)st->used, (uint32_t)st->max, (uint32_t)st->err, peak);
+    }
+    st = &lwip_stats.mem;
+    peak = mem_tlm.heap_peak;
+    for (j = 0; j < mem_tlm.sample_num; j++) {
+        if (mem_tlm.sample[j].heap_peak > peak) {
+            peak = mem_tlm.sample[j].heap_peak;
+        }
+    }
+    app_print("%-16s %5s %5u %5u %5u %5u %6u\r\n", "HEAP", "-", (uint32_t)st->avail,
+              (uint32_t)st->used, (uint32_t)st->max, (uint32_t)st->err, peak);
+
+    app_print("allocation failures: %u%s\r\n", mem_tlm.fail_cnt,
+              mem_tlm.fail_cnt ? " (time,pool,size,caller,task)" : "");
+    mem_tlm_fail_print("  ");
+}
+
+/*!
+    \brief      dump configuration, pools, time series and failures for the host sizing tool
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void mem_tlm_trace_dump(void)
+{
+    struct mem_tlm_sample *sample;
+    struct stats_mem *st;
+    uint32_t i, start;
+    int j;
+
+    app_print("MEMTLM,V,1,%u\r\n", mem_tlm.intv_ms);
+    app_print("MEMTLM,CFG,TCP_MSS,%u\r\n", TCP_MSS);
+    app_print("MEMTLM,CFG,TCP_WND,%u\r\n", TCP_WND);
+    app_print("MEMTLM,CFG,TCP_SND_BUF,%u\r\n", TCP_SND_BUF);
+    app_print("MEMTLM,CFG,TCP_SND_QUEUELEN,%u\r\n", TCP_SND_QUEUELEN);
+    app_print("MEMTLM,CFG,MEMP_NUM_TCP_SEG,%u\r\n", MEMP_NUM_TCP_SEG);
+    app_print("MEMTLM,CFG,MEMP_NUM_PBUF,%u\r\n", MEMP_NUM_PBUF);
+    app_print("MEMTLM,CFG,MEMP_NUM_NETBUF,%u\r\n", MEMP_NUM_NETBUF);
+    app_print("MEMTLM,CFG,MEMP_NUM_NETCONN,%u\r\n", MEMP_NUM_NETCONN);
+    app_print("MEMTLM,CFG,MEMP_NUM_TCP_PCB,%u\r\n", MEMP_NUM_TCP_PCB);
+    app_print("MEMTLM,CFG,MEMP_NUM_UDP_PCB,%u\r\n", MEMP_NUM_UDP_PCB);
+    app_print("MEMTLM,CFG,MEM_SIZE,%u\r\n", MEM_SIZE);
+    app_print("MEMTLM,CFG,MEM_MIN_TCP,%u\r\n", MEM_MIN_TCP);
+    app_print("MEMTLM,CFG,MAC_TXQ_DEPTH,%u\r\n", MAC_TXQ_DEPTH);
+    app_print("MEMTLM,CFG,MAC_RXQ_DEPTH,%u\r\n", MAC_RXQ_DEPTH);
+    app_print("MEMTLM,CFG,PBUF_LINK_ENCAPSULATION_HLEN,%u\r\n", PBUF_LINK_ENCAPSULATION_HLEN);
+
+    for (j = 0; j < MEMP_MAX; j++) {
+        st = lwip_stats.memp[j];
+        app_print("MEMTLM,POOL,%d,%s,%u,%u,%u,%u\r\n", j, st->name, memp_pools[j]->size,
+                  (uint32_t)st->avail, (uint32_t)st->max, (uint32_t)st->err);
+    }
+    st = &lwip_stats.mem;
+    app_print("MEMTLM,HEAP,%u,%u,%u\r\n", (uint32_t)st->avail, (uint32_t)st->max, (uint32_t)st->err);
+
+    start = (mem_tlm.sample_num < MEM_TLM_SAMPLE_NUM) ? 0 : mem_tlm.sample_idx;
+    for (i = 0; i < mem_tlm.sample_num; i++) {
+        sample = &mem_tlm.sample[(start + i) % MEM_TLM_SAMPLE_NUM];
+        app_print("MEMTLM,S,%u,%u", sample->time_ms, sample->heap_peak);
+        for (j = 0; j < MEMP_MAX; j++) {
+            app_print(",%u", sample->peak[j]);
+        }
+        app_print("\r\n");
+    }
+
+    mem_tlm_fail_print("MEMTLM,F,");
+    app_print("MEMTLM,END\r\n");
+}
+
+#endif /* CONFIG_LWIP_MEM_TELEMETRY */
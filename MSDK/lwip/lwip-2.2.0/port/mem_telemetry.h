@@ -0,0 +1,77 @@
+/*!
+    \file    mem_telemetry.h
+    \brief   Declaration of the lwIP memory pool telemetry.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _MEM_TELEMETRY_H_
+#define _MEM_TELEMETRY_H_
+
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+
+#ifdef CONFIG_LWIP_MEM_TELEMETRY
+
+/* Allocation failures kept with their caller, the oldest is overwritten */
+#define MEM_TLM_FAIL_NUM                16
+/* Samples kept in the time series, the oldest is overwritten */
+#define MEM_TLM_SAMPLE_NUM              60
+#define MEM_TLM_INTV_MS_DEFAULT         1000
+#define MEM_TLM_INTV_MS_MIN             10
+/* Pool index used for the lwIP heap */
+#define MEM_TLM_HEAP                    MEMP_MAX
+
+struct mem_tlm_fail {
+    uint32_t time_ms;                   // system time of the failure
+    void *caller;                       // return address into the caller of memp_malloc/mem_malloc
+    void *task;                         // task that asked for the memory
+    uint16_t pool;                      // memp_t or MEM_TLM_HEAP
+    uint16_t size;                      // requested size, heap only
+};
+
+struct mem_tlm_sample {
+    uint32_t time_ms;                   // system time at the end of the interval
+    uint32_t heap_peak;                 // heap bytes in use at the peak of the interval
+    uint16_t peak[MEMP_MAX];            // elements in use at the peak of the interval
+};
+
+void mem_tlm_memp_alloc(int type, void *mem, void *caller);
+void mem_tlm_heap_alloc(uint32_t size, void *mem, void *caller);
+
+int mem_tlm_start(uint32_t intv_ms);
+void mem_tlm_stop(void);
+void mem_tlm_reset(void);
+void mem_tlm_report(void);
+void mem_tlm_trace_dump(void);
+
+#endif /* CONFIG_LWIP_MEM_TELEMETRY */
+
+#endif /* _MEM_TELEMETRY_H_ */
@@ -0,0 +1,437 @@
+/*!
+    \file    net_mcast_filter.c
+    \brief   Multicast MAC filter of the WiFi network interfaces, driven by IGMP and MLD.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * INCLUDE FILES
+ ****************************************************************************************
+ */
+#include "lwip/opt.h"
+#include "lwip/netif.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/ip6_addr.h"
+#include "netif/ethernet.h"
+#include <string.h>
+
+#include "app_cfg.h"
+#include "wrapper_os.h"
+#include "dbg_print.h"
+#include "net_mcast_filter.h"
+
+#ifdef CONFIG_LWIP_MCAST_FILTER
+
+#if (NET_MCAST_FILTER_HASH & (NET_MCAST_FILTER_HASH - 1)) != 0
+#error "NET_MCAST_FILTER_HASH must be a power of 2"
+#endif
+
+/* Reference count of an entry which got more joins than it can count. It is kept until
+   the interface is removed, as it cannot tell when its last group is left */
+#define NET_MCAST_REF_PINNED            0xff
+
+struct net_mcast_entry {
+    struct netif *netif;
+    uint8_t mac[ETH_HWADDR_LEN];
+    uint8_t ref;                        // groups mapped to this MAC address, 0 if the entry is free
+    uint8_t next;                       // next entry of the bucket + 1, 0 for none
+};
+
+struct net_mcast_netif {
+    struct netif *netif;                // interface the filter is installed on, NULL if free
+    uint16_t overflow;                  // joins of the interface which did not fit in the table
+};
+
+struct net_mcast_filter {
+    uint8_t bucket[NET_MCAST_FILTER_HASH];  // first entry of the bucket + 1, 0 for none
+    struct net_mcast_entry entry[NET_MCAST_FILTER_NUM];
+    struct net_mcast_netif nif[NET_MCAST_FILTER_NETIF_NUM];
+    struct net_mcast_filter_stats stats;
+};
+
+static struct net_mcast_filter net_mcf;
+
+/*!
+    \brief      hash a multicast MAC address, the first bytes are the same for all groups
+    \param[in]  mac: multicast MAC address
+    \param[out] none
+    \retval     bucket index
+*/
+static uint8_t net_mcast_hash(const uint8_t *mac)
+{
+    return (mac[2] ^ mac[3] ^ mac[4] ^ mac[5]) & (NET_MCAST_FILTER_HASH - 1);
+}
+
+/*!
+    \brief      find the entry of a MAC address, called with the critical section held
+    \param[in]  netif: interface the address is joined on
+    \param[in]  mac: multicast MAC address
+    \param[out] prev: entry before it in the bucket + 1, 0 if first, may be NULL
+    \retval     entry index + 1, 0 if not found
+*/
+static uint8_t net_mcast_find(struct netif *netif, const uint8_t *mac, uint8_t *prev)
+{
+    uint8_t idx = net_mcf.bucket[net_mcast_hash(mac)];
+    uint8_t last = 0;
+    struct net_mcast_entry *e;
+
+    while (idx) {
+        e = &net_mcf.entry[idx - 1];
+        if ((e->netif == netif) && !memcmp(e->mac, mac, ETH_HWADDR_LEN))
+            break;
+        last = idx;
+        idx = e->next;
+    }
+    if (prev)
+        *prev = last;
+    return idx;
+}
+
+/*!
+    \brief      find the filter state of an interface, called with the critical section held
+    \param[in]  netif: interface
+    \param[out] none
+    \retval     filter state of the interface, NULL if the filter is not installed on it
+*/
+static struct net_mcast_netif *net_mcast_netif_get(struct netif *netif)
+{
+    uint8_t i;
+
+    for (i = 0; i < NET_MCAST_FILTER_NETIF_NUM; i++) {
+        if (net_mcf.nif[i].netif == netif)
+            return &net_mcf.nif[i];
+    }
+    return NULL;
+}
+
+/*!
+    \brief      add a reference to a multicast MAC address
+    \param[in]  netif: interface the group is joined on
+    \param[in]  mac: multicast MAC address
+    \param[out] none
+    \retval     none
+*/
+static void net_mcast_add(struct netif *netif, const uint8_t *mac)
+{
+    struct net_mcast_entry *e;
+    struct net_mcast_netif *nif;
+    uint8_t idx, h;
+
+    sys_enter_critical();
+    idx = net_mcast_find(netif, mac, NULL);
+    if (idx) {
+        /* A pinned entry stays joined, the count of its groups is lost */
+        if (net_mcf.entry[idx - 1].ref < NET_MCAST_REF_PINNED)
+            net_mcf.entry[idx - 1].ref++;
+        sys_exit_critical();
+        return;
+    }
+
+    for (idx = 0; idx < NET_MCAST_FILTER_NUM; idx++) {
+        if (net_mcf.entry[idx].ref == 0)
+            break;
+    }
+    if (idx == NET_MCAST_FILTER_NUM) {
+        /* Let all multicast frames of the interface in until the group is left */
+        nif = net_mcast_netif_get(netif);
+        if (nif) {
+            nif->overflow++;
+            net_mcf.stats.overflow++;
+        }
+        sys_exit_critical();
+        dbg_print(WARNING, "mcast filter: table full, filtering disabled\r\n");
+        return;
+    }
+
+    e = &net_mcf.entry[idx];
+    e->netif = netif;
+    memcpy(e->mac, mac, ETH_HWADDR_LEN);
+    e->ref = 1;
+    h = net_mcast_hash(mac);
+    e->next = net_mcf.bucket[h];
+    net_mcf.bucket[h] = idx + 1;
+    net_mcf.stats.entries++;
+    sys_exit_critical();
+}
+
+/*!
+    \brief      remove an entry from its bucket and free it, called with the critical section held
+    \param[in]  idx: entry index + 1
+    \param[in]  prev: entry before it in the bucket + 1, 0 if first
+    \param[out] none
+    \retval     none
+*/
+static void net_mcast_unlink(uint8_t idx, uint8_t prev)
+{
+    struct net_mcast_entry *e = &net_mcf.entry[idx - 1];
+
+    if (prev)
+        net_mcf.entry[prev - 1].next = e->next;
+    else
+        net_mcf.bucket[net_mcast_hash(e->mac)] = e->next;
+    e->ref = 0;
+    e->next = 0;
+    e->netif = NULL;
+    net_mcf.stats.entries--;
+}
+
+/*!
+    \brief      remove a reference to a multicast MAC address
+    \param[in]  netif: interface the group is left on
+    \param[in]  mac: multicast MAC address
+    \param[out] none
+    \retval     none
+*/
+static void net_mcast_del(struct netif *netif, const uint8_t *mac)
+{
+    struct net_mcast_netif *nif;
+    uint8_t idx, prev;
+
+    sys_enter_critical();
+    idx = net_mcast_find(netif, mac, &prev);
+    if (idx == 0) {
+        /* The join did not fit in the table */
+        nif = net_mcast_netif_get(netif);
+        if (nif && nif->overflow) {
+            nif->overflow--;
+            net_mcf.stats.overflow--;
+        }
+    } else if (net_mcf.entry[idx - 1].ref != NET_MCAST_REF_PINNED) {
+        /* A pinned entry waits for net_mcast_filter_clear */
+        if (--net_mcf.entry[idx - 1].ref == 0)
+            net_mcast_unlink(idx, prev);
+    }
+    sys_exit_critical();
+}
+
+#if LWIP_IPV4 && LWIP_IGMP
+/*!
+    \brief      IGMP MAC filter callback of the interface
+    \param[in]  netif: interface the group is joined or left on
+    \param[in]  group: IPv4 multicast group
+    \param[in]  action: NETIF_ADD_MAC_FILTER or NETIF_DEL_MAC_FILTER
+    \param[out] none
+    \retval     ERR_OK
+*/
+static err_t net_mcast_igmp_filter(struct netif *netif, const ip4_addr_t *group,
+                                   enum netif_mac_filter_action action)
+{
+    /* 01:00:5e followed by the low 23 bits of the group */
+    uint8_t mac[ETH_HWADDR_LEN] = {0x01, 0x00, 0x5e, ip4_addr2(group) & 0x7f,
+                                   ip4_addr3(group), ip4_addr4(group)};
+
+    if (action == NETIF_ADD_MAC_FILTER)
+        net_mcast_add(netif, mac);
+    else
+        net_mcast_del(netif, mac);
+    return ERR_OK;
+}
+#endif /* LWIP_IPV4 && LWIP_IGMP */
+
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+/*!
+    \brief      MLD MAC filter callback of the interface
+    \param[in]  netif: interface the group is joined or left on
+    \param[in]  group: IPv6 multicast group
+    \param[in]  action: NETIF_ADD_MAC_FILTER or NETIF_DEL_MAC_FILTER
+    \param[out] none
+    \retval     ERR_OK
+*/
+static err_t net_mcast_mld_filter(struct netif *netif, const ip6_addr_t *group,
+                                  enum netif_mac_filter_action action)
+{
+    /* 33:33 followed by the low 32 bits of the group */
+    uint32_t low = lwip_ntohl(group->addr[3]);
+    uint8_t mac[ETH_HWADDR_LEN] = {0x33, 0x33, (uint8_t)(low >> 24), (uint8_t)(low >> 16),
+                                   (uint8_t)(low >> 8), (uint8_t)low};
+
+    if (action == NETIF_ADD_MAC_FILTER)
+        net_mcast_add(netif, mac);
+    else
+        net_mcast_del(netif, mac);
+    return ERR_OK;
+}
+#endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
+
+/*!
+    \brief      install the IGMP/MLD MAC filter callbacks of an interface,
+                called from its init function before lwIP joins any group
+    \param[in]  netif: interface being added
+    \param[out] none
+    \retval     none
+*/
+void net_mcast_filter_init(struct netif *netif)
+{
+    struct net_mcast_netif *nif;
+
+    sys_enter_critical();
+    nif = net_mcast_netif_get(netif);
+    if (nif == NULL) {
+        nif = net_mcast_netif_get(NULL);
+        if (nif) {
+            nif->netif = netif;
+            nif->overflow = 0;
+        }
+    }
+    sys_exit_critical();
+    if (nif == NULL) {
+        /* net_mcast_filter_accept lets all the multicast frames of the interface in */
+        dbg_print(WARNING, "mcast filter: no room for the interface, filtering disabled\r\n");
+        return;
+    }
+
+#if LWIP_IPV4 && LWIP_IGMP
+    netif_set_igmp_mac_filter(netif, net_mcast_igmp_filter);
+#endif
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+    {
+        ip6_addr_t allnodes;
+
+        netif_set_mld_mac_filter(netif, net_mcast_mld_filter);
+        /* lwIP receives ff02::1 without joining it through MLD */
+        ip6_addr_set_allnodes_linklocal(&allnodes);
+        net_mcast_mld_filter(netif, &allnodes, NETIF_ADD_MAC_FILTER);
+    }
+#endif
+}
+
+/*!
+    \brief      free the entries and the joins which did not fit left for an interface
+                once it is removed
+    \param[in]  netif: interface removed
+    \param[out] none
+    \retval     none
+*/
+void net_mcast_filter_clear(struct netif *netif)
+{
+    struct net_mcast_netif *nif;
+    uint8_t h, idx, prev, next;
+
+    sys_enter_critical();
+    for (h = 0; h < NET_MCAST_FILTER_HASH; h++) {
+        prev = 0;
+        for (idx = net_mcf.bucket[h]; idx; idx = next) {
+            next = net_mcf.entry[idx - 1].next;
+            if (net_mcf.entry[idx - 1].netif == netif)
+                net_mcast_unlink(idx, prev);
+            else
+                prev = idx;
+        }
+    }
+    nif = net_mcast_netif_get(netif);
+    if (nif) {
+        net_mcf.stats.overflow -= nif->overflow;
+        nif->overflow = 0;
+        nif->netif = NULL;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      check the destination of a received frame against the joined groups,
+                called from the RX path before the pbuf allocation
+    \param[in]  netif: interface receiving the frame
+    \param[in]  da: destination MAC address of the frame
+    \param[out] none
+    \retval     1 if the frame shall be passed to lwIP, 0 to drop it
+*/
+int net_mcast_filter_accept(struct netif *netif, const uint8_t *da)
+{
+    struct net_mcast_netif *nif;
+    int accept;
+
+    /* Only IPv4 and IPv6 multicast are filtered, other group addresses go through */
+    if (!((da[0] == 0x01) && (da[1] == 0x00) && (da[2] == 0x5e)) &&
+        !((da[0] == 0x33) && (da[1] == 0x33)))
+        return 1;
+
+    sys_enter_critical();
+    nif = net_mcast_netif_get(netif);
+    if ((nif == NULL) || nif->overflow) {
+        net_mcf.stats.open++;
+        accept = 1;
+    } else if (net_mcast_find(netif, da, NULL)) {
+        net_mcf.stats.pass++;
+        accept = 1;
+    } else {
+        net_mcf.stats.drop++;
+        accept = 0;
+    }
+    sys_exit_critical();
+
+    return accept;
+}
+
+/*!
+    \brief      get the filter counters
+    \param[in]  reset: clear the frame counters after reading them
+    \param[out] stats: filled with the counters, may be NULL
+    \retval     none
+*/
+void net_mcast_filter_stats_get(struct net_mcast_filter_stats *stats, int reset)
+{
+    sys_enter_critical();
+    if (stats)
+        *stats = net_mcf.stats;
+    if (reset) {
+        net_mcf.stats.pass = 0;
+        net_mcf.stats.drop = 0;
+        net_mcf.stats.open = 0;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      print the joined MAC addresses and the counters
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void net_mcast_filter_dump(void)
+{
+    struct net_mcast_entry *e;
+    uint8_t h, idx;
+
+    app_print("mcast filter: %u entries, pass %u, drop %u, open %u%s\r\n",
+              net_mcf.stats.entries, net_mcf.stats.pass, net_mcf.stats.drop, net_mcf.stats.open,
+              net_mcf.stats.overflow ? " (table full, filtering disabled)" : "");
+    for (h = 0; h < NET_MCAST_FILTER_HASH; h++) {
+        for (idx = net_mcf.bucket[h]; idx; idx = e->next) {
+            e = &net_mcf.entry[idx - 1];
+            app_print("    %c%c%u %02x:%02x:%02x:%02x:%02x:%02x ref %u%s\r\n",
+                      e->netif->name[0], e->netif->name[1], e->netif->num,
+                      e->mac[0], e->mac[1], e->mac[2], e->mac[3], e->mac[4], e->mac[5], e->ref,
+                      (e->ref == NET_MCAST_REF_PINNED) ? " (pinned)" : "");
+        }
+    }
+}
+
+#endif /* CONFIG_LWIP_MCAST_FILTER */
@@ -0,0 +1,66 @@
+/*!
+    \file    net_mcast_filter.h
+    \brief   Declaration of the multicast MAC filter of the WiFi network interfaces.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _NET_MCAST_FILTER_H_
+#define _NET_MCAST_FILTER_H_
+
+#include "lwip/opt.h"
+#include "lwip/netif.h"
+
+#ifdef CONFIG_LWIP_MCAST_FILTER
+
+/* Multicast MAC addresses kept for all the interfaces */
+#define NET_MCAST_FILTER_NUM            16
+/* Hash buckets, power of 2 */
+#define NET_MCAST_FILTER_HASH           8
+/* Interfaces the filter can be installed on, at least CFG_VIF_NUM */
+#define NET_MCAST_FILTER_NETIF_NUM      4
+
+struct net_mcast_filter_stats {
+    uint32_t pass;                      // frames for a joined group
+    uint32_t drop;                      // frames dropped before the pbuf allocation
+    uint32_t open;                      // frames passed while a join did not fit in the table
+    uint16_t entries;                   // MAC addresses in the table
+    uint16_t overflow;                  // joins which did not fit in the table, all interfaces
+};
+
+void net_mcast_filter_init(struct netif *netif);
+void net_mcast_filter_clear(struct netif *netif);
+int net_mcast_filter_accept(struct netif *netif, const uint8_t *da);
+void net_mcast_filter_stats_get(struct net_mcast_filter_stats *stats, int reset);
+void net_mcast_filter_dump(void);
+
+#endif /* CONFIG_LWIP_MCAST_FILTER */
+
+#endif /* _NET_MCAST_FILTER_H_ */
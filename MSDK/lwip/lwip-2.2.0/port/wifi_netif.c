@@ -55,6 +55,12 @@ OF SUCH DAMAGE.
 #include "macif_api.h"
 #include "dbg_print.h"
 #include "wifi_init.h"
+#ifdef CONFIG_WIFI_STA_TABLE
+#include "wifi_sta_table.h"
+#endif
+#ifdef CONFIG_LWIP_MCAST_FILTER
+#include "net_mcast_filter.h"
+#endif
 
 #if LWIP_IPV6
 #include "lwip/ethip6.h"
@@ -211,6 +217,10 @@ static err_t net_if_output(struct netif *net_if, struct pbuf *p_buf)
 
     }
 
+#if defined(CONFIG_WIFI_STA_TABLE) && defined(CFG_SOFTAP)
+    wifi_sta_table_tx((uint8_t *)p_buf->payload, p_buf->tot_len, (status == ERR_OK));
+#endif
+
     return (status);
 }
 
@@ -251,6 +261,9 @@ static err_t net_if_init(struct netif *net_if)
     net_if->flags |= NETIF_FLAG_MLD6;
     #endif
     net_if->output_ip6 = ethip6_output;
+#endif
+#ifdef CONFIG_LWIP_MCAST_FILTER
+    net_mcast_filter_init(net_if);
 #endif
     return status;
 }
@@ -324,6 +337,9 @@ int net_if_remove(void *net_if)
     dhcp_cleanup(netif);
 
     status = netifapi_netif_remove(netif);
+#ifdef CONFIG_LWIP_MCAST_FILTER
+    net_mcast_filter_clear(netif);
+#endif
 
     return (status == ERR_OK ? 0 : -1);
 }
@@ -503,6 +519,16 @@ int net_if_input(net_buf_rx_t *buf, void *net_if, void *addr, uint16_t len, net_
     struct pbuf* p;
     struct netif *netif = (struct netif *)net_if;
 
+#ifdef CONFIG_LWIP_MCAST_FILTER
+    // Drop multicast frames of groups nobody joined before any processing
+    if ((len >= SIZEOF_ETH_HDR) && (((uint8_t *)addr)[0] & 0x01) &&
+        !net_mcast_filter_accept(netif, (uint8_t *)addr))
+    {
+        free_fn(buf);
+        return 0;
+    }
+#endif
+
     buf->custom_free_function = (pbuf_free_custom_fn)free_fn;
     p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, buf, addr, len);
     if (p == NULL)
@@ -512,6 +538,12 @@ int net_if_input(net_buf_rx_t *buf, void *net_if, void *addr, uint16_t len, net_
         return -1;
     }
 
+#if defined(CONFIG_WIFI_STA_TABLE) && defined(CFG_SOFTAP)
+    // Source address of the Ethernet frame
+    if (len >= SIZEOF_ETH_HDR)
+        wifi_sta_table_rx((uint8_t *)addr + ETH_HWADDR_LEN, len);
+#endif
+
     if (netif->input(p, netif))
     {
         free_fn(buf);
@@ -1316,6 +1316,202 @@ lwip_recv(int s, void *mem, size_t len, int flags)
   return lwip_recvfrom(s, mem, len, flags, NULL, NULL);
 }
 
+/* GD modified */
+#if LWIP_SOCKET_RECV_PBUF
+/* Custom pbufs (driver RX buffers) currently lent to applications */
+static u16_t recv_pbuf_lent;
+static u16_t recv_pbuf_lent_peak;
+/* Chains copied into PBUF_RAM because the lent limit was reached */
+static u32_t recv_pbuf_cloned;
+
+static u16_t
+lwip_recv_pbuf_custom_cnt(const struct pbuf *p)
+{
+  u16_t cnt = 0;
+
+  for (; p != NULL; p = p->next) {
+    if (p->flags & PBUF_FLAG_IS_CUSTOM) {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+/* Account a chain before it is handed to the application. If lending it would
+ * hold more than LWIP_SOCKET_RECV_PBUF_LENT_MAX driver RX buffers, the chain is
+ * copied into PBUF_RAM and the RX buffers go back to the driver right away.
+ */
+static struct pbuf *
+lwip_recv_pbuf_lend(struct pbuf *p)
+{
+  struct pbuf *q;
+  u16_t cnt = lwip_recv_pbuf_custom_cnt(p);
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (cnt == 0) {
+    return p;
+  }
+  SYS_ARCH_PROTECT(lev);
+  if (recv_pbuf_lent + cnt > LWIP_SOCKET_RECV_PBUF_LENT_MAX) {
+    SYS_ARCH_UNPROTECT(lev);
+    q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+    if (q != NULL) {
+      pbuf_free(p);
+      SYS_ARCH_PROTECT(lev);
+      recv_pbuf_cloned++;
+      SYS_ARCH_UNPROTECT(lev);
+      return q;
+    }
+    /* out of heap: lend the RX buffers anyway rather than dropping the data */
+    SYS_ARCH_PROTECT(lev);
+  }
+  recv_pbuf_lent = (u16_t)(recv_pbuf_lent + cnt);
+  if (recv_pbuf_lent > recv_pbuf_lent_peak) {
+    recv_pbuf_lent_peak = recv_pbuf_lent;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return p;
+}
+
+/**
+ * Receive without copying: on success *p points to a pbuf chain owned by the
+ * caller until it is returned with lwip_recv_pbuf_free(). The chain must be
+ * returned unmodified (no pbuf_header/pbuf_realloc/pbuf_cat on it).
+ * For TCP the receive window is only opened again when the chain is returned,
+ * so a slow consumer throttles the peer instead of the driver RX pool.
+ * Only MSG_DONTWAIT is supported in flags.
+ *
+ * @return length of the chain, 0 if the TCP connection was closed by the peer,
+ *         -1 on error (errno is set)
+ */
+ssize_t
+lwip_recvfrom_pbuf(int s, struct pbuf **p, int flags,
+                   struct sockaddr *from, socklen_t *fromlen)
+{
+  struct lwip_sock *sock;
+  struct pbuf *q;
+  u8_t apiflags;
+  err_t err;
+
+  LWIP_ERROR("lwip_recvfrom_pbuf: invalid pbuf pointer", p != NULL, set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_recvfrom_pbuf: unsupported flags", (flags & ~MSG_DONTWAIT) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+  *p = NULL;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_pbuf(%d, 0x%x)\n", s, flags));
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  apiflags = (flags & MSG_DONTWAIT) ? NETCONN_DONTBLOCK : 0;
+#if LWIP_TCP
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    /* data left by a previous lwip_recv() has not been acknowledged yet either */
+    q = sock->lastdata.pbuf;
+    if (q != NULL) {
+      sock->lastdata.pbuf = NULL;
+    } else {
+      err = netconn_recv_tcp_pbuf_flags(sock->conn, &q, (u8_t)(apiflags | NETCONN_NOAUTORCVD));
+      if (err != ERR_OK) {
+        LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_pbuf(%d): error is \"%s\"!\n", s, lwip_strerr(err)));
+        set_errno(err_to_errno(err));
+        done_socket(sock);
+        return (err == ERR_CLSD) ? 0 : -1;
+      }
+    }
+    lwip_recv_tcp_from(sock, from, fromlen, "lwip_recvfrom_pbuf", s, q->tot_len);
+  } else
+#endif
+  {
+    struct netbuf *buf = sock->lastdata.netbuf;
+
+    if (buf != NULL) {
+      sock->lastdata.netbuf = NULL;
+    } else {
+      err = netconn_recv_udp_raw_netbuf_flags(sock->conn, &buf, apiflags);
+      if (err != ERR_OK) {
+        LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_pbuf[UDP/RAW](%d): error is \"%s\"!\n", s, lwip_strerr(err)));
+        set_errno(err_to_errno(err));
+        done_socket(sock);
+        return -1;
+      }
+    }
+    if (from && fromlen) {
+      lwip_sock_make_addr(sock->conn, netbuf_fromaddr(buf), netbuf_fromport(buf), from, fromlen);
+    }
+    /* keep the pbuf, drop the netbuf around it */
+    q = buf->p;
+    buf->p = NULL;
+    netbuf_delete(buf);
+  }
+
+  *p = lwip_recv_pbuf_lend(q);
+  set_errno(0);
+  done_socket(sock);
+  return (ssize_t)(*p)->tot_len;
+}
+
+ssize_t
+lwip_recv_pbuf(int s, struct pbuf **p, int flags)
+{
+  return lwip_recvfrom_pbuf(s, p, flags, NULL, NULL);
+}
+
+/**
+ * Return a chain obtained from lwip_recv_pbuf()/lwip_recvfrom_pbuf().
+ * Must be called before the socket is closed so that the TCP window credit
+ * goes to the right connection.
+ */
+void
+lwip_recv_pbuf_free(int s, struct pbuf *p)
+{
+  struct lwip_sock *sock;
+  u16_t cnt, len;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (p == NULL) {
+    return;
+  }
+  cnt = lwip_recv_pbuf_custom_cnt(p);
+  len = p->tot_len;
+  if (cnt) {
+    SYS_ARCH_PROTECT(lev);
+    recv_pbuf_lent = (u16_t)(recv_pbuf_lent - LWIP_MIN(cnt, recv_pbuf_lent));
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  pbuf_free(p);
+
+#if LWIP_TCP
+  sock = get_socket(s);
+  if (sock) {
+    if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+      netconn_tcp_recvd(sock->conn, len);
+    }
+    done_socket(sock);
+  }
+#else
+  LWIP_UNUSED_ARG(s);
+  LWIP_UNUSED_ARG(sock);
+  LWIP_UNUSED_ARG(len);
+#endif
+}
+
+void
+lwip_recv_pbuf_stats(u16_t *lent, u16_t *lent_peak, u32_t *cloned)
+{
+  if (lent) {
+    *lent = recv_pbuf_lent;
+  }
+  if (lent_peak) {
+    *lent_peak = recv_pbuf_lent_peak;
+  }
+  if (cloned) {
+    *cloned = recv_pbuf_cloned;
+  }
+}
+#endif /* LWIP_SOCKET_RECV_PBUF */
+/* GD modified end */
+
 ssize_t
 lwip_recvmsg(int s, struct msghdr *message, int flags)
 {
@@ -92,6 +92,10 @@
 
 #include <string.h>
 
+/* GD modified */
+#include "tls_session.h"
+/* GD modified end */
+
 #ifndef ALTCP_MBEDTLS_ENTROPY_PTR
 #define ALTCP_MBEDTLS_ENTROPY_PTR   NULL
 #endif
@@ -283,7 +287,13 @@ altcp_mbedtls_lower_recv_process(struct altcp_pcb *conn, altcp_mbedtls_state_t *
 {
   if (!(state->flags & ALTCP_MBEDTLS_FLAGS_HANDSHAKE_DONE)) {
     /* handle connection setup (handshake not done) */
+/* GD modified */
+#ifdef CFG_TLS_SESSION_CACHE
+    int ret = tls_session_handshake(&state->ssl_context);
+#else
     int ret = mbedtls_ssl_handshake(&state->ssl_context);
+#endif
+/* GD modified end */
     /* try to send data... */
     altcp_output(conn->inner_conn);
     if (state->bio_bytes_read) {
@@ -406,6 +416,17 @@ altcp_mbedtls_handle_rx_appldata(struct altcp_pcb *conn, altcp_mbedtls_state_t *
 
     /* decrypt application data, this pulls encrypted RX data off state->rx pbuf chain */
     ret = mbedtls_ssl_read(&state->ssl_context, (unsigned char *)buf->payload, PBUF_POOL_BUFSIZE);
+/* GD modified */
+#if defined(CFG_TLS_SESSION_CACHE) && defined(TLS_SESSION_TLS13_TICKET)
+    if (ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
+      /* TLS 1.3 session ticket, keep it and go on with the application data */
+      tls_session_ticket(&state->ssl_context);
+      pbuf_free(buf);
+      ret = 1;
+      continue;
+    }
+#endif
+/* GD modified end */
     if (ret < 0) {
       if (ret == MBEDTLS_ERR_SSL_CLIENT_RECONNECT) {
         /* client is initiating a new connection using the same source port -> close connection or make handshake */
@@ -593,6 +614,15 @@ altcp_mbedtls_lower_poll(void *arg, struct altcp_pcb *inner_conn)
       if (altcp_mbedtls_handle_rx_appldata(conn, state) == ERR_ABRT) {
         return ERR_ABRT;
       }
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH) && ALTCP_MBEDTLS_SHRINK_IDLE_BUFFERS
+      /* nothing queued in either direction: give the record buffers back */
+      if ((state->flags & ALTCP_MBEDTLS_FLAGS_HANDSHAKE_DONE) &&
+          (state->rx == NULL) && (state->rx_app == NULL)) {
+        mbedtls_ssl_shrink_buffers(&state->ssl_context);
+      }
+#endif
+/* GD modified end */
     }
     if (conn->poll) {
       return conn->poll(conn->arg, conn);
@@ -888,6 +918,20 @@ altcp_tls_create_config(int is_server, u8_t cert_count, u8_t pkey_count, int hav
 /* GD modified end */
 
   mbedtls_ssl_conf_rng(&conf->conf, mbedtls_ctr_drbg_random, &altcp_tls_entropy_rng->ctr_drbg);
+/* GD modified */
+#if defined(CFG_TLS_SESSION_CACHE) && defined(TLS_SESSION_TLS13_TICKET)
+  if (!is_server) {
+    /* report the TLS 1.3 tickets so that they can be kept for resumption */
+    mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets(&conf->conf, MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED);
+  }
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+  if (!is_server && (ALTCP_MBEDTLS_MAX_FRAG_LEN != MBEDTLS_SSL_MAX_FRAG_LEN_NONE)) {
+    /* ask the server for smaller records, the record buffers follow */
+    mbedtls_ssl_conf_max_frag_len(&conf->conf, ALTCP_MBEDTLS_MAX_FRAG_LEN);
+  }
+#endif
+/* GD modified end */
 #if ALTCP_MBEDTLS_LIB_DEBUG != LWIP_DBG_OFF
   mbedtls_ssl_conf_dbg(&conf->conf, altcp_mbedtls_debug, stdout);
 #endif
@@ -1231,6 +1275,16 @@ altcp_mbedtls_connect(struct altcp_pcb *conn, const ip_addr_t *ipaddr, u16_t por
     return ERR_VAL;
   }
   conn->connected = connected;
+/* GD modified */
+#ifdef CFG_TLS_SESSION_CACHE
+  if (conn->state) {
+    altcp_mbedtls_state_t *state = (altcp_mbedtls_state_t *)conn->state;
+    struct altcp_tls_config *config = (struct altcp_tls_config *)state->conf;
+    /* offer the session of a previous connection to the same server */
+    tls_session_begin(&state->ssl_context, config->hostname ? config->hostname : ipaddr_ntoa(ipaddr), port);
+  }
+#endif
+/* GD modified end */
   return altcp_connect(conn->inner_conn, ipaddr, port, altcp_mbedtls_lower_connected);
 }
 
@@ -1453,6 +1507,21 @@ altcp_mbedtls_dealloc(struct altcp_pcb *conn)
   if (conn) {
     altcp_mbedtls_state_t *state = (altcp_mbedtls_state_t *)conn->state;
     if (state) {
+/* GD modified */
+#ifdef CFG_TLS_SESSION_CACHE
+      tls_session_end(&state->ssl_context);
+#endif
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+      {
+        mbedtls_ssl_buffer_usage usage;
+        mbedtls_ssl_get_buffer_usage(&state->ssl_context, &usage);
+        LWIP_DEBUGF(ALTCP_MBEDTLS_DEBUG, ("altcp_mbedtls: buffers in %u out %u peak %u, records in %u out %u, grow %u shrink %u\n",
+                                          (unsigned)usage.in_buf_len, (unsigned)usage.out_buf_len, (unsigned)usage.buf_peak,
+                                          (unsigned)usage.in_record_max, (unsigned)usage.out_record_max,
+                                          (unsigned)usage.grow_cnt, (unsigned)usage.shrink_cnt));
+      }
+#endif
+/* GD modified end */
       mbedtls_ssl_free(&state->ssl_context);
       state->flags = 0;
       if (state->rx) {
@@ -1261,11 +1261,35 @@ mqtt_msg_publish(mqtt_client_t *client, const char *topic, const void *payload,
       return ret;
     }
   }
+  if (client->output_hold) {
+    return ERR_OK;
+  }
 /* GD modified end */
   mqtt_output_send(&client->output, client->conn);
   return ERR_OK;
 }
 
+/* GD modified */
+/**
+ * @ingroup mqtt
+ * Hold back the publishes in the output buffer, so that a batch of small
+ * messages leaves in one write when the output is released.
+ * @param client MQTT client
+ * @param hold 1 to hold the output, 0 to release and send it
+ */
+void
+mqtt_output_hold(mqtt_client_t *client, u8_t hold)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("mqtt_output_hold: client != NULL", client);
+
+  client->output_hold = hold;
+  if (!hold && (client->conn != NULL) && (client->conn_state == MQTT_CONNECTED)) {
+    mqtt_output_send(&client->output, client->conn);
+  }
+}
+/* GD modified end */
+
 
 /**
  * @ingroup mqtt
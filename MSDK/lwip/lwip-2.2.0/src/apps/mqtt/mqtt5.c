@@ -995,6 +995,11 @@ err_t mqtt5_msg_publish(mqtt_client_t *client, const char *topic, const void *pa
         }
     }
 
+    /* GD modified */
+    if (client->output_hold) {
+        return ERR_OK;
+    }
+    /* GD modified end */
     mqtt_output_send(&client->output, client->conn);
     return ERR_OK;
 }
@@ -319,6 +319,11 @@ sntp_process(const struct sntp_timestamps *timestamps)
       t3 = SNTP_SEC_FRAC_TO_S64(sec, frac);
       t1 = SNTP_TIMESTAMP_TO_S64(timestamps->orig);
       t2 = SNTP_TIMESTAMP_TO_S64(timestamps->recv);
+      /* GD modified */
+#ifdef SNTP_SET_ROUNDTRIP_DELAY
+      SNTP_SET_ROUNDTRIP_DELAY((t4 - t1) - (t3 - t2));
+#endif
+      /* GD modified end */
       /* Clock offset calculation according to RFC 4330 */
       t4 += ((t2 - t1) + (t3 - t4)) / 2;
 
@@ -1031,6 +1031,16 @@ dhcp_network_changed_link_up(struct netif *netif)
          same state */
       /* ensure we start with short timeouts, even if already discovering */
       dhcp->tries = 0;
+/* GD modified */
+#ifdef CONFIG_FAST_RECONNECT
+      /* link came up before the first exchange: try INIT-REBOOT with the last lease */
+      if ((dhcp->state == DHCP_STATE_INIT) && (wifi_vif_history_ip_get() != 0)) {
+        dhcp->offered_ip_addr.addr = wifi_vif_history_ip_get();
+        dhcp_reboot(netif);
+        break;
+      }
+#endif /* CONFIG_FAST_RECONNECT */
+/* GD modified end */
       dhcp_discover(netif);
       break;
   }
@@ -114,6 +114,11 @@ PACK_STRUCT_END
 /* global variables */
 static struct ip_reassdata *reassdatagrams;
 static u16_t ip_reass_pbufcount;
+/* GD modified */
+/* custom pbufs (driver RX buffers) in the queue */
+static u16_t ip_reass_custompbufcount;
+static struct ip_reass_stats ip_reass_gd_stats;
+/* GD modified end */
 
 /* function prototypes */
 static void ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev);
@@ -206,6 +211,10 @@ ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *p
     pbufs_freed = (u16_t)(pbufs_freed + clen);
     pbuf_free(pcur);
   }
+  /* GD modified */
+  LWIP_ASSERT("ip_reass_custompbufcount >= ipr->custom", ip_reass_custompbufcount >= ipr->custom);
+  ip_reass_custompbufcount = (u16_t)(ip_reass_custompbufcount - ipr->custom);
+  /* GD modified end */
   /* Then, unchain the struct ip_reassdata from the list and free it. */
   ip_reass_dequeue_datagram(ipr, prev);
   LWIP_ASSERT("ip_reass_pbufcount >= pbufs_freed", ip_reass_pbufcount >= pbufs_freed);
@@ -222,10 +231,11 @@ ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *p
  * @param fraghdr IP header of the current fragment
  * @param pbufs_needed number of pbufs needed to enqueue
  *        (used for freeing other datagrams if not enough space)
+ * @param same_src only free datagrams from the source of fraghdr (GD modified)
  * @return the number of pbufs freed
  */
 static int
-ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
+ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed, int same_src)
 {
   /* @todo Can't we simply remove the last datagram in the
    *       linked list behind reassdatagrams?
@@ -243,7 +253,10 @@ ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
     other_datagrams = 0;
     r = reassdatagrams;
     while (r != NULL) {
-      if (!IP_ADDRESSES_AND_ID_MATCH(&r->iphdr, fraghdr)) {
+      /* GD modified */
+      if ((!IP_ADDRESSES_AND_ID_MATCH(&r->iphdr, fraghdr)) &&
+          (!same_src || ip4_addr_eq(&r->iphdr.src, &fraghdr->src))) {
+      /* GD modified end */
         /* Not the same datagram as fraghdr */
         other_datagrams++;
         if (oldest == NULL) {
@@ -269,6 +282,101 @@ ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
 }
 #endif /* IP_REASS_FREE_OLDEST */
 
+/* GD modified */
+/**
+ * Count the custom pbufs (driver RX buffers) of a pbuf chain.
+ */
+static u16_t
+ip_reass_custom_cnt(const struct pbuf *p)
+{
+  u16_t cnt = 0;
+
+  for (; p != NULL; p = p->next) {
+    if (p->flags & PBUF_FLAG_IS_CUSTOM) {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+/**
+ * Count the pbufs queued for the source of a fragment.
+ */
+static u16_t
+ip_reass_src_pbufs(struct ip_hdr *fraghdr)
+{
+  struct ip_reassdata *r;
+  u16_t cnt = 0;
+
+  for (r = reassdatagrams; r != NULL; r = r->next) {
+    if (ip4_addr_eq(&r->iphdr.src, &fraghdr->src)) {
+      cnt = (u16_t)(cnt + r->clen);
+    }
+  }
+  return cnt;
+}
+
+/**
+ * Free the datagram a fragment belongs to, if it is queued.
+ */
+static void
+ip_reass_drop_datagram(struct ip_hdr *fraghdr)
+{
+  struct ip_reassdata *r, *prev = NULL;
+
+  for (r = reassdatagrams; r != NULL; prev = r, r = r->next) {
+    if (IP_ADDRESSES_AND_ID_MATCH(&r->iphdr, fraghdr)) {
+      ip_reass_free_complete_datagram(r, prev);
+      return;
+    }
+  }
+}
+
+/**
+ * Free the oldest datagram holding custom pbufs, other than the one of fraghdr.
+ *
+ * @return 1 if a datagram was freed
+ */
+static int
+ip_reass_drop_oldest_custom(struct ip_hdr *fraghdr)
+{
+  struct ip_reassdata *r, *prev = NULL, *oldest = NULL, *oldest_prev = NULL;
+
+  for (r = reassdatagrams; r != NULL; prev = r, r = r->next) {
+    if ((r->custom != 0) && (!IP_ADDRESSES_AND_ID_MATCH(&r->iphdr, fraghdr)) &&
+        ((oldest == NULL) || (r->timer <= oldest->timer))) {
+      oldest = r;
+      oldest_prev = prev;
+    }
+  }
+  if (oldest == NULL) {
+    return 0;
+  }
+  ip_reass_free_complete_datagram(oldest, oldest_prev);
+  return 1;
+}
+
+/**
+ * Get the reassembly queue occupancy and the quota counters.
+ *
+ * @param stats filled with the counters, may be NULL
+ * @param reset clear the counters and the peak after reading them
+ */
+void
+ip_reass_stats_get(struct ip_reass_stats *stats, int reset)
+{
+  if (stats != NULL) {
+    ip_reass_gd_stats.pbufs = ip_reass_pbufcount;
+    ip_reass_gd_stats.custom = ip_reass_custompbufcount;
+    *stats = ip_reass_gd_stats;
+  }
+  if (reset) {
+    memset(&ip_reass_gd_stats, 0, sizeof(ip_reass_gd_stats));
+    ip_reass_gd_stats.custom_peak = ip_reass_custompbufcount;
+  }
+}
+/* GD modified end */
+
 /**
  * Enqueues a new fragment into the fragment queue
  * @param fraghdr points to the new fragments IP hdr
@@ -287,7 +395,11 @@ ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
   ipr = (struct ip_reassdata *)memp_malloc(MEMP_REASSDATA);
   if (ipr == NULL) {
 #if IP_REASS_FREE_OLDEST
-    if (ip_reass_remove_oldest_datagram(fraghdr, clen) >= clen) {
+    /* GD modified */
+    /* a source holding several datagrams gives up its own oldest one first */
+    if ((ip_reass_remove_oldest_datagram(fraghdr, clen, 1) > 0) ||
+        (ip_reass_remove_oldest_datagram(fraghdr, clen, 0) >= clen)) {
+    /* GD modified end */
       ipr = (struct ip_reassdata *)memp_malloc(MEMP_REASSDATA);
     }
     if (ipr == NULL)
@@ -511,6 +623,10 @@ ip4_reass(struct pbuf *p)
   u8_t hlen;
   int valid;
   int is_last;
+  /* GD modified */
+  u16_t ccnt;
+  u16_t src_pbufs;
+  /* GD modified end */
 
   IPFRAG_STATS_INC(ip_frag.recv);
   MIB2_STATS_INC(mib2.ipreasmreqds);
@@ -534,9 +650,60 @@ ip4_reass(struct pbuf *p)
 
   /* Check if we are allowed to enqueue more datagrams. */
   clen = pbuf_clen(p);
+
+  /* GD modified */
+  /* Do not let the queue pin too many driver RX buffers: copy the fragment out
+     of them, or give up the oldest incomplete datagram holding some. */
+  ccnt = ip_reass_custom_cnt(p);
+  if ((ccnt != 0) && ((ip_reass_custompbufcount + ccnt) > IP_REASS_MAX_CUSTOM_PBUFS)) {
+    struct pbuf *q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+    if (q != NULL) {
+      pbuf_free(p);
+      p = q;
+      fraghdr = (struct ip_hdr *)p->payload;
+      clen = 1;
+      ccnt = 0;
+      ip_reass_gd_stats.copied++;
+    } else {
+      if (ip_reass_drop_oldest_custom(fraghdr)) {
+        ip_reass_gd_stats.pressure_drop++;
+      }
+      if ((ip_reass_custompbufcount + ccnt) > IP_REASS_MAX_CUSTOM_PBUFS) {
+        ip_reass_gd_stats.copy_fail++;
+        IPFRAG_STATS_INC(ip_frag.memerr);
+        goto nullreturn;
+      }
+    }
+  }
+
+  /* Per source quota: a sender of large or incomplete datagrams cannot take
+     the whole queue from the others. It only applies while other sources have
+     fragments queued, a lone sender can use all of IP_REASS_MAX_PBUFS */
+  src_pbufs = ip_reass_src_pbufs(fraghdr);
+  if (((src_pbufs + clen) > IP_REASS_MAX_PBUFS_PER_SRC) && (ip_reass_pbufcount > src_pbufs)) {
+#if IP_REASS_FREE_OLDEST
+    if (ip_reass_remove_oldest_datagram(fraghdr, src_pbufs + clen - IP_REASS_MAX_PBUFS_PER_SRC, 1) > 0) {
+      ip_reass_gd_stats.src_drop++;
+    }
+    if ((ip_reass_src_pbufs(fraghdr) + clen) > IP_REASS_MAX_PBUFS_PER_SRC)
+#endif /* IP_REASS_FREE_OLDEST */
+    {
+      /* this datagram alone does not fit in the quota, it cannot complete */
+      LWIP_DEBUGF(IP_REASS_DEBUG, ("ip4_reass: source quota exceeded, drop datagram ID=%"X16_F"\n",
+                                   lwip_ntohs(IPH_ID(fraghdr))));
+      ip_reass_drop_datagram(fraghdr);
+      ip_reass_gd_stats.src_drop++;
+      IPFRAG_STATS_INC(ip_frag.memerr);
+      goto nullreturn;
+    }
+  }
+  /* GD modified end */
+
   if ((ip_reass_pbufcount + clen) > IP_REASS_MAX_PBUFS) {
 #if IP_REASS_FREE_OLDEST
-    if (!ip_reass_remove_oldest_datagram(fraghdr, clen) ||
+    /* GD modified */
+    if (!ip_reass_remove_oldest_datagram(fraghdr, clen, 0) ||
+    /* GD modified end */
         ((ip_reass_pbufcount + clen) > IP_REASS_MAX_PBUFS))
 #endif /* IP_REASS_FREE_OLDEST */
     {
@@ -606,6 +773,14 @@ ip4_reass(struct pbuf *p)
      the number of fragments that may be enqueued at any one time
      (overflow checked by testing against IP_REASS_MAX_PBUFS) */
   ip_reass_pbufcount = (u16_t)(ip_reass_pbufcount + clen);
+  /* GD modified */
+  ipr->clen = (u16_t)(ipr->clen + clen);
+  ipr->custom = (u16_t)(ipr->custom + ccnt);
+  ip_reass_custompbufcount = (u16_t)(ip_reass_custompbufcount + ccnt);
+  if (ip_reass_custompbufcount > ip_reass_gd_stats.custom_peak) {
+    ip_reass_gd_stats.custom_peak = ip_reass_custompbufcount;
+  }
+  /* GD modified end */
   if (is_last) {
     u16_t datagram_len = (u16_t)(offset + len);
     ipr->datagram_len = datagram_len;
@@ -660,6 +835,11 @@ ip4_reass(struct pbuf *p)
       }
     }
 
+    /* GD modified */
+    LWIP_ASSERT("ip_reass_custompbufcount >= ipr->custom", ip_reass_custompbufcount >= ipr->custom);
+    ip_reass_custompbufcount = (u16_t)(ip_reass_custompbufcount - ipr->custom);
+    /* GD modified end */
+
     /* release the sources allocate for the fragment queue entry */
     ip_reass_dequeue_datagram(ipr, ipr_prev);
 
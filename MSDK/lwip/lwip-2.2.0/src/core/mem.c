@@ -217,6 +217,11 @@ mem_malloc(mem_size_t size)
     MEM_STATS_INC_USED_LOCKED(used, size);
 #endif
   }
+  /* GD modified */
+#ifdef LWIP_HOOK_MEM_MALLOC
+  LWIP_HOOK_MEM_MALLOC(size, ret);
+#endif
+  /* GD modified end */
   return ret;
 }
 
@@ -961,6 +966,11 @@ mem_malloc_adjust_lfree:
         mem_overflow_init_element(mem, size_in);
 #endif
         MEM_SANITY();
+        /* GD modified */
+#ifdef LWIP_HOOK_MEM_MALLOC
+        LWIP_HOOK_MEM_MALLOC(size_in, (u8_t *)mem + SIZEOF_STRUCT_MEM + MEM_SANITY_OFFSET);
+#endif
+        /* GD modified end */
         return (u8_t *)mem + SIZEOF_STRUCT_MEM + MEM_SANITY_OFFSET;
       }
     }
@@ -972,6 +982,11 @@ mem_malloc_adjust_lfree:
   LWIP_MEM_ALLOC_UNPROTECT();
   sys_mutex_unlock(&mem_mutex);
   LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("mem_malloc: could not allocate %"S16_F" bytes\n", (s16_t)size));
+  /* GD modified */
+#ifdef LWIP_HOOK_MEM_MALLOC
+  LWIP_HOOK_MEM_MALLOC(size_in, NULL);
+#endif
+  /* GD modified end */
   return NULL;
 }
 
@@ -352,6 +352,11 @@ memp_malloc_fn(memp_t type, const char *file, const int line)
   memp = do_memp_malloc_pool_fn(memp_pools[type], file, line);
 #endif
 
+  /* GD modified */
+#ifdef LWIP_HOOK_MEMP_MALLOC
+  LWIP_HOOK_MEMP_MALLOC(type, memp);
+#endif
+  /* GD modified end */
   return memp;
 }
 
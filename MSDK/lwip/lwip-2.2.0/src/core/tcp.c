@@ -1538,6 +1538,21 @@ tcp_txnow(void)
   }
 }
 
+/* GD modified */
+/** Keep a FIN the application refused (its receive mbox was full) as an empty
+ * refused pbuf, tcp_fasttmr presents it again like refused data */
+void
+tcp_keep_refused_fin(struct tcp_pcb *pcb)
+{
+  if (pcb->refused_data == NULL) {
+    pcb->refused_data = pbuf_alloc(PBUF_RAW, 0, PBUF_RAM);
+    if (pcb->refused_data != NULL) {
+      pcb->refused_data->flags |= PBUF_FLAG_TCP_FIN;
+    }
+  }
+}
+/* GD modified end */
+
 /** Pass pcb->refused_data to the recv callback */
 err_t
 tcp_process_refused_data(struct tcp_pcb *pcb)
@@ -1565,6 +1580,21 @@ tcp_process_refused_data(struct tcp_pcb *pcb)
 #endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
     /* Notify again application with data previously received. */
     LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: notify kept packet\n"));
+/* GD modified */
+    if (refused_data->tot_len == 0) {
+      /* only a FIN kept by tcp_keep_refused_fin, rcv_wnd already counts it */
+      pbuf_free(refused_data);
+      TCP_EVENT_CLOSED(pcb, err);
+      if (err == ERR_ABRT) {
+        return ERR_ABRT;
+      }
+      if (err == ERR_MEM) {
+        tcp_keep_refused_fin(pcb);
+        return ERR_INPROGRESS;
+      }
+      return ERR_OK;
+    }
+/* GD modified end */
     TCP_EVENT_RECV(pcb, refused_data, ERR_OK, err);
     if (err == ERR_OK) {
       /* did refused_data include a FIN? */
@@ -1582,6 +1612,12 @@ tcp_process_refused_data(struct tcp_pcb *pcb)
         if (err == ERR_ABRT) {
           return ERR_ABRT;
         }
+/* GD modified */
+        if (err == ERR_MEM) {
+          tcp_keep_refused_fin(pcb);
+          return ERR_INPROGRESS;
+        }
+/* GD modified end */
       }
     } else if (err == ERR_ABRT) {
       /* if err == ERR_ABRT, 'pcb' is already deallocated */
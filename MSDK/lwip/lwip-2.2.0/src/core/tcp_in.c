@@ -542,6 +542,12 @@ tcp_input(struct pbuf *p, struct netif *inp)
             if (err == ERR_ABRT) {
               goto aborted;
             }
+/* GD modified */
+            if (err == ERR_MEM) {
+              /* the FIN is acked already, it must not get lost */
+              tcp_keep_refused_fin(pcb);
+            }
+/* GD modified end */
           }
         }
 
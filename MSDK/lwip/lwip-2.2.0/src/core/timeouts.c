@@ -123,6 +123,31 @@ static struct sys_timeo *next_timeout;
 
 static u32_t current_timeout_due_time;
 
+/* GD modified */
+#if LWIP_TIMERS_CYCLIC_ALIGN
+/**
+ * First expiry of a cyclic timer (re)started now: the next multiple of its
+ * interval, so that cyclic timers whose intervals divide each other expire
+ * together and the tcpip thread wakes up once for all of them.
+ */
+static u32_t
+lwip_cyclic_timer_first(u32_t interval_ms)
+{
+  u32_t now = sys_now();
+
+  return (u32_t)(now + interval_ms - (now % interval_ms));
+}
+#else
+#define lwip_cyclic_timer_first(interval_ms)  ((u32_t)(sys_now() + (interval_ms)))
+#endif /* LWIP_TIMERS_CYCLIC_ALIGN */
+
+#if LWIP_DEBUG_TIMERNAMES
+static void sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg, const char *handler_name);
+#else
+static void sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg);
+#endif
+/* GD modified end */
+
 #if LWIP_TESTMODE
 struct sys_timeo**
 sys_timeouts_get_next_timeout(void)
@@ -150,7 +175,13 @@ tcpip_tcp_timer(void *arg)
   /* timer still needed? */
   if (tcp_active_pcbs || tcp_tw_pcbs) {
     /* restart timer */
-    sys_timeout(TCP_TMR_INTERVAL, tcpip_tcp_timer, NULL);
+    /* GD modified */
+#if LWIP_DEBUG_TIMERNAMES
+    sys_timeout_abs(lwip_cyclic_timer_first(TCP_TMR_INTERVAL), tcpip_tcp_timer, NULL, "tcpip_tcp_timer");
+#else
+    sys_timeout_abs(lwip_cyclic_timer_first(TCP_TMR_INTERVAL), tcpip_tcp_timer, NULL);
+#endif
+    /* GD modified end */
   } else {
     /* disable timer */
     tcpip_tcp_timer_active = 0;
@@ -171,7 +202,13 @@ tcp_timer_needed(void)
   if (!tcpip_tcp_timer_active && (tcp_active_pcbs || tcp_tw_pcbs)) {
     /* enable and start timer */
     tcpip_tcp_timer_active = 1;
-    sys_timeout(TCP_TMR_INTERVAL, tcpip_tcp_timer, NULL);
+    /* GD modified */
+#if LWIP_DEBUG_TIMERNAMES
+    sys_timeout_abs(lwip_cyclic_timer_first(TCP_TMR_INTERVAL), tcpip_tcp_timer, NULL, "tcpip_tcp_timer");
+#else
+    sys_timeout_abs(lwip_cyclic_timer_first(TCP_TMR_INTERVAL), tcpip_tcp_timer, NULL);
+#endif
+    /* GD modified end */
   }
 }
 #endif /* LWIP_TCP */
@@ -244,11 +281,13 @@ lwip_cyclic_timer(void *arg)
   next_timeout_time = (u32_t)(current_timeout_due_time + cyclic->interval_ms);  /* overflow handled by TIME_LESS_THAN macro */
   if (TIME_LESS_THAN(next_timeout_time, now)) {
     /* timer would immediately expire again -> "overload" -> restart without any correction */
+    /* GD modified */
 #if LWIP_DEBUG_TIMERNAMES
-    sys_timeout_abs((u32_t)(now + cyclic->interval_ms), lwip_cyclic_timer, arg, cyclic->handler_name);
+    sys_timeout_abs(lwip_cyclic_timer_first(cyclic->interval_ms), lwip_cyclic_timer, arg, cyclic->handler_name);
 #else
-    sys_timeout_abs((u32_t)(now + cyclic->interval_ms), lwip_cyclic_timer, arg);
+    sys_timeout_abs(lwip_cyclic_timer_first(cyclic->interval_ms), lwip_cyclic_timer, arg);
 #endif
+    /* GD modified end */
 
   } else {
     /* correct cyclic interval with handler execution delay and sys_check_timeouts jitter */
@@ -268,7 +307,15 @@ void sys_timeouts_init(void)
   for (i = (LWIP_TCP ? 1 : 0); i < LWIP_ARRAYSIZE(lwip_cyclic_timers); i++) {
     /* we have to cast via size_t to get rid of const warning
       (this is OK as cyclic_timer() casts back to const* */
-    sys_timeout(lwip_cyclic_timers[i].interval_ms, lwip_cyclic_timer, LWIP_CONST_CAST(void *, &lwip_cyclic_timers[i]));
+    /* GD modified */
+#if LWIP_DEBUG_TIMERNAMES
+    sys_timeout_abs(lwip_cyclic_timer_first(lwip_cyclic_timers[i].interval_ms), lwip_cyclic_timer,
+                    LWIP_CONST_CAST(void *, &lwip_cyclic_timers[i]), lwip_cyclic_timers[i].handler_name);
+#else
+    sys_timeout_abs(lwip_cyclic_timer_first(lwip_cyclic_timers[i].interval_ms), lwip_cyclic_timer,
+                    LWIP_CONST_CAST(void *, &lwip_cyclic_timers[i]));
+#endif
+    /* GD modified end */
   }
 }
 
@@ -81,6 +81,17 @@ static u16_t udp_port = UDP_LOCAL_PORT_RANGE_START;
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+/* GD modified */
+#if UDP_PORT_HASH_SIZE
+#if (UDP_PORT_HASH_SIZE & (UDP_PORT_HASH_SIZE - 1)) != 0
+#error "UDP_PORT_HASH_SIZE must be a power of 2"
+#endif
+#define UDP_PORT_HASH(port) (((port) ^ ((port) >> 8)) & (UDP_PORT_HASH_SIZE - 1))
+/* pcbs on udp_pcbs per local port hash */
+static u16_t udp_port_hash[UDP_PORT_HASH_SIZE];
+#endif /* UDP_PORT_HASH_SIZE */
+/* GD modified end */
+
 /**
  * Initialize this module.
  */
@@ -237,6 +248,18 @@ udp_input(struct pbuf *p, struct netif *inp)
 
   udp_debug_print(udphdr);
 
+/* GD modified */
+#if UDP_PORT_HASH_SIZE
+  if ((udp_port_hash[UDP_PORT_HASH(dest)] == 0) &&
+      (broadcast || ip_addr_ismulticast(ip_current_dest_addr()))) {
+    /* no pcb on this port: the datagram cannot be for us, drop it
+       without walking the pcb list (no ICMP for broadcast/multicast) */
+    pbuf_free(p);
+    goto end;
+  }
+#endif /* UDP_PORT_HASH_SIZE */
+/* GD modified end */
+
   /* print the UDP source and destination */
   LWIP_DEBUGF(UDP_DEBUG, ("udp ("));
   ip_addr_debug_print_val(UDP_DEBUG, *ip_current_dest_addr());
@@ -1017,6 +1040,14 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
 
   ip_addr_set_ipaddr(&pcb->local_ip, ipaddr);
 
+/* GD modified */
+#if UDP_PORT_HASH_SIZE
+  if (rebind) {
+    udp_port_hash[UDP_PORT_HASH(pcb->local_port)]--;
+  }
+  udp_port_hash[UDP_PORT_HASH(port)]++;
+#endif /* UDP_PORT_HASH_SIZE */
+/* GD modified end */
   pcb->local_port = port;
   mib2_udp_bind(pcb);
   /* pcb not active yet? */
@@ -1138,6 +1169,11 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     }
   }
   /* PCB not yet on the list, add PCB now */
+/* GD modified */
+#if UDP_PORT_HASH_SIZE
+  udp_port_hash[UDP_PORT_HASH(pcb->local_port)]++;
+#endif /* UDP_PORT_HASH_SIZE */
+/* GD modified end */
   pcb->next = udp_pcbs;
   udp_pcbs = pcb;
   return ERR_OK;
@@ -1213,6 +1249,16 @@ udp_remove(struct udp_pcb *pcb)
   LWIP_ERROR("udp_remove: invalid pcb", pcb != NULL, return);
 
   mib2_udp_unbind(pcb);
+/* GD modified */
+#if UDP_PORT_HASH_SIZE
+  for (pcb2 = udp_pcbs; pcb2 != NULL; pcb2 = pcb2->next) {
+    if (pcb2 == pcb) {
+      udp_port_hash[UDP_PORT_HASH(pcb->local_port)]--;
+      break;
+    }
+  }
+#endif /* UDP_PORT_HASH_SIZE */
+/* GD modified end */
   /* pcb to be removed is first in list? */
   if (udp_pcbs == pcb) {
     /* make list start at 2nd pcb */
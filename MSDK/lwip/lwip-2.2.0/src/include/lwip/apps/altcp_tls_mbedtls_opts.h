@@ -106,6 +106,24 @@
 #define ALTCP_MBEDTLS_AUTHMODE                        MBEDTLS_SSL_VERIFY_OPTIONAL
 #endif
 
+/* GD modified */
+/** Maximum fragment length requested by clients (MBEDTLS_SSL_MAX_FRAG_LEN_xxx,
+ * needs MBEDTLS_SSL_MAX_FRAGMENT_LENGTH), MBEDTLS_SSL_MAX_FRAG_LEN_NONE to not ask.
+ * With MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH the record buffers are sized after it.
+ */
+#ifndef ALTCP_MBEDTLS_MAX_FRAG_LEN
+#define ALTCP_MBEDTLS_MAX_FRAG_LEN                    MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#endif
+
+/** Reduce the record buffers of an idle connection from the poll callback, which
+ * runs once the application has set a poll interval (needs
+ * MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH). They grow again on the next record.
+ */
+#ifndef ALTCP_MBEDTLS_SHRINK_IDLE_BUFFERS
+#define ALTCP_MBEDTLS_SHRINK_IDLE_BUFFERS             1
+#endif
+/* GD modified end */
+
 #endif /* LWIP_ALTCP */
 
 #endif /* LWIP_HDR_ALTCP_TLS_OPTS_H */
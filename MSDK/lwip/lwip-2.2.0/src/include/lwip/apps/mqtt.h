@@ -302,6 +302,7 @@ err_t mqtt_sub_unsub(mqtt_client_t *client, const char *topic, u8_t qos, mqtt_re
 /* GD modified */
 err_t mqtt_msg_publish(mqtt_client_t *client, const char *topic, const void *payload, u16_t payload_length, u8_t qos, u8_t retain,
                   mqtt_request_cb_t cb, void *arg);
+void mqtt_output_hold(mqtt_client_t *client, u8_t hold);
 void mqtt_output_append_u8(mqtt_ringbuf *rb, u8_t value);
 void mqtt_output_append_u16(mqtt_ringbuf *rb, u16_t value);
 void mqtt_output_append_buf(mqtt_ringbuf *rb, const void *data, u16_t length);
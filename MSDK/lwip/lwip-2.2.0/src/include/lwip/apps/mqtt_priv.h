@@ -113,6 +113,8 @@ struct mqtt_client_s
 #endif
   mqtt5_config_storage_t *mqtt5_config;
   bool run;
+  /** Publishes are appended to the output without being sent, @see mqtt_output_hold */
+  u8_t output_hold;
 /* GD modified end */
 };
 
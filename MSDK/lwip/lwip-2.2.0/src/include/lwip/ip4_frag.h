@@ -55,6 +55,47 @@ extern "C" {
 /* The IP reassembly timer interval in milliseconds. */
 #define IP_TMR_INTERVAL 1000
 
+/* GD modified */
+/**
+ * IP_REASS_MAX_PBUFS_PER_SRC: Maximum amount of pbufs waiting to be reassembled
+ * for one source address while other sources have fragments queued. When a
+ * source exceeds it, its oldest other datagrams are freed; a datagram that
+ * cannot fit alone is dropped at once instead of holding its pbufs until
+ * IP_REASS_MAXAGE. A lone source can use all of IP_REASS_MAX_PBUFS, so the
+ * largest datagram that can be reassembled does not depend on this quota.
+ */
+#ifndef IP_REASS_MAX_PBUFS_PER_SRC
+#define IP_REASS_MAX_PBUFS_PER_SRC      IP_REASS_MAX_PBUFS
+#endif
+
+/**
+ * IP_REASS_MAX_CUSTOM_PBUFS: Maximum amount of custom pbufs (driver RX buffers)
+ * held by the reassembly queue. Fragments received in custom pbufs beyond this
+ * are copied into PBUF_RAM and the driver buffers are released at once. If the
+ * copy fails, the oldest incomplete datagram holding custom pbufs is dropped.
+ */
+#ifndef IP_REASS_MAX_CUSTOM_PBUFS
+#define IP_REASS_MAX_CUSTOM_PBUFS       IP_REASS_MAX_PBUFS
+#endif
+
+struct ip_reass_stats {
+  /* pbufs and custom pbufs currently queued, highest custom count */
+  u16_t pbufs;
+  u16_t custom;
+  u16_t custom_peak;
+  /* fragments copied out of custom pbufs */
+  u32_t copied;
+  /* quota enforcements, each freeing one or more datagrams of a source */
+  u32_t src_drop;
+  /* datagrams dropped because a custom pbuf could not be copied */
+  u32_t pressure_drop;
+  /* fragments dropped because a custom pbuf could not be copied */
+  u32_t copy_fail;
+};
+
+void ip_reass_stats_get(struct ip_reass_stats *stats, int reset);
+/* GD modified end */
+
 /** IP reassembly helper struct.
  * This is exported because memp needs to know the size.
  */
@@ -65,6 +106,11 @@ struct ip_reassdata {
   u16_t datagram_len;
   u8_t flags;
   u8_t timer;
+/* GD modified */
+  /* pbufs and custom pbufs queued for this datagram */
+  u16_t clen;
+  u16_t custom;
+/* GD modified end */
 };
 
 void ip_reass_init(void);
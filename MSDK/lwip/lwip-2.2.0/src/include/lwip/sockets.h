@@ -231,6 +231,17 @@ struct ifreq {
 #define SO_BINDTODEVICE 0x100b /* bind to device */
 /* GD modified */
 #define SO_CONNINFO     0x100e /* Read Only, get pointer on connection info */
+
+/** LWIP_SOCKET_RECV_PBUF==1: enable lwip_recv_pbuf(), which lends the received
+ * pbuf chain to the caller instead of copying it into a user buffer */
+#ifndef LWIP_SOCKET_RECV_PBUF
+#define LWIP_SOCKET_RECV_PBUF           0
+#endif
+/** Maximum number of custom (driver owned) RX pbufs lent at the same time,
+ * chains above this are copied into PBUF_RAM before being lent */
+#ifndef LWIP_SOCKET_RECV_PBUF_LENT_MAX
+#define LWIP_SOCKET_RECV_PBUF_LENT_MAX  4
+#endif
 /* GD modified end */
 /*
  * Structure used for manipulating linger option.
@@ -611,6 +622,15 @@ ssize_t lwip_readv(int s, const struct iovec *iov, int iovcnt);
 ssize_t lwip_recvfrom(int s, void *mem, size_t len, int flags,
       struct sockaddr *from, socklen_t *fromlen);
 ssize_t lwip_recvmsg(int s, struct msghdr *message, int flags);
+/* GD modified */
+#if LWIP_SOCKET_RECV_PBUF
+ssize_t lwip_recv_pbuf(int s, struct pbuf **p, int flags);
+ssize_t lwip_recvfrom_pbuf(int s, struct pbuf **p, int flags,
+      struct sockaddr *from, socklen_t *fromlen);
+void lwip_recv_pbuf_free(int s, struct pbuf *p);
+void lwip_recv_pbuf_stats(u16_t *lent, u16_t *lent_peak, u32_t *cloned);
+#endif /* LWIP_SOCKET_RECV_PBUF */
+/* GD modified end */
 ssize_t lwip_send(int s, const void *dataptr, size_t size, int flags);
 ssize_t lwip_sendmsg(int s, const struct msghdr *message, int flags);
 ssize_t lwip_sendto(int s, const void *dataptr, size_t size, int flags,
@@ -58,6 +58,17 @@ extern "C" {
 #define UDP_FLAGS_CONNECTED      0x04U
 #define UDP_FLAGS_MULTICAST_LOOP 0x08U
 
+/* GD modified */
+/**
+ * UDP_PORT_HASH_SIZE: Number of buckets counting the pcbs bound per local port
+ * hash (power of 2). Broadcast and multicast datagrams to a port no pcb is
+ * bound to are dropped without walking the pcb list. 0 to disable.
+ */
+#ifndef UDP_PORT_HASH_SIZE
+#define UDP_PORT_HASH_SIZE 0
+#endif
+/* GD modified end */
+
 struct udp_pcb;
 
 /** Function prototype for udp pcb receive callback functions
@@ -2,6 +2,7 @@
 
 #include "lwip/icmp.h"
 #include "lwip/ip4.h"
+#include "lwip/ip4_frag.h"
 #include "lwip/etharp.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/stats.h"
@@ -109,6 +110,124 @@ create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
   }
 }
 
+/* Reassembly quota helpers: fragments come from 10.0.0.x, which has no route,
+   so datagrams dropped by ip4_reass() do not send ICMP time exceeded */
+#define REASS_FRAG_LEN 64
+
+struct reass_custom_buf {
+  struct pbuf_custom pc;
+  u8_t buf[IP_HLEN + 2 * REASS_FRAG_LEN];
+};
+
+static int reass_custom_alloced;
+static int reass_custom_freed;
+/* exhaust the heap while ip4_reass() runs */
+static int reass_heap_full;
+
+static void
+reass_custom_free(struct pbuf *p)
+{
+  reass_custom_freed++;
+  mem_free(p);
+}
+
+static u8_t
+reass_data_byte(u8_t src, u16_t ip_id, u16_t offset)
+{
+  return (u8_t)(src * 31 + ip_id * 7 + offset);
+}
+
+/* Feed ip4_reass() one fragment of datagram ip_id from 10.0.0.src, in a
+   custom pbuf (like a driver RX buffer) or in PBUF_RAM */
+static struct pbuf *
+reass_input(u8_t src, u16_t ip_id, u16_t start, u16_t len, int last, int custom)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  u16_t i;
+
+  fail_unless((start & 7) == 0);
+  fail_unless(len <= 2 * REASS_FRAG_LEN);
+  if (custom) {
+    struct reass_custom_buf *cb = (struct reass_custom_buf *)mem_malloc(sizeof(struct reass_custom_buf));
+    fail_unless(cb != NULL);
+    cb->pc.custom_free_function = reass_custom_free;
+    p = pbuf_alloced_custom(PBUF_RAW, (u16_t)(IP_HLEN + len), PBUF_REF, &cb->pc, cb->buf, sizeof(cb->buf));
+    reass_custom_alloced++;
+  } else {
+    p = pbuf_alloc(PBUF_RAW, (u16_t)(IP_HLEN + len), PBUF_RAM);
+  }
+  fail_unless(p != NULL);
+
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_TOS_SET(iphdr, 0);
+  IPH_LEN_SET(iphdr, lwip_htons(p->tot_len));
+  IPH_ID_SET(iphdr, lwip_htons(ip_id));
+  IPH_OFFSET_SET(iphdr, lwip_htons((start / 8) | (last ? 0 : IP_MF)));
+  IPH_TTL_SET(iphdr, 5);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  IPH_CHKSUM_SET(iphdr, 0);
+  iphdr->src.addr = lwip_htonl(LWIP_MAKEU32(10, 0, 0, src));
+  iphdr->dest.addr = PP_HTONL(LWIP_MAKEU32(10, 0, 0, 1));
+  for (i = 0; i < len; i++) {
+    ((u8_t *)p->payload)[IP_HLEN + i] = reass_data_byte(src, ip_id, (u16_t)(start + i));
+  }
+  if (reass_heap_full) {
+    void *hog[MEM_SIZE / 16];
+    struct pbuf *r;
+    int n = 0;
+
+    for (i = 256; i >= 16; i /= 2) {
+      while ((n < (int)LWIP_ARRAYSIZE(hog)) && ((hog[n] = mem_malloc(i)) != NULL)) {
+        n++;
+      }
+    }
+    r = ip4_reass(p);
+    while (n > 0) {
+      mem_free(hog[--n]);
+    }
+    return r;
+  }
+  return ip4_reass(p);
+}
+
+/* Check and free a datagram returned by ip4_reass() */
+static void
+reass_check_datagram(struct pbuf *p, u8_t src, u16_t ip_id, u16_t len)
+{
+  u16_t i, bad = 0;
+
+  fail_unless(p->tot_len == IP_HLEN + len);
+  for (i = 0; i < len; i++) {
+    if (pbuf_get_at(p, (u16_t)(IP_HLEN + i)) != reass_data_byte(src, ip_id, i)) {
+      bad++;
+    }
+  }
+  fail_unless(bad == 0);
+  pbuf_free(p);
+}
+
+/* Let every queued datagram time out */
+static void
+reass_flush(void)
+{
+  int i;
+
+  for (i = 0; i <= IP_REASS_MAXAGE; i++) {
+    ip_reass_tmr();
+  }
+}
+
+static u32_t reass_rand_state;
+
+static u32_t
+reass_rand(void)
+{
+  reass_rand_state = reass_rand_state * 1103515245UL + 12345UL;
+  return (reass_rand_state >> 16) & 0x7fff;
+}
+
 static err_t arpless_output(struct netif *netif, struct pbuf *p,
                             const ip4_addr_t *ipaddr) {
   LWIP_UNUSED_ARG(ipaddr);
@@ -234,6 +353,206 @@ START_TEST(test_ip4_reass)
 }
 END_TEST
 
+/* a source flooding incomplete datagrams cannot evict the others */
+START_TEST(test_ip4_reass_src_quota)
+{
+  struct ip_reass_stats st;
+  struct pbuf *p;
+  u16_t id;
+  LWIP_UNUSED_ARG(_i);
+
+  ip_reass_stats_get(NULL, 1);
+
+  /* 10.0.0.3 starts a datagram of 3 fragments */
+  fail_unless(reass_input(3, 1, 0, REASS_FRAG_LEN, 0, 0) == NULL);
+
+  /* 10.0.0.2 floods datagrams which never complete */
+  for (id = 1; id <= 20; id++) {
+    fail_unless(reass_input(2, id, 0, REASS_FRAG_LEN, 0, 0) == NULL);
+    fail_unless(reass_input(2, id, REASS_FRAG_LEN, REASS_FRAG_LEN, 0, 0) == NULL);
+    fail_unless(reass_input(2, id, 2 * REASS_FRAG_LEN, REASS_FRAG_LEN, 0, 0) == NULL);
+    ip_reass_stats_get(&st, 0);
+    fail_unless(st.pbufs <= IP_REASS_MAX_PBUFS_PER_SRC + 1);
+  }
+  fail_unless(st.src_drop > 0);
+
+  /* 10.0.0.3 still completes its datagram */
+  fail_unless(reass_input(3, 1, 2 * REASS_FRAG_LEN, REASS_FRAG_LEN, 1, 0) == NULL);
+  p = reass_input(3, 1, REASS_FRAG_LEN, REASS_FRAG_LEN, 0, 0);
+  fail_unless(p != NULL);
+  if (p != NULL) {
+    reass_check_datagram(p, 3, 1, 3 * REASS_FRAG_LEN);
+  }
+
+  /* while 10.0.0.2 has fragments queued, a datagram larger than the quota is
+     dropped as soon as it exceeds it */
+  ip_reass_stats_get(NULL, 1);
+  for (id = 0; id <= IP_REASS_MAX_PBUFS_PER_SRC; id++) {
+    fail_unless(reass_input(4, 100, (u16_t)(id * REASS_FRAG_LEN), REASS_FRAG_LEN, 0, 0) == NULL);
+  }
+  ip_reass_stats_get(&st, 0);
+  fail_unless(st.src_drop == 1);
+
+  reass_flush();
+  ip_reass_stats_get(&st, 1);
+  fail_unless(st.pbufs == 0);
+
+  /* a lone source can use the whole queue */
+  for (id = 0; id < IP_REASS_MAX_PBUFS - 1; id++) {
+    fail_unless(reass_input(7, 200, (u16_t)(id * REASS_FRAG_LEN), REASS_FRAG_LEN, 0, 0) == NULL);
+  }
+  p = reass_input(7, 200, (u16_t)(id * REASS_FRAG_LEN), REASS_FRAG_LEN, 1, 0);
+  fail_unless(p != NULL);
+  if (p != NULL) {
+    reass_check_datagram(p, 7, 200, (u16_t)(IP_REASS_MAX_PBUFS * REASS_FRAG_LEN));
+  }
+  ip_reass_stats_get(&st, 0);
+  fail_unless(st.src_drop == 0);
+
+  /* the quota applies again once another source queues a fragment */
+  for (id = 0; id < IP_REASS_MAX_PBUFS_PER_SRC; id++) {
+    fail_unless(reass_input(7, 201, (u16_t)(id * REASS_FRAG_LEN), REASS_FRAG_LEN, 0, 0) == NULL);
+  }
+  fail_unless(reass_input(8, 1, 0, REASS_FRAG_LEN, 0, 0) == NULL);
+  fail_unless(reass_input(7, 201, (u16_t)(id * REASS_FRAG_LEN), REASS_FRAG_LEN, 0, 0) == NULL);
+  ip_reass_stats_get(&st, 0);
+  fail_unless(st.src_drop == 1);
+  fail_unless(st.pbufs == 1);
+
+  reass_flush();
+  ip_reass_stats_get(&st, 1);
+  fail_unless(st.pbufs == 0);
+}
+END_TEST
+
+/* fragments in driver buffers beyond IP_REASS_MAX_CUSTOM_PBUFS are copied */
+START_TEST(test_ip4_reass_custom_copy)
+{
+  const u16_t nfrags = IP_REASS_MAX_CUSTOM_PBUFS + 2;
+  struct ip_reass_stats st;
+  struct pbuf *p;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  reass_custom_alloced = 0;
+  reass_custom_freed = 0;
+  ip_reass_stats_get(NULL, 1);
+
+  for (i = 0; i < nfrags - 1; i++) {
+    fail_unless(reass_input(5, 7, (u16_t)(i * REASS_FRAG_LEN), REASS_FRAG_LEN, 0, 1) == NULL);
+  }
+  ip_reass_stats_get(&st, 0);
+  fail_unless(st.custom == IP_REASS_MAX_CUSTOM_PBUFS);
+  fail_unless(st.copied == (u32_t)(nfrags - 1 - IP_REASS_MAX_CUSTOM_PBUFS));
+  /* the copied driver buffers were released at once */
+  fail_unless(reass_custom_freed == nfrags - 1 - IP_REASS_MAX_CUSTOM_PBUFS);
+
+  p = reass_input(5, 7, (u16_t)((nfrags - 1) * REASS_FRAG_LEN), REASS_FRAG_LEN, 1, 1);
+  fail_unless(p != NULL);
+  if (p != NULL) {
+    reass_check_datagram(p, 5, 7, (u16_t)(nfrags * REASS_FRAG_LEN));
+  }
+  fail_unless(reass_custom_freed == reass_custom_alloced);
+
+  ip_reass_stats_get(&st, 1);
+  fail_unless(st.pbufs == 0);
+  fail_unless(st.custom == 0);
+  fail_unless(st.custom_peak == IP_REASS_MAX_CUSTOM_PBUFS);
+
+  /* without memory for the copy, the oldest datagram holding driver buffers
+     is given up for the new fragment */
+  for (i = 0; i < IP_REASS_MAX_CUSTOM_PBUFS; i++) {
+    fail_unless(reass_input(5, 8, (u16_t)(i * REASS_FRAG_LEN), REASS_FRAG_LEN, 0, 1) == NULL);
+  }
+  reass_heap_full = 1;
+  fail_unless(reass_input(6, 9, 0, REASS_FRAG_LEN, 0, 1) == NULL);
+  reass_heap_full = 0;
+  ip_reass_stats_get(&st, 1);
+  fail_unless(st.pressure_drop == 1);
+  fail_unless(st.copied == 0);
+  fail_unless(st.custom == 1);
+  fail_unless(reass_custom_freed == reass_custom_alloced - 1);
+
+  reass_flush();
+  fail_unless(reass_custom_freed == reass_custom_alloced);
+}
+END_TEST
+
+/* random fragments from several sources: out of order, duplicated, overlapping,
+   in driver buffers or not; the limits hold and nothing leaks */
+START_TEST(test_ip4_reass_fuzz)
+{
+#define REASS_FUZZ_SRCS   4
+#define REASS_FUZZ_SLOTS  2
+  struct {
+    u16_t ip_id;
+    u16_t nfrags;
+    u16_t sent;
+  } slots[REASS_FUZZ_SRCS][REASS_FUZZ_SLOTS];
+  struct ip_reass_stats st;
+  u16_t next_id = 1;
+  int i, s, k, done = 0;
+  LWIP_UNUSED_ARG(_i);
+
+  reass_rand_state = 0x4c57;
+  reass_custom_alloced = 0;
+  reass_custom_freed = 0;
+  ip_reass_stats_get(NULL, 1);
+  for (s = 0; s < REASS_FUZZ_SRCS; s++) {
+    for (k = 0; k < REASS_FUZZ_SLOTS; k++) {
+      slots[s][k].ip_id = next_id++;
+      slots[s][k].nfrags = (u16_t)(2 + reass_rand() % 6);
+      slots[s][k].sent = 0;
+    }
+  }
+
+  for (i = 0; i < 20000; i++) {
+    struct pbuf *p;
+    u16_t idx, len;
+    u8_t src;
+
+    s = (int)(reass_rand() % REASS_FUZZ_SRCS);
+    k = (int)(reass_rand() % REASS_FUZZ_SLOTS);
+    src = (u8_t)(2 + s);
+    idx = (u16_t)(reass_rand() % slots[s][k].nfrags);
+    len = REASS_FRAG_LEN;
+    if ((idx + 2 < slots[s][k].nfrags) && ((reass_rand() % 8) == 0)) {
+      /* overlaps the next fragment */
+      len = 2 * REASS_FRAG_LEN;
+    }
+    p = reass_input(src, slots[s][k].ip_id, (u16_t)(idx * REASS_FRAG_LEN), len,
+                    (idx * REASS_FRAG_LEN + len) == (slots[s][k].nfrags * REASS_FRAG_LEN),
+                    (int)(reass_rand() % 2));
+    if (p != NULL) {
+      reass_check_datagram(p, src, slots[s][k].ip_id, (u16_t)(slots[s][k].nfrags * REASS_FRAG_LEN));
+      done++;
+    }
+    if ((p != NULL) || (++slots[s][k].sent > 3 * slots[s][k].nfrags)) {
+      /* start a new datagram, an abandoned one is left to the timer */
+      slots[s][k].ip_id = next_id++;
+      slots[s][k].nfrags = (u16_t)(2 + reass_rand() % 6);
+      slots[s][k].sent = 0;
+    }
+    if ((reass_rand() % 64) == 0) {
+      ip_reass_tmr();
+    }
+
+    ip_reass_stats_get(&st, 0);
+    fail_unless(st.pbufs <= IP_REASS_MAX_PBUFS);
+    fail_unless(st.custom <= IP_REASS_MAX_CUSTOM_PBUFS);
+    /* every driver buffer is either queued or released */
+    fail_unless(reass_custom_alloced - reass_custom_freed == st.custom);
+  }
+  fail_unless(done > 200);
+
+  reass_flush();
+  ip_reass_stats_get(&st, 1);
+  fail_unless(st.pbufs == 0);
+  fail_unless(st.custom == 0);
+  fail_unless(reass_custom_freed == reass_custom_alloced);
+}
+END_TEST
+
 /* packets to 127.0.0.1 shall not be sent out to netif_default */
 START_TEST(test_127_0_0_1)
 {
@@ -333,6 +652,9 @@ ip4_suite(void)
   testfunc tests[] = {
     TESTFUNC(test_ip4_frag),
     TESTFUNC(test_ip4_reass),
+    TESTFUNC(test_ip4_reass_src_quota),
+    TESTFUNC(test_ip4_reass_custom_copy),
+    TESTFUNC(test_ip4_reass_fuzz),
     TESTFUNC(test_127_0_0_1),
     TESTFUNC(test_ip4addr_aton),
     TESTFUNC(test_ip4_icmp_replylen_short),
@@ -85,6 +85,14 @@
 /* MIB2 stats are required to check IPv4 reassembly results */
 #define MIB2_STATS                      1
 
+/* IPv4 reassembly limits checked by the reassembly quota tests */
+#define IP_REASS_MAX_PBUFS              12
+#define IP_REASS_MAX_PBUFS_PER_SRC      9
+#define IP_REASS_MAX_CUSTOM_PBUFS       4
+
+/* Drop broadcast/multicast UDP to unbound ports before the pcb scan */
+#define UDP_PORT_HASH_SIZE              8
+
 /* netif tests want to test this, so enable: */
 #define LWIP_NETIF_EXT_STATUS_CALLBACK  1
 
@@ -335,6 +335,63 @@ START_TEST(test_udp_broadcast_rx_with_2_netifs)
 }
 END_TEST
 
+#if UDP_PORT_HASH_SIZE
+/* broadcasts to ports without pcb are dropped early, the port hash follows
+   bind, rebind and remove */
+START_TEST(test_udp_port_hash_rx)
+{
+  err_t err;
+  struct udp_pcb *pcb;
+  const u16_t port = 12345;
+  /* same hash bucket as port */
+  const u16_t port_same_hash = port + 0x800;
+  const u16_t port2 = port + 1;
+  struct test_udp_rxdata ctr;
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb = udp_new();
+  fail_unless(pcb != NULL);
+  memset(&ctr, 0, sizeof(ctr));
+  ctr.pcb = pcb;
+  udp_recv(pcb, test_recv, &ctr);
+  err = udp_bind(pcb, NULL, port);
+  fail_unless(err == ERR_OK);
+
+  p = test_udp_create_test_packet(16, port, 0xffffffff);
+  EXPECT_RET(p != NULL);
+  fail_unless(ip4_input(p, &test_netif1) == ERR_OK);
+  fail_unless(ctr.rx_cnt == 1);
+
+  p = test_udp_create_test_packet(16, port_same_hash, 0xffffffff);
+  EXPECT_RET(p != NULL);
+  fail_unless(ip4_input(p, &test_netif1) == ERR_OK);
+  p = test_udp_create_test_packet(16, port2, 0xffffffff);
+  EXPECT_RET(p != NULL);
+  fail_unless(ip4_input(p, &test_netif1) == ERR_OK);
+  fail_unless(ctr.rx_cnt == 1);
+
+  /* rebind to another port */
+  err = udp_bind(pcb, NULL, port2);
+  fail_unless(err == ERR_OK);
+  p = test_udp_create_test_packet(16, port, 0xffffffff);
+  EXPECT_RET(p != NULL);
+  fail_unless(ip4_input(p, &test_netif1) == ERR_OK);
+  fail_unless(ctr.rx_cnt == 1);
+  p = test_udp_create_test_packet(16, port2, 0xffffffff);
+  EXPECT_RET(p != NULL);
+  fail_unless(ip4_input(p, &test_netif1) == ERR_OK);
+  fail_unless(ctr.rx_cnt == 2);
+
+  udp_remove(pcb);
+  p = test_udp_create_test_packet(16, port2, 0xffffffff);
+  EXPECT_RET(p != NULL);
+  fail_unless(ip4_input(p, &test_netif1) == ERR_OK);
+  fail_unless(ctr.rx_cnt == 2);
+}
+END_TEST
+#endif /* UDP_PORT_HASH_SIZE */
+
 START_TEST(test_udp_bind)
 {
   struct udp_pcb* pcb1;
@@ -466,6 +523,9 @@ udp_suite(void)
   testfunc tests[] = {
     TESTFUNC(test_udp_new_remove),
     TESTFUNC(test_udp_broadcast_rx_with_2_netifs),
+#if UDP_PORT_HASH_SIZE
+    TESTFUNC(test_udp_port_hash_rx),
+#endif
     TESTFUNC(test_udp_bind)
   };
   return create_suite("UDP", tests, sizeof(tests)/sizeof(testfunc), udp_setup, udp_teardown);
@@ -41,21 +41,305 @@ OF SUCH DAMAGE.
 
 #define SNTP_SERVER_0       "cn.pool.ntp.org"
 
+/* NTP era 1 starts at 2036-02-07 06:28:16 UTC, lwIP hands out timestamps relative to it */
+#define NTP_DIFF_SEC_1970_2036      ((uint32_t)2085978496UL)
+
 int sntp_timezone = 0;
-uint64_t sntp_update_local_time = 0;
-uint32_t sntp_update_time = 0;
 uint32_t sntp_update_intv = 86400;
 
 #define SNTP_SERVER_USER_NUM 3
 char *sntp_server_s[SNTP_SERVER_USER_NUM] = {NULL, NULL, NULL};
 
+struct sntp_clk_sample {
+    uint64_t local_us;                  // local counter when the sample was taken
+    int64_t raw_offset_us;              // server time minus local counter
+    uint32_t delay_us;                  // round trip delay of the sample
+};
+
+/*
+ * Disciplined clock: utc = base_utc + dt + dt * freq + slew(dt), dt = local - base_local.
+ * The phase offset of every update is slewed at no more than SNTP_CLK_SLEW_MAX_PPM,
+ * the frequency is a least squares fit over the last SNTP_CLK_FLL_SAMPLES raw offsets.
+ */
+struct sntp_clock {
+    uint64_t base_local_us;             // local counter at the last update
+    uint64_t base_utc_us;               // disciplined utc at base_local_us
+    uint64_t last_read_us;              // last utc handed out, keeps the clock monotonic
+    uint64_t get_local_us;              // local counter when lwIP last read the clock
+    uint64_t prev_get_local_us;         // the read before that, i.e. the request transmit time
+    int64_t slew_us;                    // phase offset to be slewed from base_local_us
+    int64_t rtt_delay_us;               // round trip delay reported by lwIP for this response
+    int32_t freq_ppb;
+    int32_t last_offset_us;
+    uint32_t delay_us;
+    uint32_t min_delay_us;
+    uint32_t jitter_us;
+    uint32_t update_cnt;
+    uint32_t step_cnt;
+    uint32_t popcorn_cnt;
+    uint8_t synced;
+    uint8_t freq_locked;
+    uint8_t rtt_valid;
+    uint8_t popcorn_run;
+    uint8_t nsample;
+    uint8_t sample_idx;
+    struct sntp_clk_sample sample[SNTP_CLK_FLL_SAMPLES];
+};
+
+static struct sntp_clock sntp_clk;
+
 extern uint64_t get_sys_local_time_us();
-// Redefine SNTP_SET_SYSTEM_TIME for debug
-void sntp_set_system_time(uint32_t sec)
+
+/*!
+    \brief      disciplined utc of a local counter value
+    \param[in]  clk: pointer to the clock state
+    \param[in]  local_us: local counter value in microseconds
+    \param[out] none
+    \retval     utc in microseconds since 1970
+*/
+static uint64_t sntp_clk_at(const struct sntp_clock *clk, uint64_t local_us)
+{
+    int64_t dt = (int64_t)(local_us - clk->base_local_us);
+    int64_t slew_max = dt * SNTP_CLK_SLEW_MAX_PPM / 1000000;
+    int64_t slew = clk->slew_us;
+
+    if (slew > slew_max) {
+        slew = slew_max;
+    } else if (slew < -slew_max) {
+        slew = -slew_max;
+    }
+
+    return clk->base_utc_us + dt + dt * clk->freq_ppb / 1000000000 + slew;
+}
+
+/*!
+    \brief      phase offset not slewed yet
+    \param[in]  clk: pointer to the clock state
+    \param[in]  local_us: local counter value in microseconds
+    \param[out] none
+    \retval     remaining offset in microseconds
+*/
+static int64_t sntp_clk_slew_remain(const struct sntp_clock *clk, uint64_t local_us)
+{
+    int64_t dt = (int64_t)(local_us - clk->base_local_us);
+    int64_t slew_max = dt * SNTP_CLK_SLEW_MAX_PPM / 1000000;
+
+    if (clk->slew_us > slew_max) {
+        return clk->slew_us - slew_max;
+    } else if (clk->slew_us < -slew_max) {
+        return clk->slew_us + slew_max;
+    }
+
+    return 0;
+}
+
+/*!
+    \brief      update the frequency estimate from the raw offset samples
+    \param[in]  clk: pointer to the clock state
+    \param[out] none
+    \retval     none
+*/
+static void sntp_clk_freq_update(struct sntp_clock *clk)
 {
-    sntp_update_local_time = get_sys_local_time_us();
+    const struct sntp_clk_sample *s0, *s;
+    double mx = 0, my = 0, sxx = 0, sxy = 0, x, y, slope, resid = 0;
+    uint64_t span;
+    uint8_t i, oldest;
 
-    sntp_update_time = sec;
+    if (clk->nsample < 3) {
+        return;
+    }
+
+    oldest = (clk->nsample < SNTP_CLK_FLL_SAMPLES) ? 0 : clk->sample_idx;
+    s0 = &clk->sample[oldest];
+    span = clk->sample[(clk->sample_idx + SNTP_CLK_FLL_SAMPLES - 1) % SNTP_CLK_FLL_SAMPLES].local_us - s0->local_us;
+    if (span < (uint64_t)SNTP_CLK_FLL_MIN_SPAN_S * 1000000) {
+        return;
+    }
+
+    /* Work relative to the oldest sample to keep the doubles well conditioned */
+    for (i = 0; i < clk->nsample; i++) {
+        s = &clk->sample[i];
+        mx += (double)(int64_t)(s->local_us - s0->local_us);
+        my += (double)(s->raw_offset_us - s0->raw_offset_us);
+    }
+    mx /= clk->nsample;
+    my /= clk->nsample;
+    for (i = 0; i < clk->nsample; i++) {
+        s = &clk->sample[i];
+        x = (double)(int64_t)(s->local_us - s0->local_us) - mx;
+        y = (double)(s->raw_offset_us - s0->raw_offset_us) - my;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    slope = sxy / sxx;
+    for (i = 0; i < clk->nsample; i++) {
+        s = &clk->sample[i];
+        x = (double)(int64_t)(s->local_us - s0->local_us) - mx;
+        y = (double)(s->raw_offset_us - s0->raw_offset_us) - my;
+        resid += (y > slope * x) ? (y - slope * x) : (slope * x - y);
+    }
+
+    slope *= 1e9;
+    if (slope > SNTP_CLK_FREQ_MAX_PPB) {
+        slope = SNTP_CLK_FREQ_MAX_PPB;
+    } else if (slope < -SNTP_CLK_FREQ_MAX_PPB) {
+        slope = -SNTP_CLK_FREQ_MAX_PPB;
+    }
+    clk->freq_ppb = (int32_t)slope;
+    clk->jitter_us = (uint32_t)(resid / clk->nsample);
+    clk->freq_locked = 1;
+}
+
+/*!
+    \brief      lwIP hook: read the disciplined clock as an NTP timestamp
+    \param[in]  none
+    \param[out] sec: seconds relative to NTP era 1
+    \param[out] frac: fraction of second in 1/2^32 units
+    \retval     none
+*/
+void sntp_get_system_time_ntp(int32_t *sec, uint32_t *frac)
+{
+    uint64_t local_us = get_sys_local_time_us();
+    uint64_t utc_us;
+    uint32_t usec;
+
+    sys_enter_critical();
+    sntp_clk.prev_get_local_us = sntp_clk.get_local_us;
+    sntp_clk.get_local_us = local_us;
+    sntp_clk.rtt_valid = 0;
+    /* Before the first update hand out the uptime, far enough from now for lwIP to skip compensation */
+    utc_us = sntp_clk.synced ? sntp_clk_at(&sntp_clk, local_us) : local_us;
+    sys_exit_critical();
+
+    usec = (uint32_t)(utc_us % 1000000);
+    *sec = (int32_t)((uint32_t)(utc_us / 1000000) - NTP_DIFF_SEC_1970_2036);
+    *frac = usec * 4295 - ((usec * 2143) >> 16) + 2147;
+}
+
+/*!
+    \brief      lwIP hook: round trip delay of the response being processed
+    \param[in]  delay: (t4 - t1) - (t3 - t2) as 32.32 fixed point seconds
+    \param[out] none
+    \retval     none
+*/
+void sntp_set_roundtrip_delay(int64_t delay)
+{
+    if (delay < 0) {
+        delay = 0;
+    }
+
+    sys_enter_critical();
+    sntp_clk.rtt_delay_us = (int64_t)(((uint64_t)delay * 1000000) >> 32);
+    sntp_clk.rtt_valid = 1;
+    sys_exit_critical();
+}
+
+/*!
+    \brief      lwIP hook: server time received, discipline the local clock
+    \param[in]  sec: seconds relative to NTP era 1, round trip compensated when possible
+    \param[in]  frac: fraction of second in 1/2^32 units
+    \param[out] none
+    \retval     none
+*/
+void sntp_set_system_time_ntp(int32_t sec, uint32_t frac)
+{
+    struct sntp_clock *clk = &sntp_clk;
+    struct sntp_clk_sample *s;
+    uint64_t server_us, local_us;
+    int64_t offset, delay;
+    uint8_t i;
+
+    server_us = (uint64_t)(uint32_t)((uint32_t)sec + NTP_DIFF_SEC_1970_2036) * 1000000 +
+                (((uint64_t)frac * 1000000) >> 32);
+
+    sys_enter_critical();
+    if (clk->get_local_us == 0) {
+        clk->get_local_us = get_sys_local_time_us();
+    }
+    local_us = clk->get_local_us;
+    if (clk->rtt_valid) {
+        /* lwIP already moved the server time to the receive instant */
+        delay = clk->rtt_delay_us;
+    } else if (clk->prev_get_local_us && (clk->prev_get_local_us < local_us)) {
+        /* Compensation skipped: the request was sent at the previous read of the clock */
+        delay = (int64_t)(local_us - clk->prev_get_local_us);
+        server_us += delay / 2;
+    } else {
+        delay = 0;
+    }
+    clk->rtt_valid = 0;
+
+    /* Popcorn filter: drop a sample whose path was far slower than usual, unless it keeps happening */
+    if (clk->synced && clk->min_delay_us && (delay > 2 * (int64_t)clk->min_delay_us) &&
+        (delay - clk->min_delay_us > SNTP_CLK_POPCORN_US) && (clk->popcorn_run < SNTP_CLK_POPCORN_RUN)) {
+        clk->popcorn_run++;
+        clk->popcorn_cnt++;
+        sys_exit_critical();
+        return;
+    }
+    clk->popcorn_run = 0;
+
+    offset = (int64_t)(server_us - sntp_clk_at(clk, local_us));
+    if (!clk->synced || (offset > SNTP_CLK_STEP_THRESHOLD_US) || (offset < -SNTP_CLK_STEP_THRESHOLD_US)) {
+        if (clk->synced) {
+            clk->step_cnt++;
+        }
+        clk->base_utc_us = server_us;
+        clk->slew_us = 0;
+        clk->last_read_us = 0;
+        clk->nsample = 0;
+        clk->sample_idx = 0;
+        clk->freq_locked = 0;
+        clk->synced = 1;
+    } else {
+        /* Rebase at the receive instant and slew the whole offset from there */
+        clk->base_utc_us = sntp_clk_at(clk, local_us);
+        clk->slew_us = offset;
+    }
+    clk->base_local_us = local_us;
+    clk->last_offset_us = (int32_t)offset;
+    clk->delay_us = (uint32_t)delay;
+    clk->update_cnt++;
+
+    s = &clk->sample[clk->sample_idx];
+    s->local_us = local_us;
+    s->raw_offset_us = (int64_t)(server_us - local_us);
+    s->delay_us = (uint32_t)delay;
+    clk->sample_idx = (clk->sample_idx + 1) % SNTP_CLK_FLL_SAMPLES;
+    if (clk->nsample < SNTP_CLK_FLL_SAMPLES) {
+        clk->nsample++;
+    }
+    /* The reference delay follows the recent samples so that a changed path is learned */
+    clk->min_delay_us = (uint32_t)delay;
+    for (i = 0; i < clk->nsample; i++) {
+        if (clk->sample[i].delay_us < clk->min_delay_us) {
+            clk->min_delay_us = clk->sample[i].delay_us;
+        }
+    }
+    sys_exit_critical();
+
+    /* The fit works on the raw offsets only, the clock state is swapped in one go */
+    {
+        struct sntp_clock tmp;
+
+        sys_enter_critical();
+        sys_memcpy(&tmp, clk, sizeof(tmp));
+        sys_exit_critical();
+        sntp_clk_freq_update(&tmp);
+        if (tmp.freq_locked) {
+            sys_enter_critical();
+            /* Keep the clock continuous across the frequency change */
+            local_us = get_sys_local_time_us();
+            clk->base_utc_us = sntp_clk_at(clk, local_us);
+            clk->slew_us = sntp_clk_slew_remain(clk, local_us);
+            clk->base_local_us = local_us;
+            clk->freq_ppb = tmp.freq_ppb;
+            clk->jitter_us = tmp.jitter_us;
+            clk->freq_locked = 1;
+            sys_exit_critical();
+        }
+    }
 
 #ifdef CONFIG_ATCMD
 extern void at_cip_sntp_update_time_succ(void);
@@ -63,6 +347,90 @@ extern void at_cip_sntp_update_time_succ(void);
 #endif
 }
 
+/*!
+    \brief      get the disciplined utc time
+    \param[in]  none
+    \param[out] utc_us: microseconds since 1970-01-01 00:00:00 UTC
+    \retval     0 on success, -1 if the clock was never synchronized
+*/
+int sntp_get_time_us(uint64_t *utc_us)
+{
+    uint64_t t;
+
+    sys_enter_critical();
+    if (!sntp_clk.synced) {
+        sys_exit_critical();
+        return -1;
+    }
+    t = sntp_clk_at(&sntp_clk, get_sys_local_time_us());
+    if (t < sntp_clk.last_read_us) {
+        t = sntp_clk.last_read_us;
+    }
+    sntp_clk.last_read_us = t;
+    sys_exit_critical();
+
+    *utc_us = t;
+    return 0;
+}
+
+/*!
+    \brief      get the current bound on the error of the disciplined clock
+    \param[in]  none
+    \param[out] err_us: error bound in microseconds
+    \retval     0 on success, -1 if the clock was never synchronized
+*/
+int sntp_get_error_bound_us(uint32_t *err_us)
+{
+    sntp_clock_stats_t stats;
+
+    sntp_get_clock_stats(&stats);
+    if (!stats.synced) {
+        return -1;
+    }
+    *err_us = stats.err_bound_us;
+
+    return 0;
+}
+
+/*!
+    \brief      get the state of the disciplined clock
+    \param[in]  none
+    \param[out] stats: pointer to the statistics
+    \retval     none
+*/
+void sntp_get_clock_stats(sntp_clock_stats_t *stats)
+{
+    uint64_t local_us = get_sys_local_time_us();
+    uint64_t since_us, err;
+    int64_t remain;
+
+    sys_memset(stats, 0, sizeof(*stats));
+
+    sys_enter_critical();
+    stats->synced = sntp_clk.synced;
+    stats->freq_locked = sntp_clk.freq_locked;
+    stats->update_cnt = sntp_clk.update_cnt;
+    stats->step_cnt = sntp_clk.step_cnt;
+    stats->popcorn_cnt = sntp_clk.popcorn_cnt;
+    stats->last_offset_us = sntp_clk.last_offset_us;
+    stats->last_delay_us = sntp_clk.delay_us;
+    stats->min_delay_us = sntp_clk.min_delay_us;
+    stats->freq_ppb = sntp_clk.freq_ppb;
+    stats->jitter_us = sntp_clk.jitter_us;
+    if (sntp_clk.synced) {
+        since_us = local_us - sntp_clk.base_local_us;
+        remain = sntp_clk_slew_remain(&sntp_clk, local_us);
+        stats->slew_remain_us = (int32_t)remain;
+        stats->since_update_s = (uint32_t)(since_us / 1000000);
+
+        /* Half the round trip, the fit scatter, the phase still to be slewed and the drift since */
+        err = sntp_clk.delay_us / 2 + sntp_clk.jitter_us + (uint64_t)(remain < 0 ? -remain : remain);
+        err += since_us * (sntp_clk.freq_locked ? SNTP_CLK_WANDER_PPM : SNTP_CLK_XTAL_TOL_PPM) / 1000000;
+        stats->err_bound_us = (err > 0xffffffff) ? 0xffffffff : (uint32_t)err;
+    }
+    sys_exit_critical();
+}
+
 int timezone_parse(char *argv, int *timezone)
 {
     char *str = argv;
@@ -132,19 +500,16 @@ int sntp_get_timezone(void)
 
 int sntp_get_time(char *buf, uint32_t buf_len)
 {
-    uint64_t local_time;
-    uint32_t diff_time;
+    uint64_t utc_us;
 
     struct tm current_time_val;
     time_t current_time;
 
-    if (!sntp_enabled() || (sntp_update_time == 0)) {
+    if (!sntp_enabled() || sntp_get_time_us(&utc_us)) {
         return -1;
     }
 
-    local_time = get_sys_local_time_us();
-    diff_time = ((local_time - sntp_update_local_time) / 1000000) & 0xffffffff;
-    current_time = (time_t)(sntp_update_time + diff_time + sntp_timezone);
+    current_time = (time_t)(utc_us / 1000000 + sntp_timezone);
     localtime_r(&current_time, &current_time_val);
     strftime(buf, buf_len, "%Y-%m-%d %A %H:%M:%S", &current_time_val);
 
@@ -210,6 +575,7 @@ int sntp_enable(int timezone, char *server_1,  char *server_2, char *server_3)
 
 void sntp_disable(void)
 {
+    int32_t freq_ppb;
     uint8_t i;
 
     for (i = 1; i < SNTP_SERVER_USER_NUM; i++) {
@@ -220,7 +586,13 @@ void sntp_disable(void)
         }
     }
     sntp_stop();
-    sntp_update_time = 0;
+
+    /* Forget the phase but keep the oscillator frequency for the next start */
+    sys_enter_critical();
+    freq_ppb = sntp_clk.freq_ppb;
+    sys_memset(&sntp_clk, 0, sizeof(sntp_clk));
+    sntp_clk.freq_ppb = freq_ppb;
+    sys_exit_critical();
 }
 
 #endif /* CONFIG_SNTP */
@@ -37,6 +37,41 @@ OF SUCH DAMAGE.
 
 #include "lwip/apps/sntp.h"
 
+/* Offsets larger than this are stepped, smaller ones are slewed */
+#define SNTP_CLK_STEP_THRESHOLD_US      128000
+/* Maximum rate at which a phase offset is slewed */
+#define SNTP_CLK_SLEW_MAX_PPM           500
+/* Limit of the frequency correction */
+#define SNTP_CLK_FREQ_MAX_PPB           500000
+/* Oscillator tolerance assumed until the frequency is estimated */
+#define SNTP_CLK_XTAL_TOL_PPM           50
+/* Frequency wander assumed once the frequency is estimated */
+#define SNTP_CLK_WANDER_PPM             5
+/* Number of updates the frequency is fitted over */
+#define SNTP_CLK_FLL_SAMPLES            8
+/* Minimum time covered by the samples before the fit is used */
+#define SNTP_CLK_FLL_MIN_SPAN_S         60
+/* Extra round trip delay above which a response is considered an outlier */
+#define SNTP_CLK_POPCORN_US             2000
+/* Consecutive outliers after which the slower path is accepted */
+#define SNTP_CLK_POPCORN_RUN            4
+
+typedef struct {
+    uint8_t synced;                     // at least one update was applied
+    uint8_t freq_locked;                // the frequency estimate is in use
+    uint32_t update_cnt;                // updates applied
+    uint32_t step_cnt;                  // updates that stepped the clock after the first one
+    uint32_t popcorn_cnt;               // responses dropped for an outlying round trip delay
+    int32_t last_offset_us;             // offset measured by the last update
+    uint32_t last_delay_us;             // round trip delay of the last update
+    uint32_t min_delay_us;              // smallest recent round trip delay
+    int32_t freq_ppb;                   // frequency correction of the local oscillator
+    uint32_t jitter_us;                 // mean residual of the frequency fit
+    int32_t slew_remain_us;             // phase offset not slewed yet
+    uint32_t since_update_s;            // seconds since the last update
+    uint32_t err_bound_us;              // current error bound
+} sntp_clock_stats_t;
+
 int sntp_enable(int timezone, char *server_1,  char *server_2, char *server_3);
 
 void sntp_disable(void);
@@ -49,4 +84,10 @@ void sntp_set_update_intv(uint32_t interval_ms);
 
 int timezone_parse(char *argv, int *timezone);
 
+int sntp_get_time_us(uint64_t *utc_us);
+
+int sntp_get_error_bound_us(uint32_t *err_us);
+
+void sntp_get_clock_stats(sntp_clock_stats_t *stats);
+
 #endif /* _SNTP_DEMO_H_ */
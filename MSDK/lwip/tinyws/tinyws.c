@@ -468,12 +468,78 @@ int ws_session_connect(struct ws_session *ws)
     return 0;
 }
 
+/*
+ * Mask (or unmask) len bytes from src to dst, which may be the same buffer.
+ * phase is the offset of src[0] in the frame payload, so that a payload
+ * handled in several pieces keeps the key in step. Whole words are masked
+ * once dst is aligned, the key being rotated to the phase of that word.
+ */
+static void ws_mask_copy(uint8_t *dst, const uint8_t *src, int len, const uint8_t *mask, uint32_t phase)
+{
+    uint8_t key_bytes[4];
+    uint32_t key, word;
+    int i = 0, j;
+
+    while (i < len && ((uintptr_t)(dst + i) & 0x03)) {
+        dst[i] = src[i] ^ mask[(phase + i) & 0x03];
+        i++;
+    }
+
+    for (j = 0; j < 4; j++)
+        key_bytes[j] = mask[(phase + i + j) & 0x03];
+    memcpy(&key, key_bytes, 4);
+
+    for (; i + 4 <= len; i += 4) {
+        memcpy(&word, src + i, 4);
+        *(uint32_t *)(dst + i) = word ^ key;
+    }
+
+    for (; i < len; i++)
+        dst[i] = src[i] ^ mask[(phase + i) & 0x03];
+}
+
+/*
+ * Write all the bytes of a buffer, the frame would be corrupted by a partial write.
+ */
+static int ws_write_all(struct ws_session *ws, uint8_t *data, int len)
+{
+    int ret, written = 0;
+
+    while (written < len) {
+        ret = ws->net_write(ws, data + written, len - written);
+        if (ret <= 0)
+            return -1;
+        written += ret;
+    }
+
+    return written;
+}
+
+/*
+ * Read all the bytes of a frame header field, TCP may deliver them in pieces.
+ */
+static int ws_read_all(struct ws_session *ws, uint8_t *data, int len)
+{
+    int ret, got = 0;
+
+    while (got < len) {
+        ret = ws->net_read(ws, data + got, len - got);
+        if (ret <= 0)
+            return ret;
+        got += ret;
+    }
+
+    return got;
+}
+
 int ws_write(struct ws_session *ws, int opcode, int mask_flag, const uint8_t *buffer, int len)
 {
-    uint8_t *buf = (uint8_t *)buffer;
+    // tx_buf has WEBSOCKET_HDR_SIZE bytes of head room for the frame header
+    uint8_t *payload = ws->tx_buf + WEBSOCKET_HDR_SIZE;
     uint8_t hdr[WEBSOCKET_HDR_SIZE];
-    uint8_t *mask;
-    int hdr_len = 0, i;
+    uint8_t mask[4];
+    uint8_t *frame;
+    int hdr_len = 0, pos = 0, to_len;
 
     hdr[hdr_len++] = opcode;
 
@@ -496,34 +562,44 @@ int ws_write(struct ws_session *ws, int opcode, int mask_flag, const uint8_t *bu
     }
 
     if (mask_flag) {
-        mask = &hdr[hdr_len];
         random_get(mask, 4);
+        memcpy(&hdr[hdr_len], mask, 4);
         hdr_len += 4;
-
-        for (i = 0; i < len; ++i) {
-            buf[i] = (buf[i] ^ mask[i & 0x03]);
-        }
     }
 
-    if (ws->net_write(ws, hdr, hdr_len) != hdr_len) {
-        WS_ERROR("Error write header");
-        return -1;
-    }
+    /* The header is put just in front of the payload so that the frame goes
+       out in one write. The payload is masked while it is copied, the caller
+       data is left untouched. */
+    frame = payload - hdr_len;
+    memcpy(frame, hdr, hdr_len);
 
-    if (len == 0) {
-        return 0;
-    }
+    do {
+        to_len = len - pos;
+        if (to_len > ws->tx_buf_size)
+            to_len = ws->tx_buf_size;
 
-    int ret = ws->net_write(ws, buf, len);
+        if (mask_flag)
+            ws_mask_copy(payload, buffer + pos, to_len, mask, pos);
+        else if (to_len)
+            memcpy(payload, buffer + pos, to_len);
 
+        if (ws_write_all(ws, frame, (payload - frame) + to_len) < 0) {
+            WS_ERROR("Error write frame");
+            return -1;
+        }
 
-    return ret;
+        pos += to_len;
+        frame = payload;
+    } while (pos < len);
+
+    return len;
 }
 
 
 static int ws_read_data(struct ws_session *ws, uint8_t *buf, int len)
 {
     struct ws_rx_frame *rx_frame = &ws->rx_frame;
+    uint32_t phase = rx_frame->payload_len - rx_frame->remaining;
     int to_len;
     int read_len = 0;
 
@@ -540,10 +616,8 @@ static int ws_read_data(struct ws_session *ws, uint8_t *buf, int len)
     }
     rx_frame->remaining -= read_len;
 
-    if ((*((uint32_t *)&rx_frame->mask_key[0])) & 0xffffffff) {
-        for (int i = 0; i < read_len; i++) {
-            buf[i] = (buf[i] ^ rx_frame->mask_key[i % 4]);
-        }
+    if (rx_frame->mask_key[0] | rx_frame->mask_key[1] | rx_frame->mask_key[2] | rx_frame->mask_key[3]) {
+        ws_mask_copy(buf, buf, read_len, (uint8_t *)rx_frame->mask_key, phase);
     }
     return read_len;
 }
@@ -560,7 +634,7 @@ static int ws_read_hdr(struct ws_session *ws, uint8_t *buf, int len)
 
     rx_frame->hdr_recved = false;
 
-    if ((read_len = ws->net_read(ws, p, header)) <= 0) {
+    if ((read_len = ws_read_all(ws, p, header)) <= 0) {
         WS_ERROR("Error read data");
         return read_len;
     }
@@ -585,14 +659,14 @@ static int ws_read_hdr(struct ws_session *ws, uint8_t *buf, int len)
 
     if (payload_len == WS_SIZE_2B) {
         header = 2;
-        if ((read_len = ws->net_read(ws, p, header)) <= 0) {
+        if ((read_len = ws_read_all(ws, p, header)) <= 0) {
             WS_ERROR("Error read data");
             return read_len;
         }
         payload_len = p[0] << 8 | p[1];
     } else if (payload_len == WS_SIZE_4B) {
         header = 8;
-        if ((read_len = ws->net_read(ws, p, header)) <= 0) {
+        if ((read_len = ws_read_all(ws, p, header)) <= 0) {
             WS_ERROR("Error read data");
             return read_len;
         }
@@ -606,7 +680,7 @@ static int ws_read_hdr(struct ws_session *ws, uint8_t *buf, int len)
 
     if (mask) {
         // Read and store mask
-        if (payload_len != 0 && (read_len = ws->net_read(ws, p, mask_len)) <= 0) {
+        if (payload_len != 0 && (read_len = ws_read_all(ws, p, mask_len)) <= 0) {
             WS_ERROR("Error read data");
             return read_len;
         }
@@ -960,9 +1034,7 @@ int ws_session_write(struct ws_session *ws, int op, uint8_t *buf, int len, uint3
             remain_len = to_len;
         }
 
-        sys_memcpy(ws->tx_buf, pos, to_len);
-
-        if ((ret = ws_write(ws, send_op, WS_MASK, ws->tx_buf, to_len)) < 0) {
+        if ((ret = ws_write(ws, send_op, WS_MASK, pos, to_len)) < 0) {
             WS_ERROR("ws sesstion send failed");
             ws_net_error_abort(ws);
             break;
@@ -1108,7 +1180,7 @@ struct ws_session *ws_session_init(char *url, int port, char *path, char* origin
     ws->fd = -1;
     // ws->conf.ssl = 0;
 
-    ws->tx_buf = (uint8_t *)sys_malloc(tx_buf_len);
+    ws->tx_buf = (uint8_t *)sys_malloc(tx_buf_len + WEBSOCKET_HDR_SIZE);
     ws->rx_buf = (uint8_t *)sys_malloc(rx_buf_len);
 
 
@@ -1287,7 +1359,7 @@ int at_ws_session_init(
     if ((*ws)->tx_buf) {
         sys_mfree((*ws)->tx_buf);
     }
-    (*ws)->tx_buf = (uint8_t *)sys_malloc(ws_info->tx_buf_size);
+    (*ws)->tx_buf = (uint8_t *)sys_malloc(ws_info->tx_buf_size + WEBSOCKET_HDR_SIZE);
 
     if ((*ws)->rx_buf) {
         sys_mfree((*ws)->rx_buf);
@@ -2143,7 +2143,9 @@ extern int mbedtls_hwpka_flag;
  *
  * Requires: MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
  */
-//#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+/* GD modified */
+#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+/* GD modified end */
 
 /**
  * \def MBEDTLS_TEST_CONSTANT_FLOW_MEMSAN
@@ -4350,6 +4352,18 @@ extern int mbedtls_hwpka_flag;
  */
 #define MBEDTLS_SSL_OUT_CONTENT_LEN             5120//16384
 
+/* GD modified */
+/** \def MBEDTLS_SSL_IDLE_CONTENT_LEN
+ *
+ * Plaintext size the I/O buffers are reduced to by mbedtls_ssl_shrink_buffers()
+ * while a connection is idle. They grow back to the size of the next record
+ * received, or to the negotiated fragment length before the next write.
+ *
+ * Requires: MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+ */
+#define MBEDTLS_SSL_IDLE_CONTENT_LEN            512
+/* GD modified end */
+
 /** \def MBEDTLS_SSL_DTLS_MAX_BUFFERING
  *
  * Maximum number of heap-allocated bytes for the purpose of
@@ -1728,6 +1728,23 @@ struct mbedtls_ssl_config {
 #endif
 };
 
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+/**
+ * \brief   I/O buffer usage of a connection, see mbedtls_ssl_get_buffer_usage()
+ */
+typedef struct mbedtls_ssl_buffer_usage {
+    size_t in_buf_len;          /*!< current size of the input buffer           */
+    size_t out_buf_len;         /*!< current size of the output buffer          */
+    size_t buf_peak;            /*!< largest in_buf_len + out_buf_len           */
+    size_t in_record_max;       /*!< largest record received, with its header   */
+    size_t out_record_max;      /*!< largest record sent, with its header       */
+    uint32_t grow_cnt;          /*!< number of buffer enlargements              */
+    uint32_t shrink_cnt;        /*!< number of buffer reductions                */
+} mbedtls_ssl_buffer_usage;
+#endif /* MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH */
+/* GD modified end */
+
 struct mbedtls_ssl_context {
     const mbedtls_ssl_config *MBEDTLS_PRIVATE(conf); /*!< configuration information          */
 
@@ -1925,6 +1942,9 @@ struct mbedtls_ssl_context {
     size_t MBEDTLS_PRIVATE(out_left);            /*!< amount of data not yet written   */
 #if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
     size_t MBEDTLS_PRIVATE(out_buf_len);         /*!< length of output buffer          */
+/* GD modified */
+    mbedtls_ssl_buffer_usage MBEDTLS_PRIVATE(buf_usage); /*!< buffer usage statistics  */
+/* GD modified end */
 #endif
 
     unsigned char MBEDTLS_PRIVATE(cur_out_ctr)[MBEDTLS_SSL_SEQUENCE_NUMBER_LEN]; /*!<  Outgoing record sequence  number. */
@@ -4943,6 +4963,36 @@ int mbedtls_ssl_get_max_out_record_payload(const mbedtls_ssl_context *ssl);
  */
 int mbedtls_ssl_get_max_in_record_payload(const mbedtls_ssl_context *ssl);
 
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+/**
+ * \brief          Reduce the I/O buffers of an idle connection to
+ *                 \c MBEDTLS_SSL_IDLE_CONTENT_LEN.
+ *
+ * \note           Nothing is done while a handshake is in progress, while
+ *                 received data was not read yet or while written data was
+ *                 not sent yet, and for DTLS. The input buffer grows back to
+ *                 the size of the next record received, the output buffer to
+ *                 the negotiated fragment length before the next write.
+ *
+ * \param ssl      SSL context
+ *
+ * \return         \c 1 if a buffer was reduced, \c 0 otherwise.
+ */
+int mbedtls_ssl_shrink_buffers(mbedtls_ssl_context *ssl);
+
+/**
+ * \brief          Get the I/O buffer usage of a connection.
+ *
+ * \param ssl      SSL context
+ * \param usage    Filled with the current buffer sizes and the statistics
+ *                 since mbedtls_ssl_setup().
+ */
+void mbedtls_ssl_get_buffer_usage(const mbedtls_ssl_context *ssl,
+                                  mbedtls_ssl_buffer_usage *usage);
+#endif /* MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH */
+/* GD modified end */
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 /**
  * \brief          Return the peer certificate from the current connection.
@@ -482,6 +482,30 @@ static inline size_t mbedtls_ssl_get_input_buflen(const mbedtls_ssl_context *ctx
            + MBEDTLS_SSL_HEADER_LEN + MBEDTLS_SSL_PAYLOAD_OVERHEAD;
 #endif
 }
+
+/* GD modified */
+#if !defined(MBEDTLS_SSL_IDLE_CONTENT_LEN)
+#define MBEDTLS_SSL_IDLE_CONTENT_LEN 512
+#endif
+
+#define MBEDTLS_SSL_IDLE_BUFFER_LEN \
+    (MBEDTLS_SSL_IDLE_CONTENT_LEN + MBEDTLS_SSL_HEADER_LEN + MBEDTLS_SSL_PAYLOAD_OVERHEAD)
+
+/**
+ * \brief    Enlarge the I/O buffers to at least the given sizes, pass 0 to
+ *           leave a buffer unchanged.
+ *
+ * \param ssl          SSL context
+ * \param in_buf_len   minimum size of the input buffer
+ * \param out_buf_len  minimum size of the output buffer
+ *
+ * \return   0 on success, MBEDTLS_ERR_SSL_ALLOC_FAILED if a buffer could
+ *           not be enlarged.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_grow_buffers(mbedtls_ssl_context *ssl,
+                             size_t in_buf_len, size_t out_buf_len);
+/* GD modified end */
 #endif
 
 /*
@@ -3005,6 +3005,13 @@ int mbedtls_ssl_write_record(mbedtls_ssl_context *ssl, int force_flush)
         }
 
         protected_record_size = len + mbedtls_ssl_out_hdr_len(ssl);
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+        if (protected_record_size > ssl->buf_usage.out_record_max) {
+            ssl->buf_usage.out_record_max = protected_record_size;
+        }
+#endif
+/* GD modified end */
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
         /* In case of DTLS, double-check that we don't exceed
@@ -5040,6 +5047,14 @@ static int ssl_get_next_record(mbedtls_ssl_context *ssl)
         }
     }
 
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    if (rec.buf_len > ssl->buf_usage.in_record_max) {
+        ssl->buf_usage.in_record_max = rec.buf_len;
+    }
+#endif
+/* GD modified end */
+
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if (ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM) {
         /* Remember offset of next record within datagram. */
@@ -5050,6 +5065,38 @@ static int ssl_get_next_record(mbedtls_ssl_context *ssl)
     } else
 #endif
     {
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+        /* The input buffer may be smaller than the record announced by the
+         * header: reduced while idle, or to a maximum fragment length the
+         * server did not acknowledge. Enlarge it to the record size, and at
+         * least to the negotiated size for the other record types, since
+         * handshake messages may be reassembled from several records. */
+        size_t in_needed = (size_t) (ssl->in_hdr - ssl->in_buf) + rec.buf_len;
+        if (in_needed > ssl->in_buf_len) {
+            size_t in_new = (in_needed + MBEDTLS_SSL_IDLE_CONTENT_LEN - 1) /
+                            MBEDTLS_SSL_IDLE_CONTENT_LEN * MBEDTLS_SSL_IDLE_CONTENT_LEN;
+
+            if (rec.type != MBEDTLS_SSL_MSG_APPLICATION_DATA &&
+                in_new < mbedtls_ssl_get_input_buflen(ssl)) {
+                in_new = mbedtls_ssl_get_input_buflen(ssl);
+            }
+            if (in_new > MBEDTLS_SSL_IN_BUFFER_LEN) {
+                in_new = MBEDTLS_SSL_IN_BUFFER_LEN;
+            }
+            /* a record too large for any buffer is rejected by fetch_input */
+            if (in_new >= in_needed) {
+                ret = mbedtls_ssl_grow_buffers(ssl, in_new, 0);
+                if (ret != 0) {
+                    MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_grow_buffers", ret);
+                    return ret;
+                }
+                /* the record still points into the released buffer */
+                rec.buf = ssl->in_hdr;
+            }
+        }
+#endif
+/* GD modified end */
         /*
          * Fetch record contents from underlying transport.
          */
@@ -6166,6 +6213,16 @@ static int ssl_write_real(mbedtls_ssl_context *ssl,
          * copy the data into the internal buffers and setup the data structure
          * to keep track of partial writes
          */
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+        /* the output buffer may have been reduced while idle */
+        if ((ret = mbedtls_ssl_grow_buffers(ssl, 0,
+                                            mbedtls_ssl_get_output_buflen(ssl))) != 0) {
+            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_grow_buffers", ret);
+            return ret;
+        }
+#endif
+/* GD modified end */
         ssl->out_msglen  = len;
         ssl->out_msgtype = MBEDTLS_SSL_MSG_APPLICATION_DATA;
         if (len > 0) {
@@ -361,6 +361,13 @@ static void handle_buffer_resizing(mbedtls_ssl_context *ssl, int downsizing,
                 MBEDTLS_SSL_DEBUG_MSG(2, ("Reallocating in_buf to %" MBEDTLS_PRINTF_SIZET,
                                           in_buf_new_len));
                 modified = 1;
+/* GD modified */
+                if (downsizing) {
+                    ssl->buf_usage.shrink_cnt++;
+                } else {
+                    ssl->buf_usage.grow_cnt++;
+                }
+/* GD modified end */
             }
         }
     }
@@ -378,6 +385,13 @@ static void handle_buffer_resizing(mbedtls_ssl_context *ssl, int downsizing,
                 MBEDTLS_SSL_DEBUG_MSG(2, ("Reallocating out_buf to %" MBEDTLS_PRINTF_SIZET,
                                           out_buf_new_len));
                 modified = 1;
+/* GD modified */
+                if (downsizing) {
+                    ssl->buf_usage.shrink_cnt++;
+                } else {
+                    ssl->buf_usage.grow_cnt++;
+                }
+/* GD modified end */
             }
         }
     }
@@ -396,8 +410,72 @@ static void handle_buffer_resizing(mbedtls_ssl_context *ssl, int downsizing,
         ssl->in_msg = ssl->in_buf + written_in;
         ssl->in_len = ssl->in_buf + len_offset_in;
         ssl->in_iv = ssl->in_buf + iv_offset_in;
+
+/* GD modified */
+        if (ssl->in_buf_len + ssl->out_buf_len > ssl->buf_usage.buf_peak) {
+            ssl->buf_usage.buf_peak = ssl->in_buf_len + ssl->out_buf_len;
+        }
+/* GD modified end */
+    }
+}
+
+/* GD modified */
+int mbedtls_ssl_grow_buffers(mbedtls_ssl_context *ssl,
+                             size_t in_buf_len, size_t out_buf_len)
+{
+    handle_buffer_resizing(ssl, 0, in_buf_len, out_buf_len);
+
+    if ((ssl->in_buf != NULL && ssl->in_buf_len < in_buf_len) ||
+        (ssl->out_buf != NULL && ssl->out_buf_len < out_buf_len)) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
     }
+
+    return 0;
 }
+
+int mbedtls_ssl_shrink_buffers(mbedtls_ssl_context *ssl)
+{
+    size_t in_buf_len, out_buf_len;
+
+    if (ssl == NULL || ssl->conf == NULL ||
+        ssl->in_buf == NULL || ssl->out_buf == NULL) {
+        return 0;
+    }
+
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+    /* a datagram may hold several records, keep the buffers */
+    if (ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM) {
+        return 0;
+    }
+#endif
+
+    /* TLS 1.3 keeps ssl->handshake for the post-handshake messages, rely on
+     * the state only. A renegotiation leaves MBEDTLS_SSL_HANDSHAKE_OVER. */
+    if (!mbedtls_ssl_is_handshake_over(ssl)) {
+        return 0;
+    }
+
+    in_buf_len = ssl->in_buf_len;
+    out_buf_len = ssl->out_buf_len;
+
+    /* Only reduce the buffers holding no pending data, handle_buffer_resizing()
+     * leaves a buffer unchanged when the new size is not smaller. */
+    handle_buffer_resizing(ssl, 1,
+                           (ssl->in_left == 0 && ssl->in_msglen == 0 && ssl->in_offt == NULL) ?
+                           MBEDTLS_SSL_IDLE_BUFFER_LEN : in_buf_len,
+                           (ssl->out_left == 0) ? MBEDTLS_SSL_IDLE_BUFFER_LEN : out_buf_len);
+
+    return (ssl->in_buf_len < in_buf_len || ssl->out_buf_len < out_buf_len) ? 1 : 0;
+}
+
+void mbedtls_ssl_get_buffer_usage(const mbedtls_ssl_context *ssl,
+                                  mbedtls_ssl_buffer_usage *usage)
+{
+    *usage = ssl->buf_usage;
+    usage->in_buf_len = (ssl->in_buf != NULL) ? ssl->in_buf_len : 0;
+    usage->out_buf_len = (ssl->out_buf != NULL) ? ssl->out_buf_len : 0;
+}
+/* GD modified end */
 #endif /* MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH */
 
 #if defined(MBEDTLS_SSL_PROTO_TLS1_2)
@@ -1417,6 +1495,13 @@ int mbedtls_ssl_setup(mbedtls_ssl_context *ssl,
     mbedtls_ssl_reset_in_pointers(ssl);
     mbedtls_ssl_reset_out_pointers(ssl);
 
+/* GD modified */
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    memset(&ssl->buf_usage, 0, sizeof(ssl->buf_usage));
+    ssl->buf_usage.buf_peak = in_buf_len + out_buf_len;
+#endif
+/* GD modified end */
+
 #if defined(MBEDTLS_SSL_DTLS_SRTP)
     memset(&ssl->dtls_srtp_info, 0, sizeof(ssl->dtls_srtp_info));
 #endif
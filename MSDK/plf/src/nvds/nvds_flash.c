@@ -58,11 +58,16 @@ struct nvds_flash_env_tag nvds_flash_env;
 static struct list nvds_flash_list;
 
 static os_mutex_t nvds_mutex = NULL;
+
+#ifdef NVDS_FLASH_GC_TASK_SUPPORT
+static os_task_t nvds_gc_task_handle = NULL;
+#endif
 /*
  * LOCAL FUNCTIONS DEFINITIONS
  ****************************************************************************************
  */
 static int ns_del_used_cnt(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, uint8_t del_flag);
+static int txn_recover(struct nvds_flash_env_tag *flash_env, bool count);
 
 /**
  ****************************************************************************************
@@ -142,7 +147,8 @@ static int nvds_flash_erase(struct nvds_flash_env_tag *flash_env, uint32_t offse
     if ((offset + size) > flash_env->length)
         return NVDS_ERR(NVDS_E_INVAL_PARAM);
 
-    if (raw_flash_erase(flash_env->base_addr + offset, size))
+    /* sector by sector, the flash operations of the other tasks get in between */
+    if (raw_flash_sliced_op(RAW_FLASH_OP_ERASE, flash_env->base_addr + offset, NULL, size))
         return NVDS_ERR(NVDS_E_FLASH_IO_FAIL);
 
     return NVDS_ERR(NVDS_OK);
@@ -201,7 +207,7 @@ static void tag_set(uint8_t ns, enum element_type type, uint8_t fragno, uint16_t
  */
 static uint32_t element_header_crc32_calc(union entry_info *header)
 {
-    uint32_t addr = (uint32_t)header;
+    uintptr_t addr = (uintptr_t)header;
     uint32_t crc;
 
     crc = crc32(addr, offsetof(union entry_info, crc32), 0);
@@ -211,6 +217,40 @@ static uint32_t element_header_crc32_calc(union entry_info *header)
     return crc;
 }
 
+/**
+ ****************************************************************************************
+ * @brief Get the number of data entries behind an element header, a header torn by
+ * a reset has no trustworthy length and is stepped over alone
+ ****************************************************************************************
+ */
+static uint32_t element_data_entry_cnt(union entry_info *header)
+{
+    enum element_type type = tag_element_type_get(header->tag);
+
+    if ((type != ELEMENT_MIDDLE) && (type != ELEMENT_BULK))
+        return 0;
+    if (header->crc32 != element_header_crc32_calc(header))
+        return 0;
+
+    return (header->length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Get the number of entries a page walk steps over from an entry
+ *
+ * Only the length of an element in use is trusted: a header retired by page_tail_check()
+ * can be intact while the data entries behind it were never written.
+ ****************************************************************************************
+ */
+static uint32_t entry_walk_step(enum entry_state state, union entry_info *entry)
+{
+    if (state != ENTRY_USED)
+        return 1;
+
+    return 1 + element_data_entry_cnt(entry);
+}
+
 #if 0
 static uint32_t element_hash_crc32_calc(union entry_info *header)
 {
@@ -228,14 +268,14 @@ static uint32_t element_hash_crc32_calc(union entry_info *header)
 
 static uint32_t element_data_crc32_calc(void *data, uint32_t size)
 {
-    uint32_t addr = (uint32_t)data;
+    uintptr_t addr = (uintptr_t)data;
 
     return crc32(addr, size, 0);
 }
 
 static uint32_t page_header_crc32_calc(struct page_header *header)
 {
-    uint32_t addr = (uint32_t)header;
+    uintptr_t addr = (uintptr_t)header;
     uint32_t crc;
 
     crc = crc32(addr, offsetof(struct page_header, state), 0);
@@ -358,14 +398,21 @@ static int entry_state_range_alter(struct nvds_flash_env_tag *flash_env, struct
     uint8_t idx;
     int ret;
 
-    if ((end < begin) || (end >= ENTRY_COUNT_PER_PAGE))
+    if (!flash_env || !page || (end < begin) || (end >= ENTRY_COUNT_PER_PAGE))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if ((state == ENTRY_ILLEGAL) || (state >= ENTRY_ERROR))
         return NVDS_ERR(NVDS_E_FAIL);
 
+    /* modify the whole range in entry states table, then program it once */
     for (idx = begin; idx <= end; ++idx) {
-        ret = entry_state_alter(flash_env, page, idx, state);
+        ret = entry_state_set(page->entry_states, idx, state);
         NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
     }
 
+    ret = entry_states_table_write(flash_env, page->base_addr, page->entry_states);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
     return NVDS_ERR(NVDS_OK);
 }
 
@@ -695,9 +742,7 @@ static int element_find(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx,
                 }
             }
 
-            entry_idx++;
-            if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
-                entry_idx += ((entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE);
+            entry_idx += entry_walk_step(state, &entry);
         }
 
         /* go to next used page */
@@ -1191,6 +1236,22 @@ static int page_clear(struct nvds_flash_env_tag *flash_env, struct page_env_tag
     return NVDS_ERR(NVDS_OK);
 }
 
+static void nvds_gc_kick(void)
+{
+#ifdef NVDS_FLASH_GC_TASK_SUPPORT
+    if (nvds_gc_task_handle)
+        sys_task_notify(nvds_gc_task_handle, false);
+#endif
+}
+
+static void fg_latency_record(struct nvds_flash_env_tag *flash_env, uint32_t start)
+{
+    uint32_t elapsed = sys_current_time_get() - start;
+
+    if (elapsed > flash_env->gc_stats.fg_max_ms)
+        flash_env->gc_stats.fg_max_ms = elapsed;
+}
+
 static struct page_env_tag * new_page_request(struct nvds_flash_env_tag *flash_env, uint32_t seq)
 {
     struct page_env_tag *page;
@@ -1200,10 +1261,15 @@ static struct page_env_tag * new_page_request(struct nvds_flash_env_tag *flash_e
     union entry_info entry;
     uint8_t entry_idx;
     enum entry_state state;
+    uint32_t start;
 
     if (list_is_empty(&flash_env->nvds_page_free))
         return NULL;
 
+    /* the compaction below must not split a transaction still in use */
+    if (flash_env->txn_pending && txn_recover(flash_env, true))
+        return NULL;
+
     if (list_cnt(&flash_env->nvds_page_free) == 1) {
         /* candidate page */
         /* find max erase entry page */
@@ -1222,10 +1288,20 @@ static struct page_env_tag * new_page_request(struct nvds_flash_env_tag *flash_e
             return NULL;
     }
 
+    /* prefer a page the gc has already erased */
     page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_free);
+    p = page;
+    while (p && (p->header.state != PAGE_UNINITIALIZED))
+        p = (struct page_env_tag *)list_next(&p->list_hdr);
+    if (p)
+        page = p;
+
     if (page->header.state != PAGE_UNINITIALIZED) {
+        start = sys_current_time_get();
         if (nvds_flash_erase(flash_env, page->base_addr, SPI_FLASH_SEC_SIZE))
             return NULL;
+        flash_env->gc_stats.fg_erase_cnt++;
+        fg_latency_record(flash_env, start);
     }
 
     /* initialize page header */
@@ -1247,8 +1323,16 @@ static struct page_env_tag * new_page_request(struct nvds_flash_env_tag *flash_e
     /* select a page from free list, and move it to used list */
     list_extract(&flash_env->nvds_page_free, &page->list_hdr);
     list_push_back(&flash_env->nvds_page_used, &page->list_hdr);
-    if (!list_is_empty(&flash_env->nvds_page_free))
+    if (!list_is_empty(&flash_env->nvds_page_free)) {
+        /* one free page less, let the gc refill the reserve */
+        nvds_gc_kick();
         return page;
+    }
+
+    /* the gc could not keep up, compact the candidate page inline */
+    start = sys_current_time_get();
+    if (flash_env->gc_page == erase_page)
+        flash_env->gc_page = NULL;
 
     /* move candidate page from used list to free list */
     list_extract(&flash_env->nvds_page_used, &erase_page->list_hdr);
@@ -1280,9 +1364,249 @@ static struct page_env_tag * new_page_request(struct nvds_flash_env_tag *flash_e
 
     page_clear(flash_env, erase_page);
 
+    flash_env->gc_stats.fg_gc_cnt++;
+    fg_latency_record(flash_env, start);
+
     return page;
 }
 
+/**
+ ****************************************************************************************
+ * @brief Incremental garbage collection
+ *
+ * Moves the work new_page_request() would otherwise do inline out of nvds_data_put:
+ * free pages are erased ahead of time, and once the free pages drop to the watermark
+ * the full page with the most reclaimable entries is drained one element per step,
+ * then erased and handed back to the free list. The gc only moves elements into the
+ * room left in the current page and never takes a free page itself, so every reclaimed
+ * page is a net gain and the free pages stay available to new_page_request().
+ ****************************************************************************************
+ */
+static struct page_env_tag *gc_dirty_page_get(struct nvds_flash_env_tag *flash_env)
+{
+    struct page_env_tag *page;
+
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_free);
+    while (page) {
+        if (page->header.state != PAGE_UNINITIALIZED)
+            return page;
+        page = (struct page_env_tag *)list_next(&page->list_hdr);
+    }
+
+    return NULL;
+}
+
+static int gc_page_erase(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page)
+{
+    int ret;
+
+    ret = nvds_flash_erase(flash_env, page->base_addr, SPI_FLASH_SEC_SIZE);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    flash_env->gc_stats.pages_erased++;
+
+    return page_clear(flash_env, page);
+}
+
+static struct page_env_tag *gc_victim_select(struct nvds_flash_env_tag *flash_env)
+{
+    struct page_env_tag *cur_page;
+    struct page_env_tag *page;
+    struct page_env_tag *victim = NULL;
+    uint32_t free_cnt;
+    uint32_t capacity;
+    uint32_t min_reclaim;
+    uint32_t reclaim;
+    uint32_t best = 0;
+
+    free_cnt = list_cnt(&flash_env->nvds_page_free);
+    if (free_cnt > flash_env->gc_watermark)
+        return NULL;
+
+    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    if (!cur_page)
+        return NULL;
+
+    /* valid entries of the victim must fit in the current page */
+    capacity = ENTRY_COUNT_PER_PAGE - cur_page->next_free_idx;
+
+    /* only compact pages worth the copy unless a single free page is left */
+    min_reclaim = (free_cnt > 1) ? NVDS_GC_MIN_RECLAIM_ENTRIES : 1;
+
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    while (page) {
+        if ((page != cur_page) && (page->header.state == PAGE_FULL)
+            && (page->entry_cnt_used <= capacity)) {
+            reclaim = ENTRY_COUNT_PER_PAGE - page->entry_cnt_used;
+            if ((reclaim >= min_reclaim) && (reclaim > best)) {
+                best = reclaim;
+                victim = page;
+            }
+        }
+        page = (struct page_env_tag *)list_next(&page->list_hdr);
+    }
+
+    return victim;
+}
+
+static int gc_element_relocate(struct nvds_flash_env_tag *flash_env)
+{
+    struct page_env_tag *victim = flash_env->gc_page;
+    struct page_env_tag *cur_page;
+    union entry_info entry;
+    enum entry_state state = ENTRY_FREE;
+    enum element_type type;
+    uint32_t entry_idx;
+    uint32_t entry_start;
+    uint32_t entry_cnt;
+    uint32_t i;
+    int ret;
+
+    /* skip the entries that are no longer in use */
+    for (entry_idx = flash_env->gc_entry_idx; entry_idx < ENTRY_COUNT_PER_PAGE; entry_idx++) {
+        entry_state_get(victim->entry_states, entry_idx, &state);
+        if ((state != ENTRY_UPDATED) && (state != ENTRY_ILLEGAL))
+            break;
+    }
+    flash_env->gc_entry_idx = entry_idx;
+
+    /* page drained */
+    if ((entry_idx >= ENTRY_COUNT_PER_PAGE) || (state != ENTRY_USED))
+        return NVDS_ERR(NVDS_E_NOT_FOUND);
+
+    ret = entry_read(flash_env, victim, entry_idx, &entry);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    /* a marker in use belongs to an unfinished transaction, the next step settles it */
+    type = tag_element_type_get(entry.tag);
+    if (type == ELEMENT_TXN) {
+        flash_env->txn_pending = 1;
+        return NVDS_ERR(NVDS_E_FAIL);
+    }
+
+    /* element header and its data entries are moved together */
+    entry_cnt = 1;
+    if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+        entry_cnt += (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+    if (entry_idx + entry_cnt > ENTRY_COUNT_PER_PAGE)
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    if ((cur_page == victim) || (cur_page->header.state != PAGE_ACTIVE)
+        || (page_room_get(cur_page) < (int)(entry_cnt * ENTRY_SIZE)))
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+
+    entry_start = cur_page->next_free_idx;
+    for (i = 0; i < entry_cnt; i++) {
+        /* entry_write() encrypts in place, read every entry right before writing it */
+        if (i) {
+            ret = entry_read(flash_env, victim, entry_idx + i, &entry);
+            NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        }
+
+        ret = entry_write(flash_env, cur_page, &entry);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+    }
+
+    ret = entry_state_range_alter(flash_env, cur_page, entry_start, entry_start + entry_cnt - 1, ENTRY_USED);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    /* a reset before this point leaves two identical copies, pages_load() keeps the new one */
+    ret = entry_state_range_alter(flash_env, victim, entry_idx, entry_idx + entry_cnt - 1, ENTRY_UPDATED);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    if (victim->entry_cnt_used >= entry_cnt)
+        victim->entry_cnt_used -= entry_cnt;
+    else
+        victim->entry_cnt_used = 0;
+
+    flash_env->gc_entry_idx = entry_idx + entry_cnt;
+    flash_env->gc_stats.entries_relocated += entry_cnt;
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int gc_step(struct nvds_flash_env_tag *flash_env)
+{
+    struct page_env_tag *page;
+    int ret;
+
+    /* erase free pages ahead of time so new_page_request() does not have to */
+    page = gc_dirty_page_get(flash_env);
+    if (page) {
+        ret = gc_page_erase(flash_env, page);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        goto done;
+    }
+
+    /* finish the transactions a failed commit left, before moving their elements */
+    if (flash_env->txn_pending) {
+        ret = txn_recover(flash_env, true);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        goto done;
+    }
+
+    if (!flash_env->gc_page) {
+        flash_env->gc_page = gc_victim_select(flash_env);
+        flash_env->gc_entry_idx = 0;
+        if (!flash_env->gc_page)
+            return NVDS_ERR(NVDS_E_NOT_FOUND);
+    }
+
+    ret = gc_element_relocate(flash_env);
+    if (ret == NVDS_ERR(NVDS_OK))
+        goto done;
+
+    if (ret != NVDS_ERR(NVDS_E_NOT_FOUND)) {
+        /* select again on the next kick, once deletes made some room */
+        flash_env->gc_page = NULL;
+        return ret;
+    }
+
+    /* no valid element left, erase the page and give it back to the free list */
+    page = flash_env->gc_page;
+    flash_env->gc_page = NULL;
+    list_extract(&flash_env->nvds_page_used, &page->list_hdr);
+    list_push_back(&flash_env->nvds_page_free, &page->list_hdr);
+
+    /* a failed erase leaves a dirty free page which is retried by the next step */
+    ret = gc_page_erase(flash_env, page);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+    flash_env->gc_stats.pages_reclaimed++;
+
+done:
+    flash_env->gc_stats.steps++;
+    return NVDS_ERR(NVDS_OK);
+}
+
+#ifdef NVDS_FLASH_GC_TASK_SUPPORT
+static void nvds_gc_task(void *param)
+{
+    struct nvds_flash_env_tag *flash_env;
+    bool busy;
+
+    for (;;) {
+        sys_task_wait_notification(-1);
+
+        /* release the mutex between steps so that no put waits for more than one step */
+        do {
+            busy = false;
+            if (OS_OK != sys_mutex_get(&nvds_mutex))
+                break;
+
+            flash_env = (struct nvds_flash_env_tag *)list_pick(&nvds_flash_list);
+            while (flash_env) {
+                if (gc_step(flash_env) == NVDS_ERR(NVDS_OK))
+                    busy = true;
+                flash_env = (struct nvds_flash_env_tag *)list_next(&flash_env->list_hdr);
+            }
+
+            sys_mutex_put(&nvds_mutex);
+        } while (busy);
+    }
+}
+#endif
+
 static int bulk_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char* key, uint8_t *buf, uint32_t bufsize)
 {
     struct page_env_tag *cur_page;
@@ -1434,16 +1758,66 @@ no_space_out:
     return NVDS_ERR(NVDS_E_NO_SPACE);
 }
 
-static int data_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char* key, uint8_t *buf, uint32_t bufsize)
+static uint32_t element_entry_cnt(uint32_t bufsize)
+{
+    if (bufsize <= ELEMENT_SMALL_MAX_SIZE)
+        return 1;
+
+    return 1 + (bufsize + ENTRY_SIZE - 1) / ENTRY_SIZE;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Write a small or middle element at the end of the page, entry states unchanged
+ ****************************************************************************************
+ */
+static int element_entries_write(struct nvds_flash_env_tag *flash_env, struct page_env_tag *cur_page,
+                                    uint8_t ns_idx, const char* key, uint8_t *buf, uint32_t bufsize)
 {
-    struct page_env_tag *cur_page;
     union entry_info entry;
     enum element_type type;
-    int entry_start;
     int entry_cnt;
     uint32_t address;
     int ret;
 
+    entry_cnt = (bufsize + ENTRY_SIZE - 1) / ENTRY_SIZE;
+    sys_memset((void*)&entry, 0xFF, sizeof(union entry_info));
+    type = ELEMENT_SMALL;
+    if (bufsize > ELEMENT_SMALL_MAX_SIZE)
+        type = ELEMENT_MIDDLE;
+    tag_set(ns_idx, type, TAG_FRAG_NO_DEFAULT, &entry.tag);
+    entry.length = bufsize;
+    sys_memcpy(entry.key, key, strlen(key));
+    entry.key[strlen(key)] = 0;
+
+    if (type == ELEMENT_SMALL) {
+        sys_memcpy(entry.value, buf, bufsize);
+    } else {
+        entry.varlen_info_t.datacrc32 = element_data_crc32_calc(buf, bufsize);
+    }
+
+    entry.crc32 = element_header_crc32_calc(&entry);
+    ret = entry_write(flash_env, cur_page, &entry);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    if (type == ELEMENT_MIDDLE) {
+        address = cur_page->base_addr + PAGE_ENTRY_OFFSET + cur_page->next_free_idx * ENTRY_SIZE;
+        ret = entry_data_write(flash_env, address, bufsize, buf);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        cur_page->next_free_idx += entry_cnt;
+        cur_page->entry_cnt_used += entry_cnt;
+    }
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int data_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char* key, uint8_t *buf, uint32_t bufsize)
+{
+    struct page_env_tag *cur_page;
+    int entry_start;
+    int ret;
+
     /* compare with current value if exist */
     if (element_compare(flash_env, ns_idx, key, buf, bufsize)) {
         /* find success need to subtract used_cnt one, data_element_put return ok will add one */
@@ -1490,41 +1864,12 @@ static int data_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx
 
     /* write to current page */
     entry_start = cur_page->next_free_idx;
-    entry_cnt = (bufsize + ENTRY_SIZE - 1) / ENTRY_SIZE;
-    sys_memset((void*)&entry, 0xFF, sizeof(union entry_info));
-    type = ELEMENT_SMALL;
-    if (bufsize > ELEMENT_SMALL_MAX_SIZE)
-        type = ELEMENT_MIDDLE;
-    tag_set(ns_idx, type, TAG_FRAG_NO_DEFAULT, &entry.tag);
-    entry.length = bufsize;
-    sys_memcpy(entry.key, key, strlen(key));
-    entry.key[strlen(key)] = 0;
-
-    if (type == ELEMENT_SMALL) {
-        sys_memcpy(entry.value, buf, bufsize);
-    } else {
-        entry.varlen_info_t.datacrc32 = element_data_crc32_calc(buf, bufsize);
-    }
-
-    entry.crc32 = element_header_crc32_calc(&entry);
-    ret = entry_write(flash_env, cur_page, &entry);
+    ret = element_entries_write(flash_env, cur_page, ns_idx, key, buf, bufsize);
     NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
 
-    if (type == ELEMENT_MIDDLE) {
-        address = cur_page->base_addr + PAGE_ENTRY_OFFSET + cur_page->next_free_idx * ENTRY_SIZE;
-        ret = entry_data_write(flash_env, address, bufsize, buf);
-        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
-
-        cur_page->next_free_idx += entry_cnt;
-        cur_page->entry_cnt_used += entry_cnt;
-
-        /* modify element states */
-        ret = entry_state_range_alter(flash_env, cur_page, entry_start, entry_start + entry_cnt, ENTRY_USED);
-        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
-    } else {
-        ret = entry_state_range_alter(flash_env, cur_page, entry_start, entry_start, ENTRY_USED);
-        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
-    }
+    /* modify element states */
+    ret = entry_state_range_alter(flash_env, cur_page, entry_start, cur_page->next_free_idx - 1, ENTRY_USED);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
 
 #ifdef NVDS_DEBUG
     page_print(flash_env, cur_page);
@@ -1663,10 +2008,488 @@ static int ns_del_used_cnt(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx,
     return NVDS_ERR(NVDS_OK);
 }
 
-static void page_header_read(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page)
-{
-    int ret;
-    struct page_header *header = &page->header;
+/**
+ ****************************************************************************************
+ * @brief Transaction
+ *
+ * A transaction is written to a single page as
+ *     BEGIN(n) | elements and delete markers (n entries) | COMMIT(n)
+ * BEGIN is marked used first, the n entries and COMMIT are then marked used with one
+ * entry states table write, which is the commit point. After it the older copies of
+ * the keys are deleted and the markers are marked updated. pages_load() rolls back a
+ * transaction without COMMIT, and finishes one whose BEGIN is still in use.
+ ****************************************************************************************
+ */
+static void txn_mark_fill(union entry_info *entry, uint8_t mark, uint16_t length,
+                                uint8_t ns_idx, const char *key)
+{
+    sys_memset((void*)entry, 0xFF, sizeof(union entry_info));
+    tag_set(NAMESPACE_ANY_IDX, ELEMENT_TXN, mark, &entry->tag);
+    entry->length = length;
+    entry->key[0] = 0;
+    if (key) {
+        sys_memcpy(entry->key, key, strlen(key));
+        entry->key[strlen(key)] = 0;
+    }
+    entry->value[0] = ns_idx;
+    entry->crc32 = element_header_crc32_calc(entry);
+}
+
+static bool txn_mark_check(union entry_info *entry, uint8_t mark)
+{
+    return (tag_namespace_get(entry->tag) == NAMESPACE_ANY_IDX)
+            && (tag_element_type_get(entry->tag) == ELEMENT_TXN)
+            && (tag_fragno_get(entry->tag) == mark)
+            && (entry->crc32 == element_header_crc32_calc(entry));
+}
+
+/**
+ ****************************************************************************************
+ * @brief Mark entries from begin to end updated with one states table write
+ *
+ * counted is how many of these entries are included in entry_cnt_used.
+ ****************************************************************************************
+ */
+static int txn_range_invalidate(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page,
+                                    uint32_t begin, uint32_t end, uint32_t counted)
+{
+    int ret;
+
+    if (end >= ENTRY_COUNT_PER_PAGE)
+        end = ENTRY_COUNT_PER_PAGE - 1;
+
+    page->entry_cnt_used = (page->entry_cnt_used > counted) ? (page->entry_cnt_used - counted) : 0;
+
+    /* never write again over what the transaction has programmed, even if the states
+       write fails: the range is updated in RAM and goes to flash with the next one */
+    if (page->next_free_idx < end + 1)
+        page->next_free_idx = end + 1;
+
+    ret = entry_state_range_alter(flash_env, page, begin, end, ENTRY_UPDATED);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+/**
+ ****************************************************************************************
+ * @brief Delete the copies of a key older than the transaction starting at begin_idx
+ *
+ * @return number of elements deleted, or a negative value on error
+ ****************************************************************************************
+ */
+static int txn_old_version_del(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char *key,
+                                    struct page_env_tag *txn_page, uint32_t begin_idx)
+{
+    struct page_env_tag *page;
+    uint8_t entry_idx;
+    int cnt = 0;
+    int ret;
+
+    do {
+        entry_idx = 0;
+        ret = element_find(flash_env, ns_idx, key, &page, &entry_idx, NULL, ELEMENT_ANY);
+        if (ret == NVDS_ERR(NVDS_E_NOT_FOUND))
+            break;
+        else if (ret)
+            return -ret;
+
+        /* copies on later pages, or after BEGIN, are not older than the transaction */
+        if ((page->header.seqno > txn_page->header.seqno)
+            || ((page == txn_page) && (entry_idx > begin_idx)))
+            break;
+
+        ret = data_element_del(flash_env, ns_idx, key);
+        if (ret)
+            return -ret;
+        cnt++;
+    } while (1);
+
+    return cnt;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Apply a committed transaction: delete older copies, then retire the markers
+ *
+ * count is false when called from pages_load(), namespace used counts are computed
+ * once all the pages are loaded.
+ ****************************************************************************************
+ */
+static int txn_apply(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page,
+                        uint32_t begin_idx, uint32_t body_cnt, bool count)
+{
+    union entry_info entry;
+    enum entry_state state = ENTRY_FREE;
+    enum element_type type;
+    uint32_t commit_idx = begin_idx + 1 + body_cnt;
+    uint32_t entry_idx;
+    uint32_t retired = 2;
+    uint8_t ns;
+    uint8_t pass;
+    int cnt;
+    int ret;
+
+    /* writes first, so that deletes do not drop a namespace the writes still use */
+    for (pass = 0; pass < 2; pass++) {
+        for (entry_idx = begin_idx + 1; entry_idx < commit_idx;) {
+            ret = entry_read(flash_env, page, entry_idx, &entry);
+            NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+            type = tag_element_type_get(entry.tag);
+            if (type != ELEMENT_TXN) {
+                if (pass == 0) {
+                    ns = tag_namespace_get(entry.tag);
+                    cnt = txn_old_version_del(flash_env, ns, entry.key, page, begin_idx);
+                    NVDS_ERR_RET(cnt >= 0, -cnt);
+                    if (count && !cnt)
+                        ns_add_used_cnt(flash_env, ns);
+                }
+                entry_idx += element_entry_cnt(entry.length);
+                continue;
+            }
+
+            if (pass == 1) {
+                /* delete marker, namespace index is kept in value */
+                ns = entry.value[0];
+                cnt = txn_old_version_del(flash_env, ns, entry.key, page, begin_idx);
+                NVDS_ERR_RET(cnt >= 0, -cnt);
+                if (count && cnt)
+                    ns_del_used_cnt(flash_env, ns, 1);
+
+                entry_state_get(page->entry_states, entry_idx, &state);
+                if (state == ENTRY_USED)
+                    retired++;
+                entry_state_set(page->entry_states, entry_idx, ENTRY_UPDATED);
+            }
+            entry_idx++;
+        }
+    }
+
+    /* retire delete markers and both transaction markers at once */
+    entry_state_set(page->entry_states, begin_idx, ENTRY_UPDATED);
+    entry_state_set(page->entry_states, commit_idx, ENTRY_UPDATED);
+    ret = entry_states_table_write(flash_env, page->base_addr, page->entry_states);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    page->entry_cnt_used = (page->entry_cnt_used > retired) ? (page->entry_cnt_used - retired) : 0;
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int txn_commit(struct nvds_flash_env_tag *flash_env, struct nvds_txn *txn)
+{
+    struct page_env_tag *cur_page;
+    struct nvds_txn_op *op;
+    struct nvds_txn_op *next;
+    union entry_info entry;
+    uint32_t body_cnt = 0;
+    uint32_t begin_idx;
+    int ret;
+
+    /* resolve namespaces first, creating one writes to flash; drop the no-op */
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        next = (struct nvds_txn_op *)list_next(&op->list_hdr);
+
+        ret = ns_index_by_namespace(flash_env, op->null_ns ? NULL : op->namespace, !op->del, &op->ns_idx);
+        if ((ret != NVDS_ERR(NVDS_OK)) && !((ret == NVDS_ERR(NVDS_E_NOT_FOUND)) && op->del))
+            return ret;
+
+        if (op->del) {
+            if ((ret == NVDS_ERR(NVDS_E_NOT_FOUND))
+                || (data_element_find(flash_env, op->ns_idx, op->key) == NVDS_ERR(NVDS_E_NOT_FOUND))) {
+                list_extract(&txn->op_list, &op->list_hdr);
+                sys_mfree(op);
+            } else {
+                body_cnt++;
+            }
+        } else if (element_compare(flash_env, op->ns_idx, op->key, op->data, op->length)) {
+            list_extract(&txn->op_list, &op->list_hdr);
+            sys_mfree(op);
+        } else {
+            body_cnt += element_entry_cnt(op->length);
+        }
+
+        op = next;
+    }
+
+    if (body_cnt == 0)
+        return NVDS_ERR(NVDS_OK);
+
+    /* the whole transaction goes to one page, switch page at most once */
+    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    if ((cur_page->header.state == PAGE_INVALID)
+        || (cur_page->header.state == PAGE_ERROR)
+        || (cur_page->header.state == PAGE_CANDIDATE))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if (page_room_get(cur_page) < (int)((body_cnt + 2) * ENTRY_SIZE)) {
+        ret = page_state_alter(flash_env, cur_page, PAGE_FULL);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        cur_page = new_page_request(flash_env, cur_page->header.seqno + 1);
+        if (!cur_page || (page_room_get(cur_page) < (int)((body_cnt + 2) * ENTRY_SIZE)))
+            return NVDS_ERR(NVDS_E_NO_SPACE);
+    }
+
+    begin_idx = cur_page->next_free_idx;
+    txn_mark_fill(&entry, TXN_MARK_BEGIN, body_cnt, NAMESPACE_ANY_IDX, NULL);
+    ret = entry_write(flash_env, cur_page, &entry);
+    if (ret)
+        goto rollback;
+
+    ret = entry_state_alter(flash_env, cur_page, begin_idx, ENTRY_USED);
+    if (ret)
+        goto rollback;
+
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        if (op->del) {
+            txn_mark_fill(&entry, TXN_MARK_DEL, 0, op->ns_idx, op->key);
+            ret = entry_write(flash_env, cur_page, &entry);
+        } else {
+            ret = element_entries_write(flash_env, cur_page, op->ns_idx, op->key, op->data, op->length);
+        }
+        if (ret)
+            goto rollback;
+
+        op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+    }
+
+    txn_mark_fill(&entry, TXN_MARK_COMMIT, body_cnt, NAMESPACE_ANY_IDX, NULL);
+    ret = entry_write(flash_env, cur_page, &entry);
+    if (ret)
+        goto rollback;
+
+    /* commit point */
+    ret = entry_state_range_alter(flash_env, cur_page, begin_idx + 1, begin_idx + 1 + body_cnt, ENTRY_USED);
+    if (ret)
+        goto rollback;
+
+    /* on failure from here, the gc or pages_load() finishes the transaction */
+    ret = txn_apply(flash_env, cur_page, begin_idx, body_cnt, true);
+    if (ret)
+        flash_env->txn_pending = 1;
+    return ret;
+
+rollback:
+    /* entry_write() has counted every entry written so far as used */
+    if (txn_range_invalidate(flash_env, cur_page, begin_idx, begin_idx + 1 + body_cnt,
+                            cur_page->next_free_idx - begin_idx))
+        flash_env->txn_pending = 1;
+    return ret;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Finish or roll back the transactions interrupted by a reset or a failed commit
+ *
+ * count is false when called from pages_load(), as for txn_apply().
+ ****************************************************************************************
+ */
+static int txn_recover(struct nvds_flash_env_tag *flash_env, bool count)
+{
+    struct page_env_tag *page;
+    union entry_info entry;
+    union entry_info commit;
+    enum entry_state state;
+    enum element_type type;
+    uint32_t entry_idx;
+    uint32_t commit_idx;
+    uint32_t body_cnt;
+    uint32_t counted;
+    uint32_t idx;
+    int ret;
+
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    while (page) {
+        for (entry_idx = 0; entry_idx < ENTRY_COUNT_PER_PAGE;) {
+            entry_state_get(page->entry_states, entry_idx, &state);
+            if (state == ENTRY_FREE)
+                break;
+
+            if (state != ENTRY_USED) {
+                entry_idx++;
+                continue;
+            }
+
+            ret = entry_read(flash_env, page, entry_idx, &entry);
+            NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+            type = tag_element_type_get(entry.tag);
+            if (txn_mark_check(&entry, TXN_MARK_BEGIN)) {
+                body_cnt = entry.length;
+                commit_idx = entry_idx + 1 + body_cnt;
+
+                state = ENTRY_FREE;
+                if (commit_idx < ENTRY_COUNT_PER_PAGE) {
+                    entry_state_get(page->entry_states, commit_idx, &state);
+                    ret = entry_read(flash_env, page, commit_idx, &commit);
+                    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+                }
+
+                if ((state == ENTRY_USED) && txn_mark_check(&commit, TXN_MARK_COMMIT)
+                    && (commit.length == body_cnt)) {
+                    ret = txn_apply(flash_env, page, entry_idx, body_cnt, count);
+                } else {
+                    /* pages_load() stopped counting at the first free entry after BEGIN */
+                    counted = 0;
+                    for (idx = entry_idx; (idx <= commit_idx) && (idx < ENTRY_COUNT_PER_PAGE); idx++) {
+                        entry_state_get(page->entry_states, idx, &state);
+                        if (state == ENTRY_USED)
+                            counted++;
+                    }
+                    ret = txn_range_invalidate(flash_env, page, entry_idx, commit_idx, counted);
+                }
+                NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+                entry_idx = commit_idx + 1;
+                continue;
+            } else if (type == ELEMENT_TXN) {
+                /* marker left outside of a transaction */
+                ret = txn_range_invalidate(flash_env, page, entry_idx, entry_idx, 1);
+                NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+            }
+
+            entry_idx += 1 + element_data_entry_cnt(&entry);
+        }
+
+        page = (struct page_env_tag*)list_next(&page->list_hdr);
+    }
+
+    flash_env->txn_pending = 0;
+    return NVDS_ERR(NVDS_OK);
+}
+
+static uint32_t element_id_hash_calc(union entry_info *entry)
+{
+    uint32_t crc;
+
+    crc = crc32((uintptr_t)&entry->tag, sizeof(entry->tag), 0);
+    crc = crc32((uintptr_t)entry->key, strlen(entry->key), crc);
+
+    return crc;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Retire the older copy of the elements being moved when a reset hit
+ *
+ * The gc and the inline compaction write the copy of an element to the last used page
+ * before marking the original updated, a reset in between leaves two identical copies.
+ * The elements of the last used page are hashed, then the older pages are walked once
+ * and the entries matching one of them are marked updated.
+ ****************************************************************************************
+ */
+static int element_dup_retire(struct nvds_flash_env_tag *flash_env)
+{
+    struct element_id {
+        uint32_t hash;
+        uint8_t entry_idx;
+    } *ids;
+    struct page_env_tag *last;
+    struct page_env_tag *page;
+    union entry_info entry;
+    union entry_info copy;
+    enum entry_state state;
+    uint32_t id_cnt = 0;
+    uint32_t entry_idx;
+    uint32_t entry_cnt;
+    uint32_t hash;
+    uint32_t i;
+    int ret = NVDS_ERR(NVDS_OK);
+
+    last = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    if (!last || (list_cnt(&flash_env->nvds_page_used) < 2) || !last->entry_cnt_used)
+        return NVDS_ERR(NVDS_OK);
+
+    ids = sys_malloc(last->entry_cnt_used * sizeof(struct element_id));
+    if (!ids)
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+
+    for (entry_idx = 0; (entry_idx < ENTRY_COUNT_PER_PAGE) && (id_cnt < last->entry_cnt_used);) {
+        entry_state_get(last->entry_states, entry_idx, &state);
+        if (state == ENTRY_FREE)
+            break;
+
+        if (state != ENTRY_USED) {
+            entry_idx++;
+            continue;
+        }
+
+        ret = entry_read(flash_env, last, entry_idx, &entry);
+        if (ret)
+            goto exit;
+
+        if ((entry.crc32 == element_header_crc32_calc(&entry))
+            && (tag_element_type_get(entry.tag) != ELEMENT_TXN)) {
+            ids[id_cnt].hash = element_id_hash_calc(&entry);
+            ids[id_cnt].entry_idx = entry_idx;
+            id_cnt++;
+        }
+
+        entry_idx += 1 + element_data_entry_cnt(&entry);
+    }
+
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    while (id_cnt && (page != last)) {
+        for (entry_idx = 0; entry_idx < ENTRY_COUNT_PER_PAGE;) {
+            entry_state_get(page->entry_states, entry_idx, &state);
+            if (state == ENTRY_FREE)
+                break;
+
+            if (state != ENTRY_USED) {
+                entry_idx++;
+                continue;
+            }
+
+            ret = entry_read(flash_env, page, entry_idx, &entry);
+            if (ret)
+                goto exit;
+
+            entry_cnt = 1 + element_data_entry_cnt(&entry);
+            if (entry.crc32 != element_header_crc32_calc(&entry)) {
+                entry_idx += entry_cnt;
+                continue;
+            }
+
+            hash = element_id_hash_calc(&entry);
+            for (i = 0; i < id_cnt; i++) {
+                if (ids[i].hash != hash)
+                    continue;
+
+                ret = entry_read(flash_env, last, ids[i].entry_idx, &copy);
+                if (ret)
+                    goto exit;
+
+                if ((copy.tag == entry.tag) && !strcmp(copy.key, entry.key)) {
+                    ret = entry_state_range_alter(flash_env, page, entry_idx, entry_idx + entry_cnt - 1,
+                                                    ENTRY_UPDATED);
+                    if (ret)
+                        goto exit;
+
+                    page->entry_cnt_used = (page->entry_cnt_used > entry_cnt) ?
+                                            (page->entry_cnt_used - entry_cnt) : 0;
+                    break;
+                }
+            }
+
+            entry_idx += entry_cnt;
+        }
+
+        page = (struct page_env_tag *)list_next(&page->list_hdr);
+    }
+
+exit:
+    sys_mfree(ids);
+    return ret;
+}
+
+static void page_header_read(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page)
+{
+    int ret;
+    struct page_header *header = &page->header;
 
     /* read page header */
     ret = nvds_flash_read(flash_env, page->base_addr + PAGE_HEADER_OFFSET,
@@ -1731,6 +2554,68 @@ static bool cmp_sequence_no(struct list_hdr const * pageA, struct list_hdr const
     return ((seqA & ~BIT(31)) < (seqB & ~BIT(31)));
 }
 
+/**
+ ****************************************************************************************
+ * @brief Mark used the data entries a reset left free behind a header in use
+ *
+ * The entries of an element are all programmed before its states, a reset in the states
+ * table write can leave the header used and the end of its data free.
+ ****************************************************************************************
+ */
+static void element_states_complete(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page,
+                                        uint32_t data_idx, uint32_t data_cnt)
+{
+    enum entry_state state;
+    uint32_t idx;
+    bool torn = false;
+
+    if (data_idx + data_cnt > ENTRY_COUNT_PER_PAGE)
+        return;
+
+    for (idx = data_idx; idx < data_idx + data_cnt; idx++) {
+        entry_state_get(page->entry_states, idx, &state);
+        if (state == ENTRY_FREE) {
+            entry_state_set(page->entry_states, idx, ENTRY_USED);
+            torn = true;
+        }
+    }
+
+    if (torn)
+        entry_states_table_write(flash_env, page->base_addr, page->entry_states);
+}
+
+/**
+ ****************************************************************************************
+ * @brief Skip the entries programmed after the first free state, left by a reset
+ * between an entry write and its state update
+ ****************************************************************************************
+ */
+static void page_tail_check(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page)
+{
+    uint8_t data[ENTRY_SIZE];
+    uint32_t entry_idx;
+    uint32_t end = page->next_free_idx;
+    uint32_t i;
+
+    for (entry_idx = page->next_free_idx; entry_idx < ENTRY_COUNT_PER_PAGE; entry_idx++) {
+        if (nvds_flash_read(flash_env, page->base_addr + PAGE_ENTRY_OFFSET + entry_idx * ENTRY_SIZE,
+                            ENTRY_SIZE, data))
+            return;
+
+        for (i = 0; i < ENTRY_SIZE; i++) {
+            if (data[i] != 0xFF) {
+                end = entry_idx + 1;
+                break;
+            }
+        }
+    }
+
+    if (end > page->next_free_idx) {
+        entry_state_range_alter(flash_env, page, page->next_free_idx, end - 1, ENTRY_UPDATED);
+        page->next_free_idx = end;
+    }
+}
+
 static int pages_load(struct nvds_flash_env_tag *flash_env)
 {
     uint32_t sector_cnt;
@@ -1741,8 +2626,8 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
     union entry_info entry;
     enum entry_state state;
     struct namespace_info *ns_info;
-    enum element_type type;
     bool is_err = false;
+    bool ns_used;
     uint8_t ns;
 
     if (!flash_env)
@@ -1814,6 +2699,11 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
 
                 ns = tag_namespace_get(entry.tag);
                 if (ns == 0) {
+                    /* a namespace is listed once, even if a reset left two copies of it */
+                    ns_state_get(flash_env->ns_states, entry.value[0], &ns_used);
+                    if (ns_used)
+                        goto next_entry;
+
                     /* save namespace to list when find ns index = 0 */
                     ns_info = sys_malloc(sizeof(struct namespace_info));
                     if (!ns_info)
@@ -1829,28 +2719,36 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
                     /* save element hash list */
                 }
 
+next_entry:
                 /* entry index should skip element data if exist */
                 entry_idx++;
                 page->entry_cnt_used++;
 
-                type = tag_element_type_get(entry.tag);
-                if ((ELEMENT_MIDDLE == type) || (ELEMENT_BULK == type)) {
-                    entry_cnt = (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
-                    entry_idx += entry_cnt;
-                    /* record used entry idx */
-                    page->entry_cnt_used += entry_cnt;
-                }
+                entry_cnt = element_data_entry_cnt(&entry);
+                element_states_complete(flash_env, page, entry_idx, entry_cnt);
+                entry_idx += entry_cnt;
+                /* record used entry idx */
+                page->entry_cnt_used += entry_cnt;
             }
         }
 
         if (is_err) {
             list_push_back(&flash_env->nvds_page_free, &page->list_hdr);
         } else {
+            page_tail_check(flash_env, page);
             list_insert(&flash_env->nvds_page_used, &page->list_hdr, cmp_sequence_no);
             //co_list_push_back(&flash_env->nvds_page_used, &page->list_hdr);
         }
     }
 
+    /* finish or roll back interrupted transactions before counting */
+    if (txn_recover(flash_env, false))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    /* drop the copies left behind by an element move the reset interrupted */
+    if (element_dup_retire(flash_env))
+        return NVDS_ERR(NVDS_E_FAIL);
+
     /* walk used page list to record namespace used count */
     page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
     while (page) {
@@ -1876,12 +2774,7 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
                 }
             }
 
-            entry_idx++;
-            type = tag_element_type_get(entry.tag);
-            if ((ELEMENT_MIDDLE == type) || (ELEMENT_BULK == type)) {
-                entry_cnt = (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
-                entry_idx += entry_cnt;
-            }
+            entry_idx += entry_walk_step(state, &entry);
         }
 
         page = (struct page_env_tag*)list_next(&page->list_hdr);
@@ -1939,6 +2832,8 @@ static const char* element_type_string_get(enum element_type type)
         return "bulk";
     case ELEMENT_BULKINFO:
         return "bulk info";
+    case ELEMENT_TXN:
+        return "transaction";
     default:
         return "unknown";
     }
@@ -2295,6 +3190,7 @@ static void nvds_dump_namespace(struct nvds_flash_env_tag *flash_env, const char
 
 static int nvds_flash_env_init(struct nvds_flash_env_tag *flash_env, uint32_t start_addr, uint32_t size, const char *label)
 {
+    uint32_t page_cnt;
     int ret;
 
     /* Init nvds flash environment */
@@ -2314,11 +3210,30 @@ static int nvds_flash_env_init(struct nvds_flash_env_tag *flash_env, uint32_t st
     ret = pages_load(flash_env);
     NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
 
+    /* one page is always the current page, and one free page is needed to compact inline */
+    page_cnt = size / SPI_FLASH_SEC_SIZE;
+    flash_env->gc_watermark = NVDS_GC_FREE_PAGE_WATERMARK;
+    if (flash_env->gc_watermark + 2 > page_cnt)
+        flash_env->gc_watermark = (page_cnt > 2) ? (page_cnt - 2) : 1;
+
     list_push_back(&nvds_flash_list, &flash_env->list_hdr);
 
     return NVDS_ERR(NVDS_OK);
 }
 
+static void nvds_gc_start(void)
+{
+#ifdef NVDS_FLASH_GC_TASK_SUPPORT
+    /* without the task, the inline compaction in new_page_request() still applies */
+    if (!nvds_gc_task_handle)
+        nvds_gc_task_handle = (os_task_t)sys_task_create_dynamic((const uint8_t *)"nvds gc",
+                                    NVDS_GC_TASK_STACK_SIZE, NVDS_GC_TASK_PRIORITY, nvds_gc_task, NULL);
+#endif
+
+    /* erase the dirty free pages found at load */
+    nvds_gc_kick();
+}
+
 /*
  * EXPORTED FUNCTIONS DEFINITIONS
  ****************************************************************************************
@@ -2406,9 +3321,7 @@ int nvds_del_keys_by_namespace(void *handle, const char *namespace)
                 }
             }
 
-            entry_idx++;
-            if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
-                entry_idx += ((entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE);
+            entry_idx += entry_walk_step(state, &entry);
         }
 
         /* go to next used page */
@@ -2466,10 +3379,7 @@ int nvds_find_keys_by_namespace(void *handle, const char *namespace, found_keys_
                 }
             }
 
-            entry_idx++;
-            if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
-                entry_idx += ((entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE);
-
+            entry_idx += entry_walk_step(state, &entry);
         }
         page = (struct page_env_tag*)list_next(&page->list_hdr);
     }
@@ -2532,6 +3442,8 @@ void *nvds_flash_init(uint32_t start_addr, uint32_t size, const char *label)
     if (NVDS_ERR(NVDS_OK) != nvds_flash_env_init(flash_env, start_addr, size, label))
         goto exit;
 
+    nvds_gc_start();
+
     return (void *)flash_env;
 exit:
     if (nvds_mutex) {
@@ -2568,6 +3480,8 @@ int nvds_flash_internal_init(void)
     if (NVDS_ERR(NVDS_OK) != ret)
         goto exit;
 
+    nvds_gc_start();
+
     return ret;
 exit:
     if (nvds_mutex) {
@@ -2769,6 +3683,199 @@ void nvds_dump(void *handle, uint8_t verbose, const char *namespace)
 
     sys_mutex_put(&nvds_mutex);
 }
+
+void *nvds_txn_begin(void *handle)
+{
+    struct nvds_txn *txn;
+
+    txn = sys_malloc(sizeof(struct nvds_txn));
+    if (!txn)
+        return NULL;
+    sys_memset(txn, 0, sizeof(struct nvds_txn));
+
+    if (handle)
+        txn->flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        txn->flash_env = &nvds_flash_env;
+    list_init(&txn->op_list);
+
+    return (void *)txn;
+}
+
+static int txn_op_add(struct nvds_txn *txn, const char *namespace, const char *key,
+                        uint8_t *data, uint32_t length, bool del)
+{
+    struct nvds_txn_op *op;
+    struct nvds_txn_op *old;
+    uint32_t entry_cnt;
+    uint32_t old_cnt = 0;
+
+    if (!txn || !key || (strlen(key) > (KEY_NAME_MAX_SIZE - 1))
+        || (namespace && (strlen(namespace) > (KEY_NAME_MAX_SIZE - 1))))
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    /* the last operation on a key replaces the previous one */
+    old = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (old) {
+        if ((old->null_ns == !namespace) && !strcmp(old->key, key)
+            && (!namespace || !strcmp(old->namespace, namespace)))
+            break;
+        old = (struct nvds_txn_op *)list_next(&old->list_hdr);
+    }
+    if (old)
+        old_cnt = old->del ? 1 : element_entry_cnt(old->length);
+
+    /* BEGIN and COMMIT markers take two more entries of the same page */
+    entry_cnt = del ? 1 : element_entry_cnt(length);
+    if ((txn->entry_cnt - old_cnt + entry_cnt + 2) > ENTRY_COUNT_PER_PAGE)
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+
+    op = sys_malloc(sizeof(struct nvds_txn_op) + length);
+    if (!op)
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+    sys_memset(op, 0, sizeof(struct nvds_txn_op));
+
+    if (namespace)
+        sys_memcpy(op->namespace, namespace, strlen(namespace));
+    else
+        op->null_ns = true;
+    sys_memcpy(op->key, key, strlen(key));
+    op->del = del;
+    op->length = length;
+    if (length)
+        sys_memcpy(op->data, data, length);
+
+    if (old) {
+        list_extract(&txn->op_list, &old->list_hdr);
+        sys_mfree(old);
+    }
+    list_push_back(&txn->op_list, &op->list_hdr);
+    txn->entry_cnt = txn->entry_cnt - old_cnt + entry_cnt;
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+int nvds_txn_put(void *txn, const char *namespace, const char *key, uint8_t *data, uint32_t length)
+{
+    if (!data || (length == 0) || (length > TXN_ELEMENT_MAX_SIZE))
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    return txn_op_add((struct nvds_txn *)txn, namespace, key, data, length, false);
+}
+
+int nvds_txn_del(void *txn, const char *namespace, const char *key)
+{
+    return txn_op_add((struct nvds_txn *)txn, namespace, key, NULL, 0, true);
+}
+
+void nvds_txn_abort(void *txn)
+{
+    struct nvds_txn *t = (struct nvds_txn *)txn;
+    struct nvds_txn_op *op;
+
+    if (!t)
+        return;
+
+    while (!list_is_empty(&t->op_list)) {
+        op = (struct nvds_txn_op *)list_pop_front(&t->op_list);
+        if (!op)
+            break;
+        sys_mfree(op);
+    }
+
+    sys_mfree(t);
+}
+
+int nvds_txn_commit(void *txn)
+{
+    struct nvds_txn *t = (struct nvds_txn *)txn;
+    int ret;
+
+    if (!t)
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex)) {
+        nvds_txn_abort(txn);
+        return NVDS_ERR(NVDS_E_FAIL);
+    }
+
+    ret = txn_commit(t->flash_env, t);
+
+    sys_mutex_put(&nvds_mutex);
+    nvds_txn_abort(txn);
+    return ret;
+}
+
+int nvds_gc_step(void *handle)
+{
+    struct nvds_flash_env_tag *flash_env;
+    int ret;
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if (handle)
+        flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        flash_env = &nvds_flash_env;
+
+    ret = gc_step(flash_env);
+
+    sys_mutex_put(&nvds_mutex);
+    return ret;
+}
+
+int nvds_gc_watermark_set(void *handle, uint8_t free_pages)
+{
+    struct nvds_flash_env_tag *flash_env;
+    int ret = NVDS_ERR(NVDS_OK);
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if (handle)
+        flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        flash_env = &nvds_flash_env;
+
+    if ((free_pages == 0) || ((free_pages + 2) * SPI_FLASH_SEC_SIZE > flash_env->length)) {
+        ret = NVDS_ERR(NVDS_E_INVAL_PARAM);
+        goto exit;
+    }
+
+    flash_env->gc_watermark = free_pages;
+    nvds_gc_kick();
+
+exit:
+    sys_mutex_put(&nvds_mutex);
+    return ret;
+}
+
+int nvds_gc_stats_get(void *handle, struct nvds_gc_stats *stats, uint8_t reset)
+{
+    struct nvds_flash_env_tag *flash_env;
+
+    if (!stats)
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if (handle)
+        flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        flash_env = &nvds_flash_env;
+
+    *stats = flash_env->gc_stats;
+    stats->free_pages = list_cnt(&flash_env->nvds_page_free);
+    stats->watermark = flash_env->gc_watermark;
+
+    if (reset)
+        sys_memset(&flash_env->gc_stats, 0, sizeof(flash_env->gc_stats));
+
+    sys_mutex_put(&nvds_mutex);
+    return NVDS_ERR(NVDS_OK);
+}
 #else /* NVDS_FLASH_SUPPORT */
 int nvds_flash_internal_init()
 {
@@ -2813,4 +3920,43 @@ void nvds_dump(void *handle, uint8_t verbose, const char *namespace)
 {
     return;
 }
+
+void *nvds_txn_begin(void *handle)
+{
+    return NULL;
+}
+
+int nvds_txn_put(void *txn, const char *namespace, const char *key, uint8_t *data, uint32_t length)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+int nvds_txn_del(void *txn, const char *namespace, const char *key)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+int nvds_txn_commit(void *txn)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+void nvds_txn_abort(void *txn)
+{
+}
+
+int nvds_gc_step(void *handle)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+int nvds_gc_watermark_set(void *handle, uint8_t free_pages)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+int nvds_gc_stats_get(void *handle, struct nvds_gc_stats *stats, uint8_t reset)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
 #endif /* NVDS_FLASH_SUPPORT */
@@ -81,6 +81,28 @@ enum nvds_ret {
 #define NVDS_NS_WIFI_INFO               "wifi_info"
 
 typedef void (*found_keys_cb) (const char *namespace, const char *key, uint16_t val_len);
+
+// garbage collection statistics
+struct nvds_gc_stats {
+    // gc steps that did some work
+    uint32_t steps;
+    // pages reclaimed by the gc
+    uint32_t pages_reclaimed;
+    // pages erased by the gc, including the reclaimed ones
+    uint32_t pages_erased;
+    // entries moved by the gc out of the pages it reclaimed
+    uint32_t entries_relocated;
+    // page erases that had to run inline in a put
+    uint32_t fg_erase_cnt;
+    // page compactions that had to run inline in a put
+    uint32_t fg_gc_cnt;
+    // longest inline erase or compaction, in ms
+    uint32_t fg_max_ms;
+    // free pages currently available
+    uint8_t free_pages;
+    // free pages the gc keeps in reserve
+    uint8_t watermark;
+};
 /*
  * FUNCTION DECLARATIONS
  ****************************************************************************************
@@ -264,4 +286,133 @@ int nvds_clean(const char *nvds_label);
  */
 void nvds_dump(void *handle, uint8_t verbose, const char *namespace);
 
+/**
+ ****************************************************************************************
+ * @brief      Start a transaction
+ *
+ * Operations added with nvds_txn_put / nvds_txn_del are kept in memory and written
+ * by nvds_txn_commit as one batch: after a reset, either all of them or none of them
+ * are found in the nvds flash. The whole batch must fit in one flash page.
+ *
+ * \code{c}
+ * void *txn = nvds_txn_begin(NULL);
+ * nvds_txn_put(txn, namespace, "ssid", ssid, ssid_len);
+ * nvds_txn_put(txn, namespace, "psk", psk, psk_len);
+ * nvds_txn_del(txn, namespace, "bssid");
+ * int ret = nvds_txn_commit(txn);
+ * \endcode
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL indicate internal nvds flash
+ *
+ * @return If successful, handle of the transaction will be returned, otherwise return NULL.
+ ****************************************************************************************
+ */
+void *nvds_txn_begin(void *handle);
+
+/**
+ ****************************************************************************************
+ * @brief      Add an element write to a transaction
+ *
+ * A later put or delete of the same key in the transaction replaces this one.
+ *
+ * @param[in]  txn          Handle of the transaction
+ * @param[in]  namespace    Namespace of the element, NULL is for default namespace.
+ * @param[in]  key          Key name, shouldn't be empty.
+ * @param[in]  data         The value to set, copied by this function.
+ * @param[in]  length       Length of value, at most 256 bytes in a transaction.
+ *
+ * @return  NVDS_OK                 Operation added to the transaction
+ *          NVDS_E_INVAL_PARAM      Parameter is invalid, or value too long for a transaction
+ *          NVDS_E_NO_SPACE         No memory, or the transaction would not fit in one page
+ ****************************************************************************************
+ */
+int nvds_txn_put(void *txn, const char *namespace, const char *key, uint8_t *data, uint32_t length);
+
+/**
+ ****************************************************************************************
+ * @brief      Add an element delete to a transaction, deleting a missing key is not an error
+ *
+ * @param[in]  txn          Handle of the transaction
+ * @param[in]  namespace    Namespace of the element, NULL is for default namespace.
+ * @param[in]  key          Key name, shouldn't be empty.
+ *
+ * @return  NVDS_OK                 Operation added to the transaction
+ *          NVDS_E_INVAL_PARAM      Parameter is invalid
+ *          NVDS_E_NO_SPACE         No memory, or the transaction would not fit in one page
+ ****************************************************************************************
+ */
+int nvds_txn_del(void *txn, const char *namespace, const char *key);
+
+/**
+ ****************************************************************************************
+ * @brief      Write all the operations of a transaction and release it
+ *
+ * @param[in]  txn          Handle of the transaction, invalid after this call
+ *
+ * @return  NVDS_OK                 All the operations are written
+ *          NVDS_E_FAIL             Generic nvds fail status, nothing is written
+ *          NVDS_E_FLASH_IO_FAIL    Flash api fail, nothing is written unless the failure
+ *                                  happened after the commit point, in which case the
+ *                                  transaction is completed by the next gc step or
+ *                                  nvds initialization
+ *          NVDS_E_NO_SPACE         The transaction can not fit in the available space
+ ****************************************************************************************
+ */
+int nvds_txn_commit(void *txn);
+
+/**
+ ****************************************************************************************
+ * @brief      Drop all the operations of a transaction and release it
+ *
+ * @param[in]  txn          Handle of the transaction, invalid after this call
+ ****************************************************************************************
+ */
+void nvds_txn_abort(void *txn);
+
+/**
+ ****************************************************************************************
+ * @brief      Run one bounded garbage collection step
+ *
+ * A step either erases one free page ahead of time, moves one element out of the page
+ * being reclaimed, or erases that page once it holds no valid element. It is called from
+ * the nvds gc task when CONFIG_NVDS_GC_TASK is defined, and can be called from
+ * any other low priority context otherwise.
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL indicate internal nvds flash
+ *
+ * @return  NVDS_OK                 One step was performed, more work may be pending
+ *          NVDS_E_NOT_FOUND        Nothing to collect, free pages are above the watermark
+ *          NVDS_E_NO_SPACE         Not enough room left in the current page to move an element
+ *          NVDS_E_FLASH_IO_FAIL    Flash api, such as flash read/write/erase operation fail
+ ****************************************************************************************
+ */
+int nvds_gc_step(void *handle);
+
+/**
+ ****************************************************************************************
+ * @brief      Set the count of free pages the garbage collection keeps in reserve
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL indicate internal nvds flash
+ * @param[in]  free_pages   Free page watermark, between 1 and page count - 2
+ *
+ * @return  NVDS_OK                 Watermark updated
+ *          NVDS_E_INVAL_PARAM      Watermark out of range
+ ****************************************************************************************
+ */
+int nvds_gc_watermark_set(void *handle, uint8_t free_pages);
+
+/**
+ ****************************************************************************************
+ * @brief      Get garbage collection statistics
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL indicate internal nvds flash
+ * @param[out] stats        Statistics of the nvds flash storage
+ * @param[in]  reset        Clear the counters after reading them when set
+ *
+ * @return  NVDS_OK                 Statistics returned
+ *          NVDS_E_INVAL_PARAM      stats is NULL
+ ****************************************************************************************
+ */
+int nvds_gc_stats_get(void *handle, struct nvds_gc_stats *stats, uint8_t reset);
+
 #endif /* _NVDS_FLASH_H_ */
@@ -41,6 +41,7 @@ OF SUCH DAMAGE.
  ****************************************************************************************
  */
 #include "slist.h"
+#include "nvds_flash.h"
 #include "mbedtls/aes.h"
 #include "mbedtls/platform.h"
 #include "config_gdm32.h"
@@ -77,6 +78,19 @@ OF SUCH DAMAGE.
 // Entry states table
 #define ENTRY_STATES_TABLE_SIZE         (ENTRY_SIZE / sizeof(uint32_t))
 
+// Garbage collection
+// Reclaim pages from a low priority task instead of inline in nvds_data_put,
+// enabled with CONFIG_NVDS_GC_TASK in app_cfg.h
+#ifdef CONFIG_NVDS_GC_TASK
+#define NVDS_FLASH_GC_TASK_SUPPORT
+#endif
+#define NVDS_GC_TASK_STACK_SIZE         384
+#define NVDS_GC_TASK_PRIORITY           OS_TASK_PRIORITY(0)
+// Default count of free pages the gc keeps in reserve
+#define NVDS_GC_FREE_PAGE_WATERMARK     2
+// Reclaimable entries a page needs before it is compacted ahead of time
+#define NVDS_GC_MIN_RECLAIM_ENTRIES     (ENTRY_COUNT_PER_PAGE / 4)
+
 // Page offset definition
 // Page header offset of page
 #define PAGE_HEADER_OFFSET              0
@@ -121,6 +135,14 @@ OF SUCH DAMAGE.
 // valid count exclude 0, 254, 255
 #define NAMESPACE_MAX_CNT               253
 
+// transaction definition
+// Transaction markers use NAMESPACE_ANY_IDX, which never matches a lookup
+#define TXN_MARK_BEGIN                  0
+#define TXN_MARK_DEL                    1
+#define TXN_MARK_COMMIT                 2
+// Largest value a transaction accepts, it must fit without bulk fragments
+#define TXN_ELEMENT_MAX_SIZE            ELEMENT_MIDDLE_MAX_SIZE
+
 // cryption definition
 #define LABEL_NAME_MAX_SIZE             32
 #define LABEL_INNER_NVDS_FLASH          "inner_nvds"
@@ -148,6 +170,8 @@ enum element_type {
     ELEMENT_BULK,
     // bulkinfo element
     ELEMENT_BULKINFO,
+    // transaction marker element
+    ELEMENT_TXN,
     // any element
     ELEMENT_ANY = 7,
 };
@@ -262,6 +286,30 @@ struct page_env_tag
     bool need_erase;
 };
 
+struct nvds_txn_op
+{
+    struct list_hdr list_hdr;
+    char namespace[KEY_NAME_MAX_SIZE];
+    char key[KEY_NAME_MAX_SIZE];
+    // namespace is NULL, i.e. default namespace
+    bool null_ns;
+    // delete the key instead of writing it
+    bool del;
+    // namespace index, resolved at commit
+    uint8_t ns_idx;
+    uint16_t length;
+    uint8_t data[];
+};
+
+struct nvds_txn
+{
+    struct nvds_flash_env_tag *flash_env;
+    // pending operations, one per key
+    struct list op_list;
+    // entries the operations take in flash, markers excluded
+    uint32_t entry_cnt;
+};
+
 struct nvds_crypt_env {
     mbedtls_aes_context ctx;
     uint8_t key[AES_KEY_SZ];
@@ -288,6 +336,17 @@ struct nvds_flash_env_tag {
     struct list nvds_page_free;
     // used page list
     struct list nvds_page_used;
+
+    // page being reclaimed by the gc, NULL when idle
+    struct page_env_tag *gc_page;
+    // next entry of gc_page to look at
+    uint8_t gc_entry_idx;
+    // count of free pages the gc keeps in reserve
+    uint8_t gc_watermark;
+    // gc statistics
+    struct nvds_gc_stats gc_stats;
+    // set when a transaction failed after its commit point, settled before moving elements
+    uint8_t txn_pending;
 };
 
 #endif /* _NVDS_TYPE_H_ */
@@ -42,6 +42,7 @@ OF SUCH DAMAGE.
 #include "ll.h"
 #include "app_cfg.h"
 #include "config_gdm32.h"
+#include "systime.h"
 
 // Flash erase callback list
 static struct list raw_erase_cb_list;
@@ -52,6 +53,108 @@ typedef struct
     raw_flash_erase_handler_t callback;
 } raw_erase_cb_list_item_t;
 
+// Flash operation statistics
+static raw_flash_stats_t raw_flash_stats;
+
+// Serializes the flash operations of the tasks, the raw flash task included
+static os_mutex_t raw_flash_mutex;
+
+#ifdef RAW_FLASH_QUEUE_SUPPORT
+typedef struct
+{
+    struct list_hdr hdr;
+    raw_flash_op_t op;
+    raw_flash_prio_t prio;
+    uint32_t offset;
+    uint8_t *data;
+    int len;
+    // bytes already served
+    int done;
+    uint32_t submit_time;
+    raw_flash_done_cb_t cb;
+    void *arg;
+} raw_flash_req_t;
+
+// Pending requests, one FIFO per priority
+static struct list raw_flash_req_list[RAW_FLASH_PRIO_MAX];
+static os_task_t raw_flash_task_handle;
+
+static void raw_flash_task(void *param);
+#endif
+
+/*!
+    \brief      add a value to a statistics histogram
+    \param[in]  hist: histogram of RAW_FLASH_HIST_BINS bins
+    \param[in]  base: upper bound of the first bin, each following bin is 4 times wider
+    \param[in]  value: value to add
+    \param[out] none
+    \retval     none
+*/
+static void raw_flash_hist_add(uint32_t *hist, uint32_t base, uint32_t value)
+{
+    uint32_t bin = 0;
+
+    while ((bin < RAW_FLASH_HIST_BINS - 1) && (value >= base)) {
+        base <<= 2;
+        bin++;
+    }
+    hist[bin]++;
+}
+
+/*!
+    \brief      record an interrupt disabled window, called before interrupts are restored
+    \param[in]  start_us: time the interrupts were disabled, in us
+    \param[out] none
+    \retval     none
+*/
+static void raw_flash_irq_off_record(uint32_t start_us)
+{
+    uint32_t duration = (uint32_t)get_sys_local_time_us() - start_us;
+
+    raw_flash_hist_add(raw_flash_stats.irq_off_hist, RAW_FLASH_IRQ_HIST_BASE_US, duration);
+    if (duration > raw_flash_stats.irq_off_max_us)
+        raw_flash_stats.irq_off_max_us = duration;
+}
+
+/*!
+    \brief      check if the caller runs in an interrupt or exception handler
+    \param[in]  none
+    \param[out] none
+    \retval     1 in a handler, 0 in a task or before the scheduler is started
+*/
+static int raw_flash_in_handler(void)
+{
+    return (__RV_CSR_READ(CSR_MSUBM) & MSUBM_TYP) ? 1 : 0;
+}
+
+/*!
+    \brief      take the raw flash lock
+                A handler, such as the crash dump of the exception handler, goes without it
+    \param[in]  none
+    \param[out] none
+    \retval     1 if the lock is taken and must be released, 0 otherwise
+*/
+static int raw_flash_lock(void)
+{
+    if (!raw_flash_mutex || raw_flash_in_handler())
+        return 0;
+
+    sys_mutex_get(&raw_flash_mutex);
+    return 1;
+}
+
+/*!
+    \brief      release the raw flash lock
+    \param[in]  locked: value returned by raw_flash_lock
+    \param[out] none
+    \retval     none
+*/
+static void raw_flash_unlock(int locked)
+{
+    if (locked)
+        sys_mutex_put(&raw_flash_mutex);
+}
+
 /*!
     \brief      flash initilization
     \param[in]  none
@@ -60,7 +163,23 @@ typedef struct
 */
 void raw_flash_init(void)
 {
+#ifdef RAW_FLASH_QUEUE_SUPPORT
+    int prio;
+#endif
+
     list_init(&raw_erase_cb_list);
+
+    if (!raw_flash_mutex)
+        sys_mutex_init(&raw_flash_mutex);
+
+#ifdef RAW_FLASH_QUEUE_SUPPORT
+    for (prio = 0; prio < RAW_FLASH_PRIO_MAX; prio++)
+        list_init(&raw_flash_req_list[prio]);
+
+    if (!raw_flash_task_handle)
+        raw_flash_task_handle = (os_task_t)sys_task_create_dynamic((const uint8_t *)"raw flash",
+                                    RAW_FLASH_TASK_STACK_SIZE, RAW_FLASH_TASK_PRIORITY, raw_flash_task, NULL);
+#endif
 }
 
 /*!
@@ -156,35 +275,48 @@ void raw_flash_offset_mapping(uint32_t of_spage, uint32_t of_epage, uint32_t of_
 */
 int raw_flash_read(uint32_t offset, void *data, int len)
 {
-    int ret;
+    int ret = 0;
     uint32_t fmc_ofvr_temp = FMC_OFVR;
+    uint32_t start_us;
+    int done;
+    int slice;
+    int locked;
 
     if (!raw_flash_is_valid_offset(offset) || data == NULL
         || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
         return -1;
     }
 
+    locked = raw_flash_lock();
 
     if (fmc_ofvr_temp > 0) {                                                //working on image 1
         if (offset >= RE_IMG_0_OFFSET && offset < RE_IMG_1_OFFSET) {       //read flash from image 0
-            __disable_irq();
-
-            // reset FMC_OFVR to 0
-            fmc_unlock();
-            ob_unlock();
-            fmc_offset_value_config(0);
-            ob_lock();
-            fmc_lock();
-
-            ret = rom_flash_read(offset, data, len);
-
-            // recovery FMC_OFVR value
-            fmc_unlock();
-            ob_unlock();
-            fmc_offset_value_config(fmc_ofvr_temp);
-            ob_lock();
-            fmc_lock();
-            __enable_irq();
+            // the code runs from the remapped image, bound the interrupt disabled window
+            for (done = 0; (done < len) && !ret; done += slice) {
+                slice = ((len - done) > RAW_FLASH_READ_SLICE) ? RAW_FLASH_READ_SLICE : (len - done);
+
+                __disable_irq();
+                start_us = (uint32_t)get_sys_local_time_us();
+
+                // reset FMC_OFVR to 0
+                fmc_unlock();
+                ob_unlock();
+                fmc_offset_value_config(0);
+                ob_lock();
+                fmc_lock();
+
+                ret = rom_flash_read(offset + done, (uint8_t *)data + done, slice);
+
+                // recovery FMC_OFVR value
+                fmc_unlock();
+                ob_unlock();
+                fmc_offset_value_config(fmc_ofvr_temp);
+                ob_lock();
+                fmc_lock();
+
+                raw_flash_irq_off_record(start_us);
+                __enable_irq();
+            }
         } else if (offset >= RE_IMG_1_OFFSET && offset < RE_IMG_1_END){                                                          //read flash from image 1
             ret = rom_flash_read(offset - (RE_IMG_1_OFFSET - RE_IMG_0_OFFSET), data, len);
         } else {
@@ -192,30 +324,39 @@ int raw_flash_read(uint32_t offset, void *data, int len)
         }
     } else {                                                         //working on image 0
         if (offset >= RE_IMG_1_OFFSET && offset < RE_IMG_1_END) {        //read flash from image 1
-            __disable_irq();
-
-            fmc_unlock();
-            ob_unlock();
-            fmc_offset_region_config(RE_IMG_0_OFFSET >> 12, (RE_IMG_1_OFFSET >> 12) - 1);
-            fmc_offset_value_config((RE_IMG_1_OFFSET - RE_IMG_0_OFFSET) >> 12);
-            ob_lock();
-            fmc_lock();
-
-            ret = rom_flash_read(offset - (RE_IMG_1_OFFSET - RE_IMG_0_OFFSET), data, len);
-
-            fmc_unlock();
-            ob_unlock();
-            fmc_offset_region_config(0x1fff, 0);
-            fmc_offset_value_config(0);
-            ob_lock();
-            fmc_lock();
-
-            __enable_irq();
+            for (done = 0; (done < len) && !ret; done += slice) {
+                slice = ((len - done) > RAW_FLASH_READ_SLICE) ? RAW_FLASH_READ_SLICE : (len - done);
+
+                __disable_irq();
+                start_us = (uint32_t)get_sys_local_time_us();
+
+                fmc_unlock();
+                ob_unlock();
+                fmc_offset_region_config(RE_IMG_0_OFFSET >> 12, (RE_IMG_1_OFFSET >> 12) - 1);
+                fmc_offset_value_config((RE_IMG_1_OFFSET - RE_IMG_0_OFFSET) >> 12);
+                ob_lock();
+                fmc_lock();
+
+                ret = rom_flash_read(offset + done - (RE_IMG_1_OFFSET - RE_IMG_0_OFFSET),
+                                     (uint8_t *)data + done, slice);
+
+                fmc_unlock();
+                ob_unlock();
+                fmc_offset_region_config(0x1fff, 0);
+                fmc_offset_value_config(0);
+                ob_lock();
+                fmc_lock();
+
+                raw_flash_irq_off_record(start_us);
+                __enable_irq();
+            }
         } else {                        //read flash from image 0 and other partition
             ret = rom_flash_read(offset, data, len);
         }
     }
 
+    raw_flash_unlock(locked);
+
     return ret;
 }
 
@@ -277,12 +418,19 @@ static void redirect_vector_free(uint32_t *vector_addr)
 */
 int raw_flash_write(uint32_t offset, const void *data, int len)
 {
+    int locked;
+    int ret;
+
     if (!raw_flash_is_valid_offset(offset) || data == NULL
         || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
         return -1;
     }
 
-    if (rom_flash_write(offset, data, len)) {
+    locked = raw_flash_lock();
+    ret = rom_flash_write(offset, data, len);
+    raw_flash_unlock(locked);
+
+    if (ret) {
         return -1;
     }
 
@@ -361,7 +509,10 @@ void raw_flash_erase_handler_unregister(raw_flash_erase_handler_t callback)
 */
 int raw_flash_erase(uint32_t offset, int len)
 {
-    int ret;
+    int ret = 0;
+    uint32_t start_us;
+    int slice;
+    int locked;
 
     if (!raw_flash_is_valid_offset(offset)
         || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
@@ -375,9 +526,25 @@ int raw_flash_erase(uint32_t offset, int len)
     /* redirect vector table to sram */
     VECTOR_SRAM_ENTER();
 
-    GLOBAL_INT_DISABLE();
-    ret = rom_flash_erase(offset, len);
-    GLOBAL_INT_RESTORE();
+    locked = raw_flash_lock();
+
+    /* erase sector by sector, pending interrupts are served in between */
+    while ((len > 0) && !ret) {
+        slice = RAW_FLASH_ERASE_SLICE - (offset & (RAW_FLASH_ERASE_SLICE - 1));
+        if (slice > len)
+            slice = len;
+
+        GLOBAL_INT_DISABLE();
+        start_us = (uint32_t)get_sys_local_time_us();
+        ret = rom_flash_erase(offset, slice);
+        raw_flash_irq_off_record(start_us);
+        GLOBAL_INT_RESTORE();
+
+        offset += slice;
+        len -= slice;
+    }
+
+    raw_flash_unlock(locked);
 
     /* restore vector table */
     VECTOR_SRAM_RESTORE();
@@ -400,6 +567,10 @@ int raw_flash_erase(uint32_t offset, int len)
 int raw_flash_write_fast(uint32_t offset, const void *data, int len)
 {
     int ret = 0;
+    uint32_t start_us;
+    int done;
+    int slice;
+    int locked;
 
     if (!raw_flash_is_valid_offset(offset) || data == NULL
         || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
@@ -422,19 +593,33 @@ int raw_flash_write_fast(uint32_t offset, const void *data, int len)
     /* redirect vector table to sram */
     VECTOR_SRAM_ENTER();
 
+    /* the unaligned head and tail are written by raw_flash_write, which takes the lock itself */
+    locked = raw_flash_lock();
+
     /* unlock the flash program erase controller */
     fmc_unlock();
     /* clear pending flags */
     fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR);
 
-    /* prevent interrupt handler from reading flash, it will disrupt the flash continuous programming pipeline */
-    GLOBAL_INT_DISABLE();
-    ret = fmc_continuous_program(FLASH_BASE + offset + r, (uint32_t *)(data + r), len - r - rr);
-    GLOBAL_INT_RESTORE();
+    /* prevent interrupt handler from reading flash, it will disrupt the flash continuous programming pipeline,
+       the data is programmed in slices so that pending interrupts are served in between */
+    for (done = r; (done < len - rr) && !ret; done += slice) {
+        slice = ((len - rr - done) > RAW_FLASH_WRITE_SLICE) ? RAW_FLASH_WRITE_SLICE : (len - rr - done);
+
+        GLOBAL_INT_DISABLE();
+        start_us = (uint32_t)get_sys_local_time_us();
+        ret = fmc_continuous_program(FLASH_BASE + offset + done, (uint32_t *)(data + done), slice);
+        if (ret == FMC_READY)
+            ret = fmc_ready_wait(FMC_TIMEOUT_COUNT);
+        raw_flash_irq_off_record(start_us);
+        GLOBAL_INT_RESTORE();
+    }
 
     /* lock the flash program erase controller */
     fmc_lock();
 
+    raw_flash_unlock(locked);
+
     /* restore vector table */
     VECTOR_SRAM_RESTORE();
 
@@ -445,3 +630,286 @@ int raw_flash_write_fast(uint32_t offset, const void *data, int len)
     }
     return ret;
 }
+
+/*!
+    \brief      do the first slice of a flash operation, the slice ends at the slice size of the
+                operation or, for an erase, at the sector boundary
+    \param[in]  op: operation to perform
+    \param[in]  offset: flash offset
+    \param[in]  data: buffer to read into or write from, unused for erase
+    \param[in]  len: length left of the operation
+    \param[out] none
+    \retval     length of the slice, or -1 on error
+*/
+static int raw_flash_slice(raw_flash_op_t op, uint32_t offset, uint8_t *data, int len)
+{
+    int ret;
+
+    switch (op) {
+    case RAW_FLASH_OP_READ:
+        if (len > RAW_FLASH_READ_SLICE)
+            len = RAW_FLASH_READ_SLICE;
+        ret = raw_flash_read(offset, data, len);
+        break;
+    case RAW_FLASH_OP_WRITE:
+        if (len > RAW_FLASH_WRITE_SLICE)
+            len = RAW_FLASH_WRITE_SLICE;
+        ret = raw_flash_write(offset, data, len);
+        break;
+    default:
+        if (len > (int)(RAW_FLASH_ERASE_SLICE - (offset & (RAW_FLASH_ERASE_SLICE - 1))))
+            len = RAW_FLASH_ERASE_SLICE - (offset & (RAW_FLASH_ERASE_SLICE - 1));
+        ret = raw_flash_erase(offset, len);
+        break;
+    }
+
+    return ret ? -1 : len;
+}
+
+/*!
+    \brief      record the completion of a flash operation, called in a critical section
+    \param[in]  submit_time: time the operation was submitted, in ms
+    \param[in]  status: result of the operation
+    \param[out] none
+    \retval     none
+*/
+static void raw_flash_done_record(uint32_t submit_time, int status)
+{
+    uint32_t latency = sys_current_time_get() - submit_time;
+
+    if (status)
+        raw_flash_stats.fail_cnt++;
+    raw_flash_hist_add(raw_flash_stats.lat_hist, RAW_FLASH_LAT_HIST_BASE_MS, latency);
+    if (latency > raw_flash_stats.lat_max_ms)
+        raw_flash_stats.lat_max_ms = latency;
+}
+
+#ifdef RAW_FLASH_QUEUE_SUPPORT
+/*!
+    \brief      get the oldest request of the highest pending priority
+    \param[in]  none
+    \param[out] none
+    \retval     request, or NULL if the queue is empty
+*/
+static raw_flash_req_t *raw_flash_req_pick(void)
+{
+    raw_flash_req_t *req = NULL;
+    int prio;
+
+    sys_enter_critical();
+    for (prio = RAW_FLASH_PRIO_MAX - 1; prio >= 0; prio--) {
+        req = (raw_flash_req_t *)list_pick(&raw_flash_req_list[prio]);
+        if (req)
+            break;
+    }
+    sys_exit_critical();
+
+    return req;
+}
+
+/*!
+    \brief      serve one slice of a request
+    \param[in]  req: request to serve
+    \param[out] none
+    \retval     result of the slice(0: ok, or -1: error)
+*/
+static int raw_flash_req_slice(raw_flash_req_t *req)
+{
+    int slice = raw_flash_slice(req->op, req->offset + req->done,
+                                req->data + req->done, req->len - req->done);
+
+    if (slice < 0)
+        return -1;
+
+    req->done += slice;
+    return 0;
+}
+
+/*!
+    \brief      raw flash task, serves the queued requests slice by slice
+    \param[in]  param: unused
+    \param[out] none
+    \retval     none
+*/
+static void raw_flash_task(void *param)
+{
+    raw_flash_req_t *req;
+    raw_flash_req_t *partial = NULL;
+    int ret;
+
+    for (;;) {
+        req = raw_flash_req_pick();
+        if (req == NULL) {
+            sys_task_wait_notification(-1);
+            continue;
+        }
+
+        /* a partly served request is resumed once no higher priority one is pending */
+        if (partial && (partial != req))
+            raw_flash_stats.suspend_cnt++;
+
+        ret = raw_flash_req_slice(req);
+        if (!ret && (req->done < req->len)) {
+            partial = req;
+            /* give the ready tasks of the same priority a chance between two slices */
+            sys_yield();
+            continue;
+        }
+        partial = NULL;
+
+        sys_enter_critical();
+        list_extract(&raw_flash_req_list[req->prio], &req->hdr);
+        raw_flash_stats.queue_depth--;
+        raw_flash_done_record(req->submit_time, ret);
+        sys_exit_critical();
+
+        if (req->cb)
+            req->cb(req->arg, ret);
+
+        sys_mfree(req);
+    }
+}
+#endif
+
+/*!
+    \brief      queue a flash operation, served by the raw flash task in slices
+    \param[in]  op: operation to perform
+    \param[in]  offset: flash offset
+    \param[in]  data: buffer to read into or write from, unused for erase. It must stay valid
+                      until the callback is called
+    \param[in]  len: length of the operation
+    \param[in]  prio: priority of the request, a higher one suspends a lower one between slices
+    \param[in]  cb: callback called from the raw flash task on completion, may be NULL. It runs
+                    on the small stack of the raw flash task and holds up the following requests,
+                    it must neither block nor call the raw flash API
+    \param[in]  arg: argument of the callback
+    \param[out] none
+    \retval     result of submit(0: queued, or -1: error). Without RAW_FLASH_QUEUE_SUPPORT the
+                operation is done and the callback called before returning
+*/
+int raw_flash_submit(raw_flash_op_t op, uint32_t offset, void *data, int len,
+                     raw_flash_prio_t prio, raw_flash_done_cb_t cb, void *arg)
+{
+#ifdef RAW_FLASH_QUEUE_SUPPORT
+    raw_flash_req_t *req;
+#else
+    int ret;
+#endif
+
+    if ((op >= RAW_FLASH_OP_MAX) || (prio >= RAW_FLASH_PRIO_MAX)
+        || ((op != RAW_FLASH_OP_ERASE) && (data == NULL))
+        || !raw_flash_is_valid_offset(offset)
+        || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
+        return -1;
+    }
+
+#ifdef RAW_FLASH_QUEUE_SUPPORT
+    if (!raw_flash_task_handle)
+        return -1;
+
+    req = (raw_flash_req_t *)sys_malloc(sizeof(raw_flash_req_t));
+    if (req == NULL)
+        return -1;
+
+    sys_memset(req, 0, sizeof(raw_flash_req_t));
+    req->op = op;
+    req->prio = prio;
+    req->offset = offset;
+    req->data = (uint8_t *)data;
+    req->len = len;
+    req->cb = cb;
+    req->arg = arg;
+    req->submit_time = sys_current_time_get();
+
+    sys_enter_critical();
+    list_push_back(&raw_flash_req_list[prio], &req->hdr);
+    raw_flash_stats.req_cnt[op]++;
+    raw_flash_stats.queue_depth++;
+    if (raw_flash_stats.queue_depth > raw_flash_stats.queue_max)
+        raw_flash_stats.queue_max = raw_flash_stats.queue_depth;
+    sys_exit_critical();
+
+    sys_task_notify(raw_flash_task_handle, false);
+
+    return 0;
+#else
+    raw_flash_stats.req_cnt[op]++;
+    if (op == RAW_FLASH_OP_READ)
+        ret = raw_flash_read(offset, data, len);
+    else if (op == RAW_FLASH_OP_WRITE)
+        ret = raw_flash_write(offset, data, len);
+    else
+        ret = raw_flash_erase(offset, len);
+    if (ret) {
+        raw_flash_stats.fail_cnt++;
+        ret = -1;
+    }
+
+    if (cb)
+        cb(arg, ret);
+
+    return 0;
+#endif
+}
+
+/*!
+    \brief      do a flash operation in the caller's context, slice by slice like a queued request
+                The raw flash lock is released between two slices, so the flash operations of
+                other tasks get in between, the waiting task of the highest priority first. The
+                lock passes the priority of a waiting task on to the task holding it
+    \param[in]  op: operation to perform
+    \param[in]  offset: flash offset
+    \param[in]  data: buffer to read into or write from, unused for erase
+    \param[in]  len: length of the operation
+    \param[out] none
+    \retval     result of the operation(0: ok, or -1: error)
+*/
+int raw_flash_sliced_op(raw_flash_op_t op, uint32_t offset, void *data, int len)
+{
+    uint32_t submit_time;
+    int done;
+    int slice = 0;
+
+    if ((op >= RAW_FLASH_OP_MAX)
+        || ((op != RAW_FLASH_OP_ERASE) && (data == NULL))
+        || !raw_flash_is_valid_offset(offset)
+        || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
+        return -1;
+    }
+
+    submit_time = sys_current_time_get();
+    sys_enter_critical();
+    raw_flash_stats.req_cnt[op]++;
+    sys_exit_critical();
+
+    for (done = 0; (done < len) && (slice >= 0); done += slice)
+        slice = raw_flash_slice(op, offset + done, (uint8_t *)data + done, len - done);
+
+    sys_enter_critical();
+    raw_flash_done_record(submit_time, (slice < 0) ? -1 : 0);
+    sys_exit_critical();
+
+    return (slice < 0) ? -1 : 0;
+}
+
+/*!
+    \brief      get flash operation statistics
+    \param[in]  reset: clear the counters and histograms after reading them, queue depth is kept
+    \param[out] stats: pointer to the statistics
+    \retval     none
+*/
+void raw_flash_stats_get(raw_flash_stats_t *stats, int reset)
+{
+    uint32_t depth;
+
+    sys_enter_critical();
+    if (stats)
+        sys_memcpy(stats, &raw_flash_stats, sizeof(raw_flash_stats_t));
+    if (reset) {
+        depth = raw_flash_stats.queue_depth;
+        sys_memset(&raw_flash_stats, 0, sizeof(raw_flash_stats_t));
+        raw_flash_stats.queue_depth = depth;
+        raw_flash_stats.queue_max = depth;
+    }
+    sys_exit_critical();
+}
@@ -40,6 +40,22 @@ OF SUCH DAMAGE.
 
 #define FLASH_TOTAL_SIZE            FLASH_SIZE_SIP
 
+// Queued flash operations served by the raw flash task
+#define RAW_FLASH_QUEUE_SUPPORT
+// In words, the completion callbacks run on this stack
+#define RAW_FLASH_TASK_STACK_SIZE   512
+#define RAW_FLASH_TASK_PRIORITY     OS_TASK_PRIORITY(1)
+
+// Longest span handled with interrupts disabled in one go, longer operations are split
+#define RAW_FLASH_ERASE_SLICE       FLASH_PAGE_SIZE
+#define RAW_FLASH_WRITE_SLICE       256
+#define RAW_FLASH_READ_SLICE        1024
+
+// Histogram bin i counts values below (base << (2 * i)), the last bin counts the rest
+#define RAW_FLASH_HIST_BINS         8
+#define RAW_FLASH_LAT_HIST_BASE_MS  1
+#define RAW_FLASH_IRQ_HIST_BASE_US  16
+
 typedef enum
 {
     RAW_FLASH_ERASE_BLE_PRE_HANDLE,
@@ -48,6 +64,43 @@ typedef enum
 
 typedef void (*raw_flash_erase_handler_t)(raw_erase_type_t type);
 
+typedef enum
+{
+    RAW_FLASH_OP_READ,
+    RAW_FLASH_OP_WRITE,
+    RAW_FLASH_OP_ERASE,
+    RAW_FLASH_OP_MAX,
+} raw_flash_op_t;
+
+// Requests of a higher priority are served first, a lower one is suspended between slices
+typedef enum
+{
+    RAW_FLASH_PRIO_LOW,
+    RAW_FLASH_PRIO_NORMAL,
+    RAW_FLASH_PRIO_HIGH,
+    RAW_FLASH_PRIO_MAX,
+} raw_flash_prio_t;
+
+// Called from the raw flash task, status is 0 on success or -1 on error. It must be short,
+// it must neither block nor call the raw flash API
+typedef void (*raw_flash_done_cb_t)(void *arg, int status);
+
+typedef struct
+{
+    uint32_t req_cnt[RAW_FLASH_OP_MAX];
+    uint32_t fail_cnt;
+    // times a partly done request was put aside for a higher priority one
+    uint32_t suspend_cnt;
+    uint32_t queue_depth;
+    uint32_t queue_max;
+    // submit to completion
+    uint32_t lat_hist[RAW_FLASH_HIST_BINS];
+    uint32_t lat_max_ms;
+    // every interrupt disabled window of the flash operations, queued or not
+    uint32_t irq_off_hist[RAW_FLASH_HIST_BINS];
+    uint32_t irq_off_max_us;
+} raw_flash_stats_t;
+
 void raw_flash_init(void);
 uint32_t raw_flash_total_size(void);
 int raw_flash_is_valid_offset(uint32_t offset);
@@ -60,5 +113,9 @@ int raw_flash_erase(uint32_t offset, int len);
 int raw_flash_erase_handler_register(raw_flash_erase_handler_t callback);
 void raw_flash_erase_handler_unregister(raw_flash_erase_handler_t callback);
 int raw_flash_write_fast(uint32_t offset, const void *data, int len);
+int raw_flash_submit(raw_flash_op_t op, uint32_t offset, void *data, int len,
+                     raw_flash_prio_t prio, raw_flash_done_cb_t cb, void *arg);
+int raw_flash_sliced_op(raw_flash_op_t op, uint32_t offset, void *data, int len);
+void raw_flash_stats_get(raw_flash_stats_t *stats, int reset);
 
 #endif
@@ -36,12 +36,13 @@ OF SUCH DAMAGE.
 #include <stdint.h>
 #include "dbg_print.h"
 #include "wakelock.h"
-#include "tickless_sleep.h"
 #include "gd32vw55x_platform.h"
 #include "systime.h"
 #include "gd32vw55x.h"
 #include "wrapper_os.h"
+#include "tickless_sleep.h"
 #include "FreeRTOS.h"
+#include "ll.h"
 
 #ifdef CFG_WLAN_SUPPORT
 #include "wlan_config.h"
@@ -57,6 +58,13 @@ extern uint64_t xMaximumPossibleSuppressedTicks;
 /* maybe need wrap it as sys_task_step_tick later */
 extern void vTaskStepTick(const uint64_t xTicksToJump);
 
+static uint8_t sleep_state;             // state chosen by the pre sleep processing
+static uint64_t sleep_start_us;
+static uint32_t sleep_avg_us = DEEP_SLEEP_MAX_TIME_MS * 1000;   // average of the real sleep lengths
+static uint32_t sleep_stats_start;
+static sys_sleep_stats_t sleep_stats;
+static uint8_t sleep_refused;           // a refusal was counted since the last sleep
+
 void freertos_cpu_sleep_time_get(uint32_t *stats_ms, uint32_t *sleep_ms)
 {
 #if configGENERATE_RUN_TIME_STATS
@@ -74,8 +82,75 @@ void freertos_cpu_sleep_time_get(uint32_t *stats_ms, uint32_t *sleep_ms)
 #endif
 }
 
+/*!
+    \brief      account a finished sleep, IRQs must be disabled
+    \param[in]  state: sleep state used
+    \param[in]  slept_us: time spent in the sleep state
+    \param[in]  timer_wake: 1 if the sleep ran until the scheduled wakeup, 0 if another interrupt ended it
+    \param[out] none
+    \retval     none
+*/
+static void tickless_sleep_account(uint8_t state, uint64_t slept_us, int timer_wake)
+{
+    uint32_t us = (slept_us > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t)slept_us;
+
+    sleep_stats.enter_cnt[state]++;
+    sleep_stats.residency_us[state] += slept_us;
+    if (timer_wake)
+        sleep_stats.wake_timer_cnt++;
+    else
+        sleep_stats.wake_irq_cnt++;
+
+    sleep_avg_us = sleep_avg_us - (sleep_avg_us >> 3) + (us >> 3);
+}
+
+/*!
+    \brief      choose the sleep state for a predicted idle length
+                Note: the kernel only knows the next timeout, interrupts driven
+                wakeups are taken into account with the average of the last sleeps.
+    \param[in]  expected_ms: time to the next timeout of the kernel
+    \param[out] none
+    \retval     sleep state
+*/
+static uint8_t tickless_sleep_state_select(uint32_t expected_ms)
+{
+    uint32_t predicted_ms = expected_ms;
+
+    if (sys_ps_get() != SYS_PS_DEEP_SLEEP)
+        return SYS_SLEEP_WFI;
+
+    /* twice the average sleep, in ms */
+    if (predicted_ms > sleep_avg_us / 500)
+        predicted_ms = sleep_avg_us / 500;
+
+    if (predicted_ms >= DEEP_SLEEP_MIN_TIME_MS)
+        return SYS_SLEEP_DEEP;
+    if (predicted_ms >= LIGHT_SLEEP_MIN_TIME_MS)
+        return SYS_SLEEP_LIGHT;
+    return SYS_SLEEP_WFI;
+}
+
+/*!
+    \brief      get the sleep statistics of the idle task
+    \param[in]  reset: restart the statistics after reading them
+    \param[out] stats: sleep statistics
+    \retval     none
+*/
+void freertos_sleep_stats_get(sys_sleep_stats_t *stats, int reset)
+{
+    GLOBAL_INT_DISABLE();
+    *stats = sleep_stats;
+    stats->stats_ms = sys_current_time_get() - sleep_stats_start;
+    if (reset) {
+        sys_memset(&sleep_stats, 0, sizeof(sleep_stats));
+        sleep_stats_start = sys_current_time_get();
+    }
+    GLOBAL_INT_RESTORE();
+}
+
 void freertos_pre_sleep_processing(unsigned long long *expected_idle_time)
 {
+    uint32_t expected_ms;
     uint16_t sleep_time;
     struct time_rtc time_before_sleep;
     struct time_rtc time_after_sleep;
@@ -83,12 +158,22 @@ void freertos_pre_sleep_processing(unsigned long long *expected_idle_time)
     volatile uint64_t passed_time;
     volatile uint64_t sys_timer_val, pass_timer_cnt;
 
-    if (sys_ps_get() == SYS_PS_DEEP_SLEEP) {
-        if (*expected_idle_time < xMaximumPossibleSuppressedTicks) {
-            sleep_time = DEEP_SLEEP_MIN_TIME_MS;
-        } else {
-            sleep_time = DEEP_SLEEP_MAX_TIME_MS;
-        }
+    if (*expected_idle_time < xMaximumPossibleSuppressedTicks
+        && *expected_idle_time * portTICK_PERIOD_MS < DEEP_SLEEP_MAX_TIME_MS) {
+        expected_ms = *expected_idle_time * portTICK_PERIOD_MS;
+    } else {
+        expected_ms = DEEP_SLEEP_MAX_TIME_MS;
+    }
+
+    sleep_state = tickless_sleep_state_select(expected_ms);
+    if (sleep_state != SYS_SLEEP_DEEP) {
+        /* the WFI is done by the port, SysTimer keeps running */
+        if (sleep_state == SYS_SLEEP_LIGHT)
+            rcu_fmc_clock_sleep_disable();
+        sleep_start_us = get_sys_local_time_us();
+    } else {
+        /* wake up in time for the next timeout instead of a fixed sleep time */
+        sleep_time = expected_ms;
 
         rtc_32k_time_get(&time_before_sleep, 0);
         //dbg_print(INFO, "time_before_sleep sec %d msec %d\r\n\n", time_before_sleep.tv_sec, time_before_sleep.tv_msec);
@@ -139,19 +224,38 @@ void freertos_pre_sleep_processing(unsigned long long *expected_idle_time)
 #if configGENERATE_RUN_TIME_STATS
         cpu_sleep_ms += passed_time;
 #endif
+        tickless_sleep_account(SYS_SLEEP_DEEP, passed_time * 1000, passed_time + 1 >= sleep_time);
     }
 }
 
 void freertos_post_sleep_processing(unsigned long long *expected_idle_time)
 {
-    if (sys_ps_get() == SYS_PS_DEEP_SLEEP) {
+    if (sleep_state == SYS_SLEEP_DEEP) {
         *expected_idle_time = 1;
+        return;
     }
+
+    if (sleep_state == SYS_SLEEP_LIGHT)
+        rcu_fmc_clock_sleep_enable();
+
+    /* the tick compare value is only reached if no other interrupt ended the WFI before */
+    tickless_sleep_account(sleep_state, get_sys_local_time_us() - sleep_start_us,
+                           SysTimer_GetLoadValue() >= SysTimer_GetCompareValue());
 }
 
 int freertos_ready_to_sleep(void)
 {
-    return sys_wakelock_status_get() == 0 && wifi_hw_is_sleep();
+    if (sys_wakelock_status_get() == 0 && wifi_hw_is_sleep()) {
+        sleep_refused = 0;
+        return 1;
+    }
+
+    /* the idle task asks again on each pass, count the refused sleep once */
+    if (!sleep_refused) {
+        sleep_refused = 1;
+        sleep_stats.abort_cnt++;
+    }
+    return 0;
 }
 
 #endif  /* ( configUSE_TICKLESS_IDLE != 0 ) */
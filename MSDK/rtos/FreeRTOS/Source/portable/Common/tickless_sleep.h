@@ -35,7 +35,11 @@ OF SUCH DAMAGE.
 #ifndef TICKLESS_SLEEP_H
 #define TICKLESS_SLEEP_H
 
-#define DEEP_SLEEP_MIN_TIME_MS    2000
+/* The idle hook picks the sleep state from the predicted idle length: plain
+   WFI below LIGHT_SLEEP_MIN_TIME_MS, WFI with the flash clock gated below
+   DEEP_SLEEP_MIN_TIME_MS, deep sleep above (only in SYS_PS_DEEP_SLEEP mode). */
+#define LIGHT_SLEEP_MIN_TIME_MS   2
+#define DEEP_SLEEP_MIN_TIME_MS    20
 #define DEEP_SLEEP_MAX_TIME_MS    10000
 
 #ifndef portNVIC_SYSTICK_CURRENT_VALUE
@@ -48,5 +52,6 @@ OF SUCH DAMAGE.
 void freertos_pre_sleep_processing(unsigned long long *expected_idle_time);
 void freertos_post_sleep_processing(unsigned long long *expected_idle_time);
 int freertos_ready_to_sleep(void);
+void freertos_sleep_stats_get(sys_sleep_stats_t *stats, int reset);
 
 #endif /* TICKLESS_SLEEP_H */
@@ -110,6 +110,16 @@
 #define portGET_RUN_TIME_COUNTER_VALUE()    xTickCount
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
 #endif
+
+#ifdef CFG_OS_PROFILE
+extern void sys_prof_task_ready(void *task, const char *name);
+extern void sys_prof_task_switch(void *task, const char *name);
+extern void sys_prof_task_delete(void *task);
+
+#define traceMOVED_TASK_TO_READY_STATE( pxTCB )     sys_prof_task_ready( ( pxTCB ), ( pxTCB )->pcTaskName )
+#define traceTASK_SWITCHED_IN()                     sys_prof_task_switch( pxCurrentTCB, pxCurrentTCB->pcTaskName )
+#define traceTASK_DELETE( pxTCB )                   sys_prof_task_delete( pxTCB )
+#endif
 #define configUSE_MUTEXES               1
 
 #define configUSE_TIMERS                1
@@ -0,0 +1,344 @@
+/*!
+    \file    freertos_heap_prof.c
+    \brief   Heap profiler for GD32VW55x SDK
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include <dbg_print.h>
+#include "wrapper_os.h"
+#include "compiler.h"
+
+#ifdef CFG_HEAP_PROFILE
+#include "ll.h"
+
+#define HEAP_PROF_MAGIC               0x4850
+#define HEAP_PROF_SITE_OTHER          HEAP_PROF_SITE_NUM
+
+// heap block | size(4 bytes) | site(2 bytes) | magic(2 bytes) | memory
+// The tag keeps the 8 bytes alignment returned by pvPortMalloc.
+typedef struct
+{
+    uint32_t            size;     // requested size
+    uint16_t            site;     // index in heap_prof_sites
+    uint16_t            magic;
+} heap_prof_tag_t;
+
+/* Sites are keyed by the caller return address and placed by hash with linear
+   probing. Callers that find the table full are accounted in the extra last
+   entry, whose ra is 0. Entries are never removed so that tags stay valid. */
+static sys_heap_site_t heap_prof_sites[HEAP_PROF_SITE_NUM + 1];
+static uint32_t heap_prof_live;
+static uint32_t heap_prof_peak;
+static uint32_t heap_prof_fail_cnt;
+
+/*!
+    \brief      find or create the site entry of a caller, IRQs must be disabled
+    \param[in]  ra: return address of the caller
+    \param[out] none
+    \retval     index of the site entry
+*/
+static uint16_t heap_prof_site_lookup(uint32_t ra)
+{
+    uint32_t idx = ((ra >> 1) * 2654435761u) % HEAP_PROF_SITE_NUM;
+    uint32_t i;
+
+    for (i = 0; i < HEAP_PROF_SITE_NUM; i++) {
+        if (heap_prof_sites[idx].ra == ra)
+            return idx;
+        if (heap_prof_sites[idx].ra == 0) {
+            heap_prof_sites[idx].ra = ra;
+            return idx;
+        }
+        if (++idx == HEAP_PROF_SITE_NUM)
+            idx = 0;
+    }
+
+    return HEAP_PROF_SITE_OTHER;
+}
+
+/*!
+    \brief      tag an allocated block and account it to the caller site
+    \param[in]  p_tag: heap block returned by the allocator
+    \param[in]  size: requested size
+    \param[in]  ra: return address of the caller
+    \param[out] none
+    \retval     address of the memory handed to the caller
+*/
+static void *heap_prof_add(heap_prof_tag_t *p_tag, size_t size, uint32_t ra)
+{
+    sys_heap_site_t *p_site;
+    uint16_t site;
+
+    GLOBAL_INT_DISABLE();
+    site = heap_prof_site_lookup(ra);
+    p_site = &heap_prof_sites[site];
+    p_site->live_bytes += size;
+    p_site->live_cnt++;
+    p_site->alloc_cnt++;
+    if (p_site->live_bytes > p_site->peak_bytes)
+        p_site->peak_bytes = p_site->live_bytes;
+    heap_prof_live += size;
+    if (heap_prof_live > heap_prof_peak)
+        heap_prof_peak = heap_prof_live;
+    GLOBAL_INT_RESTORE();
+
+    p_tag->size = size;
+    p_tag->site = site;
+    p_tag->magic = HEAP_PROF_MAGIC;
+
+    return (void *)(p_tag + 1);
+}
+
+/*!
+    \brief      remove a block from the accounting of its site
+    \param[in]  p_tag: tag in front of the memory handed to the caller
+    \param[out] none
+    \retval     none
+*/
+static void heap_prof_del(heap_prof_tag_t *p_tag)
+{
+    sys_heap_site_t *p_site;
+
+    if (p_tag->magic != HEAP_PROF_MAGIC || p_tag->site > HEAP_PROF_SITE_OTHER) {
+        printf("heap prof: block %p tag damaged!\r\n", p_tag + 1);
+        return;
+    }
+
+    GLOBAL_INT_DISABLE();
+    p_site = &heap_prof_sites[p_tag->site];
+    p_site->live_bytes -= p_tag->size;
+    p_site->live_cnt--;
+    heap_prof_live -= p_tag->size;
+    GLOBAL_INT_RESTORE();
+
+    p_tag->magic = 0;
+}
+
+/***************** heap management implementation *****************/
+/*!
+    \brief      allocate a block of memory with a minimum of 'size' bytes.
+    \param[in]  size: the minimum size of the requested block in bytes
+    \param[out] none
+    \retval     address to allocated memory, NULL pointer if there is an error
+*/
+void *sys_malloc(size_t size)
+{
+    uint32_t ra = (uint32_t)__builtin_return_address(0);
+    heap_prof_tag_t *p_tag;
+
+    p_tag = (heap_prof_tag_t *)pvPortMalloc(size + sizeof(heap_prof_tag_t));
+    if (p_tag == NULL) {
+        heap_prof_fail_cnt++;
+        return NULL;
+    }
+
+    return heap_prof_add(p_tag, size, ra);
+}
+
+/*!
+    \brief      allocate a certian chunks of memory with specified size
+                Note: The allocated memory is filled with bytes of value zero.
+                All chunks in the allocated memory are contiguous.
+    \param[in]  count: multiple number of size want to malloc
+    \param[in]  size:  number of size want to malloc
+    \param[out] none
+    \retval     address to allocated memory, NULL pointer if there is an error
+*/
+void *sys_calloc(size_t count, size_t size)
+{
+    uint32_t ra = (uint32_t)__builtin_return_address(0);
+    heap_prof_tag_t *p_tag;
+
+    size = count * size;
+    p_tag = (heap_prof_tag_t *)pvPortMalloc(size + sizeof(heap_prof_tag_t));
+    if (p_tag == NULL) {
+        heap_prof_fail_cnt++;
+        return NULL;
+    }
+    sys_memset(p_tag + 1, 0, size);
+
+    return heap_prof_add(p_tag, size, ra);
+}
+
+/*!
+    \brief      change the size of a previously allocated memory block.
+    \param[in]  mem: address to the old buffer
+    \param[in]  size: number of the new buffer size
+    \param[out] none
+    \retval     address to allocated memory, NULL pointer if there is an error
+*/
+void *sys_realloc(void *mem, size_t size)
+{
+    uint32_t ra = (uint32_t)__builtin_return_address(0);
+    heap_prof_tag_t *p_old = NULL;
+    heap_prof_tag_t *p_tag;
+    heap_prof_tag_t old_tag;
+
+    if (mem != NULL) {
+        p_old = (heap_prof_tag_t *)mem - 1;
+        old_tag = *p_old;
+        heap_prof_del(p_old);
+    }
+
+    p_tag = (heap_prof_tag_t *)pvPortReAlloc(p_old, size + sizeof(heap_prof_tag_t));
+    if (p_tag == NULL) {
+        heap_prof_fail_cnt++;
+        // realloc fail, the old block is still owned by the caller
+        if (p_old != NULL) {
+            *p_old = old_tag;
+            GLOBAL_INT_DISABLE();
+            heap_prof_sites[old_tag.site].live_bytes += old_tag.size;
+            heap_prof_sites[old_tag.site].live_cnt++;
+            heap_prof_live += old_tag.size;
+            GLOBAL_INT_RESTORE();
+        }
+        return NULL;
+    }
+
+    return heap_prof_add(p_tag, size, ra);
+}
+
+/*!
+    \brief      free a memory to the heap
+    \param[in]  ptr: pointer to the address want to free
+    \param[out] none
+    \retval     none
+*/
+void sys_mfree(void *ptr)
+{
+    heap_prof_tag_t *p_tag;
+
+    if (ptr == NULL)
+        return;
+
+    p_tag = (heap_prof_tag_t *)ptr - 1;
+    heap_prof_del(p_tag);
+    vPortFree(p_tag);
+}
+
+/*!
+    \brief      get the allocation sites with the most live bytes, sorted by live bytes
+    \param[in]  max: maximum number of entries to copy
+    \param[out] sites: the site entries
+    \retval     number of entries copied
+*/
+int sys_heap_prof_sites_get(sys_heap_site_t *sites, int max)
+{
+    sys_heap_site_t site;
+    int i, j, num = 0;
+
+    if (max <= 0)
+        return 0;
+
+    for (i = 0; i <= HEAP_PROF_SITE_NUM; i++) {
+        GLOBAL_INT_DISABLE();
+        site = heap_prof_sites[i];
+        GLOBAL_INT_RESTORE();
+        if (site.alloc_cnt == 0)
+            continue;
+
+        // when full, the smallest entry makes room for a larger site
+        if (num == max) {
+            if (sites[num - 1].live_bytes >= site.live_bytes)
+                continue;
+            num--;
+        }
+
+        for (j = num; j > 0 && sites[j - 1].live_bytes < site.live_bytes; j--)
+            sites[j] = sites[j - 1];
+        sites[j] = site;
+        num++;
+    }
+
+    return num;
+}
+
+/*!
+    \brief      get the heap profiler totals
+    \param[in]  none
+    \param[out] live: bytes currently allocated through the wrapper
+    \param[out] peak: maximum of live since boot or last reset
+    \param[out] fail_cnt: number of failed allocations
+    \retval     none
+*/
+void sys_heap_prof_info(uint32_t *live, uint32_t *peak, uint32_t *fail_cnt)
+{
+    GLOBAL_INT_DISABLE();
+    *live = heap_prof_live;
+    *peak = heap_prof_peak;
+    *fail_cnt = heap_prof_fail_cnt;
+    GLOBAL_INT_RESTORE();
+}
+
+/*!
+    \brief      restart the peak and allocation counters from the current state
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_heap_prof_reset(void)
+{
+    int i;
+
+    GLOBAL_INT_DISABLE();
+    for (i = 0; i <= HEAP_PROF_SITE_NUM; i++) {
+        heap_prof_sites[i].peak_bytes = heap_prof_sites[i].live_bytes;
+        heap_prof_sites[i].alloc_cnt = heap_prof_sites[i].live_cnt;
+    }
+    heap_prof_peak = heap_prof_live;
+    heap_prof_fail_cnt = 0;
+    GLOBAL_INT_RESTORE();
+}
+
+/*!
+    \brief      get the fragmentation of the heap free list
+                Note: frag_permille is 1000 * (1 - largest free block / free bytes),
+                0 when all the free memory is in one block.
+    \param[in]  none
+    \param[out] frag: fragmentation information
+    \retval     none
+*/
+void sys_heap_frag_get(sys_heap_frag_t *frag)
+{
+    HeapStats_t stats;
+
+    vPortGetHeapStats(&stats);
+
+    frag->free_bytes = stats.xAvailableHeapSpaceInBytes;
+    frag->largest_free = stats.xSizeOfLargestFreeBlockInBytes;
+    frag->free_blocks = stats.xNumberOfFreeBlocks;
+    if (stats.xAvailableHeapSpaceInBytes != 0)
+        frag->frag_permille = (uint32_t)(((uint64_t)(stats.xAvailableHeapSpaceInBytes - stats.xSizeOfLargestFreeBlockInBytes) * 1000)
+                                         / stats.xAvailableHeapSpaceInBytes);
+    else
+        frag->frag_permille = 0;
+}
+#endif
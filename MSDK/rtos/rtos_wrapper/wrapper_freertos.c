@@ -68,6 +68,8 @@ __INLINE TickType_t sys_timeout_2_tickcount(int timeout_ms)
 
 #ifdef CFG_HEAP_MEM_CHECK
 #include "freertos_heap_dbg.c"
+#elif defined(CFG_HEAP_PROFILE)
+#include "freertos_heap_prof.c"
 #else
 /***************** heap management implementation *****************/
 /*!
@@ -1176,6 +1178,27 @@ int32_t sys_random_bytes_get(void *dst, uint32_t size)
 #endif
 }
 
+static uint32_t timer_coalesced_cnt;
+
+/*!
+    \brief      delay the expiry of a timer to the next tick aligned on its slack
+                Note: the alignment is the largest power of 2 not above the slack,
+                so timers with different slacks still expire on common ticks.
+    \param[in]  timer_ctx: pointer to the timer context, due is the expiry without slack
+    \param[in]  now: current tick count
+    \param[out] none
+    \retval     timeout from now to program, in ticks
+*/
+static uint32_t _sys_timer_slack_apply(os_timer_context_t *timer_ctx, TickType_t now)
+{
+    TickType_t due = (TickType_t)SYS_TIME_SLACK_ROUND((TickType_t)timer_ctx->due, timer_ctx->slack);
+
+    if (due != timer_ctx->due)
+        timer_coalesced_cnt++;
+
+    return due - now;
+}
+
 /*!
     \brief      set system timer callback
     \param[in]  p_tmr:pointer to the timer callback
@@ -1194,6 +1217,17 @@ static void _sys_timer_callback(void *p_tmr)
         return;
     }
 
+    /* a periodic timer reloads with the timeout of its last start, follow the
+       period without slack instead so that the alignment does not drift */
+    if (timer_ctx->slack && uxTimerGetReloadMode(timer)) {
+        TickType_t now = xTaskGetTickCount();
+
+        timer_ctx->due += timer_ctx->period;
+        if (timer_ctx->due <= now)
+            timer_ctx->due = now + timer_ctx->period;
+        xTimerChangePeriod(timer, _sys_timer_slack_apply(timer_ctx, now), 0);
+    }
+
     timer_func(p_tmr, timer_ctx->p_arg);
 }
 
@@ -1226,6 +1260,8 @@ void sys_timer_init(os_timer_t *timer, const uint8_t *name, uint32_t delay, uint
 
     timer_ctx->p_arg = arg;
     timer_ctx->timer_func = func;
+    timer_ctx->period = delay / OS_MS_PER_TICK;
+    timer_ctx->slack = 0;
     vTimerSetTimerID(*timer, (void *)timer_ctx);
 }
 
@@ -1268,9 +1304,15 @@ void sys_timer_delete(os_timer_t *timer)
 */
 void sys_timer_start(os_timer_t *timer, uint8_t from_isr)
 {
+    os_timer_context_t *timer_ctx = (os_timer_context_t *)pvTimerGetTimerID(*timer);
     uint8_t result = 0;
     portBASE_TYPE HigherPriorityTaskWoken = pdFALSE;
 
+    if (timer_ctx->slack) {
+        sys_timer_start_ext(timer, timer_ctx->period * OS_MS_PER_TICK, from_isr);
+        return;
+    }
+
     if (from_isr) {
         if (xTimerStartFromISR(*timer, &HigherPriorityTaskWoken) == pdPASS) {
             if (HigherPriorityTaskWoken != pdFALSE) {
@@ -1300,6 +1342,7 @@ void sys_timer_start(os_timer_t *timer, uint8_t from_isr)
 */
 void sys_timer_start_ext(os_timer_t *timer, uint32_t delay, uint8_t from_isr)
 {
+    os_timer_context_t *timer_ctx = (os_timer_context_t *)pvTimerGetTimerID(*timer);
     uint32_t timer_ticks;
     uint8_t result = 0;
     portBASE_TYPE HigherPriorityTaskWoken = pdFALSE;
@@ -1309,6 +1352,13 @@ void sys_timer_start_ext(os_timer_t *timer, uint32_t delay, uint8_t from_isr)
     } else {
         timer_ticks = delay / OS_MS_PER_TICK;
     }
+    timer_ctx->period = timer_ticks;
+    if (timer_ctx->slack) {
+        TickType_t now = from_isr ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+
+        timer_ctx->due = now + timer_ticks;
+        timer_ticks = _sys_timer_slack_apply(timer_ctx, now);
+    }
 
     if (from_isr) {
         if (xTimerChangePeriodFromISR(*timer, timer_ticks, &HigherPriorityTaskWoken) == pdPASS) {
@@ -1372,6 +1422,23 @@ uint8_t sys_timer_pending(os_timer_t *timer)
     return xTimerIsTimerActive(*timer);
 }
 
+/*!
+    \brief      set the tolerance of a timer expiry
+                Note: the expiries are delayed by up to slack_ms so that timers
+                sharing a tick can be served by a single wakeup. It is used from
+                the next start of the timer, 0 disables it.
+    \param[in]  timer: pointer to the timer handle
+    \param[in]  slack_ms: maximum delay allowed on the expiry in milliseconds
+    \param[out] none
+    \retval     none
+*/
+void sys_timer_slack_set(os_timer_t *timer, uint32_t slack_ms)
+{
+    os_timer_context_t *timer_ctx = (os_timer_context_t *)pvTimerGetTimerID(*timer);
+
+    timer_ctx->slack = slack_ms / OS_MS_PER_TICK;
+}
+
 /*!
     \brief      Miscellaneous initialization work after OS initialized and
                 task scheduler started
@@ -1514,6 +1581,9 @@ uint32_t sys_in_critical(void)
 void sys_enter_critical(void)
 {
     vPortEnterCritical();
+#ifdef CFG_OS_PROFILE
+    sys_prof_crit_enter();
+#endif
 }
 
 /*!
@@ -1524,6 +1594,9 @@ void sys_enter_critical(void)
 */
 void sys_exit_critical(void)
 {
+#ifdef CFG_OS_PROFILE
+    sys_prof_crit_exit((uint32_t)__builtin_return_address(0));
+#endif
     vPortExitCritical();
 }
 
@@ -1535,6 +1608,9 @@ void sys_exit_critical(void)
 */
 void sys_int_enter(void)
 {
+#ifdef CFG_OS_PROFILE
+    sys_prof_int_enter();
+#endif
     // FreeRTOS no longer need record this
     return;
 }
@@ -1547,6 +1623,9 @@ void sys_int_enter(void)
 */
 void sys_int_exit(void)
 {
+#ifdef CFG_OS_PROFILE
+    sys_prof_int_exit();
+#endif
     // FreeRTOS no longer need record this
     return;
 }
@@ -1586,6 +1665,22 @@ void sys_cpu_sleep_time_get(uint32_t *stats_ms, uint32_t *sleep_ms)
     freertos_cpu_sleep_time_get(stats_ms, sleep_ms);
 }
 
+/*!
+    \brief      get the sleep state residency and wakeup statistics
+    \param[in]  reset: restart the statistics after reading them
+    \param[out] stats: sleep statistics
+    \retval     none
+*/
+void sys_sleep_stats_get(sys_sleep_stats_t *stats, int reset)
+{
+    extern void freertos_sleep_stats_get(sys_sleep_stats_t *stats, int reset);
+
+    freertos_sleep_stats_get(stats, reset);
+    stats->timer_coalesced = timer_coalesced_cnt;
+    if (reset)
+        timer_coalesced_cnt = 0;
+}
+
 /*!
     \brief      show cpu usage percentage per task
     \retval     none
@@ -44,6 +44,9 @@ OF SUCH DAMAGE.
 typedef struct timer_context {
     void *p_arg;
     timer_func_t timer_func;
+    uint32_t period;            // timeout requested by the user, in ticks
+    uint32_t slack;             // delay allowed on the expiry, in ticks
+    uint64_t due;               // expiry without slack, in ticks
 } os_timer_context_t;
 
 typedef struct task_wrapper {
@@ -50,3 +50,5 @@ OF SUCH DAMAGE.
 #elif defined(PLATFORM_OS_THREADX)
 #include "wrapper_threadx.c"
 #endif
+
+#include "wrapper_os_prof.c"
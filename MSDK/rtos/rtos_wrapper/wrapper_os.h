@@ -63,6 +63,12 @@ extern "C" {
 #define SYS_PS_OFF                    0
 #define SYS_PS_DEEP_SLEEP             1
 
+/* CPU sleep states chosen by the idle task */
+#define SYS_SLEEP_WFI                 0
+#define SYS_SLEEP_LIGHT               1
+#define SYS_SLEEP_DEEP                2
+#define SYS_SLEEP_STATE_NUM           3
+
 #define TASK_PRIO_HIGHER(n)           (n)
 #define TASK_PRIO_LOWER(n)            (-n)
 
@@ -79,6 +85,69 @@ typedef unsigned long os_prio_t;
 typedef void (*task_func_t)(void *argv);
 typedef void (*timer_func_t)(void *p_tmr, void *p_arg);
 
+#ifdef CFG_HEAP_PROFILE
+/* heap profiler allocation site */
+typedef struct
+{
+    uint32_t ra;            // return address of the caller, 0 for the overflow entry
+    uint32_t live_bytes;    // bytes currently allocated
+    uint32_t peak_bytes;    // maximum of live_bytes
+    uint32_t live_cnt;      // blocks currently allocated
+    uint32_t alloc_cnt;     // allocations made
+} sys_heap_site_t;
+
+/* heap free list fragmentation */
+typedef struct
+{
+    uint32_t free_bytes;
+    uint32_t largest_free;
+    uint32_t free_blocks;
+    uint32_t frag_permille;
+} sys_heap_frag_t;
+#endif
+
+#ifdef CFG_OS_PROFILE
+/* CPU profiler task entry */
+typedef struct
+{
+    void *task;                         // OS task handle, NULL for the overflow entry
+    char name[OS_PROF_NAME_LEN];
+    uint64_t run_us;                    // time spent running
+    uint32_t switch_cnt;                // times switched in
+    uint32_t ready_max_us;              // longest ready to running delay
+} sys_prof_task_t;
+
+/* CPU profiler statistics, histogram bin i counts values below OS_PROF_HIST_BASE_US << (2 * i) */
+typedef struct
+{
+    uint32_t run_hist[OS_PROF_HIST_BINS];       // task run time per switch in
+    uint32_t ready_hist[OS_PROF_HIST_BINS];     // ready to running delay
+    uint32_t isr_hist[OS_PROF_HIST_BINS];       // ISR duration
+    uint32_t irq_off_hist[OS_PROF_HIST_BINS];   // outermost sys_enter_critical windows
+    uint32_t switch_cnt;
+    uint32_t run_max_us;
+    uint32_t ready_max_us;
+    uint32_t isr_cnt;
+    uint32_t isr_max_us;
+    uint64_t isr_total_us;
+    uint32_t irq_off_max_us;
+    uint32_t irq_off_max_ra;                    // caller of the longest window
+    uint32_t stats_us;                          // time covered by the statistics
+} sys_prof_stats_t;
+#endif
+
+/* idle sleep statistics */
+typedef struct
+{
+    uint32_t enter_cnt[SYS_SLEEP_STATE_NUM];
+    uint64_t residency_us[SYS_SLEEP_STATE_NUM];
+    uint32_t wake_timer_cnt;            // sleeps that lasted until the next timeout
+    uint32_t wake_irq_cnt;              // sleeps ended early by another interrupt
+    uint32_t abort_cnt;                 // sleeps refused by a wakelock or the wifi, once until the next sleep
+    uint32_t timer_coalesced;           // timer expiries moved within their slack
+    uint32_t stats_ms;                  // time covered by the statistics
+} sys_sleep_stats_t;
+
 /*============================ MACRO FUNCTIONS ===============================*/
 #define sys_zalloc(a)                  sys_calloc(a, 1)
 
@@ -87,6 +156,13 @@ typedef void (*timer_func_t)(void *p_tmr, void *p_arg);
 #define SYS_TIME_AFTER_EQ(a, b)        ((int32_t)(a) - (int32_t)(b) >= 0)
 #define SYS_TIME_BEFORE_EQ(a, b)       SYS_TIME_AFTER_EQ(b, a)
 
+/* expiry t delayed within slack onto a multiple of the largest power of 2 not above slack,
+   so that expiries with different slacks still meet on common times. The mask has the type
+   of t, a 64-bit TickType_t keeps its upper half */
+#define SYS_SLACK_ALIGN(type, slack)   (((slack) > 1) ? ((type)1 << (31 - __builtin_clz(slack))) : (type)1)
+#define SYS_TIME_SLACK_ROUND(t, slack) (((t) + SYS_SLACK_ALIGN(__typeof__(t), slack) - 1) &          \
+                                        ~(SYS_SLACK_ALIGN(__typeof__(t), slack) - 1))
+
 #define sys_task_create_dynamic(name, stack_size, priority, func, ctx)  sys_task_create(NULL, name, NULL, stack_size, 0, 0, priority, func, ctx)
 
 /*============================ PROTOTYPES ====================================*/
@@ -164,6 +240,42 @@ uint16_t sys_heap_block_size(void);
 */
 void sys_heap_info(int *total_size, int *free_size, int *min_free_size);
 
+#ifdef CFG_HEAP_PROFILE
+/*!
+    \brief      get the allocation sites with the most live bytes, sorted by live bytes
+    \param[in]  max: maximum number of entries to copy
+    \param[out] sites: the site entries
+    \retval     number of entries copied
+*/
+int sys_heap_prof_sites_get(sys_heap_site_t *sites, int max);
+
+/*!
+    \brief      get the heap profiler totals
+    \param[in]  none
+    \param[out] live: bytes currently allocated through the wrapper
+    \param[out] peak: maximum of live since boot or last reset
+    \param[out] fail_cnt: number of failed allocations
+    \retval     none
+*/
+void sys_heap_prof_info(uint32_t *live, uint32_t *peak, uint32_t *fail_cnt);
+
+/*!
+    \brief      restart the peak and allocation counters from the current state
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_heap_prof_reset(void);
+
+/*!
+    \brief      get the fragmentation of the heap free list
+    \param[in]  none
+    \param[out] frag: fragmentation information
+    \retval     none
+*/
+void sys_heap_frag_get(sys_heap_frag_t *frag);
+#endif
+
 /*!
     \brief      set the content of the buffer to specified value
     \param[in]  s: The address of a buffer
@@ -689,6 +801,18 @@ uint8_t sys_timer_stop(os_timer_t *timer, uint8_t from_isr);
 */
 uint8_t sys_timer_pending(os_timer_t *timer);
 
+/*!
+    \brief      set the tolerance of a timer expiry
+                Note: the expiries are delayed by up to slack_ms so that timers
+                sharing a tick can be served by a single wakeup. It is used from
+                the next start of the timer, 0 disables it.
+    \param[in]  timer: pointer to the timer handle
+    \param[in]  slack_ms: maximum delay allowed on the expiry in milliseconds
+    \param[out] none
+    \retval     none
+*/
+void sys_timer_slack_set(os_timer_t *timer, uint32_t slack_ms);
+
 /*!
     \brief      initialize the OS
     \param[in]  none
@@ -806,6 +930,14 @@ uint8_t sys_ps_get(void);
 */
 void sys_cpu_sleep_time_get(uint32_t *stats_ms, uint32_t *sleep_ms);
 
+/*!
+    \brief      get the sleep state residency and wakeup statistics
+    \param[in]  reset: restart the statistics after reading them
+    \param[out] stats: sleep statistics
+    \retval     none
+*/
+void sys_sleep_stats_get(sys_sleep_stats_t *stats, int reset);
+
 /*!
     \brief      show cpu usage percentage per task
     \retval     none
@@ -828,6 +960,82 @@ void sys_int_enter(void);
 */
 void sys_int_exit(void);
 
+#ifdef CFG_OS_PROFILE
+/*!
+    \brief      OS hook: a task was made ready to run
+    \param[in]  task: OS task handle
+    \param[in]  name: task name
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_task_ready(void *task, const char *name);
+
+/*!
+    \brief      OS hook: a task was selected to run
+    \param[in]  task: OS task handle
+    \param[in]  name: task name
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_task_switch(void *task, const char *name);
+
+/*!
+    \brief      OS hook: a task is deleted
+    \param[in]  task: OS task handle
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_task_delete(void *task);
+
+/*!
+    \brief      OS hook: an ISR starts
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_int_enter(void);
+
+/*!
+    \brief      OS hook: an ISR ends
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_int_exit(void);
+
+/*!
+    \brief      OS hook: called by sys_enter_critical once interrupts are disabled
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_crit_enter(void);
+
+/*!
+    \brief      OS hook: called by sys_exit_critical before interrupts are enabled again
+    \param[in]  ra: return address of the sys_exit_critical caller
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_crit_exit(uint32_t ra);
+
+/*!
+    \brief      get the profiler statistics
+    \param[in]  reset: restart the statistics and the task table after reading them
+    \param[out] stats: profiler statistics
+    \retval     none
+*/
+void sys_prof_stats_get(sys_prof_stats_t *stats, int reset);
+
+/*!
+    \brief      get the task statistics, sorted by run time
+    \param[in]  max: maximum number of entries to copy
+    \param[out] tasks: the task entries
+    \retval     number of entries copied
+*/
+int sys_prof_task_get(sys_prof_task_t *tasks, int max);
+#endif
+
 /*!
     \brief      check task exist or not
     \param[in]  name: Task name
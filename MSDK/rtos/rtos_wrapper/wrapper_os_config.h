@@ -73,6 +73,23 @@ extern uint32_t SystemCoreClock;
 
 // #define CFG_HEAP_MEM_CHECK
 
+/* Heap profiler: live/peak bytes per allocation site, tags each block with 8 bytes.
+ * Not used together with CFG_HEAP_MEM_CHECK. */
+// #define CFG_HEAP_PROFILE
+#ifdef CFG_HEAP_PROFILE
+#define HEAP_PROF_SITE_NUM              32
+#endif
+
+/* CPU profiler: task run time, ready to run latency, ISR duration and
+ * sys_enter_critical windows, timed with get_sys_local_time_us. */
+// #define CFG_OS_PROFILE
+#ifdef CFG_OS_PROFILE
+#define OS_PROF_TASK_NUM                24
+#define OS_PROF_NAME_LEN                12
+#define OS_PROF_HIST_BINS               8
+#define OS_PROF_HIST_BASE_US            16
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,394 @@
+/*!
+    \file    wrapper_os_prof.c
+    \brief   CPU profiler for GD32VW55x SDK
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "wrapper_os.h"
+
+#ifdef CFG_OS_PROFILE
+#include <string.h>
+#include "ll.h"
+#include "compiler.h"
+#include "systime.h"
+
+// Marks the entry of a deleted task, keeps the probe chains of the task table
+#define OS_PROF_TASK_GONE           ((void *)1)
+#define OS_PROF_TASK_OTHER          OS_PROF_TASK_NUM
+#define OS_PROF_ISR_NEST            4
+
+struct os_prof_task
+{
+    sys_prof_task_t info;
+    uint32_t ready_ts;
+    bool ready;
+};
+
+static struct
+{
+    /* Tasks are keyed by the OS handle and placed by hash with linear probing.
+       When the table is full, tasks are accounted in the extra last entry. */
+    struct os_prof_task tasks[OS_PROF_TASK_NUM + 1];
+    struct os_prof_task *p_cur;
+    void *cur_task;
+    uint32_t switch_ts;
+    uint32_t crit_nest;
+    uint32_t crit_ts;
+    uint8_t isr_nest;
+    uint32_t isr_ts[OS_PROF_ISR_NEST];
+    uint32_t reset_ts;
+    sys_prof_stats_t stats;
+} os_prof;
+
+/*!
+    \brief      get the profiler time
+    \param[in]  none
+    \param[out] none
+    \retval     local time in us, wraps after 71 minutes
+*/
+__INLINE uint32_t os_prof_now(void)
+{
+    return (uint32_t)get_sys_local_time_us();
+}
+
+/*!
+    \brief      disable interrupts for the profiler update done in ISR hooks
+    \param[in]  none
+    \param[out] none
+    \retval     previous mstatus value
+*/
+__INLINE uint32_t os_prof_irq_save(void)
+{
+    uint32_t mstatus;
+
+    __asm__ volatile ("csrrci %0, mstatus, %1" : "=r" (mstatus) : "i" (INTE_EN));
+    return mstatus;
+}
+
+/*!
+    \brief      restore interrupts after os_prof_irq_save
+    \param[in]  mstatus: value returned by os_prof_irq_save
+    \param[out] none
+    \retval     none
+*/
+__INLINE void os_prof_irq_restore(uint32_t mstatus)
+{
+    if (mstatus & INTE_EN)
+        GLOBAL_INT_START();
+}
+
+/*!
+    \brief      add a value to a statistics histogram
+    \param[in]  hist: histogram of OS_PROF_HIST_BINS bins
+    \param[in]  value: value in us, bin i counts values below OS_PROF_HIST_BASE_US << (2 * i)
+    \param[out] none
+    \retval     none
+*/
+static void os_prof_hist_add(uint32_t *hist, uint32_t value)
+{
+    uint32_t base = OS_PROF_HIST_BASE_US;
+    int bin = 0;
+
+    while ((bin < OS_PROF_HIST_BINS - 1) && (value >= base)) {
+        base <<= 2;
+        bin++;
+    }
+    hist[bin]++;
+}
+
+/*!
+    \brief      find or create the entry of a task
+    \param[in]  task: OS task handle
+    \param[in]  name: task name, copied when the entry is created
+    \param[out] none
+    \retval     task entry
+*/
+static struct os_prof_task *os_prof_task_lookup(void *task, const char *name)
+{
+    uint32_t idx = (((uint32_t)task >> 3) * 2654435761u) % OS_PROF_TASK_NUM;
+    struct os_prof_task *p_free = NULL;
+    struct os_prof_task *p_task;
+    uint32_t i;
+
+    for (i = 0; i < OS_PROF_TASK_NUM; i++) {
+        p_task = &os_prof.tasks[idx];
+        if (p_task->info.task == task)
+            return p_task;
+        if (p_task->info.task == OS_PROF_TASK_GONE) {
+            if (p_free == NULL)
+                p_free = p_task;
+        } else if (p_task->info.task == NULL) {
+            if (p_free == NULL)
+                p_free = p_task;
+            break;
+        }
+        if (++idx == OS_PROF_TASK_NUM)
+            idx = 0;
+    }
+
+    if (p_free == NULL) {
+        p_task = &os_prof.tasks[OS_PROF_TASK_OTHER];
+        if (p_task->info.name[0] == '\0')
+            strncpy(p_task->info.name, "others", OS_PROF_NAME_LEN - 1);
+        return p_task;
+    }
+
+    memset(p_free, 0, sizeof(*p_free));
+    p_free->info.task = task;
+    if (name)
+        strncpy(p_free->info.name, name, OS_PROF_NAME_LEN - 1);
+
+    return p_free;
+}
+
+/*!
+    \brief      OS hook: a task was made ready to run
+                Note: called by the OS with the scheduler locked
+    \param[in]  task: OS task handle
+    \param[in]  name: task name
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_task_ready(void *task, const char *name)
+{
+    struct os_prof_task *p_task = os_prof_task_lookup(task, name);
+
+    if (!p_task->ready) {
+        p_task->ready = true;
+        p_task->ready_ts = os_prof_now();
+    }
+}
+
+/*!
+    \brief      OS hook: a task was selected to run
+                Note: called by the OS with the scheduler locked
+    \param[in]  task: OS task handle
+    \param[in]  name: task name
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_task_switch(void *task, const char *name)
+{
+    struct os_prof_task *p_task;
+    uint32_t now = os_prof_now();
+    uint32_t delta;
+
+    if (task == os_prof.cur_task && os_prof.p_cur != NULL) {
+        os_prof.p_cur->ready = false;
+        return;
+    }
+
+    if (os_prof.p_cur != NULL) {
+        delta = now - os_prof.switch_ts;
+        os_prof.p_cur->info.run_us += delta;
+        if (delta > os_prof.stats.run_max_us)
+            os_prof.stats.run_max_us = delta;
+        os_prof_hist_add(os_prof.stats.run_hist, delta);
+    }
+
+    p_task = os_prof_task_lookup(task, name);
+    if (p_task->ready) {
+        delta = now - p_task->ready_ts;
+        p_task->ready = false;
+        if (delta > p_task->info.ready_max_us)
+            p_task->info.ready_max_us = delta;
+        if (delta > os_prof.stats.ready_max_us)
+            os_prof.stats.ready_max_us = delta;
+        os_prof_hist_add(os_prof.stats.ready_hist, delta);
+    }
+    p_task->info.switch_cnt++;
+    os_prof.stats.switch_cnt++;
+
+    os_prof.p_cur = p_task;
+    os_prof.cur_task = task;
+    os_prof.switch_ts = now;
+}
+
+/*!
+    \brief      OS hook: a task is deleted, its entry is kept until it is reused
+    \param[in]  task: OS task handle
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_task_delete(void *task)
+{
+    uint32_t idx = (((uint32_t)task >> 3) * 2654435761u) % OS_PROF_TASK_NUM;
+    uint32_t i;
+
+    sys_enter_critical();
+    for (i = 0; i < OS_PROF_TASK_NUM; i++) {
+        if (os_prof.tasks[idx].info.task == task) {
+            os_prof.tasks[idx].info.task = OS_PROF_TASK_GONE;
+            os_prof.tasks[idx].ready = false;
+            break;
+        }
+        if (os_prof.tasks[idx].info.task == NULL)
+            break;
+        if (++idx == OS_PROF_TASK_NUM)
+            idx = 0;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      OS hook: an ISR starts
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_int_enter(void)
+{
+    uint32_t mstatus = os_prof_irq_save();
+
+    if (os_prof.isr_nest < OS_PROF_ISR_NEST)
+        os_prof.isr_ts[os_prof.isr_nest] = os_prof_now();
+    os_prof.isr_nest++;
+
+    os_prof_irq_restore(mstatus);
+}
+
+/*!
+    \brief      OS hook: an ISR ends, nested ISRs are included in the duration of the outer one
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_int_exit(void)
+{
+    uint32_t mstatus = os_prof_irq_save();
+    uint32_t delta;
+
+    if (os_prof.isr_nest > 0) {
+        os_prof.isr_nest--;
+        if (os_prof.isr_nest < OS_PROF_ISR_NEST) {
+            delta = os_prof_now() - os_prof.isr_ts[os_prof.isr_nest];
+            if (delta > os_prof.stats.isr_max_us)
+                os_prof.stats.isr_max_us = delta;
+            if (os_prof.isr_nest == 0)
+                os_prof.stats.isr_total_us += delta;
+            os_prof.stats.isr_cnt++;
+            os_prof_hist_add(os_prof.stats.isr_hist, delta);
+        }
+    }
+
+    os_prof_irq_restore(mstatus);
+}
+
+/*!
+    \brief      OS hook: called by sys_enter_critical once interrupts are disabled
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_crit_enter(void)
+{
+    if (os_prof.crit_nest++ == 0)
+        os_prof.crit_ts = os_prof_now();
+}
+
+/*!
+    \brief      OS hook: called by sys_exit_critical before interrupts are enabled again
+    \param[in]  ra: return address of the sys_exit_critical caller
+    \param[out] none
+    \retval     none
+*/
+void sys_prof_crit_exit(uint32_t ra)
+{
+    uint32_t delta;
+
+    if (os_prof.crit_nest == 0 || --os_prof.crit_nest != 0)
+        return;
+
+    delta = os_prof_now() - os_prof.crit_ts;
+    if (delta > os_prof.stats.irq_off_max_us) {
+        os_prof.stats.irq_off_max_us = delta;
+        os_prof.stats.irq_off_max_ra = ra;
+    }
+    os_prof_hist_add(os_prof.stats.irq_off_hist, delta);
+}
+
+/*!
+    \brief      get the profiler statistics
+    \param[in]  reset: restart the statistics and the task table after reading them
+    \param[out] stats: profiler statistics
+    \retval     none
+*/
+void sys_prof_stats_get(sys_prof_stats_t *stats, int reset)
+{
+    uint32_t now;
+
+    sys_enter_critical();
+    now = os_prof_now();
+    *stats = os_prof.stats;
+    stats->stats_us = now - os_prof.reset_ts;
+    if (reset) {
+        memset(&os_prof.stats, 0, sizeof(os_prof.stats));
+        memset(os_prof.tasks, 0, sizeof(os_prof.tasks));
+        os_prof.p_cur = NULL;
+        if (os_prof.cur_task != NULL) {
+            os_prof.p_cur = os_prof_task_lookup(os_prof.cur_task, sys_task_name_get(NULL));
+            os_prof.switch_ts = now;
+        }
+        os_prof.reset_ts = now;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      get the task statistics, sorted by run time
+                Note: the running task is accounted up to the time of the call
+    \param[in]  max: maximum number of entries to copy
+    \param[out] tasks: the task entries
+    \retval     number of entries copied
+*/
+int sys_prof_task_get(sys_prof_task_t *tasks, int max)
+{
+    sys_prof_task_t task;
+    int i, j, num = 0;
+
+    for (i = 0; i <= OS_PROF_TASK_NUM && num < max; i++) {
+        sys_enter_critical();
+        task = os_prof.tasks[i].info;
+        if (&os_prof.tasks[i] == os_prof.p_cur)
+            task.run_us += os_prof_now() - os_prof.switch_ts;
+        sys_exit_critical();
+        if (task.task == NULL && task.switch_cnt == 0)
+            continue;
+
+        for (j = num; j > 0 && tasks[j - 1].run_us < task.run_us; j--)
+            tasks[j] = tasks[j - 1];
+        tasks[j] = task;
+        num++;
+    }
+
+    return num;
+}
+#endif /* CFG_OS_PROFILE */
@@ -467,6 +467,10 @@ void sys_task_delete(void *task)
 
     task_wrapper = (task_wrapper_t *)task_handle->user_data;
 
+#ifdef CFG_OS_PROFILE
+    sys_prof_task_delete(task_handle);
+#endif
+
     /* if task is deleted by another task, delete task first, then free task_wrapper. Otherwise, when
         task_wrapper is freed but task is still alive, task_wrapper pointer got by task is invalid.
     */
@@ -1656,6 +1660,21 @@ uint8_t sys_timer_pending(os_timer_t *timer)
     return !!(t->parent.flag & RT_TIMER_FLAG_ACTIVATED);
 }
 
+/*!
+    \brief      set the tolerance of a timer expiry
+                Note: timer coalescing is only implemented with FreeRTOS,
+                the timers keep their exact expiry here.
+    \param[in]  timer: pointer to the timer handle
+    \param[in]  slack_ms: maximum delay allowed on the expiry in milliseconds
+    \param[out] none
+    \retval     none
+*/
+void sys_timer_slack_set(os_timer_t *timer, uint32_t slack_ms)
+{
+    (void)timer;
+    (void)slack_ms;
+}
+
 /*!
     \brief      Miscellaneous initialization work after OS initialized and
                 task scheduler started
@@ -1669,6 +1688,31 @@ void sys_os_misc_init(void)
 
 }
 
+#ifdef CFG_OS_PROFILE
+/*!
+    \brief      scheduler hook feeding the CPU profiler
+    \param[in]  from: thread switched out
+    \param[in]  to: thread switched in
+    \param[out] none
+    \retval     none
+*/
+static void rtthread_prof_switch_hook(rt_thread_t from, rt_thread_t to)
+{
+    sys_prof_task_switch(to, to->parent.name);
+}
+
+/*!
+    \brief      thread resume hook feeding the CPU profiler
+    \param[in]  thread: thread made ready
+    \param[out] none
+    \retval     none
+*/
+static void rtthread_prof_ready_hook(rt_thread_t thread)
+{
+    sys_prof_task_ready(thread, thread->parent.name);
+}
+#endif
+
 /*!
     \brief      initialize the OS
     \param[in]  none
@@ -1689,6 +1733,10 @@ void sys_os_init(void)
     rt_system_lps_init();
 #endif
     rt_thread_idle_init();
+#ifdef CFG_OS_PROFILE
+    rt_scheduler_sethook(rtthread_prof_switch_hook);
+    rt_thread_resume_sethook(rtthread_prof_ready_hook);
+#endif
     rt_show_version();
 }
 
@@ -1863,6 +1911,9 @@ uint32_t sys_in_critical(void)
 void sys_enter_critical(void)
 {
     vPortEnterCritical();
+#ifdef CFG_OS_PROFILE
+    sys_prof_crit_enter();
+#endif
 }
 
 /*!
@@ -1873,6 +1924,9 @@ void sys_enter_critical(void)
 */
 void sys_exit_critical(void)
 {
+#ifdef CFG_OS_PROFILE
+    sys_prof_crit_exit((uint32_t)__builtin_return_address(0));
+#endif
     vPortExitCritical();
 }
 
@@ -1884,6 +1938,9 @@ void sys_exit_critical(void)
 */
 void sys_int_enter(void)
 {
+#ifdef CFG_OS_PROFILE
+    sys_prof_int_enter();
+#endif
     rt_interrupt_enter();
 }
 
@@ -1896,6 +1953,9 @@ void sys_int_enter(void)
 void sys_int_exit(void)
 {
     rt_interrupt_leave();
+#ifdef CFG_OS_PROFILE
+    sys_prof_int_exit();
+#endif
 }
 
 /*!
@@ -1947,6 +2007,18 @@ void sys_cpu_sleep_time_get(uint32_t *stats_ms, uint32_t *sleep_ms)
     return;
 }
 
+/*!
+    \brief      get the sleep state residency and wakeup statistics
+    \param[in]  reset: restart the statistics after reading them
+    \param[out] stats: sleep statistics
+    \retval     none
+*/
+void sys_sleep_stats_get(sys_sleep_stats_t *stats, int reset)
+{
+    (void)reset;
+    sys_memset(stats, 0, sizeof(*stats));
+}
+
 /*!
     \brief      show cpu usage percentage per task
     \retval     none
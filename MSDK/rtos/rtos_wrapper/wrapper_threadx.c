@@ -986,6 +986,9 @@ void sys_task_delete(void *task)
     }
 
     if (task_wrapper != NULL) {
+#ifdef CFG_OS_PROFILE
+        sys_prof_task_delete(&task_wrapper->tx_thread);
+#endif
         sys_enter_critical();
         co_list_push_back(&threadx_idle_task.rmv_task_list, &(task_wrapper->hdr));
         sys_exit_critical();
@@ -2297,6 +2300,21 @@ uint8_t sys_timer_pending(os_timer_t *timer)
 
 }
 
+/*!
+    \brief      set the tolerance of a timer expiry
+                Note: timer coalescing is only implemented with FreeRTOS,
+                the timers keep their exact expiry here.
+    \param[in]  timer: pointer to the timer handle
+    \param[in]  slack_ms: maximum delay allowed on the expiry in milliseconds
+    \param[out] none
+    \retval     none
+*/
+void sys_timer_slack_set(os_timer_t *timer, uint32_t slack_ms)
+{
+    (void)timer;
+    (void)slack_ms;
+}
+
 /*!
     \brief      Miscellaneous initialization work after OS initialized and
                 task scheduler started
@@ -2310,6 +2328,42 @@ void sys_os_misc_init(void)
 
 }
 
+#if defined(CFG_OS_PROFILE) && defined(TX_ENABLE_EXECUTION_CHANGE_NOTIFY)
+/*!
+    \brief      ThreadX execution change notification, a thread is scheduled
+                Note: ThreadX has no hook for threads made ready, ready latency is not measured
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+VOID _tx_execution_thread_enter(VOID)
+{
+    TX_THREAD *p_thread = tx_thread_identify();
+
+    if (p_thread != NULL)
+        sys_prof_task_switch(p_thread, p_thread->tx_thread_name);
+}
+
+/*!
+    \brief      ThreadX execution change notifications not used by the profiler,
+                ISRs are timed by sys_int_enter/exit
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+VOID _tx_execution_thread_exit(VOID)
+{
+}
+
+VOID _tx_execution_isr_enter(VOID)
+{
+}
+
+VOID _tx_execution_isr_exit(VOID)
+{
+}
+#endif
+
 /*!
     \brief      initialize the OS
     \param[in]  none
@@ -2552,6 +2606,9 @@ void sys_enter_critical(void)
     vPortEnterCritical();
     _tx_thread_preempt_disable++;
 #endif
+#ifdef CFG_OS_PROFILE
+    sys_prof_crit_enter();
+#endif
 }
 
 /*!
@@ -2580,11 +2637,17 @@ void sys_exit_critical(void)
         return;
     }
 
+#ifdef CFG_OS_PROFILE
+    sys_prof_crit_exit((uint32_t)__builtin_return_address(0));
+#endif
     _tx_thread_preempt_disable--;
     tx_queue_receive(&critic_queue.queue, &interrupt_value, TX_NO_WAIT);
     interrupt_save = interrupt_value;
     TX_RESTORE;
 #else
+#ifdef CFG_OS_PROFILE
+    sys_prof_crit_exit((uint32_t)__builtin_return_address(0));
+#endif
     _tx_thread_preempt_disable--;
     vPortExitCritical();
     _tx_thread_system_preempt_check();
@@ -2599,6 +2662,9 @@ void sys_exit_critical(void)
 */
 void sys_int_enter(void)
 {
+#ifdef CFG_OS_PROFILE
+    sys_prof_int_enter();
+#endif
     // Threadx no longer need record this
     return;
 }
@@ -2611,6 +2677,9 @@ void sys_int_enter(void)
 */
 void sys_int_exit(void)
 {
+#ifdef CFG_OS_PROFILE
+    sys_prof_int_exit();
+#endif
     // Threadx no longer need record this
     return;
 }
@@ -2650,6 +2719,18 @@ void sys_cpu_sleep_time_get(uint32_t *stats_ms, uint32_t *sleep_ms)
     return;
 }
 
+/*!
+    \brief      get the sleep state residency and wakeup statistics
+    \param[in]  reset: restart the statistics after reading them
+    \param[out] stats: sleep statistics
+    \retval     none
+*/
+void sys_sleep_stats_get(sys_sleep_stats_t *stats, int reset)
+{
+    (void)reset;
+    sys_memset(stats, 0, sizeof(*stats));
+}
+
 /*!
     \brief      show cpu usage percentage per task
     \retval     none
@@ -0,0 +1,211 @@
+/*!
+    \file    test_atcmd_hash.c
+    \brief   Unit test and lookup benchmark of the AT command hash index
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Unit test and lookup benchmark of the AT command hash index. The table holds the command
+ * names of atcmd.c. The index must resolve every line as the linear resolver it replaced:
+ * names, queries ("AT+XXX?"), unknown commands, prefixes and duplicated names. The
+ * benchmark replays the command mix of an AT gateway, mostly AT+CIPRECVDATA polling.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "atcmd.h"
+
+#define BENCH_LINES             2000000
+
+static const char *const names[] = {
+#include "atcmd_names.h"
+};
+#define NAME_NUM                (sizeof(names) / sizeof(names[0]))
+
+static void cmd_exec(int argc, char **argv)
+{
+}
+
+static struct atcmd_entry table[NAME_NUM + 1];
+static struct atcmd_hash_slot hash[AT_CMD_HASH_SIZE];
+
+/* the resolver of atcmd_task before the index */
+static const struct atcmd_entry *linear_lookup(const struct atcmd_entry *tbl, uint32_t num, const char *name)
+{
+    uint32_t i;
+
+    for (i = 0; i < num; i++) {
+        if ((strcmp(name, tbl[i].name) == 0) ||
+            (strncmp(name, tbl[i].name, strlen(tbl[i].name)) == 0
+            && name[strlen(name) - 1] == AT_QUESTION
+            && (strlen(name) == strlen(tbl[i].name) + 1)))
+            return &tbl[i];
+    }
+    return NULL;
+}
+
+static void check_line(const char *line)
+{
+    const struct atcmd_entry *ref = linear_lookup(table, NAME_NUM, line);
+    const struct atcmd_entry *got = atcmd_hash_lookup(hash, table, line);
+
+    if (got != ref) {
+        printf("\"%s\": index %ld, linear %ld\n", line, got ? (long)(got - table) : -1L,
+               ref ? (long)(ref - table) : -1L);
+        TEST_ASSERT(got == ref);
+    }
+}
+
+/* every line resolves as with the linear resolver */
+static void test_resolve(void)
+{
+    char line[64];
+    uint32_t i, len, dup = 0;
+
+    printf("resolve, %u commands\n", (unsigned)NAME_NUM);
+    for (i = 0; i < NAME_NUM; i++) {
+        TEST_ASSERT(atcmd_hash_lookup(hash, table, names[i]) != NULL);
+        dup += atcmd_hash_lookup(hash, table, names[i]) != &table[i];
+        len = strlen(names[i]);
+        TEST_ASSERT(len + 3 <= sizeof(line));
+        check_line(names[i]);
+        // query
+        snprintf(line, sizeof(line), "%s?", names[i]);
+        check_line(line);
+        // unknown: longer, double query, prefixes, lower case
+        snprintf(line, sizeof(line), "%sX", names[i]);
+        check_line(line);
+        snprintf(line, sizeof(line), "%s??", names[i]);
+        check_line(line);
+        memcpy(line, names[i], len + 1);
+        while (len > 0) {
+            line[--len] = '\0';
+            check_line(line);
+        }
+        snprintf(line, sizeof(line), "%s", names[i]);
+        line[1] = 't';
+        check_line(line);
+    }
+    check_line("");
+    check_line("?");
+    check_line("AT+");
+    check_line("AT+NOTACOMMAND");
+    printf("  %u duplicated names, resolved to their first entry\n", dup);
+}
+
+/* table size limits and duplicated names */
+static void test_build(void)
+{
+    static struct atcmd_entry big[AT_CMD_HASH_SIZE];
+    struct atcmd_entry dup[3] = {{"AT+A", cmd_exec}, {"AT+B", cmd_exec}, {"AT+A", cmd_exec}};
+    static char big_names[AT_CMD_HASH_SIZE][16];
+    uint32_t i;
+
+    printf("build\n");
+    TEST_ASSERT(atcmd_hash_build(hash, dup, 3) == 0);
+    TEST_ASSERT(atcmd_hash_lookup(hash, dup, "AT+A") == &dup[0]);
+    TEST_ASSERT(atcmd_hash_lookup(hash, dup, "AT+A?") == &dup[0]);
+    TEST_ASSERT(atcmd_hash_lookup(hash, dup, "AT+B") == &dup[1]);
+    TEST_ASSERT(atcmd_hash_lookup(hash, dup, "AT+C") == NULL);
+
+    for (i = 0; i < AT_CMD_HASH_SIZE; i++) {
+        snprintf(big_names[i], sizeof(big_names[i]), "AT+CMD%u", i);
+        big[i].name = big_names[i];
+        big[i].exec = cmd_exec;
+    }
+    // an empty slot must remain, and the slot index is 8-bit
+    TEST_ASSERT(atcmd_hash_build(hash, big, AT_CMD_HASH_SIZE) == -1);
+    TEST_ASSERT(atcmd_hash_build(hash, big, AT_CMD_HASH_SIZE - 1) == 0);
+    for (i = 0; i < AT_CMD_HASH_SIZE - 1; i++)
+        TEST_ASSERT(atcmd_hash_lookup(hash, big, big_names[i]) == &big[i]);
+    TEST_ASSERT(atcmd_hash_lookup(hash, big, "AT+CMD255") == NULL);
+}
+
+/* lines per second of an AT gateway, with both resolvers */
+static void bench(void)
+{
+    // command and weight, in lines out of 100
+    static const struct {
+        const char *line;
+        int weight;
+    } mix[] = {
+        {"AT+CIPRECVDATA", 55}, {"AT+CIPSEND", 15}, {"AT+CIPSTATUS", 8}, {"AT+CIPSTATUS?", 2},
+        {"AT+CWSTATUS", 5}, {"AT+CIPSTART", 4}, {"AT+CIPCLOSE", 4}, {"AT+PING", 3},
+        {"AT+CWLAP", 2}, {"AT+RST", 1}, {"AT+BADCMD", 1},
+    };
+    const char *lines[100];
+    const struct atcmd_entry *e;
+    uint64_t t0, t_linear, t_hash;
+    uint32_t i, j, n = 0, found = 0;
+
+    for (i = 0; i < sizeof(mix) / sizeof(mix[0]); i++) {
+        for (j = 0; j < (uint32_t)mix[i].weight; j++)
+            lines[n++] = mix[i].line;
+    }
+    TEST_ASSERT_EQ(n, 100);
+
+    t0 = host_time_ns();
+    for (i = 0; i < BENCH_LINES; i++) {
+        e = linear_lookup(table, NAME_NUM, lines[(i * 37) % 100]);
+        found += (e != NULL);
+    }
+    t_linear = host_time_ns() - t0;
+    t0 = host_time_ns();
+    for (i = 0; i < BENCH_LINES; i++) {
+        e = atcmd_hash_lookup(hash, table, lines[(i * 37) % 100]);
+        found -= (e != NULL);
+    }
+    t_hash = host_time_ns() - t0;
+    TEST_ASSERT_EQ(found, 0);
+
+    printf("gateway mix, %u commands in the table\n", (unsigned)NAME_NUM);
+    printf("  linear %.1f ns/line, hashed %.1f ns/line\n",
+           (double)t_linear / BENCH_LINES, (double)t_hash / BENCH_LINES);
+    TEST_ASSERT(t_hash < t_linear);
+}
+
+int main(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < NAME_NUM; i++) {
+        table[i].name = (char *)names[i];
+        table[i].exec = cmd_exec;
+    }
+    TEST_ASSERT(atcmd_hash_build(hash, table, NAME_NUM) == 0);
+    test_resolve();
+    bench();
+    test_build();
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,609 @@
+/*!
+    \file    host_os.c
+    \brief   host port of the OS wrapper used by the host tests
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <time.h>
+#include "wrapper_os.h"
+#include "systime.h"
+#include "host_test.h"
+
+#define HOST_HEAP_DEFAULT               (256 * 1024)
+#define HOST_TASK_NAME_LEN              16
+
+/* each block is preceded by its size */
+struct host_blk
+{
+    size_t size;
+    size_t rsvd;
+};
+
+struct host_task
+{
+    pthread_t thread;
+    task_func_t func;
+    void *ctx;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+    char name[HOST_TASK_NAME_LEN];
+};
+
+uint32_t SystemCoreClock = 160000000;
+
+static pthread_mutex_t host_heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t host_crit_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static uint32_t host_heap_size = HOST_HEAP_DEFAULT;
+static uint32_t host_heap_live;
+static uint32_t host_heap_min_free = HOST_HEAP_DEFAULT;
+static uint32_t host_time_offset_ms;
+static bool host_sim_time;
+static uint64_t host_sim_time_us;
+static __thread struct host_task *host_cur_task;
+
+uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void host_heap_limit_set(uint32_t size)
+{
+    pthread_mutex_lock(&host_heap_lock);
+    host_heap_size = size ? size : 0xffffffff;
+    host_heap_min_free = host_heap_size - host_heap_live;
+    pthread_mutex_unlock(&host_heap_lock);
+}
+
+uint32_t host_heap_used(void)
+{
+    return host_heap_live;
+}
+
+void host_time_shift_ms(uint32_t ms)
+{
+    host_time_offset_ms += ms;
+}
+
+void host_sim_time_set_us(uint64_t us)
+{
+    host_sim_time = true;
+    host_sim_time_us = us;
+}
+
+/* ---- heap ---- */
+void *sys_malloc(size_t size)
+{
+    struct host_blk *blk = NULL;
+
+    pthread_mutex_lock(&host_heap_lock);
+    if (host_heap_live + size <= host_heap_size) {
+        blk = malloc(sizeof(*blk) + size);
+        if (blk) {
+            blk->size = size;
+            host_heap_live += size;
+            if (host_heap_size - host_heap_live < host_heap_min_free)
+                host_heap_min_free = host_heap_size - host_heap_live;
+        }
+    }
+    pthread_mutex_unlock(&host_heap_lock);
+
+    return blk ? blk + 1 : NULL;
+}
+
+void *sys_calloc(size_t count, size_t size)
+{
+    void *mem = sys_malloc(count * size);
+
+    if (mem)
+        memset(mem, 0, count * size);
+    return mem;
+}
+
+void sys_mfree(void *ptr)
+{
+    struct host_blk *blk;
+
+    if (ptr == NULL)
+        return;
+    blk = (struct host_blk *)ptr - 1;
+    pthread_mutex_lock(&host_heap_lock);
+    host_heap_live -= blk->size;
+    pthread_mutex_unlock(&host_heap_lock);
+    free(blk);
+}
+
+void *sys_realloc(void *mem, size_t size)
+{
+    void *new_mem;
+    size_t old;
+
+    if (mem == NULL)
+        return sys_malloc(size);
+    new_mem = sys_malloc(size);
+    if (new_mem) {
+        old = ((struct host_blk *)mem - 1)->size;
+        memcpy(new_mem, mem, old < size ? old : size);
+        sys_mfree(mem);
+    }
+    return new_mem;
+}
+
+int32_t sys_free_heap_size(void)
+{
+    return host_heap_size - host_heap_live;
+}
+
+int32_t sys_min_free_heap_size(void)
+{
+    return host_heap_min_free;
+}
+
+void sys_memset(void *s, uint8_t c, uint32_t count)
+{
+    memset(s, c, count);
+}
+
+void sys_memcpy(void *des, const void *src, uint32_t n)
+{
+    memcpy(des, src, n);
+}
+
+void sys_memmove(void *des, const void *src, uint32_t n)
+{
+    memmove(des, src, n);
+}
+
+int32_t sys_memcmp(const void *buf1, const void *buf2, uint32_t count)
+{
+    return memcmp(buf1, buf2, count);
+}
+
+/* ---- tasks ---- */
+static struct host_task *host_task_alloc(const uint8_t *name)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->cond, NULL);
+    if (name)
+        snprintf(task->name, sizeof(task->name), "%s", (const char *)name);
+    return task;
+}
+
+static struct host_task *host_task_self(void)
+{
+    if (host_cur_task == NULL) {
+        host_cur_task = host_task_alloc((const uint8_t *)"main");
+        host_cur_task->thread = pthread_self();
+    }
+    return host_cur_task;
+}
+
+static void *host_task_entry(void *arg)
+{
+    struct host_task *task = arg;
+
+    host_cur_task = task;
+    task->func(task->ctx);
+    return NULL;
+}
+
+void *sys_task_create(void *static_tcb, const uint8_t *name, uint32_t *stack_base, uint32_t stack_size,
+                    uint32_t queue_size, uint32_t queue_item_size, uint32_t priority, task_func_t func, void *ctx)
+{
+    struct host_task *task = host_task_alloc(name);
+
+    task->func = func;
+    task->ctx = ctx;
+    if (pthread_create(&task->thread, NULL, host_task_entry, task)) {
+        free(task);
+        return NULL;
+    }
+    pthread_detach(task->thread);
+    return task;
+}
+
+void sys_task_delete(void *task)
+{
+    if ((task == NULL) || (task == host_cur_task))
+        pthread_exit(NULL);
+}
+
+os_task_t sys_current_task_handle_get(void)
+{
+    return host_task_self();
+}
+
+char *sys_task_name_get(void *task)
+{
+    return ((struct host_task *)(task ? task : host_task_self()))->name;
+}
+
+int sys_task_init_notification(void *task)
+{
+    return 0;
+}
+
+int sys_task_wait_notification(int timeout)
+{
+    struct host_task *task = host_task_self();
+    struct timespec ts;
+    int count;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (timeout > 0) {
+        ts.tv_sec += timeout / 1000;
+        ts.tv_nsec += (timeout % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&task->lock);
+    while ((task->notify == 0) && (timeout != 0)) {
+        if (timeout < 0)
+            pthread_cond_wait(&task->cond, &task->lock);
+        else if (pthread_cond_timedwait(&task->cond, &task->lock, &ts) == ETIMEDOUT)
+            break;
+    }
+    count = task->notify;
+    task->notify = 0;
+    pthread_mutex_unlock(&task->lock);
+
+    return count;
+}
+
+void sys_task_notify(void *task, bool isr)
+{
+    struct host_task *t = task;
+
+    pthread_mutex_lock(&t->lock);
+    t->notify++;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+/* ---- semaphores and mutexes ---- */
+int32_t sys_sema_init_ext(os_sema_t *sema, int max_count, int init_count)
+{
+    sem_t *sem = malloc(sizeof(sem_t));
+
+    if ((sem == NULL) || sem_init(sem, 0, init_count)) {
+        free(sem);
+        *sema = NULL;
+        return OS_ERROR;
+    }
+    *sema = sem;
+    return OS_OK;
+}
+
+int32_t sys_sema_init(os_sema_t *sema, int32_t init_val)
+{
+    return sys_sema_init_ext(sema, 0x7fffffff, init_val);
+}
+
+void sys_sema_free(os_sema_t *sema)
+{
+    if (*sema) {
+        sem_destroy(*sema);
+        free(*sema);
+        *sema = NULL;
+    }
+}
+
+void sys_sema_up(os_sema_t *sema)
+{
+    sem_post(*sema);
+}
+
+void sys_sema_up_from_isr(os_sema_t *sema)
+{
+    sem_post(*sema);
+}
+
+int32_t sys_sema_down(os_sema_t *sema, uint32_t timeout_ms)
+{
+    struct timespec ts;
+
+    if (timeout_ms == 0) {
+        while (sem_wait(*sema) && (errno == EINTR));
+        return OS_OK;
+    }
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return sem_timedwait(*sema, &ts) ? OS_TIMEOUT : OS_OK;
+}
+
+int sys_sema_get_count(os_sema_t *sema)
+{
+    int val;
+
+    sem_getvalue(*sema, &val);
+    return val;
+}
+
+int sys_mutex_init(os_mutex_t *mutex)
+{
+    pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(m, &attr);
+    *mutex = m;
+    return OS_OK;
+}
+
+void sys_mutex_free(os_mutex_t *mutex)
+{
+    pthread_mutex_destroy(*mutex);
+    free(*mutex);
+    *mutex = NULL;
+}
+
+int32_t sys_mutex_get(os_mutex_t *mutex)
+{
+    pthread_mutex_lock(*mutex);
+    return OS_OK;
+}
+
+int32_t sys_mutex_try_get(os_mutex_t *mutex, int timeout)
+{
+    return pthread_mutex_trylock(*mutex) ? OS_ERROR : OS_OK;
+}
+
+void sys_mutex_put(os_mutex_t *mutex)
+{
+    pthread_mutex_unlock(*mutex);
+}
+
+/* ---- message queues ---- */
+struct host_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t item_size;
+    int32_t size;
+    int32_t cnt;
+    int32_t head;
+    uint8_t *buf;
+};
+
+static void host_deadline(struct timespec *ts, int timeout_ms)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+int32_t sys_queue_init(os_queue_t *queue, int32_t queue_size, uint32_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+
+    if (q == NULL)
+        return OS_ERROR;
+    q->buf = malloc((size_t)queue_size * item_size);
+    if (q->buf == NULL) {
+        free(q);
+        return OS_ERROR;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->item_size = item_size;
+    q->size = queue_size;
+    *queue = q;
+    return OS_OK;
+}
+
+void sys_queue_free(os_queue_t *queue)
+{
+    struct host_queue *q = *queue;
+
+    if (q) {
+        pthread_mutex_destroy(&q->lock);
+        pthread_cond_destroy(&q->cond);
+        free(q->buf);
+        free(q);
+        *queue = NULL;
+    }
+}
+
+/* wait until the queue is not full (write) or not empty (read), timeout as sys_queue_write */
+static int host_queue_wait(struct host_queue *q, bool write, int timeout)
+{
+    struct timespec ts;
+
+    if (timeout > 0)
+        host_deadline(&ts, timeout);
+    while (write ? (q->cnt == q->size) : (q->cnt == 0)) {
+        if (timeout == 0)
+            return OS_TIMEOUT;
+        if (timeout < 0)
+            pthread_cond_wait(&q->cond, &q->lock);
+        else if (pthread_cond_timedwait(&q->cond, &q->lock, &ts) == ETIMEDOUT)
+            return OS_TIMEOUT;
+    }
+    return OS_OK;
+}
+
+int sys_queue_write(os_queue_t *queue, void *msg, int timeout, bool isr)
+{
+    struct host_queue *q = *queue;
+    int ret;
+
+    pthread_mutex_lock(&q->lock);
+    ret = host_queue_wait(q, true, isr ? 0 : timeout);
+    if (ret == OS_OK) {
+        memcpy(q->buf + ((q->head + q->cnt) % q->size) * q->item_size, msg, q->item_size);
+        q->cnt++;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+int sys_queue_read(os_queue_t *queue, void *msg, int timeout, bool isr)
+{
+    struct host_queue *q = *queue;
+    int ret;
+
+    pthread_mutex_lock(&q->lock);
+    ret = host_queue_wait(q, false, isr ? 0 : timeout);
+    if (ret == OS_OK) {
+        memcpy(msg, q->buf + q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->size;
+        q->cnt--;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+int32_t sys_queue_post(os_queue_t *queue, void *msg)
+{
+    return sys_queue_write(queue, msg, -1, false) ? OS_ERROR : OS_OK;
+}
+
+int32_t sys_queue_post_with_timeout(os_queue_t *queue, void *msg, int32_t timeout_ms)
+{
+    return sys_queue_write(queue, msg, timeout_ms, false) ? OS_ERROR : OS_OK;
+}
+
+int32_t sys_queue_fetch(os_queue_t *queue, void *msg, uint32_t timeout_ms, uint8_t is_blocking)
+{
+    int timeout = is_blocking ? (timeout_ms ? (int)timeout_ms : -1) : 0;
+
+    return sys_queue_read(queue, msg, timeout, false) ? OS_TIMEOUT : OS_OK;
+}
+
+bool sys_queue_is_empty(os_queue_t *queue)
+{
+    return sys_queue_cnt(queue) == 0;
+}
+
+int sys_queue_cnt(os_queue_t *queue)
+{
+    struct host_queue *q = *queue;
+    int cnt;
+
+    pthread_mutex_lock(&q->lock);
+    cnt = q->cnt;
+    pthread_mutex_unlock(&q->lock);
+    return cnt;
+}
+
+/* ---- critical sections: one lock shared by all the host threads ---- */
+void sys_enter_critical(void)
+{
+    pthread_mutex_lock(&host_crit_lock);
+}
+
+void sys_exit_critical(void)
+{
+    pthread_mutex_unlock(&host_crit_lock);
+}
+
+void sys_sched_lock(void)
+{
+    sys_enter_critical();
+}
+
+void sys_sched_unlock(void)
+{
+    sys_exit_critical();
+}
+
+/* ---- time ---- */
+uint32_t sys_current_time_get(void)
+{
+    return (uint32_t)(get_sys_local_time_us() / 1000);
+}
+
+uint32_t sys_os_now(bool isr)
+{
+    return sys_current_time_get();
+}
+
+uint64_t get_sys_local_time_us(void)
+{
+    if (host_sim_time)
+        return host_sim_time_us;
+    return host_time_ns() / 1000 + (uint64_t)host_time_offset_ms * 1000;
+}
+
+void sys_ms_sleep(int ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+
+    while (nanosleep(&ts, &ts) && (errno == EINTR));
+}
+
+void sys_us_delay(uint32_t nus)
+{
+    uint64_t end = host_time_ns() + (uint64_t)nus * 1000;
+
+    while (host_time_ns() < end);
+}
+
+void sys_yield(void)
+{
+    sched_yield();
+}
+
+int32_t sys_random_bytes_get(void *dst, uint32_t size)
+{
+    uint8_t *p = dst;
+
+    while (size--)
+        *p++ = (uint8_t)rand();
+    return 0;
+}
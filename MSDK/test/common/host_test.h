@@ -0,0 +1,73 @@
+/*!
+    \file    host_test.h
+    \brief   helpers shared by the host unit tests, simulations and benchmarks
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/* stop the test with a non-zero exit code when cond is false */
+#define TEST_ASSERT(cond)                                                       \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            printf("%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #cond);  \
+            exit(1);                                                            \
+        }                                                                       \
+    } while (0)
+
+/* TEST_ASSERT printing two integer values on failure */
+#define TEST_ASSERT_EQ(a, b)                                                    \
+    do {                                                                        \
+        long long _a = (long long)(a), _b = (long long)(b);                     \
+        if (_a != _b) {                                                         \
+            printf("%s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, \
+                   #a, #b, _a, _b);                                             \
+            exit(1);                                                            \
+        }                                                                       \
+    } while (0)
+
+/* monotonic host time, for benchmarks */
+uint64_t host_time_ns(void);
+/* limit the heap seen by sys_malloc, 0 for no limit */
+void host_heap_limit_set(uint32_t size);
+/* bytes currently allocated with sys_malloc */
+uint32_t host_heap_used(void);
+/* shift the time returned by the OS wrapper, to test expirations */
+void host_time_shift_ms(uint32_t ms);
+/* make the OS wrapper time a simulated clock, set with host_sim_time_set_us, for simulations */
+void host_sim_time_set_us(uint64_t us);
+
+#endif /* _HOST_TEST_H_ */
@@ -0,0 +1,381 @@
+/*!
+    \file    test_heap_prof.c
+    \brief   Unit test of the allocation site heap profiler
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Unit test of the allocation site heap profiler (CFG_HEAP_PROFILE). The FreeRTOS heap
+ * is a first-fit heap with coalescing on a static array, so that the allocation failures
+ * and the fragmentation of its free list are those of a real heap. The allocation sites
+ * are functions of this file: each one has its own return address.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "wrapper_os.h"
+#include "host_test.h"
+
+#define HEAP_SIZE               (64 * 1024)
+#define HEAP_BLK_HDR            8
+#define HEAP_ALIGN(n)           (((n) + 7) & ~7)
+/* more sites than the profiler table holds */
+#define OVERFLOW_SITE_NUM       (HEAP_PROF_SITE_NUM + 8)
+/* fewer sites than are live */
+#define TOP_SITE_NUM            4
+
+/* ---- first-fit heap behind pvPortMalloc ---- */
+struct heap_blk
+{
+    uint32_t size;      // block size, header included
+    uint32_t used;
+};
+
+static uint8_t heap[HEAP_SIZE] __attribute__((aligned(8)));
+
+#define HEAP_BLK(off)           ((struct heap_blk *)(heap + (off)))
+
+static void heap_init(void)
+{
+    HEAP_BLK(0)->size = HEAP_SIZE;
+    HEAP_BLK(0)->used = 0;
+}
+
+void *pvPortMalloc(size_t size)
+{
+    uint32_t need = HEAP_ALIGN(size) + HEAP_BLK_HDR, off;
+    struct heap_blk *b;
+
+    for (off = 0; off < HEAP_SIZE; off += b->size) {
+        b = HEAP_BLK(off);
+        if (b->used || (b->size < need))
+            continue;
+        if (b->size - need >= 2 * HEAP_BLK_HDR) {
+            HEAP_BLK(off + need)->size = b->size - need;
+            HEAP_BLK(off + need)->used = 0;
+            b->size = need;
+        }
+        b->used = 1;
+        return b + 1;
+    }
+    return NULL;
+}
+
+void vPortFree(void *pv)
+{
+    struct heap_blk *b, *n;
+    uint32_t off;
+
+    if (pv == NULL)
+        return;
+    b = (struct heap_blk *)pv - 1;
+    TEST_ASSERT(b->used);
+    b->used = 0;
+    // merge the free neighbours
+    for (off = 0; off < HEAP_SIZE; off += b->size) {
+        b = HEAP_BLK(off);
+        while (!b->used && (off + b->size < HEAP_SIZE) && !(n = HEAP_BLK(off + b->size))->used)
+            b->size += n->size;
+    }
+}
+
+void *pvPortReAlloc(void *pv, size_t size)
+{
+    struct heap_blk *b;
+    uint32_t old;
+    void *p;
+
+    p = pvPortMalloc(size);
+    if ((p == NULL) || (pv == NULL))
+        return p;
+    b = (struct heap_blk *)pv - 1;
+    old = b->size - HEAP_BLK_HDR;
+    memcpy(p, pv, old < size ? old : size);
+    vPortFree(pv);
+    return p;
+}
+
+void vPortGetHeapStats(HeapStats_t *stats)
+{
+    struct heap_blk *b;
+    uint32_t off;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->xSizeOfSmallestFreeBlockInBytes = HEAP_SIZE;
+    for (off = 0; off < HEAP_SIZE; off += b->size) {
+        b = HEAP_BLK(off);
+        if (b->used)
+            continue;
+        stats->xAvailableHeapSpaceInBytes += b->size;
+        stats->xNumberOfFreeBlocks++;
+        if (b->size > stats->xSizeOfLargestFreeBlockInBytes)
+            stats->xSizeOfLargestFreeBlockInBytes = b->size;
+        if (b->size < stats->xSizeOfSmallestFreeBlockInBytes)
+            stats->xSizeOfSmallestFreeBlockInBytes = b->size;
+    }
+}
+
+/* of the OS wrapper, which the test does not link */
+void sys_memset(void *s, uint8_t c, uint32_t count)
+{
+    memset(s, c, count);
+}
+
+/* ---- allocation sites ---- */
+static __attribute__((noinline)) void *site_malloc(size_t size)
+{
+    return sys_malloc(size);
+}
+
+static __attribute__((noinline)) void *site_calloc(size_t count, size_t size)
+{
+    return sys_calloc(count, size);
+}
+
+static __attribute__((noinline)) void *site_realloc(void *mem, size_t size)
+{
+    return sys_realloc(mem, size);
+}
+
+/* distinct bodies, so that the compiler does not merge them */
+static volatile uint32_t site_calls[64];
+#define SITE_FUNC(n)                                                            \
+    static __attribute__((noinline)) void *site_##n(size_t size)                \
+    {                                                                           \
+        site_calls[n]++;                                                        \
+        return sys_malloc(size);                                                \
+    }
+#define SITE_FUNC8(n)                                                           \
+    SITE_FUNC(n##0) SITE_FUNC(n##1) SITE_FUNC(n##2) SITE_FUNC(n##3)             \
+    SITE_FUNC(n##4) SITE_FUNC(n##5) SITE_FUNC(n##6) SITE_FUNC(n##7)
+#define SITE_PTR8(n)                                                            \
+    site_##n##0, site_##n##1, site_##n##2, site_##n##3,                         \
+    site_##n##4, site_##n##5, site_##n##6, site_##n##7
+
+SITE_FUNC8(1) SITE_FUNC8(2) SITE_FUNC8(3) SITE_FUNC8(4) SITE_FUNC8(5)
+
+static void *(*const site_funcs[OVERFLOW_SITE_NUM])(size_t) = {
+    SITE_PTR8(1), SITE_PTR8(2), SITE_PTR8(3), SITE_PTR8(4), SITE_PTR8(5)
+};
+
+static uint32_t live_get(void)
+{
+    uint32_t live, peak, fail;
+
+    sys_heap_prof_info(&live, &peak, &fail);
+    return live;
+}
+
+/* per site counters and totals of a simple allocation pattern, reset */
+static void test_accounting(void)
+{
+    sys_heap_site_t s[8];
+    uint32_t live, peak, fail;
+    void *a[10], *b[6], *c;
+    uint8_t *p;
+    int i, n;
+
+    printf("accounting\n");
+    for (i = 0; i < 10; i++)
+        a[i] = site_malloc(100);
+    for (i = 0; i < 6; i++) {
+        b[i] = site_calloc(4, 50);
+        p = b[i];
+        TEST_ASSERT((p != NULL) && (p[0] == 0) && (p[199] == 0));
+    }
+    c = site_realloc(NULL, 30);
+    memset(c, 0x5A, 30);
+    c = site_realloc(c, 300);
+    TEST_ASSERT((((uint8_t *)c)[0] == 0x5A) && (((uint8_t *)c)[29] == 0x5A));
+    for (i = 0; i < 5; i++)
+        sys_mfree(a[i]);
+
+    // sorted by live bytes: calloc 1200, malloc 500, realloc 300
+    n = sys_heap_prof_sites_get(s, 8);
+    TEST_ASSERT_EQ(n, 3);
+    TEST_ASSERT((s[0].live_bytes == 1200) && (s[0].peak_bytes == 1200) && (s[0].live_cnt == 6) && (s[0].alloc_cnt == 6));
+    TEST_ASSERT((s[1].live_bytes == 500) && (s[1].peak_bytes == 1000) && (s[1].live_cnt == 5) && (s[1].alloc_cnt == 10));
+    // a realloc moves the block to the site of the last call
+    TEST_ASSERT((s[2].live_bytes == 300) && (s[2].peak_bytes == 300) && (s[2].live_cnt == 1) && (s[2].alloc_cnt == 2));
+    TEST_ASSERT((s[0].ra != 0) && (s[0].ra != s[1].ra) && (s[1].ra != s[2].ra));
+    sys_heap_prof_info(&live, &peak, &fail);
+    TEST_ASSERT_EQ(live, 2000);
+    TEST_ASSERT_EQ(peak, 2500);
+    TEST_ASSERT_EQ(fail, 0);
+
+    // the peaks and counts restart from what is live
+    sys_heap_prof_reset();
+    sys_heap_prof_info(&live, &peak, &fail);
+    TEST_ASSERT((live == 2000) && (peak == 2000));
+    n = sys_heap_prof_sites_get(s, 8);
+    TEST_ASSERT((n == 3) && (s[1].peak_bytes == 500) && (s[1].alloc_cnt == 5));
+
+    for (i = 5; i < 10; i++)
+        sys_mfree(a[i]);
+    for (i = 0; i < 6; i++)
+        sys_mfree(b[i]);
+    sys_mfree(c);
+    sys_mfree(NULL);
+    TEST_ASSERT_EQ(live_get(), 0);
+
+    // sites with nothing allocated since the reset are not reported
+    sys_heap_prof_reset();
+    TEST_ASSERT_EQ(sys_heap_prof_sites_get(s, 8), 0);
+}
+
+/* failed allocations are counted, a failed realloc leaves the block to its owner */
+static void test_failures(void)
+{
+    static void *blk[HEAP_SIZE / 1024];
+    uint32_t live, peak, fail;
+    int i, n;
+
+    printf("failures\n");
+    for (n = 0; (blk[n] = site_malloc(1000)) != NULL; n++)
+        memset(blk[n], n, 1000);
+    TEST_ASSERT(n > 0);
+    sys_heap_prof_info(&live, &peak, &fail);
+    TEST_ASSERT((live == n * 1000) && (fail == 1));
+
+    TEST_ASSERT(site_realloc(blk[0], 4000) == NULL);
+    sys_heap_prof_info(&live, &peak, &fail);
+    TEST_ASSERT((live == n * 1000) && (fail == 2));
+    TEST_ASSERT((((uint8_t *)blk[0])[0] == 0) && (((uint8_t *)blk[0])[999] == 0));
+    // its tag is still valid
+    sys_mfree(blk[0]);
+    TEST_ASSERT_EQ(live_get(), (n - 1) * 1000);
+    for (i = 1; i < n; i++)
+        sys_mfree(blk[i]);
+    TEST_ASSERT_EQ(live_get(), 0);
+    printf("  %d blocks of 1000 bytes before the heap was exhausted\n", n);
+    sys_heap_prof_reset();
+}
+
+/* the callers that find the site table full share its last entry */
+static void test_site_overflow(void)
+{
+    sys_heap_site_t s[HEAP_PROF_SITE_NUM + 1], top[TOP_SITE_NUM];
+    void *p[OVERFLOW_SITE_NUM];
+    uint32_t sum = 0, named = 0, other = 0;
+    int i, n;
+
+    printf("site table overflow\n");
+    for (i = 0; i < OVERFLOW_SITE_NUM; i++)
+        p[i] = site_funcs[i](8 * (i + 1));
+    n = sys_heap_prof_sites_get(s, HEAP_PROF_SITE_NUM + 1);
+    for (i = 0; i < n; i++) {
+        sum += s[i].live_bytes;
+        if (s[i].ra != 0)
+            named++;
+        else
+            other = s[i].live_cnt;
+        if (i > 0)
+            TEST_ASSERT(s[i - 1].live_bytes >= s[i].live_bytes);
+    }
+    // the table already holds the sites of the tests before
+    TEST_ASSERT(named <= HEAP_PROF_SITE_NUM);
+    TEST_ASSERT(other > 0);
+    TEST_ASSERT_EQ(sum, live_get());
+    TEST_ASSERT_EQ(sum, 8 * OVERFLOW_SITE_NUM * (OVERFLOW_SITE_NUM + 1) / 2);
+    printf("  %u sites with an entry, %u blocks in the overflow entry\n", named, other);
+
+    // a smaller buffer gets the sites with the most live bytes, not the first ones of the table
+    TEST_ASSERT(n > TOP_SITE_NUM);
+    TEST_ASSERT_EQ(sys_heap_prof_sites_get(top, TOP_SITE_NUM), TOP_SITE_NUM);
+    for (i = 0; i < TOP_SITE_NUM; i++)
+        TEST_ASSERT((top[i].ra == s[i].ra) && (top[i].live_bytes == s[i].live_bytes));
+    TEST_ASSERT(top[TOP_SITE_NUM - 1].live_bytes >= s[TOP_SITE_NUM].live_bytes);
+
+    for (i = 0; i < OVERFLOW_SITE_NUM; i++)
+        sys_mfree(p[i]);
+    TEST_ASSERT_EQ(live_get(), 0);
+    sys_heap_prof_reset();
+}
+
+/* fragmentation reported from the free list of the heap */
+static void test_fragmentation(void)
+{
+    static void *blk[HEAP_SIZE / 256];
+    sys_heap_frag_t frag;
+    int i, n;
+
+    printf("fragmentation\n");
+    sys_heap_frag_get(&frag);
+    TEST_ASSERT((frag.free_bytes == HEAP_SIZE) && (frag.free_blocks == 1) && (frag.frag_permille == 0));
+
+    // fill the heap with equal blocks, then free one out of two: equal holes
+    for (n = 0; (blk[n] = site_malloc(240)) != NULL; n++);
+    for (i = 0; i < n; i += 2)
+        sys_mfree(blk[i]);
+    sys_heap_frag_get(&frag);
+    printf("  %u free bytes in %u blocks, largest %u, fragmentation %u/1000\n",
+           frag.free_bytes, frag.free_blocks, frag.largest_free, frag.frag_permille);
+    TEST_ASSERT_EQ(frag.free_blocks, (n + 1) / 2);
+    TEST_ASSERT_EQ(frag.largest_free, 256);
+    TEST_ASSERT_EQ(frag.frag_permille, 1000 * (frag.free_blocks - 1) / frag.free_blocks);
+    // the free bytes are there, but not for a block larger than a hole
+    TEST_ASSERT((frag.free_bytes > 4096) && (site_malloc(512) == NULL));
+
+    for (i = 1; i < n; i += 2)
+        sys_mfree(blk[i]);
+    sys_heap_frag_get(&frag);
+    TEST_ASSERT((frag.free_blocks == 1) && (frag.frag_permille == 0));
+    TEST_ASSERT_EQ(live_get(), 0);
+    sys_heap_prof_reset();
+}
+
+/* a damaged tag is reported and does not corrupt the counters */
+static void test_damaged_tag(void)
+{
+    uint32_t live;
+    uint16_t *p;
+
+    printf("damaged tag\n");
+    p = site_malloc(64);
+    live = live_get();
+    // magic, the last half word of the tag
+    p[-1] = 0;
+    sys_mfree(p);
+    TEST_ASSERT_EQ(live_get(), live);
+}
+
+int main(void)
+{
+    heap_init();
+    test_accounting();
+    test_failures();
+    test_site_overflow();
+    test_fragmentation();
+    test_damaged_tag();
+    printf("PASS\n");
+    return 0;
+}
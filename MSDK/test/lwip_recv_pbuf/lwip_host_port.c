@@ -0,0 +1,74 @@
+/*!
+    \file    lwip_host_port.c
+    \brief   host replacements of the wifi functions the lwIP port configuration refers to
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "lwip/inet_chksum.h"
+
+u16_t lwip_standard_chksum(const void *dataptr, int len);
+
+/*!
+    \brief      checksum routine selected by LWIP_CHKSUM, the firmware one is in wifi_net_ip.c
+    \param[in]  dataptr: data to calculate checksum
+    \param[in]  len: data length
+    \param[out] none
+    \retval     checksum of data
+*/
+uint16_t wifi_ip_chksum(const void *dataptr, int len)
+{
+    return lwip_standard_chksum(dataptr, len);
+}
+
+/*!
+    \brief      hook for the ethernet types lwIP does not handle (LWIP_HOOK_UNKNOWN_ETH_PROTOCOL)
+    \param[in]  pbuf: received frame
+    \param[in]  netif: receiving interface
+    \param[out] none
+    \retval     ERR_IF, the frame is dropped by lwIP
+*/
+err_t net_eth_receive(struct pbuf *pbuf, struct netif *netif)
+{
+    return ERR_IF;
+}
+
+/* ARP of the firmware, not reached without an ethernet interface */
+void net_static_ip_check_conflict(struct netif *netif, const ip4_addr_t *addr)
+{
+}
+
+void *dhcpd_find_ethaddr_from_packet(struct pbuf *p)
+{
+    return NULL;
+}
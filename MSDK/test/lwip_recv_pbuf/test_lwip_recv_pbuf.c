@@ -0,0 +1,520 @@
+/*!
+    \file    test_lwip_recv_pbuf.c
+    \brief   test of the borrowed-buffer socket receive of lwIP
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+ * Test of lwip_recv_pbuf() with the real lwIP core, socket layer and lwipopts.h.
+ * Two interfaces share a subnet: the client on A (10.0.0.1) sends to the server on
+ * B (10.0.0.2). The output of A is queued on the "air", which runs at LINK_RATE_MBPS.
+ * The RX task of a simulated MAC copies each packet into one of its MACIF_RX_BUF_CNT
+ * RX buffers and gives it to B as a custom pbuf, as net_if_input does. When no RX
+ * buffer is free the RX task waits, as the link layer would hold the frames back:
+ * these waits are the starvation of the RX pool. The ACKs of B come back through the
+ * loopback of A. The receive mbox is shorter than the window, a segment it refuses
+ * can be lost and resent by the peer, as on the device.
+ * Checked: the data of a stream received with recv() and with lwip_recv_pbuf(), the
+ * cap of the lent RX buffers, the clones above it, the RX buffers all given back,
+ * and a consumer holding its chains throttling the peer instead of the RX pool.
+ * The CPU time of the consumer per MB is compared between the two receive paths, and
+ * the copy recv() does is timed on the borrowed chains.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "lwip/tcpip.h"
+#include "lwip/netif.h"
+#include "lwip/sockets.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "wrapper_os.h"
+#include "host_test.h"
+
+#define RX_BUF_CNT              MACIF_RX_BUF_CNT
+#define RX_BUF_SIZE             1600
+#define SERVER_PORT             5001
+#define COPY_BUF_SIZE           TCP_MSS
+#define AIR_QUEUE_SIZE          256
+#define LINK_RATE_MBPS          50
+
+/* packet on the air */
+struct air_pkt
+{
+    uint16_t len;
+    uint8_t data[];
+};
+
+/* simulated MAC RX buffer, net_buf_rx_t in the firmware */
+struct rx_buf
+{
+    struct pbuf_custom pc;
+    uint16_t len;
+    uint8_t data[RX_BUF_SIZE];
+};
+
+enum rx_mode
+{
+    MODE_COPY,
+    MODE_BORROW,
+};
+
+struct run_res
+{
+    uint64_t bytes;
+    uint64_t cpu_ns;
+    uint64_t copy_ns;
+    int rx_free_min;
+    uint32_t rx_waits;
+    uint32_t cloned;
+    uint16_t lent_peak;
+};
+
+static struct netif netif_a;
+static struct netif netif_b;
+static struct rx_buf rx_bufs[RX_BUF_CNT];
+static struct rx_buf *rx_free[RX_BUF_CNT];
+static int rx_free_cnt;
+static int rx_free_min;
+static uint32_t rx_waits;
+static pthread_mutex_t rx_lock = PTHREAD_MUTEX_INITIALIZER;
+static os_sema_t rx_sema;
+static os_queue_t air_queue;
+/* the stream repeats every 251 bytes, any offset can be sent from this buffer */
+static uint8_t tx_pattern[251 + TCP_MSS];
+static uint64_t send_total;
+static uint64_t send_off;
+static volatile int send_done;
+
+static uint8_t pattern(uint64_t off)
+{
+    return (uint8_t)(off % 251);
+}
+
+static void rx_buf_free(struct pbuf *p)
+{
+    pthread_mutex_lock(&rx_lock);
+    rx_free[rx_free_cnt++] = (struct rx_buf *)p;
+    pthread_mutex_unlock(&rx_lock);
+    sys_sema_up(&rx_sema);
+}
+
+static struct rx_buf *rx_buf_get(void)
+{
+    struct rx_buf *buf;
+
+    if (sys_sema_get_count(&rx_sema) == 0) {
+        pthread_mutex_lock(&rx_lock);
+        rx_waits++;
+        pthread_mutex_unlock(&rx_lock);
+    }
+    sys_sema_down(&rx_sema, 0);
+    pthread_mutex_lock(&rx_lock);
+    buf = rx_free[--rx_free_cnt];
+    if (rx_free_cnt < rx_free_min)
+        rx_free_min = rx_free_cnt;
+    pthread_mutex_unlock(&rx_lock);
+    return buf;
+}
+
+static int rx_buf_free_cnt(void)
+{
+    int cnt;
+
+    pthread_mutex_lock(&rx_lock);
+    cnt = rx_free_cnt;
+    pthread_mutex_unlock(&rx_lock);
+    return cnt;
+}
+
+static void rx_stats_reset(void)
+{
+    pthread_mutex_lock(&rx_lock);
+    rx_free_min = rx_free_cnt;
+    rx_waits = 0;
+    pthread_mutex_unlock(&rx_lock);
+}
+
+/* transmit of A: the packet goes on the air to B */
+static err_t netif_a_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    struct air_pkt *pkt = malloc(sizeof(*pkt) + p->tot_len);
+
+    TEST_ASSERT(pkt);
+    pkt->len = pbuf_copy_partial(p, pkt->data, p->tot_len, 0);
+    TEST_ASSERT(sys_queue_write(&air_queue, &pkt, 0, false) == 0);
+    return ERR_OK;
+}
+
+static err_t netif_b_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    /* B has no peer of its own, its traffic is routed through A */
+    return ERR_RTE;
+}
+
+/* RX task of the MAC, the part of net_if_input the test needs */
+static void rx_task(void *arg)
+{
+    struct air_pkt *pkt;
+    struct rx_buf *buf;
+    struct pbuf *p;
+    uint64_t now, next = 0;
+
+    for (;;) {
+        sys_queue_read(&air_queue, &pkt, -1, false);
+        /* airtime of the packet */
+        now = host_time_ns();
+        next = ((next > now) ? next : now) + (uint64_t)pkt->len * 8 * 1000 / LINK_RATE_MBPS;
+        while (host_time_ns() < next);
+        buf = rx_buf_get();
+        TEST_ASSERT(pkt->len <= RX_BUF_SIZE);
+        memcpy(buf->data, pkt->data, pkt->len);
+        buf->len = pkt->len;
+        free(pkt);
+        buf->pc.custom_free_function = rx_buf_free;
+        p = pbuf_alloced_custom(PBUF_RAW, buf->len, PBUF_REF, &buf->pc, buf->data, buf->len);
+        if (netif_b.input(p, &netif_b))
+            rx_buf_free(&buf->pc.pbuf);
+    }
+}
+
+static err_t netif_a_init(struct netif *netif)
+{
+    netif->output = netif_a_output;
+    netif->mtu = 1500;
+    netif->name[0] = 'a';
+    netif->name[1] = '0';
+    return ERR_OK;
+}
+
+static err_t netif_b_init(struct netif *netif)
+{
+    netif->output = netif_b_output;
+    netif->mtu = 1500;
+    netif->name[0] = 'b';
+    netif->name[1] = '0';
+    return ERR_OK;
+}
+
+static void tcpip_init_done(void *arg)
+{
+    sys_sema_up((os_sema_t *)arg);
+}
+
+static void stack_init(void)
+{
+    ip4_addr_t addr, mask;
+    os_sema_t done;
+    int i;
+
+    for (i = 0; i < RX_BUF_CNT; i++)
+        rx_free[i] = &rx_bufs[i];
+    for (i = 0; i < sizeof(tx_pattern); i++)
+        tx_pattern[i] = pattern(i);
+    rx_free_cnt = RX_BUF_CNT;
+    sys_sema_init(&rx_sema, RX_BUF_CNT);
+    TEST_ASSERT(sys_queue_init(&air_queue, AIR_QUEUE_SIZE, sizeof(struct air_pkt *)) == OS_OK);
+    TEST_ASSERT(sys_task_create_dynamic((const uint8_t *)"mac_rx", 1024, 0, rx_task, NULL));
+
+    sys_sema_init(&done, 0);
+    tcpip_init(tcpip_init_done, &done);
+    sys_sema_down(&done, 0);
+    sys_sema_free(&done);
+
+    /* B first: netif_add puts A in front of it, so A is the route to 10.0.0.0/24 */
+    LOCK_TCPIP_CORE();
+    IP4_ADDR(&mask, 255, 255, 255, 0);
+    IP4_ADDR(&addr, 10, 0, 0, 2);
+    TEST_ASSERT(netif_add(&netif_b, &addr, &mask, IP4_ADDR_ANY4, NULL, netif_b_init, tcpip_input));
+    IP4_ADDR(&addr, 10, 0, 0, 1);
+    TEST_ASSERT(netif_add(&netif_a, &addr, &mask, IP4_ADDR_ANY4, NULL, netif_a_init, tcpip_input));
+    netif_set_up(&netif_b);
+    netif_set_link_up(&netif_b);
+    netif_set_up(&netif_a);
+    netif_set_link_up(&netif_a);
+    UNLOCK_TCPIP_CORE();
+}
+
+/* queue as much of the stream as the send buffer takes, the payload is not copied */
+static void sender_push(struct tcp_pcb *pcb)
+{
+    u16_t len;
+
+    while ((send_off < send_total) && (tcp_sndqueuelen(pcb) < TCP_SND_QUEUELEN)) {
+        len = LWIP_MIN(tcp_sndbuf(pcb), TCP_MSS);
+        if (send_total - send_off < len)
+            len = (u16_t)(send_total - send_off);
+        if ((len == 0) || (tcp_write(pcb, &tx_pattern[send_off % 251], len, 0) != ERR_OK))
+            break;
+        send_off += len;
+    }
+    tcp_output(pcb);
+    if (send_off == send_total) {
+        /* once closed, the pcb is lwIP's: on a loaded host it can outlive the FIN-WAIT-2
+           timeout while the next run is going on, that abort is not an error of the run */
+        tcp_sent(pcb, NULL);
+        tcp_err(pcb, NULL);
+        TEST_ASSERT(tcp_close(pcb) == ERR_OK);
+        send_done = 1;
+    }
+}
+
+static err_t sender_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    sender_push(pcb);
+    return ERR_OK;
+}
+
+static err_t sender_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+    TEST_ASSERT(err == ERR_OK);
+    tcp_sent(pcb, sender_sent);
+    sender_push(pcb);
+    return ERR_OK;
+}
+
+static void sender_err(void *arg, err_t err)
+{
+    printf("sender: connection error %d\n", err);
+    exit(1);
+}
+
+/*
+ * The peer, on the raw API in the tcpip thread. Its data is not copied so that it does
+ * not take the lwIP heap of the device under test.
+ */
+static void sender_start(void *arg)
+{
+    struct tcp_pcb *pcb = tcp_new();
+    ip_addr_t addr;
+
+    TEST_ASSERT(pcb);
+    IP_ADDR4(&addr, 10, 0, 0, 2);
+    tcp_err(pcb, sender_err);
+    TEST_ASSERT(tcp_connect(pcb, &addr, SERVER_PORT, sender_connected) == ERR_OK);
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void check_data(const uint8_t *data, int len, uint64_t off)
+{
+    int n;
+
+    for (; len > 0; data += n, off += n, len -= n) {
+        n = (len < TCP_MSS) ? len : TCP_MSS;
+        if (memcmp(data, &tx_pattern[off % 251], n)) {
+            printf("data mismatch in %d bytes at %llu\n", n, (unsigned long long)off);
+            exit(1);
+        }
+    }
+}
+
+static int accept_one(int *ls)
+{
+    struct sockaddr_in sa;
+    int s, on = 1;
+
+    *ls = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(*ls >= 0);
+    /* the connection of the previous run is in TIME_WAIT */
+    TEST_ASSERT(lwip_setsockopt(*ls, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0);
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = PP_HTONS(SERVER_PORT);
+    TEST_ASSERT(lwip_bind(*ls, (struct sockaddr *)&sa, sizeof(sa)) == 0);
+    TEST_ASSERT(lwip_listen(*ls, 1) == 0);
+    TEST_ASSERT(tcpip_callback(sender_start, NULL) == ERR_OK);
+    s = lwip_accept(*ls, NULL, NULL);
+    TEST_ASSERT(s >= 0);
+    return s;
+}
+
+static void close_and_settle(int s, int ls)
+{
+    int i;
+
+    lwip_close(s);
+    lwip_close(ls);
+    /* wait for the sender to finish and for the last packets to be processed */
+    for (i = 0; (i < 2000) && (!send_done || (rx_buf_free_cnt() != RX_BUF_CNT)); i++)
+        sys_ms_sleep(1);
+    TEST_ASSERT(send_done);
+    TEST_ASSERT_EQ(rx_buf_free_cnt(), RX_BUF_CNT);
+}
+
+/*
+ * Receive a stream of total bytes. In MODE_BORROW the consumer keeps up to hold chains
+ * before it gives them all back, the chains of lwip_recv_pbuf() are checked in place.
+ * It also gives them back at half a receive window: the window of the peer is only
+ * opened again by lwip_recv_pbuf_free(), holding all of it would stop the stream.
+ */
+static void run(enum rx_mode mode, uint64_t total, int hold, struct run_res *res)
+{
+    static uint8_t buf[COPY_BUF_SIZE];
+    struct pbuf *held[64];
+    struct pbuf *p, *q;
+    uint32_t cloned0;
+    uint64_t cpu0, t0;
+    u16_t lent;
+    int s, ls, n = 0, held_len = 0, ret, i;
+
+    TEST_ASSERT(hold < 64);
+    memset(res, 0, sizeof(*res));
+    send_total = total;
+    send_off = 0;
+    send_done = 0;
+    lwip_recv_pbuf_stats(NULL, NULL, &cloned0);
+    s = accept_one(&ls);
+    rx_stats_reset();
+
+    cpu0 = thread_cpu_ns();
+    for (;;) {
+        if (mode == MODE_COPY) {
+            ret = lwip_recv(s, buf, sizeof(buf), 0);
+            TEST_ASSERT(ret >= 0);
+            if (ret == 0)
+                break;
+            check_data(buf, ret, res->bytes);
+        } else {
+            ret = lwip_recv_pbuf(s, &p, 0);
+            TEST_ASSERT(ret >= 0);
+            if (ret == 0)
+                break;
+            TEST_ASSERT_EQ(ret, p->tot_len);
+            i = 0;
+            for (q = p; q != NULL; q = q->next) {
+                check_data(q->payload, q->len, res->bytes + i);
+                i += q->len;
+            }
+            if (hold == 0) {
+                /* the copy recv() would do, not counted in the CPU time of the consumer */
+                t0 = host_time_ns();
+                for (i = 0; i < ret; i += sizeof(buf))
+                    pbuf_copy_partial(p, buf, sizeof(buf), i);
+                res->copy_ns += host_time_ns() - t0;
+            }
+            lwip_recv_pbuf_stats(&lent, NULL, NULL);
+            TEST_ASSERT(lent <= LWIP_SOCKET_RECV_PBUF_LENT_MAX);
+            held[n++] = p;
+            held_len += ret;
+            if ((n > hold) || (held_len >= TCP_WND / 2)) {
+                held_len = 0;
+                while (n)
+                    lwip_recv_pbuf_free(s, held[--n]);
+            }
+        }
+        res->bytes += ret;
+    }
+    while (n)
+        lwip_recv_pbuf_free(s, held[--n]);
+    res->cpu_ns = thread_cpu_ns() - cpu0 - res->copy_ns;
+
+    close_and_settle(s, ls);
+    TEST_ASSERT_EQ(res->bytes, total);
+    res->rx_free_min = rx_free_min;
+    res->rx_waits = rx_waits;
+    lwip_recv_pbuf_stats(&lent, &res->lent_peak, &res->cloned);
+    res->cloned -= cloned0;
+    TEST_ASSERT_EQ(lent, 0);
+}
+
+/*
+ * A consumer that stops giving its chains back: the peer must stall on the receive
+ * window, and at most LWIP_SOCKET_RECV_PBUF_LENT_MAX RX buffers stay lent meanwhile.
+ */
+static void test_stalled_consumer(void)
+{
+    struct pbuf *held[128];
+    uint64_t bytes = 0, end;
+    int s, ls, n = 0, ret, rx_free_stalled;
+    u16_t lent;
+    struct pbuf *p;
+
+    send_total = 1024 * 1024;
+    send_off = 0;
+    send_done = 0;
+    s = accept_one(&ls);
+
+    end = host_time_ns() + 300 * 1000000ULL;
+    while (host_time_ns() < end) {
+        ret = lwip_recv_pbuf(s, &p, MSG_DONTWAIT);
+        if (ret < 0) {
+            TEST_ASSERT(errno == EWOULDBLOCK);
+            sys_ms_sleep(1);
+            continue;
+        }
+        TEST_ASSERT(ret > 0);
+        TEST_ASSERT(n < 128);
+        held[n++] = p;
+        bytes += ret;
+    }
+    /* nothing is pending in the stack: the RX buffers still used are the lent ones */
+    rx_free_stalled = rx_buf_free_cnt();
+    lwip_recv_pbuf_stats(&lent, NULL, NULL);
+    printf("stalled consumer: %llu bytes held in %d chains, %u RX buffers lent, %d/%d free\n",
+           (unsigned long long)bytes, n, lent, rx_free_stalled, RX_BUF_CNT);
+    TEST_ASSERT(bytes <= TCP_WND);
+    TEST_ASSERT(!send_done);
+    TEST_ASSERT(lent <= LWIP_SOCKET_RECV_PBUF_LENT_MAX);
+    TEST_ASSERT_EQ(rx_free_stalled, RX_BUF_CNT - lent);
+
+    /* giving the chains back opens the window again */
+    while (n)
+        lwip_recv_pbuf_free(s, held[--n]);
+    for (;;) {
+        ret = lwip_recv_pbuf(s, &p, 0);
+        TEST_ASSERT(ret >= 0);
+        if (ret == 0)
+            break;
+        bytes += ret;
+        lwip_recv_pbuf_free(s, p);
+    }
+    close_and_settle(s, ls);
+    TEST_ASSERT_EQ(bytes, send_total);
+}
+
+static void print_res(const char *name, const struct run_res *res)
+{
+    printf("%-22s %8.0f ns/MB consumer CPU, RX buffers min free %2d/%d, RX waits %u, clones %u, lent peak %u\n",
+           name, (double)res->cpu_ns * 1048576.0 / (double)res->bytes, res->rx_free_min, RX_BUF_CNT,
+           res->rx_waits, res->cloned, res->lent_peak);
+}
+
+int main(void)
+{
+    struct run_res copy, borrow, hold;
+    const uint64_t total = 8 * 1024 * 1024;
+
+    stack_init();
+
+    run(MODE_COPY, total, 0, &copy);
+    print_res("recv() copy", &copy);
+
+    run(MODE_BORROW, total, 0, &borrow);
+    print_res("lwip_recv_pbuf()", &borrow);
+    printf("%-22s %8.0f ns/MB\n", "copy of recv()", (double)borrow.copy_ns * 1048576.0 / (double)borrow.bytes);
+    /* one chain lent at a time, only a chain merged from the out-of-sequence queue can be
+     * longer than the cap and cloned */
+    TEST_ASSERT(borrow.lent_peak <= LWIP_SOCKET_RECV_PBUF_LENT_MAX);
+
+    /* holding more chains than the cap: the ones above it are cloned */
+    run(MODE_BORROW, 4 * 1024 * 1024, 2 * LWIP_SOCKET_RECV_PBUF_LENT_MAX, &hold);
+    print_res("lwip_recv_pbuf() held", &hold);
+    TEST_ASSERT(hold.cloned > 0);
+    TEST_ASSERT(hold.lent_peak <= LWIP_SOCKET_RECV_PBUF_LENT_MAX);
+
+    test_stalled_consumer();
+
+    printf("test_lwip_recv_pbuf passed\n");
+    return 0;
+}
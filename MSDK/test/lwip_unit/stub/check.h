@@ -0,0 +1,90 @@
+/*!
+    \file    check.h
+    \brief   Minimal check framework for the lwIP unit tests on the host
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+#include <stdio.h>
+#include <string.h>
+
+/* the API subset of check 0.12 used by lwip_check.h and the ported suites, the tests run
+   in the process of test_lwip_unit.c */
+#define CHECK_MAJOR_VERSION             0
+#define CHECK_MINOR_VERSION             12
+
+typedef void (*SFun)(void);
+typedef void (*TFun)(int _i);
+
+typedef struct {
+    TFun func;
+    const char *name;
+    SFun setup;
+    SFun teardown;
+} TCase;
+
+#define SUITE_MAX_TCASES                64
+
+typedef struct {
+    const char *name;
+    TCase *tcase[SUITE_MAX_TCASES];
+    int num;
+} Suite;
+
+extern int check_fail_cnt;
+extern int check_cnt;
+
+#define START_TEST(name)                static void name(int _i) { (void)_i;
+#define END_TEST                        }
+
+#define fail_unless(expr, ...)                                                          \
+    do {                                                                                \
+        check_cnt++;                                                                    \
+        if (!(expr)) {                                                                  \
+            check_fail_cnt++;                                                           \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);             \
+        }                                                                               \
+    } while (0)
+#define fail_if(expr, ...)              fail_unless(!(expr))
+#define fail(...)                       fail_unless(0)
+#define ck_assert(expr)                 fail_unless(expr)
+#define ck_assert_int_eq(a, b)          fail_unless((a) == (b))
+
+Suite *suite_create(const char *name);
+TCase *tcase_create(const char *name);
+void tcase_add_checked_fixture(TCase *tc, SFun setup, SFun teardown);
+void _tcase_add_test(TCase *tc, TFun func, const char *name, int signal, int allowed_exit_value,
+                     int start, int end);
+void suite_add_tcase(Suite *s, TCase *tc);
+
+#endif /* _CHECK_H_ */
@@ -0,0 +1,190 @@
+/*!
+    \file    test_lwip_unit.c
+    \brief   Runner of the lwIP unit tests on the host
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Runs the ip4 and udp suites of lwip-2.2.0/test/unit against the lwIP core with the
+ * options of test/unit/lwipopts.h and the tcpip thread of test/unit/arch.
+ * check is not available here: stub/check.h provides the part of its API the suites use
+ * and the test cases run one after the other in this process.
+ * The port functions the GD modifications of the core call are stubbed below.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "lwip_check.h"
+#include "ip4/test_ip4.h"
+#include "udp/test_udp.h"
+#include "lwip/tcpip.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+
+int check_fail_cnt;
+int check_cnt;
+
+Suite *suite_create(const char *name)
+{
+    Suite *s = calloc(1, sizeof(Suite));
+
+    if (s == NULL) {
+        abort();
+    }
+    s->name = name;
+    return s;
+}
+
+TCase *tcase_create(const char *name)
+{
+    TCase *tc = calloc(1, sizeof(TCase));
+
+    if (tc == NULL) {
+        abort();
+    }
+    tc->name = name;
+    return tc;
+}
+
+void tcase_add_checked_fixture(TCase *tc, SFun setup, SFun teardown)
+{
+    tc->setup = setup;
+    tc->teardown = teardown;
+}
+
+void _tcase_add_test(TCase *tc, TFun func, const char *name, int signal, int allowed_exit_value,
+                     int start, int end)
+{
+    tc->func = func;
+    tc->name = name;
+}
+
+void suite_add_tcase(Suite *s, TCase *tc)
+{
+    if (s->num >= SUITE_MAX_TCASES) {
+        abort();
+    }
+    s->tcase[s->num++] = tc;
+}
+
+/* same as in lwip_unittests.c, whose main needs the real check */
+Suite *create_suite(const char *name, testfunc *tests, size_t num_tests, SFun setup, SFun teardown)
+{
+    size_t i;
+    Suite *s = suite_create(name);
+
+    for (i = 0; i < num_tests; i++) {
+        TCase *tc_core = tcase_create(name);
+        if ((setup != NULL) || (teardown != NULL)) {
+            tcase_add_checked_fixture(tc_core, setup, teardown);
+        }
+        tcase_add_named_test(tc_core, tests[i]);
+        suite_add_tcase(s, tc_core);
+    }
+    return s;
+}
+
+void lwip_check_ensure_no_alloc(unsigned int skip)
+{
+    int i;
+    unsigned int mask;
+
+    if (!(skip & SKIP_HEAP)) {
+        fail_unless(lwip_stats.mem.used == 0);
+    }
+    for (i = 0, mask = 1; i < MEMP_MAX; i++, mask <<= 1) {
+        if (!(skip & mask)) {
+            fail_unless(lwip_stats.memp[i]->used == 0);
+        }
+    }
+}
+
+/* port functions, not built for the unit tests */
+unsigned int lwip_port_rand(void)
+{
+    return (unsigned int)rand();
+}
+
+void ppp_init(void)
+{
+}
+
+void dhcp_network_changed_link_up(struct netif *netif)
+{
+}
+
+void dhcp_coarse_tmr(void)
+{
+}
+
+void dhcp_fine_tmr(void)
+{
+}
+
+void dhcp_cleanup(struct netif *netif)
+{
+}
+
+int net_static_ip_check_conflict(void *netif, void *addr)
+{
+    return 0;
+}
+
+int dhcpd_find_ethaddr_from_packet(void *p, void *ethaddr)
+{
+    return 0;
+}
+
+int main(void)
+{
+    suite_getter_fn *suites[] = {ip4_suite, udp_suite};
+    Suite *s;
+    int i, k, fail_cnt;
+
+    tcpip_init(NULL, NULL);
+    for (k = 0; k < (int)(sizeof(suites) / sizeof(suites[0])); k++) {
+        s = suites[k]();
+        for (i = 0; i < s->num; i++) {
+            fail_cnt = check_fail_cnt;
+            if (s->tcase[i]->setup) {
+                s->tcase[i]->setup();
+            }
+            s->tcase[i]->func(0);
+            if (s->tcase[i]->teardown) {
+                s->tcase[i]->teardown();
+            }
+            printf("%-8s %-40s %s\n", s->name, s->tcase[i]->name,
+                   (check_fail_cnt == fail_cnt) ? "ok" : "FAILED");
+        }
+    }
+    printf("%d checks, %d failed\n", check_cnt, check_fail_cnt);
+    return (check_fail_cnt != 0);
+}
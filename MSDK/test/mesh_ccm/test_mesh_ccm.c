@@ -0,0 +1,275 @@
+/*!
+    \file    test_mesh_ccm.c
+    \brief   Known answer tests and benchmark of the mesh AES-CCM engine
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Known answer tests of bt_ccm_encrypt/bt_ccm_decrypt of aes_ccm.c: the network PDU of
+ * Mesh Profile sample data 8.3.1 and packet vector #1 of RFC 3610, which has additional
+ * data. Random messages are then checked against the CCM of TinyCrypt: every payload,
+ * additional data and MIC size the mesh uses, in place and out of place, with several
+ * keys and with tampered MICs.
+ * The benchmark times a network PDU and a segmented access message against TinyCrypt,
+ * both expanding the key once per operation. The costs of one AES block and of one key
+ * expansion are printed alongside: the engine before the rework expanded the key for
+ * every block through bt_encrypt_be.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "host_test.h"
+#include "bluetooth/bt_crypto.h"
+#include <tinycrypt/aes.h>
+#include <tinycrypt/ccm_mode.h>
+#include <tinycrypt/constants.h>
+
+#define RANDOM_ROUNDS           20000
+#define RANDOM_KEYS             16
+#define PAYLOAD_MAX             384         /* segmented access message with TransMIC */
+#define BENCH_ROUNDS            20000
+
+struct ccm_kat {
+    const char *name;
+    const char *key;
+    const char *nonce;
+    const char *aad;
+    const char *plaintext;
+    const char *enc_data;       /* encrypted data followed by the MIC */
+    size_t mic_size;
+};
+
+static const struct ccm_kat kats[] = {
+    {
+        "mesh 8.3.1 network PDU",
+        "0953fa93e7caac9638f58820220a398e",
+        "00800000011201000012345678",
+        "",
+        "fffd034b50057e400000010000",
+        "b5e5bfdacbaf6cb7fb6bff871f035444ce83a670df",
+        8,
+    },
+    {
+        "RFC 3610 packet vector #1",
+        "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf",
+        "00000003020100a0a1a2a3a4a5",
+        "0001020304050607",
+        "08090a0b0c0d0e0f101112131415161718191a1b1c1d1e",
+        "588c979a61c663d2f066d0c2c0f989806d5f6b61dac38417e8d12cfdf926e0",
+        8,
+    },
+};
+
+const char *bt_hex(const void *buf, size_t len)
+{
+    return "";
+}
+
+static size_t hex2bin(const char *hex, uint8_t *bin)
+{
+    size_t len = 0;
+
+    while (hex[0] && hex[1]) {
+        sscanf(hex, "%2hhx", &bin[len++]);
+        hex += 2;
+    }
+    return len;
+}
+
+static void test_kat(const struct ccm_kat *kat)
+{
+    uint8_t key[16], nonce[13], aad[32], pt[64], exp[80], out[80];
+    size_t aad_len, len, exp_len;
+
+    hex2bin(kat->key, key);
+    hex2bin(kat->nonce, nonce);
+    aad_len = hex2bin(kat->aad, aad);
+    len = hex2bin(kat->plaintext, pt);
+    exp_len = hex2bin(kat->enc_data, exp);
+    TEST_ASSERT_EQ(exp_len, len + kat->mic_size);
+
+    TEST_ASSERT_EQ(bt_ccm_encrypt(key, nonce, pt, len, aad, aad_len, out, kat->mic_size), 0);
+    TEST_ASSERT(!memcmp(out, exp, exp_len));
+
+    TEST_ASSERT_EQ(bt_ccm_decrypt(key, nonce, exp, len, aad, aad_len, out, kat->mic_size), 0);
+    TEST_ASSERT(!memcmp(out, pt, len));
+
+    exp[len] ^= 0x80;
+    TEST_ASSERT_EQ(bt_ccm_decrypt(key, nonce, exp, len, aad, aad_len, out, kat->mic_size), -EBADMSG);
+
+    printf("%-28s ok\n", kat->name);
+}
+
+/* reference encryption with the CCM of TinyCrypt, enc_data gets the MIC appended */
+static void ref_encrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *pt, size_t len,
+                        const uint8_t *aad, size_t aad_len, uint8_t *enc_data, size_t mic_size)
+{
+    struct tc_aes_key_sched_struct sched;
+    struct tc_ccm_mode_struct ccm;
+
+    TEST_ASSERT(tc_aes128_set_encrypt_key(&sched, key) == TC_CRYPTO_SUCCESS);
+    TEST_ASSERT(tc_ccm_config(&ccm, &sched, nonce, 13, mic_size) == TC_CRYPTO_SUCCESS);
+    TEST_ASSERT(tc_ccm_generation_encryption(enc_data, len + mic_size, aad, aad_len,
+                                             pt, len, &ccm) == TC_CRYPTO_SUCCESS);
+}
+
+static void test_random(void)
+{
+    static const size_t mic_sizes[] = {4, 8, 16};
+    static uint8_t keys[RANDOM_KEYS][16];
+    uint8_t nonce[13], aad[16], pt[PAYLOAD_MAX], ref[PAYLOAD_MAX + 16];
+    uint8_t enc[PAYLOAD_MAX + 16], dec[PAYLOAD_MAX + 16];
+    int round;
+    size_t i;
+
+    srand(3610);
+    for (i = 0; i < sizeof(keys); i++)
+        ((uint8_t *)keys)[i] = rand();
+
+    for (round = 0; round < RANDOM_ROUNDS; round++) {
+        const uint8_t *key = keys[rand() % RANDOM_KEYS];
+        size_t len = rand() % (PAYLOAD_MAX + 1);
+        size_t aad_len = (rand() % 4) ? 0 : 16;    /* label UUID of a virtual address */
+        size_t mic_size = mic_sizes[rand() % 3];
+
+        for (i = 0; i < sizeof(nonce); i++)
+            nonce[i] = rand();
+        for (i = 0; i < aad_len; i++)
+            aad[i] = rand();
+        for (i = 0; i < len; i++)
+            pt[i] = rand();
+        if (len == 0)
+            len = 1;
+
+        ref_encrypt(key, nonce, pt, len, aad, aad_len, ref, mic_size);
+
+        /* in place, as the network and transport layers do */
+        memcpy(enc, pt, len);
+        TEST_ASSERT_EQ(bt_ccm_encrypt(key, nonce, enc, len, aad, aad_len, enc, mic_size), 0);
+        TEST_ASSERT(!memcmp(enc, ref, len + mic_size));
+
+        memcpy(dec, ref, len + mic_size);
+        TEST_ASSERT_EQ(bt_ccm_decrypt(key, nonce, dec, len, aad, aad_len, dec, mic_size), 0);
+        TEST_ASSERT(!memcmp(dec, pt, len));
+
+        /* out of place, with a flipped bit in the payload or in the MIC */
+        enc[rand() % (len + mic_size)] ^= 1 << (rand() % 8);
+        TEST_ASSERT_EQ(bt_ccm_decrypt(key, nonce, enc, len, aad, aad_len, dec, mic_size), -EBADMSG);
+    }
+    printf("%d random messages match TinyCrypt\n", RANDOM_ROUNDS);
+}
+
+typedef void (*bench_fn)(const uint8_t key[16], uint8_t nonce[13], uint8_t *buf, size_t len, size_t mic_size);
+
+static void bench_encrypt(const uint8_t key[16], uint8_t nonce[13], uint8_t *buf, size_t len, size_t mic_size)
+{
+    bt_ccm_encrypt(key, nonce, buf, len, NULL, 0, buf, mic_size);
+}
+
+static void bench_decrypt(const uint8_t key[16], uint8_t nonce[13], uint8_t *buf, size_t len, size_t mic_size)
+{
+    bt_ccm_decrypt(key, nonce, buf, len, NULL, 0, buf, mic_size);
+}
+
+static void bench_tinycrypt(const uint8_t key[16], uint8_t nonce[13], uint8_t *buf, size_t len, size_t mic_size)
+{
+    struct tc_aes_key_sched_struct sched;
+    struct tc_ccm_mode_struct ccm;
+    uint8_t out[PAYLOAD_MAX + 16];
+
+    tc_aes128_set_encrypt_key(&sched, key);
+    tc_ccm_config(&ccm, &sched, nonce, 13, mic_size);
+    tc_ccm_generation_encryption(out, len + mic_size, NULL, 0, buf, len, &ccm);
+}
+
+static double bench_run(bench_fn fn, size_t len, size_t mic_size)
+{
+    static const uint8_t key[16] = {0x09, 0x53, 0xfa, 0x93};
+    uint8_t nonce[13] = {0x00, 0x80}, buf[PAYLOAD_MAX + 16] = {0};
+    uint64_t start;
+    int i;
+
+    fn(key, nonce, buf, len, mic_size);
+    start = host_time_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        nonce[12] = i;
+        fn(key, nonce, buf, len, mic_size);
+    }
+    return (double)(host_time_ns() - start) / BENCH_ROUNDS;
+}
+
+static void bench_aes(void)
+{
+    static const uint8_t key[16] = {0x09, 0x53, 0xfa, 0x93};
+    struct tc_aes_key_sched_struct sched;
+    uint8_t block[16] = {0};
+    uint64_t start, expand;
+    int i;
+
+    start = host_time_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        block[0] = i;
+        tc_aes128_set_encrypt_key(&sched, block);
+    }
+    expand = host_time_ns() - start;
+
+    tc_aes128_set_encrypt_key(&sched, key);
+    start = host_time_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        tc_aes_encrypt(block, block, &sched);
+
+    printf("%-28s %6.0f ns, key expansion %6.0f ns\n", "AES block",
+           (double)(host_time_ns() - start) / BENCH_ROUNDS, (double)expand / BENCH_ROUNDS);
+}
+
+static void bench(const char *name, size_t len, size_t mic_size)
+{
+    printf("%-28s encrypt %6.0f ns, decrypt %6.0f ns, TinyCrypt %6.0f ns\n",
+           name, bench_run(bench_encrypt, len, mic_size), bench_run(bench_decrypt, len, mic_size),
+           bench_run(bench_tinycrypt, len, mic_size));
+}
+
+int main(void)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(kats) / sizeof(kats[0]); i++)
+        test_kat(&kats[i]);
+    test_random();
+
+    bench_aes();
+    bench("network PDU (18 bytes)", 18, 4);
+    bench("access message (376 bytes)", 376, 8);
+
+    printf("test_mesh_ccm passed\n");
+    return 0;
+}
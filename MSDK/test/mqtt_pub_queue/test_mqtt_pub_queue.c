@@ -0,0 +1,411 @@
+/*!
+    \file    test_mqtt_pub_queue.c
+    \brief   Test of the MQTT publish queue with a broker stand-in
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Test of the MQTT publish queue against a broker stand-in.
+ * The stand-in models what the queue sees of the lwIP MQTT client: the request slots
+ * (MQTT_REQ_MAX_IN_FLIGHT, a QoS 0 publish holds one until its TCP write is acknowledged),
+ * the output ring, the held output and the ERR_CONN/ERR_MEM results. It records the
+ * publishes the broker receives and the TCP writes. The spill file lives in an in-memory
+ * FatFS. The MQTT task is run by shifting the OS wrapper clock by the delays the drain
+ * asks for, so the drain rate is checked without waiting for it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "fatfs.h"
+#include "mqtt_pub_queue.c"
+
+#define BROKER_RECV_MAX         1000
+#define TELEMETRY_TOPIC         "fleet/telemetry"
+
+int core_locked;
+
+/* in-memory FatFS, one file */
+static uint8_t disk[256 * 1024];
+static uint32_t disk_size;
+static bool file_exists, mounted = true;
+static FATFS the_fs;
+static int unlink_cnt;
+
+/* broker stand-in */
+static int slots_max = MQTT_REQ_MAX_IN_FLIGHT;
+static int slots_used, ring_used;
+static bool link_up = true, hold, refuse;
+static int writes, recv_cnt, recv_seq[BROKER_RECV_MAX];
+
+FATFS *fatfs_get_fs(void)
+{
+    return mounted ? &the_fs : NULL;
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+    /* file accesses stay out of the core lock */
+    TEST_ASSERT_EQ(core_locked, 0);
+    if (!file_exists) {
+        if (!(mode & FA_OPEN_ALWAYS))
+            return FR_NO_FILE;
+        file_exists = true;
+        disk_size = 0;
+    }
+    fp->obj.objsize = disk_size;
+    fp->fptr = 0;
+    return FR_OK;
+}
+
+FRESULT f_close(FIL *fp)
+{
+    return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+    if (fp->fptr + btr > disk_size)
+        btr = disk_size - fp->fptr;
+    memcpy(buff, disk + fp->fptr, btr);
+    fp->fptr += btr;
+    *br = btr;
+    return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    TEST_ASSERT(fp->fptr + btw <= sizeof(disk));
+    memcpy(disk + fp->fptr, buff, btw);
+    fp->fptr += btw;
+    if (fp->fptr > disk_size)
+        disk_size = fp->fptr;
+    fp->obj.objsize = disk_size;
+    *bw = btw;
+    return FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR *path)
+{
+    file_exists = false;
+    disk_size = 0;
+    unlink_cnt++;
+    return FR_OK;
+}
+
+static void broker_write(void)
+{
+    if (ring_used)
+        writes++;
+    ring_used = 0;
+}
+
+/* the TCP writes are acknowledged, the QoS 0 publishes free their request slot */
+static void broker_ack(void)
+{
+    slots_used = 0;
+}
+
+void mqtt_output_hold(mqtt_client_t *client, u8_t hold_on)
+{
+    TEST_ASSERT(core_locked > 0);
+    hold = hold_on;
+    if (!hold)
+        broker_write();
+}
+
+static err_t broker_publish(mqtt_client_t *client, const mqtt_pubq_msg_t *msg, bool last_try)
+{
+    int len = 2 + strlen(msg->topic) + msg->payload_len + 4;
+
+    TEST_ASSERT(core_locked > 0);
+    if (!link_up)
+        return ERR_CONN;
+    if (refuse || (slots_used >= slots_max) || (ring_used + len > MQTT_OUTPUT_RINGBUF_SIZE))
+        return ERR_MEM;
+    slots_used++;
+    ring_used += len;
+    TEST_ASSERT(recv_cnt < BROKER_RECV_MAX);
+    recv_seq[recv_cnt++] = atoi((const char *)msg->payload);
+    if (!hold)
+        broker_write();
+    return ERR_OK;
+}
+
+static int push(int seq, int size, bool draining)
+{
+    char buf[1200];
+
+    memset(buf, 'x', size);
+    snprintf(buf, sizeof(buf), "%d", seq);
+    if (size > (int)strlen(buf))
+        buf[strlen(buf)] = 'x';
+    return mqtt_pubq_push(TELEMETRY_TOPIC, (uint8_t *)buf, size, 0, 0, draining);
+}
+
+/* run the MQTT task until the queue is empty, returns the time it waited in ms */
+static uint32_t run_task(void)
+{
+    uint32_t waited = 0;
+    int delay, i;
+
+    for (i = 0; i < 100000; i++) {
+        delay = mqtt_pubq_drain((mqtt_client_t *)&the_fs, broker_publish);
+        if (delay < 0)
+            break;
+        if (delay == 0)
+            delay = 1;
+        host_time_shift_ms(delay);
+        waited += delay;
+        broker_ack();
+    }
+    TEST_ASSERT_EQ(core_locked, 0);
+    return waited;
+}
+
+static void check_order(int n)
+{
+    int i;
+
+    TEST_ASSERT_EQ(recv_cnt, n);
+    for (i = 0; i < n; i++)
+        TEST_ASSERT_EQ(recv_seq[i], i);
+}
+
+static void broker_reset(void)
+{
+    recv_cnt = 0;
+    writes = 0;
+    broker_ack();
+}
+
+/*
+ * Small QoS 0 publishes leave in a few writes. The number of request slots bounds
+ * a write: the drain waits for the acknowledgement of the held publishes to go on.
+ */
+static void test_batch(void)
+{
+    mqtt_pubq_stats_t stats;
+    uint32_t waited[2];
+    int slots[2] = {4, MQTT_REQ_MAX_IN_FLIGHT}, batches[2], i, s;
+
+    for (s = 0; s < 2; s++) {
+        slots_max = slots[s];
+        broker_reset();
+        for (i = 0; i < 40; i++)
+            TEST_ASSERT_EQ(push(i, 20, true), MQTT_PUBQ_OK);
+        waited[s] = run_task();
+        check_order(40);
+        mqtt_pubq_stats_get(&stats, true);
+        TEST_ASSERT_EQ(stats.sent_cnt, 40);
+        batches[s] = writes;
+        printf("batch: %d request slots, 40 publishes of 20 bytes in %d writes, drain waited %u ms\n",
+               slots_max, writes, waited[s]);
+    }
+    TEST_ASSERT(batches[1] < batches[0]);
+    TEST_ASSERT(waited[1] < waited[0]);
+    slots_max = MQTT_REQ_MAX_IN_FLIGHT;
+}
+
+/* publishes made while the link is down spill to the file and leave in order */
+static void test_offline(void)
+{
+    mqtt_pubq_stats_t stats;
+    int i, n = 500;
+
+    broker_reset();
+    link_up = false;
+    for (i = 0; i < n; i++)
+        TEST_ASSERT_EQ(push(i, 100, false), MQTT_PUBQ_OK);
+    mqtt_pubq_stats_get(&stats, false);
+    TEST_ASSERT_EQ(stats.depth, n);
+    TEST_ASSERT(stats.spill_cnt > 0);
+    TEST_ASSERT(stats.file_bytes > 0);
+    /* a lost link keeps all of them */
+    TEST_ASSERT_EQ(mqtt_pubq_drain((mqtt_client_t *)&the_fs, broker_publish), -1);
+    TEST_ASSERT_EQ(recv_cnt, 0);
+
+    link_up = true;
+    run_task();
+    check_order(n);
+    mqtt_pubq_stats_get(&stats, true);
+    TEST_ASSERT_EQ(stats.depth, 0);
+    TEST_ASSERT_EQ(stats.file_bytes, 0);
+    TEST_ASSERT(!file_exists);
+    printf("offline: %d publishes, %u spilled, sent in %d writes after the reconnection: OK\n",
+           n, stats.spill_cnt, writes);
+}
+
+/* the spilled publishes survive a reset, a record cut by the reset is dropped */
+static void test_reset(void)
+{
+    uint32_t saved;
+    int i;
+
+    broker_reset();
+    link_up = false;
+    for (i = 0; i < 200; i++)
+        TEST_ASSERT_EQ(push(i, 100, false), MQTT_PUBQ_OK);
+    saved = disk_size;
+    TEST_ASSERT(saved > 0);
+    /* the reset loses the RAM ring and cuts a record being written */
+    mqtt_pubq_flush();
+    file_exists = true;
+    memset(disk + saved, 0x55, 7);
+    disk_size = saved + 7;
+    sys_mutex_free(&pubq.lock);
+    sys_sema_free(&pubq.room);
+    memset(&pubq, 0, sizeof(pubq));
+
+    link_up = true;
+    TEST_ASSERT_EQ(push(100000, 30, true), MQTT_PUBQ_OK);
+    run_task();
+    TEST_ASSERT(recv_cnt >= 2);
+    TEST_ASSERT_EQ(recv_seq[recv_cnt - 1], 100000);
+    for (i = 1; i < recv_cnt - 1; i++)
+        TEST_ASSERT_EQ(recv_seq[i], recv_seq[i - 1] + 1);
+    printf("reset: %d publishes recovered from the file: OK\n", recv_cnt - 1);
+}
+
+static void test_rate(void)
+{
+    mqtt_pubq_stats_t stats;
+    uint32_t t0, elapsed;
+    int i;
+
+    broker_reset();
+    link_up = false;
+    for (i = 0; i < 100; i++)
+        TEST_ASSERT_EQ(push(i, 10, false), MQTT_PUBQ_OK);
+    mqtt_pubq_rate_set(50);
+    link_up = true;
+    t0 = sys_current_time_get();
+    run_task();
+    elapsed = sys_current_time_get() - t0;
+    check_order(100);
+    TEST_ASSERT(elapsed >= 1960 && elapsed <= 2100);
+    mqtt_pubq_rate_set(0);
+    mqtt_pubq_stats_get(&stats, true);
+    printf("rate: 100 publishes at 50/s in %u ms: OK\n", elapsed);
+}
+
+static void *drain_later(void *arg)
+{
+    sys_ms_sleep(100);
+    run_task();
+    return NULL;
+}
+
+/*
+ * Without file system the queue is bounded by the ring. Above the high water mark,
+ * a publish of a connected client waits for the drain: it is woken up as soon as the
+ * drain makes room, or rejected after MQTT_PUBQ_BP_TIMEOUT.
+ */
+static void test_backpressure(void)
+{
+    mqtt_pubq_stats_t stats;
+    pthread_t th;
+    uint32_t t0, elapsed;
+    int i, res;
+
+    mounted = false;
+    broker_reset();
+    link_up = false;
+    for (i = 0; i < 100; i++)
+        push(i, 100, false);
+    mqtt_pubq_stats_get(&stats, true);
+    TEST_ASSERT(stats.drop_full_cnt > 0);
+    TEST_ASSERT_EQ(stats.enqueue_cnt + stats.drop_full_cnt, 100);
+    printf("no file system: %u queued, %u rejected\n", stats.enqueue_cnt, stats.drop_full_cnt);
+
+    /* nobody drains: the publish waits for the timeout */
+    link_up = true;
+    t0 = sys_current_time_get();
+    res = push(1000, 100, true);
+    elapsed = sys_current_time_get() - t0;
+    mqtt_pubq_stats_get(&stats, true);
+    TEST_ASSERT_EQ(res, MQTT_PUBQ_ERR_FULL);
+    TEST_ASSERT_EQ(stats.wait_cnt, 1);
+    TEST_ASSERT(elapsed >= MQTT_PUBQ_BP_TIMEOUT && elapsed < MQTT_PUBQ_BP_TIMEOUT + 200);
+
+    /* the MQTT task drains after 100 ms: the publish goes in at once */
+    TEST_ASSERT_EQ(pthread_create(&th, NULL, drain_later, NULL), 0);
+    t0 = sys_current_time_get();
+    res = push(1001, 100, true);
+    elapsed = sys_current_time_get() - t0;
+    pthread_join(th, NULL);
+    mqtt_pubq_stats_get(&stats, true);
+    TEST_ASSERT_EQ(res, MQTT_PUBQ_OK);
+    TEST_ASSERT_EQ(stats.wait_cnt, 1);
+    TEST_ASSERT(elapsed >= 90 && elapsed < 1000);
+    printf("back-pressure: rejected after %u ms without drain, accepted after %u ms with the drain: OK\n",
+           MQTT_PUBQ_BP_TIMEOUT, elapsed);
+    mqtt_pubq_flush();
+    mounted = true;
+}
+
+/* a publish the client keeps refusing is retried, then dropped */
+static void test_refused(void)
+{
+    mqtt_pubq_stats_t stats;
+
+    refuse = true;
+    TEST_ASSERT_EQ(push(0, 10, true), MQTT_PUBQ_OK);
+    run_task();
+    refuse = false;
+    mqtt_pubq_stats_get(&stats, true);
+    TEST_ASSERT_EQ(stats.drop_err_cnt, 1);
+    TEST_ASSERT_EQ(stats.retry_cnt, MQTT_PUBQ_RETRY_MAX - 1);
+
+    /* larger than the MQTT output buffer */
+    TEST_ASSERT_EQ(push(0, 1020, true), MQTT_PUBQ_ERR_LEN);
+    printf("refused: %u retries then dropped: OK\n", stats.retry_cnt);
+}
+
+int main(void)
+{
+    test_batch();
+    test_offline();
+    test_reset();
+    test_rate();
+    test_backpressure();
+    test_refused();
+    TEST_ASSERT_EQ(core_locked, 0);
+    return 0;
+}
@@ -0,0 +1,545 @@
+/*!
+    \file    test_net_mcast_filter.c
+    \brief   Unit test and noisy capture benchmark of the multicast MAC filter
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Unit test and benchmark of the multicast MAC filter of the WiFi RX path.
+ * An Ethernet interface is added to lwIP with the filter callbacks, as net_if_init does.
+ * The test checks the table against IGMP/MLD joins and leaves. The benchmark replays a
+ * synthetic capture of a noisy LAN (mDNS, SSDP, WS-Discovery, LLMNR, IGMP queries,
+ * neighbour solicitations, random groups) with and without the filter in front of
+ * ethernet_input, and checks that the application receives the same datagrams.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/igmp.h"
+#include "lwip/mld6.h"
+#include "lwip/udp.h"
+#include "lwip/etharp.h"
+#include "lwip/ethip6.h"
+#include "lwip/inet_chksum.h"
+#include "netif/ethernet.h"
+#include "host_test.h"
+#include "net_mcast_filter.h"
+
+#define CAP_FRAME_NUM           5000
+#define CAP_FRAME_MAX           1400
+#define BENCH_ROUNDS            200
+
+struct cap_frame
+{
+    uint16_t len;
+    uint8_t data[CAP_FRAME_MAX];
+};
+
+static struct netif nif, nif2;
+static struct cap_frame *cap;
+static uint32_t to_lwip, to_app;
+static uint64_t to_app_bytes;
+
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* lwIP clock and the GD hooks of etharp.c */
+u32_t sys_now(void)
+{
+    return (u32_t)(time_ns() / 1000000);
+}
+
+void net_static_ip_check_conflict(struct netif *netif, const ip4_addr_t *addr)
+{
+}
+
+void *dhcpd_find_ethaddr_from_packet(struct pbuf *p)
+{
+    return NULL;
+}
+
+static void pbuf_nofree(struct pbuf *p)
+{
+}
+
+static err_t nif_linkoutput(struct netif *netif, struct pbuf *p)
+{
+    return ERR_OK;
+}
+
+static err_t nif_init(struct netif *netif)
+{
+    netif->output = etharp_output;
+    netif->output_ip6 = ethip6_output;
+    netif->linkoutput = nif_linkoutput;
+    netif->mtu = 1500;
+    netif->hwaddr_len = ETH_HWADDR_LEN;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP
+                   | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6 | NETIF_FLAG_ETHERNET;
+    net_mcast_filter_init(netif);
+    return ERR_OK;
+}
+
+static void udp_rx(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    to_app++;
+    to_app_bytes += p->tot_len;
+    pbuf_free(p);
+}
+
+/* RX path of wifi_netif.c: the filter runs before the pbuf allocation */
+static void frame_input(const uint8_t *frame, uint16_t len, bool filter)
+{
+    struct pbuf_custom pc;
+    struct pbuf *p;
+
+    if (filter && (frame[0] & 0x01) && !net_mcast_filter_accept(&nif, frame))
+        return;
+    to_lwip++;
+    pc.custom_free_function = pbuf_nofree;
+    p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &pc, (void *)frame, len);
+    if (nif.input(p, &nif) != ERR_OK)
+        pbuf_free(p);
+}
+
+static void mac_of_ip4(uint8_t *mac, const uint8_t *group)
+{
+    mac[0] = 0x01;
+    mac[1] = 0x00;
+    mac[2] = 0x5e;
+    mac[3] = group[1] & 0x7f;
+    mac[4] = group[2];
+    mac[5] = group[3];
+}
+
+static void mac_of_ip6(uint8_t *mac, const uint8_t *group)
+{
+    mac[0] = 0x33;
+    mac[1] = 0x33;
+    memcpy(&mac[2], &group[12], 4);
+}
+
+static uint8_t *frame_eth(struct cap_frame *f, const uint8_t *da, uint16_t type)
+{
+    static const uint8_t sa[ETH_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x42};
+
+    memcpy(f->data, da, ETH_HWADDR_LEN);
+    memcpy(&f->data[6], sa, ETH_HWADDR_LEN);
+    f->data[12] = type >> 8;
+    f->data[13] = type & 0xff;
+    return &f->data[14];
+}
+
+/* UDP or raw payload of len bytes to an IPv4 group, dport 0 for a raw payload */
+static void frame_ip4(struct cap_frame *f, const uint8_t *group, uint8_t proto,
+                      uint16_t sport, uint16_t dport, uint16_t len)
+{
+    static const uint8_t src[4] = {192, 168, 1, 50};
+    uint8_t da[ETH_HWADDR_LEN], *ip;
+    uint16_t tot = 20 + (dport ? 8 : 0) + len, sum;
+
+    mac_of_ip4(da, group);
+    ip = frame_eth(f, da, ETHTYPE_IP);
+    memset(ip, 0, tot);
+    ip[0] = 0x45;
+    ip[2] = tot >> 8;
+    ip[3] = tot & 0xff;
+    ip[4] = rand() & 0xff;
+    ip[8] = 1;
+    ip[9] = proto;
+    memcpy(&ip[12], src, 4);
+    memcpy(&ip[16], group, 4);
+    sum = inet_chksum(ip, 20);
+    memcpy(&ip[10], &sum, 2);
+    if (dport) {
+        ip[20] = sport >> 8;
+        ip[21] = sport & 0xff;
+        ip[22] = dport >> 8;
+        ip[23] = dport & 0xff;
+        ip[24] = (8 + len) >> 8;
+        ip[25] = (8 + len) & 0xff;
+    } else if (proto == IP_PROTO_IGMP) {
+        /* general query */
+        ip[20] = 0x11;
+        ip[21] = 100;
+    }
+    f->len = 14 + tot;
+}
+
+/* UDP or ICMPv6 payload of len bytes from a link-local address to an IPv6 group */
+static void frame_ip6(struct cap_frame *f, const uint8_t *group, uint8_t nh,
+                      uint16_t sport, uint16_t dport, uint8_t icmp_type, uint16_t len)
+{
+    uint8_t da[ETH_HWADDR_LEN], *ip;
+    uint16_t plen = (nh == IP6_NEXTH_UDP ? 8 : 4) + len;
+
+    mac_of_ip6(da, group);
+    ip = frame_eth(f, da, ETHTYPE_IPV6);
+    memset(ip, 0, 40 + plen);
+    ip[0] = 0x60;
+    ip[4] = plen >> 8;
+    ip[5] = plen & 0xff;
+    ip[6] = nh;
+    ip[7] = 255;
+    ip[8] = 0xfe;
+    ip[9] = 0x80;
+    ip[23] = 0x50;
+    memcpy(&ip[24], group, 16);
+    if (nh == IP6_NEXTH_UDP) {
+        ip[40] = sport >> 8;
+        ip[41] = sport & 0xff;
+        ip[42] = dport >> 8;
+        ip[43] = dport & 0xff;
+        ip[44] = plen >> 8;
+        ip[45] = plen & 0xff;
+    } else {
+        ip[40] = icmp_type;
+    }
+    f->len = 14 + 40 + plen;
+}
+
+static void group_ip6(uint8_t *group, uint32_t low)
+{
+    memset(group, 0, 16);
+    group[0] = 0xff;
+    group[1] = 0x02;
+    group[12] = low >> 24;
+    group[13] = low >> 16;
+    group[14] = low >> 8;
+    group[15] = low;
+}
+
+/* solicited-node group ff02::1:ffxx:xxxx of an address ending with low */
+static void group_sol(uint8_t *group, uint32_t low)
+{
+    group_ip6(group, 0xff000000 | (low & 0xffffff));
+    group[11] = 0x01;
+}
+
+static uint32_t nif_low24(void)
+{
+    return ((uint32_t)nif.hwaddr[3] << 16) | ((uint32_t)nif.hwaddr[4] << 8) | nif.hwaddr[5];
+}
+
+/* the traffic mix of the capture, in percent */
+static void cap_build(void)
+{
+    static const uint8_t mdns4[4] = {224, 0, 0, 251}, ssdp[4] = {239, 255, 255, 250};
+    static const uint8_t llmnr4[4] = {224, 0, 0, 252}, allsys[4] = {224, 0, 0, 1};
+    uint8_t group[16];
+    int i, r;
+
+    srand(50);
+    cap = malloc(sizeof(*cap) * CAP_FRAME_NUM);
+    TEST_ASSERT(cap != NULL);
+    for (i = 0; i < CAP_FRAME_NUM; i++) {
+        struct cap_frame *f = &cap[i];
+
+        r = rand() % 100;
+        if (r < 15) {
+            frame_ip4(f, mdns4, IP_PROTO_UDP, 5353, 5353, 80 + rand() % 320);
+        } else if (r < 27) {
+            group_ip6(group, 0xfb);
+            frame_ip6(f, group, IP6_NEXTH_UDP, 5353, 5353, 0, 80 + rand() % 320);
+        } else if (r < 52) {
+            frame_ip4(f, ssdp, IP_PROTO_UDP, 50000, 1900, 250 + rand() % 100);
+        } else if (r < 57) {
+            frame_ip4(f, ssdp, IP_PROTO_UDP, 50001, 3702, 500 + rand() % 400);
+        } else if (r < 62) {
+            frame_ip4(f, llmnr4, IP_PROTO_UDP, 50002, 5355, 40);
+        } else if (r < 67) {
+            /* ff02::1:3 */
+            group_ip6(group, 0x00000003);
+            group[11] = 0x01;
+            frame_ip6(f, group, IP6_NEXTH_UDP, 50002, 5355, 0, 40);
+        } else if (r < 69) {
+            frame_ip4(f, allsys, IP_PROTO_IGMP, 0, 0, 8);
+        } else if (r < 72) {
+            /* router advertisement to all nodes */
+            group_ip6(group, 0x00000001);
+            frame_ip6(f, group, IP6_NEXTH_ICMP6, 0, 0, 134, 60);
+        } else if (r < 74) {
+            /* neighbour solicitation for our address */
+            group_sol(group, nif_low24());
+            frame_ip6(f, group, IP6_NEXTH_ICMP6, 0, 0, 135, 20);
+        } else if (r < 84) {
+            group_sol(group, 0x11 + rand() % 0xfee);
+            frame_ip6(f, group, IP6_NEXTH_ICMP6, 0, 0, 135, 20);
+        } else if (r < 95) {
+            group[0] = 239;
+            group[1] = rand() & 0xff;
+            group[2] = rand() & 0xff;
+            group[3] = 1 + rand() % 254;
+            frame_ip4(f, group, IP_PROTO_UDP, 40000, 1024 + rand() % 59000, 100 + rand() % 1100);
+        } else {
+            group[0] = 224;
+            group[1] = 0;
+            group[2] = 1;
+            group[3] = 1 + rand() % 200;
+            frame_ip4(f, group, IP_PROTO_UDP, 40000, 9999, 200);
+        }
+    }
+}
+
+/* destination MAC address of an IPv4 group */
+static int accept_ip4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+    uint8_t group[4] = {a, b, c, d}, mac[ETH_HWADDR_LEN];
+
+    mac_of_ip4(mac, group);
+    return net_mcast_filter_accept(&nif, mac);
+}
+
+/*
+ * Joins and leaves: reference counts of the groups sharing a MAC address,
+ * the groups lwIP joins by itself and the table overflow.
+ */
+static void test_filter(void)
+{
+    static const uint8_t stp[ETH_HWADDR_LEN] = {0x01, 0x80, 0xc2, 0x00, 0x00, 0x00};
+    static const uint8_t bcast[ETH_HWADDR_LEN] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+    struct net_mcast_filter_stats stats;
+    ip4_addr_t g, g2, many[NET_MCAST_FILTER_NUM];
+    ip6_addr_t g6;
+    uint8_t mac[ETH_HWADDR_LEN], group[16];
+    int i, n;
+
+    /* 224.0.0.1 joined by igmp_start, ff02::1 and the solicited-node group of the link-local address */
+    TEST_ASSERT(accept_ip4(224, 0, 0, 1));
+    group_ip6(group, 0x00000001);
+    mac_of_ip6(mac, group);
+    TEST_ASSERT(net_mcast_filter_accept(&nif, mac));
+    group_sol(group, nif_low24());
+    mac_of_ip6(mac, group);
+    TEST_ASSERT(net_mcast_filter_accept(&nif, mac));
+
+    /* other group addresses are not filtered */
+    TEST_ASSERT(net_mcast_filter_accept(&nif, stp));
+    TEST_ASSERT(net_mcast_filter_accept(&nif, bcast));
+
+    /* 224.0.0.251 and 224.128.0.251 share 01:00:5e:00:00:fb */
+    TEST_ASSERT(!accept_ip4(224, 0, 0, 251));
+    IP4_ADDR(&g, 224, 0, 0, 251);
+    IP4_ADDR(&g2, 224, 128, 0, 251);
+    TEST_ASSERT_EQ(igmp_joingroup_netif(&nif, &g), ERR_OK);
+    TEST_ASSERT_EQ(igmp_joingroup_netif(&nif, &g2), ERR_OK);
+    TEST_ASSERT(accept_ip4(224, 0, 0, 251));
+    TEST_ASSERT_EQ(igmp_leavegroup_netif(&nif, &g2), ERR_OK);
+    TEST_ASSERT(accept_ip4(224, 0, 0, 251));
+    TEST_ASSERT_EQ(igmp_leavegroup_netif(&nif, &g), ERR_OK);
+    TEST_ASSERT(!accept_ip4(224, 0, 0, 251));
+
+    /* MLD */
+    group_ip6(group, 0xfb);
+    memcpy(g6.addr, group, 16);
+    ip6_addr_clear_zone(&g6);
+    mac_of_ip6(mac, group);
+    TEST_ASSERT(!net_mcast_filter_accept(&nif, mac));
+    TEST_ASSERT_EQ(mld6_joingroup_netif(&nif, &g6), ERR_OK);
+    TEST_ASSERT(net_mcast_filter_accept(&nif, mac));
+    TEST_ASSERT_EQ(mld6_leavegroup_netif(&nif, &g6), ERR_OK);
+    TEST_ASSERT(!net_mcast_filter_accept(&nif, mac));
+
+    /* a join which does not fit opens the filter until it is left */
+    net_mcast_filter_stats_get(&stats, 1);
+    n = NET_MCAST_FILTER_NUM - stats.entries + 1;
+    for (i = 0; i < n; i++) {
+        IP4_ADDR(&many[i], 239, 1, 1, 1 + i);
+        TEST_ASSERT_EQ(igmp_joingroup_netif(&nif, &many[i]), ERR_OK);
+    }
+    net_mcast_filter_stats_get(&stats, 0);
+    TEST_ASSERT_EQ(stats.entries, NET_MCAST_FILTER_NUM);
+    TEST_ASSERT_EQ(stats.overflow, 1);
+    TEST_ASSERT(accept_ip4(239, 9, 9, 9));
+    TEST_ASSERT_EQ(igmp_leavegroup_netif(&nif, &many[n - 1]), ERR_OK);
+    TEST_ASSERT(!accept_ip4(239, 9, 9, 9));
+    for (i = 0; i < n - 1; i++) {
+        TEST_ASSERT(accept_ip4(239, 1, 1, 1 + i));
+        TEST_ASSERT_EQ(igmp_leavegroup_netif(&nif, &many[i]), ERR_OK);
+        TEST_ASSERT(!accept_ip4(239, 1, 1, 1 + i));
+    }
+    net_mcast_filter_stats_get(&stats, 1);
+    TEST_ASSERT_EQ(stats.overflow, 0);
+    TEST_ASSERT_EQ(stats.open, 1);
+    printf("filter: OK\n");
+}
+
+/*
+ * A MAC address joined more times than its reference count holds stays in the table,
+ * the table overflow of an interface only opens that interface, and removing the
+ * interface frees both.
+ */
+static void test_netif_clear(void)
+{
+    struct net_mcast_filter_stats stats;
+    ip4_addr_t ip, mask, gw, g, many[NET_MCAST_FILTER_NUM];
+    uint8_t mac[ETH_HWADDR_LEN], group[4] = {239, 2, 2, 2};
+    uint16_t entries;
+    int i, n;
+
+    net_mcast_filter_stats_get(&stats, 1);
+    entries = stats.entries;
+    IP4_ADDR(&ip, 192, 168, 2, 10);
+    IP4_ADDR(&mask, 255, 255, 255, 0);
+    IP4_ADDR(&gw, 192, 168, 2, 1);
+    nif2.hwaddr[0] = 0x02;
+    nif2.hwaddr[5] = 0x20;
+    TEST_ASSERT(netif_add(&nif2, &ip, &mask, &gw, NULL, nif_init, ethernet_input) != NULL);
+    netif_set_up(&nif2);
+
+    /* 300 joins of one MAC address, then 300 leaves */
+    IP4_ADDR(&g, 239, 2, 2, 2);
+    mac_of_ip4(mac, group);
+    for (i = 0; i < 300; i++)
+        TEST_ASSERT_EQ(nif2.igmp_mac_filter(&nif2, &g, NETIF_ADD_MAC_FILTER), ERR_OK);
+    for (i = 0; i < 300; i++)
+        TEST_ASSERT_EQ(nif2.igmp_mac_filter(&nif2, &g, NETIF_DEL_MAC_FILTER), ERR_OK);
+    net_mcast_filter_stats_get(&stats, 0);
+    TEST_ASSERT_EQ(stats.overflow, 0);
+    TEST_ASSERT(net_mcast_filter_accept(&nif2, mac));
+    TEST_ASSERT(!net_mcast_filter_accept(&nif, mac));
+    TEST_ASSERT(!accept_ip4(239, 9, 9, 9));
+
+    /* fill the table from the second interface */
+    n = NET_MCAST_FILTER_NUM - stats.entries + 1;
+    for (i = 0; i < n; i++) {
+        IP4_ADDR(&many[i], 239, 3, 3, 1 + i);
+        TEST_ASSERT_EQ(igmp_joingroup_netif(&nif2, &many[i]), ERR_OK);
+    }
+    net_mcast_filter_stats_get(&stats, 0);
+    TEST_ASSERT_EQ(stats.overflow, 1);
+    group[1] = 9;
+    mac_of_ip4(mac, group);
+    TEST_ASSERT(net_mcast_filter_accept(&nif2, mac));
+    TEST_ASSERT(!accept_ip4(239, 9, 9, 9));
+
+    net_mcast_filter_clear(&nif2);
+    net_mcast_filter_stats_get(&stats, 0);
+    TEST_ASSERT_EQ(stats.overflow, 0);
+    TEST_ASSERT_EQ(stats.entries, entries);
+    /* the leaves of lwIP find nothing left */
+    netif_remove(&nif2);
+    net_mcast_filter_stats_get(&stats, 1);
+    TEST_ASSERT_EQ(stats.overflow, 0);
+    TEST_ASSERT_EQ(stats.entries, entries);
+    TEST_ASSERT(!accept_ip4(239, 9, 9, 9));
+    TEST_ASSERT(accept_ip4(224, 0, 0, 1));
+
+    /* the slot of the interface is free for the next one */
+    TEST_ASSERT(netif_add(&nif2, &ip, &mask, &gw, NULL, nif_init, ethernet_input) != NULL);
+    netif_set_up(&nif2);
+    TEST_ASSERT(net_mcast_filter_accept(&nif2, mac) == 0);
+    netif_remove(&nif2);
+    net_mcast_filter_clear(&nif2);
+    net_mcast_filter_stats_get(&stats, 1);
+    TEST_ASSERT_EQ(stats.entries, entries);
+    printf("netif clear: OK\n");
+}
+
+/* replay the capture, the device runs an mDNS responder on 224.0.0.251:5353 */
+static void bench_replay(void)
+{
+    struct net_mcast_filter_stats stats;
+    uint32_t app[2], lwip[2];
+    uint64_t bytes[2], t0, ns[2];
+    struct udp_pcb *pcb;
+    ip4_addr_t g;
+    int pass, r, i;
+
+    IP4_ADDR(&g, 224, 0, 0, 251);
+    TEST_ASSERT_EQ(igmp_joingroup_netif(&nif, &g), ERR_OK);
+    pcb = udp_new();
+    TEST_ASSERT(pcb != NULL);
+    TEST_ASSERT_EQ(udp_bind(pcb, IP4_ADDR_ANY, 5353), ERR_OK);
+    udp_recv(pcb, udp_rx, NULL);
+    cap_build();
+
+    for (pass = 0; pass < 2; pass++) {
+        to_lwip = to_app = 0;
+        to_app_bytes = 0;
+        t0 = time_ns();
+        for (r = 0; r < BENCH_ROUNDS; r++) {
+            for (i = 0; i < CAP_FRAME_NUM; i++)
+                frame_input(cap[i].data, cap[i].len, pass == 1);
+        }
+        ns[pass] = time_ns() - t0;
+        lwip[pass] = to_lwip;
+        app[pass] = to_app;
+        bytes[pass] = to_app_bytes;
+    }
+
+    TEST_ASSERT(app[0] > 0);
+    TEST_ASSERT_EQ(app[1], app[0]);
+    TEST_ASSERT_EQ(bytes[1], bytes[0]);
+    TEST_ASSERT(lwip[1] < lwip[0]);
+    net_mcast_filter_stats_get(&stats, 0);
+    for (pass = 0; pass < 2; pass++) {
+        printf("bench: %-9s %d frames x %d, %5.1f%% to lwIP, %u datagrams to the application, %.0f ns/frame\n",
+               pass ? "filter" : "no filter", CAP_FRAME_NUM, BENCH_ROUNDS,
+               100.0 * lwip[pass] / ((double)CAP_FRAME_NUM * BENCH_ROUNDS), app[pass],
+               (double)ns[pass] / ((double)CAP_FRAME_NUM * BENCH_ROUNDS));
+    }
+    net_mcast_filter_dump();
+
+    udp_remove(pcb);
+    free(cap);
+}
+
+int main(void)
+{
+    ip4_addr_t ip, mask, gw;
+
+    lwip_init();
+    IP4_ADDR(&ip, 192, 168, 1, 10);
+    IP4_ADDR(&mask, 255, 255, 255, 0);
+    IP4_ADDR(&gw, 192, 168, 1, 1);
+    nif.hwaddr[0] = 0x02;
+    nif.hwaddr[4] = 0x00;
+    nif.hwaddr[5] = 0x10;
+    TEST_ASSERT(netif_add(&nif, &ip, &mask, &gw, NULL, nif_init, ethernet_input) != NULL);
+    netif_create_ip6_linklocal_address(&nif, 1);
+    netif_ip6_addr_set_state(&nif, 0, IP6_ADDR_PREFERRED);
+    netif_set_up(&nif);
+
+    test_filter();
+    test_netif_clear();
+    bench_replay();
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*!
+    \file    flash_sim.c
+    \brief   Simulated NOR flash with power cuts, for the nvds host tests
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * The flash services the nvds links against on the target: programming can only clear
+ * bits, an erase sets a whole sector back to 0xFF. Program and erase times move the
+ * simulated clock of the OS wrapper, so sys_current_time_get() in the nvds sees them.
+ * A power cut stops an operation part way: a random prefix of the write is programmed,
+ * or a random prefix of the sector is erased.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "flash_sim.h"
+#include "rom_export.h"
+#include "raw_flash_api.h"
+#include "crc.h"
+#include "mbedtls/aes.h"
+
+static uint8_t flash[FLASH_SIM_SIZE];
+static uint64_t sim_us;
+static uint32_t op_cnt;
+static uint32_t cut_at;
+static bool cut_clean;
+static bool cut;
+
+static void sim_time_add(uint64_t us)
+{
+    sim_us += us;
+    host_sim_time_set_us(sim_us);
+}
+
+/* length of the operation to carry out, shorter when the power is cut during it */
+static uint32_t sim_op_len(uint32_t len)
+{
+    op_cnt++;
+    if (cut_at && (op_cnt >= cut_at)) {
+        cut = true;
+        cut_at = 0;
+        return cut_clean ? 0 : rand() % (len + 1);
+    }
+    return len;
+}
+
+void flash_sim_reset(uint32_t seed)
+{
+    memset(flash, 0xFF, sizeof(flash));
+    srand(seed);
+    sim_us = 0;
+    op_cnt = 0;
+    cut_at = 0;
+    cut = false;
+    host_sim_time_set_us(0);
+}
+
+void flash_sim_cut_set(uint32_t count)
+{
+    cut = false;
+    cut_clean = false;
+    cut_at = count ? (op_cnt + count) : 0;
+}
+
+void flash_sim_fail_set(uint32_t count)
+{
+    flash_sim_cut_set(count);
+    cut_clean = true;
+}
+
+bool flash_sim_is_cut(void)
+{
+    return cut;
+}
+
+uint64_t flash_sim_time_us(void)
+{
+    return sim_us;
+}
+
+uint32_t flash_sim_op_cnt(void)
+{
+    return op_cnt;
+}
+
+int rom_flash_read(uint32_t offset, void *data, uint32_t len)
+{
+    if (cut || (offset + len > FLASH_SIM_SIZE))
+        return -1;
+
+    memcpy(data, &flash[offset], len);
+    return 0;
+}
+
+int rom_flash_write(uint32_t offset, const void *data, uint32_t len)
+{
+    const uint8_t *src = data;
+    uint32_t n;
+    uint32_t i;
+
+    if (cut || (offset + len > FLASH_SIM_SIZE))
+        return -1;
+
+    n = sim_op_len(len);
+    for (i = 0; i < n; i++)
+        flash[offset + i] &= src[i];
+    sim_time_add(((n + 3) / 4) * FLASH_SIM_WORD_PROGRAM_US);
+
+    return cut ? -1 : 0;
+}
+
+int raw_flash_erase(uint32_t offset, int len)
+{
+    uint32_t n;
+
+    if (cut || (offset % FLASH_SIM_SECTOR_SIZE) || (offset + len > FLASH_SIM_SIZE))
+        return -1;
+
+    n = sim_op_len(len);
+    memset(&flash[offset], 0xFF, n);
+    sim_time_add(((len + FLASH_SIM_SECTOR_SIZE - 1) / FLASH_SIM_SECTOR_SIZE) * FLASH_SIM_ERASE_US);
+
+    return cut ? -1 : 0;
+}
+
+/* only the erase goes through the sliced operation on the host */
+int raw_flash_sliced_op(raw_flash_op_t op, uint32_t offset, void *data, int len)
+{
+    if (op != RAW_FLASH_OP_ERASE)
+        return -1;
+
+    return raw_flash_erase(offset, len) ? -1 : 0;
+}
+
+void raw_flash_nodec_config(uint32_t nd_idx, uint32_t start_page, uint32_t end_page)
+{
+}
+
+uint32_t crc32(uintptr_t addr, uint32_t len, uint32_t crc)
+{
+    const uint8_t *p = (const uint8_t *)addr;
+    int k;
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/* the host tests do not encrypt the nvds */
+int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode, const unsigned char input[16],
+                          unsigned char output[16])
+{
+    return -1;
+}
@@ -0,0 +1,62 @@
+/*!
+    \file    flash_sim.h
+    \brief   Simulated NOR flash with power cuts, for the nvds host tests
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _FLASH_SIM_H_
+#define _FLASH_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FLASH_SIM_SIZE              0x20000
+#define FLASH_SIM_SECTOR_SIZE       4096
+/* sector erase and word program times of the simulated part */
+#define FLASH_SIM_ERASE_US          45000
+#define FLASH_SIM_WORD_PROGRAM_US   16
+
+/* erase the whole flash and restart the simulated clock */
+void flash_sim_reset(uint32_t seed);
+/* cut the power at the count-th program or erase from now, 0 for never; the operation
+   it hits is left partially done and every operation fails until the next call */
+void flash_sim_cut_set(uint32_t count);
+/* same as flash_sim_cut_set(), but the operation it hits is rejected before it starts,
+   as the flash api does on an error: the flash is left untouched */
+void flash_sim_fail_set(uint32_t count);
+/* true once the power has been cut */
+bool flash_sim_is_cut(void);
+/* simulated time spent in the flash operations, in us */
+uint64_t flash_sim_time_us(void);
+/* program and erase operations since the reset */
+uint32_t flash_sim_op_cnt(void);
+
+#endif /* _FLASH_SIM_H_ */
@@ -0,0 +1,319 @@
+/*!
+    \file    test_nvds_gc.c
+    \brief   Latency harness and power cut test of the nvds garbage collection
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * The same random put/delete traffic runs twice on a 16 KB store: once with only the
+ * inline compaction of new_page_request(), once with nvds_gc_step() called between the
+ * operations, as the nvds gc task does when the system is idle. The longest
+ * nvds_data_put and the puts that waited for a sector erase are reported for both, in
+ * simulated flash time. Every value is checked against a shadow copy, with reloads
+ * along the way.
+ * Power cuts are then injected in the gc steps. After each reboot every key must read
+ * back, and a key deleted after the reboot must stay deleted across the next one: it
+ * comes back if the copy of an element a cut move left behind survives the reload.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "flash_sim.h"
+#include "nvds_flash.h"
+
+#define STORE_BASE              0x10000
+#define STORE_SIZE              0x4000
+#define STORE_NS                "test"
+#define KEY_CNT                 32
+#define VALUE_MAX               600
+#define TRAFFIC_OPS             6000
+#define TRAFFIC_RELOAD_OPS      500
+#define CUT_ROUNDS              400
+#define CUT_TRAFFIC_OPS         20
+#define GC_STEP_MAX             1000
+
+struct traffic_result {
+    uint32_t puts;
+    uint32_t nospace;
+    uint32_t erase_waits;
+    uint64_t max_put_us;
+    uint64_t put_us;
+    struct nvds_gc_stats stats;
+};
+
+static uint8_t shadow_val[KEY_CNT][VALUE_MAX];
+static uint32_t shadow_len[KEY_CNT];
+static void *store;
+
+static void key_name(int k, char *key)
+{
+    sprintf(key, "key%d", k);
+}
+
+static void store_reload(void)
+{
+    if (store)
+        nvds_flash_deinit(store);
+    store = nvds_flash_init(STORE_BASE, STORE_SIZE, "test");
+    TEST_ASSERT(store);
+}
+
+static void store_check(void)
+{
+    uint8_t buf[VALUE_MAX];
+    uint32_t len;
+    char key[16];
+    int ret;
+    int k;
+
+    for (k = 0; k < KEY_CNT; k++) {
+        key_name(k, key);
+        len = sizeof(buf);
+        ret = nvds_data_get(store, STORE_NS, key, buf, &len);
+        if (shadow_len[k]) {
+            TEST_ASSERT_EQ(ret, NVDS_OK);
+            TEST_ASSERT_EQ(len, shadow_len[k]);
+            TEST_ASSERT(!memcmp(buf, shadow_val[k], len));
+        } else {
+            TEST_ASSERT_EQ(ret, NVDS_E_NOT_FOUND);
+        }
+    }
+}
+
+static void gc_drain(void)
+{
+    int steps = 0;
+
+    while (nvds_gc_step(store) == NVDS_OK)
+        TEST_ASSERT(++steps < GC_STEP_MAX);
+}
+
+/* half small values, most of the others in one element, some bulk ones */
+static uint32_t value_len_rand(void)
+{
+    int t = rand() % 10;
+
+    if (t < 5)
+        return 1 + rand() % 8;
+    if (t < 9)
+        return 9 + rand() % 248;
+    return 257 + rand() % (VALUE_MAX - 256);
+}
+
+/* one random put or delete, the put latency is returned in us */
+static uint64_t traffic_op(struct traffic_result *res)
+{
+    uint8_t buf[VALUE_MAX];
+    uint64_t start;
+    uint64_t lat;
+    uint32_t len;
+    uint32_t i;
+    char key[16];
+    int ret;
+    int k;
+
+    k = rand() % KEY_CNT;
+    key_name(k, key);
+
+    if (!(rand() % 8)) {
+        nvds_data_del(store, STORE_NS, key);
+        shadow_len[k] = 0;
+        return 0;
+    }
+
+    len = value_len_rand();
+    for (i = 0; i < len; i++)
+        buf[i] = rand();
+
+    start = flash_sim_time_us();
+    ret = nvds_data_put(store, STORE_NS, key, buf, len);
+    lat = flash_sim_time_us() - start;
+
+    if (ret == NVDS_E_NO_SPACE) {
+        /* the old value is deleted before the room is checked */
+        shadow_len[k] = 0;
+        if (res)
+            res->nospace++;
+    } else {
+        TEST_ASSERT_EQ(ret, NVDS_OK);
+        memcpy(shadow_val[k], buf, len);
+        shadow_len[k] = len;
+    }
+
+    if (res) {
+        res->puts++;
+        res->put_us += lat;
+        if (lat > res->max_put_us)
+            res->max_put_us = lat;
+        if (lat >= FLASH_SIM_ERASE_US)
+            res->erase_waits++;
+    }
+
+    return lat;
+}
+
+static void store_format(uint32_t seed)
+{
+    flash_sim_reset(seed);
+    memset(shadow_len, 0, sizeof(shadow_len));
+    store = NULL;
+    store_reload();
+}
+
+/* the statistics start over at each load, add them up before a reload */
+static void traffic_stats_add(struct traffic_result *res)
+{
+    struct nvds_gc_stats stats;
+
+    TEST_ASSERT_EQ(nvds_gc_stats_get(store, &stats, 0), NVDS_OK);
+    res->stats.steps += stats.steps;
+    res->stats.pages_reclaimed += stats.pages_reclaimed;
+    res->stats.pages_erased += stats.pages_erased;
+    res->stats.entries_relocated += stats.entries_relocated;
+    res->stats.fg_erase_cnt += stats.fg_erase_cnt;
+    res->stats.fg_gc_cnt += stats.fg_gc_cnt;
+    if (stats.fg_max_ms > res->stats.fg_max_ms)
+        res->stats.fg_max_ms = stats.fg_max_ms;
+}
+
+static void traffic_run(bool gc, uint32_t seed, struct traffic_result *res)
+{
+    int op;
+
+    memset(res, 0, sizeof(*res));
+    store_format(seed);
+
+    for (op = 0; op < TRAFFIC_OPS; op++) {
+        traffic_op(res);
+        if (gc)
+            gc_drain();
+
+        if ((op % TRAFFIC_RELOAD_OPS) == (TRAFFIC_RELOAD_OPS - 1)) {
+            store_check();
+            traffic_stats_add(res);
+            store_reload();
+            if (gc)
+                gc_drain();
+            store_check();
+        }
+    }
+
+    traffic_stats_add(res);
+    nvds_flash_deinit(store);
+    store = NULL;
+}
+
+static void traffic_print(const char *name, struct traffic_result *res)
+{
+    printf("%-22s puts %u, avg %5llu us, max %6llu us, waited for an erase %4u, "
+           "inline erases %4u, inline compactions %3u, gc steps %5u, no space %u\n",
+           name, res->puts, (unsigned long long)(res->put_us / res->puts),
+           (unsigned long long)res->max_put_us, res->erase_waits, res->stats.fg_erase_cnt,
+           res->stats.fg_gc_cnt, res->stats.steps, res->nospace);
+}
+
+static void test_gc_latency(void)
+{
+    struct traffic_result inline_res;
+    struct traffic_result gc_res;
+
+    traffic_run(false, 1, &inline_res);
+    traffic_run(true, 1, &gc_res);
+
+    traffic_print("inline compaction", &inline_res);
+    traffic_print("gc between operations", &gc_res);
+
+    /* the traffic does reach the inline compaction */
+    TEST_ASSERT(inline_res.stats.fg_gc_cnt > 0);
+    TEST_ASSERT(inline_res.max_put_us >= FLASH_SIM_ERASE_US);
+
+    /* with the gc keeping up, no put waits for an erase */
+    TEST_ASSERT_EQ(gc_res.stats.fg_erase_cnt, 0);
+    TEST_ASSERT_EQ(gc_res.stats.fg_gc_cnt, 0);
+    TEST_ASSERT_EQ(gc_res.erase_waits, 0);
+    TEST_ASSERT(gc_res.max_put_us < FLASH_SIM_ERASE_US);
+    TEST_ASSERT(gc_res.stats.pages_reclaimed > 0);
+    TEST_ASSERT_EQ(gc_res.nospace, 0);
+}
+
+static void test_gc_power_cut(void)
+{
+    uint32_t cuts = 0;
+    uint32_t round;
+    uint32_t op;
+    char key[16];
+    int k;
+
+    store_format(2);
+
+    for (round = 0; round < CUT_ROUNDS; round++) {
+        /* traffic without the gc, so that it has pages to reclaim */
+        for (op = 0; op < CUT_TRAFFIC_OPS; op++)
+            traffic_op(NULL);
+
+        flash_sim_cut_set(1 + rand() % 16);
+        while (!flash_sim_is_cut() && (nvds_gc_step(store) == NVDS_OK))
+            ;
+        if (flash_sim_is_cut())
+            cuts++;
+
+        /* reboot */
+        flash_sim_cut_set(0);
+        store_reload();
+        store_check();
+
+        /* delete a key, it must not come back */
+        for (k = rand() % KEY_CNT; !shadow_len[k]; k = (k + 1) % KEY_CNT)
+            ;
+        key_name(k, key);
+        TEST_ASSERT_EQ(nvds_data_del(store, STORE_NS, key), NVDS_OK);
+        shadow_len[k] = 0;
+        store_check();
+        store_reload();
+        store_check();
+    }
+
+    printf("gc power cut: %u rounds, %u cut in a gc step\n", CUT_ROUNDS, cuts);
+    TEST_ASSERT(cuts > CUT_ROUNDS / 2);
+
+    nvds_flash_deinit(store);
+    store = NULL;
+}
+
+int main(void)
+{
+    test_gc_latency();
+    test_gc_power_cut();
+
+    printf("test_nvds_gc passed\n");
+    return 0;
+}
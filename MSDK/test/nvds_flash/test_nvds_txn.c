@@ -0,0 +1,315 @@
+/*!
+    \file    test_nvds_txn.c
+    \brief   Power cut fuzz test of the nvds transactions
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Random transactions are committed over random put/delete traffic on a 16 KB store,
+ * with the power cut at a random flash operation of most commits. After the reboot,
+ * sometimes cut again while the transaction is recovered, every key must hold either
+ * the values from before the transaction or the values it wrote, never a mix.
+ * A commit can also fail on a flash error and the system keep running: the gc must
+ * then finish or roll back the transaction before it moves any of its entries.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "flash_sim.h"
+#include "nvds_flash.h"
+
+#define STORE_BASE              0x10000
+#define STORE_SIZE              0x4000
+#define KEY_CNT                 16
+#define VALUE_MAX               256
+#define TXN_OPS_MAX             6
+#define FUZZ_ROUNDS             3000
+#define FAIL_ROUNDS             1000
+#define CUT_OPS_MAX             40
+#define RECOVERY_CUT_OPS_MAX    6
+#define GC_STEP_MAX             1000
+
+struct shadow {
+    uint8_t val[KEY_CNT][VALUE_MAX];
+    uint32_t len[KEY_CNT];
+};
+
+static void *store;
+
+/* odd keys live in a namespace, even ones in the default one */
+static const char *key_ns(int k)
+{
+    return (k & 1) ? "txn" : NULL;
+}
+
+static void key_name(int k, char *key)
+{
+    sprintf(key, "k%d", k);
+}
+
+static void store_reload(void)
+{
+    if (store)
+        nvds_flash_deinit(store);
+    store = nvds_flash_init(STORE_BASE, STORE_SIZE, "test");
+    TEST_ASSERT(store);
+}
+
+/* true if every key matches s */
+static bool store_match(struct shadow *s)
+{
+    uint8_t buf[VALUE_MAX];
+    uint32_t len;
+    char key[16];
+    int ret;
+    int k;
+
+    for (k = 0; k < KEY_CNT; k++) {
+        key_name(k, key);
+        len = sizeof(buf);
+        ret = nvds_data_get(store, key_ns(k), key, buf, &len);
+        if (s->len[k]) {
+            if ((ret != NVDS_OK) || (len != s->len[k]) || memcmp(buf, s->val[k], len))
+                return false;
+        } else if (ret != NVDS_E_NOT_FOUND) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void gc_drain(void)
+{
+    int steps = 0;
+
+    while (nvds_gc_step(store) == NVDS_OK)
+        TEST_ASSERT(++steps < GC_STEP_MAX);
+}
+
+static void value_rand(uint8_t *buf, uint32_t *len)
+{
+    uint32_t i;
+    int t = rand() % 3;
+
+    if (t == 0)
+        *len = 1 + rand() % 8;
+    else if (t == 1)
+        *len = 9 + rand() % 120;
+    else
+        *len = 130 + rand() % (VALUE_MAX - 130);
+
+    for (i = 0; i < *len; i++)
+        buf[i] = rand();
+}
+
+static void traffic_run(struct shadow *s)
+{
+    uint8_t buf[VALUE_MAX];
+    uint32_t len;
+    char key[16];
+    int ret;
+    int n;
+    int k;
+
+    for (n = rand() % 4; n > 0; n--) {
+        k = rand() % KEY_CNT;
+        key_name(k, key);
+        if (rand() % 5) {
+            value_rand(buf, &len);
+            ret = nvds_data_put(store, key_ns(k), key, buf, len);
+            TEST_ASSERT_EQ(ret, NVDS_OK);
+            memcpy(s->val[k], buf, len);
+            s->len[k] = len;
+        } else {
+            nvds_data_del(store, key_ns(k), key);
+            s->len[k] = 0;
+        }
+    }
+
+    if (rand() % 2)
+        gc_drain();
+}
+
+/* build a random transaction, next is what the store holds once it is committed */
+static void *txn_build(struct shadow *next)
+{
+    uint8_t buf[VALUE_MAX];
+    uint32_t len;
+    char key[16];
+    void *txn;
+    int n;
+    int k;
+
+    txn = nvds_txn_begin(store);
+    TEST_ASSERT(txn);
+
+    for (n = 1 + rand() % TXN_OPS_MAX; n > 0; n--) {
+        k = rand() % KEY_CNT;
+        key_name(k, key);
+        if (rand() % 4) {
+            value_rand(buf, &len);
+            TEST_ASSERT_EQ(nvds_txn_put(txn, key_ns(k), key, buf, len), NVDS_OK);
+            memcpy(next->val[k], buf, len);
+            next->len[k] = len;
+        } else {
+            TEST_ASSERT_EQ(nvds_txn_del(txn, key_ns(k), key), NVDS_OK);
+            next->len[k] = 0;
+        }
+    }
+
+    return txn;
+}
+
+static void test_txn_power_cut(void)
+{
+    static struct shadow cur;
+    static struct shadow next;
+    uint32_t committed = 0;
+    uint32_t rolled_back = 0;
+    uint32_t recovery_cuts = 0;
+    uint32_t round;
+    bool cut;
+    int ret;
+
+    flash_sim_reset(3);
+    memset(&cur, 0, sizeof(cur));
+    store = NULL;
+    store_reload();
+
+    for (round = 0; round < FUZZ_ROUNDS; round++) {
+        traffic_run(&cur);
+        TEST_ASSERT(store_match(&cur));
+
+        next = cur;
+        flash_sim_cut_set((rand() % 3) ? 1 + rand() % CUT_OPS_MAX : 0);
+        ret = nvds_txn_commit(txn_build(&next));
+        cut = flash_sim_is_cut();
+        flash_sim_cut_set(0);
+
+        if (!cut) {
+            /* the store leaves room for any transaction of this test */
+            TEST_ASSERT_EQ(ret, NVDS_OK);
+            TEST_ASSERT(store_match(&next));
+            cur = next;
+            if (rand() % 4)
+                continue;
+        }
+
+        /* reboot, sometimes cut again while the transaction is recovered */
+        if (cut && !(rand() % 3)) {
+            flash_sim_cut_set(1 + rand() % RECOVERY_CUT_OPS_MAX);
+            if (store)
+                nvds_flash_deinit(store);
+            store = nvds_flash_init(STORE_BASE, STORE_SIZE, "test");
+            flash_sim_cut_set(0);
+            recovery_cuts++;
+        }
+        store_reload();
+
+        if (store_match(&next)) {
+            if (cut)
+                committed++;
+            cur = next;
+        } else {
+            TEST_ASSERT(cut);
+            TEST_ASSERT(store_match(&cur));
+            rolled_back++;
+        }
+    }
+
+    printf("txn power cut: %u rounds, %u completed and %u rolled back after a cut, "
+           "%u cut again in the recovery\n", FUZZ_ROUNDS, committed, rolled_back, recovery_cuts);
+    TEST_ASSERT(committed > 0);
+    TEST_ASSERT(rolled_back > 0);
+
+    nvds_flash_deinit(store);
+    store = NULL;
+}
+
+static void test_txn_flash_error(void)
+{
+    static struct shadow cur;
+    static struct shadow next;
+    uint32_t failed = 0;
+    uint32_t round;
+    int ret;
+
+    flash_sim_reset(4);
+    memset(&cur, 0, sizeof(cur));
+    store = NULL;
+    store_reload();
+
+    for (round = 0; round < FAIL_ROUNDS; round++) {
+        traffic_run(&cur);
+
+        /* the flash fails in the commit, then works again without a reboot */
+        next = cur;
+        flash_sim_fail_set(1 + rand() % CUT_OPS_MAX);
+        ret = nvds_txn_commit(txn_build(&next));
+        if (flash_sim_is_cut()) {
+            TEST_ASSERT(ret != NVDS_OK);
+            failed++;
+        }
+        flash_sim_cut_set(0);
+
+        /* the gc settles the transaction before moving anything */
+        gc_drain();
+        if (store_match(&next)) {
+            cur = next;
+        } else {
+            TEST_ASSERT(ret != NVDS_OK);
+            TEST_ASSERT(store_match(&cur));
+        }
+
+        /* what the gc left must load the same */
+        if (!(rand() % 8)) {
+            store_reload();
+            TEST_ASSERT(store_match(&cur));
+        }
+    }
+
+    printf("txn flash error: %u rounds, %u commits failed\n", FAIL_ROUNDS, failed);
+    TEST_ASSERT(failed > 0);
+
+    nvds_flash_deinit(store);
+    store = NULL;
+}
+
+int main(void)
+{
+    test_txn_power_cut();
+    test_txn_flash_error();
+
+    printf("test_nvds_txn passed\n");
+    return 0;
+}
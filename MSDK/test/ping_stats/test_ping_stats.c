@@ -0,0 +1,219 @@
+/*!
+    \file    test_ping_stats.c
+    \brief   Test of the statistics and pacing of the ping command
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Unit test of the ping statistics and pacing of ping.c.
+ * Checked: every round trip time falls in a histogram bucket that holds it and the buckets
+ * are at most 1/16 of their value wide, the percentiles of known distributions are within
+ * a bucket of the exact ones, the interval argument is parsed to the microsecond and bad
+ * ones are refused, and the wait between two requests neither returns early nor overshoots
+ * by more than the host scheduling slack, sleeping for the intervals of a tick or more.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "ping.c"
+
+/* scheduling slack of the host, checked on the median wait as a busy host delays a few */
+#define WAIT_SLACK_US           3000
+#define WAIT_NUM                21
+
+static struct ping_info_t info;
+
+static void test_hist_index(void)
+{
+    uint32_t us, idx, prev = 0, low, width;
+
+    for (us = 0; us < (1 << PING_HIST_MAX_BITS); us++) {
+        idx = ping_hist_index(us);
+        TEST_ASSERT(idx < PING_HIST_BUCKETS);
+        TEST_ASSERT(idx == prev || idx == prev + 1);
+        low = ping_hist_low(idx, &width);
+        TEST_ASSERT(low <= us && us < low + width);
+        TEST_ASSERT(width * 16 <= low || width == 1);
+        prev = idx;
+    }
+    /* the last bucket takes the rest */
+    TEST_ASSERT_EQ(ping_hist_index(1 << PING_HIST_MAX_BITS), PING_HIST_BUCKETS - 1);
+    TEST_ASSERT_EQ(ping_hist_index(0xffffffff), PING_HIST_BUCKETS - 1);
+}
+
+static void stats_reset(void)
+{
+    memset(&info, 0, sizeof(info));
+    info.ping_min_delay = 0xffffffff;
+}
+
+static void stats_add(uint32_t us)
+{
+    info.ping_hist[ping_hist_index(us)]++;
+    info.ping_recv_count++;
+    if (us < info.ping_min_delay)
+        info.ping_min_delay = us;
+    if (us > info.ping_max_delay)
+        info.ping_max_delay = us;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* the percentile is within the bucket of the exact value */
+static void percentile_check(uint32_t *val, uint32_t n)
+{
+    static const uint32_t pcts[] = {1, 50, 90, 99, 100};
+    uint32_t i, exact, got, low, width;
+
+    qsort(val, n, sizeof(val[0]), cmp_u32);
+    for (i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++) {
+        exact = val[(n * pcts[i] + 99) / 100 - 1];
+        got = ping_percentile(&info, pcts[i]);
+        low = ping_hist_low(ping_hist_index(exact), &width);
+        TEST_ASSERT(got >= low && got < low + width);
+    }
+}
+
+static void test_percentile(void)
+{
+    static uint32_t val[10000];
+    uint32_t i;
+
+    stats_reset();
+    TEST_ASSERT_EQ(ping_percentile(&info, 50), 0);
+
+    /* a single reply is every percentile */
+    stats_add(1234);
+    TEST_ASSERT_EQ(ping_percentile(&info, 1), 1234);
+    TEST_ASSERT_EQ(ping_percentile(&info, 100), 1234);
+
+    /* uniform 1 to 20 ms */
+    stats_reset();
+    srand(43);
+    for (i = 0; i < 10000; i++) {
+        val[i] = 1000 + rand() % 19000;
+        stats_add(val[i]);
+    }
+    percentile_check(val, 10000);
+
+    /* a fast mode and a 1% tail of slow replies */
+    stats_reset();
+    for (i = 0; i < 1000; i++) {
+        val[i] = (i % 100 == 0) ? 200000 + rand() % 50000 : 2000 + rand() % 500;
+        stats_add(val[i]);
+    }
+    percentile_check(val, 1000);
+    TEST_ASSERT(ping_percentile(&info, 50) < 2600);
+    TEST_ASSERT(ping_percentile(&info, 100) >= 200000);
+
+    /* beyond the histogram range, the maximum is reported */
+    stats_reset();
+    stats_add(100);
+    stats_add(10 << PING_HIST_MAX_BITS);
+    TEST_ASSERT_EQ(ping_percentile(&info, 100), 10 << PING_HIST_MAX_BITS);
+}
+
+static void test_interval_parse(void)
+{
+    static const struct {
+        const char *str;
+        int ret;
+        uint32_t us;
+    } cases[] = {
+        {"1000", 0, 1000000},
+        {"0", 0, 0},
+        {"0.25", 0, 250},
+        {"1.5", 0, 1500},
+        {"2.001", 0, 2001},
+        {"0.0005", 0, 0},       /* below 1us */
+        {"10.", 0, 10000},
+        {".5", 0, 500},
+        {"3600000", 0, 3600000000u},
+        {"3600001", -1, 0},
+        {"", -1, 0},
+        {"1a", -1, 0},
+        {"-1", -1, 0},
+        {"1.2.3", -1, 0},
+        {" 1", -1, 0},
+    };
+    uint32_t i, us;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        us = 0xdeadbeef;
+        TEST_ASSERT_EQ(ping_interval_parse(cases[i].str, &us), cases[i].ret);
+        if (cases[i].ret == 0)
+            TEST_ASSERT_EQ(us, cases[i].us);
+        else
+            TEST_ASSERT_EQ(us, 0xdeadbeef);
+    }
+}
+
+static void test_wait(void)
+{
+    static const uint32_t intervals[] = {0, 250, 900, 1000 * OS_MS_PER_TICK, 5500, 20000};
+    uint64_t t, now, late[WAIT_NUM], tmp;
+    uint32_t i, k, j;
+
+    for (i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+        t = ping_time_us();
+        for (k = 0; k < WAIT_NUM; k++) {
+            t += intervals[i];
+            ping_wait_until(t, intervals[i]);
+            now = ping_time_us();
+            TEST_ASSERT(now >= t);
+            late[k] = now - t;
+            for (j = k; j > 0 && late[j - 1] > late[j]; j--) {
+                tmp = late[j];
+                late[j] = late[j - 1];
+                late[j - 1] = tmp;
+            }
+        }
+        TEST_ASSERT(late[WAIT_NUM / 2] < WAIT_SLACK_US);
+    }
+}
+
+int main(void)
+{
+    test_hist_index();
+    test_percentile();
+    test_interval_parse();
+    test_wait();
+
+    printf("ping stats: pass\n");
+    return 0;
+}
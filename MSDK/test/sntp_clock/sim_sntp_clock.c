@@ -0,0 +1,261 @@
+/*!
+    \file    sim_sntp_clock.c
+    \brief   Simulation of the disciplined SNTP clock
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Simulation of the disciplined clock of sntp_api.c.
+ * The local counter drifts: a fixed offset, a random walk and a +-3 ppm hourly thermal
+ * term. Each poll plays what lwIP's sntp_process does with SNTP_COMP_ROUNDTRIP: the
+ * transmit and receive timestamps are read from the clock, the server timestamps from
+ * the true time, with exponential network jitter and delay spikes.
+ * The clock is read every second and compared with the true time. Checked once the
+ * frequency is locked: the error stays within a few milliseconds and within the bound
+ * the clock reports, reads never go backwards, and the frequency estimate follows the
+ * oscillator. The error of the former whole second clock is reported alongside.
+ * Every scenario is a different oscillator and runs in its own process, so that the
+ * frequency kept across sntp_disable() does not carry over.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "sntp_api.h"
+
+/* NTP era 1 starts at 2036-02-07 06:28:16 UTC */
+#define NTP_DIFF_SEC_1970_2036  ((uint32_t)2085978496UL)
+#define UTC_START_US            1.76e15
+
+struct scenario {
+    const char *name;
+    double drift_ppm;
+    double poll_s;
+    double jitter_us;           /* mean of the exponential network jitter */
+    double spike_p;             /* probability of a delay spike */
+    int hours;
+    double max_err_us;          /* allowed once the frequency is locked */
+    int in_tolerance;           /* within SNTP_CLK_XTAL_TOL_PPM */
+};
+
+static double local_us;         /* local counter */
+static double true_us;          /* true UTC */
+static double drift_ppm;
+static double base_drift_ppm;
+static double walk_ppm;
+
+u8_t sntp_enabled(void) { return 1; }
+void sntp_init(void) {}
+void sntp_stop(void) {}
+void sntp_setoperatingmode(u8_t operating_mode) {}
+void sntp_setservername(u8_t idx, const char *server) {}
+
+static double rnd(void)
+{
+    return (rand() + 0.5) / ((double)RAND_MAX + 1);
+}
+
+static double expo(double mean)
+{
+    return -mean * log(rnd());
+}
+
+static double gauss(void)
+{
+    return sqrt(-2 * log(rnd())) * cos(2 * M_PI * rnd());
+}
+
+static void advance(double dt_us)
+{
+    double step;
+
+    while (dt_us > 0) {
+        step = dt_us > 1e6 ? 1e6 : dt_us;
+        drift_ppm = base_drift_ppm + walk_ppm + 3.0 * sin(true_us / 3600e6 * 2 * M_PI);
+        true_us += step;
+        local_us += step * (1 + drift_ppm * 1e-6);
+        walk_ppm += 0.002 * gauss() * sqrt(step / 1e6);
+        dt_us -= step;
+    }
+    host_sim_time_set_us((uint64_t)local_us);
+}
+
+static int64_t ntp_time(double utc_us)
+{
+    uint64_t us = (uint64_t)utc_us;
+    uint32_t usec = us % 1000000;
+    int32_t sec = (int32_t)((uint32_t)(us / 1000000) - NTP_DIFF_SEC_1970_2036);
+    /* SNTP_FRAC_TO_US inverse, as lwIP's sntp.c */
+    uint32_t frac = usec * 4295 - ((usec * 2143) >> 16) + 2147;
+
+    return (int64_t)(((uint64_t)(uint32_t)sec << 32) | frac);
+}
+
+static int64_t clock_ntp_time(void)
+{
+    int32_t sec;
+    uint32_t frac;
+
+    sntp_get_system_time_ntp(&sec, &frac);
+    return (int64_t)(((uint64_t)(uint32_t)sec << 32) | frac);
+}
+
+/* former clock: whole seconds, stepped at each update */
+static uint32_t old_sec;
+static double old_local_us;
+
+/* one request and response, as sntp_process() */
+static void poll_server(const struct scenario *sc)
+{
+    double d_up = 3000 + expo(sc->jitter_us), d_down = 2500 + expo(sc->jitter_us);
+    int64_t t1, t2, t3, t4;
+    uint32_t step;
+    int32_t sec;
+
+    if (rnd() < sc->spike_p)
+        d_down += 30000 + expo(20000);
+
+    t1 = clock_ntp_time();
+    advance(d_up);
+    t2 = ntp_time(true_us);
+    advance(150);
+    t3 = ntp_time(true_us);
+    old_sec = (uint32_t)(true_us / 1e6);
+    advance(d_down);
+    t4 = clock_ntp_time();
+
+    /* lwIP compensates the round trip unless the clock is more than 2^30 s off */
+    sec = (int32_t)(t4 >> 32);
+    step = (sec < (int32_t)(t3 >> 32)) ? (uint32_t)(t3 >> 32) - (uint32_t)sec
+                                      : (uint32_t)sec - (uint32_t)(t3 >> 32);
+    if ((step >> 30) == 0) {
+        sntp_set_roundtrip_delay((t4 - t1) - (t3 - t2));
+        t4 += ((t2 - t1) + (t3 - t4)) / 2;
+        sntp_set_system_time_ntp((int32_t)((uint64_t)t4 >> 32), (uint32_t)t4);
+    } else {
+        sntp_set_system_time_ntp((int32_t)(t3 >> 32), (uint32_t)t3);
+    }
+    old_local_us = local_us;
+}
+
+static void run_scenario(const struct scenario *sc)
+{
+    double err, max_err = 0, sum_err = 0, old_err, old_max = 0, old_sum = 0;
+    double next_poll = 0, settle_us, end_us;
+    long samples = 0, violations = 0, backwards = 0;
+    uint64_t now, prev = 0;
+    sntp_clock_stats_t stats;
+    uint32_t bound;
+
+    srand(1234);
+    base_drift_ppm = sc->drift_ppm;
+    walk_ppm = 0;
+    true_us = UTC_START_US;
+    local_us = 5e6;
+    advance(0);
+    settle_us = UTC_START_US + (sc->poll_s * 4 > 1800 ? sc->poll_s * 4 : 1800) * 1e6;
+    end_us = UTC_START_US + sc->hours * 3600e6;
+    sntp_disable();
+
+    while (true_us < end_us) {
+        if (true_us >= next_poll) {
+            poll_server(sc);
+            next_poll = true_us + sc->poll_s * 1e6;
+        }
+        advance(997e3 + 3000 * rnd());
+        if (sntp_get_time_us(&now))
+            continue;
+        if (now < prev)
+            backwards++;
+        prev = now;
+
+        err = fabs((double)(int64_t)(now - (uint64_t)true_us));
+        TEST_ASSERT_EQ(sntp_get_error_bound_us(&bound), 0);
+        if (err > bound)
+            violations++;
+        if (true_us > settle_us) {
+            old_err = fabs((old_sec + floor((local_us - old_local_us) / 1e6)) * 1e6 - true_us);
+            if (err > max_err)
+                max_err = err;
+            if (old_err > old_max)
+                old_max = old_err;
+            sum_err += err;
+            old_sum += old_err;
+            samples++;
+        }
+    }
+
+    sntp_get_clock_stats(&stats);
+    printf("%-30s max %5.2f ms mean %5.2f ms | whole second clock max %6.0f ms | "
+           "bound exceeded %ld/%ld | correction %+6.2f ppm (oscillator %+6.2f ppm) | steps %u popcorn %u\n",
+           sc->name, max_err / 1e3, sum_err / samples / 1e3, old_max / 1e3, violations, samples,
+           stats.freq_ppb / 1e3, drift_ppm, stats.step_cnt, stats.popcorn_cnt);
+
+    TEST_ASSERT(samples > 0);
+    TEST_ASSERT_EQ(backwards, 0);
+    TEST_ASSERT(stats.freq_locked);
+    TEST_ASSERT(fabs(stats.freq_ppb / 1e3 + drift_ppm) < SNTP_CLK_WANDER_PPM);
+    if (sc->in_tolerance) {
+        TEST_ASSERT(max_err < sc->max_err_us);
+        TEST_ASSERT_EQ(violations, 0);
+    }
+}
+
+static const struct scenario scenarios[] = {
+    {"40 ppm, 64 s poll",             40,   64,   500,  0,    12, 3000,  1},
+    {"40 ppm, 64 s poll, spikes",     40,   64,   3000, 0.1,  12, 8000,  1},
+    {"-45 ppm, 1024 s poll, spikes",  -45,  1024, 3000, 0.1,  48, 8000,  1},
+    {"15 ppm, 86.4 s poll",           15,   86.4, 2000, 0.05, 24, 8000,  1},
+    /* beyond the assumed tolerance, the bound may be exceeded before the first lock */
+    {"-80 ppm, 1024 s poll, spikes",  -80,  1024, 3000, 0.1,  48, 0,     0},
+};
+
+int main(void)
+{
+    uint32_t i;
+    int status;
+
+    setvbuf(stdout, NULL, _IONBF, 0);
+    for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        if (fork() == 0) {
+            run_scenario(&scenarios[i]);
+            exit(0);
+        }
+        TEST_ASSERT(wait(&status) > 0);
+        TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    printf("sntp clock: pass\n");
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*!
+    \file    sntp.h
+    \brief   lwIP SNTP stand-in, the simulation plays the client
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef LWIP_HDR_APPS_SNTP_H
+#define LWIP_HDR_APPS_SNTP_H
+
+#include <stdint.h>
+/* included by lwip/arch.h */
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef uint8_t u8_t;
+
+#define SNTP_OPMODE_POLL                0
+
+u8_t sntp_enabled(void);
+void sntp_init(void);
+void sntp_stop(void);
+void sntp_setoperatingmode(u8_t operating_mode);
+void sntp_setservername(u8_t idx, const char *server);
+
+/* SNTP_SET_SYSTEM_TIME_NTP, SNTP_GET_SYSTEM_TIME_NTP and the round trip hook of lwipopts.h */
+void sntp_set_system_time_ntp(int32_t sec, uint32_t frac);
+void sntp_get_system_time_ntp(int32_t *sec, uint32_t *frac);
+void sntp_set_roundtrip_delay(int64_t delay);
+
+#endif /* LWIP_HDR_APPS_SNTP_H */
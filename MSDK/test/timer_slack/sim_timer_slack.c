@@ -0,0 +1,320 @@
+/*!
+    \file    sim_timer_slack.c
+    \brief   Simulation of the timer populations with timer slack
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Simulation of the timers running while a station is connected and a mesh node is
+ * provisioned, with and without timer slack.
+ * The first part plays the expiry rule of each timer source with the rounding of
+ * SYS_TIME_SLACK_ROUND: periodic sys_timers follow their period without slack, as
+ * wrapper_freertos.c does, mesh delayed work and eloop timeouts are armed again by
+ * their handler, a few milliseconds after the expiry, and the lwIP cyclic timers
+ * follow timeouts.c with and without LWIP_TIMERS_CYCLIC_ALIGN. The processor wakes
+ * up once per distinct expiry time. Checked: no expiry is later than the slack of its
+ * timer and the wakeups drop.
+ * The second part runs the lwIP cyclic timers of timeouts.c on the simulated clock,
+ * with the TCP timer started at an odd time by a connection, handlers taking a few
+ * milliseconds and the tcpip thread held up once. Checked: the tcpip thread only
+ * wakes up on multiples of the TCP timer interval.
+ * The rounding itself is checked on 32-bit times across their wrap and on 64-bit ticks
+ * above 2^32, as the FreeRTOS tick count of wrapper_freertos.c.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/tcp.h"
+#include "lwip/timeouts.h"
+#include "lwip/priv/tcp_priv.h"
+
+#define SIM_DURATION_MS         600000
+#define SIM_RUNS                20
+#define SIM_HANDLER_MS_MAX      2           /* time a handler takes before it arms again */
+
+/* slacks set by the firmware */
+#define MEM_TLM_SLACK(i)        ((i) / 8)                           /* mem_telemetry.c */
+#define MESH_WORK_SLACK(d)      (((d) >= 1000) ? ((d) >> 5) : 0)    /* mesh_kernel.c */
+#define ELOOP_POLLING_SLACK(i)  ((i) / 4)                           /* wifi_management.h, wifi_sta_table.h */
+
+enum sim_kind {
+    SIM_PERIODIC,           /* periodic sys_timer */
+    SIM_REARMED,            /* armed again by its handler from the time it runs */
+    SIM_CYCLIC,             /* lwIP cyclic timer, started with the stack */
+    SIM_CYCLIC_TCP,         /* lwIP TCP timer, started by the first connection */
+};
+
+struct sim_timer {
+    const char *name;
+    enum sim_kind kind;
+    uint32_t period;
+    uint32_t slack;
+    uint32_t due;           /* expiry without slack */
+    uint32_t expiry;
+    uint32_t late_max;
+};
+
+static const struct sim_timer sim_population[] = {
+    {"mem_tlm sampling",    SIM_PERIODIC,   1000,   MEM_TLM_SLACK(1000)},
+    {"mesh beacon",         SIM_REARMED,    10000,  MESH_WORK_SLACK(10000)},
+    {"mesh heartbeat",      SIM_REARMED,    8000,   MESH_WORK_SLACK(8000)},
+    {"mesh friend poll",    SIM_REARMED,    2600,   MESH_WORK_SLACK(2600)},
+    {"eloop link polling",  SIM_REARMED,    3000,   ELOOP_POLLING_SLACK(3000)},
+    {"eloop IPv6 polling",  SIM_REARMED,    4000,   ELOOP_POLLING_SLACK(4000)},
+    {"eloop STA table",     SIM_REARMED,    10000,  ELOOP_POLLING_SLACK(10000)},
+    {"lwIP tcp_tmr",        SIM_CYCLIC_TCP, 250,    0},
+    {"lwIP igmp_tmr",       SIM_CYCLIC,     250,    0},
+    {"lwIP dhcp_fine_tmr",  SIM_CYCLIC,     500,    0},
+    {"lwIP ip_reass_tmr",   SIM_CYCLIC,     1000,   0},
+    {"lwIP etharp_tmr",     SIM_CYCLIC,     1000,   0},
+    {"lwIP dns_tmr",        SIM_CYCLIC,     1000,   0},
+    {"lwIP dhcp_coarse_tmr", SIM_CYCLIC,    60000,  0},
+};
+
+#define SIM_TIMERS              (sizeof(sim_population) / sizeof(sim_population[0]))
+
+/* first expiry of an lwIP cyclic timer started at now, as lwip_cyclic_timer_first() */
+static uint32_t sim_cyclic_first(uint32_t now, uint32_t interval, int align)
+{
+    return align ? now + interval - (now % interval) : now + interval;
+}
+
+static void sim_arm(struct sim_timer *t, uint32_t now, int slack)
+{
+    uint32_t s = slack ? t->slack : 0;
+
+    if (t->kind == SIM_PERIODIC)
+        t->due += t->period;
+    else
+        t->due = now + t->period;
+    t->expiry = SYS_TIME_SLACK_ROUND(t->due, s);
+    TEST_ASSERT(t->expiry - t->due <= s);
+}
+
+/*!
+    \brief      run one population
+    \param[in]  seed: seed of the start times and handler durations
+    \param[in]  slack: nonzero to apply the slacks and align the lwIP timers
+    \param[out] late_max: largest delay of each timer on its expiry without slack
+    \retval     number of wakeups
+*/
+static uint32_t sim_run(unsigned int seed, int slack, uint32_t *late_max)
+{
+    struct sim_timer timers[SIM_TIMERS];
+    uint32_t lwip_start, now, wakeups = 0;
+    unsigned int i;
+
+    srand(seed);
+    memcpy(timers, sim_population, sizeof(timers));
+    lwip_start = 1 + rand() % 1000;
+    for (i = 0; i < SIM_TIMERS; i++) {
+        struct sim_timer *t = &timers[i];
+        uint32_t start = 1 + rand() % t->period;
+
+        if (t->kind == SIM_CYCLIC) {
+            t->expiry = sim_cyclic_first(lwip_start, t->period, slack);
+        } else if (t->kind == SIM_CYCLIC_TCP) {
+            t->expiry = sim_cyclic_first(lwip_start + start, t->period, slack);
+        } else {
+            t->due = start;
+            if (t->kind == SIM_PERIODIC)
+                t->due -= t->period;
+            sim_arm(t, start, slack);
+        }
+        t->late_max = 0;
+    }
+
+    for (;;) {
+        now = UINT32_MAX;
+        for (i = 0; i < SIM_TIMERS; i++)
+            if (timers[i].expiry < now)
+                now = timers[i].expiry;
+        if (now >= SIM_DURATION_MS)
+            break;
+        wakeups++;
+
+        for (i = 0; i < SIM_TIMERS; i++) {
+            struct sim_timer *t = &timers[i];
+            uint32_t done = now + rand() % (SIM_HANDLER_MS_MAX + 1);
+
+            if (t->expiry != now)
+                continue;
+            if (t->kind == SIM_CYCLIC || t->kind == SIM_CYCLIC_TCP) {
+                /* the TCP timer is armed again from now without the alignment */
+                if (t->kind == SIM_CYCLIC_TCP)
+                    t->expiry = slack ? sim_cyclic_first(done, t->period, 1) : done + t->period;
+                else
+                    t->expiry += t->period;
+                continue;
+            }
+            if (now - t->due > t->late_max)
+                t->late_max = now - t->due;
+            sim_arm(t, done, slack);
+        }
+    }
+
+    for (i = 0; i < SIM_TIMERS; i++)
+        if (timers[i].late_max > late_max[i])
+            late_max[i] = timers[i].late_max;
+    return wakeups;
+}
+
+static void sim_populations(void)
+{
+    uint32_t late_max[SIM_TIMERS] = {0}, late_none[SIM_TIMERS] = {0};
+    uint64_t wakeups = 0, wakeups_slack = 0;
+    unsigned int seed, i;
+
+    for (seed = 1; seed <= SIM_RUNS; seed++) {
+        wakeups += sim_run(seed, 0, late_none);
+        wakeups_slack += sim_run(seed, 1, late_max);
+    }
+
+    printf("%-22s %7s %6s %9s\n", "timer", "period", "slack", "late max");
+    for (i = 0; i < SIM_TIMERS; i++) {
+        const struct sim_timer *t = &sim_population[i];
+
+        if (t->kind == SIM_CYCLIC || t->kind == SIM_CYCLIC_TCP) {
+            printf("%-22s %7u %6s %9s\n", t->name, t->period, "align", "-");
+            continue;
+        }
+        printf("%-22s %7u %6u %9u\n", t->name, t->period, t->slack, late_max[i]);
+        TEST_ASSERT(late_max[i] <= t->slack);
+        TEST_ASSERT(late_none[i] == 0);
+    }
+    printf("wakeups per second: %.2f without slack, %.2f with slack\n",
+           wakeups * 1000.0 / SIM_RUNS / SIM_DURATION_MS,
+           wakeups_slack * 1000.0 / SIM_RUNS / SIM_DURATION_MS);
+    TEST_ASSERT(wakeups_slack * 10 < wakeups * 8);
+}
+
+/* ---- lwIP timeouts.c on the simulated clock ---- */
+static struct netif sim_netif;
+static uint32_t sim_ms;
+static uint32_t sim_tx;
+
+static void sim_time_set(uint32_t ms)
+{
+    sim_ms = ms;
+    host_sim_time_set_us((uint64_t)ms * 1000);
+}
+
+static err_t sim_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    sim_tx++;
+    return ERR_OK;
+}
+
+static err_t sim_netif_init(struct netif *netif)
+{
+    netif->output = sim_netif_output;
+    netif->mtu = 1500;
+    return ERR_OK;
+}
+
+static void sim_lwip_timers(void)
+{
+    ip4_addr_t ip, mask, peer;
+    struct tcp_pcb *pcb;
+    uint32_t end, wakeups = 0, off_grid = 0;
+
+    sim_time_set(1000003);
+    lwip_init();
+    IP4_ADDR(&ip, 10, 0, 0, 1);
+    IP4_ADDR(&mask, 255, 255, 255, 0);
+    IP4_ADDR(&peer, 10, 0, 0, 2);
+    TEST_ASSERT(netif_add(&sim_netif, &ip, &mask, &ip, NULL, sim_netif_init, ip_input) != NULL);
+    netif_set_default(&sim_netif);
+    netif_set_up(&sim_netif);
+    netif_set_link_up(&sim_netif);
+
+    /* the first connection starts the TCP timer, the timeouts due meanwhile run first */
+    sim_time_set(sim_ms + 1111);
+    sys_check_timeouts();
+    pcb = tcp_new();
+    TEST_ASSERT(pcb != NULL);
+    TEST_ASSERT(tcp_connect(pcb, &peer, 80, NULL) == ERR_OK);
+
+    end = sim_ms + 20000;
+    while (sim_ms < end) {
+        uint32_t sleep = sys_timeouts_sleeptime();
+
+        TEST_ASSERT(sleep != SYS_TIMEOUTS_SLEEPTIME_INFINITE);
+        sim_time_set(sim_ms + sleep);
+        wakeups++;
+        if (sim_ms % TCP_TMR_INTERVAL)
+            off_grid++;
+        /* the tcpip thread is held up once by a long message */
+        if (wakeups == 20)
+            sim_time_set(sim_ms + 1337);
+        sys_check_timeouts();
+        sim_time_set(sim_ms + rand() % (SIM_HANDLER_MS_MAX + 1));
+    }
+    tcp_abort(pcb);
+
+    printf("lwIP timers: %u wakeups in 20 s, %u off the %u ms grid, %u SYN sent\n",
+           wakeups, off_grid, TCP_TMR_INTERVAL, sim_tx);
+    TEST_ASSERT_EQ(off_grid, 0);
+    TEST_ASSERT(wakeups <= 20000 / TCP_TMR_INTERVAL + 1);
+    TEST_ASSERT(sim_tx > 1);
+}
+
+/*!
+    \brief      check the rounding on the time types it is used with
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void test_slack_round(void)
+{
+    uint64_t tick = (3ULL << 32) + 5;
+    uint32_t ms = 0xFFFFFFF5u;
+
+    TEST_ASSERT(SYS_TIME_SLACK_ROUND(tick, 20) == (3ULL << 32) + 16);
+    TEST_ASSERT(SYS_TIME_SLACK_ROUND(tick, 1) == tick);
+    TEST_ASSERT(SYS_TIME_SLACK_ROUND(tick, 0) == tick);
+    TEST_ASSERT(SYS_TIME_SLACK_ROUND(tick, 0x80000000u) == (7ULL << 31));
+    TEST_ASSERT_EQ(SYS_TIME_SLACK_ROUND(ms, 8), 0xFFFFFFF8u);
+    TEST_ASSERT_EQ(SYS_TIME_SLACK_ROUND(ms, 16), 0);
+}
+
+int main(void)
+{
+    test_slack_round();
+    sim_populations();
+    sim_lwip_timers();
+    printf("sim_timer_slack passed\n");
+    return 0;
+}
@@ -0,0 +1,357 @@
+/*!
+    \file    test_tinyws.c
+    \brief   Test of the WebSocket client framing and masking
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Test of the tinyws framing against RFC 6455.
+ * The session reads and writes an in-memory wire. The transport can cut the writes and
+ * the reads at random lengths, as TCP does, and the masking key is set by the test.
+ * Checked: the frame examples of RFC 6455 5.7, the 7-bit, 16-bit and 64-bit payload
+ * lengths, the single write of a frame that fits the tx buffer, the caller data left
+ * untouched by the masking, and the unmasking of payloads read in pieces.
+ * The word-wise masking is also compared with the byte-wise one, and timed against it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "tinyws.c"
+
+#define TX_BUF_SIZE             1460
+#define WIRE_SIZE               (200 * 1024)
+
+static uint8_t wire[WIRE_SIZE];
+static int wire_len;
+static int wire_pos;
+static int write_calls;
+/* longest write and read the transport accepts at once, 0 for no limit */
+static int write_cut;
+static int read_cut;
+static uint8_t next_mask[4];
+
+/* the handshake is not exercised */
+void mbedtls_sha1_init(mbedtls_sha1_context *ctx) {}
+void mbedtls_sha1_free(mbedtls_sha1_context *ctx) {}
+int mbedtls_sha1_starts(mbedtls_sha1_context *ctx) { return 0; }
+int mbedtls_sha1_update(mbedtls_sha1_context *ctx, const unsigned char *input, size_t ilen) { return 0; }
+int mbedtls_sha1_finish(mbedtls_sha1_context *ctx, unsigned char output[20]) { return 0; }
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                          const unsigned char *src, size_t slen) { *olen = 0; return 0; }
+void *wss_tls_connect(int *sock, char *host, int port) { return NULL; }
+int wss_tls_handshake(void *tls_in) { return -1; }
+void wss_tls_close(void *tls_in, int *sock) {}
+int wss_tls_write(void *tls_in, uint8_t *buf, int len) { return -1; }
+int wss_tls_read(void *tls_in, uint8_t *buffer, int buf_len) { return -1; }
+
+int random_get(unsigned char *output, unsigned int len)
+{
+    memcpy(output, next_mask, len < 4 ? len : 4);
+    return 0;
+}
+
+static int wire_write(struct ws_session *ws, uint8_t *data, size_t data_len)
+{
+    int len = data_len;
+
+    if (write_cut && len > 1)
+        len = 1 + rand() % (len < write_cut ? len : write_cut);
+    TEST_ASSERT(wire_len + len <= WIRE_SIZE);
+    memcpy(wire + wire_len, data, len);
+    wire_len += len;
+    write_calls++;
+    return len;
+}
+
+static int wire_read(struct ws_session *ws, uint8_t *data, size_t data_len)
+{
+    int len = data_len;
+
+    if (len > wire_len - wire_pos)
+        len = wire_len - wire_pos;
+    if (read_cut && len > 1)
+        len = 1 + rand() % (len < read_cut ? len : read_cut);
+    memcpy(data, wire + wire_pos, len);
+    wire_pos += len;
+    return len;
+}
+
+static void wire_reset(void)
+{
+    wire_len = 0;
+    wire_pos = 0;
+    write_calls = 0;
+}
+
+static void session_init(struct ws_session *ws)
+{
+    memset(ws, 0, sizeof(*ws));
+    ws->tx_buf_size = TX_BUF_SIZE;
+    ws->tx_buf = malloc(TX_BUF_SIZE + WEBSOCKET_HDR_SIZE);
+    ws->rx_buf_size = TX_BUF_SIZE;
+    ws->rx_buf = malloc(TX_BUF_SIZE);
+    ws->net_write = wire_write;
+    ws->net_read = wire_read;
+}
+
+static void session_free(struct ws_session *ws)
+{
+    free(ws->tx_buf);
+    free(ws->rx_buf);
+}
+
+/* read one frame from the wire as the session task does, in rx_buf sized pieces */
+static int frame_read(struct ws_session *ws, uint8_t *out)
+{
+    int payload_len, len, pos = 0;
+
+    payload_len = ws_read_hdr(ws, ws->rx_buf, ws->rx_buf_size);
+    TEST_ASSERT(payload_len >= 0);
+    while (ws->rx_frame.remaining > 0) {
+        len = ws_read_data(ws, ws->rx_buf, ws->rx_buf_size);
+        TEST_ASSERT(len > 0);
+        memcpy(out + pos, ws->rx_buf, len);
+        pos += len;
+    }
+    TEST_ASSERT_EQ(pos, payload_len);
+    return payload_len;
+}
+
+static void mask_ref(uint8_t *dst, const uint8_t *src, int len, const uint8_t *mask, uint32_t phase)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        dst[i] = src[i] ^ mask[(phase + i) & 0x03];
+}
+
+/* RFC 6455 5.7 */
+static void test_rfc_examples(void)
+{
+    static const uint8_t unmasked[] = {0x81, 0x05, 0x48, 0x65, 0x6c, 0x6c, 0x6f};
+    static const uint8_t masked[] = {0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d, 0x7f, 0x9f, 0x4d, 0x51, 0x58};
+    static const uint8_t ping[] = {0x89, 0x05, 0x48, 0x65, 0x6c, 0x6c, 0x6f};
+    struct ws_session ws;
+    uint8_t out[16];
+
+    session_init(&ws);
+
+    wire_reset();
+    TEST_ASSERT_EQ(ws_write(&ws, WS_OPCODE_TEXT | WS_FIN, 0, (const uint8_t *)"Hello", 5), 5);
+    TEST_ASSERT_EQ(wire_len, sizeof(unmasked));
+    TEST_ASSERT(memcmp(wire, unmasked, sizeof(unmasked)) == 0);
+
+    wire_reset();
+    memcpy(next_mask, &masked[2], 4);
+    TEST_ASSERT_EQ(ws_write(&ws, WS_OPCODE_TEXT | WS_FIN, WS_MASK, (const uint8_t *)"Hello", 5), 5);
+    TEST_ASSERT_EQ(wire_len, sizeof(masked));
+    TEST_ASSERT(memcmp(wire, masked, sizeof(masked)) == 0);
+
+    /* the masked frame read back, two bytes of payload at a time */
+    ws.rx_buf_size = 2;
+    TEST_ASSERT_EQ(frame_read(&ws, out), 5);
+    TEST_ASSERT(memcmp(out, "Hello", 5) == 0);
+    TEST_ASSERT_EQ(ws.rx_frame.op, WS_OPCODE_TEXT);
+    TEST_ASSERT(ws.rx_frame.fin_frame);
+    ws.rx_buf_size = TX_BUF_SIZE;
+
+    wire_reset();
+    TEST_ASSERT_EQ(ws_write(&ws, WS_OPCODE_PING | WS_FIN, 0, (const uint8_t *)"Hello", 5), 5);
+    TEST_ASSERT(memcmp(wire, ping, sizeof(ping)) == 0);
+
+    session_free(&ws);
+}
+
+/* the header of each payload length encoding */
+static void test_length_encoding(void)
+{
+    static const struct {
+        int len;
+        int hdr_len;
+        uint8_t hdr[10];
+    } cases[] = {
+        {0,      2,  {0x82, 0x00}},
+        {125,    2,  {0x82, 0x7d}},
+        {126,    4,  {0x82, 0x7e, 0x00, 0x7e}},
+        {256,    4,  {0x82, 0x7e, 0x01, 0x00}},
+        {65535,  4,  {0x82, 0x7e, 0xff, 0xff}},
+        {65536,  10, {0x82, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00}},
+        {100000, 10, {0x82, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x86, 0xa0}},
+    };
+    static uint8_t data[100000], out[100000];
+    struct ws_session ws;
+    uint32_t i;
+    int j;
+
+    session_init(&ws);
+    for (j = 0; j < (int)sizeof(data); j++)
+        data[j] = rand();
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        wire_reset();
+        TEST_ASSERT_EQ(ws_write(&ws, WS_OPCODE_BINARY | WS_FIN, 0, data, cases[i].len), cases[i].len);
+        TEST_ASSERT_EQ(wire_len, cases[i].hdr_len + cases[i].len);
+        TEST_ASSERT(memcmp(wire, cases[i].hdr, cases[i].hdr_len) == 0);
+        TEST_ASSERT(memcmp(wire + cases[i].hdr_len, data, cases[i].len) == 0);
+        TEST_ASSERT_EQ(frame_read(&ws, out), cases[i].len);
+        TEST_ASSERT(memcmp(out, data, cases[i].len) == 0);
+
+        /* same length masked, the mask bit and the key follow the length */
+        wire_reset();
+        next_mask[0] = rand(); next_mask[1] = rand(); next_mask[2] = rand(); next_mask[3] = rand();
+        TEST_ASSERT_EQ(ws_write(&ws, WS_OPCODE_BINARY | WS_FIN, WS_MASK, data, cases[i].len), cases[i].len);
+        TEST_ASSERT_EQ(wire_len, cases[i].hdr_len + 4 + cases[i].len);
+        TEST_ASSERT_EQ(wire[1], cases[i].hdr[1] | WS_MASK);
+        TEST_ASSERT(memcmp(wire + 2, cases[i].hdr + 2, cases[i].hdr_len - 2) == 0);
+        TEST_ASSERT(memcmp(wire + cases[i].hdr_len, next_mask, 4) == 0);
+        TEST_ASSERT_EQ(frame_read(&ws, out), cases[i].len);
+        TEST_ASSERT(memcmp(out, data, cases[i].len) == 0);
+    }
+
+    session_free(&ws);
+}
+
+/* frames of random length and data, cut at random by the transport both ways */
+static void test_round_trip(void)
+{
+    static uint8_t data[4 * TX_BUF_SIZE], copy[4 * TX_BUF_SIZE], out[4 * TX_BUF_SIZE];
+    struct ws_session ws;
+    int t, j, len, mask_flag;
+
+    session_init(&ws);
+    for (t = 0; t < 300; t++) {
+        len = rand() % (t & 1 ? (int)sizeof(data) : 200);
+        mask_flag = (t & 2) ? WS_MASK : 0;
+        for (j = 0; j < len; j++)
+            data[j] = rand();
+        memcpy(copy, data, len);
+        next_mask[0] = rand(); next_mask[1] = rand(); next_mask[2] = rand(); next_mask[3] = rand();
+        write_cut = 0;
+        read_cut = 0;
+
+        /* a frame that fits the tx buffer goes out in a single write */
+        wire_reset();
+        TEST_ASSERT_EQ(ws_write(&ws, WS_OPCODE_BINARY | WS_FIN, mask_flag, data, len), len);
+        if (len <= TX_BUF_SIZE)
+            TEST_ASSERT_EQ(write_calls, 1);
+        else
+            TEST_ASSERT_EQ(write_calls, (len + TX_BUF_SIZE - 1) / TX_BUF_SIZE);
+        TEST_ASSERT(memcmp(data, copy, len) == 0);
+        TEST_ASSERT_EQ(frame_read(&ws, out), len);
+        TEST_ASSERT(memcmp(out, data, len) == 0);
+
+        /* partial writes are completed, partial reads keep the mask phase */
+        write_cut = 1 + rand() % 64;
+        read_cut = 1 + rand() % 64;
+        ws.rx_buf_size = 1 + rand() % TX_BUF_SIZE;
+        wire_reset();
+        TEST_ASSERT_EQ(ws_write(&ws, WS_OPCODE_BINARY | WS_FIN, mask_flag, data, len), len);
+        TEST_ASSERT(memcmp(data, copy, len) == 0);
+        TEST_ASSERT_EQ(frame_read(&ws, out), len);
+        TEST_ASSERT(memcmp(out, data, len) == 0);
+        ws.rx_buf_size = TX_BUF_SIZE;
+    }
+    write_cut = 0;
+    read_cut = 0;
+
+    session_free(&ws);
+}
+
+/* ws_mask_copy against the byte-wise definition, every alignment and phase, in and out of place */
+static void test_mask_copy(void)
+{
+    uint8_t in[300], ref[300], out[304], inplace[304], mask[4];
+    int t, i, len, src_off, dst_off, phase, cut;
+
+    for (t = 0; t < 100000; t++) {
+        len = rand() % 200;
+        src_off = rand() % 4;
+        dst_off = rand() % 4;
+        phase = rand() % 4;
+        cut = len ? rand() % len : 0;
+        for (i = 0; i < 4; i++)
+            mask[i] = rand();
+        for (i = 0; i < len; i++)
+            in[src_off + i] = rand();
+
+        mask_ref(ref, in + src_off, len, mask, phase);
+        ws_mask_copy(out + dst_off, in + src_off, len, mask, phase);
+        TEST_ASSERT(memcmp(out + dst_off, ref, len) == 0);
+
+        memcpy(inplace + dst_off, in + src_off, len);
+        ws_mask_copy(inplace + dst_off, inplace + dst_off, cut, mask, phase);
+        ws_mask_copy(inplace + dst_off + cut, inplace + dst_off + cut, len - cut, mask, phase + cut);
+        TEST_ASSERT(memcmp(inplace + dst_off, ref, len) == 0);
+    }
+}
+
+/* masking throughput of a TCP segment sized payload, word-wise against byte-wise */
+static void bench_mask_copy(void)
+{
+    static uint8_t src[TX_BUF_SIZE + 4], dst[TX_BUF_SIZE + 4];
+    static const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    const int loops = 100000;
+    uint64_t t0, t_byte, t_word;
+    int t;
+
+    t0 = host_time_ns();
+    for (t = 0; t < loops; t++) {
+        mask_ref(dst, src + 1, TX_BUF_SIZE, mask, t);
+        __asm__ volatile("" ::: "memory");
+    }
+    t_byte = host_time_ns() - t0;
+
+    t0 = host_time_ns();
+    for (t = 0; t < loops; t++) {
+        ws_mask_copy(dst, src + 1, TX_BUF_SIZE, mask, t);
+        __asm__ volatile("" ::: "memory");
+    }
+    t_word = host_time_ns() - t0;
+
+    printf("mask %d bytes: byte-wise %.0f MB/s, word-wise %.0f MB/s\n", TX_BUF_SIZE,
+           (double)TX_BUF_SIZE * loops * 1e3 / t_byte, (double)TX_BUF_SIZE * loops * 1e3 / t_word);
+}
+
+int main(void)
+{
+    srand(6455);
+
+    test_rfc_examples();
+    test_length_encoding();
+    test_round_trip();
+    test_mask_copy();
+    bench_mask_copy();
+
+    printf("tinyws framing: pass\n");
+    return 0;
+}
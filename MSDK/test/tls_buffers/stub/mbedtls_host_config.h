@@ -0,0 +1,57 @@
+/*!
+    \file    mbedtls_host_config.h
+    \brief   mbedTLS configuration of the firmware, for the host
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef MBEDTLS_HOST_CONFIG_H
+#define MBEDTLS_HOST_CONFIG_H
+
+#include "mbedtls/mbedtls_config.h"
+
+/* no security engine, the software implementations are used */
+#undef CONFIG_HW_SECURITY_ENGINE
+#undef MBEDTLS_AES_ALT
+#undef MBEDTLS_DES_ALT
+#undef MBEDTLS_SHA256_ALT
+#undef MBEDTLS_ECDSA_VERIFY_ALT
+#undef MBEDTLS_ECDSA_SIGN_ALT
+
+/* host C library and sockets */
+#undef MBEDTLS_PLATFORM_NO_STD_FUNCTIONS
+#undef MBEDTLS_PLATFORM_EXIT_ALT
+#undef MBEDTLS_PLATFORM_TIME_ALT
+#undef MBEDTLS_PLATFORM_PRINTF_ALT
+#undef MBEDTLS_PLATFORM_SNPRINTF_ALT
+#undef MBEDTLS_PSA_CRYPTO_SPM
+#undef MBEDTLS_NET_C
+
+#endif /* MBEDTLS_HOST_CONFIG_H */
@@ -0,0 +1,340 @@
+/*!
+    \file    test_trace_ext.c
+    \brief   Multi-producer stress test of the trace ring
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Multi-producer stress test of the trace ring. Producer threads write console, BT snoop,
+ * Wi-Fi and BLE logs of random sizes while a drain thread sends the ring to a UART
+ * stand-in: with trace_print, or through the DMA completion path when built with
+ * TRACE_UART_DMA. The producers are preempted between reserve and commit at any point,
+ * so they commit in any order. The drain is slower than the producers and the ring fills.
+ * The UART stream is parsed back: every log the ring accepted must come out once, whole
+ * and with its content, and the ring counters must add up.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "trace_ext.h"
+
+#define RING_SIZE               0x4000
+#define PRODUCER_NUM            8
+#define PRODUCER_LOGS           10000
+#define SINK_SIZE               (32 << 20)
+#define DRAIN_TIMEOUT_MS        5000
+
+/* trace stream format */
+#define HDR_LEN                 6
+#define HDR_SYNC                0x7E
+#define FLAG_COMPLT             0
+#define FLAG_START              1
+#define FLAG_CONT               2
+#define FLAG_END                3
+#define BTSNOOP_HDR_LEN         8
+#define TRACE_HDR_LEN           12
+
+/* test log content: magic, producer, index, length, then a pattern */
+#define LOG_MAGIC               0xA5
+#define LOG_HDR_LEN             8
+
+/* the trace region of the firmware linker script */
+#define STR_(x)                 #x
+#define STR(x)                  STR_(x)
+uint32_t _trace[RING_SIZE / 4];
+__asm__(".globl _etrace\n.set _etrace, _trace + " STR(RING_SIZE));
+
+static uint8_t *sink;
+static uint32_t sink_len;
+static volatile int drain_stop;
+static uint32_t attempts[PRODUCER_NUM][TRACE_SRC_NUM];
+static uint8_t seen[PRODUCER_NUM][PRODUCER_LOGS];
+
+void uart_transfer_trace_data(const uint8_t *d, int size)
+{
+    TEST_ASSERT(sink_len + size <= SINK_SIZE);
+    memcpy(sink + sink_len, d, size);
+    sink_len += size;
+    // the UART is slower than the producers
+    if ((rand() % 8) == 0)
+        usleep(rand() % 50);
+}
+
+#ifdef TRACE_UART_DMA
+static os_sema_t dma_sema;
+static volatile uint32_t dma_addr, dma_num;
+
+/* called with the interrupts disabled, the transfer runs in the DMA thread */
+void trace_uart_dma_transfer(uint32_t address, uint32_t num)
+{
+    TEST_ASSERT(dma_num == 0);
+    dma_addr = address;
+    dma_num = num;
+    sys_sema_up(&dma_sema);
+}
+
+static void *dma_thread(void *arg)
+{
+    while (1) {
+        sys_sema_down(&dma_sema, 0);
+        if (dma_num == 0)
+            break;
+        uart_transfer_trace_data((const uint8_t *)(uintptr_t)dma_addr, dma_num);
+        dma_num = 0;
+        // transfer complete interrupt
+        trace_dma_transfer_cmplt();
+    }
+    return NULL;
+}
+#endif
+
+static void *drain_thread(void *arg)
+{
+    while (!drain_stop) {
+#ifdef TRACE_UART_DMA
+        trace_dma_print();
+#else
+        trace_print(300);
+#endif
+        if ((rand() % 4) == 0)
+            usleep(rand() % 30);
+    }
+    return NULL;
+}
+
+static void log_fill(uint8_t *p, int len, int tid, uint32_t idx)
+{
+    int i;
+
+    p[0] = LOG_MAGIC;
+    p[1] = tid;
+    memcpy(p + 2, &idx, 4);
+    p[6] = len & 0xff;
+    p[7] = len >> 8;
+    for (i = LOG_HDR_LEN; i < len; i++)
+        p[i] = (tid * 31 + idx * 7 + i) % 0x7E;
+}
+
+/* check a log, record it as seen and return its producer, -1 if invalid */
+static int log_check(const uint8_t *p, int len)
+{
+    uint32_t idx;
+    int i, tid = p[1];
+
+    if ((len < LOG_HDR_LEN) || (p[0] != LOG_MAGIC) || (tid >= PRODUCER_NUM) ||
+        ((p[6] | (p[7] << 8)) != len))
+        return -1;
+    memcpy(&idx, p + 2, 4);
+    if ((idx >= PRODUCER_LOGS) || seen[tid][idx])
+        return -1;
+    for (i = LOG_HDR_LEN; i < len; i++) {
+        if (p[i] != (tid * 31 + idx * 7 + i) % 0x7E)
+            return -1;
+    }
+    seen[tid][idx] = 1;
+    return tid;
+}
+
+static void *producer_thread(void *arg)
+{
+    int tid = (int)(intptr_t)arg;
+    uint8_t buf[2500] __attribute__((aligned(4)));
+    unsigned seed = tid * 7919 + 1;
+    int n, len, head;
+
+    for (n = 0; n < PRODUCER_LOGS; n++) {
+        // mostly short logs, some of several segments
+        len = LOG_HDR_LEN + rand_r(&seed) % ((rand_r(&seed) % 16) ? 120 : 2400);
+        len &= ~1;
+        switch (rand_r(&seed) % 5) {
+        case 0:
+            log_fill(buf, len, tid, n);
+            trace_console(len, buf);
+            attempts[tid][TRACE_SRC_CONSOLE]++;
+            break;
+        case 1:
+            log_fill(buf, len, tid, n);
+            trace_btsnoop(buf, len, 1, 2);
+            attempts[tid][TRACE_SRC_BTSNOOP]++;
+            break;
+        case 2:
+            // HCI header and payload from two buffers
+            log_fill(buf, len, tid, n);
+            head = LOG_HDR_LEN + rand_r(&seed) % (len - LOG_HDR_LEN + 1);
+            trace_btsnoop_payload(buf, head, 0, 4, buf + head, len - head);
+            attempts[tid][TRACE_SRC_BTSNOOP]++;
+            break;
+        case 3:
+            len = len > 510 ? 510 : len;
+            log_fill(buf, len, tid, n);
+            trace_wifi(0x123456, len / 2, (uint16_t *)buf, false);
+            attempts[tid][TRACE_SRC_WIFI]++;
+            break;
+        default:
+            len = len > 510 ? 510 : len;
+            log_fill(buf, len, tid, n);
+            trace_ble_log(0xABCDEF, len / 2, (uint16_t *)buf, TRACE_TYPE_BLE, MODULE_APP, LEVEL_ERROR);
+            attempts[tid][TRACE_SRC_BLE]++;
+            break;
+        }
+        if ((rand_r(&seed) % 4) == 0)
+            usleep(rand_r(&seed) % 200);
+    }
+    return NULL;
+}
+
+/* parse the UART stream back to logs, count the valid ones per source */
+static void stream_check(const uint8_t *s, uint32_t len, uint32_t good[TRACE_SRC_NUM])
+{
+    static uint8_t rec[4096];
+    const uint8_t *h;
+    uint32_t pos = 0;
+    int rec_len = -1, rec_type = 0, seg_len, flag, type, off, src, init = 0;
+
+    while (pos < len) {
+        h = s + pos;
+        TEST_ASSERT(pos + HDR_LEN <= len);
+        TEST_ASSERT((h[0] == HDR_SYNC) && ((h[0] ^ h[1] ^ h[2] ^ h[3] ^ h[4]) == h[5]));
+        seg_len = (h[2] | (h[3] << 8)) & 0x3FF;
+        flag = (h[3] >> 2) & 0x03;
+        type = (h[3] >> 4) & 0x07;
+        TEST_ASSERT(pos + HDR_LEN + seg_len <= len);
+
+        // a console log longer than a segment is a run of complete segments
+        if ((type == TRACE_TYPE_CONSOLE) && (rec_len > 0) && (rec_type == type)) {
+            TEST_ASSERT(flag == FLAG_COMPLT);
+        } else if ((flag == FLAG_COMPLT) || (flag == FLAG_START)) {
+            // the segments of a log are reserved at once, they are never interleaved
+            TEST_ASSERT(rec_len < 0);
+            rec_len = 0;
+            rec_type = type;
+        } else {
+            TEST_ASSERT((rec_len >= 0) && (rec_type == type));
+        }
+        TEST_ASSERT(rec_len + seg_len <= (int)sizeof(rec));
+        memcpy(rec + rec_len, h + HDR_LEN, seg_len);
+        rec_len += seg_len;
+        pos += HDR_LEN + seg_len;
+
+        if ((flag == FLAG_START) || (flag == FLAG_CONT))
+            continue;
+        if (type == TRACE_TYPE_CONSOLE) {
+            // the record trace_ext_init writes
+            if ((rec_len == 5) && (rec[0] == 0x60) && !init) {
+                init = 1;
+                rec_len = -1;
+                continue;
+            }
+            TEST_ASSERT((rec_len >= LOG_HDR_LEN) && (rec[0] == LOG_MAGIC));
+            if (rec_len < (rec[6] | (rec[7] << 8)))
+                continue;
+        }
+
+        off = (type == TRACE_TYPE_CONSOLE) ? 0 : (type == TRACE_TYPE_BTSNOOP) ? BTSNOOP_HDR_LEN : TRACE_HDR_LEN;
+        src = (type == TRACE_TYPE_CONSOLE) ? TRACE_SRC_CONSOLE : (type == TRACE_TYPE_BTSNOOP) ? TRACE_SRC_BTSNOOP :
+              (type == TRACE_TYPE_WIFI) ? TRACE_SRC_WIFI : TRACE_SRC_BLE;
+        TEST_ASSERT(rec_len > off);
+        TEST_ASSERT(log_check(rec + off, rec_len - off) >= 0);
+        good[src]++;
+        rec_len = -1;
+    }
+    TEST_ASSERT(init && (rec_len < 0));
+}
+
+int main(void)
+{
+    pthread_t prod[PRODUCER_NUM], drain;
+    struct trace_ring_stats st;
+    uint32_t good[TRACE_SRC_NUM] = {0}, total, i, ms;
+    uint64_t t0;
+    const char *src_name[TRACE_SRC_NUM] = {"ble", "wifi", "btsnoop", "console"};
+#ifdef TRACE_UART_DMA
+    pthread_t dma;
+
+    TEST_ASSERT(!sys_sema_init(&dma_sema, 0));
+    TEST_ASSERT(!pthread_create(&dma, NULL, dma_thread, NULL));
+    printf("trace ring, %d producers, DMA drain\n", PRODUCER_NUM);
+#else
+    printf("trace ring, %d producers, polled drain\n", PRODUCER_NUM);
+#endif
+    srand(1);
+    sink = malloc(SINK_SIZE);
+    TEST_ASSERT(sink != NULL);
+    trace_ext_init(true, false);
+
+    t0 = host_time_ns();
+    TEST_ASSERT(!pthread_create(&drain, NULL, drain_thread, NULL));
+    for (i = 0; i < PRODUCER_NUM; i++)
+        TEST_ASSERT(!pthread_create(&prod[i], NULL, producer_thread, (void *)(intptr_t)i));
+    for (i = 0; i < PRODUCER_NUM; i++)
+        pthread_join(prod[i], NULL);
+
+    // every committed byte leaves the ring
+    for (ms = 0; ms < DRAIN_TIMEOUT_MS; ms++) {
+        trace_ring_stats_get(&st, false);
+        if (st.used == 0)
+            break;
+        usleep(1000);
+    }
+    drain_stop = 1;
+    pthread_join(drain, NULL);
+#ifdef TRACE_UART_DMA
+    sys_sema_up(&dma_sema);
+    pthread_join(dma, NULL);
+#endif
+    trace_ring_stats_get(&st, false);
+    TEST_ASSERT_EQ(st.used, 0);
+    TEST_ASSERT_EQ(st.size, RING_SIZE);
+
+    stream_check(sink, sink_len, good);
+    printf("  %u bytes sent in %.2f s, ring used max %u/%u\n", sink_len, (host_time_ns() - t0) / 1e9,
+           st.used_max, st.size);
+    for (i = 0; i < TRACE_SRC_NUM; i++) {
+        for (total = 0, ms = 0; ms < PRODUCER_NUM; ms++)
+            total += attempts[ms][i];
+        // the console count includes the init record
+        if (i == TRACE_SRC_CONSOLE)
+            st.rec_cnt[i]--;
+        printf("  %-8s logs %6u written %6u dropped %6u received %6u\n", src_name[i], total,
+               st.rec_cnt[i], st.drop_cnt[i], good[i]);
+        TEST_ASSERT_EQ(st.rec_cnt[i] + st.drop_cnt[i], total);
+        TEST_ASSERT_EQ(good[i], st.rec_cnt[i]);
+        TEST_ASSERT_EQ(st.overwrite_cnt[i], 0);
+    }
+
+    free(sink);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,427 @@
+/*!
+    \file    test_wifi_capture.c
+    \brief   replay harness of the monitor mode capture engine
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Recorded 802.11 frames are fed to the capture RX callback, as the MAC RX context would.
+ * The test checks the compiled filter against a reference, the per-channel counters, and
+ * that the pcap/radiotap stream written to the UART and TCP sinks holds the expected frames.
+ * A pcap file (linktype 105 or 127) can be given as argument to replay a real recording,
+ * otherwise a synthetic one is generated.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "wrapper_os.h"
+#include "wifi_management.h"
+#include "wifi_capture.h"
+#include "uart_config.h"
+#include "lwip/sockets.h"
+#include "host_test.h"
+
+#define REC_FRAME_NUM           20000
+#define TEST_FILTER             "beacon qos_data bssid aa:bb:cc:00:00:03 rssi -70"
+#define RADIOTAP_LEN            13
+
+struct rec_frame
+{
+    uint16_t len;
+    uint16_t freq;
+    int8_t rssi;
+    uint8_t *data;
+};
+
+static struct rec_frame rec[REC_FRAME_NUM];
+static int rec_num;
+static const uint8_t bss[4][6] = {
+    {0x02, 0, 0, 0, 0, 1}, {0x02, 0, 0, 0, 0, 2}, {0xaa, 0xbb, 0xcc, 0, 0, 3}, {0x02, 0, 0, 0, 0, 4}
+};
+
+static cb_macif_rx monitor_cb;
+static uint8_t *uart_out;
+static uint32_t uart_out_len, uart_out_size;
+static uint32_t uart_baudrate;
+static int uart_slow_us;
+
+int wifi_management_monitor_start(uint8_t channel, cb_macif_rx cb)
+{
+    monitor_cb = cb;
+    return 0;
+}
+
+void uart_config(uint32_t usart_periph, uint32_t baudrate, bool flow_cntl, bool dma_rx, bool dma_tx)
+{
+    TEST_ASSERT(usart_periph == WIFI_CAPTURE_UART);
+    uart_baudrate = baudrate;
+}
+
+void uart_put_data(uint32_t usart_periph, const uint8_t *d, int size)
+{
+    TEST_ASSERT(usart_periph == WIFI_CAPTURE_UART);
+    if (uart_out_len + size > uart_out_size) {
+        uart_out_size = (uart_out_len + size) * 2;
+        uart_out = realloc(uart_out, uart_out_size);
+    }
+    memcpy(uart_out + uart_out_len, d, size);
+    uart_out_len += size;
+    if (uart_slow_us)
+        sys_us_delay(uart_slow_us);
+}
+
+/* beacons, probe requests, data frames in both directions, ACK and RTS from 4 BSS */
+static void rec_generate(void)
+{
+    uint8_t b[1600];
+    const uint8_t *bs, *sta;
+    int i, k, len;
+
+    srand(42);
+    for (i = 0; i < REC_FRAME_NUM; i++) {
+        memset(b, 0, sizeof(b));
+        bs = bss[rand() % 4];
+        sta = bss[rand() % 4];
+        switch (rand() % 6) {
+        case 0:     // beacon
+            b[0] = 0x80;
+            len = 60 + rand() % 200;
+            memset(b + 4, 0xff, 6);
+            memcpy(b + 10, bs, 6);
+            memcpy(b + 16, bs, 6);
+            break;
+        case 1:     // probe request
+            b[0] = 0x40;
+            len = 40 + rand() % 60;
+            memcpy(b + 16, bs, 6);
+            break;
+        case 2:     // data, to DS
+            b[0] = 0x08;
+            b[1] = 0x01;
+            len = 24 + rand() % 1476;
+            memcpy(b + 4, bs, 6);
+            memcpy(b + 10, sta, 6);
+            break;
+        case 3:     // QoS data, from DS
+            b[0] = 0x88;
+            b[1] = 0x02;
+            len = 26 + rand() % 1474;
+            memcpy(b + 10, bs, 6);
+            memcpy(b + 4, sta, 6);
+            break;
+        case 4:     // ACK
+            b[0] = 0xd4;
+            len = 10;
+            memcpy(b + 4, bs, 6);
+            break;
+        default:    // RTS
+            b[0] = 0xb4;
+            len = 16;
+            memcpy(b + 4, sta, 6);
+            memcpy(b + 10, bs, 6);
+            break;
+        }
+        for (k = 24; k < len; k++)
+            b[k] = rand();
+        rec[i].len = len;
+        rec[i].rssi = -95 + rand() % 75;
+        rec[i].freq = 2412 + 25 * (rand() % 3);
+        rec[i].data = malloc(len);
+        memcpy(rec[i].data, b, len);
+    }
+    rec_num = REC_FRAME_NUM;
+}
+
+/* load a pcap file with 802.11 (105) or radiotap (127) link type */
+static void rec_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    uint32_t gh[6], rh[4];
+    uint8_t *buf;
+    uint32_t skip;
+
+    TEST_ASSERT(f != NULL);
+    TEST_ASSERT((fread(gh, 4, 6, f) == 6) && (gh[0] == 0xa1b2c3d4));
+    TEST_ASSERT((gh[5] == 105) || (gh[5] == 127));
+    while ((rec_num < REC_FRAME_NUM) && (fread(rh, 4, 4, f) == 4)) {
+        buf = malloc(rh[2]);
+        TEST_ASSERT(fread(buf, 1, rh[2], f) == rh[2]);
+        skip = (gh[5] == 127) ? (buf[2] | (buf[3] << 8)) : 0;
+        if ((rh[2] <= skip + 10) || (rh[2] != rh[3])) {
+            free(buf);
+            continue;
+        }
+        rec[rec_num].len = rh[2] - skip;
+        rec[rec_num].freq = 2437;
+        rec[rec_num].rssi = -40 - (rec_num % 50);
+        rec[rec_num].data = malloc(rec[rec_num].len);
+        memcpy(rec[rec_num].data, buf + skip, rec[rec_num].len);
+        free(buf);
+        rec_num++;
+    }
+    fclose(f);
+}
+
+/* independent implementation of TEST_FILTER */
+static int ref_match(int i)
+{
+    const uint8_t *b = rec[i].data, *addr = NULL;
+    int type = (b[0] >> 2) & 3, subtype = b[0] >> 4, ds = b[1] & 3;
+
+    if (rec[i].rssi < -70)
+        return 0;
+    if ((type == 0) && (subtype == 8))
+        return !memcmp(b + 16, bss[2], 6);
+    if ((type == 2) && (subtype == 8)) {
+        if (ds == 0)
+            addr = b + 16;
+        else if (ds == 1)
+            addr = b + 4;
+        else if (ds == 2)
+            addr = b + 10;
+        return addr && !memcmp(addr, bss[2], 6);
+    }
+    return 0;
+}
+
+static void feed(int pace_us, double *cb_ns)
+{
+    struct wifi_frame_info info;
+    uint64_t t0;
+    int i;
+
+    for (i = 0; i < rec_num; i++) {
+        info.vif_idx = 0;
+        info.length = rec[i].len;
+        info.freq = rec[i].freq;
+        info.rssi = rec[i].rssi;
+        info.payload = rec[i].data;
+        t0 = host_time_ns();
+        monitor_cb(&info, NULL);
+        *cb_ns += host_time_ns() - t0;
+        if (pace_us)
+            sys_us_delay(pace_us);
+    }
+}
+
+/* check the stream holds the frames passing the filter in order, possibly with drops */
+static uint32_t stream_check(const uint8_t *s, uint32_t len, int snap, int use_filter)
+{
+    uint32_t gh[6], rh[4], off = 24, nrec = 0;
+    const uint8_t *r;
+    int j = 0;
+
+    TEST_ASSERT(len >= 24);
+    memcpy(gh, s, 24);
+    TEST_ASSERT((gh[0] == 0xa1b2c3d4) && (gh[5] == 127) && (gh[4] == (uint32_t)(RADIOTAP_LEN + snap)));
+    while (off + 16 <= len) {
+        memcpy(rh, s + off, 16);
+        r = s + off + 16;
+        off += 16 + rh[2];
+        TEST_ASSERT(off <= len);
+        TEST_ASSERT((r[2] == RADIOTAP_LEN) && (rh[3] >= RADIOTAP_LEN));
+        // the next recorded frame passing the filter, skipping the dropped ones
+        for (; j < rec_num; j++) {
+            if (use_filter && !ref_match(j))
+                continue;
+            if ((rec[j].len + RADIOTAP_LEN == rh[3]) && ((r[8] | (r[9] << 8)) == rec[j].freq) &&
+                ((int8_t)r[12] == rec[j].rssi) && !memcmp(r + RADIOTAP_LEN, rec[j].data, rh[2] - RADIOTAP_LEN))
+                break;
+        }
+        TEST_ASSERT(j < rec_num);
+        TEST_ASSERT(rh[2] == RADIOTAP_LEN + (rec[j].len < snap ? rec[j].len : snap));
+        j++;
+        nrec++;
+    }
+    TEST_ASSERT(off == len);
+    return nrec;
+}
+
+static uint32_t run(int sink, int snap, int pace_us, int slow_us, int use_filter)
+{
+    struct wifi_capture_cfg cfg;
+    struct wifi_capture_stats st;
+    uint32_t rx = 0, flt = 0, cap = 0, drop = 0, expected = 0;
+    double cb_ns = 0;
+    int i;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.channel = 6;
+    cfg.snap_len = snap;
+    cfg.sink = sink;
+    TEST_ASSERT(!wifi_capture_filter_compile(use_filter ? TEST_FILTER : NULL, &cfg.filter));
+    uart_out_len = 0;
+    uart_slow_us = slow_us;
+    wifi_capture_stats_get(&st, true);
+
+    TEST_ASSERT(!wifi_capture_start(&cfg));
+    feed(pace_us, &cb_ns);
+    wifi_capture_stop();
+
+    wifi_capture_stats_get(&st, false);
+    for (i = 0; i < rec_num; i++)
+        expected += !use_filter || ref_match(i);
+    for (i = 0; i <= WIFI_CAPTURE_CHANNEL_NUM; i++) {
+        TEST_ASSERT(st.chan[i].rx == st.chan[i].filtered + st.chan[i].captured + st.chan[i].dropped);
+        rx += st.chan[i].rx;
+        flt += st.chan[i].filtered;
+        cap += st.chan[i].captured;
+        drop += st.chan[i].dropped;
+    }
+    TEST_ASSERT_EQ(rx, rec_num);
+    TEST_ASSERT_EQ(cap + drop, expected);
+    if (sink == WIFI_CAPTURE_SINK_UART) {
+        TEST_ASSERT(uart_baudrate == WIFI_CAPTURE_UART_BAUDRATE);
+        TEST_ASSERT_EQ(stream_check(uart_out, uart_out_len, snap, use_filter), cap);
+        TEST_ASSERT_EQ(st.sent, cap);
+    }
+    printf("  rx %u filtered %u captured %u dropped %u sent %u ring hwm %u/%u, callback %.0f ns/frame\n",
+           rx, flt, cap, drop, st.sent, st.ring_hwm, WIFI_CAPTURE_RING_SIZE, cb_ns / rec_num);
+    return drop;
+}
+
+#ifndef HOST_CAPTURE_ON_LOG_UART
+/* TCP sink: a loopback server collects the stream */
+static int tcp_lsock;
+static uint8_t *tcp_out;
+static uint32_t tcp_out_len;
+
+static void *tcp_server(void *arg)
+{
+    int c = accept(tcp_lsock, NULL, NULL);
+    int n;
+
+    tcp_out = malloc(64 * 1024 * 1024);
+    while ((n = recv(c, tcp_out + tcp_out_len, 64 * 1024, 0)) > 0)
+        tcp_out_len += n;
+    close(c);
+    return NULL;
+}
+
+static void run_tcp(void)
+{
+    struct wifi_capture_cfg cfg;
+    struct wifi_capture_stats st;
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    pthread_t th;
+    double cb_ns = 0;
+    uint32_t cap = 0;
+    int i;
+
+    tcp_lsock = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT(!bind(tcp_lsock, (struct sockaddr *)&addr, sizeof(addr)) && !listen(tcp_lsock, 1));
+    getsockname(tcp_lsock, (struct sockaddr *)&addr, &addr_len);
+    pthread_create(&th, NULL, tcp_server, NULL);
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.channel = 6;
+    cfg.sink = WIFI_CAPTURE_SINK_TCP;
+    cfg.ip = addr.sin_addr.s_addr;
+    cfg.port = ntohs(addr.sin_port);
+    TEST_ASSERT(!wifi_capture_filter_compile(TEST_FILTER, &cfg.filter));
+    wifi_capture_stats_get(&st, true);
+    TEST_ASSERT(!wifi_capture_start(&cfg));
+    feed(5, &cb_ns);
+    wifi_capture_stop();
+    pthread_join(th, NULL);
+    close(tcp_lsock);
+
+    wifi_capture_stats_get(&st, false);
+    for (i = 0; i <= WIFI_CAPTURE_CHANNEL_NUM; i++)
+        cap += st.chan[i].captured;
+    TEST_ASSERT_EQ(stream_check(tcp_out, tcp_out_len, WIFI_CAPTURE_SNAP_LEN_DEFAULT, 1), cap);
+    TEST_ASSERT(st.sink_err == 0);
+    printf("  tcp: %u frames, %u bytes\n", cap, tcp_out_len);
+    free(tcp_out);
+}
+
+static void test_filter_compile(void)
+{
+    struct wifi_capture_filter flt;
+    int i;
+
+    TEST_ASSERT(wifi_capture_filter_compile("beacon bogus", &flt) == -1);
+    TEST_ASSERT(wifi_capture_filter_compile("bssid 11:22", &flt) == -1);
+    TEST_ASSERT(wifi_capture_filter_compile("rssi", &flt) == -1);
+    TEST_ASSERT(!wifi_capture_filter_compile("", &flt) && (flt.type_mask == ~(uint64_t)0) && !flt.flags);
+    TEST_ASSERT(!wifi_capture_filter_compile("mgmt ack", &flt) && (flt.type_mask == (0xffffull | (1ull << 29))));
+
+    TEST_ASSERT(!wifi_capture_filter_compile(TEST_FILTER, &flt));
+    for (i = 0; i < rec_num; i++)
+        TEST_ASSERT(wifi_capture_filter_match(&flt, rec[i].data, rec[i].len, rec[i].rssi) == ref_match(i));
+    printf("filter: %d frames match the reference\n", rec_num);
+}
+#endif /* HOST_CAPTURE_ON_LOG_UART */
+
+int main(int argc, char **argv)
+{
+    struct wifi_capture_cfg cfg;
+
+    setvbuf(stdout, NULL, _IONBF, 0);
+    if (argc > 1)
+        rec_load(argv[1]);
+    else
+        rec_generate();
+
+#ifdef HOST_CAPTURE_ON_LOG_UART
+    // the binary stream must not be mixed with the console output
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.channel = 6;
+    cfg.sink = WIFI_CAPTURE_SINK_UART;
+    TEST_ASSERT(!wifi_capture_filter_compile(NULL, &cfg.filter));
+    TEST_ASSERT(wifi_capture_start(&cfg) == WIFI_CAPTURE_ERR_UART_SHARED);
+    TEST_ASSERT(!wifi_capture_running() && (uart_out_len == 0) && (uart_baudrate == 0));
+    printf("uart sink on the log UART rejected\n");
+    run(WIFI_CAPTURE_SINK_NONE, 0, 0, 0, 1);
+#else
+    (void)cfg;
+    test_filter_compile();
+    // drops depend on the host scheduling, the stream is checked whatever their number
+    printf("filtered, uart, paced:\n");
+    run(WIFI_CAPTURE_SINK_UART, 128, 5, 0, 1);
+    printf("unfiltered, uart, paced, snap 64:\n");
+    run(WIFI_CAPTURE_SINK_UART, 64, 20, 0, 0);
+    printf("unfiltered, slow uart, burst:\n");
+    run(WIFI_CAPTURE_SINK_UART, 256, 0, 200, 0);
+    printf("unfiltered, counting only, burst:\n");
+    TEST_ASSERT(run(WIFI_CAPTURE_SINK_NONE, 0, 0, 0, 0) == 0);
+    printf("filtered, tcp, paced:\n");
+    run_tcp();
+#endif
+    printf("OK\n");
+    return 0;
+}
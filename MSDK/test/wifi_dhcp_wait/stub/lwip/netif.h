@@ -0,0 +1,72 @@
+/*!
+    \file    netif.h
+    \brief   lwIP netif stand-in, the extended status callbacks
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef LWIP_HDR_NETIF_H
+#define LWIP_HDR_NETIF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LWIP_NETIF_EXT_STATUS_CALLBACK  1
+
+#define LWIP_NSC_IPV4_ADDRESS_CHANGED   0x0010
+#define LWIP_NSC_IPV4_ADDR_VALID        0x0400
+
+typedef uint16_t netif_nsc_reason_t;
+typedef struct {
+    int unused;
+} netif_ext_callback_args_t;
+
+struct netif {
+    bool up;
+    bool obtained;
+    uint32_t ip;
+};
+
+typedef void (*netif_ext_callback_fn)(struct netif *netif, netif_nsc_reason_t reason,
+                                      const netif_ext_callback_args_t *args);
+
+typedef struct netif_ext_callback {
+    netif_ext_callback_fn callback_fn;
+    struct netif_ext_callback *next;
+} netif_ext_callback_t;
+
+#define NETIF_DECLARE_EXT_CALLBACK(name) static netif_ext_callback_t name;
+
+void netif_add_ext_callback(netif_ext_callback_t *callback, netif_ext_callback_fn fn);
+void netif_remove_ext_callback(netif_ext_callback_t *callback);
+
+#define netif_is_up(netif)              ((netif)->up)
+
+#endif /* LWIP_HDR_NETIF_H */
@@ -0,0 +1,57 @@
+/*!
+    \file    wifi_netif.h
+    \brief   lwIP port stand-in, the DHCP client of the test
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef WIFI_NETIF_H_
+#define WIFI_NETIF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* as in lwip/lwip-2.2.0/port/wifi_netif.h */
+void net_if_set_default(void *net_if);
+void net_if_send_gratuitous_arp(void *net_if);
+void net_if_set_ip(void *net_if, uint32_t ip, uint32_t mask, uint32_t gw);
+int net_if_get_ip(void *net_if, uint32_t *ip, uint32_t *mask, uint32_t *gw);
+int net_dhcp_start(void *net_if);
+void net_dhcp_stop(void *net_if);
+int net_dhcp_release(void *net_if);
+bool net_dhcp_address_obtained(void *net_if);
+int net_dhcpd_start(void *net_if);
+void net_dhcpd_stop(void *net_if);
+int net_set_dns(uint32_t dns_server);
+int net_get_dns(uint32_t *dns_server);
+bool net_if_is_static_ip(void);
+uint16_t net_ip_chksum(const void *dataptr, int len);
+
+#endif /* WIFI_NETIF_H_ */
@@ -0,0 +1,390 @@
+/*!
+    \file    test_wifi_dhcp_wait.c
+    \brief   Test of the DHCP wait of the Wi-Fi IP configuration
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Test of the blocking DHCP start of wifi_net_ip.c against a DHCP client stand-in.
+ * net_dhcp_start() starts a thread that plays the exchanges with the server and, when the
+ * lease is bound, sets the address and runs the netif extended status callbacks under the
+ * core lock, as dhcp_bind() does in the tcpip thread.
+ * Checked: the waiter returns as soon as the address is valid, an ACK received before the
+ * wait starts is not missed, the callback of another netif does not end the wait, a
+ * silent server times out with the callback removed, a second waiter falls back to
+ * the 100 ms polling, and two tasks starting together never register the callback twice.
+ * The detection lag of the event and of the polling are reported.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+
+/* a slow semaphore creation widens the window of two tasks claiming the waiter slot */
+static int32_t slow_sema_init(os_sema_t *sema, int32_t init_val);
+#define sys_sema_init slow_sema_init
+#include "wifi_net_ip.c"
+#undef sys_sema_init
+
+static int32_t slow_sema_init(os_sema_t *sema, int32_t init_val)
+{
+    usleep(2000);
+    return sys_sema_init(sema, init_val);
+}
+
+#define RUNS                    30
+/* scheduling slack of the host, far below the 100 ms polling step */
+#define EVENT_LAG_MAX_MS        20
+
+enum server_mode {
+    SERVER_REPLY,               /* the lease is bound after reply_ms */
+    SERVER_REPLY_AT_START,      /* bound inside net_dhcp_start */
+    SERVER_SILENT,
+};
+
+struct server {
+    struct netif *netif;
+    struct netif *other;        /* a netif whose address becomes valid first */
+    enum server_mode mode;
+    uint32_t reply_ms;
+    uint64_t bound_ns;
+    pthread_t thread;
+    bool running;
+};
+
+static pthread_mutex_t core_lock = PTHREAD_MUTEX_INITIALIZER;
+static netif_ext_callback_t *ext_callbacks;
+static struct netif netifs[CFG_VIF_NUM];
+static struct server servers[CFG_VIF_NUM];
+static int dhcp_stop_cnt;
+
+void host_core_lock(void)
+{
+    pthread_mutex_lock(&core_lock);
+}
+
+void host_core_unlock(void)
+{
+    pthread_mutex_unlock(&core_lock);
+}
+
+void netif_add_ext_callback(netif_ext_callback_t *callback, netif_ext_callback_fn fn)
+{
+    netif_ext_callback_t *cb;
+
+    /* lwIP does not check, a second add links the entry to itself */
+    for (cb = ext_callbacks; cb != NULL; cb = cb->next)
+        TEST_ASSERT(cb != callback);
+    callback->callback_fn = fn;
+    callback->next = ext_callbacks;
+    ext_callbacks = callback;
+}
+
+void netif_remove_ext_callback(netif_ext_callback_t *callback)
+{
+    netif_ext_callback_t **p;
+
+    for (p = &ext_callbacks; *p != NULL; p = &(*p)->next) {
+        if (*p == callback) {
+            *p = callback->next;
+            return;
+        }
+    }
+}
+
+/* dhcp_bind(), with the core lock held */
+static void netif_bound(struct netif *netif, uint32_t ip)
+{
+    netif_ext_callback_t *cb;
+
+    netif->ip = ip;
+    __atomic_store_n(&netif->obtained, true, __ATOMIC_RELEASE);
+    for (cb = ext_callbacks; cb != NULL; cb = cb->next)
+        cb->callback_fn(netif, LWIP_NSC_IPV4_ADDRESS_CHANGED | LWIP_NSC_IPV4_ADDR_VALID, NULL);
+}
+
+static struct server *server_of(void *net_if)
+{
+    return &servers[(struct netif *)net_if - netifs];
+}
+
+static void *server_task(void *arg)
+{
+    struct server *srv = arg;
+
+    if (srv->other) {
+        usleep(srv->reply_ms * 500);
+        host_core_lock();
+        netif_bound(srv->other, 0x0101a8c0);
+        host_core_unlock();
+        usleep(srv->reply_ms * 500);
+    } else {
+        usleep(srv->reply_ms * 1000);
+    }
+
+    host_core_lock();
+    netif_bound(srv->netif, 0x6401a8c0);
+    srv->bound_ns = host_time_ns();
+    host_core_unlock();
+    return NULL;
+}
+
+int net_dhcp_start(void *net_if)
+{
+    struct server *srv = server_of(net_if);
+
+    srv->netif = net_if;
+    srv->netif->obtained = false;
+    if (srv->mode == SERVER_REPLY_AT_START) {
+        host_core_lock();
+        netif_bound(srv->netif, 0x6401a8c0);
+        srv->bound_ns = host_time_ns();
+        host_core_unlock();
+    } else if (srv->mode == SERVER_REPLY) {
+        TEST_ASSERT_EQ(pthread_create(&srv->thread, NULL, server_task, srv), 0);
+        srv->running = true;
+    }
+    return 0;
+}
+
+static void server_join(struct server *srv)
+{
+    if (srv->running)
+        pthread_join(srv->thread, NULL);
+    srv->running = false;
+}
+
+void net_dhcp_stop(void *net_if)
+{
+    dhcp_stop_cnt++;
+}
+
+int net_dhcp_release(void *net_if)
+{
+    return 0;
+}
+
+/* read without the core lock, as dhcp_supplied_address() is */
+bool net_dhcp_address_obtained(void *net_if)
+{
+    return __atomic_load_n(&((struct netif *)net_if)->obtained, __ATOMIC_ACQUIRE);
+}
+
+int net_if_get_ip(void *net_if, uint32_t *ip, uint32_t *mask, uint32_t *gw)
+{
+    *ip = ((struct netif *)net_if)->ip;
+    *mask = 0x00ffffff;
+    *gw = 0x0101a8c0;
+    return 0;
+}
+
+bool net_if_is_static_ip(void)
+{
+    return false;
+}
+
+void net_if_set_default(void *net_if) {}
+void net_if_send_gratuitous_arp(void *net_if) {}
+void net_if_set_ip(void *net_if, uint32_t ip, uint32_t mask, uint32_t gw) {}
+int net_dhcpd_start(void *net_if) { return 0; }
+void net_dhcpd_stop(void *net_if) {}
+int net_set_dns(uint32_t dns_server) { return 0; }
+int net_get_dns(uint32_t *dns_server) { *dns_server = 0; return 0; }
+uint16_t net_ip_chksum(const void *dataptr, int len) { return 0; }
+
+void *vif_idx_to_net_if(uint8_t vif_idx)
+{
+    return &netifs[vif_idx];
+}
+
+static void netif_reset(int idx, enum server_mode mode, uint32_t reply_ms)
+{
+    memset(&netifs[idx], 0, sizeof(netifs[idx]));
+    memset(&servers[idx], 0, sizeof(servers[idx]));
+    netifs[idx].up = true;
+    servers[idx].mode = mode;
+    servers[idx].reply_ms = reply_ms;
+}
+
+/* DISCOVER/OFFER and REQUEST/ACK, each 5 to 50 ms */
+static uint32_t exchange_ms(void)
+{
+    return (5 + rand() % 46) + (5 + rand() % 46);
+}
+
+/* milliseconds from the bound lease to the return of wifi_dhcp_start */
+static double lag_ms(int idx, uint64_t end_ns)
+{
+    TEST_ASSERT(end_ns >= servers[idx].bound_ns);
+    return (end_ns - servers[idx].bound_ns) / 1e6;
+}
+
+static void test_event_wake(void)
+{
+    double lag, sum = 0, max = 0;
+    int i;
+
+    for (i = 0; i < RUNS; i++) {
+        netif_reset(0, SERVER_REPLY, exchange_ms());
+        TEST_ASSERT_EQ(wifi_dhcp_start(&netifs[0], 2000), 0);
+        lag = lag_ms(0, host_time_ns());
+        server_join(&servers[0]);
+        TEST_ASSERT(lag < EVENT_LAG_MAX_MS);
+        TEST_ASSERT(ext_callbacks == NULL);
+        sum += lag;
+        if (lag > max)
+            max = lag;
+    }
+    printf("event: detection lag avg %.2f ms, max %.2f ms\n", sum / RUNS, max);
+}
+
+static void test_ack_before_wait(void)
+{
+    uint64_t t0;
+
+    netif_reset(0, SERVER_REPLY_AT_START, 0);
+    t0 = host_time_ns();
+    TEST_ASSERT_EQ(wifi_dhcp_start(&netifs[0], 2000), 0);
+    TEST_ASSERT(host_time_ns() - t0 < EVENT_LAG_MAX_MS * 1000000ULL);
+    TEST_ASSERT(ext_callbacks == NULL);
+}
+
+static void test_other_netif(void)
+{
+    netif_reset(0, SERVER_REPLY, 100);
+    netif_reset(1, SERVER_SILENT, 0);
+    servers[0].other = &netifs[1];
+    TEST_ASSERT_EQ(wifi_dhcp_start(&netifs[0], 2000), 0);
+    TEST_ASSERT(lag_ms(0, host_time_ns()) < EVENT_LAG_MAX_MS);
+    TEST_ASSERT(netifs[0].obtained);
+    server_join(&servers[0]);
+}
+
+static void test_timeout(void)
+{
+    uint64_t t0;
+    double elapsed;
+
+    netif_reset(0, SERVER_SILENT, 0);
+    dhcp_stop_cnt = 0;
+    t0 = host_time_ns();
+    TEST_ASSERT_EQ(wifi_dhcp_start(&netifs[0], 300), -1);
+    elapsed = (host_time_ns() - t0) / 1e6;
+    TEST_ASSERT(elapsed >= 295 && elapsed < 300 + EVENT_LAG_MAX_MS);
+    TEST_ASSERT_EQ(dhcp_stop_cnt, 1);
+    TEST_ASSERT(ext_callbacks == NULL);
+
+    /* the next start registers again */
+    netif_reset(0, SERVER_REPLY, 10);
+    TEST_ASSERT_EQ(wifi_dhcp_start(&netifs[0], 2000), 0);
+    server_join(&servers[0]);
+}
+
+static void *first_waiter(void *arg)
+{
+    TEST_ASSERT_EQ(wifi_dhcp_start(&netifs[0], 5000), 0);
+    return NULL;
+}
+
+/* a second task waiting at the same time polls, as before the event */
+static void test_second_waiter(void)
+{
+    double lag, sum = 0, max = 0;
+    pthread_t first;
+    int i;
+
+    for (i = 0; i < RUNS / 3; i++) {
+        netif_reset(0, SERVER_REPLY, 250);
+        netif_reset(1, SERVER_REPLY, exchange_ms());
+        TEST_ASSERT_EQ(pthread_create(&first, NULL, first_waiter, NULL), 0);
+        while (!servers[0].running)
+            usleep(1000);
+        TEST_ASSERT_EQ(wifi_dhcp_start(&netifs[1], 2000), 0);
+        lag = lag_ms(1, host_time_ns());
+        TEST_ASSERT(lag <= 100 + EVENT_LAG_MAX_MS);
+        sum += lag;
+        if (lag > max)
+            max = lag;
+        pthread_join(first, NULL);
+        server_join(&servers[0]);
+        server_join(&servers[1]);
+        TEST_ASSERT(ext_callbacks == NULL);
+    }
+    printf("polling: detection lag avg %.2f ms, max %.2f ms\n", sum / (RUNS / 3), max);
+}
+
+static pthread_barrier_t start_barrier;
+
+static void *racing_waiter(void *arg)
+{
+    pthread_barrier_wait(&start_barrier);
+    TEST_ASSERT_EQ(wifi_dhcp_start(arg, 2000), 0);
+    return NULL;
+}
+
+/* two tasks claiming the waiter slot at the same time */
+static void test_racing_waiters(void)
+{
+    pthread_t waiters[2];
+    int i, k;
+
+    TEST_ASSERT_EQ(pthread_barrier_init(&start_barrier, NULL, 2), 0);
+    for (i = 0; i < RUNS; i++) {
+        for (k = 0; k < 2; k++) {
+            netif_reset(k, SERVER_REPLY, 20);
+            TEST_ASSERT_EQ(pthread_create(&waiters[k], NULL, racing_waiter, &netifs[k]), 0);
+        }
+        for (k = 0; k < 2; k++) {
+            pthread_join(waiters[k], NULL);
+            server_join(&servers[k]);
+        }
+        TEST_ASSERT(ext_callbacks == NULL);
+    }
+    pthread_barrier_destroy(&start_barrier);
+}
+
+int main(void)
+{
+    srand(41);
+
+    test_event_wake();
+    test_ack_before_wait();
+    test_other_netif();
+    test_timeout();
+    test_second_waiter();
+    test_racing_waiters();
+
+    printf("dhcp wait: pass\n");
+    return 0;
+}
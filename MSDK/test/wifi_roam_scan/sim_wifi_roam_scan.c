@@ -0,0 +1,343 @@
+/*!
+    \file    sim_wifi_roam_scan.c
+    \brief   simulation of the roaming scanner against the legacy connected scan
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * A STA connected to an ESS whose current AP fades out is simulated with a millisecond clock.
+ * The legacy policy runs a full scan at each poll once the RSSI is under the threshold, as
+ * mgmt_connected_scan_done does. The roaming scanner scans the learnt channels of the ESS in
+ * slices, and escalates to a full scan after WIFI_ROAM_MISS_LIMIT missed rounds.
+ * For each scenario the simulation reports the roaming decision latency, the time spent off
+ * the home channel and the number of channels visited.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "wifi_roam_scan.c"
+
+/* full scan dwell time per channel and channel switch time, in ms */
+#define FULL_DWELL_MS           50
+#define SWITCH_MS               3
+#define ROAM_RSSI_THRESHOLD     -70
+#define ROAM_RSSI_MARGIN        10
+#define SIM_END_MS              120000
+
+struct sim_ap
+{
+    const char *ssid;
+    int channel;
+    uint8_t id;
+    /* rssi at t = 0 and variation per second, in dB */
+    double rssi0;
+    double slope;
+};
+
+struct sim_result
+{
+    bool roamed;
+    uint32_t trigger_ms;
+    uint32_t latency_ms;
+    uint32_t airtime_ms;
+    uint32_t chan_visits;
+};
+
+static uint32_t now_ms;
+static struct sim_ap aps[8];
+static int ap_num, cur_ap;
+static struct mac_chan_def chans[WIFI_ROAM_CHANNEL_NUM + 1];
+
+/* eloop with a single timeout */
+static eloop_timeout_handler tmo_handler;
+static uint32_t tmo_at;
+
+/* scan in progress */
+static bool scan_busy;
+static uint32_t scan_done_at;
+static uint8_t scan_chan[WIFI_ROAM_CHANNEL_NUM + 1];
+static uint32_t chan_visits;
+
+/* NVDS */
+static uint8_t nvds_buf[256];
+static uint32_t nvds_len;
+static int nvds_puts;
+
+static double ap_rssi(struct sim_ap *ap)
+{
+    double rssi = ap->rssi0 + ap->slope * now_ms / 1000.0;
+
+    return rssi > -40 ? -40 : rssi;
+}
+
+int eloop_timeout_register(unsigned int msecs, eloop_timeout_handler handler, void *eloop_data, void *user_data)
+{
+    tmo_handler = handler;
+    tmo_at = now_ms + msecs;
+    return 0;
+}
+
+int eloop_timeout_cancel(eloop_timeout_handler handler, void *eloop_data, void *user_data)
+{
+    tmo_handler = NULL;
+    return 0;
+}
+
+int wifi_netlink_scan_set_with_freqs(int vif_idx, const char *ssid, int *freqs, int duration)
+{
+    int i, n = 0;
+
+    if (scan_busy)
+        return -2;
+    memset(scan_chan, 0, sizeof(scan_chan));
+    if (freqs == NULL) {
+        for (i = 1; i <= 13; i++)
+            scan_chan[i] = 1;
+        n = 13;
+        scan_done_at = now_ms + n * (FULL_DWELL_MS + SWITCH_MS);
+    } else {
+        for (i = 0; freqs[i]; i++) {
+            scan_chan[wifi_freq_to_channel(freqs[i])] = 1;
+            n++;
+        }
+        scan_done_at = now_ms + n * (duration * 1024 / 1000 + SWITCH_MS);
+    }
+    chan_visits += n;
+    scan_busy = true;
+    return 0;
+}
+
+int wifi_netlink_scan_results_get(int vif_idx, struct macif_scan_results *results)
+{
+    struct mac_scan_result *r;
+    int i;
+
+    results->result_cnt = 0;
+    for (i = 0; i < ap_num; i++) {
+        if (!scan_chan[aps[i].channel])
+            continue;
+        r = &results->result[results->result_cnt++];
+        memset(r, 0, sizeof(*r));
+        r->valid_flag = true;
+        r->ssid.length = strlen(aps[i].ssid);
+        memcpy(r->ssid.array, aps[i].ssid, r->ssid.length);
+        r->bssid.array[0] = aps[i].id;
+        r->chan = &chans[aps[i].channel];
+        r->chan->freq = wifi_channel_to_freq(aps[i].channel);
+        r->rssi = (int8_t)ap_rssi(&aps[i]);
+    }
+    return 0;
+}
+
+int macif_vif_current_chan_get(uint32_t vif_idx, uint8_t *channel)
+{
+    *channel = aps[cur_ap].channel;
+    return 0;
+}
+
+int nvds_data_get(void *handle, const char *namespace, const char *key, uint8_t *data, uint32_t *length)
+{
+    if (nvds_len == 0)
+        return 1;
+    if (*length < nvds_len)
+        return 2;
+    memcpy(data, nvds_buf, nvds_len);
+    *length = nvds_len;
+    return 0;
+}
+
+int nvds_data_put(void *handle, const char *namespace, const char *key, uint8_t *data, uint32_t length)
+{
+    TEST_ASSERT(length <= sizeof(nvds_buf));
+    memcpy(nvds_buf, data, length);
+    nvds_len = length;
+    nvds_puts++;
+    return 0;
+}
+
+/* legacy candidate selection: the best AP of the ESS in all the results */
+static int legacy_candidate(const char *ssid, struct mac_scan_result *cand)
+{
+    struct macif_scan_results *res = calloc(1, sizeof(*res));
+    int i, best = -200, ret = -1;
+
+    wifi_netlink_scan_results_get(0, res);
+    for (i = 0; i < res->result_cnt; i++) {
+        if ((res->result[i].ssid.length == strlen(ssid)) &&
+            !memcmp(res->result[i].ssid.array, ssid, strlen(ssid)) && (res->result[i].rssi > best)) {
+            best = res->result[i].rssi;
+            *cand = res->result[i];
+            ret = 0;
+        }
+    }
+    free(res);
+    return ret;
+}
+
+/* roam_scan: false for the legacy policy, reboot: clear the RAM state, NVDS is kept */
+static struct sim_result run(const char *name, bool roam_scan, bool reboot)
+{
+    struct sim_result res = {0};
+    struct mac_scan_result cand;
+    eloop_timeout_handler handler;
+    uint32_t poll_at = 0, polls = 0, scan_t0 = 0, next;
+    bool triggered = false;
+    int ret, i;
+
+    if (reboot)
+        memset(&roam, 0, sizeof(roam));
+    now_ms = 0;
+    cur_ap = 0;
+    tmo_handler = NULL;
+    scan_busy = false;
+    chan_visits = 0;
+    if (roam_scan)
+        wifi_roam_scan_connected(0, "corp");
+
+    while ((now_ms < SIM_END_MS) && !res.roamed) {
+        next = poll_at;
+        if (tmo_handler && (tmo_at < next))
+            next = tmo_at;
+        if (scan_busy && (scan_done_at < next))
+            next = scan_done_at;
+        now_ms = next;
+        host_sim_time_set_us((uint64_t)now_ms * 1000);
+
+        if (scan_busy && (now_ms == scan_done_at)) {
+            scan_busy = false;
+            res.airtime_ms += now_ms - scan_t0;
+            if (roam_scan) {
+                ret = wifi_roam_scan_done(0, &cand);
+                if (ret > 0)
+                    continue;   // next slice of the round
+            } else {
+                ret = legacy_candidate("corp", &cand);
+            }
+            if (ret)
+                continue;
+            if ((cand.bssid.array[0] != aps[cur_ap].id) &&
+                (cand.rssi >= ap_rssi(&aps[cur_ap]) + ROAM_RSSI_MARGIN)) {
+                res.roamed = true;
+                res.latency_ms = now_ms - res.trigger_ms;
+                if (roam_scan)
+                    wifi_roam_scan_decided(0, true);
+                for (i = 0; i < ap_num; i++) {
+                    if (aps[i].id == cand.bssid.array[0])
+                        cur_ap = i;
+                }
+            } else if (roam_scan) {
+                wifi_roam_scan_decided(0, false);
+            }
+            continue;
+        }
+
+        if (tmo_handler && (now_ms == tmo_at)) {
+            handler = tmo_handler;
+            tmo_handler = NULL;
+            scan_t0 = now_ms;
+            handler(NULL, NULL);
+            continue;
+        }
+
+        // rssi polling, every second and every 3 seconds once triggered
+        poll_at += triggered ? 3000 : 1000;
+        if (!triggered && (ap_rssi(&aps[cur_ap]) < ROAM_RSSI_THRESHOLD)) {
+            triggered = true;
+            res.trigger_ms = now_ms;
+            polls = 0;
+            if (roam_scan)
+                wifi_roam_scan_trigger(0);
+            poll_at = now_ms + 1;
+        } else if (triggered && !scan_busy && !tmo_handler) {
+            // the polling scan backs off after 10 tries, as polling_scan_count does
+            if ((polls < 10) || (polls % 10 == 0)) {
+                scan_t0 = now_ms;
+                if (roam_scan)
+                    wifi_roam_scan_start(0, "corp");
+                else
+                    wifi_netlink_scan_set_with_freqs(0, "corp", NULL, 0);
+            }
+            polls++;
+        }
+    }
+
+    res.chan_visits = chan_visits;
+    printf("%-34s %s roam %s, latency %5u ms | off-channel %5u ms, channel visits %3u | nvds writes %d\n",
+           name, roam_scan ? "roam scan" : "legacy   ", res.roamed ? "yes" : "no ", res.latency_ms,
+           res.airtime_ms, res.chan_visits, nvds_puts);
+    return res;
+}
+
+int main(void)
+{
+    struct wifi_roam_scan_stats st;
+    struct sim_result legacy, rs, rs_reboot;
+
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    // A: ESS on 1 (current, fading), 6 (improving) and 11, other networks on 3 and 9
+    aps[0] = (struct sim_ap){"corp", 1, 1, -50, -0.8};
+    aps[1] = (struct sim_ap){"corp", 6, 2, -85, 0.4};
+    aps[2] = (struct sim_ap){"corp", 11, 3, -78, 0};
+    aps[3] = (struct sim_ap){"other", 3, 9, -60, 0};
+    aps[4] = (struct sim_ap){"other", 9, 10, -65, 0};
+    ap_num = 5;
+    legacy = run("A: fresh history", false, true);
+    rs = run("A: fresh history", true, true);
+    TEST_ASSERT(legacy.roamed && rs.roamed && (cur_ap == 1));
+    TEST_ASSERT(rs.airtime_ms * 2 < legacy.airtime_ms);
+    TEST_ASSERT(rs.chan_visits * 2 < legacy.chan_visits);
+    TEST_ASSERT(rs.latency_ms <= legacy.latency_ms);
+
+    // the history was saved, a reboot keeps it
+    TEST_ASSERT(nvds_puts > 0);
+    rs_reboot = run("A: after reboot, history in NVDS", true, true);
+    TEST_ASSERT(rs_reboot.roamed && (rs_reboot.airtime_ms * 2 < legacy.airtime_ms));
+
+    // B: a new AP of the ESS on channel 4, which is not in the history
+    aps[1].rssi0 = -90;
+    aps[1].slope = 0;
+    aps[5] = (struct sim_ap){"corp", 4, 4, -60, 0};
+    ap_num = 6;
+    legacy = run("B: new AP off the history", false, true);
+    rs = run("B: new AP off the history", true, true);
+    // found by the escalation to a full scan
+    TEST_ASSERT(rs.roamed && (aps[cur_ap].channel == 4));
+    wifi_roam_scan_stats_get(&st, false);
+    TEST_ASSERT(st.full_rounds > 0);
+
+    printf("history:\n");
+    wifi_roam_scan_dump();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,456 @@
+/*!
+    \file    test_wifi_sta_table.c
+    \brief   Unit test, churn simulation and lookup benchmark of the station table
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Unit test, churn simulation and lookup benchmark of the SoftAP station table.
+ * The time is a simulated millisecond clock, the eloop holds the single timeout the
+ * table registers and a deauthentication is reported back as a client removed event,
+ * as the SoftAP does. The churn simulation checks the table against a reference model:
+ * counters, lookups, the inactivity eviction bound and the statistics.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wrapper_os.h"
+#include "host_test.h"
+#include "wifi_eloop.h"
+#include "wifi_management.h"
+#include "dhcpd.h"
+#include "wifi_sta_table.h"
+
+#define SIM_CLIENT_NUM          40
+#define SIM_STEP_MS             100
+#define SIM_END_MS              (2 * 3600 * 1000)
+#define SIM_IDLE_TIMEOUT_S      60
+#define SIM_BEACON_MS           103
+#define BENCH_LOOPS             4000000
+
+/* client behaviour in the churn simulation */
+enum sim_profile
+{
+    SIM_ACTIVE,
+    SIM_BURSTY,
+    SIM_SILENT
+};
+
+struct sim_client
+{
+    uint8_t mac[6];
+    uint8_t profile;
+    bool assoc;
+    uint16_t aid;
+    uint16_t listen_interval;
+    uint32_t assoc_time;
+    uint32_t last_rx;
+    uint32_t rx_pkts;
+    uint64_t rx_bytes;
+    uint32_t tx_pkts;
+    uint32_t tx_fail;
+};
+
+static uint32_t now_ms;
+
+/* eloop with a single timeout */
+static eloop_timeout_handler tmo_handler;
+static uint32_t tmo_at;
+
+/* deauthentications requested by the table */
+static int deauth_cnt;
+static uint8_t deauth_mac[SIM_CLIENT_NUM][6];
+
+static struct sim_client clients[SIM_CLIENT_NUM];
+
+int eloop_timeout_register(unsigned int msecs, eloop_timeout_handler handler, void *eloop_data, void *user_data)
+{
+    tmo_handler = handler;
+    tmo_at = now_ms + msecs;
+    return 0;
+}
+
+int eloop_timeout_register_slack(unsigned int msecs, unsigned int slack_ms, eloop_timeout_handler handler,
+                                 void *eloop_data, void *user_data)
+{
+    tmo_handler = handler;
+    tmo_at = SYS_TIME_SLACK_ROUND(now_ms + msecs, slack_ms);
+    return 0;
+}
+
+int wifi_management_ap_delete_client(uint8_t *client_mac)
+{
+    TEST_ASSERT(deauth_cnt < SIM_CLIENT_NUM);
+    memcpy(deauth_mac[deauth_cnt++], client_mac, 6);
+    return 0;
+}
+
+uint32_t dhcpd_find_ipaddr_by_macaddr(uint8_t *mac)
+{
+    return 0x0a01a8c0;
+}
+
+static void time_set(uint32_t ms)
+{
+    now_ms = ms;
+    host_sim_time_set_us((uint64_t)ms * 1000);
+}
+
+static void run_timeout(void)
+{
+    eloop_timeout_handler handler = tmo_handler;
+
+    TEST_ASSERT(handler != NULL);
+    tmo_handler = NULL;
+    handler(NULL, NULL);
+}
+
+static void mac_make(uint8_t *mac, int i)
+{
+    mac[0] = 0x02;
+    mac[1] = 0x11;
+    mac[2] = 0x22;
+    mac[3] = i * 7;
+    mac[4] = i * 13;
+    mac[5] = i;
+}
+
+/*
+ * Table operations with a full table, on the data path, the lease cache,
+ * reassociation, removal and eviction.
+ */
+static void test_basic(void)
+{
+    struct wifi_sta_info info, list[CFG_STA_NUM];
+    uint8_t mac[6], eth[6];
+    int i;
+
+    time_set(1000);
+    for (i = 1; i <= CFG_STA_NUM; i++) {
+        mac_make(mac, i);
+        TEST_ASSERT_EQ(wifi_sta_table_add(1, mac, i, 10), 0);
+    }
+    mac_make(mac, 99);
+    TEST_ASSERT_EQ(wifi_sta_table_add(1, mac, 99, 10), -1);
+    for (i = 1; i <= CFG_STA_NUM; i++) {
+        mac_make(mac, i);
+        TEST_ASSERT_EQ(wifi_sta_table_get(mac, &info), 0);
+        TEST_ASSERT_EQ(info.aid, i);
+        TEST_ASSERT_EQ(wifi_sta_table_get_by_aid(1, i, &info), 0);
+        TEST_ASSERT_EQ(info.mac[5], i);
+        TEST_ASSERT_EQ(wifi_sta_table_get_by_aid(0, i, &info), -1);
+    }
+
+    /* data path, group frames are not accounted */
+    mac_make(mac, 3);
+    for (i = 0; i < 100; i++)
+        wifi_sta_table_rx(mac, 1500);
+    mac_make(eth, 3);
+    wifi_sta_table_tx(eth, 500, true);
+    wifi_sta_table_tx(eth, 500, false);
+    eth[0] |= 0x01;
+    wifi_sta_table_tx(eth, 500, true);
+    TEST_ASSERT_EQ(wifi_sta_table_get(mac, &info), 0);
+    TEST_ASSERT_EQ(info.rx_pkts, 100);
+    TEST_ASSERT_EQ(info.rx_bytes, 150000);
+    TEST_ASSERT_EQ(info.tx_pkts, 1);
+    TEST_ASSERT_EQ(info.tx_bytes, 500);
+    TEST_ASSERT_EQ(info.tx_fail, 1);
+
+    /* lease cache */
+    wifi_sta_table_lease_set(mac, 4);
+    TEST_ASSERT_EQ(wifi_sta_table_lease_get(mac), 4);
+    mac_make(eth, 98);
+    TEST_ASSERT_EQ(wifi_sta_table_lease_get(eth), -1);
+
+    /* a reassociation starts over */
+    TEST_ASSERT_EQ(wifi_sta_table_add(1, mac, 3, 10), 0);
+    TEST_ASSERT_EQ(wifi_sta_table_get(mac, &info), 0);
+    TEST_ASSERT_EQ(info.rx_pkts, 0);
+    TEST_ASSERT_EQ(info.lease_idx, -1);
+
+    /* removals keep the hash chains consistent */
+    for (i = 1; i <= CFG_STA_NUM; i += 2) {
+        mac_make(mac, i);
+        wifi_sta_table_del(mac);
+    }
+    for (i = 1; i <= CFG_STA_NUM; i++) {
+        mac_make(mac, i);
+        TEST_ASSERT_EQ(wifi_sta_table_get(mac, &info) == 0, !(i & 1));
+        TEST_ASSERT_EQ(wifi_sta_table_get_by_aid(1, i, &info) == 0, !(i & 1));
+    }
+    TEST_ASSERT_EQ(wifi_sta_table_list(1, list, CFG_STA_NUM), CFG_STA_NUM / 2);
+
+    /* eviction: client 2 keeps talking, the others are idle */
+    time_set(now_ms + 200000);
+    mac_make(mac, 2);
+    wifi_sta_table_rx(mac, 100);
+    time_set(now_ms + 120000);
+    deauth_cnt = 0;
+    run_timeout();
+    TEST_ASSERT_EQ(deauth_cnt, CFG_STA_NUM / 2 - 1);
+    /* an evicted client is only deauthenticated once */
+    deauth_cnt = 0;
+    run_timeout();
+    TEST_ASSERT_EQ(deauth_cnt, 0);
+    time_set(now_ms + 300000);
+    run_timeout();
+    TEST_ASSERT_EQ(deauth_cnt, 1);
+    TEST_ASSERT_EQ(deauth_mac[0][5], 2);
+
+    wifi_sta_table_dump(-1);
+    wifi_sta_table_clear(1);
+    TEST_ASSERT_EQ(wifi_sta_table_list(-1, list, CFG_STA_NUM), 0);
+    run_timeout();
+    TEST_ASSERT(tmo_handler == NULL);
+    deauth_cnt = 0;
+    printf("basic: OK\n");
+}
+
+static struct sim_client *sim_find(const uint8_t *mac)
+{
+    int i;
+
+    for (i = 0; i < SIM_CLIENT_NUM; i++) {
+        if (!memcmp(clients[i].mac, mac, 6))
+            return &clients[i];
+    }
+    return NULL;
+}
+
+static void sim_assoc(struct sim_client *c, struct wifi_sta_table_stats *exp, int *assoc_num)
+{
+    int ret = wifi_sta_table_add(0, c->mac, c->aid, c->listen_interval);
+
+    if (c->assoc) {
+        /* reassociation */
+        exp->removed++;
+        (*assoc_num)--;
+    }
+    if (*assoc_num == CFG_STA_NUM) {
+        TEST_ASSERT_EQ(ret, -1);
+        exp->full++;
+        c->assoc = false;
+        return;
+    }
+    TEST_ASSERT_EQ(ret, 0);
+    exp->added++;
+    (*assoc_num)++;
+    c->assoc = true;
+    c->assoc_time = now_ms;
+    c->last_rx = 0;
+    c->rx_pkts = 0;
+    c->rx_bytes = 0;
+    c->tx_pkts = 0;
+    c->tx_fail = 0;
+}
+
+static void sim_check(struct sim_client *c)
+{
+    struct wifi_sta_info info;
+
+    if (!c->assoc) {
+        TEST_ASSERT_EQ(wifi_sta_table_get(c->mac, &info), -1);
+        return;
+    }
+    TEST_ASSERT_EQ(wifi_sta_table_get(c->mac, &info), 0);
+    TEST_ASSERT_EQ(info.aid, c->aid);
+    TEST_ASSERT_EQ(info.assoc_time, c->assoc_time);
+    TEST_ASSERT_EQ(info.last_rx, c->last_rx);
+    TEST_ASSERT_EQ(info.rx_pkts, c->rx_pkts);
+    TEST_ASSERT_EQ(info.rx_bytes, c->rx_bytes);
+    TEST_ASSERT_EQ(info.tx_pkts, c->tx_pkts);
+    TEST_ASSERT_EQ(info.tx_fail, c->tx_fail);
+    TEST_ASSERT_EQ(wifi_sta_table_get_by_aid(0, c->aid, &info), 0);
+    TEST_ASSERT(!memcmp(info.mac, c->mac, 6));
+}
+
+/*
+ * Clients join, talk, doze, leave and reassociate for two hours. Each deauthentication
+ * must hit a client idle for at least the timeout and its listen interval, and no client
+ * may stay idle for more than that plus one check period.
+ */
+static void sim_churn(void)
+{
+    struct wifi_sta_table_stats stats, exp = {0};
+    uint32_t idle_max = 0, timeout_ms, last;
+    int i, assoc_num = 0, evict_num = 0;
+    uint32_t t;
+
+    srand(48);
+    wifi_sta_table_stats_get(&stats, true);
+    wifi_sta_table_idle_timeout_set(SIM_IDLE_TIMEOUT_S);
+    for (i = 0; i < SIM_CLIENT_NUM; i++) {
+        mac_make(clients[i].mac, 100 + i);
+        clients[i].profile = i % 3;
+        clients[i].aid = i + 1;
+        clients[i].listen_interval = (i % 4) * 5;
+    }
+
+    for (t = 1000; t < SIM_END_MS; t += SIM_STEP_MS) {
+        time_set(t);
+        for (i = 0; i < SIM_CLIENT_NUM; i++) {
+            struct sim_client *c = &clients[i];
+            int r = rand() % 100000;
+
+            if (!c->assoc) {
+                if (r < 50)
+                    sim_assoc(c, &exp, &assoc_num);
+                continue;
+            }
+            if (r < 5) {
+                wifi_sta_table_del(c->mac);
+                exp.removed++;
+                assoc_num--;
+                c->assoc = false;
+                continue;
+            }
+            if (r < 8) {
+                sim_assoc(c, &exp, &assoc_num);
+                continue;
+            }
+            if (((c->profile == SIM_ACTIVE) && (r < 30000))
+                || ((c->profile == SIM_BURSTY) && (r < 180))) {
+                uint32_t len = 60 + rand() % 1440;
+
+                wifi_sta_table_rx(c->mac, len);
+                c->rx_pkts++;
+                c->rx_bytes += len;
+                c->last_rx = now_ms;
+            }
+            if ((c->profile != SIM_SILENT) && (r % 7 == 0)) {
+                bool ok = (r % 5) != 0;
+
+                wifi_sta_table_tx(c->mac, 1000, ok);
+                if (ok)
+                    c->tx_pkts++;
+                else
+                    c->tx_fail++;
+            }
+        }
+
+        if (tmo_handler && ((int32_t)(now_ms - tmo_at) >= 0)) {
+            deauth_cnt = 0;
+            run_timeout();
+            /* the SoftAP reports each deauthenticated client as removed */
+            for (i = 0; i < deauth_cnt; i++) {
+                struct sim_client *c = sim_find(deauth_mac[i]);
+
+                TEST_ASSERT(c && c->assoc);
+                last = c->last_rx ? c->last_rx : c->assoc_time;
+                timeout_ms = SIM_IDLE_TIMEOUT_S * 1000 + c->listen_interval * SIM_BEACON_MS;
+                TEST_ASSERT(now_ms - last >= timeout_ms);
+                wifi_sta_table_del(c->mac);
+                exp.removed++;
+                exp.evicted++;
+                assoc_num--;
+                c->assoc = false;
+                evict_num++;
+            }
+        }
+
+        for (i = 0; i < SIM_CLIENT_NUM; i++) {
+            struct sim_client *c = &clients[i];
+
+            if (!c->assoc)
+                continue;
+            last = c->last_rx ? c->last_rx : c->assoc_time;
+            timeout_ms = SIM_IDLE_TIMEOUT_S * 1000 + c->listen_interval * SIM_BEACON_MS;
+            TEST_ASSERT(now_ms - last < timeout_ms + WIFI_STA_TABLE_CHECK_MS + WIFI_STA_TABLE_CHECK_SLACK_MS + SIM_STEP_MS);
+            if (now_ms - last > idle_max)
+                idle_max = now_ms - last;
+        }
+        if ((t % 60000) == 0) {
+            for (i = 0; i < SIM_CLIENT_NUM; i++)
+                sim_check(&clients[i]);
+        }
+    }
+
+    for (i = 0; i < SIM_CLIENT_NUM; i++)
+        sim_check(&clients[i]);
+    wifi_sta_table_stats_get(&stats, false);
+    TEST_ASSERT_EQ(stats.added, exp.added);
+    TEST_ASSERT_EQ(stats.removed, exp.removed);
+    TEST_ASSERT_EQ(stats.evicted, exp.evicted);
+    TEST_ASSERT_EQ(stats.full, exp.full);
+    TEST_ASSERT(evict_num > 0);
+    TEST_ASSERT(exp.full > 0);
+    printf("churn: %u joins, %u leaves, %u evictions, %u rejected while full, longest idle %u ms: OK\n",
+           exp.added, exp.removed, exp.evicted, exp.full, idle_max);
+    wifi_sta_table_clear(0);
+}
+
+/*
+ * Cost of the per frame accounting with a full table, against the linear MAC
+ * scan the data path would need without the hash.
+ */
+static void bench_lookup(void)
+{
+    static uint8_t macs[CFG_STA_NUM][6];
+    volatile int sink = 0;
+    uint64_t t0, t1, t2;
+    uint8_t mac[6];
+    int i, j;
+
+    for (i = 0; i < CFG_STA_NUM; i++) {
+        mac_make(macs[i], i + 1);
+        TEST_ASSERT_EQ(wifi_sta_table_add(1, macs[i], i + 1, 10), 0);
+    }
+
+    t0 = host_time_ns();
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        mac_make(mac, (i % CFG_STA_NUM) + 1);
+        wifi_sta_table_rx(mac, 100);
+    }
+    t1 = host_time_ns();
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        mac_make(mac, (i % CFG_STA_NUM) + 1);
+        for (j = 0; j < CFG_STA_NUM; j++) {
+            if (!memcmp(macs[j], mac, 6)) {
+                sink += j;
+                break;
+            }
+        }
+    }
+    t2 = host_time_ns();
+
+    printf("bench: hashed rx accounting %.1f ns/frame, linear MAC scan %.1f ns/lookup, %d clients\n",
+           (double)(t1 - t0) / BENCH_LOOPS, (double)(t2 - t1) / BENCH_LOOPS, CFG_STA_NUM);
+    wifi_sta_table_clear(1);
+}
+
+int main(void)
+{
+    test_basic();
+    sim_churn();
+    bench_lookup();
+    return 0;
+}
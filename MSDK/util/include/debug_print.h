@@ -38,6 +38,10 @@ OF SUCH DAMAGE.
 #include <stdarg.h>
 #include <stdint.h>
 
+// co_printf only records the format string address and the raw arguments, the text is
+// rebuilt on the host by scripts/logtool/logdecode.py from the ELF of the image
+//#define CONFIG_PRINT_DEFERRED
+
 #define ERROR_LEVEL         1
 #define WARNING_LEVEL       2
 #define INFO_LEVEL          3
@@ -58,6 +62,9 @@ int co_printf(const char *format, ...);
 int co_snprintf(char *out, int space, const char *format, ...);
 int print_buffer(unsigned long addr, void *data, unsigned long width, unsigned long count, unsigned long linelen);
 int print(char **out, const char *format, va_list args, int space);
+#ifdef CONFIG_PRINT_DEFERRED
+void co_printf_bench(uint32_t count);
+#endif
 
 /**
  ****************************************************************************************
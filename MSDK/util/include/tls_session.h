@@ -0,0 +1,152 @@
+/*!
+    \file    tls_session.h
+    \brief   Declaration for TLS client session cache.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _TLS_SESSION_H_
+#define _TLS_SESSION_H_
+
+#include "util_config.h"
+#include <stdint.h>
+#include "mbedtls/version.h"
+
+/* Session export and import, and handshake steps, are used as in mbedtls 3.6 */
+#if defined(CFG_TLS_SESSION_CACHE) && (MBEDTLS_VERSION_NUMBER < 0x03060000)
+#undef CFG_TLS_SESSION_CACHE
+#endif
+
+#ifdef CFG_TLS_SESSION_CACHE
+#include "mbedtls/ssl.h"
+
+/* Number of host:port sessions kept in RAM */
+#define TLS_SESSION_CACHE_NUM           4
+/* Maximum length of a host name, including the terminating null */
+#define TLS_SESSION_HOST_LEN            64
+/* Sessions older than this are not offered anymore, in seconds */
+#define TLS_SESSION_EXPIRE_S            (2 * 3600)
+/* Number of client connections followed at the same time */
+#define TLS_SESSION_CONN_NUM            4
+
+/* TLS 1.3 sessions come as tickets after the handshake */
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_SESSION_TICKETS)
+#define TLS_SESSION_TLS13_TICKET
+#endif
+
+/* handshake types */
+#define TLS_HS_FULL                     0
+#define TLS_HS_RESUMED                  1
+#define TLS_HS_TYPE_NUM                 2
+
+/* handshake cost of one type */
+typedef struct {
+    uint32_t cnt;                   // completed handshakes
+    uint32_t time_sum_ms;           // total handshake time
+    uint32_t time_max_ms;           // longest handshake
+    uint32_t heap_sum;              // total of the heap peaks
+    uint32_t heap_max;              // largest heap peak
+} tls_hs_stats_t;
+
+/* session cache statistics */
+typedef struct {
+    tls_hs_stats_t hs[TLS_HS_TYPE_NUM];
+    uint32_t fail_cnt;              // handshakes failed or dropped before the end
+    uint32_t hit_cnt;               // connections offered a cached session
+    uint32_t miss_cnt;              // connections without a usable session
+    uint32_t reject_cnt;            // offered sessions the server did not resume
+    uint32_t expire_cnt;            // sessions dropped because too old
+    uint32_t store_cnt;             // new sessions kept
+    uint32_t stats_ms;              // time covered by the statistics
+} tls_session_stats_t;
+
+/*!
+    \brief      start following a client connection and offer the cached session of its server
+                Note: call it after mbedtls_ssl_setup and before the first handshake step.
+    \param[in]  ssl: ssl context of the connection
+    \param[in]  host: host name or address of the server
+    \param[in]  port: port of the server
+    \param[out] none
+    \retval     1 if a cached session was offered, 0 if not, -1 if the connection is not followed
+*/
+int tls_session_begin(mbedtls_ssl_context *ssl, const char *host, uint16_t port);
+
+/*!
+    \brief      perform the handshake, as mbedtls_ssl_handshake, and account its cost
+                Note: contexts that were not passed to tls_session_begin just run mbedtls_ssl_handshake.
+    \param[in]  ssl: ssl context of the connection
+    \param[out] none
+    \retval     return value of mbedtls_ssl_handshake
+*/
+int tls_session_handshake(mbedtls_ssl_context *ssl);
+
+/*!
+    \brief      keep the session of a MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET event
+    \param[in]  ssl: ssl context of the connection
+    \param[out] none
+    \retval     none
+*/
+void tls_session_ticket(mbedtls_ssl_context *ssl);
+
+/*!
+    \brief      stop following a connection, call it before mbedtls_ssl_free
+    \param[in]  ssl: ssl context of the connection
+    \param[out] none
+    \retval     none
+*/
+void tls_session_end(mbedtls_ssl_context *ssl);
+
+/*!
+    \brief      forget the session of a server
+    \param[in]  host: host name or address of the server
+    \param[in]  port: port of the server
+    \param[out] none
+    \retval     none
+*/
+void tls_session_remove(const char *host, uint16_t port);
+
+/*!
+    \brief      forget all the sessions
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void tls_session_flush(void);
+
+/*!
+    \brief      get the session cache statistics
+    \param[in]  reset: restart the statistics after reading them
+    \param[out] stats: the statistics
+    \retval     none
+*/
+void tls_session_stats_get(tls_session_stats_t *stats, int reset);
+#endif /* CFG_TLS_SESSION_CACHE */
+
+#endif /* _TLS_SESSION_H_ */
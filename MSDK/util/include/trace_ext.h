@@ -537,4 +537,44 @@ uint16_t trace_print(uint16_t max_bytes);
 
 void trace_dma_print(void);
 
+/**
+ * \name    TRACE_SOURCE
+ * \brief   Producers accounted separately by the trace ring.
+ * \anchor  TRACE_SOURCE
+ */
+enum trace_source
+{
+    TRACE_SRC_BLE = 0,
+    TRACE_SRC_WIFI,
+    TRACE_SRC_BTSNOOP,
+    TRACE_SRC_CONSOLE,
+    TRACE_SRC_NUM
+};
+
+/* Trace ring accounting, indexed by @ref TRACE_SOURCE */
+struct trace_ring_stats
+{
+    // Logs written to the ring
+    uint32_t rec_cnt[TRACE_SRC_NUM];
+    // Logs refused because the ring was full
+    uint32_t drop_cnt[TRACE_SRC_NUM];
+    // Logs not yet sent and discarded to make room (loop mode only)
+    uint32_t overwrite_cnt[TRACE_SRC_NUM];
+    // Highest ring occupation seen, in bytes
+    uint32_t used_max;
+    // Current ring occupation and size, in bytes
+    uint32_t used;
+    uint32_t size;
+};
+
+/**
+ ******************************************************************************
+ * @brief Get trace ring counters.
+ *
+ * @param[out] stats  Counters since init or since the last reset
+ * @param[in]  reset  Clear the counters after reading them
+ ******************************************************************************
+ */
+void trace_ring_stats_get(struct trace_ring_stats *stats, bool reset);
+
 #endif /* _TRACE_EXT_H_ */
@@ -48,4 +48,8 @@ OF SUCH DAMAGE.
 #endif
 #endif /* CFG_GD_TRACE_EXT */
 
+/* Keep the TLS client sessions by host:port in RAM to resume them on reconnection.
+   They hold the master secrets and are not written to flash. */
+//#define CFG_TLS_SESSION_CACHE
+
 #endif /* _UTIL_CONFIG_H_ */
@@ -117,6 +117,26 @@ static int print_task_init = 0;
 static int w_point = 0, r_point = 0, used_len = 0;
 #endif
 
+#ifdef CONFIG_PRINT_DEFERRED
+// must be a power of 2
+#define DLOG_BUF_LEN            4096
+// record: sync, length, sequence, format address (LE), arguments, checksum
+// length counts sequence to arguments, checksum is the xor of the same bytes
+#define DLOG_SYNC               0xA5
+#define DLOG_HDR_LEN            7
+#define DLOG_RECORD_MAX         128
+// longest string argument recorded, longer ones are truncated
+#define DLOG_STR_MAX            32
+#define PRINT_BENCH_STACK_SIZE  512
+static uint8_t dlog_buf[DLOG_BUF_LEN];
+// free running indexes
+static uint32_t dlog_wr = 0, dlog_rd = 0;
+// the sequence also counts dropped records, so the decoder can report gaps
+static uint8_t dlog_seq = 0;
+static os_sema_t dlog_sema;
+static int dlog_task_init = 0;
+#endif
+
 static void printchar(char **str, int c, int *space)
 {
     if (!str) {
@@ -371,29 +391,177 @@ static void print_task_handle(void *argv)
 #endif
 
 
-int co_printf(const char *format, ...)
+#ifdef CONFIG_PRINT_DEFERRED
+static void dlog_task_handle(void *argv)
+{
+    uint32_t rd, avail, chunk;
+#ifdef LOG_UART
+    uint32_t i;
+#endif
+
+    do {
+        sys_sema_down(&dlog_sema, 0);
+        while ((avail = dlog_wr - dlog_rd) > 0) {
+            rd = dlog_rd & (DLOG_BUF_LEN - 1);
+            chunk = (avail < (DLOG_BUF_LEN - rd)) ? avail : (DLOG_BUF_LEN - rd);
+#ifdef LOG_UART
+            for (i = 0; i < chunk; i++)
+                log_uart_putc_noint(dlog_buf[rd + i]);
+#else
+            trace_console(chunk, &dlog_buf[rd]);
+#endif
+            sys_enter_critical();
+            dlog_rd += chunk;
+            sys_exit_critical();
+        }
+    } while(1);
+}
+
+/* walk the format the same way as print() and copy what each conversion would read */
+static int dlog_args_pack(uint8_t *buf, int space, const char *format, va_list args)
+{
+    uint8_t *p = buf;
+    const uint8_t *src;
+    uint32_t val;
+    int len;
+
+    for (; *format != 0; ++format) {
+        if (*format != '%')
+            continue;
+
+        ++format;
+        if (*format == '\0')
+            break;
+        if (*format == '%')
+            continue;
+        if (*format == '-')
+            ++format;
+        while (*format == '0')
+            ++format;
+        while (*format >= '0' && *format <= '9')
+            ++format;
+
+        if (*format == 's') {
+            /* the string may be gone when the record is decoded */
+            src = (const uint8_t *)va_arg(args, int);
+            if (!src)
+                src = (const uint8_t *)"(null)";
+            for (len = 0; (len < DLOG_STR_MAX) && src[len]; len++);
+            if (space < len + 1)
+                break;
+            *p++ = len;
+            sys_memcpy(p, src, len);
+            p += len;
+            space -= len + 1;
+            continue;
+        }
+
+        if ((*format == 'p') && ((format[1] == 'M') || (format[1] == 'I'))) {
+            len = (*++format == 'M') ? 6 : 4;
+            src = (const uint8_t *)va_arg(args, int);
+            if (space < len)
+                break;
+            sys_memcpy(p, src, len);
+            p += len;
+            space -= len;
+            continue;
+        }
+
+        if ((*format != 'd') && (*format != 'p') && (*format != 'x') && (*format != 'X')) {
+            if (*format == 'z')
+                ++format;
+            if (*format == '\0')
+                break;
+            /* print() reads no argument for the other conversions */
+            if ((*format != 'u') && (*format != 'c'))
+                continue;
+        }
+
+        val = (uint32_t)va_arg(args, int);
+        if (space < 4)
+            break;
+        *p++ = val & 0xFF;
+        *p++ = (val >> 8) & 0xFF;
+        *p++ = (val >> 16) & 0xFF;
+        *p++ = (val >> 24) & 0xFF;
+        space -= 4;
+    }
+
+    return p - buf;
+}
+
+static int dlog_record(const char *format, va_list args)
+{
+    uint8_t rec[DLOG_RECORD_MAX];
+    uint32_t addr = (uint32_t)format;
+    uint32_t wr;
+    uint8_t chk = 0;
+    int len, first, i;
+
+    if (dlog_task_init == 0) {
+        sys_enter_critical();
+        if (dlog_task_init == 0) {
+            sys_sema_init(&dlog_sema, 0);
+            sys_task_create_dynamic((const uint8_t *)"Print", 512,
+                 (OS_TASK_PRIO_IDLE + TASK_PRIO_HIGHER(1)), dlog_task_handle, NULL);
+            dlog_task_init = 1;
+        }
+        sys_exit_critical();
+    }
+
+    rec[0] = DLOG_SYNC;
+    rec[3] = addr & 0xFF;
+    rec[4] = (addr >> 8) & 0xFF;
+    rec[5] = (addr >> 16) & 0xFF;
+    rec[6] = (addr >> 24) & 0xFF;
+    len = DLOG_HDR_LEN + dlog_args_pack(&rec[DLOG_HDR_LEN], DLOG_RECORD_MAX - DLOG_HDR_LEN - 1, format, args);
+    rec[1] = len - 2;
+    for (i = 3; i < len; i++)
+        chk ^= rec[i];
+
+    /* the sequence and the copy are under the same critical section to keep records in order */
+    sys_enter_critical();
+    rec[2] = dlog_seq++;
+    rec[len] = chk ^ rec[2];
+    len++;
+    if ((DLOG_BUF_LEN - (dlog_wr - dlog_rd)) >= (uint32_t)len) {
+        wr = dlog_wr & (DLOG_BUF_LEN - 1);
+        first = ((DLOG_BUF_LEN - wr) < (uint32_t)len) ? (DLOG_BUF_LEN - wr) : len;
+        sys_memcpy(&dlog_buf[wr], rec, first);
+        sys_memcpy(&dlog_buf[0], &rec[first], len - first);
+        dlog_wr += len;
+    } else {
+        /* ring is full, the record is dropped */
+        len = 0;
+    }
+    sys_exit_critical();
+
+    if (len)
+        sys_sema_up(&dlog_sema);
+
+    return len;
+}
+#endif
+
+static int co_vprintf_text(const char *format, va_list args)
 {
 #if (!defined(CONFIG_PRINT_IN_SEQUENCE) | !defined(LOG_UART))
     int ret;
 #ifndef LOG_UART
     char out[1024], *pout = &out[0];
 #endif
-    va_list args;
 
-    va_start(args, format);
 #ifndef LOG_UART
     ret = print(&pout, format, args, 1024);
     trace_console(ret, (uint8_t *)out);
 #else
     ret = print(0, format, args, 0);
 #endif
-    va_end(args);
 
     return ret;
 #else
     char out[1024], *pout = &out[0];
     char len = 0;
-    va_list args;
     int cur_wp = 0;
     int pc = 0;
 
@@ -408,9 +576,7 @@ int co_printf(const char *format, ...)
         sys_exit_critical();
     }
 
-    va_start(args, format);
     pc = print(&pout, format, args, 1024);
-    va_end(args);
 
     len = strlen(out);
     if (len < (MAX_BUF_LEN - used_len)) {
@@ -440,6 +606,98 @@ int co_printf(const char *format, ...)
 #endif    // CONFIG_PRINT_IN_SEQUENCE end
 }
 
+int co_printf(const char *format, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, format);
+#ifdef CONFIG_PRINT_DEFERRED
+    ret = dlog_record(format, args);
+#else
+    ret = co_vprintf_text(format, args);
+#endif
+    va_end(args);
+
+    return ret;
+}
+
+#ifdef CONFIG_PRINT_DEFERRED
+struct print_bench {
+    os_sema_t done;
+    uint32_t count;
+    int deferred;
+    uint32_t cycles;
+    uint32_t stack_free;
+};
+
+static int co_printf_text(const char *format, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, format);
+    ret = co_vprintf_text(format, args);
+    va_end(args);
+
+    return ret;
+}
+
+static void print_bench_task(void *argv)
+{
+    struct print_bench *bench = (struct print_bench *)argv;
+    uint64_t start;
+    uint32_t i;
+
+    start = __get_rv_cycle();
+    for (i = 0; i < bench->count; i++) {
+        if (bench->deferred)
+            co_printf("print bench %d/%u: %s %08x\r\n", i, bench->count, "deferred", (uint32_t)bench);
+        else
+            co_printf_text("print bench %d/%u: %s %08x\r\n", i, bench->count, "text", (uint32_t)bench);
+    }
+    bench->cycles = (uint32_t)((__get_rv_cycle() - start) / bench->count);
+    bench->stack_free = sys_stack_free_get(NULL);
+
+    sys_sema_up(&bench->done);
+    sys_task_delete(NULL);
+}
+
+/* run each path in a fresh task so that its stack high water mark is its own */
+void co_printf_bench(uint32_t count)
+{
+    struct print_bench bench;
+    uint32_t cycles[2], stack[2];
+    int deferred;
+
+    if (count == 0)
+        count = 1;
+    if (sys_sema_init(&bench.done, 0))
+        return;
+
+    __enable_mcycle_counter();
+    for (deferred = 0; deferred < 2; deferred++) {
+        bench.count = count;
+        bench.deferred = deferred;
+        if (sys_task_create_dynamic((const uint8_t *)"print bench", PRINT_BENCH_STACK_SIZE,
+                                    OS_TASK_PRIORITY(1), print_bench_task, &bench) == NULL) {
+            co_printf_text("print bench: task create failed\r\n");
+            goto exit;
+        }
+        sys_sema_down(&bench.done, 0);
+        cycles[deferred] = bench.cycles;
+        stack[deferred] = (PRINT_BENCH_STACK_SIZE - bench.stack_free) * sizeof(uint32_t);
+    }
+
+    co_printf_text("print bench: %u calls\r\n", count);
+    co_printf_text("  text:     %u cycles/call, %u bytes stack\r\n", cycles[0], stack[0]);
+    co_printf_text("  deferred: %u cycles/call, %u bytes stack\r\n", cycles[1], stack[1]);
+exit:
+    __disable_mcycle_counter();
+    sys_sema_free(&bench.done);
+}
+#endif
+
 int co_snprintf(char *out, int space, const char *format, ...)
 {
     int ret = 0;
@@ -0,0 +1,532 @@
+/*!
+    \file    tls_session.c
+    \brief   TLS client session cache for GD32VW55x SDK.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "tls_session.h"
+
+#ifdef CFG_TLS_SESSION_CACHE
+#include "wrapper_os.h"
+#include "dbg_print.h"
+
+/* Session of a server, as serialized by mbedtls_ssl_session_save */
+struct tls_session_entry
+{
+    char host[TLS_SESSION_HOST_LEN];
+    uint16_t port;
+    uint16_t len;                   // length of data, 0 when the entry is free
+    uint32_t saved_ms;              // time the session was received
+    uint32_t used_ms;               // time of the last offer, the oldest entry is replaced first
+    uint8_t *data;
+};
+
+/* Client connection between tls_session_begin and tls_session_end */
+struct tls_session_conn
+{
+    mbedtls_ssl_context *ssl;       // NULL when the slot is free
+    char host[TLS_SESSION_HOST_LEN];
+    uint16_t port;
+    uint8_t offered;                // a cached session was given to mbedtls
+    uint8_t cert_seen;              // the handshake went through the server certificate
+    uint8_t started;                // the first handshake step ran
+    uint8_t done;                   // the handshake is over and accounted
+    uint32_t start_ms;
+    int32_t start_free;             // free heap before the first handshake step
+    int32_t start_min_free;         // minimum ever free heap at the same time
+    int32_t low_free;               // lowest free heap seen after a handshake step
+};
+
+static struct tls_session_entry tls_sess_cache[TLS_SESSION_CACHE_NUM];
+static struct tls_session_conn tls_sess_conn[TLS_SESSION_CONN_NUM];
+static tls_session_stats_t tls_sess_stats;
+static uint32_t tls_sess_stats_start;
+static os_mutex_t tls_sess_mutex;
+
+/*!
+    \brief      take the session cache mutex, create it on first use
+    \param[in]  none
+    \param[out] none
+    \retval     0 on success, -1 if the mutex could not be created
+*/
+static int tls_session_lock(void)
+{
+    os_mutex_t mutex = NULL;
+
+    if (tls_sess_mutex == NULL) {
+        if (sys_mutex_init(&mutex) != OS_OK)
+            return -1;
+        sys_enter_critical();
+        if (tls_sess_mutex == NULL) {
+            tls_sess_mutex = mutex;
+            mutex = NULL;
+        }
+        sys_exit_critical();
+        // another task created it first
+        if (mutex)
+            sys_mutex_free(&mutex);
+    }
+
+    sys_mutex_get(&tls_sess_mutex);
+    return 0;
+}
+
+/*!
+    \brief      release the session cache mutex
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void tls_session_unlock(void)
+{
+    sys_mutex_put(&tls_sess_mutex);
+}
+
+/*!
+    \brief      find the connection slot of an ssl context
+    \param[in]  ssl: ssl context of the connection
+    \param[out] none
+    \retval     the connection slot, NULL if the context is not followed
+*/
+static struct tls_session_conn *tls_session_conn_find(mbedtls_ssl_context *ssl)
+{
+    int i;
+
+    for (i = 0; i < TLS_SESSION_CONN_NUM; i++) {
+        if (tls_sess_conn[i].ssl == ssl)
+            return &tls_sess_conn[i];
+    }
+
+    return NULL;
+}
+
+/*!
+    \brief      find the cached session of a server, the mutex must be held
+    \param[in]  host: host name or address of the server
+    \param[in]  port: port of the server
+    \param[out] none
+    \retval     the cache entry, NULL if there is none
+*/
+static struct tls_session_entry *tls_session_entry_find(const char *host, uint16_t port)
+{
+    struct tls_session_entry *e;
+    int i;
+
+    for (i = 0; i < TLS_SESSION_CACHE_NUM; i++) {
+        e = &tls_sess_cache[i];
+        if (e->len && e->port == port && !strcmp(e->host, host))
+            return e;
+    }
+
+    return NULL;
+}
+
+/*!
+    \brief      free a cache entry, the mutex must be held
+    \param[in]  e: the cache entry
+    \param[out] none
+    \retval     none
+*/
+static void tls_session_entry_del(struct tls_session_entry *e)
+{
+    sys_mfree(e->data);
+    sys_memset(e, 0, sizeof(*e));
+}
+
+/*!
+    \brief      put a session in the cache, replacing the least recently used one if full,
+                the mutex must be held
+    \param[in]  host: host name or address of the server
+    \param[in]  port: port of the server
+    \param[in]  data: serialized session, owned by the cache afterwards
+    \param[in]  len: length of the serialized session
+    \param[out] none
+    \retval     the cache entry
+*/
+static struct tls_session_entry *tls_session_entry_set(const char *host, uint16_t port,
+                                                       uint8_t *data, uint16_t len)
+{
+    uint32_t now = sys_current_time_get();
+    struct tls_session_entry *e, *victim = NULL;
+    int i;
+
+    e = tls_session_entry_find(host, port);
+    if (e == NULL) {
+        for (i = 0; i < TLS_SESSION_CACHE_NUM; i++) {
+            e = &tls_sess_cache[i];
+            if (e->len == 0)
+                break;
+            if (victim == NULL || (now - e->used_ms) > (now - victim->used_ms))
+                victim = e;
+        }
+        if (i == TLS_SESSION_CACHE_NUM)
+            e = victim;
+    }
+
+    if (e->len)
+        tls_session_entry_del(e);
+
+    strcpy(e->host, host);
+    e->port = port;
+    e->len = len;
+    e->data = data;
+    e->saved_ms = now;
+    e->used_ms = now;
+
+    return e;
+}
+
+/*!
+    \brief      keep the current session of a connection, the mutex must be held
+    \param[in]  conn: the connection
+    \param[out] none
+    \retval     none
+*/
+static void tls_session_save(struct tls_session_conn *conn)
+{
+    mbedtls_ssl_session session;
+    struct tls_session_entry *e;
+    uint8_t *data = NULL;
+    size_t len = 0;
+
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_get_session(conn->ssl, &session) != 0)
+        goto end;
+
+    if (mbedtls_ssl_session_save(&session, NULL, 0, &len) != MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL ||
+        len == 0 || len > 0xFFFF)
+        goto end;
+    data = sys_malloc(len);
+    if (data == NULL)
+        goto end;
+    if (mbedtls_ssl_session_save(&session, data, len, &len) != 0)
+        goto end;
+
+    e = tls_session_entry_find(conn->host, conn->port);
+    if (e && e->len == len && !memcmp(e->data, data, len))
+        goto end;
+
+    e = tls_session_entry_set(conn->host, conn->port, data, len);
+    data = NULL;
+    tls_sess_stats.store_cnt++;
+
+end:
+    if (data)
+        sys_mfree(data);
+    mbedtls_ssl_session_free(&session);
+}
+
+/*!
+    \brief      account a finished handshake and keep its session
+    \param[in]  conn: the connection
+    \param[in]  ret: return value of the last handshake step
+    \param[out] none
+    \retval     none
+*/
+static void tls_session_hs_done(struct tls_session_conn *conn, int ret)
+{
+    struct tls_session_entry *e;
+    tls_hs_stats_t *hs;
+    uint32_t time_ms, heap = 0;
+    int32_t min_free;
+    int type;
+
+    conn->done = 1;
+    time_ms = sys_current_time_get() - conn->start_ms;
+    if (conn->low_free < conn->start_free)
+        heap = conn->start_free - conn->low_free;
+    // samples are taken between steps, the minimum ever free heap also catches
+    // a peak inside a step when it is a new low
+    min_free = sys_min_free_heap_size();
+    if (min_free < conn->start_min_free && (uint32_t)(conn->start_free - min_free) > heap)
+        heap = conn->start_free - min_free;
+
+    if (tls_session_lock())
+        return;
+
+    if (ret != 0) {
+        tls_sess_stats.fail_cnt++;
+        // do not offer it again, the next connection does a full handshake
+        if (conn->offered) {
+            e = tls_session_entry_find(conn->host, conn->port);
+            if (e)
+                tls_session_entry_del(e);
+        }
+        goto end;
+    }
+
+    // a resumed handshake skips the server certificate, in TLS 1.2 and TLS 1.3
+    type = (conn->offered && !conn->cert_seen) ? TLS_HS_RESUMED : TLS_HS_FULL;
+    if (conn->offered && type == TLS_HS_FULL)
+        tls_sess_stats.reject_cnt++;
+
+    hs = &tls_sess_stats.hs[type];
+    hs->cnt++;
+    hs->time_sum_ms += time_ms;
+    if (time_ms > hs->time_max_ms)
+        hs->time_max_ms = time_ms;
+    hs->heap_sum += heap;
+    if (heap > hs->heap_max)
+        hs->heap_max = heap;
+
+    // TLS 1.3 sessions are kept when their ticket arrives
+    if (mbedtls_ssl_get_version_number(conn->ssl) != MBEDTLS_SSL_VERSION_TLS1_3)
+        tls_session_save(conn);
+
+end:
+    tls_session_unlock();
+}
+
+/*!
+    \brief      start following a client connection and offer the cached session of its server
+                Note: call it after mbedtls_ssl_setup and before the first handshake step.
+    \param[in]  ssl: ssl context of the connection
+    \param[in]  host: host name or address of the server
+    \param[in]  port: port of the server
+    \param[out] none
+    \retval     1 if a cached session was offered, 0 if not, -1 if the connection is not followed
+*/
+int tls_session_begin(mbedtls_ssl_context *ssl, const char *host, uint16_t port)
+{
+    struct tls_session_conn *conn;
+    struct tls_session_entry *e;
+    mbedtls_ssl_session session;
+    uint32_t now;
+    int ret = 0;
+
+    if (ssl == NULL || host == NULL || strlen(host) >= TLS_SESSION_HOST_LEN)
+        return -1;
+    if (tls_session_lock())
+        return -1;
+
+    // a context freed without tls_session_end may come back at the same address
+    conn = tls_session_conn_find(ssl);
+    if (conn == NULL)
+        conn = tls_session_conn_find(NULL);
+    if (conn == NULL) {
+        tls_session_unlock();
+        return -1;
+    }
+
+    sys_memset(conn, 0, sizeof(*conn));
+    conn->ssl = ssl;
+    strcpy(conn->host, host);
+    conn->port = port;
+
+    now = sys_current_time_get();
+    e = tls_session_entry_find(host, port);
+    if (e && (now - e->saved_ms) >= TLS_SESSION_EXPIRE_S * 1000) {
+        tls_session_entry_del(e);
+        tls_sess_stats.expire_cnt++;
+        e = NULL;
+    }
+
+    if (e) {
+        mbedtls_ssl_session_init(&session);
+        if (mbedtls_ssl_session_load(&session, e->data, e->len) == 0 &&
+            mbedtls_ssl_set_session(ssl, &session) == 0) {
+            conn->offered = 1;
+            e->used_ms = now;
+            ret = 1;
+        } else {
+            // saved by another mbedtls build or configuration
+            tls_session_entry_del(e);
+        }
+        mbedtls_ssl_session_free(&session);
+    }
+
+    if (ret)
+        tls_sess_stats.hit_cnt++;
+    else
+        tls_sess_stats.miss_cnt++;
+
+    tls_session_unlock();
+    return ret;
+}
+
+/*!
+    \brief      perform the handshake, as mbedtls_ssl_handshake, and account its cost
+                Note: contexts that were not passed to tls_session_begin just run mbedtls_ssl_handshake.
+    \param[in]  ssl: ssl context of the connection
+    \param[out] none
+    \retval     return value of mbedtls_ssl_handshake
+*/
+int tls_session_handshake(mbedtls_ssl_context *ssl)
+{
+    struct tls_session_conn *conn = tls_session_conn_find(ssl);
+    int32_t free_size;
+    int ret = 0;
+
+    if (ssl == NULL || conn == NULL || conn->done)
+        return mbedtls_ssl_handshake(ssl);
+
+    if (!conn->started) {
+        conn->started = 1;
+        conn->start_ms = sys_current_time_get();
+        conn->start_free = sys_free_heap_size();
+        conn->start_min_free = sys_min_free_heap_size();
+        conn->low_free = conn->start_free;
+    }
+
+    // the steps of mbedtls_ssl_handshake, one at a time to see the states and sample the heap
+    while (!mbedtls_ssl_is_handshake_over(ssl)) {
+        if (ssl->MBEDTLS_PRIVATE(state) == MBEDTLS_SSL_SERVER_CERTIFICATE)
+            conn->cert_seen = 1;
+
+        ret = mbedtls_ssl_handshake_step(ssl);
+
+        free_size = sys_free_heap_size();
+        if (free_size < conn->low_free)
+            conn->low_free = free_size;
+
+        if (ret != 0)
+            break;
+    }
+
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE ||
+        ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS || ret == MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS)
+        return ret;
+
+    tls_session_hs_done(conn, ret);
+    return ret;
+}
+
+/*!
+    \brief      keep the session of a MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET event
+    \param[in]  ssl: ssl context of the connection
+    \param[out] none
+    \retval     none
+*/
+void tls_session_ticket(mbedtls_ssl_context *ssl)
+{
+    struct tls_session_conn *conn = tls_session_conn_find(ssl);
+
+    if (ssl == NULL || conn == NULL || !conn->done)
+        return;
+    if (tls_session_lock())
+        return;
+
+    tls_session_save(conn);
+    tls_session_unlock();
+}
+
+/*!
+    \brief      stop following a connection, call it before mbedtls_ssl_free
+    \param[in]  ssl: ssl context of the connection
+    \param[out] none
+    \retval     none
+*/
+void tls_session_end(mbedtls_ssl_context *ssl)
+{
+    struct tls_session_conn *conn = tls_session_conn_find(ssl);
+
+    if (ssl == NULL || conn == NULL)
+        return;
+    if (tls_session_lock())
+        return;
+
+    // closed in the middle of the handshake
+    if (conn->started && !conn->done)
+        tls_sess_stats.fail_cnt++;
+    conn->ssl = NULL;
+
+    tls_session_unlock();
+}
+
+/*!
+    \brief      forget the session of a server
+    \param[in]  host: host name or address of the server
+    \param[in]  port: port of the server
+    \param[out] none
+    \retval     none
+*/
+void tls_session_remove(const char *host, uint16_t port)
+{
+    struct tls_session_entry *e;
+
+    if (host == NULL || tls_session_lock())
+        return;
+
+    e = tls_session_entry_find(host, port);
+    if (e)
+        tls_session_entry_del(e);
+
+    tls_session_unlock();
+}
+
+/*!
+    \brief      forget all the sessions
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void tls_session_flush(void)
+{
+    int i;
+
+    if (tls_session_lock())
+        return;
+
+    for (i = 0; i < TLS_SESSION_CACHE_NUM; i++) {
+        if (tls_sess_cache[i].len)
+            tls_session_entry_del(&tls_sess_cache[i]);
+    }
+
+    tls_session_unlock();
+}
+
+/*!
+    \brief      get the session cache statistics
+    \param[in]  reset: restart the statistics after reading them
+    \param[out] stats: the statistics
+    \retval     none
+*/
+void tls_session_stats_get(tls_session_stats_t *stats, int reset)
+{
+    uint32_t now = sys_current_time_get();
+
+    if (tls_session_lock()) {
+        sys_memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    *stats = tls_sess_stats;
+    stats->stats_ms = now - tls_sess_stats_start;
+    if (reset) {
+        sys_memset(&tls_sess_stats, 0, sizeof(tls_sess_stats));
+        tls_sess_stats_start = now;
+    }
+
+    tls_session_unlock();
+}
+#endif /* CFG_TLS_SESSION_CACHE */
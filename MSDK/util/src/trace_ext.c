@@ -181,11 +181,35 @@ extern uint32_t _etrace[];
 static uint8_t *trace_start = (uint8_t *)_trace;
 static uint32_t TRACE_SIZE_MAX = 0x4000;
 
+/*
+ * The ring is split by four byte offsets, in ring order:
+ *   rec_start <= trace_start <= trace_commit <= trace_end
+ * [rec_start, trace_start) drained bytes of a log not fully sent yet, kept so
+ *                          that loop mode can still parse it
+ * [trace_start, commit)    complete logs waiting for the UART
+ * [commit, trace_end)      reserved by writers still copying their log
+ */
+struct trace_wr {
+    // write offset inside the reserved region
+    uint32_t pos;
+    // time stamp taken at reservation so it follows the ring order
+    uint64_t ts;
+    uint8_t seqno;
+};
+
 struct trace_env_tag {
-    // Index (in 16bits word) of the first trace within the trace buffer
+    // Offset of the first log segment still (partially) in the trace buffer
+    volatile uint32_t rec_start;
+    // Offset of the next byte to send to the UART
     volatile uint32_t trace_start;
-    // Index (in 16bits word) of the last trace within the trace buffer
+    // Offset up to which all logs are complete
+    volatile uint32_t trace_commit;
+    // Offset of the end of the last reservation
     volatile uint32_t trace_end;
+    // Number of writers between reserve and commit
+    volatile uint8_t writers;
+    // Bytes handed to the UART (polled or DMA) and not released yet
+    volatile uint16_t tx_bytes;
     //sequence number
     volatile uint8_t seqno;
     volatile uint8_t btsnoop_seqno;
@@ -196,9 +220,7 @@ struct trace_env_tag {
     volatile bool task_sleep;
 #endif
 
-#ifdef TRACE_UART_DMA
-    volatile uint16_t dma_send_bytes;
-#endif
+    struct trace_ring_stats stats;
 };
 static struct trace_env_tag trace_env;
 
@@ -208,6 +230,8 @@ static uint8_t ble_trace_mask[(MODULE_NUM + 1)/2] = {0};
  * FUNCTION DEFINITIONS
  ******************************************************************************
  */
+static uint32_t trace_room_left(void);
+
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
 static void task_notify_with_isr_check(os_task_t task_handler)
 {
@@ -229,7 +253,7 @@ static void priority_adjust_task(void *argv)
     priority_adjust_task_handle = (os_task_t)xTaskGetCurrentTaskHandle();
     for (;;)
     {
-        room_left = (trace_env.trace_start + TRACE_SIZE_MAX - (trace_env.trace_end + 1)) % TRACE_SIZE_MAX;
+        room_left = trace_room_left();
         if(room_left < sched_low_level && trace_env.trace_priority == 0)
         {
             trace_env.trace_priority = TRACE_PRIORITY_MAX;
@@ -254,7 +278,7 @@ static void trace_print_task(void *argv)
         if(trace_count() != 0)
         {
             trace_print(300);
-            room_left = (trace_env.trace_start + TRACE_SIZE_MAX - (trace_env.trace_end + 1)) % TRACE_SIZE_MAX;
+            room_left = trace_room_left();
             if(trace_env.trace_priority != 0 && room_left > sched_up_level)
             {
                 sys_task_notify((void *)priority_adjust_task_handle, false);
@@ -270,9 +294,14 @@ static void trace_print_task(void *argv)
 }
 #endif
 
+static uint32_t trace_room_left(void)
+{
+    return (trace_env.rec_start + TRACE_SIZE_MAX - (trace_env.trace_end + 1)) % TRACE_SIZE_MAX;
+}
+
 static uint32_t free_space_check_hdl()
 {
-    uint32_t room_left = (trace_env.trace_start + TRACE_SIZE_MAX - (trace_env.trace_end + 1)) % TRACE_SIZE_MAX;
+    uint32_t room_left = trace_room_left();
 #if (defined(CFG_GD_TRACE_DYNAMIC_PRI_SCH))
     if(trace_env.trace_priority == 0 && room_left < sched_low_level)
     {
@@ -282,58 +311,225 @@ static uint32_t free_space_check_hdl()
     return room_left;
 }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-static void trace_buf_Align()
+static uint8_t trace_type_to_src(uint8_t type)
 {
-    trace_env.trace_end = (((trace_env.trace_end + 3) & 0xFFFFFFFFC)) % TRACE_SIZE_MAX;
+    switch(type & ~TRACE_TYPE_NEW)
+    {
+    case TRACE_TYPE_BLE:
+        return TRACE_SRC_BLE;
+    case TRACE_TYPE_WIFI:
+        return TRACE_SRC_WIFI;
+    case TRACE_TYPE_BTSNOOP:
+        return TRACE_SRC_BTSNOOP;
+    case TRACE_TYPE_CONSOLE:
+        return TRACE_SRC_CONSOLE;
+    default:
+        return TRACE_SRC_NUM;
+    }
 }
+
+/*
+ * Length of the log segment stored at @pos, header and alignment padding
+ * included. Header bytes are read modulo the ring size since a header may
+ * straddle the end of the buffer. @p_ctrl returns the flag/type byte.
+ */
+static uint32_t trace_seg_len(uint32_t pos, uint8_t *p_ctrl)
+{
+    uint8_t len_lsb = trace_start[(pos + 2) % TRACE_SIZE_MAX];
+    uint8_t ctrl = trace_start[(pos + 3) % TRACE_SIZE_MAX];
+    uint32_t seg_len = ((len_lsb | (ctrl << 8)) & PAYLOAD_LEN_MASK) + LOG_HEADER_BYTES;
+
+#if (TRACE_ADDR_NO_ALIGN == 0)
+    //the last segment of a log is padded up to the next word
+    if(((ctrl >> 2) & 0x03) == COMPLT_FLAG || ((ctrl >> 2) & 0x03) == END_FLAG)
+    {
+        seg_len = ((pos + seg_len + 3) & 0xFFFFFFFC) - pos;
+    }
 #endif
 
-static void trace_buf_write(uint8_t *buf, uint16_t len)
+    if(p_ctrl != NULL)
+    {
+        *p_ctrl = ctrl;
+    }
+    return seg_len;
+}
+
+/*
+ * Loop mode: discard the oldest committed logs until @need_bytes are
+ * available. Logs are discarded up to their last segment so that no orphan
+ * continue segment is left behind. Called with interrupts disabled and no
+ * drain in progress, so neither uncommitted data nor bytes owned by the UART
+ * are touched. Nothing is discarded if the request cannot be satisfied.
+ */
+static bool trace_ring_reclaim(uint32_t need_bytes)
 {
-    if (trace_env.trace_end + len <= TRACE_SIZE_MAX)
+    uint32_t committed = (trace_env.trace_commit + TRACE_SIZE_MAX - trace_env.rec_start) % TRACE_SIZE_MAX;
+    uint32_t sent = (trace_env.trace_start + TRACE_SIZE_MAX - trace_env.rec_start) % TRACE_SIZE_MAX;
+    uint16_t lost[TRACE_SRC_NUM] = {0};
+    uint32_t freed = 0;
+    uint32_t seg_len;
+    uint8_t ctrl, flag, src;
+    bool in_log = false;
+    bool counted = false;
+
+    while(freed < need_bytes || in_log)
+    {
+        if(freed >= committed)
+        {
+            return false;
+        }
+        seg_len = trace_seg_len((trace_env.rec_start + freed) % TRACE_SIZE_MAX, &ctrl);
+        flag = (ctrl >> 2) & 0x03;
+        src = trace_type_to_src(ctrl >> 4);
+        if(!in_log)
+        {
+            counted = false;
+        }
+        //count each log once, and only if some of it had not been sent yet
+        if(!counted && freed + seg_len > sent && src < TRACE_SRC_NUM)
+        {
+            lost[src]++;
+            counted = true;
+        }
+        in_log = (flag == START_FLAG || flag == CONTINUE_FLAG);
+        freed += seg_len;
+    }
+
+    for(src = 0; src < TRACE_SRC_NUM; src++)
+    {
+        trace_env.stats.overwrite_cnt[src] += lost[src];
+    }
+    trace_env.rec_start = (trace_env.rec_start + freed) % TRACE_SIZE_MAX;
+    if(freed > sent)
     {
-        memcpy(trace_start + trace_env.trace_end, buf, len);
-        trace_env.trace_end += len;
+        trace_env.trace_start = trace_env.rec_start;
+    }
+    return true;
+}
+
+/*
+ * Reserve @len bytes for one log and assign its sequence number and time
+ * stamp. Only the bookkeeping runs with interrupts disabled; the caller
+ * fills the region with trace_buf_write() and publishes it with
+ * trace_ring_commit(). @p_seqno may be NULL for sources without sequence.
+ */
+static bool trace_ring_reserve(uint32_t len, uint8_t src, volatile uint8_t *p_seqno, struct trace_wr *wr)
+{
+    uint32_t room_left;
+    uint32_t used;
+    bool ret = false;
+
+    GLOBAL_INT_DISABLE();
+    wr->ts = get_sys_local_time_us();
+
+    room_left = free_space_check_hdl();
+    if(room_left < len)
+    {
+        if(!trace_loop || trace_env.tx_bytes != 0 || len >= TRACE_SIZE_MAX ||
+           !trace_ring_reclaim(len - room_left))
+        {
+            if(p_seqno != NULL)
+            {
+                (*p_seqno)++;
+            }
+            trace_env.stats.drop_cnt[src]++;
+            goto end;     //drop the current log
+        }
+    }
+
+    wr->pos = trace_env.trace_end;
+    wr->seqno = (p_seqno != NULL) ? (*p_seqno)++ : 0xFF;
+    trace_env.trace_end = (trace_env.trace_end + len) % TRACE_SIZE_MAX;
+    trace_env.writers++;
+
+    trace_env.stats.rec_cnt[src]++;
+    used = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.rec_start) % TRACE_SIZE_MAX;
+    if(used > trace_env.stats.used_max)
+    {
+        trace_env.stats.used_max = used;
+    }
+    ret = true;
+
+end:
+    GLOBAL_INT_RESTORE();
+    return ret;
+}
+
+/*
+ * Publish the region of the calling writer. Writers do not finish in
+ * reservation order: an interrupt finishes before the task it preempted,
+ * but a task preempted between reserve and commit may resume only after
+ * later writers, from other tasks, are done. The commit offset is thus only
+ * moved when no writer is left, everything reserved is complete then.
+ * Logs of writers that keep overlapping wait in the ring, none is lost.
+ */
+static void trace_ring_commit(void)
+{
+    GLOBAL_INT_DISABLE();
+    if(--trace_env.writers == 0)
+    {
+        trace_env.trace_commit = trace_env.trace_end;
+    }
+    GLOBAL_INT_RESTORE();
+}
+
+static void trace_buf_write(struct trace_wr *wr, uint8_t *buf, uint16_t len)
+{
+    if (wr->pos + len <= TRACE_SIZE_MAX)
+    {
+        memcpy(trace_start + wr->pos, buf, len);
+        wr->pos += len;
     }
     else
     {
-        uint16_t tlen = TRACE_SIZE_MAX - trace_env.trace_end;
+        uint16_t tlen = TRACE_SIZE_MAX - wr->pos;
 
-        memcpy(trace_start + trace_env.trace_end, buf, tlen);
+        memcpy(trace_start + wr->pos, buf, tlen);
         memcpy(trace_start, buf + tlen, len - tlen);
-        trace_env.trace_end = len - tlen;
+        wr->pos = len - tlen;
     }
 
-    trace_env.trace_end %= TRACE_SIZE_MAX;
+    wr->pos %= TRACE_SIZE_MAX;
 }
 
-
-static bool free_used_space(uint32_t need_bytes)
+/*
+ * Give back @bytes handed to the UART by the last drain. The headers of the
+ * drained segments are parsed with interrupts enabled: tx_bytes is still set
+ * so producers cannot reclaim, and room is computed from rec_start so the
+ * drained area is not reused before rec_start moves.
+ */
+static void trace_ring_release(uint32_t bytes)
 {
-    do {
-        uint32_t data_len;
-        uint8_t *p_start = trace_start + trace_env.trace_start;
-        //FIX TODO we may remove continue payload and checksum
-        data_len = p_start[2] | (p_start[3] << 8);
-        data_len &= PAYLOAD_LEN_MASK;
-        data_len += LOG_HEADER_BYTES;      //add header
-        need_bytes = data_len < need_bytes ? (need_bytes - data_len) : 0;
-        trace_env.trace_start = (data_len + trace_env.trace_start) % TRACE_SIZE_MAX;
-    }while(need_bytes > 0);
+    uint32_t rd = (trace_env.trace_start + bytes) % TRACE_SIZE_MAX;
+    uint32_t pos = trace_env.rec_start;
+    uint32_t seg_len;
 
-    return true;
+    while(pos != rd)
+    {
+        seg_len = trace_seg_len(pos, NULL);
+        if(seg_len > (rd + TRACE_SIZE_MAX - pos) % TRACE_SIZE_MAX)
+        {
+            break;
+        }
+        pos = (pos + seg_len) % TRACE_SIZE_MAX;
+    }
+
+    GLOBAL_INT_DISABLE();
+    trace_env.rec_start = pos;
+    trace_env.trace_start = rd;
+    trace_env.tx_bytes = 0;
+    GLOBAL_INT_RESTORE();
 }
 
 void trace_console(uint16_t len, uint8_t *p_buf)
 {
     uint8_t header[LOG_HEADER_BYTES] = {0};
+    struct trace_wr wr;
     uint16_t length;
     uint8_t flag = 0;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-    uint32_t room_left;
 #if (TRACE_ADDR_NO_ALIGN == 0)
     uint32_t temp_total_bytes = 0;
 #endif
@@ -355,30 +551,15 @@ void trace_console(uint16_t len, uint8_t *p_buf)
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop)
-        {
-            goto end;     //drop the current log
-        }
-
-        if(!free_used_space(total_bytes - room_left))
-        {
-            goto end;
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_CONSOLE, NULL, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_CONSOLE, NULL, &wr))
+#endif
     {
         goto end;     //drop the current log
     }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -406,23 +587,19 @@ void trace_console(uint16_t len, uint8_t *p_buf)
 #endif
 
     //reuse left_bytes to first packet left bytes
-    left_bytes = MAX_PAYLOAD_LEN - LOG_HEADER_BYTES;
-    trace_buf_write(header, LOG_HEADER_BYTES);
+    left_bytes = MAX_PAYLOAD_LEN;
+    trace_buf_write(&wr, header, LOG_HEADER_BYTES);
 
     //first payload segment
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(p_buf, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        trace_buf_write(&wr, p_buf, total_bytes);
+        goto commit;
 
     }
     else
     {
-        trace_buf_write(p_buf, left_bytes);
+        trace_buf_write(&wr, p_buf, left_bytes);
         p_buf += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -456,15 +633,13 @@ void trace_console(uint16_t len, uint8_t *p_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(p_buf, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, p_buf, length);
         p_buf += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -473,7 +648,6 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 void trace_ext_init(bool force, bool loop)
@@ -511,14 +685,15 @@ void trace_ext_init(bool force, bool loop)
     trace_env.task_sleep = false;
 #endif
 
-#ifdef TRACE_UART_DMA
-    trace_env.dma_send_bytes = 0;
-#endif
-
     memset(trace_start, 0, TRACE_SIZE_MAX);
 
+    trace_env.rec_start = 0;
     trace_env.trace_start = 0;
+    trace_env.trace_commit = 0;
     trace_env.trace_end = 0;
+    trace_env.writers = 0;
+    trace_env.tx_bytes = 0;
+    memset(&trace_env.stats, 0, sizeof(trace_env.stats));
 
     trace_loop = loop;
     trace_initialized = true;
@@ -551,7 +726,7 @@ bool trace_wifi_filter_set()
 void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type, uint8_t module, uint8_t trace_level)
 {
     uint8_t *ptr;
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
@@ -559,7 +734,6 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-    uint32_t room_left;
 #if (TRACE_ADDR_NO_ALIGN == 0)
     uint32_t temp_total_bytes = 0;
 #endif
@@ -601,28 +775,15 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
+#endif
     {
-        trace_env.seqno++;
         goto end;     //drop the current log
     }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -636,7 +797,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     type |= TRACE_TYPE_NEW;
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -659,11 +820,11 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     header[12] = trace_level;
     header[13] = nb_param & 0xFF;
     //MSB timestamp
-    header[14] =  (ts >> 16) & 0xFF;
-    header[15] = (ts >> 24) & 0xFF;
+    header[14] =  (wr.ts >> 16) & 0xFF;
+    header[15] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[16] = ts & 0xFF;
-    header[17] = (ts >> 8) & 0xFF;
+    header[16] = wr.ts & 0xFF;
+    header[17] = (wr.ts >> 8) & 0xFF;
 #else
     //Align Reserv
     header[6] = 0xFF;
@@ -679,32 +840,28 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     header[14] = trace_level;
     header[15] = nb_param & 0xFF;
     //MSB timestamp
-    header[16] =  (ts >> 16) & 0xFF;
-    header[17] = (ts >> 24) & 0xFF;
+    header[16] =  (wr.ts >> 16) & 0xFF;
+    header[17] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[18] = ts & 0xFF;
-    header[19] = (ts >> 8) & 0xFF;
+    header[18] = wr.ts & 0xFF;
+    header[19] = (wr.ts >> 8) & 0xFF;
 #endif
 
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        trace_buf_write(&wr, ptr, total_bytes);
+        goto commit;
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -712,7 +869,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -740,15 +897,13 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
         header[6] = 0xFF;
         header[7] = 0xFF;
 #endif
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -757,18 +912,16 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 
 void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 {
     uint8_t *ptr;
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
@@ -798,28 +951,15 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
+#endif
     {
-        trace_env.seqno++;
         goto end;     //drop the current log
     }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -831,7 +971,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -854,11 +994,11 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[12] = 0xFF;
     header[13] = nb_param & 0xFF;
     //MSB timestamp
-    header[14] =  (ts >> 16) & 0xFF;
-    header[15] = (ts >> 24) & 0xFF;
+    header[14] =  (wr.ts >> 16) & 0xFF;
+    header[15] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[16] = ts & 0xFF;
-    header[17] = (ts >> 8) & 0xFF;
+    header[16] = wr.ts & 0xFF;
+    header[17] = (wr.ts >> 8) & 0xFF;
 #else
     //Align Reserv
     header[6] = 0xFF;
@@ -874,17 +1014,17 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[14] = 0xFF;
     header[15] = nb_param & 0xFF;
     //MSB timestamp
-    header[16] =  (ts >> 16) & 0xFF;
-    header[17] = (ts >> 24) & 0xFF;
+    header[16] =  (wr.ts >> 16) & 0xFF;
+    header[17] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[18] = ts & 0xFF;
-    header[19] = (ts >> 8) & 0xFF;
+    header[18] = wr.ts & 0xFF;
+    header[19] = (wr.ts >> 8) & 0xFF;
 #endif
 
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -904,23 +1044,19 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        trace_buf_write(&wr, ptr, total_bytes);
+        goto commit;
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -928,7 +1064,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -957,15 +1093,13 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -974,7 +1108,6 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 
@@ -982,11 +1115,10 @@ end:
 void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 {
     uint8_t *ptr;
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
@@ -1016,29 +1148,15 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();   //need to change
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.wifi_seqno++;
-            goto end;     //drop the current log
-        }
-    }
-
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_WIFI, &trace_env.wifi_seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_WIFI, &trace_env.wifi_seqno, &wr))
+#endif
     {
-        trace_env.wifi_seqno++;
         goto end;     //drop the current log
     }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -1050,7 +1168,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.wifi_seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1070,11 +1188,11 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[8] = id & 0xFF;
     header[9] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[10] =  (ts >> 16) & 0xFF;
-    header[11] = (ts >> 24) & 0xFF;
+    header[10] =  (wr.ts >> 16) & 0xFF;
+    header[11] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[12] = ts & 0xFF;
-    header[13] = (ts >> 8) & 0xFF;
+    header[12] = wr.ts & 0xFF;
+    header[13] = (wr.ts >> 8) & 0xFF;
 #else
     //Align Reserv
     header[6] = 0xFF;
@@ -1086,17 +1204,17 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[10] = id & 0xFF;
     header[11] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[12] =  (ts >> 16) & 0xFF;
-    header[13] = (ts >> 24) & 0xFF;
+    header[12] =  (wr.ts >> 16) & 0xFF;
+    header[13] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[14] = ts & 0xFF;
-    header[15] = (ts >> 8) & 0xFF;
+    header[14] = wr.ts & 0xFF;
+    header[15] = (wr.ts >> 8) & 0xFF;
 #endif
 
     //reuse left_bytes to first packet left bytes
-    left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES - 2;
-    total_bytes -= TRACE_HEADER_BYTES - 2;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
+    total_bytes -= TRACE_HEADER_BYTES;
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -1117,23 +1235,19 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        trace_buf_write(&wr, ptr, total_bytes);
+        goto commit;
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1141,7 +1255,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.wifi_seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1170,15 +1284,13 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -1187,14 +1299,13 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 #else
 void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type, uint8_t module, uint8_t trace_level)
 {
     uint8_t *ptr;
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
@@ -1202,7 +1313,6 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-    uint32_t room_left;
 #if (TRACE_ADDR_NO_ALIGN == 0)
     uint32_t temp_total_bytes = 0;
 #endif
@@ -1244,28 +1354,15 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
+#endif
     {
-        trace_env.seqno++;
         goto end;     //drop the current log
     }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -1276,7 +1373,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1295,11 +1392,11 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     header[8] = id & 0xFF;
     header[9] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[10] =  (ts >> 16) & 0xFF;
-    header[11] = (ts >> 24) & 0xFF;
+    header[10] =  (wr.ts >> 16) & 0xFF;
+    header[11] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[12] = ts & 0xFF;
-    header[13] = (ts >> 8) & 0xFF;
+    header[12] = wr.ts & 0xFF;
+    header[13] = (wr.ts >> 8) & 0xFF;
 #else
     //Align Reserv
     header[6] = 0xFF;
@@ -1311,32 +1408,28 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     header[10] = id & 0xFF;
     header[11] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[12] =  (ts >> 16) & 0xFF;
-    header[13] = (ts >> 24) & 0xFF;
+    header[12] =  (wr.ts >> 16) & 0xFF;
+    header[13] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[14] = ts & 0xFF;
-    header[15] = (ts >> 8) & 0xFF;
+    header[14] = wr.ts & 0xFF;
+    header[15] = (wr.ts >> 8) & 0xFF;
 #endif
 
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        trace_buf_write(&wr, ptr, total_bytes);
+        goto commit;
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1344,7 +1437,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1373,15 +1466,13 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -1390,18 +1481,16 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 
 void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 {
     uint8_t *ptr;
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
@@ -1431,28 +1520,15 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_BLE, &trace_env.seqno, &wr))
+#endif
     {
-        trace_env.seqno++;
         goto end;     //drop the current log
     }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -1463,7 +1539,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1483,11 +1559,11 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[8] = id & 0xFF;
     header[9] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[10] =  (ts >> 16) & 0xFF;
-    header[11] = (ts >> 24) & 0xFF;
+    header[10] =  (wr.ts >> 16) & 0xFF;
+    header[11] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[12] = ts & 0xFF;
-    header[13] = (ts >> 8) & 0xFF;
+    header[12] = wr.ts & 0xFF;
+    header[13] = (wr.ts >> 8) & 0xFF;
 #else
     //Align Reserv
     header[6] = 0xFF;
@@ -1498,17 +1574,17 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[10] = id & 0xFF;
     header[11] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[12] =  (ts >> 16) & 0xFF;
-    header[13] = (ts >> 24) & 0xFF;
+    header[12] =  (wr.ts >> 16) & 0xFF;
+    header[13] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[14] = ts & 0xFF;
-    header[15] = (ts >> 8) & 0xFF;
+    header[14] = wr.ts & 0xFF;
+    header[15] = (wr.ts >> 8) & 0xFF;
 #endif
 
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -1529,23 +1605,19 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        trace_buf_write(&wr, ptr, total_bytes);
+        goto commit;
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1553,7 +1625,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1582,15 +1654,13 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -1599,17 +1669,15 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 {
     uint8_t *ptr;
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
@@ -1640,28 +1708,15 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();   //need to change
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.wifi_seqno++;
-            goto end;     //drop the current log
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_WIFI, &trace_env.wifi_seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_WIFI, &trace_env.wifi_seqno, &wr))
+#endif
     {
-        trace_env.wifi_seqno++;
         goto end;     //drop the current log
     }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -1672,7 +1727,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.wifi_seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1692,11 +1747,11 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[8] = id & 0xFF;
     header[9] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[10] =  (ts >> 16) & 0xFF;
-    header[11] = (ts >> 24) & 0xFF;
+    header[10] =  (wr.ts >> 16) & 0xFF;
+    header[11] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[12] = ts & 0xFF;
-    header[13] = (ts >> 8) & 0xFF;
+    header[12] = wr.ts & 0xFF;
+    header[13] = (wr.ts >> 8) & 0xFF;
 #else
     //Align Reserv
     header[6] = 0xFF;
@@ -1707,17 +1762,17 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     header[10] = id & 0xFF;
     header[11] = (id >> 8) & 0xFF;
     //MSB timestamp
-    header[12] =  (ts >> 16) & 0xFF;
-    header[13] = (ts >> 24) & 0xFF;
+    header[12] =  (wr.ts >> 16) & 0xFF;
+    header[13] = (wr.ts >> 24) & 0xFF;
     //LSB timestamp
-    header[14] = ts & 0xFF;
-    header[15] = (ts >> 8) & 0xFF;
+    header[14] = wr.ts & 0xFF;
+    header[15] = (wr.ts >> 8) & 0xFF;
 #endif
 
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -1737,23 +1792,19 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        trace_buf_write(&wr, ptr, total_bytes);
+        goto commit;
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1761,7 +1812,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.wifi_seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1790,15 +1841,13 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -1807,17 +1856,15 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 #endif
 
 void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_type)
 {
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_BTSNOOP_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
 #if (TRACE_ADDR_NO_ALIGN == 0)
     uint32_t temp_total_bytes = 0;
 #endif
@@ -1840,28 +1887,15 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.btsnoop_seqno++;
-            goto end;     //drop the current log
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_BTSNOOP, &trace_env.btsnoop_seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_BTSNOOP, &trace_env.btsnoop_seqno, &wr))
+#endif
     {
-        trace_env.btsnoop_seqno++;
         goto end;     //drop the current log
     }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -1872,9 +1906,9 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     }
 
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.btsnoop_seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
-    flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
+    flag = (block_num > 1 || (block_num == 1 && left_bytes > 0)) ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
     header[3] = ((length >> 8) & 0x03) | (TRACE_TYPE_BTSNOOP << 4) | (flag << 2);
 #if TRACE_ADDR_NO_ALIGN
@@ -1887,10 +1921,10 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
 #if TRACE_ADDR_NO_ALIGN
     /* write btsnoop header */
     header[6] = (hci_type & 0x7F) | ((direction & 0x01) << 7);
-    header[7] = ts & 0xFF;
-    header[8] = (ts >> 8) & 0xFF;
-    header[9] = (ts >> 16) & 0xFF;
-    header[10] = (ts >> 24) & 0xFF;
+    header[7] = wr.ts & 0xFF;
+    header[8] = (wr.ts >> 8) & 0xFF;
+    header[9] = (wr.ts >> 16) & 0xFF;
+    header[10] = (wr.ts >> 24) & 0xFF;
     header[11] = 0xFF;
     header[12] = 0xFF;
     header[13] = 0xFF;
@@ -1899,10 +1933,10 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     header[7] = 0xFF;
     /* write btsnoop header */
     header[8] = (hci_type & 0x7F) | ((direction & 0x01) << 7);
-    header[9] = ts & 0xFF;
-    header[10] = (ts >> 8) & 0xFF;
-    header[11] = (ts >> 16) & 0xFF;
-    header[12] = (ts >> 24) & 0xFF;
+    header[9] = wr.ts & 0xFF;
+    header[10] = (wr.ts >> 8) & 0xFF;
+    header[11] = (wr.ts >> 16) & 0xFF;
+    header[12] = (wr.ts >> 24) & 0xFF;
     header[13] = 0xFF;
     header[14] = 0xFF;
     header[15] = 0xFF;
@@ -1911,22 +1945,18 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     //set left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - BTSNOOP_HEADER_BYTES;
     total_bytes -= BTSNOOP_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_BTSNOOP_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_BTSNOOP_HEADER_BYTES);
 
     //first payload segment, it may complete packet or start packet
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(p_buf, total_bytes);
-#if TRACE_ADDR_NO_ALIGN
+        trace_buf_write(&wr, p_buf, total_bytes);
         //complete packet go end
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        goto commit;
     }
     else
     {
-        trace_buf_write(p_buf, left_bytes);
+        trace_buf_write(&wr, p_buf, left_bytes);
         p_buf += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1934,7 +1964,7 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.btsnoop_seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1962,15 +1992,13 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(p_buf, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, p_buf, length);
         p_buf += length;
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -1979,16 +2007,14 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_type, uint8_t *p_payload, uint16_t payload_len)
 {
-    uint64_t ts;
+    struct trace_wr wr;
     uint8_t header[TOTAL_BTSNOOP_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
 #if (TRACE_ADDR_NO_ALIGN == 0)
     uint32_t temp_total_bytes = 0;
 #endif
@@ -2011,28 +2037,15 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
 #endif
 
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-    ts = get_sys_local_time_us();
-
-    room_left = free_space_check_hdl();
-
+    /* Only the reservation runs with interrupts disabled */
 #if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.btsnoop_seqno++;
-            goto end;     //drop the current log
-        }
-    }
+    if(!trace_ring_reserve(total_bytes, TRACE_SRC_BTSNOOP, &trace_env.btsnoop_seqno, &wr))
 #else
-    if(room_left < temp_total_bytes)
+    if(!trace_ring_reserve(temp_total_bytes, TRACE_SRC_BTSNOOP, &trace_env.btsnoop_seqno, &wr))
+#endif
     {
-        trace_env.btsnoop_seqno++;
         goto end;     //drop the current log
     }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -2042,9 +2055,9 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     }
 
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.btsnoop_seqno++;
+    header[1] = wr.seqno;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
-    flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
+    flag = (block_num > 1 || (block_num == 1 && left_bytes > 0)) ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
     header[3] = ((length >> 8) & 0x03) | (TRACE_TYPE_BTSNOOP << 4) | (flag << 2);
 #if TRACE_ADDR_NO_ALIGN
@@ -2057,10 +2070,10 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
 #if TRACE_ADDR_NO_ALIGN
     /* write btsnoop header */
     header[6] = (hci_type & 0x7F) | ((direction & 0x01) << 7);
-    header[7] = ts & 0xFF;
-    header[8] = (ts >> 8) & 0xFF;
-    header[9] = (ts >> 16) & 0xFF;
-    header[10] = (ts >> 24) & 0xFF;
+    header[7] = wr.ts & 0xFF;
+    header[8] = (wr.ts >> 8) & 0xFF;
+    header[9] = (wr.ts >> 16) & 0xFF;
+    header[10] = (wr.ts >> 24) & 0xFF;
     header[11] = 0xFF;
     header[12] = 0xFF;
     header[13] = 0xFF;
@@ -2070,10 +2083,10 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     header[7] = 0xFF;
     /* write btsnoop header */
     header[8] = (hci_type & 0x7F) | ((direction & 0x01) << 7);
-    header[9] = ts & 0xFF;
-    header[10] = (ts >> 8) & 0xFF;
-    header[11] = (ts >> 16) & 0xFF;
-    header[12] = (ts >> 24) & 0xFF;
+    header[9] = wr.ts & 0xFF;
+    header[10] = (wr.ts >> 8) & 0xFF;
+    header[11] = (wr.ts >> 16) & 0xFF;
+    header[12] = (wr.ts >> 24) & 0xFF;
     header[13] = 0xFF;
     header[14] = 0xFF;
     header[15] = 0xFF;
@@ -2082,35 +2095,31 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     //set left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - BTSNOOP_HEADER_BYTES;
     total_bytes -= BTSNOOP_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_BTSNOOP_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_BTSNOOP_HEADER_BYTES);
 
     //first payload segment, it may complete packet or start packet
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(p_buf, len);
+        trace_buf_write(&wr, p_buf, len);
         if(p_payload != NULL)
         {
-            trace_buf_write(p_payload, payload_len);
+            trace_buf_write(&wr, p_payload, payload_len);
         }
-#if TRACE_ADDR_NO_ALIGN
         //complete packet go end
-        goto end;
-#else
-        goto align_buffer;
-#endif
+        goto commit;
     }
     else
     {
         if(len > left_bytes)
         {
-            trace_buf_write(p_buf, left_bytes);
+            trace_buf_write(&wr, p_buf, left_bytes);
             len -= left_bytes;
             p_buf += left_bytes;
         }
         else
         {
-            trace_buf_write(p_buf, len);
-            trace_buf_write(p_payload, left_bytes- len);
+            trace_buf_write(&wr, p_buf, len);
+            trace_buf_write(&wr, p_payload, left_bytes- len);
             payload_len -= (left_bytes - len);
             p_payload += (left_bytes - len);
             len = 0;
@@ -2121,7 +2130,7 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.btsnoop_seqno - 1;
+        header[1] = wr.seqno;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -2149,16 +2158,16 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
         if(total_bytes == 0)
         {
             if(len > 0)
             {
-                trace_buf_write(p_buf, len);
+                trace_buf_write(&wr, p_buf, len);
             }
             if(payload_len > 0)
             {
-                trace_buf_write(p_payload, payload_len);
+                trace_buf_write(&wr, p_payload, payload_len);
             }
         }
         else
@@ -2167,16 +2176,16 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
             {
                 if(len > length)
                 {
-                    trace_buf_write(p_buf, length);
+                    trace_buf_write(&wr, p_buf, length);
                     p_buf += length;
                     len -= length;
                     length = 0;
                 }
                 else
                 {
-                    trace_buf_write(p_buf, len);
-                    len = 0;
+                    trace_buf_write(&wr, p_buf, len);
                     length -= len;
+                    len = 0;
                 }
             }
 
@@ -2184,23 +2193,21 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
             {
                 if(payload_len > length)
                 {
-                    trace_buf_write(p_payload, length);
+                    trace_buf_write(&wr, p_payload, length);
                     payload_len -= length;
                     p_payload += length;
                 }
                 else
                 {
-                    trace_buf_write(p_payload, payload_len);
+                    trace_buf_write(&wr, p_payload, payload_len);
                     payload_len = 0;
                 }
             }
         }
     }while(total_bytes > 0);
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-align_buffer:
-    trace_buf_Align();
-#endif
+commit:
+    trace_ring_commit();
 
 end:
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
@@ -2209,116 +2216,133 @@ end:
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 uint16_t trace_count()
 {
-    return trace_initialized ? (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX : 0;
+    return trace_initialized ? (trace_env.trace_commit + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX : 0;
 }
 
 uint16_t trace_print(uint16_t max_bytes)
 {
     uint16_t send_bytes = 0;
+    uint32_t rd;
 
     if(!trace_initialized || trace_count() == 0)
     {
         return send_bytes;
     }
 
-    send_bytes = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
-
-    if(send_bytes > max_bytes)
+    GLOBAL_INT_DISABLE();
+    if(trace_env.tx_bytes == 0)
     {
-        send_bytes = max_bytes;
+        send_bytes = (trace_env.trace_commit + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
+        if(send_bytes > max_bytes)
+        {
+            send_bytes = max_bytes;
+        }
+        trace_env.tx_bytes = send_bytes;
     }
+    rd = trace_env.trace_start;
+    GLOBAL_INT_RESTORE();
 
     if(send_bytes > 0)
     {
-        if (trace_env.trace_start + send_bytes <= TRACE_SIZE_MAX)
+        if (rd + send_bytes <= TRACE_SIZE_MAX)
         {
-            uart_transfer_trace_data(trace_start + trace_env.trace_start, send_bytes);
-            trace_env.trace_start += send_bytes;
+            uart_transfer_trace_data(trace_start + rd, send_bytes);
         }
         else
         {
-            uint16_t tlen = TRACE_SIZE_MAX - trace_env.trace_start;
+            uint16_t tlen = TRACE_SIZE_MAX - rd;
 
-            uart_transfer_trace_data(trace_start + trace_env.trace_start, tlen);
+            uart_transfer_trace_data(trace_start + rd, tlen);
             uart_transfer_trace_data(trace_start, send_bytes - tlen);
-            trace_env.trace_start = send_bytes - tlen;
         }
 
-        trace_env.trace_start %= TRACE_SIZE_MAX;
+        trace_ring_release(send_bytes);
     }
     return send_bytes;
 }
 
-void trace_dma_print()
-{
 #ifdef TRACE_UART_DMA
-    uint16_t send_bytes = 0;
-    if(!trace_initialized || trace_count() == 0)
+/*
+ * Hand the committed bytes up to the end of the ring straight to the DMA.
+ * Must be called with interrupts disabled.
+ */
+static void trace_dma_arm(void)
+{
+    uint16_t send_bytes;
+
+    if(trace_env.tx_bytes != 0)
     {
         return;
     }
 
-    // DMA is not sending bytes, arrange dma transfer
-    if(trace_env.dma_send_bytes == 0)
+    send_bytes = (trace_env.trace_commit + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
+    if(send_bytes > 0)
     {
-        send_bytes = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
-        if(send_bytes > 0)
+        if (trace_env.trace_start + send_bytes > TRACE_SIZE_MAX)
         {
-            if (trace_env.trace_start + send_bytes <= TRACE_SIZE_MAX)
-            {
-                trace_env.dma_send_bytes = send_bytes;
-            }
-            else
-            {
-                trace_env.dma_send_bytes = TRACE_SIZE_MAX - trace_env.trace_start;
-            }
-
-            trace_uart_dma_transfer((uint32_t)(trace_start + trace_env.trace_start), trace_env.dma_send_bytes);
+            send_bytes = TRACE_SIZE_MAX - trace_env.trace_start;
         }
+        trace_env.tx_bytes = send_bytes;
+
+        trace_uart_dma_transfer((uint32_t)(trace_start + trace_env.trace_start), send_bytes);
+    }
+}
+#endif
+
+void trace_dma_print()
+{
+#ifdef TRACE_UART_DMA
+    if(!trace_initialized || trace_count() == 0)
+    {
+        return;
     }
 
+    // DMA is not sending bytes, arrange dma transfer
+    GLOBAL_INT_DISABLE();
+    trace_dma_arm();
+    GLOBAL_INT_RESTORE();
 #endif
 }
 
 #ifdef TRACE_UART_DMA
 void trace_dma_transfer_cmplt()
 {
-    uint16_t send_bytes = 0;
-
-    if(!trace_initialized)
+    if(!trace_initialized || trace_env.tx_bytes == 0)
     {
         return;
     }
 
-    GLOBAL_INT_DISABLE();
-    trace_env.trace_start = (trace_env.trace_start + trace_env.dma_send_bytes) % TRACE_SIZE_MAX;
+    trace_ring_release(trace_env.tx_bytes);
 
     // Check left bytes need to transfer
-    send_bytes = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
-    if(send_bytes > 0)
-    {
-        if (trace_env.trace_start + send_bytes <= TRACE_SIZE_MAX)
-        {
-            trace_env.dma_send_bytes = send_bytes;
-        }
-        else
-        {
-            trace_env.dma_send_bytes = TRACE_SIZE_MAX - trace_env.trace_start;
-        }
+    GLOBAL_INT_DISABLE();
+    trace_dma_arm();
+    GLOBAL_INT_RESTORE();
+}
+#endif
 
-        trace_uart_dma_transfer((uint32_t)(trace_start + trace_env.trace_start), trace_env.dma_send_bytes);
+void trace_ring_stats_get(struct trace_ring_stats *stats, bool reset)
+{
+    if(!trace_initialized)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
     }
-    else
-        trace_env.dma_send_bytes = 0;
 
+    GLOBAL_INT_DISABLE();
+    *stats = trace_env.stats;
+    stats->used = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.rec_start) % TRACE_SIZE_MAX;
+    stats->size = TRACE_SIZE_MAX;
+    if(reset)
+    {
+        memset(&trace_env.stats, 0, sizeof(trace_env.stats));
+    }
     GLOBAL_INT_RESTORE();
 }
-#endif
 
 #else /* CFG_GD_TRACE_EXT */
 void trace_ext_init(bool force, bool loop)
@@ -2346,6 +2370,11 @@ void trace_dma_print()
 
 }
 
+void trace_ring_stats_get(struct trace_ring_stats *stats, bool reset)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
 void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_type)
 {
 
@@ -0,0 +1,796 @@
+/*!
+    \file    wifi_capture.c
+    \brief   Monitor mode frame capture with filtering and pcap output.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "app_cfg.h"
+
+#ifdef CONFIG_WIFI_CAPTURE
+#include <string.h>
+#include <stdlib.h>
+#include "wrapper_os.h"
+#include "lwip/sockets.h"
+#include "wifi_export.h"
+#include "wifi_management.h"
+#include "wifi_netlink.h"
+#include "wifi_capture.h"
+#include "systime.h"
+#include "uart.h"
+#include "uart_config.h"
+
+/* Record header stored in the ring, followed by cap_len bytes of frame */
+struct cap_rec
+{
+    /* record length in bytes, multiple of 4. 0 marks the end of the ring */
+    uint16_t rec_len;
+    uint16_t cap_len;
+    uint16_t orig_len;
+    uint16_t freq;
+    int8_t rssi;
+    uint8_t rsvd[3];
+    uint32_t ts_lo;
+    uint32_t ts_hi;
+};
+
+#define CAP_REC_HDR_LEN         sizeof(struct cap_rec)
+#define CAP_RING_MASK           (WIFI_CAPTURE_RING_SIZE - 1)
+#define CAP_ALIGN4(len)         (((len) + 3) & ~3)
+
+/* pcap with radiotap header (LINKTYPE_IEEE802_11_RADIOTAP) */
+#define CAP_PCAP_MAGIC          0xa1b2c3d4
+#define CAP_PCAP_LINKTYPE       127
+#define CAP_PCAP_REC_LEN        16
+/* version, pad, length, present(channel, antenna signal), channel, antenna signal */
+#define CAP_RADIOTAP_LEN        13
+#define CAP_RADIOTAP_PRESENT    ((1 << 3) | (1 << 5))
+#define CAP_RADIOTAP_CHAN_2G    0x0080
+#define CAP_RADIOTAP_CHAN_5G    0x0100
+
+/* Single producer (MAC RX context) / single consumer (capture task) ring */
+struct cap_ring
+{
+    uint8_t *buf;
+    /* free running indexes, head written by the producer only, tail by the consumer only */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+};
+
+struct cap_ctx
+{
+    struct cap_ring ring;
+    struct wifi_capture_filter filter;
+    struct wifi_capture_stats stats;
+    os_task_t task;
+    os_sema_t exit_sema;
+    uint16_t snap_len;
+    uint8_t sink;
+    int sock;
+    uint32_t ip;
+    uint16_t port;
+    uint8_t *tx_buf;
+    uint16_t tx_len;
+    volatile uint8_t active;
+    volatile uint8_t in_cb;
+    volatile uint8_t wake_pending;
+    volatile uint8_t exit;
+};
+
+static struct cap_ctx cap_ctx;
+
+static const struct
+{
+    const char *name;
+    uint8_t type;
+    /* 0xff: all subtypes */
+    uint8_t subtype;
+} cap_flt_names[] = {
+    {"mgmt", 0, 0xff},         {"ctrl", 1, 0xff},         {"data", 2, 0xff},
+    {"assoc_req", 0, 0},       {"assoc_resp", 0, 1},      {"reassoc_req", 0, 2},
+    {"reassoc_resp", 0, 3},    {"probe_req", 0, 4},       {"probe_resp", 0, 5},
+    {"beacon", 0, 8},          {"atim", 0, 9},            {"disassoc", 0, 10},
+    {"auth", 0, 11},           {"deauth", 0, 12},         {"action", 0, 13},
+    {"bar", 1, 8},             {"ba", 1, 9},              {"pspoll", 1, 10},
+    {"rts", 1, 11},            {"cts", 1, 12},            {"ack", 1, 13},
+    {"null", 2, 4},            {"qos_data", 2, 8},        {"qos_null", 2, 12},
+};
+
+/*!
+    \brief      parse a MAC address string xx:xx:xx:xx:xx:xx
+    \param[in]  str: MAC address string
+    \param[in]  len: length of the string
+    \param[out] mac: parsed MAC address
+    \retval     0 on success, -1 on error
+*/
+static int cap_parse_mac(const char *str, int len, uint8_t *mac)
+{
+    int i, j, v;
+    char c;
+
+    if (len != 17)
+        return -1;
+
+    for (i = 0; i < 6; i++) {
+        v = 0;
+        for (j = 0; j < 2; j++) {
+            c = str[i * 3 + j];
+            if (c >= '0' && c <= '9')
+                v = (v << 4) | (c - '0');
+            else if (c >= 'a' && c <= 'f')
+                v = (v << 4) | (c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                v = (v << 4) | (c - 'A' + 10);
+            else
+                return -1;
+        }
+        if (i < 5 && str[i * 3 + 2] != ':')
+            return -1;
+        mac[i] = v;
+    }
+
+    return 0;
+}
+
+/*!
+    \brief      compile a filter expression
+                The expression is a list of space separated terms:
+                - frame types: mgmt, ctrl, data, beacon, probe_req, ... (see cap_flt_names),
+                  a frame passes if it matches any of them, all types if none is given
+                - bssid <xx:xx:xx:xx:xx:xx>: frame BSSID, RA or TA for control frames
+                - rssi <dBm>: minimum rssi
+                Terms of different kinds must all match.
+    \param[in]  expr: filter expression, NULL or empty to capture everything
+    \param[out] flt: compiled filter
+    \retval     0 on success, -1 on syntax error
+*/
+int wifi_capture_filter_compile(const char *expr, struct wifi_capture_filter *flt)
+{
+    const char *tok, *arg;
+    int len, arg_len;
+    unsigned int i;
+
+    memset(flt, 0, sizeof(*flt));
+
+    while (expr && *expr) {
+        while (*expr == ' ')
+            expr++;
+        if (*expr == '\0')
+            break;
+        tok = expr;
+        while (*expr && *expr != ' ')
+            expr++;
+        len = expr - tok;
+
+        if ((len == 5 && !strncmp(tok, "bssid", 5)) || (len == 4 && !strncmp(tok, "rssi", 4))) {
+            while (*expr == ' ')
+                expr++;
+            arg = expr;
+            while (*expr && *expr != ' ')
+                expr++;
+            arg_len = expr - arg;
+            if (arg_len == 0)
+                return -1;
+
+            if (len == 5) {
+                if (cap_parse_mac(arg, arg_len, flt->bssid))
+                    return -1;
+                flt->flags |= WIFI_CAPTURE_FLT_BSSID;
+            } else {
+                flt->rssi_min = (int8_t)atoi(arg);
+                flt->flags |= WIFI_CAPTURE_FLT_RSSI;
+            }
+            continue;
+        }
+
+        for (i = 0; i < sizeof(cap_flt_names) / sizeof(cap_flt_names[0]); i++) {
+            if ((strlen(cap_flt_names[i].name) == (size_t)len) &&
+                !strncmp(tok, cap_flt_names[i].name, len))
+                break;
+        }
+        if (i == sizeof(cap_flt_names) / sizeof(cap_flt_names[0]))
+            return -1;
+
+        if (cap_flt_names[i].subtype == 0xff)
+            flt->type_mask |= (uint64_t)0xffff << (cap_flt_names[i].type << 4);
+        else
+            flt->type_mask |= (uint64_t)1 << ((cap_flt_names[i].type << 4) | cap_flt_names[i].subtype);
+    }
+
+    if (flt->type_mask == 0)
+        flt->type_mask = ~(uint64_t)0;
+
+    return 0;
+}
+
+/*!
+    \brief      check an 802.11 frame against a compiled filter, cheapest checks first
+    \param[in]  flt: compiled filter
+    \param[in]  frame: 802.11 frame starting with the frame control
+    \param[in]  len: frame length
+    \param[in]  rssi: frame rssi in dBm
+    \param[out] none
+    \retval     true if the frame passes the filter
+*/
+bool wifi_capture_filter_match(const struct wifi_capture_filter *flt, const uint8_t *frame,
+                               uint16_t len, int8_t rssi)
+{
+    const uint8_t *bssid;
+    uint16_t fc;
+    uint8_t type;
+
+    if ((flt->flags & WIFI_CAPTURE_FLT_RSSI) && (rssi < flt->rssi_min))
+        return false;
+
+    // frame control, duration and addr1
+    if (len < 10)
+        return false;
+
+    fc = frame[0] | (frame[1] << 8);
+    type = (fc >> 2) & 0x3;
+    if (!((flt->type_mask >> ((type << 4) | ((fc >> 4) & 0xf))) & 1))
+        return false;
+
+    if (!(flt->flags & WIFI_CAPTURE_FLT_BSSID))
+        return true;
+
+    switch (type) {
+    case 0:
+        // management: addr3
+        if (len < 22)
+            return false;
+        bssid = frame + 16;
+        break;
+    case 1:
+        // control: RA, or TA when present
+        if (!memcmp(frame + 4, flt->bssid, 6))
+            return true;
+        if (len < 16)
+            return false;
+        bssid = frame + 10;
+        break;
+    case 2:
+        if (len < 24)
+            return false;
+        // depends on ToDS/FromDS, no BSSID in 4 address frames
+        switch ((fc >> 8) & 0x3) {
+        case 0:
+            bssid = frame + 16;
+            break;
+        case 1:
+            bssid = frame + 4;
+            break;
+        case 2:
+            bssid = frame + 10;
+            break;
+        default:
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    return !memcmp(bssid, flt->bssid, 6);
+}
+
+/*!
+    \brief      copy a frame in the ring, called by the producer only
+    \param[in]  ring: pointer to the ring
+    \param[in]  rec: record header, rec_len is set here
+    \param[in]  data: frame, rec->cap_len bytes are copied
+    \param[out] none
+    \retval     ring usage in bytes after the copy, -1 if the ring is full
+*/
+static int cap_ring_put(struct cap_ring *ring, struct cap_rec *rec, const uint8_t *data)
+{
+    uint32_t need = CAP_ALIGN4(CAP_REC_HDR_LEN + rec->cap_len);
+    uint32_t head = ring->head;
+    uint32_t off = head & CAP_RING_MASK;
+    uint32_t pad = 0;
+
+    // records are contiguous, skip the end of the ring if too short
+    if (WIFI_CAPTURE_RING_SIZE - off < need)
+        pad = WIFI_CAPTURE_RING_SIZE - off;
+
+    if ((head - ring->tail) + pad + need > WIFI_CAPTURE_RING_SIZE)
+        return -1;
+
+    if (pad) {
+        if (pad >= CAP_REC_HDR_LEN)
+            ((struct cap_rec *)(ring->buf + off))->rec_len = 0;
+        head += pad;
+        off = 0;
+    }
+
+    rec->rec_len = need;
+    memcpy(ring->buf + off, rec, CAP_REC_HDR_LEN);
+    memcpy(ring->buf + off + CAP_REC_HDR_LEN, data, rec->cap_len);
+
+    // publish the record after its content
+    __sync_synchronize();
+    ring->head = head + need;
+
+    return head + need - ring->tail;
+}
+
+/*!
+    \brief      get the oldest record of the ring, called by the consumer only
+    \param[in]  ring: pointer to the ring
+    \param[out] none
+    \retval     the record, or NULL if the ring is empty
+*/
+static struct cap_rec *cap_ring_peek(struct cap_ring *ring)
+{
+    struct cap_rec *rec;
+    uint32_t tail, off;
+
+    while ((tail = ring->tail) != ring->head) {
+        __sync_synchronize();
+        off = tail & CAP_RING_MASK;
+        if (WIFI_CAPTURE_RING_SIZE - off >= CAP_REC_HDR_LEN) {
+            rec = (struct cap_rec *)(ring->buf + off);
+            if (rec->rec_len)
+                return rec;
+        }
+        // end of ring marker
+        ring->tail = tail + WIFI_CAPTURE_RING_SIZE - off;
+    }
+
+    return NULL;
+}
+
+/*!
+    \brief      release the record returned by cap_ring_peek
+    \param[in]  ring: pointer to the ring
+    \param[in]  rec: the record
+    \param[out] none
+    \retval     none
+*/
+static void cap_ring_release(struct cap_ring *ring, struct cap_rec *rec)
+{
+    ring->tail += rec->rec_len;
+}
+
+/*!
+    \brief      monitor RX callback, run in the MAC RX context
+    \param[in]  info: received frame
+    \param[in]  arg: unused
+    \param[out] none
+    \retval     none
+*/
+static void wifi_capture_rx_cb(struct wifi_frame_info *info, void *arg)
+{
+    struct cap_ctx *cap = &cap_ctx;
+    struct wifi_capture_chan_stats *cs;
+    struct cap_rec rec;
+    uint64_t ts;
+    int ch, used;
+
+    cap->in_cb = 1;
+    if (!cap->active)
+        goto end;
+
+    ch = wifi_freq_to_channel(info->freq);
+    if (ch > WIFI_CAPTURE_CHANNEL_NUM)
+        ch = 0;
+    cs = &cap->stats.chan[ch];
+    cs->rx++;
+
+    if ((info->payload == NULL) ||
+        !wifi_capture_filter_match(&cap->filter, info->payload, info->length, info->rssi)) {
+        cs->filtered++;
+        goto end;
+    }
+
+    // nothing to stream, only count
+    if (cap->sink == WIFI_CAPTURE_SINK_NONE) {
+        cs->captured++;
+        goto end;
+    }
+
+    ts = get_sys_local_time_us();
+    rec.cap_len = info->length < cap->snap_len ? info->length : cap->snap_len;
+    rec.orig_len = info->length;
+    rec.freq = info->freq;
+    rec.rssi = info->rssi;
+    rec.ts_lo = (uint32_t)ts;
+    rec.ts_hi = (uint32_t)(ts >> 32);
+
+    used = cap_ring_put(&cap->ring, &rec, info->payload);
+    if (used < 0) {
+        cs->dropped++;
+        goto end;
+    }
+    cs->captured++;
+    if ((uint32_t)used > cap->stats.ring_hwm)
+        cap->stats.ring_hwm = used;
+
+    if ((used >= WIFI_CAPTURE_WAKE_LEVEL) && !cap->wake_pending) {
+        cap->wake_pending = 1;
+        sys_task_notify(cap->task, false);
+    }
+
+end:
+    cap->in_cb = 0;
+}
+
+/*!
+    \brief      write the staging buffer to the sink
+    \param[in]  cap: capture context
+    \param[out] none
+    \retval     none
+*/
+static void cap_sink_flush(struct cap_ctx *cap)
+{
+    uint8_t *data = cap->tx_buf;
+    int len = cap->tx_len;
+    int n;
+
+    cap->tx_len = 0;
+    if (len == 0)
+        return;
+
+    if (cap->sink == WIFI_CAPTURE_SINK_UART) {
+        uart_put_data(WIFI_CAPTURE_UART, data, len);
+    } else if (cap->sink == WIFI_CAPTURE_SINK_TCP) {
+        while (len > 0) {
+            n = send(cap->sock, data, len, 0);
+            if (n <= 0) {
+                netlink_printf("capture: tcp send failed, stream stopped\r\n");
+                cap->stats.sink_err++;
+                close(cap->sock);
+                cap->sock = -1;
+                cap->sink = WIFI_CAPTURE_SINK_NONE;
+                return;
+            }
+            data += n;
+            len -= n;
+        }
+    }
+}
+
+/*!
+    \brief      append data to the staging buffer, flushed to the sink when full
+    \param[in]  cap: capture context
+    \param[in]  data: data to write
+    \param[in]  len: data length
+    \param[out] none
+    \retval     none
+*/
+static void cap_sink_write(struct cap_ctx *cap, const uint8_t *data, uint32_t len)
+{
+    uint32_t n;
+
+    while (len) {
+        n = WIFI_CAPTURE_TX_BUF_SIZE - cap->tx_len;
+        if (n > len)
+            n = len;
+        memcpy(cap->tx_buf + cap->tx_len, data, n);
+        cap->tx_len += n;
+        data += n;
+        len -= n;
+        if (cap->tx_len == WIFI_CAPTURE_TX_BUF_SIZE)
+            cap_sink_flush(cap);
+    }
+}
+
+/*!
+    \brief      open the sink and write the pcap file header
+    \param[in]  cap: capture context
+    \param[out] none
+    \retval     none
+*/
+static void cap_sink_open(struct cap_ctx *cap)
+{
+    struct sockaddr_in addr;
+    uint32_t hdr[6];
+
+    if (cap->sink == WIFI_CAPTURE_SINK_TCP) {
+        cap->sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (cap->sock < 0) {
+            cap->sink = WIFI_CAPTURE_SINK_NONE;
+            goto err;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cap->port);
+        addr.sin_addr.s_addr = cap->ip;
+        if (connect(cap->sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            close(cap->sock);
+            cap->sock = -1;
+            cap->sink = WIFI_CAPTURE_SINK_NONE;
+            goto err;
+        }
+    }
+
+    if (cap->sink == WIFI_CAPTURE_SINK_NONE)
+        return;
+
+    // magic, version 2.4, thiszone, sigfigs, snaplen, linktype
+    hdr[0] = CAP_PCAP_MAGIC;
+    hdr[1] = 2 | (4 << 16);
+    hdr[2] = 0;
+    hdr[3] = 0;
+    hdr[4] = CAP_RADIOTAP_LEN + cap->snap_len;
+    hdr[5] = CAP_PCAP_LINKTYPE;
+    cap_sink_write(cap, (uint8_t *)hdr, sizeof(hdr));
+    cap_sink_flush(cap);
+    return;
+
+err:
+    netlink_printf("capture: connect to tcp server failed, only counting frames\r\n");
+    cap->stats.sink_err++;
+}
+
+/*!
+    \brief      write one record to the sink as a pcap record with a radiotap header
+    \param[in]  cap: capture context
+    \param[in]  rec: ring record
+    \param[out] none
+    \retval     none
+*/
+static void cap_sink_record(struct cap_ctx *cap, struct cap_rec *rec)
+{
+    uint64_t ts = ((uint64_t)rec->ts_hi << 32) | rec->ts_lo;
+    uint32_t pcap[4];
+    uint8_t rt[CAP_RADIOTAP_LEN];
+    uint16_t chan_flags = rec->freq > 4000 ? CAP_RADIOTAP_CHAN_5G : CAP_RADIOTAP_CHAN_2G;
+
+    pcap[0] = (uint32_t)(ts / 1000000);
+    pcap[1] = (uint32_t)(ts % 1000000);
+    pcap[2] = CAP_RADIOTAP_LEN + rec->cap_len;
+    pcap[3] = CAP_RADIOTAP_LEN + rec->orig_len;
+
+    // radiotap fields are little endian
+    rt[0] = 0;
+    rt[1] = 0;
+    rt[2] = CAP_RADIOTAP_LEN;
+    rt[3] = 0;
+    rt[4] = CAP_RADIOTAP_PRESENT & 0xff;
+    rt[5] = (CAP_RADIOTAP_PRESENT >> 8) & 0xff;
+    rt[6] = 0;
+    rt[7] = 0;
+    rt[8] = rec->freq & 0xff;
+    rt[9] = rec->freq >> 8;
+    rt[10] = chan_flags & 0xff;
+    rt[11] = chan_flags >> 8;
+    rt[12] = (uint8_t)rec->rssi;
+
+    cap_sink_write(cap, (uint8_t *)pcap, CAP_PCAP_REC_LEN);
+    cap_sink_write(cap, rt, CAP_RADIOTAP_LEN);
+    cap_sink_write(cap, (uint8_t *)(rec + 1), rec->cap_len);
+}
+
+/*!
+    \brief      move all the records of the ring to the sink
+    \param[in]  cap: capture context
+    \param[out] none
+    \retval     none
+*/
+static void cap_drain(struct cap_ctx *cap)
+{
+    struct cap_rec *rec;
+
+    while ((rec = cap_ring_peek(&cap->ring)) != NULL) {
+        if (cap->sink != WIFI_CAPTURE_SINK_NONE) {
+            cap_sink_record(cap, rec);
+            cap->stats.sent++;
+            cap->stats.sent_bytes += CAP_PCAP_REC_LEN + CAP_RADIOTAP_LEN + rec->cap_len;
+        }
+        cap_ring_release(&cap->ring, rec);
+    }
+    cap_sink_flush(cap);
+}
+
+/*!
+    \brief      capture task, drains the ring to the sink
+    \param[in]  arg: capture context
+    \param[out] none
+    \retval     none
+*/
+static void wifi_capture_task(void *arg)
+{
+    struct cap_ctx *cap = (struct cap_ctx *)arg;
+    uint8_t stop;
+
+    cap_sink_open(cap);
+
+    while (1) {
+        sys_task_wait_notification(WIFI_CAPTURE_FLUSH_MS);
+        // read before draining, so the records put before the stop request are all drained
+        stop = cap->exit;
+        __sync_synchronize();
+        cap->wake_pending = 0;
+        cap_drain(cap);
+        if (stop)
+            break;
+    }
+
+    if (cap->sock >= 0) {
+        close(cap->sock);
+        cap->sock = -1;
+    }
+
+    sys_sema_up(&cap->exit_sema);
+    sys_task_delete(NULL);
+}
+
+/*!
+    \brief      check whether the capture UART also carries the text output of the firmware
+    \param[in]  none
+    \param[out] none
+    \retval     true if the UART is shared, false otherwise
+*/
+static bool cap_uart_shared(void)
+{
+#ifdef LOG_UART
+    if (WIFI_CAPTURE_UART == LOG_UART)
+        return true;
+#endif
+#ifdef CONFIG_ATCMD
+    if (WIFI_CAPTURE_UART == AT_UART)
+        return true;
+#endif
+#ifdef TRACE_UART
+    if (WIFI_CAPTURE_UART == TRACE_UART)
+        return true;
+#endif
+#ifdef HCI_UART
+    if (WIFI_CAPTURE_UART == HCI_UART)
+        return true;
+#endif
+    return false;
+}
+
+/*!
+    \brief      start monitor mode on a channel and capture the frames passing the filter
+    \param[in]  cfg: capture configuration
+    \param[out] none
+    \retval     0 on success, or a negative enum wifi_capture_err
+*/
+int wifi_capture_start(const struct wifi_capture_cfg *cfg)
+{
+    struct cap_ctx *cap = &cap_ctx;
+
+    if (cap->task)
+        return WIFI_CAPTURE_ERR_RUNNING;
+
+    if ((cfg->channel < 1) || (cfg->channel > WIFI_CAPTURE_CHANNEL_NUM) ||
+        (cfg->snap_len > WIFI_CAPTURE_SNAP_LEN_MAX))
+        return WIFI_CAPTURE_ERR_INVAL;
+
+    if (cfg->sink == WIFI_CAPTURE_SINK_UART) {
+        // log or AT text in the middle of the records would corrupt the pcap stream
+        if (cap_uart_shared())
+            return WIFI_CAPTURE_ERR_UART_SHARED;
+        uart_config(WIFI_CAPTURE_UART, WIFI_CAPTURE_UART_BAUDRATE, false, false, false);
+    }
+
+    cap->ring.buf = sys_malloc(WIFI_CAPTURE_RING_SIZE);
+    cap->tx_buf = sys_malloc(WIFI_CAPTURE_TX_BUF_SIZE);
+    if (!cap->ring.buf || !cap->tx_buf)
+        goto err;
+
+    if (sys_sema_init(&cap->exit_sema, 0))
+        goto err;
+
+    cap->ring.head = 0;
+    cap->ring.tail = 0;
+    cap->filter = cfg->filter;
+    cap->snap_len = cfg->snap_len ? cfg->snap_len : WIFI_CAPTURE_SNAP_LEN_DEFAULT;
+    cap->sink = cfg->sink;
+    cap->ip = cfg->ip;
+    cap->port = cfg->port;
+    cap->sock = -1;
+    cap->tx_len = 0;
+    cap->wake_pending = 0;
+    cap->exit = 0;
+
+    cap->task = sys_task_create_dynamic((const uint8_t *)"capture", WIFI_CAPTURE_TASK_STACK_SIZE,
+                                        WIFI_CAPTURE_TASK_PRIO, wifi_capture_task, cap);
+    if (cap->task == NULL) {
+        sys_sema_free(&cap->exit_sema);
+        goto err;
+    }
+
+    cap->active = 1;
+    if (wifi_management_monitor_start(cfg->channel, wifi_capture_rx_cb)) {
+        wifi_capture_stop();
+        return WIFI_CAPTURE_ERR_MONITOR;
+    }
+
+    return 0;
+
+err:
+    if (cap->ring.buf)
+        sys_mfree(cap->ring.buf);
+    if (cap->tx_buf)
+        sys_mfree(cap->tx_buf);
+    cap->ring.buf = NULL;
+    cap->tx_buf = NULL;
+    return WIFI_CAPTURE_ERR_NOMEM;
+}
+
+/*!
+    \brief      stop the capture and flush the remaining frames to the sink
+                Monitor mode is left running, wifi_management_sta_start leaves it.
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void wifi_capture_stop(void)
+{
+    struct cap_ctx *cap = &cap_ctx;
+
+    if (cap->task == NULL)
+        return;
+
+    // the RX callback may still run until it sees active cleared
+    cap->active = 0;
+    while (cap->in_cb)
+        sys_ms_sleep(1);
+
+    cap->exit = 1;
+    sys_task_notify(cap->task, false);
+    sys_sema_down(&cap->exit_sema, 0);
+    sys_sema_free(&cap->exit_sema);
+
+    sys_mfree(cap->ring.buf);
+    sys_mfree(cap->tx_buf);
+    cap->ring.buf = NULL;
+    cap->tx_buf = NULL;
+    cap->task = NULL;
+}
+
+/*!
+    \brief      check whether a capture is running
+    \param[in]  none
+    \param[out] none
+    \retval     true if running
+*/
+bool wifi_capture_running(void)
+{
+    return cap_ctx.task != NULL;
+}
+
+/*!
+    \brief      get the capture statistics, counters are kept between captures
+    \param[in]  reset: clear the counters after reading them
+    \param[out] stats: capture statistics
+    \retval     none
+*/
+void wifi_capture_stats_get(struct wifi_capture_stats *stats, bool reset)
+{
+    sys_memcpy(stats, &cap_ctx.stats, sizeof(*stats));
+    if (reset)
+        sys_memset(&cap_ctx.stats, 0, sizeof(cap_ctx.stats));
+}
+#endif /* CONFIG_WIFI_CAPTURE */
@@ -0,0 +1,156 @@
+/*!
+    \file    wifi_capture.h
+    \brief   Declaration for monitor mode frame capture.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _WIFI_CAPTURE_H_
+#define _WIFI_CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Size of the frame ring filled in the MAC RX context, must be a power of 2 */
+#define WIFI_CAPTURE_RING_SIZE              (16 * 1024)
+/* Default and maximum number of bytes kept from each frame */
+#define WIFI_CAPTURE_SNAP_LEN_DEFAULT       128
+#define WIFI_CAPTURE_SNAP_LEN_MAX           1600
+/* The capture task is woken up when the ring is filled over this level, or every
+   WIFI_CAPTURE_FLUSH_MS otherwise */
+#define WIFI_CAPTURE_WAKE_LEVEL             (WIFI_CAPTURE_RING_SIZE / 2)
+#define WIFI_CAPTURE_FLUSH_MS               20
+/* Output staging buffer, one TCP segment */
+#define WIFI_CAPTURE_TX_BUF_SIZE            1460
+/* UART used by the uart sink. The stream is binary, so it must not be the log, AT,
+   trace or HCI UART, wifi_capture_start rejects the uart sink in that case */
+#define WIFI_CAPTURE_UART                   USART0
+#define WIFI_CAPTURE_UART_BAUDRATE          2000000
+
+#define WIFI_CAPTURE_TASK_STACK_SIZE        512
+#define WIFI_CAPTURE_TASK_PRIO              OS_TASK_PRIORITY(1)
+
+/* 2.4GHz channels, index 0 counts frames received on an unknown frequency */
+#define WIFI_CAPTURE_CHANNEL_NUM            14
+
+/* Filter flags */
+#define WIFI_CAPTURE_FLT_BSSID              0x01
+#define WIFI_CAPTURE_FLT_RSSI               0x02
+
+/* Compiled capture filter, all the enabled checks must pass */
+struct wifi_capture_filter
+{
+    /* bit (type << 4 | subtype) set if the frame type is accepted */
+    uint64_t type_mask;
+    /* WIFI_CAPTURE_FLT_xxx */
+    uint8_t flags;
+    /* minimum rssi in dBm */
+    int8_t rssi_min;
+    uint8_t bssid[6];
+};
+
+enum wifi_capture_sink
+{
+    /* only update the counters */
+    WIFI_CAPTURE_SINK_NONE,
+    /* pcap stream on WIFI_CAPTURE_UART, which must be a dedicated UART */
+    WIFI_CAPTURE_SINK_UART,
+    /* pcap stream to a TCP server */
+    WIFI_CAPTURE_SINK_TCP,
+};
+
+/* Errors returned by wifi_capture_start */
+enum wifi_capture_err
+{
+    /* a capture is already running */
+    WIFI_CAPTURE_ERR_RUNNING = -1,
+    /* invalid channel or snap length */
+    WIFI_CAPTURE_ERR_INVAL = -2,
+    /* out of memory, or the task could not be created */
+    WIFI_CAPTURE_ERR_NOMEM = -3,
+    /* monitor mode could not be started */
+    WIFI_CAPTURE_ERR_MONITOR = -4,
+    /* WIFI_CAPTURE_UART is shared with text output, use the tcp sink */
+    WIFI_CAPTURE_ERR_UART_SHARED = -5,
+};
+
+struct wifi_capture_cfg
+{
+    uint8_t channel;
+    /* bytes kept from each frame, 0 for WIFI_CAPTURE_SNAP_LEN_DEFAULT */
+    uint16_t snap_len;
+    /* enum wifi_capture_sink */
+    uint8_t sink;
+    /* TCP server address (network order) and port */
+    uint32_t ip;
+    uint16_t port;
+    struct wifi_capture_filter filter;
+};
+
+struct wifi_capture_chan_stats
+{
+    /* frames received on the channel */
+    uint32_t rx;
+    /* frames rejected by the filter */
+    uint32_t filtered;
+    /* frames put in the ring */
+    uint32_t captured;
+    /* frames lost because the ring was full */
+    uint32_t dropped;
+};
+
+struct wifi_capture_stats
+{
+    struct wifi_capture_chan_stats chan[WIFI_CAPTURE_CHANNEL_NUM + 1];
+    /* frames written to the sink */
+    uint32_t sent;
+    /* bytes written to the sink */
+    uint32_t sent_bytes;
+    /* sink write errors */
+    uint32_t sink_err;
+    /* highest ring usage in bytes */
+    uint32_t ring_hwm;
+};
+
+/* compile a filter expression */
+int wifi_capture_filter_compile(const char *expr, struct wifi_capture_filter *flt);
+/* check an 802.11 frame against a compiled filter */
+bool wifi_capture_filter_match(const struct wifi_capture_filter *flt, const uint8_t *frame,
+                               uint16_t len, int8_t rssi);
+/* start monitor mode and capture */
+int wifi_capture_start(const struct wifi_capture_cfg *cfg);
+/* stop capture, monitor mode is left running */
+void wifi_capture_stop(void);
+/* check whether a capture is running */
+bool wifi_capture_running(void);
+/* get the capture statistics */
+void wifi_capture_stats_get(struct wifi_capture_stats *stats, bool reset);
+
+#endif /* _WIFI_CAPTURE_H_ */
@@ -253,6 +253,25 @@ static void eloop_event_dispatch(eloop_message_t message)
 int eloop_timeout_register(unsigned int msecs,
                eloop_timeout_handler handler,
                void *eloop_data, void *user_data)
+{
+    return eloop_timeout_register_slack(msecs, 0, handler, eloop_data, user_data);
+}
+
+/*!
+    \brief      register timeout that may expire late
+                Note: the timeout is delayed by up to slack_ms so that timeouts
+                with a slack expire together and wake up the eloop task once.
+    \param[in]  msecs: number of milliseconds to the timeout
+    \param[in]  slack_ms: maximum delay allowed on the timeout in milliseconds
+    \param[in]  handler: callback function to be called when timeout occurs
+    \param[in]  eloop_data: callback context data (eloop_ctx)
+    \param[in]  user_data: callback context data (sock_ctx)
+    \param[out] none
+    \retval     0 on success, -1 on failure
+*/
+int eloop_timeout_register_slack(unsigned int msecs, unsigned int slack_ms,
+               eloop_timeout_handler handler,
+               void *eloop_data, void *user_data)
 {
     struct eloop_timeout *timeout, *tmp;
     SYS_SR_ALLOC();
@@ -266,6 +285,7 @@ int eloop_timeout_register(unsigned int msecs,
 
     timeout->time = sys_current_time_get();
     timeout->time += msecs;
+    timeout->time = SYS_TIME_SLACK_ROUND(timeout->time, slack_ms);
     timeout->eloop_data = eloop_data;
     timeout->user_data = user_data;
     timeout->handler = handler;
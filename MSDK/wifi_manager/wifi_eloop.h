@@ -195,6 +195,23 @@ int eloop_timeout_register(unsigned int msecs,
                eloop_timeout_handler handler,
                void *eloop_data, void *user_data);
 
+/**
+ * eloop_timeout_register_slack - Register timeout that may expire late
+ * @msecs: Number of milliseconds to the timeout
+ * @slack_ms: Maximum delay allowed on the timeout in milliseconds
+ * @handler: Callback function to be called when timeout occurs
+ * @eloop_data: Callback context data (eloop_ctx)
+ * @user_data: Callback context data (sock_ctx)
+ * Returns: 0 on success, -1 on failure
+ *
+ * Register a timeout like eloop_timeout_register() for periodic polling:
+ * the timeout is delayed by up to slack_ms so that polling timeouts expire
+ * together and wake up the event loop task once.
+ */
+int eloop_timeout_register_slack(unsigned int msecs, unsigned int slack_ms,
+               eloop_timeout_handler handler,
+               void *eloop_data, void *user_data);
+
 /**
  * eloop_timeout_cancel - Cancel timeouts
  * @handler: Matching callback function
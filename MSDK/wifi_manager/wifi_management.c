@@ -42,9 +42,16 @@ OF SUCH DAMAGE.
 #include "lwip/dhcp.h"
 #include "lwip/netifapi.h"
 #include "lwip/ip_addr.h"
+#include "lwip/tcpip.h"
 #include "wifi_net_ip.h"
 #include "wifi_init.h"
 #include "dbg_print.h"
+#ifdef CONFIG_WIFI_ROAM_SCAN
+#include "wifi_roam_scan.h"
+#endif
+#ifdef CONFIG_WIFI_STA_TABLE
+#include "wifi_sta_table.h"
+#endif
 
 /*============================ MACROS ========================================*/
 #define STATE_MACHINE_DATA struct wifi_management_sm_data
@@ -53,6 +60,12 @@ OF SUCH DAMAGE.
 /*============================ MACRO FUNCTIONS ===============================*/
 #define GET_SM_STATE(machine)  sm->machine ## _state
 
+#ifdef CONFIG_WIFI_ROAM_SCAN
+#define MGMT_ROAM_DECIDED(sm, roam)     wifi_roam_scan_decided((sm)->vif_idx, roam)
+#else
+#define MGMT_ROAM_DECIDED(sm, roam)
+#endif
+
 /*============================ TYPES =========================================*/
 /*============================ GLOBAL VARIABLES ==============================*/
 wifi_management_sm_data_t wifi_sm_data[CFG_VIF_NUM];
@@ -220,41 +233,84 @@ static int mgmt_wait_queue_flush(void)
 
 /************************ WiFi Management Timeouts ****************************/
 /*!
-    \brief      Callback function for dhcp polling
+    \brief      Callback function for dhcp timeout
     \param[in]  eloop_data: pointer to the eloop data
     \param[in]  user_ctx: pointer to the user parameters
     \param[out] none
     \retval     none
 */
-static void mgmt_dhcp_polling(void *eloop_data, void *user_ctx)
+static void mgmt_dhcp_timeout(void *eloop_data, void *user_ctx)
 {
     wifi_management_sm_data_t *sm = eloop_data;
+
+    wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": DHCP: IP request timeout!\r\n");
+    sm->reason = WIFI_MGMT_CONN_DHCP_FAIL;
+    eloop_event_send(sm->vif_idx, WIFI_MGMT_EVENT_DHCP_FAIL);
+}
+
+/*!
+    \brief      Use the IPv4 address got by DHCP or configured statically
+    \param[in]  sm: pointer to the wifi management state machine data
+    \param[out] none
+    \retval     none
+*/
+static void mgmt_dhcp_done(wifi_management_sm_data_t *sm)
+{
     struct netif *net_if = vif_idx_to_net_if(sm->vif_idx);
     struct wifi_ip_addr_cfg cfg;
 
-    if (net_dhcp_address_obtained(net_if) || net_if_is_static_ip()) {
-        net_if_get_ip(net_if, &(cfg.ipv4.addr), &(cfg.ipv4.mask), &(cfg.ipv4.gw));
-        net_get_dns(&cfg.ipv4.dns);
+    eloop_timeout_cancel(mgmt_dhcp_timeout, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
 
-        wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": IPv4 addr got " IP_FMT "\r\n", IP_ARG(cfg.ipv4.addr));
+    net_if_get_ip(net_if, &(cfg.ipv4.addr), &(cfg.ipv4.mask), &(cfg.ipv4.gw));
+    net_get_dns(&cfg.ipv4.dns);
 
-        net_if_set_default(net_if);
-        net_if_send_gratuitous_arp(net_if);
-        eloop_event_send(sm->vif_idx, WIFI_MGMT_EVENT_DHCP_SUCCESS);
-        return;
+    wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": IPv4 addr got " IP_FMT "\r\n", IP_ARG(cfg.ipv4.addr));
+
+    net_if_set_default(net_if);
+    net_if_send_gratuitous_arp(net_if);
+}
+
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+NETIF_DECLARE_EXT_CALLBACK(mgmt_netif_cb)
+
+/*!
+    \brief      Callback function for the netif status changes, called in the TCPIP task
+                Note: it only posts the events, the state machine runs in the wifi management task.
+    \param[in]  netif: pointer to the network interface which changed
+    \param[in]  reason: LWIP_NSC_xxx flags of the changes
+    \param[in]  args: details of the changes
+    \param[out] none
+    \retval     none
+*/
+static void mgmt_netif_status_cb(struct netif *netif, netif_nsc_reason_t reason, const netif_ext_callback_args_t *args)
+{
+    struct wifi_vif_tag *wvif;
+    int vif_idx;
+
+    for (vif_idx = 0; vif_idx < CFG_VIF_NUM; vif_idx++) {
+        if (vif_idx_to_net_if(vif_idx) == netif)
+            break;
     }
+    if (vif_idx == CFG_VIF_NUM)
+        return;
 
-    if (--sm->dhcp_polling_count) {
-        if ((sm->dhcp_polling_count & 0xF) == 0) {
-            wifi_sm_printf(WIFI_SM_INFO, STATE_MACHINE_DEBUG_PREFIX ": waiting for DHCP done\r\n");
-        }
-        eloop_timeout_register(WIFI_MGMT_DHCP_POLLING_INTERVAL, mgmt_dhcp_polling, sm, NULL);
-    } else {
-        wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": DHCP: IP request timeout!\r\n");
-        sm->reason = WIFI_MGMT_CONN_DHCP_FAIL;
-        eloop_event_send(sm->vif_idx, WIFI_MGMT_EVENT_DHCP_FAIL);
+    wvif = &wifi_vif_tab[vif_idx];
+    if (wvif->wvif_type != WVIF_STA)
+        return;
+
+    /* also issued when DHCP INIT-REBOOT binds the address the interface already had */
+    if ((reason & LWIP_NSC_IPV4_ADDR_VALID) && (wvif->sta.state == WIFI_STA_STATE_IP_GETTING) &&
+        (net_dhcp_address_obtained(netif) || net_if_is_static_ip())) {
+        eloop_event_send(vif_idx, WIFI_MGMT_EVENT_DHCP_SUCCESS);
     }
+#ifdef CONFIG_IPV6_SUPPORT
+    if ((reason & LWIP_NSC_IPV6_ADDR_STATE_CHANGED) && (args->ipv6_addr_state_changed.addr_index == 1) &&
+        ip6_addr_isinvalid(args->ipv6_addr_state_changed.old_state) && wifi_ipv6_is_got(vif_idx)) {
+        eloop_event_send(vif_idx, WIFI_MGMT_EVENT_IPV6_GOT);
+    }
+#endif /* CONFIG_IPV6_SUPPORT */
 }
+#endif /* LWIP_NETIF_EXT_STATUS_CALLBACK */
 
 #ifdef CONFIG_IPV6_SUPPORT
 /*!
@@ -272,7 +328,8 @@ static void mgmt_ipv6_polling(void *eloop_data, void *user_ctx)
     if (wifi_ipv6_is_got(sm->vif_idx)) {
         wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": IPv6 addr got %s\r\n", ip6addr_ntoa(ip_2_ip6(&net_if->ip6_addr[1])));
     } else if (net_if->rs_count) {
-        eloop_timeout_register(WIFI_MGMT_IPV6_POLLING_INTERVAL, mgmt_ipv6_polling, sm, NULL);
+        eloop_timeout_register_slack(WIFI_MGMT_IPV6_POLLING_INTERVAL, WIFI_MGMT_POLLING_SLACK(WIFI_MGMT_IPV6_POLLING_INTERVAL),
+                                     mgmt_ipv6_polling, sm, NULL);
     } else {
         wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": IPv6 addr got timeout!\r\n");
         wifi_ip6_unique_addr_set_invalid(net_if);
@@ -310,7 +367,8 @@ static void mgmt_link_status_polling(void *eloop_data, void *user_ctx)
                 sm->polling_scan_count = WIFI_MGMT_POLLING_SCAN_LONG_LIMIT;
         }
     }
-    eloop_timeout_register(WIFI_MGMT_LINK_POLLING_INTERVAL, mgmt_link_status_polling, sm, NULL);
+    eloop_timeout_register_slack(WIFI_MGMT_LINK_POLLING_INTERVAL, WIFI_MGMT_POLLING_SLACK(WIFI_MGMT_LINK_POLLING_INTERVAL),
+                                 mgmt_link_status_polling, sm, NULL);
 }
 #else
 /*!
@@ -333,13 +391,21 @@ static void mgmt_link_status_polling(void *eloop_data, void *user_ctx)
             sm->preroam_start = 0;
             sm->polling_scan_count = 0;
             sys_memset(sm->preroam_bssid_bk, 0, sizeof(sm->preroam_bssid_bk));
+#ifdef CONFIG_WIFI_ROAM_SCAN
+            wifi_roam_scan_abort(sm->vif_idx);
+#endif
             return;
         }
 
         if (sm->polling_scan_count < 10
                 || (sm->polling_scan_count % WIFI_MGMT_POLLING_SCAN_TRIGGER_POINT == 0)) {
             wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": Start polling scan [%u]\r\n", sm->polling_scan_count);
-#ifdef CFG_80211R
+#if defined(CONFIG_WIFI_ROAM_SCAN)
+            /* scan the channels learnt for the ESS, all of them after some misses */
+            ret = wifi_roam_scan_start(sm->vif_idx, wifi_vif_tab[sm->vif_idx].sta.cfg.ssid);
+            if (ret > 0)
+                ret = 0;
+#elif defined(CFG_80211R)
             if (sm->param) {
                 ret = wifi_netlink_scan_set_with_ssid(sm->vif_idx, (char *)sm->param, 0xFF);
             } else {
@@ -357,7 +423,8 @@ static void mgmt_link_status_polling(void *eloop_data, void *user_ctx)
 
         sm->polling_scan_count++;
 
-        eloop_timeout_register(WIFI_MGMT_LINK_POLLING_INTERVAL, mgmt_link_status_polling, sm, NULL);
+        eloop_timeout_register_slack(WIFI_MGMT_LINK_POLLING_INTERVAL, WIFI_MGMT_POLLING_SLACK(WIFI_MGMT_LINK_POLLING_INTERVAL),
+                                 mgmt_link_status_polling, sm, NULL);
     }
 
 }
@@ -422,9 +489,18 @@ static void mgmt_connected_scan_done(wifi_management_sm_data_t *sm)
 
     wifi_sm_printf(WIFI_SM_INFO, STATE_MACHINE_DEBUG_PREFIX ": polling scan done\r\n");
 
+#ifdef CONFIG_WIFI_ROAM_SCAN
+    ret = wifi_roam_scan_done(sm->vif_idx, &candidate);
+    if (ret > 0) {
+        /* Channel slices remain in this round */
+        return;
+    }
+    sm->polling_scan = false;
+#else
     sm->polling_scan = false;
 
     ret = wifi_netlink_candidate_ap_find(sm->vif_idx, NULL, sta_cfg->ssid, &candidate);
+#endif
     if (ret) {
         /* Not find any ap with the same ssid. Do nothing. */
         return;
@@ -437,6 +513,7 @@ static void mgmt_connected_scan_done(wifi_management_sm_data_t *sm)
     if (sys_memcmp((uint8_t *)candidate.bssid.array, sta_cfg->bssid, WIFI_ALEN) == 0) {
         /* The current AP has the best signal strength. Do nothing. */
         wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": the current AP has the best rssi or no others\r\n");
+        MGMT_ROAM_DECIDED(sm, false);
         return;
     }
 
@@ -448,6 +525,7 @@ static void mgmt_connected_scan_done(wifi_management_sm_data_t *sm)
 #ifdef CONFIG_WPA_SUPPLICANT
         char buffer[32];
         co_snprintf(buffer, sizeof(buffer), MAC_FMT, MAC_ARG(candidate.bssid.array));
+        MGMT_ROAM_DECIDED(sm, true);
         wifi_wpa_roaming_start(sm->vif_idx, buffer);
 #else
         rssi = macif_vif_sta_rssi_get(sm->vif_idx);
@@ -457,8 +535,10 @@ static void mgmt_connected_scan_done(wifi_management_sm_data_t *sm)
             struct mac_scan_result *target_ap = (struct mac_scan_result *)sys_malloc(sizeof(struct mac_scan_result));
             if (target_ap == NULL) {
                 wifi_sm_printf(WIFI_SM_ERROR, STATE_MACHINE_DEBUG_PREFIX ": Failed to allocate memory for target AP\r\n");
+                MGMT_ROAM_DECIDED(sm, false);
                 return;
             }
+            MGMT_ROAM_DECIDED(sm, true);
             sys_memcpy(target_ap, &candidate, sizeof(struct mac_scan_result));
             wifi_sm_printf(WIFI_SM_INFO, STATE_MACHINE_DEBUG_PREFIX ": target AP found ("MAC_FMT")\r\n", MAC_ARG(candidate.bssid.array));
             eloop_message_send(sm->vif_idx, WIFI_MGMT_EVENT_FT_ROAMING_CMD, 0,
@@ -467,6 +547,7 @@ static void mgmt_connected_scan_done(wifi_management_sm_data_t *sm)
         } else {
             wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": the targe ap isn't good enough(%d - %d < %d)\r\n",
                 candidate.rssi, rssi, WIFI_MGMT_ROAMING_RSSI_RELATIVE_GAIN);
+            MGMT_ROAM_DECIDED(sm, false);
         }
 #endif
     } else
@@ -477,10 +558,12 @@ static void mgmt_connected_scan_done(wifi_management_sm_data_t *sm)
         if (candidate.rssi >= rssi + WIFI_MGMT_ROAMING_RSSI_RELATIVE_GAIN) {
             wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": try roaming to a better AP\r\n");
             sta_cfg->channel = wifi_freq_to_channel(candidate.chan->freq);
+            MGMT_ROAM_DECIDED(sm, true);
             eloop_event_send(sm->vif_idx, WIFI_MGMT_EVENT_CONNECT_CMD);
         } else {
             wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": the targe ap isn't good enough(%d - %d < %d)\r\n",
                 candidate.rssi, rssi, WIFI_MGMT_ROAMING_RSSI_RELATIVE_GAIN);
+            MGMT_ROAM_DECIDED(sm, false);
         }
     }
 }
@@ -669,9 +752,12 @@ SM_STATE(MAINTAIN_CONNECTION, IDLE)
 #endif
     sm->delayed_connect_retry = 0;
 
-    eloop_timeout_cancel(mgmt_dhcp_polling, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
+    eloop_timeout_cancel(mgmt_dhcp_timeout, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
     eloop_timeout_cancel(mgmt_link_status_polling, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
     eloop_timeout_cancel(mgmt_connect_retry, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
+#ifdef CONFIG_WIFI_ROAM_SCAN
+    wifi_roam_scan_abort(sm->vif_idx);
+#endif
 
     ret = wifi_netlink_disconnect_req(sm->vif_idx);
     if (ret) {
@@ -716,8 +802,11 @@ SM_STATE(MAINTAIN_CONNECTION, SCAN)
     SM_ENTRY(MAINTAIN_CONNECTION, SCAN);
     config_sta->state = WIFI_STA_STATE_SCAN;
 
-    eloop_timeout_cancel(mgmt_dhcp_polling, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
+    eloop_timeout_cancel(mgmt_dhcp_timeout, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
     eloop_timeout_cancel(mgmt_link_status_polling, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
+#ifdef CONFIG_WIFI_ROAM_SCAN
+    wifi_roam_scan_abort(sm->vif_idx);
+#endif
 
     if (sm->delayed_connect_retry) // delay the connect
         return;
@@ -795,23 +884,27 @@ SM_STATE(MAINTAIN_CONNECTION, DHCP)
     if (!net_if)
         return;
 
-    if (!net_if_is_static_ip()) {
-        if (net_dhcp_address_obtained(net_if)) {
-#if 0 /* Marked here to continue iperf after reconnect  */
-            /* if ip has been get before, clear it and get a new one */
-            ip_cfg.mode = IP_ADDR_NONE;
-            wifi_set_vif_ip(sm->vif_idx, &ip_cfg);
-#endif
-        }
+    if (net_if_is_static_ip()) {
+        eloop_event_send(sm->vif_idx, WIFI_MGMT_EVENT_DHCP_SUCCESS);
+        return;
+    }
 
-        sm->dhcp_polling_count = WIFI_MGMT_DHCP_POLLING_LIMIT;
-        ip_cfg.mode = IP_ADDR_DHCP_CLIENT;
-        ip_cfg.default_output = true;
-        ip_cfg.dhcp.to_ms = 0;
+    if (net_dhcp_address_obtained(net_if)) {
+#if 0 /* Marked here to continue iperf after reconnect  */
+        /* if ip has been get before, clear it and get a new one */
+        ip_cfg.mode = IP_ADDR_NONE;
         wifi_set_vif_ip(sm->vif_idx, &ip_cfg);
+#endif
     }
-    wifi_sm_printf(WIFI_SM_INFO, STATE_MACHINE_DEBUG_PREFIX ": start polling DHCP status\r\n");
-    eloop_timeout_register(WIFI_MGMT_DHCP_POLLING_INTERVAL, mgmt_dhcp_polling, sm, NULL);
+
+    /* the lease is reported by mgmt_netif_status_cb */
+    wifi_sm_printf(WIFI_SM_INFO, STATE_MACHINE_DEBUG_PREFIX ": start DHCP\r\n");
+    eloop_timeout_register(WIFI_MGMT_DHCP_TIMEOUT, mgmt_dhcp_timeout, sm, NULL);
+
+    ip_cfg.mode = IP_ADDR_DHCP_CLIENT;
+    ip_cfg.default_output = true;
+    ip_cfg.dhcp.to_ms = 0;
+    wifi_set_vif_ip(sm->vif_idx, &ip_cfg);
 }
 
 SM_STATE(MAINTAIN_CONNECTION, CONNECTED)
@@ -833,7 +926,8 @@ SM_STATE(MAINTAIN_CONNECTION, CONNECTED)
     if (wifi_ipv6_is_got(sm->vif_idx)) {
         wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": DHCP got ip6 %s\r\n", ip6addr_ntoa(ip_2_ip6(&wvif->net_if.ip6_addr[1])));
     } else {
-        eloop_timeout_register(WIFI_MGMT_IPV6_POLLING_INTERVAL, mgmt_ipv6_polling, sm, NULL);
+        eloop_timeout_register_slack(WIFI_MGMT_IPV6_POLLING_INTERVAL, WIFI_MGMT_POLLING_SLACK(WIFI_MGMT_IPV6_POLLING_INTERVAL),
+                                     mgmt_ipv6_polling, sm, NULL);
     }
 #endif /* CONFIG_IPV6_SUPPORT */
 
@@ -843,6 +937,9 @@ SM_STATE(MAINTAIN_CONNECTION, CONNECTED)
     sm->polling_scan_count = 0;
     sys_memset(sm->preroam_bssid_bk, 0, sizeof(sm->preroam_bssid_bk));
     sta->cfg.conn_with_bssid = false;  // clear here to find the same ssid with higher rssi after disconnect
+#ifdef CONFIG_WIFI_ROAM_SCAN
+    wifi_roam_scan_connected(sm->vif_idx, sta->cfg.ssid);
+#endif
 
     net_if_get_ip(&wvif->net_if, &ip, NULL, NULL);
 #ifdef CONFIG_FAST_RECONNECT
@@ -1143,7 +1240,13 @@ SM_STEP(MAINTAIN_CONNECTION)
         case WIFI_MGMT_EVENT_RX_EAPOL:
             wifi_wpa_sta_sm_step(sm->vif_idx, WIFI_MGMT_EVENT_RX_EAPOL, sm->param, sm->param_len, WIFI_STA_SM_EAPOL);
             break;
+#ifdef CONFIG_IPV6_SUPPORT
+        case WIFI_MGMT_EVENT_IPV6_GOT:
+            /* checked when entering CONNECTED */
+            break;
+#endif /* CONFIG_IPV6_SUPPORT */
         case WIFI_MGMT_EVENT_DHCP_SUCCESS:
+            mgmt_dhcp_done(sm);
             wifi_netlink_dhcp_done(sm->vif_idx);
             SM_ENTER(MAINTAIN_CONNECTION, CONNECTED);
             eloop_timeout_cancel(mgmt_connect_retry, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
@@ -1241,9 +1344,18 @@ SM_STEP(MAINTAIN_CONNECTION)
                 struct wifi_sta *config_sta = &wifi_vif_tab[sm->vif_idx].sta;
                 sm->preroam_start = 1;
                 sys_memcpy(sm->preroam_bssid_bk, config_sta->cfg.bssid, WIFI_ALEN);
+#ifdef CONFIG_WIFI_ROAM_SCAN
+                wifi_roam_scan_trigger(sm->vif_idx);
+#endif
                 eloop_timeout_register(1, mgmt_link_status_polling, sm, NULL);
             }
             break;
+#ifdef CONFIG_IPV6_SUPPORT
+        case WIFI_MGMT_EVENT_IPV6_GOT:
+            eloop_timeout_cancel(mgmt_ipv6_polling, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
+            mgmt_ipv6_polling(sm, NULL);
+            break;
+#endif /* CONFIG_IPV6_SUPPORT */
 #ifndef CONFIG_WPA_SUPPLICANT
         case WIFI_MGMT_EVENT_RX_UNPROT_DEAUTH:
             wpas_unprot_disconnect(sm->vif_idx, sm->param, sm->param_len);
@@ -1306,6 +1418,9 @@ SM_STATE(MAINTAIN_SOFTAP, INIT)
     SM_ENTRY(MAINTAIN_SOFTAP, INIT);
 
     wifi_netlink_ap_stop(sm->vif_idx);
+#ifdef CONFIG_WIFI_STA_TABLE
+    wifi_sta_table_clear(sm->vif_idx);
+#endif
 
     wvif->ap.ap_state = WIFI_AP_STATE_INIT;
 }
@@ -1367,6 +1482,9 @@ SM_STEP(MAINTAIN_SOFTAP)
             uint8_t new_channel = sm->reason;
 
             wifi_netlink_ap_stop(sm->vif_idx);
+#ifdef CONFIG_WIFI_STA_TABLE
+            wifi_sta_table_clear(sm->vif_idx);
+#endif
             wvif->ap.ap_state = WIFI_AP_STATE_INIT;
 
             wifi_vif_tab[sm->vif_idx].ap.cfg.channel = new_channel;
@@ -1378,10 +1496,22 @@ SM_STEP(MAINTAIN_SOFTAP)
         case WIFI_MGMT_EVENT_CLIENT_ADDED:
             // add user callback here
             wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": Add client "MAC_FMT"\r\n", MAC_ARG_UINT8(sm->param));
+#ifdef CONFIG_WIFI_STA_TABLE
+            if (sm->param_len >= WIFI_ALEN + 4) {
+                wifi_sta_table_add(sm->vif_idx, sm->param,
+                                   sm->param[WIFI_ALEN] | (sm->param[WIFI_ALEN + 1] << 8),
+                                   sm->param[WIFI_ALEN + 2] | (sm->param[WIFI_ALEN + 3] << 8));
+            } else {
+                wifi_sta_table_add(sm->vif_idx, sm->param, 0, 0);
+            }
+#endif
             break;
         case WIFI_MGMT_EVENT_CLIENT_REMOVED:
             // add user callback here
             wifi_sm_printf(WIFI_SM_NOTICE, STATE_MACHINE_DEBUG_PREFIX ": Delete client "MAC_FMT"\r\n", MAC_ARG_UINT8(sm->param));
+#ifdef CONFIG_WIFI_STA_TABLE
+            wifi_sta_table_del(sm->param);
+#endif
             break;
         case WIFI_MGMT_EVENT_SCAN_CMD:
             if (sm->param) {
@@ -2362,6 +2492,12 @@ int wifi_management_init(void)
 
     wifi_eloop_init();
 
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+    LOCK_TCPIP_CORE();
+    netif_add_ext_callback(&mgmt_netif_cb, mgmt_netif_status_cb);
+    UNLOCK_TCPIP_CORE();
+#endif
+
     /* Wifi management sm init */
     eloop_event_send(WIFI_VIF_INDEX_DEFAULT, WIFI_MGMT_EVENT_INIT);
 
@@ -2380,6 +2516,11 @@ int wifi_management_init(void)
 */
 void wifi_management_deinit(void)
 {
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+    LOCK_TCPIP_CORE();
+    netif_remove_ext_callback(&mgmt_netif_cb);
+    UNLOCK_TCPIP_CORE();
+#endif
     wifi_eloop_terminate();
     wifi_wait_terminated(WIFI_MGMT_TASK);
 }
@@ -65,8 +65,7 @@ extern "C" {
     (((WIFI_MGMT_CONNECT_RETRY_LIMIT) * (WIFI_MGMT_CONNECT_RETRY_LIMIT - 1) * \
     (WIFI_MGMT_CONNECT_RETRY_INTERVAL) >> 1) + 14000)   // 20s in total
 #define WIFI_MGMT_WPS_CONNECT_BLOCK_TIME        120000  // 2 minutes
-#define WIFI_MGMT_DHCP_POLLING_LIMIT            200     // max polling times
-#define WIFI_MGMT_DHCP_POLLING_INTERVAL         100     // unit: ms
+#define WIFI_MGMT_DHCP_TIMEOUT                  20000   // unit: ms
 
 #ifdef CONFIG_IPV6_SUPPORT
 /** Router solicitations are sent in 4 second intervals (see RFC 4861, ch. 6.3.7) */
@@ -74,6 +73,7 @@ extern "C" {
 #endif /* CONFIG_IPV6_SUPPORT */
 
 #define WIFI_MGMT_LINK_POLLING_INTERVAL         3000   // unit: ms
+#define WIFI_MGMT_POLLING_SLACK(interval)       ((interval) / 4)    // polling may run late by a quarter of its interval
 #define WIFI_MGMT_POLLING_SCAN_TRIGGER_POINT    10      // 10 * WIFI_MGMT_LINK_POLLING_INTERVAL
 #define WIFI_MGMT_ROAMING_RSSI_RELATIVE_GAIN    10      // dBm
 
@@ -203,6 +203,8 @@ typedef enum {
 
     WIFI_MGMT_EVENT_FT_ROAMING_CMD,
 
+    WIFI_MGMT_EVENT_IPV6_GOT,
+
     WIFI_MGMT_EVENT_MAX,
     WIFI_MGMT_EVENT_NUM = WIFI_MGMT_EVENT_MAX - WIFI_MGMT_EVENT_START - 1,
 } wifi_management_event_t;
@@ -263,7 +265,6 @@ typedef struct wifi_management_sm_data {
     uint8_t *wps_bcn;
     uint32_t wps_bcn_len;
 #endif
-    uint8_t dhcp_polling_count;
     uint8_t delayed_connect_retry;
     uint32_t retry_count;
     uint32_t retry_limit;
@@ -39,6 +39,7 @@ OF SUCH DAMAGE.
 #include "wifi_vif.h"
 #include "wifi_export.h"
 #include "lwip/netif.h"
+#include "lwip/tcpip.h"
 #include "dbg_print.h"
 #include "string.h"
 
@@ -73,6 +74,77 @@ static int wifi_dhcp_stop(struct netif *net_if)
     return 0;
 }
 
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+static os_sema_t dhcp_wait_sema;
+static struct netif *dhcp_wait_netif;
+NETIF_DECLARE_EXT_CALLBACK(dhcp_wait_cb)
+
+/*!
+    \brief      netif status callback used to wake up wifi_dhcp_start, run in tcpip thread
+    \param[in]  netif: pointer to the network interface
+    \param[in]  reason: change reason
+    \param[in]  args: change arguments
+    \param[out] none
+    \retval     none
+*/
+static void wifi_dhcp_wait_status_cb(struct netif *netif, netif_nsc_reason_t reason,
+                                     const netif_ext_callback_args_t *args)
+{
+    if ((netif != dhcp_wait_netif) || !(reason & LWIP_NSC_IPV4_ADDR_VALID))
+        return;
+
+    if (net_dhcp_address_obtained(netif) || net_if_is_static_ip())
+        sys_sema_up(&dhcp_wait_sema);
+}
+
+/*!
+    \brief      start waiting for the address of the network interface
+    \param[in]  net_if: pointer to the network interface
+    \param[out] none
+    \retval     0 on success, -1 if another task is already waiting
+*/
+static int wifi_dhcp_wait_begin(struct netif *net_if)
+{
+    // Claim the waiter slot first, the semaphore belongs to the task that claimed it
+    LOCK_TCPIP_CORE();
+    if (dhcp_wait_netif != NULL) {
+        UNLOCK_TCPIP_CORE();
+        return -1;
+    }
+    dhcp_wait_netif = net_if;
+    UNLOCK_TCPIP_CORE();
+
+    if (sys_sema_init(&dhcp_wait_sema, 0)) {
+        LOCK_TCPIP_CORE();
+        dhcp_wait_netif = NULL;
+        UNLOCK_TCPIP_CORE();
+        return -1;
+    }
+
+    LOCK_TCPIP_CORE();
+    netif_add_ext_callback(&dhcp_wait_cb, wifi_dhcp_wait_status_cb);
+    UNLOCK_TCPIP_CORE();
+
+    return 0;
+}
+
+/*!
+    \brief      stop waiting for the address of the network interface
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void wifi_dhcp_wait_end(void)
+{
+    LOCK_TCPIP_CORE();
+    netif_remove_ext_callback(&dhcp_wait_cb);
+    dhcp_wait_netif = NULL;
+    UNLOCK_TCPIP_CORE();
+
+    sys_sema_free(&dhcp_wait_sema);
+}
+#endif /* LWIP_NETIF_EXT_STATUS_CALLBACK */
+
 /**
  ******************************************************************************
  * @brief Retrieve IP address using DHCP
@@ -89,16 +161,29 @@ static int wifi_dhcp_stop(struct netif *net_if)
 static int wifi_dhcp_start(struct netif *net_if, uint32_t to_ms)
 {
     uint32_t start_ms;
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+    bool wait = false;
+#endif
 
     if (!netif_is_up(net_if)) {
         dbg_print(WARNING, "net_if is not up, stop dhcp\r\n");
         return -1;
     }
 
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+    // Register before starting so that a fast ACK is not missed
+    if (to_ms != 0)
+        wait = (wifi_dhcp_wait_begin(net_if) == 0);
+#endif
+
     // Run DHCP client
     if (net_dhcp_start(net_if))
     {
         dbg_print(ERR, "Failed to start DHCP\r\n");
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+        if (wait)
+            wifi_dhcp_wait_end();
+#endif
         return -1;
     }
 
@@ -106,12 +191,22 @@ static int wifi_dhcp_start(struct netif *net_if, uint32_t to_ms)
         return 0;
     }
 
-    start_ms = sys_os_now(false);
-    while ((!net_dhcp_address_obtained(net_if)) &&
-           (sys_os_now(false) - start_ms < to_ms) &&
-           !net_if_is_static_ip())
+#if LWIP_NETIF_EXT_STATUS_CALLBACK
+    if (wait) {
+        if (!net_dhcp_address_obtained(net_if) && !net_if_is_static_ip())
+            sys_sema_down(&dhcp_wait_sema, to_ms);
+        wifi_dhcp_wait_end();
+    } else
+#endif
     {
-        sys_ms_sleep(100);
+        // Another task is already waiting, fall back to polling
+        start_ms = sys_os_now(false);
+        while ((!net_dhcp_address_obtained(net_if)) &&
+               (sys_os_now(false) - start_ms < to_ms) &&
+               !net_if_is_static_ip())
+        {
+            sys_ms_sleep(100);
+        }
     }
 
     if (!net_dhcp_address_obtained(net_if) && !net_if_is_static_ip())
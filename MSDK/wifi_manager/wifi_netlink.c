@@ -555,6 +555,8 @@ uint8_t wifi_netlink_auto_conn_get(void)
 
 /*!
     \brief      Store infomation of connected AP if enable auto connection
+                The AP information and the auto connection flag are written in one
+                nvds transaction, so a reset never leaves one without the other.
     \param[in]  cfg: pointer to the information of AP
     \param[in]  ip: IP address
     \param[out] none
@@ -564,6 +566,9 @@ int wifi_netlink_joined_ap_store(struct sta_cfg *cfg, uint32_t ip)
 {
     struct auto_conn_info info;
     uint32_t total_len;
+    uint8_t auto_conn_enable = 1;
+    void *txn;
+    int ret;
 
     //ip
     info.ip_addr = ip;
@@ -585,7 +590,21 @@ int wifi_netlink_joined_ap_store(struct sta_cfg *cfg, uint32_t ip)
     netlink_printf("Store ssid = %s passphrase = %s channel = %d ip = "IP_FMT"\r\n",
                     cfg->ssid, cfg->passphrase, cfg->channel, IP_ARG(info.ip_addr));
 
-    return nvds_data_put(NULL, NVDS_NS_WIFI_INFO, WIFI_AUTO_CONN_AP_INFO, (uint8_t *)(&info), total_len);
+    txn = nvds_txn_begin(NULL);
+    if (txn == NULL)
+        return -1;
+
+    /* an unchanged value is dropped by the commit, only the new AP is written */
+    ret = nvds_txn_put(txn, NVDS_NS_WIFI_INFO, WIFI_AUTO_CONN_AP_INFO, (uint8_t *)(&info), total_len);
+    if (ret == 0)
+        ret = nvds_txn_put(txn, NVDS_NS_WIFI_INFO, WIFI_AUTO_CONN_EN,
+                            (uint8_t *)(&auto_conn_enable), sizeof(uint8_t));
+    if (ret != 0) {
+        nvds_txn_abort(txn);
+        return ret;
+    }
+
+    return nvds_txn_commit(txn);
 }
 
 /*!
@@ -694,6 +713,51 @@ int wifi_netlink_scan_set_with_ssid(int vif_idx, char *ssid, uint8_t channel)
     return 0;
 }
 
+/*!
+    \brief      Config and start wifi scan on a list of channels with a given dwell time
+    \param[in]  vif_idx: index of the wifi vif
+    \param[in]  ssid: pointer to the ssid to probe, NULL for wildcard
+    \param[in]  freqs: zero terminated list of frequencies in MHz, NULL for all channels
+    \param[in]  duration: scan duration per channel in TU, 0 for the default one
+    \param[out] none
+    \retval     0 on success and != 0 if error occured.
+*/
+int wifi_netlink_scan_set_with_freqs(int vif_idx, const char *ssid, int *freqs, int duration)
+{
+    struct macif_cmd_scan cmd;
+    struct macif_cmd_resp resp;
+    struct macif_scan_ssid scan_ssid = {NULL, 0};
+    char str_ssid[MAC_SSID_MAX_LEN + 1];
+
+    if (ssid) {
+        if (strlen(ssid) > MAC_SSID_MAX_LEN)
+            return -1;
+        scan_ssid.len = strlen(ssid);
+        strcpy(str_ssid, ssid);
+        scan_ssid.ssid = str_ssid;
+    }
+
+    sys_memset((void *)&cmd, 0, sizeof(cmd));
+    cmd.hdr.len = sizeof(cmd);
+    cmd.hdr.id = MACIF_SCAN_CMD;
+    cmd.vif_idx = vif_idx;
+    cmd.ssids = &scan_ssid;
+    cmd.ssid_cnt = 1;
+    cmd.freqs = freqs;
+    cmd.extra_ies = NULL;
+    cmd.bssid = NULL;
+    cmd.extra_ies_len = 0;
+    cmd.no_cck = 0;
+    cmd.duration = duration;
+    cmd.passive = false;
+    cmd.sock = -1;
+
+    if (macif_cmd_send(&cmd.hdr, &resp.hdr) ||
+        (resp.status != MACIF_STATUS_SUCCESS))
+        return -2;
+    return 0;
+}
+
 /*!
     \brief      Config and start wifi scan
     \param[in]  vif_idx: index of the wifi vif
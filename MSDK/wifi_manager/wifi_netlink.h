@@ -98,6 +98,7 @@ void wifi_netlink_wireless_mode_print(uint32_t wireless_mode);
 int wifi_netlink_status_print(void);
 int wifi_netlink_scan_set(int vif_idx, uint8_t channel);
 int wifi_netlink_scan_set_with_ssid(int vif_idx, char *ssid, uint8_t channel);
+int wifi_netlink_scan_set_with_freqs(int vif_idx, const char *ssid, int *freqs, int duration);
 int wifi_netlink_scan_set_with_extraie(int vif_idx, uint8_t channel,
                                             uint8_t *extra_ie, uint32_t extra_ie_len);
 int wifi_netlink_scan_results_get(int vif_idx, struct macif_scan_results *results);
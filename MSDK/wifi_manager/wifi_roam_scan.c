@@ -0,0 +1,539 @@
+/*!
+    \file    wifi_roam_scan.c
+    \brief   Roaming scanner with per-ESS channel history.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "app_cfg.h"
+
+#ifdef CONFIG_WIFI_ROAM_SCAN
+#include <string.h>
+#include "wrapper_os.h"
+#include "wifi_export.h"
+#include "wifi_management.h"
+#include "wifi_netlink.h"
+#include "wifi_roam_scan.h"
+#include "macif_vif.h"
+#include "nvds_flash.h"
+
+#define ROAM_CHAN_BIT(ch)               (1 << ((ch) - 1))
+#define ROAM_CHAN_ALL                   ((1 << WIFI_ROAM_CHANNEL_NUM) - 1)
+
+/* Channel history of an ESS, as stored in NVDS */
+struct roam_ess
+{
+    /* hash of the SSID, 0 if the entry is free */
+    uint32_t ssid_hash;
+    uint8_t score[WIFI_ROAM_CHANNEL_NUM];
+    /* rounds since the entry was last used */
+    uint8_t age;
+    uint8_t rsvd;
+};
+
+struct roam_scan_ctx
+{
+    uint8_t loaded;
+    uint8_t dirty;
+    /* a round is running */
+    uint8_t busy;
+    /* the current (or last) round scans all the channels */
+    uint8_t full;
+    /* partial rounds in a row without roaming */
+    uint8_t misses;
+    uint8_t triggered;
+    uint8_t vif_idx;
+    uint8_t plan_num;
+    uint8_t plan_idx;
+    uint8_t plan[WIFI_ROAM_PLAN_CHAN_MAX];
+    /* zero terminated frequency list of the current slice */
+    int freqs[WIFI_ROAM_SLICE_CHAN_NUM + 1];
+    /* channels scanned in the round and channels the ESS was seen on */
+    uint16_t scanned_mask;
+    uint16_t seen_mask;
+    char ssid[MAC_SSID_LEN + 1];
+    uint8_t ssid_len;
+    uint8_t best_valid;
+    uint32_t ssid_hash;
+    /* best AP of the ESS found in the round */
+    struct mac_scan_result best;
+    uint32_t slice_start;
+    uint32_t trigger_time;
+    uint32_t last_save;
+    struct roam_ess ess[WIFI_ROAM_ESS_NUM];
+    struct wifi_roam_scan_stats stats;
+};
+
+static struct roam_scan_ctx roam;
+
+/*!
+    \brief      Compute the hash of an SSID (FNV-1a)
+    \param[in]  ssid: pointer to the SSID
+    \param[in]  len: length of the SSID
+    \param[out] none
+    \retval     the hash, never 0
+*/
+static uint32_t roam_ssid_hash(const char *ssid, uint8_t len)
+{
+    uint32_t hash = 2166136261UL;
+    uint8_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (uint8_t)ssid[i];
+        hash *= 16777619UL;
+    }
+    return hash ? hash : 1;
+}
+
+/*!
+    \brief      Load the channel history from NVDS once
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void roam_history_load(void)
+{
+    uint32_t len = sizeof(roam.ess);
+
+    if (roam.loaded)
+        return;
+    roam.loaded = 1;
+    if (nvds_data_get(NULL, NVDS_NS_WIFI_INFO, WIFI_ROAM_NVDS_KEY, (uint8_t *)roam.ess, &len)
+            || (len != sizeof(roam.ess))) {
+        sys_memset(roam.ess, 0, sizeof(roam.ess));
+    }
+}
+
+/*!
+    \brief      Write the channel history to NVDS if it changed
+    \param[in]  force: write even if the last write is recent
+    \param[out] none
+    \retval     none
+*/
+static void roam_history_save(bool force)
+{
+    uint32_t now = sys_current_time_get();
+
+    if (!roam.dirty)
+        return;
+    if (!force && roam.last_save && (now - roam.last_save < WIFI_ROAM_SAVE_INTERVAL_MS))
+        return;
+    if (nvds_data_put(NULL, NVDS_NS_WIFI_INFO, WIFI_ROAM_NVDS_KEY, (uint8_t *)roam.ess, sizeof(roam.ess)) == 0) {
+        roam.dirty = 0;
+        roam.last_save = now;
+        roam.stats.nvds_save++;
+    }
+}
+
+/*!
+    \brief      Find the history entry of an ESS
+    \param[in]  hash: hash of the SSID
+    \param[in]  create: replace the least recently used entry if not found
+    \param[out] none
+    \retval     pointer to the entry, NULL if not found
+*/
+static struct roam_ess *roam_ess_get(uint32_t hash, bool create)
+{
+    struct roam_ess *ess = NULL;
+    int i;
+
+    for (i = 0; i < WIFI_ROAM_ESS_NUM; i++) {
+        if (roam.ess[i].ssid_hash == hash) {
+            ess = &roam.ess[i];
+            break;
+        }
+    }
+    if (ess == NULL) {
+        if (!create)
+            return NULL;
+        /* a free entry, or the least recently used one */
+        ess = &roam.ess[0];
+        for (i = 1; (i < WIFI_ROAM_ESS_NUM) && ess->ssid_hash; i++) {
+            if ((roam.ess[i].ssid_hash == 0) || (roam.ess[i].age > ess->age))
+                ess = &roam.ess[i];
+        }
+        sys_memset(ess, 0, sizeof(*ess));
+        ess->ssid_hash = hash;
+        roam.dirty = 1;
+    }
+
+    for (i = 0; i < WIFI_ROAM_ESS_NUM; i++) {
+        if (roam.ess[i].age < 0xFF)
+            roam.ess[i].age++;
+    }
+    ess->age = 0;
+    return ess;
+}
+
+/*!
+    \brief      Update the channel scores of an ESS
+    \param[in]  ess: pointer to the history entry
+    \param[in]  seen_mask: channels the ESS was seen on
+    \param[in]  scanned_mask: channels that were scanned
+    \param[out] none
+    \retval     true if a new channel was learnt
+*/
+static bool roam_ess_learn(struct roam_ess *ess, uint16_t seen_mask, uint16_t scanned_mask)
+{
+    bool new_chan = false;
+    int ch;
+
+    for (ch = 1; ch <= WIFI_ROAM_CHANNEL_NUM; ch++) {
+        uint8_t *score = &ess->score[ch - 1];
+
+        if (seen_mask & ROAM_CHAN_BIT(ch)) {
+            if (*score == 0)
+                new_chan = true;
+            if (*score < WIFI_ROAM_SCORE_MAX) {
+                *score = (*score + WIFI_ROAM_SCORE_SEEN > WIFI_ROAM_SCORE_MAX) ?
+                         WIFI_ROAM_SCORE_MAX : *score + WIFI_ROAM_SCORE_SEEN;
+                roam.dirty = 1;
+            }
+        } else if ((scanned_mask & ROAM_CHAN_BIT(ch)) && *score) {
+            (*score)--;
+            roam.dirty = 1;
+        }
+    }
+    return new_chan;
+}
+
+/*!
+    \brief      Select the best scored channels of an ESS
+    \param[in]  ess: pointer to the history entry
+    \param[out] none
+    \retval     number of channels in roam.plan
+*/
+static uint8_t roam_plan_build(struct roam_ess *ess)
+{
+    uint16_t used = 0;
+    uint8_t n, ch, best;
+
+    for (n = 0; n < WIFI_ROAM_PLAN_CHAN_MAX; n++) {
+        best = 0;
+        for (ch = 1; ch <= WIFI_ROAM_CHANNEL_NUM; ch++) {
+            if ((used & ROAM_CHAN_BIT(ch)) || (ess->score[ch - 1] == 0))
+                continue;
+            if ((best == 0) || (ess->score[ch - 1] > ess->score[best - 1]))
+                best = ch;
+        }
+        if (best == 0)
+            break;
+        used |= ROAM_CHAN_BIT(best);
+        roam.plan[n] = best;
+    }
+    return n;
+}
+
+/*!
+    \brief      Start the next scan of the round
+    \param[in]  none
+    \param[out] none
+    \retval     0 on success and != 0 if error occured.
+*/
+static int roam_slice_start(void)
+{
+    int n;
+
+    roam.slice_start = sys_current_time_get();
+    if (roam.full)
+        return wifi_netlink_scan_set_with_freqs(roam.vif_idx, roam.ssid, NULL, 0);
+
+    for (n = 0; (n < WIFI_ROAM_SLICE_CHAN_NUM) && (roam.plan_idx < roam.plan_num); n++) {
+        roam.freqs[n] = wifi_channel_to_freq(roam.plan[roam.plan_idx]);
+        roam.scanned_mask |= ROAM_CHAN_BIT(roam.plan[roam.plan_idx]);
+        roam.plan_idx++;
+    }
+    roam.freqs[n] = 0;
+    roam.stats.slices++;
+    return wifi_netlink_scan_set_with_freqs(roam.vif_idx, roam.ssid, roam.freqs,
+                                            WIFI_ROAM_SLICE_DWELL_TU);
+}
+
+/*!
+    \brief      Timeout of the gap between two slices
+    \param[in]  eloop_data: pointer to the eloop data
+    \param[in]  user_ctx: pointer to the user parameters
+    \param[out] none
+    \retval     none
+*/
+static void roam_next_slice(void *eloop_data, void *user_ctx)
+{
+    if (!roam.busy)
+        return;
+    if (roam_slice_start()) {
+        /* e.g. a user scan is running, the round starts again at the next link polling */
+        wifi_sm_printf(WIFI_SM_WARNING, "roam scan: start slice failed\r\n");
+        roam.busy = 0;
+    }
+}
+
+/*!
+    \brief      Learn the channel of the AP the STA is connected to
+    \param[in]  vif_idx: index of the wifi vif
+    \param[in]  ssid: pointer to the SSID of the AP
+    \param[out] none
+    \retval     none
+*/
+void wifi_roam_scan_connected(int vif_idx, const char *ssid)
+{
+    struct roam_ess *ess;
+    uint8_t channel = 0;
+    size_t len = strlen(ssid);
+
+    wifi_roam_scan_abort(vif_idx);
+    roam.misses = 0;
+    if ((len == 0) || (len > MAC_SSID_LEN))
+        return;
+
+    macif_vif_current_chan_get(vif_idx, &channel);
+    if ((channel < 1) || (channel > WIFI_ROAM_CHANNEL_NUM))
+        return;
+
+    roam_history_load();
+    ess = roam_ess_get(roam_ssid_hash(ssid, len), true);
+    roam_history_save(roam_ess_learn(ess, ROAM_CHAN_BIT(channel), 0));
+}
+
+/*!
+    \brief      Record that the rssi dropped under the roaming threshold
+    \param[in]  vif_idx: index of the wifi vif
+    \param[out] none
+    \retval     none
+*/
+void wifi_roam_scan_trigger(int vif_idx)
+{
+    if (!roam.triggered) {
+        roam.triggered = 1;
+        roam.trigger_time = sys_current_time_get();
+    }
+}
+
+/*!
+    \brief      Start a roaming scan round. Only the channels the ESS was seen on
+                are scanned, WIFI_ROAM_SLICE_CHAN_NUM channels at a time with a
+                return to the home channel in between. All the channels are
+                scanned if the ESS is unknown or after WIFI_ROAM_MISS_LIMIT
+                partial rounds without roaming.
+    \param[in]  vif_idx: index of the wifi vif
+    \param[in]  ssid: pointer to the SSID of the ESS
+    \param[out] none
+    \retval     0 if the round is started, 1 if a round is already running,
+                < 0 if error occured.
+*/
+int wifi_roam_scan_start(int vif_idx, const char *ssid)
+{
+    struct roam_ess *ess;
+    size_t len = strlen(ssid);
+
+    if (roam.busy)
+        return 1;
+    if ((len == 0) || (len > MAC_SSID_LEN))
+        return -1;
+
+    roam_history_load();
+    sys_memcpy(roam.ssid, ssid, len);
+    roam.ssid[len] = '\0';
+    roam.ssid_len = len;
+    roam.ssid_hash = roam_ssid_hash(ssid, len);
+    roam.vif_idx = vif_idx;
+
+    ess = roam_ess_get(roam.ssid_hash, false);
+    roam.plan_num = ess ? roam_plan_build(ess) : 0;
+    roam.plan_idx = 0;
+    roam.full = (roam.plan_num == 0) || (roam.misses >= WIFI_ROAM_MISS_LIMIT);
+    roam.seen_mask = 0;
+    roam.scanned_mask = roam.full ? ROAM_CHAN_ALL : 0;
+    roam.best_valid = 0;
+
+    if (roam_slice_start())
+        return -2;
+    roam.busy = 1;
+    if (roam.full)
+        roam.stats.full_rounds++;
+    else
+        roam.stats.partial_rounds++;
+    return 0;
+}
+
+/*!
+    \brief      Process the results of the last scan of a round. The next slice
+                is scheduled if channels remain, otherwise the channel history is
+                updated and the best AP of the round is returned.
+    \param[in]  vif_idx: index of the wifi vif
+    \param[out] candidate: pointer to the best AP of the ESS found in the round
+    \retval     1 if the round goes on, 0 if it is complete with a candidate,
+                -1 if no round is running, -2 if the ESS was not found.
+*/
+int wifi_roam_scan_done(int vif_idx, struct mac_scan_result *candidate)
+{
+    struct macif_scan_results *results;
+    struct mac_scan_result *result;
+    struct roam_ess *ess;
+    uint32_t elapsed, idx;
+    int ch;
+
+    if (!roam.busy || (vif_idx != roam.vif_idx))
+        return -1;
+
+    elapsed = sys_current_time_get() - roam.slice_start;
+    if (roam.full)
+        roam.stats.airtime_full_ms += elapsed;
+    else
+        roam.stats.airtime_partial_ms += elapsed;
+
+    /* one pass over the results both learns the channels and keeps the best AP */
+    results = (struct macif_scan_results *)sys_zalloc(sizeof(struct macif_scan_results));
+    if (results && (wifi_netlink_scan_results_get(vif_idx, results) == 0)) {
+        for (idx = 0; idx < results->result_cnt; idx++) {
+            result = &results->result[idx];
+            if ((result->ssid.length != roam.ssid_len) ||
+                sys_memcmp(result->ssid.array, roam.ssid, roam.ssid_len))
+                continue;
+            ch = wifi_freq_to_channel(result->chan->freq);
+            if ((ch >= 1) && (ch <= WIFI_ROAM_CHANNEL_NUM))
+                roam.seen_mask |= ROAM_CHAN_BIT(ch);
+            if (!roam.best_valid || (result->rssi > roam.best.rssi)) {
+                sys_memcpy(&roam.best, result, sizeof(roam.best));
+                roam.best_valid = 1;
+            }
+        }
+    }
+    if (results)
+        sys_mfree(results);
+
+    if (!roam.full && (roam.plan_idx < roam.plan_num)) {
+        eloop_timeout_register(WIFI_ROAM_SLICE_GAP_MS, roam_next_slice, &roam, NULL);
+        return 1;
+    }
+
+    roam.busy = 0;
+    ess = roam_ess_get(roam.ssid_hash, roam.seen_mask != 0);
+    if (ess)
+        roam_history_save(roam_ess_learn(ess, roam.seen_mask, roam.scanned_mask));
+
+    if (!roam.best_valid) {
+        wifi_roam_scan_decided(vif_idx, false);
+        return -2;
+    }
+    sys_memcpy(candidate, &roam.best, sizeof(*candidate));
+    return 0;
+}
+
+/*!
+    \brief      Report the decision taken at the end of a round
+    \param[in]  vif_idx: index of the wifi vif
+    \param[in]  roam_to: true if the STA roams to the candidate
+    \param[out] none
+    \retval     none
+*/
+void wifi_roam_scan_decided(int vif_idx, bool roam_to)
+{
+    uint32_t latency;
+
+    if (roam_to) {
+        roam.stats.roams++;
+        roam.misses = 0;
+        if (roam.triggered) {
+            latency = sys_current_time_get() - roam.trigger_time;
+            roam.stats.latency_cnt++;
+            roam.stats.latency_last_ms = latency;
+            roam.stats.latency_sum_ms += latency;
+            if (latency > roam.stats.latency_max_ms)
+                roam.stats.latency_max_ms = latency;
+            roam.triggered = 0;
+        }
+    } else {
+        roam.stats.misses++;
+        /* a full round has seen everything, go back to partial rounds */
+        if (roam.full)
+            roam.misses = 0;
+        else if (roam.misses < 0xFF)
+            roam.misses++;
+    }
+}
+
+/*!
+    \brief      Stop the current round
+    \param[in]  vif_idx: index of the wifi vif
+    \param[out] none
+    \retval     none
+*/
+void wifi_roam_scan_abort(int vif_idx)
+{
+    eloop_timeout_cancel(roam_next_slice, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
+    roam.busy = 0;
+    roam.triggered = 0;
+}
+
+/*!
+    \brief      Get the statistics of the roaming scanner
+    \param[in]  reset: clear the statistics after reading them
+    \param[out] stats: pointer to the statistics
+    \retval     none
+*/
+void wifi_roam_scan_stats_get(struct wifi_roam_scan_stats *stats, bool reset)
+{
+    if (stats)
+        sys_memcpy(stats, &roam.stats, sizeof(*stats));
+    if (reset)
+        sys_memset(&roam.stats, 0, sizeof(roam.stats));
+}
+
+/*!
+    \brief      Print the channel history and the statistics
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void wifi_roam_scan_dump(void)
+{
+    struct wifi_roam_scan_stats *st = &roam.stats;
+    int i, ch;
+
+    roam_history_load();
+    for (i = 0; i < WIFI_ROAM_ESS_NUM; i++) {
+        if (roam.ess[i].ssid_hash == 0)
+            continue;
+        netlink_printf("ess %08x age %u:", roam.ess[i].ssid_hash, roam.ess[i].age);
+        for (ch = 1; ch <= WIFI_ROAM_CHANNEL_NUM; ch++) {
+            if (roam.ess[i].score[ch - 1])
+                netlink_printf(" ch%d=%u", ch, roam.ess[i].score[ch - 1]);
+        }
+        netlink_printf("\r\n");
+    }
+    netlink_printf("rounds: partial %u (%u slices) full %u, misses in a row %u\r\n",
+                   st->partial_rounds, st->slices, st->full_rounds, roam.misses);
+    netlink_printf("airtime: partial %u ms full %u ms\r\n", st->airtime_partial_ms, st->airtime_full_ms);
+    netlink_printf("decisions: roam %u no roam %u, latency last %u ms max %u ms avg %u ms\r\n",
+                   st->roams, st->misses, st->latency_last_ms, st->latency_max_ms,
+                   st->latency_cnt ? st->latency_sum_ms / st->latency_cnt : 0);
+    netlink_printf("nvds saves %u\r\n", st->nvds_save);
+}
+#endif /* CONFIG_WIFI_ROAM_SCAN */
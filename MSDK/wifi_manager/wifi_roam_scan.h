@@ -0,0 +1,107 @@
+/*!
+    \file    wifi_roam_scan.h
+    \brief   Roaming scanner with per-ESS channel history.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _WIFI_ROAM_SCAN_H_
+#define _WIFI_ROAM_SCAN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mac_types.h"
+
+/* ESS entries kept in the channel history, the least recently used one is replaced */
+#define WIFI_ROAM_ESS_NUM                   4
+/* 2.4GHz channels */
+#define WIFI_ROAM_CHANNEL_NUM               14
+/* Channel score: credit when an AP of the ESS is seen on the channel, the score
+   is decreased by 1 each time the channel is scanned without finding the ESS */
+#define WIFI_ROAM_SCORE_SEEN                4
+#define WIFI_ROAM_SCORE_MAX                 15
+/* Channels scanned in a partial round, the best scored ones of the ESS */
+#define WIFI_ROAM_PLAN_CHAN_MAX             4
+/* Channels per scan slice and dwell time per channel (TU) */
+#define WIFI_ROAM_SLICE_CHAN_NUM            2
+#define WIFI_ROAM_SLICE_DWELL_TU            30
+/* Time spent back on the home channel between two slices. The AP DTIM period is
+   not known by the STA vif, so this covers a DTIM period of 3 at 100 TU */
+#define WIFI_ROAM_SLICE_GAP_MS              310
+/* Partial rounds without roaming before a full scan is done */
+#define WIFI_ROAM_MISS_LIMIT                3
+/* The history is written to NVDS at once when a new channel is learnt, and at
+   most once per WIFI_ROAM_SAVE_INTERVAL_MS for score updates */
+#define WIFI_ROAM_SAVE_INTERVAL_MS          600000
+#define WIFI_ROAM_NVDS_KEY                  "roam_chan"
+
+struct wifi_roam_scan_stats
+{
+    /* rounds limited to the learnt channels */
+    uint32_t partial_rounds;
+    /* rounds scanning all the channels */
+    uint32_t full_rounds;
+    /* scan requests of partial rounds */
+    uint32_t slices;
+    /* time off the home channel in ms, from the scan request to the scan done
+       event, for partial slices and for full scans */
+    uint32_t airtime_partial_ms;
+    uint32_t airtime_full_ms;
+    /* rounds that ended with or without a roaming decision */
+    uint32_t roams;
+    uint32_t misses;
+    /* time from the roaming trigger (rssi under the threshold) to the roaming
+       decision, in ms */
+    uint32_t latency_cnt;
+    uint32_t latency_last_ms;
+    uint32_t latency_max_ms;
+    uint32_t latency_sum_ms;
+    /* NVDS writes of the channel history */
+    uint32_t nvds_save;
+};
+
+/* learn the channel of the AP the STA is connected to */
+void wifi_roam_scan_connected(int vif_idx, const char *ssid);
+/* the rssi dropped under the roaming threshold */
+void wifi_roam_scan_trigger(int vif_idx);
+/* start a roaming scan round */
+int wifi_roam_scan_start(int vif_idx, const char *ssid);
+/* process the results of the last scan of a round */
+int wifi_roam_scan_done(int vif_idx, struct mac_scan_result *candidate);
+/* report the decision taken at the end of a round */
+void wifi_roam_scan_decided(int vif_idx, bool roam_to);
+/* stop the current round */
+void wifi_roam_scan_abort(int vif_idx);
+/* get the statistics */
+void wifi_roam_scan_stats_get(struct wifi_roam_scan_stats *stats, bool reset);
+/* print the channel history and statistics */
+void wifi_roam_scan_dump(void);
+
+#endif /* _WIFI_ROAM_SCAN_H_ */
@@ -0,0 +1,536 @@
+/*!
+    \file    wifi_sta_table.c
+    \brief   SoftAP station table with per-client counters.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "app_cfg.h"
+#include "wlan_config.h"
+
+#if defined(CONFIG_WIFI_STA_TABLE) && defined(CFG_SOFTAP)
+#include <string.h>
+#include "wrapper_os.h"
+#include "wifi_vif.h"
+#include "wifi_management.h"
+#include "wifi_netlink.h"
+#include "wifi_eloop.h"
+#include "wifi_sta_table.h"
+#include "dhcpd.h"
+
+#define STA_TABLE_NONE                  0xFF
+#define STA_TABLE_HASH(mac)             ((((mac)[3] * 31 + (mac)[4]) * 31 + (mac)[5]) \
+                                         & (WIFI_STA_TABLE_HASH_SIZE - 1))
+/* one beacon interval of 100 TU, in ms */
+#define STA_TABLE_BEACON_MS             103
+
+struct sta_table_entry
+{
+    struct wifi_sta_info info;
+    uint8_t used;
+    /* the client has been deauthenticated for inactivity */
+    uint8_t evicted;
+    /* next entry in the hash bucket */
+    uint8_t next;
+    uint8_t rsvd;
+};
+
+struct sta_table_ctx
+{
+    struct sta_table_entry ent[WIFI_STA_TABLE_SIZE];
+    uint8_t bucket[WIFI_STA_TABLE_HASH_SIZE];
+    uint8_t aid_map[WIFI_STA_TABLE_AID_MAX];
+    uint8_t init;
+    /* number of used entries, the data path returns at once when 0 */
+    volatile uint8_t cnt;
+    uint8_t timer_on;
+    uint32_t idle_timeout_s;
+    struct wifi_sta_table_stats stats;
+};
+
+static struct sta_table_ctx sta_tbl;
+
+/*!
+    \brief      Initialize the table on first use
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void sta_table_init(void)
+{
+    if (sta_tbl.init)
+        return;
+    sys_memset(sta_tbl.bucket, STA_TABLE_NONE, sizeof(sta_tbl.bucket));
+    sys_memset(sta_tbl.aid_map, STA_TABLE_NONE, sizeof(sta_tbl.aid_map));
+    sta_tbl.idle_timeout_s = WIFI_STA_TABLE_IDLE_TIMEOUT_S;
+    sta_tbl.init = 1;
+}
+
+/*!
+    \brief      Find the entry of a client.
+                The data path calls it without lock: entries are only linked and
+                unlinked in critical sections and the walk is bounded, so a
+                concurrent removal at worst misses the frame.
+    \param[in]  mac: MAC address of the client
+    \param[out] none
+    \retval     index of the entry, STA_TABLE_NONE if not found
+*/
+static uint8_t sta_table_find(const uint8_t *mac)
+{
+    uint8_t idx = sta_tbl.bucket[STA_TABLE_HASH(mac)];
+    int hops = 0;
+
+    while ((idx != STA_TABLE_NONE) && (hops++ < WIFI_STA_TABLE_SIZE)) {
+        struct sta_table_entry *ent = &sta_tbl.ent[idx];
+
+        if (ent->used && !sys_memcmp(ent->info.mac, mac, 6))
+            return idx;
+        idx = ent->next;
+    }
+    return STA_TABLE_NONE;
+}
+
+/*!
+    \brief      Unlink an entry from its hash bucket and the AID index and free it,
+                must be called in a critical section
+    \param[in]  idx: index of the entry
+    \param[out] none
+    \retval     none
+*/
+static void sta_table_unlink(uint8_t idx)
+{
+    struct sta_table_entry *ent = &sta_tbl.ent[idx];
+    uint8_t *link = &sta_tbl.bucket[STA_TABLE_HASH(ent->info.mac)];
+
+    while (*link != STA_TABLE_NONE) {
+        if (*link == idx) {
+            *link = ent->next;
+            break;
+        }
+        link = &sta_tbl.ent[*link].next;
+    }
+    if ((ent->info.aid < WIFI_STA_TABLE_AID_MAX) && (sta_tbl.aid_map[ent->info.aid] == idx))
+        sta_tbl.aid_map[ent->info.aid] = STA_TABLE_NONE;
+    ent->used = 0;
+    ent->next = STA_TABLE_NONE;
+    sta_tbl.cnt--;
+    sta_tbl.stats.removed++;
+}
+
+/*!
+    \brief      Deauthenticate the clients idle for longer than the inactivity timeout
+    \param[in]  eloop_data: unused
+    \param[in]  user_ctx: unused
+    \param[out] none
+    \retval     none
+*/
+static void sta_table_check(void *eloop_data, void *user_ctx)
+{
+    uint32_t now = sys_current_time_get();
+    uint32_t timeout_ms, last;
+    int i;
+
+    sta_tbl.timer_on = 0;
+    if (sta_tbl.cnt == 0)
+        return;
+
+    for (i = 0; i < WIFI_STA_TABLE_SIZE; i++) {
+        struct sta_table_entry *ent = &sta_tbl.ent[i];
+
+        if (!ent->used || ent->evicted || (sta_tbl.idle_timeout_s == 0))
+            continue;
+        /* a dozing client only wakes up every listen interval */
+        timeout_ms = sta_tbl.idle_timeout_s * 1000 + ent->info.listen_interval * STA_TABLE_BEACON_MS;
+        last = ent->info.last_rx ? ent->info.last_rx : ent->info.assoc_time;
+        if ((int32_t)(now - last) < (int32_t)timeout_ms)
+            continue;
+
+        netlink_printf("sta table: client "MAC_FMT" idle for %u s, deauthenticate\r\n",
+                       MAC_ARG_UINT8(ent->info.mac), (now - last) / 1000);
+        ent->evicted = 1;
+        sta_tbl.stats.evicted++;
+        wifi_management_ap_delete_client(ent->info.mac);
+    }
+
+    eloop_timeout_register_slack(WIFI_STA_TABLE_CHECK_MS, WIFI_STA_TABLE_CHECK_SLACK_MS, sta_table_check, NULL, NULL);
+    sta_tbl.timer_on = 1;
+}
+
+/*!
+    \brief      Add a client to the table, called upon the client added event
+    \param[in]  vif_idx: index of the SoftAP vif
+    \param[in]  mac: MAC address of the client
+    \param[in]  aid: association ID, 0 if unknown
+    \param[in]  listen_interval: listen interval of the client, 0 if unknown
+    \param[out] none
+    \retval     0 on success, -1 if the table is full
+*/
+int wifi_sta_table_add(int vif_idx, const uint8_t *mac, uint16_t aid, uint16_t listen_interval)
+{
+    struct sta_table_entry *ent;
+    uint8_t idx, h;
+
+    sta_table_init();
+
+    /* reassociation, the client starts over */
+    idx = sta_table_find(mac);
+    if (idx != STA_TABLE_NONE) {
+        sys_enter_critical();
+        sta_table_unlink(idx);
+        sys_exit_critical();
+    }
+
+    for (idx = 0; idx < WIFI_STA_TABLE_SIZE; idx++) {
+        if (!sta_tbl.ent[idx].used)
+            break;
+    }
+    if (idx == WIFI_STA_TABLE_SIZE) {
+        sta_tbl.stats.full++;
+        return -1;
+    }
+
+    ent = &sta_tbl.ent[idx];
+    sys_memset(ent, 0, sizeof(*ent));
+    sys_memcpy(ent->info.mac, mac, 6);
+    ent->info.vif_idx = vif_idx;
+    ent->info.lease_idx = -1;
+    ent->info.aid = aid;
+    ent->info.listen_interval = listen_interval;
+    ent->info.assoc_time = sys_current_time_get();
+
+    h = STA_TABLE_HASH(mac);
+    sys_enter_critical();
+    ent->next = sta_tbl.bucket[h];
+    ent->used = 1;
+    sta_tbl.bucket[h] = idx;
+    if (aid && (aid < WIFI_STA_TABLE_AID_MAX))
+        sta_tbl.aid_map[aid] = idx;
+    sta_tbl.cnt++;
+    sta_tbl.stats.added++;
+    sys_exit_critical();
+
+    if (!sta_tbl.timer_on) {
+        eloop_timeout_register_slack(WIFI_STA_TABLE_CHECK_MS, WIFI_STA_TABLE_CHECK_SLACK_MS, sta_table_check, NULL, NULL);
+        sta_tbl.timer_on = 1;
+    }
+    return 0;
+}
+
+/*!
+    \brief      Remove a client from the table, called upon the client removed event
+    \param[in]  mac: MAC address of the client
+    \param[out] none
+    \retval     none
+*/
+void wifi_sta_table_del(const uint8_t *mac)
+{
+    uint8_t idx;
+
+    if (!sta_tbl.init)
+        return;
+
+    sys_enter_critical();
+    idx = sta_table_find(mac);
+    if (idx != STA_TABLE_NONE)
+        sta_table_unlink(idx);
+    sys_exit_critical();
+}
+
+/*!
+    \brief      Remove all the clients of a SoftAP, called when it stops
+    \param[in]  vif_idx: index of the SoftAP vif
+    \param[out] none
+    \retval     none
+*/
+void wifi_sta_table_clear(int vif_idx)
+{
+    uint8_t idx;
+
+    if (!sta_tbl.init)
+        return;
+
+    sys_enter_critical();
+    for (idx = 0; idx < WIFI_STA_TABLE_SIZE; idx++) {
+        if (sta_tbl.ent[idx].used && (sta_tbl.ent[idx].info.vif_idx == vif_idx))
+            sta_table_unlink(idx);
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      Get a copy of the entry of a client
+    \param[in]  mac: MAC address of the client
+    \param[out] info: pointer to the copy of the entry
+    \retval     0 on success, -1 if the client is not in the table
+*/
+int wifi_sta_table_get(const uint8_t *mac, struct wifi_sta_info *info)
+{
+    uint8_t idx;
+
+    if (!sta_tbl.init)
+        return -1;
+
+    sys_enter_critical();
+    idx = sta_table_find(mac);
+    if (idx != STA_TABLE_NONE)
+        sys_memcpy(info, &sta_tbl.ent[idx].info, sizeof(*info));
+    sys_exit_critical();
+
+    return (idx != STA_TABLE_NONE) ? 0 : -1;
+}
+
+/*!
+    \brief      Get a copy of the entry of a client by association ID
+    \param[in]  vif_idx: index of the SoftAP vif
+    \param[in]  aid: association ID of the client
+    \param[out] info: pointer to the copy of the entry
+    \retval     0 on success, -1 if the client is not in the table
+*/
+int wifi_sta_table_get_by_aid(int vif_idx, uint16_t aid, struct wifi_sta_info *info)
+{
+    uint8_t idx = STA_TABLE_NONE;
+    int i;
+
+    if (!sta_tbl.init || (aid == 0))
+        return -1;
+
+    sys_enter_critical();
+    if (aid < WIFI_STA_TABLE_AID_MAX) {
+        idx = sta_tbl.aid_map[aid];
+        if ((idx != STA_TABLE_NONE) && (sta_tbl.ent[idx].info.vif_idx != vif_idx))
+            idx = STA_TABLE_NONE;
+    } else {
+        for (i = 0; i < WIFI_STA_TABLE_SIZE; i++) {
+            if (sta_tbl.ent[i].used && (sta_tbl.ent[i].info.aid == aid)
+                && (sta_tbl.ent[i].info.vif_idx == vif_idx)) {
+                idx = i;
+                break;
+            }
+        }
+    }
+    if (idx != STA_TABLE_NONE)
+        sys_memcpy(info, &sta_tbl.ent[idx].info, sizeof(*info));
+    sys_exit_critical();
+
+    return (idx != STA_TABLE_NONE) ? 0 : -1;
+}
+
+/*!
+    \brief      Get a copy of the entries of a SoftAP
+    \param[in]  vif_idx: index of the SoftAP vif, -1 for all the vifs
+    \param[in]  max: number of entries info can hold
+    \param[out] info: pointer to the copy of the entries
+    \retval     number of entries copied
+*/
+int wifi_sta_table_list(int vif_idx, struct wifi_sta_info *info, int max)
+{
+    int i, num = 0;
+
+    if (!sta_tbl.init)
+        return 0;
+
+    sys_enter_critical();
+    for (i = 0; (i < WIFI_STA_TABLE_SIZE) && (num < max); i++) {
+        if (sta_tbl.ent[i].used
+            && ((vif_idx < 0) || (sta_tbl.ent[i].info.vif_idx == vif_idx))) {
+            sys_memcpy(&info[num++], &sta_tbl.ent[i].info, sizeof(*info));
+        }
+    }
+    sys_exit_critical();
+
+    return num;
+}
+
+/*!
+    \brief      Account a frame received from a client
+    \param[in]  src: source MAC address of the Ethernet frame
+    \param[in]  len: length of the frame
+    \param[out] none
+    \retval     none
+*/
+void wifi_sta_table_rx(const uint8_t *src, uint32_t len)
+{
+    struct sta_table_entry *ent;
+    uint8_t idx;
+
+    if (sta_tbl.cnt == 0)
+        return;
+
+    idx = sta_table_find(src);
+    if (idx == STA_TABLE_NONE)
+        return;
+
+    ent = &sta_tbl.ent[idx];
+    ent->info.rx_pkts++;
+    ent->info.rx_bytes += len;
+    ent->info.last_rx = sys_current_time_get();
+}
+
+/*!
+    \brief      Account a frame sent to a client
+    \param[in]  dst: destination MAC address of the Ethernet frame
+    \param[in]  len: length of the frame
+    \param[in]  ok: the frame has been accepted by the MAC layer
+    \param[out] none
+    \retval     none
+*/
+void wifi_sta_table_tx(const uint8_t *dst, uint32_t len, bool ok)
+{
+    struct sta_table_entry *ent;
+    uint8_t idx;
+
+    if ((sta_tbl.cnt == 0) || (dst[0] & 0x01))
+        return;
+
+    idx = sta_table_find(dst);
+    if (idx == STA_TABLE_NONE)
+        return;
+
+    ent = &sta_tbl.ent[idx];
+    if (ok) {
+        ent->info.tx_pkts++;
+        ent->info.tx_bytes += len;
+        ent->info.last_tx = sys_current_time_get();
+    } else {
+        ent->info.tx_fail++;
+    }
+}
+
+/*!
+    \brief      Get the DHCP server lease index cached for a client
+    \param[in]  mac: MAC address of the client
+    \param[out] none
+    \retval     lease index, -1 if not known
+*/
+int wifi_sta_table_lease_get(const uint8_t *mac)
+{
+    uint8_t idx;
+
+    if (sta_tbl.cnt == 0)
+        return -1;
+
+    idx = sta_table_find(mac);
+    if (idx == STA_TABLE_NONE)
+        return -1;
+    return sta_tbl.ent[idx].info.lease_idx;
+}
+
+/*!
+    \brief      Cache the DHCP server lease index of a client
+    \param[in]  mac: MAC address of the client
+    \param[in]  lease_idx: lease index, -1 to forget it
+    \param[out] none
+    \retval     none
+*/
+void wifi_sta_table_lease_set(const uint8_t *mac, int lease_idx)
+{
+    uint8_t idx;
+
+    if (sta_tbl.cnt == 0)
+        return;
+
+    idx = sta_table_find(mac);
+    if (idx != STA_TABLE_NONE)
+        sta_tbl.ent[idx].info.lease_idx = lease_idx;
+}
+
+/*!
+    \brief      Set the inactivity timeout
+    \param[in]  timeout_s: timeout in seconds, 0 disables the eviction
+    \param[out] none
+    \retval     none
+*/
+void wifi_sta_table_idle_timeout_set(uint32_t timeout_s)
+{
+    sta_table_init();
+    sta_tbl.idle_timeout_s = timeout_s;
+}
+
+/*!
+    \brief      Get the inactivity timeout
+    \param[in]  none
+    \param[out] none
+    \retval     timeout in seconds, 0 if the eviction is disabled
+*/
+uint32_t wifi_sta_table_idle_timeout_get(void)
+{
+    sta_table_init();
+    return sta_tbl.idle_timeout_s;
+}
+
+/*!
+    \brief      Get the statistics of the table
+    \param[in]  reset: clear the statistics after reading them
+    \param[out] stats: pointer to the statistics, may be NULL
+    \retval     none
+*/
+void wifi_sta_table_stats_get(struct wifi_sta_table_stats *stats, bool reset)
+{
+    if (stats)
+        sys_memcpy(stats, &sta_tbl.stats, sizeof(*stats));
+    if (reset)
+        sys_memset(&sta_tbl.stats, 0, sizeof(sta_tbl.stats));
+}
+
+/*!
+    \brief      Print the clients and their counters
+    \param[in]  vif_idx: index of the SoftAP vif, -1 for all the vifs
+    \param[out] none
+    \retval     none
+*/
+void wifi_sta_table_dump(int vif_idx)
+{
+    struct wifi_sta_info *info;
+    uint32_t now = sys_current_time_get(), ip;
+    int i, num;
+
+    info = sys_malloc(WIFI_STA_TABLE_SIZE * sizeof(*info));
+    if (info == NULL)
+        return;
+    num = wifi_sta_table_list(vif_idx, info, WIFI_STA_TABLE_SIZE);
+
+    for (i = 0; i < num; i++) {
+        ip = dhcpd_find_ipaddr_by_macaddr(info[i].mac);
+        netlink_printf("[%d] "MAC_FMT" aid %u vif %u ip "IP_FMT" up %u s idle %u s li %u\r\n",
+                       i, MAC_ARG_UINT8(info[i].mac), info[i].aid, info[i].vif_idx, IP_ARG(ip),
+                       (now - info[i].assoc_time) / 1000,
+                       (now - (info[i].last_rx ? info[i].last_rx : info[i].assoc_time)) / 1000,
+                       info[i].listen_interval);
+        netlink_printf("    rx %u pkts %u KB, tx %u pkts %u KB %u fail\r\n",
+                       info[i].rx_pkts, (uint32_t)(info[i].rx_bytes >> 10),
+                       info[i].tx_pkts, (uint32_t)(info[i].tx_bytes >> 10), info[i].tx_fail);
+    }
+    sys_mfree(info);
+
+    netlink_printf("clients %d, added %u removed %u evicted %u full %u, idle timeout %u s\r\n",
+                   num, sta_tbl.stats.added, sta_tbl.stats.removed, sta_tbl.stats.evicted,
+                   sta_tbl.stats.full, sta_tbl.idle_timeout_s);
+}
+#endif /* CONFIG_WIFI_STA_TABLE && CFG_SOFTAP */
@@ -0,0 +1,115 @@
+/*!
+    \file    wifi_sta_table.h
+    \brief   SoftAP station table with per-client counters.
+
+    \version 2023-07-20, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2023, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef _WIFI_STA_TABLE_H_
+#define _WIFI_STA_TABLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_cfg.h"
+#include "wlan_config.h"
+
+/* Stations tracked, one entry per client the SoftAP can accept */
+#define WIFI_STA_TABLE_SIZE                 CFG_STA_NUM
+/* MAC hash buckets, must be a power of 2 and larger than WIFI_STA_TABLE_SIZE */
+#define WIFI_STA_TABLE_HASH_SIZE            32
+/* AIDs indexed directly, larger AIDs are found by walking the table */
+#define WIFI_STA_TABLE_AID_MAX              64
+/* A client without any data frame for this time is deauthenticated, 0 disables
+   the eviction. The idle time of a client is extended by its listen interval */
+#define WIFI_STA_TABLE_IDLE_TIMEOUT_S       300
+/* Period of the inactivity check, only running while clients are connected */
+#define WIFI_STA_TABLE_CHECK_MS             10000
+/* The check may run late by up to this delay, to share a wakeup with other timers */
+#define WIFI_STA_TABLE_CHECK_SLACK_MS       (WIFI_STA_TABLE_CHECK_MS / 4)
+
+struct wifi_sta_info
+{
+    uint8_t mac[6];
+    uint8_t vif_idx;
+    /* index of the DHCP server lease, -1 if not known */
+    int8_t lease_idx;
+    /* association ID and listen interval (in beacon intervals), 0 if not
+       reported by the authenticator */
+    uint16_t aid;
+    uint16_t listen_interval;
+    /* association time and time of the last data frame received from or sent
+       to the client, in ms */
+    uint32_t assoc_time;
+    uint32_t last_rx;
+    uint32_t last_tx;
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint32_t rx_pkts;
+    uint32_t tx_pkts;
+    /* frames to the client the MAC layer did not accept */
+    uint32_t tx_fail;
+};
+
+struct wifi_sta_table_stats
+{
+    uint32_t added;
+    uint32_t removed;
+    /* clients deauthenticated by the inactivity check */
+    uint32_t evicted;
+    /* association events dropped because the table was full */
+    uint32_t full;
+};
+
+/* a client has associated with the SoftAP on vif_idx */
+int wifi_sta_table_add(int vif_idx, const uint8_t *mac, uint16_t aid, uint16_t listen_interval);
+/* a client has left */
+void wifi_sta_table_del(const uint8_t *mac);
+/* the SoftAP on vif_idx has stopped */
+void wifi_sta_table_clear(int vif_idx);
+/* get a copy of the entry of a client, by MAC address or by AID */
+int wifi_sta_table_get(const uint8_t *mac, struct wifi_sta_info *info);
+int wifi_sta_table_get_by_aid(int vif_idx, uint16_t aid, struct wifi_sta_info *info);
+/* get a copy of the entries of vif_idx (-1 for all), returns the number of entries */
+int wifi_sta_table_list(int vif_idx, struct wifi_sta_info *info, int max);
+/* data path accounting, called for every Ethernet frame of the WiFi interfaces */
+void wifi_sta_table_rx(const uint8_t *src, uint32_t len);
+void wifi_sta_table_tx(const uint8_t *dst, uint32_t len, bool ok);
+/* DHCP server lease index cache */
+int wifi_sta_table_lease_get(const uint8_t *mac);
+void wifi_sta_table_lease_set(const uint8_t *mac, int lease_idx);
+/* inactivity timeout in seconds, 0 disables the eviction */
+void wifi_sta_table_idle_timeout_set(uint32_t timeout_s);
+uint32_t wifi_sta_table_idle_timeout_get(void);
+/* get the statistics */
+void wifi_sta_table_stats_get(struct wifi_sta_table_stats *stats, bool reset);
+/* print the clients of vif_idx (-1 for all) */
+void wifi_sta_table_dump(int vif_idx);
+
+#endif /* _WIFI_STA_TABLE_H_ */
@@ -839,6 +839,8 @@ void wifi_wpa_sta_pmksa_cache_flush(int vif_idx, int flush_all);
 
 int wifi_wpa_sta_sm_step(int vif_idx, uint16_t event, uint8_t *data, uint32_t data_len, int sm);
 int wifi_wpa_ap_sm_step(int vif_idx, uint16_t event, uint8_t *data, uint32_t data_len);
+/* param: MAC address of the client, optionally followed by its AID and listen
+   interval (16 bits little endian each) */
 int wifi_wpa_send_client_add_event(int vif_idx, uint8_t *param, uint32_t param_len);
 int wifi_wpa_send_client_remove_event(int vif_idx, uint8_t *param, uint32_t param_len);
 #ifdef CONFIG_WPS
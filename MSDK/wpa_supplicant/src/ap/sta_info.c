@@ -1588,8 +1588,16 @@ void ap_sta_set_authorized_event(struct hostapd_data *hapd,
 		wpa_msg(hapd->msg_ctx, MSG_INFO, AP_STA_CONNECTED "%s%s%s%s",
 			buf, ip_addr, keyid_buf, dpp_pkhash_buf);
 /* GD modify */
-		wifi_wpa_send_client_add_event(wifi_wpa_get_vif_idx(hapd->conf->iface),
-			sta->addr, WIFI_ALEN);
+		{
+			/* MAC address, AID and listen interval (little endian) */
+			u8 info[WIFI_ALEN + 4];
+
+			os_memcpy(info, sta->addr, WIFI_ALEN);
+			WPA_PUT_LE16(&info[WIFI_ALEN], sta->aid);
+			WPA_PUT_LE16(&info[WIFI_ALEN + 2], sta->listen_interval);
+			wifi_wpa_send_client_add_event(wifi_wpa_get_vif_idx(hapd->conf->iface),
+				info, sizeof(info));
+		}
 /* GD modify end*/
 		if (hapd->msg_ctx_parent &&
 		    hapd->msg_ctx_parent != hapd->msg_ctx)
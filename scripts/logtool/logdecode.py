@@ -0,0 +1,298 @@
+#! /usr/bin/env python3
+#
+#     Copyright (c) 2024, GigaDevice Semiconductor Inc.
+#
+#     Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+#
+#     1. Redistributions of source code must retain the above copyright notice, this
+#        list of conditions and the following disclaimer.
+#     2. Redistributions in binary form must reproduce the above copyright notice,
+#        this list of conditions and the following disclaimer in the documentation
+#        and/or other materials provided with the distribution.
+#     3. Neither the name of the copyright holder nor the names of its contributors
+#        may be used to endorse or promote products derived from this software without
+#        specific prior written permission.
+#
+#     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+# INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+# NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+# OF SUCH DAMAGE.
+
+# Decode the log output of an image built with CONFIG_PRINT_DEFERRED.
+#
+# Each co_printf record is: 0xA5, length, sequence, format address (LE), arguments, checksum.
+# The format string is read from the ELF of the image at the recorded address, and the
+# arguments are formatted the same way as print() in MSDK/util/src/debug_print.c.
+# Bytes that are not part of a valid record are passed through as text.
+#
+# Examples:
+#     logdecode.py MSDK/projects/image-msdk.elf capture.bin
+#     logdecode.py MSDK/projects/image-msdk.elf --serial /dev/ttyUSB0 --baud 115200
+
+import sys
+import struct
+import argparse
+
+DLOG_SYNC = 0xA5
+DLOG_MIN_LEN = 5            # sequence and format address
+
+
+class ElfStrings:
+    def __init__(self, path):
+        with open(path, mode='rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF':
+            raise ValueError(path + ' is not an ELF file')
+        is64 = self.data[4] == 2
+        endian = '<' if self.data[5] == 1 else '>'
+        if is64:
+            shoff, = struct.unpack_from(endian + 'Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + 'HH', self.data, 0x3A)
+            fmt = endian + 'IIQQQQ'
+        else:
+            shoff, = struct.unpack_from(endian + 'I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + 'HH', self.data, 0x2E)
+            fmt = endian + 'IIIIII'
+        self.sections = []
+        for i in range(shnum):
+            name, sh_type, flags, addr, offset, size = struct.unpack_from(fmt, self.data, shoff + i * shentsize)
+            # allocated sections with content in the file
+            if (flags & 0x2) and sh_type == 1 and size:
+                self.sections.append((addr, size, offset))
+        self.cache = {}
+
+    def string(self, addr):
+        if addr in self.cache:
+            return self.cache[addr]
+        s = None
+        for base, size, offset in self.sections:
+            if base <= addr < base + size:
+                start = offset + addr - base
+                end = self.data.find(b'\0', start, offset + size)
+                if end >= 0:
+                    s = self.data[start:end].decode('latin-1')
+                break
+        self.cache[addr] = s
+        return s
+
+
+def pad(s, width, left, zero):
+    # same as prints(): the padding character is used on either side
+    if len(s) >= width:
+        return s
+    fill = ('0' if zero else ' ') * (width - len(s))
+    return s + fill if left else fill + s
+
+
+def int_str(v, base, signed, upper):
+    # same as printi(): 32 bit value, '-' only for signed decimal
+    v &= 0xFFFFFFFF
+    neg = False
+    if signed and base == 10 and v & 0x80000000:
+        v = 0x100000000 - v
+        neg = True
+    digits = '0123456789ABCDEF' if upper else '0123456789abcdef'
+    s = ''
+    while True:
+        s = digits[v % base] + s
+        v //= base
+        if not v:
+            break
+    return s, neg
+
+
+def printi(v, base, signed, upper, width, left, zero):
+    s, neg = int_str(v, base, signed, upper)
+    if neg:
+        if zero and width:
+            return '-' + pad(s, width - 1, left, zero)
+        s = '-' + s
+    return pad(s, width, left, zero)
+
+
+def render(fmt, args):
+    out = ''
+    pos = 0
+
+    def word():
+        nonlocal pos
+        if pos + 4 > len(args):
+            raise IndexError
+        v, = struct.unpack_from('<I', args, pos)
+        pos += 4
+        return v
+
+    def raw(n):
+        nonlocal pos
+        if pos + n > len(args):
+            raise IndexError
+        b = args[pos:pos + n]
+        pos += n
+        return b
+
+    i = 0
+    try:
+        while i < len(fmt):
+            c = fmt[i]
+            i += 1
+            if c != '%':
+                out += c
+                continue
+            if i >= len(fmt):
+                break
+            if fmt[i] == '%':
+                out += '%'
+                i += 1
+                continue
+            left = zero = False
+            width = 0
+            if fmt[i] == '-':
+                left = True
+                i += 1
+            while i < len(fmt) and fmt[i] == '0':
+                zero = True
+                i += 1
+            while i < len(fmt) and fmt[i].isdigit():
+                width = width * 10 + int(fmt[i])
+                i += 1
+            if i >= len(fmt):
+                break
+            t = fmt[i]
+            i += 1
+            if t == 's':
+                n = raw(1)[0]
+                out += pad(raw(n).decode('latin-1'), width, left, zero)
+            elif t == 'd':
+                out += printi(word(), 10, True, False, width, left, zero)
+            elif t == 'p' and i < len(fmt) and fmt[i] in 'MI':
+                if fmt[i] == 'M':
+                    out += ':'.join(printi(b, 16, True, False, 2, left, True) for b in raw(6))
+                else:
+                    out += '.'.join(printi(b, 10, True, False, width, left, zero) for b in raw(4))
+                i += 1
+            elif t in 'px':
+                out += printi(word(), 16, False, False, width, left, zero)
+            elif t == 'X':
+                out += printi(word(), 16, False, True, width, left, zero)
+            else:
+                if t == 'z':
+                    if i >= len(fmt):
+                        break
+                    t = fmt[i]
+                    i += 1
+                if t == 'u':
+                    out += printi(word(), 10, False, False, width, left, zero)
+                elif t == 'c':
+                    out += pad(chr(word() & 0xFF), width, left, zero)
+    except IndexError:
+        out += '<truncated>'
+    return out
+
+
+class Decoder:
+    def __init__(self, elf, out):
+        self.elf = elf
+        self.out = out
+        self.buf = b''
+        self.seq = None
+        self.records = 0
+        self.dropped = 0
+        self.bad = 0
+
+    def record(self, start):
+        """Return the decoded text and the record size, None if no record starts here,
+        or 0 if more bytes are needed."""
+        b = self.buf
+        if start + 2 > len(b):
+            return 0
+        length = b[start + 1]
+        if length < DLOG_MIN_LEN:
+            return None
+        if start + 3 + length > len(b):
+            return 0
+        payload = b[start + 2:start + 2 + length]
+        chk = 0
+        for x in payload:
+            chk ^= x
+        if chk != b[start + 2 + length]:
+            return None
+        seq = payload[0]
+        addr, = struct.unpack_from('<I', payload, 1)
+        fmt = self.elf.string(addr)
+        if fmt is None:
+            return None
+        text = ''
+        if self.seq is not None and seq != self.seq:
+            lost = (seq - self.seq) & 0xFF
+            self.dropped += lost
+            text += '[%d records dropped]\n' % lost
+        self.seq = (seq + 1) & 0xFF
+        self.records += 1
+        return text + render(fmt, payload[5:]), 3 + length
+
+    def feed(self, data, final=False):
+        self.buf += data
+        i = 0
+        text = ''
+        while i < len(self.buf):
+            if self.buf[i] != DLOG_SYNC:
+                j = self.buf.find(bytes([DLOG_SYNC]), i)
+                if j < 0:
+                    j = len(self.buf)
+                text += self.buf[i:j].decode('latin-1')
+                i = j
+                continue
+            r = self.record(i)
+            if r == 0 and not final:
+                break
+            if not r:
+                # not a record, pass the byte through
+                self.bad += 1
+                text += chr(self.buf[i])
+                i += 1
+                continue
+            text += r[0]
+            i += r[1]
+        self.buf = self.buf[i:]
+        if text:
+            self.out.write(text.replace('\r\n', '\n'))
+            self.out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode CONFIG_PRINT_DEFERRED log output')
+    parser.add_argument('elf', help='ELF file of the running image')
+    parser.add_argument('infile', nargs='?', default='-', help='captured log, - for stdin')
+    parser.add_argument('--serial', metavar='PORT', help='read from a serial port, needs pyserial')
+    parser.add_argument('--baud', type=int, default=115200)
+    args = parser.parse_args()
+
+    dec = Decoder(ElfStrings(args.elf), sys.stdout)
+    try:
+        if args.serial:
+            import serial
+            port = serial.Serial(args.serial, args.baud, timeout=0.1)
+            while True:
+                dec.feed(port.read(4096))
+        else:
+            f = sys.stdin.buffer if args.infile == '-' else open(args.infile, mode='rb')
+            while True:
+                data = f.read1(4096) if hasattr(f, 'read1') else f.read(4096)
+                if not data:
+                    break
+                dec.feed(data)
+            dec.feed(b'', final=True)
+    except KeyboardInterrupt:
+        pass
+    sys.stderr.write('%d records, %d dropped\n' % (dec.records, dec.dropped))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,274 @@
+#! /usr/bin/env python3
+#
+#     Copyright (c) 2024, GigaDevice Semiconductor Inc.
+#
+#     Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+#
+#     1. Redistributions of source code must retain the above copyright notice, this
+#        list of conditions and the following disclaimer.
+#     2. Redistributions in binary form must reproduce the above copyright notice,
+#        this list of conditions and the following disclaimer in the documentation
+#        and/or other materials provided with the distribution.
+#     3. Neither the name of the copyright holder nor the names of its contributors
+#        may be used to endorse or promote products derived from this software without
+#        specific prior written permission.
+#
+#     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+# INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+# NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+# OF SUCH DAMAGE.
+
+# Recommend lwipopts.h sizes from the pool telemetry of an image built with
+# CONFIG_LWIP_MEM_TELEMETRY.
+#
+# Run a representative workload (e.g. iperf with the product's connection count) with
+#     lwip_stats trace reset
+#     lwip_stats trace start [interval ms]
+# then capture the output of "lwip_stats trace dump". The MEMTLM lines of the log give,
+# per interval, the peak number of elements in use of every memp pool and the peak heap
+# usage, plus the last allocation failures.
+#
+# The data path pools scale with the throughput, the pcb pools with the connection count.
+# Pools that failed an allocation were starved: their peak is only a lower bound and they
+# are grown past their current size.
+#
+# Examples:
+#     memsize.py trace.log --measured-mbps 12 --target-mbps 20 --target-conns 4
+#     memsize.py trace.log --measured-mbps 12 --target-mbps 20 --rtt-ms 30 --elf image-msdk.elf
+
+import sys
+import math
+import struct
+import argparse
+
+# data path pools: usage follows the aggregate throughput
+DATA_POOLS = ('TCP_SEG', 'PBUF_REF/ROM', 'PBUF_POOL', 'NETBUF', 'FRAG_PBUF', 'REASSDATA', 'TCPIP_MSG_INPKT')
+# per connection pools: usage follows the number of connections
+CONN_POOLS = ('TCP_PCB', 'NETCONN', 'TCP_PCB_LISTEN')
+POOL_OPTION = {
+    'TCP_SEG': 'MEMP_NUM_TCP_SEG',
+    'PBUF_REF/ROM': 'MEMP_NUM_PBUF',
+    'NETBUF': 'MEMP_NUM_NETBUF',
+    'NETCONN': 'MEMP_NUM_NETCONN',
+    'TCP_PCB': 'MEMP_NUM_TCP_PCB',
+    'UDP_PCB': 'MEMP_NUM_UDP_PCB',
+}
+HEAP_ROUND = 512
+
+
+class Trace:
+    def __init__(self, lines):
+        self.intv_ms = 0
+        self.cfg = {}
+        self.pools = []             # [idx] = dict(name, size, avail, max, err)
+        self.heap = None
+        self.samples = []           # (time, heap_peak, [peaks])
+        self.fails = []             # (time, pool, size, caller, task)
+        for line in lines:
+            i = line.find('MEMTLM,')
+            if i < 0:
+                continue
+            f = line[i:].strip().split(',')
+            try:
+                self.parse(f)
+            except (IndexError, ValueError):
+                sys.stderr.write('skipped malformed line: %s\n' % line.strip())
+        if not self.pools:
+            raise ValueError('no MEMTLM pool records found')
+
+    def parse(self, f):
+        kind = f[1]
+        if kind == 'V':
+            self.intv_ms = int(f[3])
+        elif kind == 'CFG':
+            self.cfg[f[2]] = int(f[3])
+        elif kind == 'POOL':
+            idx = int(f[2])
+            while len(self.pools) <= idx:
+                self.pools.append(None)
+            self.pools[idx] = dict(name=f[3], size=int(f[4]), avail=int(f[5]), max=int(f[6]), err=int(f[7]))
+        elif kind == 'HEAP':
+            self.heap = dict(name='HEAP', size=1, avail=int(f[2]), max=int(f[3]), err=int(f[4]))
+        elif kind == 'S':
+            self.samples.append((int(f[2]), int(f[3]), [int(v) for v in f[4:]]))
+        elif kind == 'F':
+            self.fails.append((int(f[2]), f[3], int(f[4]), int(f[5], 16) if f[5] not in ('(nil)', '0') else 0, f[6]))
+
+    def series(self, idx):
+        # interval peaks of a pool, idx None for the heap
+        if idx is None:
+            return [s[1] for s in self.samples]
+        return [s[2][idx] for s in self.samples if idx < len(s[2])]
+
+
+class ElfSymbols:
+    # function symbols of a 32 bit little endian ELF, to name the allocation callers
+    def __init__(self, path):
+        with open(path, mode='rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF' or data[4] != 1:
+            raise ValueError(path + ' is not a 32 bit ELF file')
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x2E)
+        sects = [struct.unpack_from('<IIIIIIIIII', data, shoff + i * shentsize) for i in range(shnum)]
+        self.syms = []
+        for sh in sects:
+            if sh[1] != 2:          # SHT_SYMTAB
+                continue
+            strtab = sects[sh[6]]
+            for off in range(sh[4], sh[4] + sh[5], 16):
+                name, value, size, info = struct.unpack_from('<IIIB', data, off)
+                if (info & 0xf) != 2 or not size:       # STT_FUNC
+                    continue
+                end = data.find(b'\0', strtab[4] + name)
+                self.syms.append((value & ~1, size, data[strtab[4] + name:end].decode('latin-1')))
+        self.syms.sort()
+
+    def name(self, addr):
+        for value, size, name in self.syms:
+            if value <= addr < value + size:
+                return '%s+0x%x' % (name, addr - value)
+        return None
+
+
+def percentile(values, p):
+    if not values:
+        return 0
+    v = sorted(values)
+    return v[min(len(v) - 1, int(math.ceil(p / 100.0 * len(v))) - 1)]
+
+
+def grow(peak, scale, headroom, pool):
+    need = int(math.ceil(peak * scale * headroom))
+    if pool['err']:
+        # starved: the real demand is above what the pool could give
+        need = max(need, int(math.ceil(pool['avail'] * headroom)) + 1)
+    return need
+
+
+def recommend(tr, args):
+    mss = tr.cfg.get('TCP_MSS', 1460)
+    tp = args.target_mbps / args.measured_mbps if args.target_mbps else 1.0
+    by_name = dict((p['name'], (i, p)) for i, p in enumerate(tr.pools) if p)
+
+    def peak(name):
+        if name not in by_name:
+            return 0
+        i, p = by_name[name]
+        return max([p['max']] + tr.series(i))
+
+    conns = args.measured_conns or max(1, peak('TCP_PCB'))
+    target_conns = args.target_conns or conns
+    cr = float(target_conns) / conns
+
+    rows = []
+    for i, p in enumerate(tr.pools):
+        if not p:
+            continue
+        series = tr.series(i)
+        pk = max([p['max']] + series)
+        if p['name'] in DATA_POOLS:
+            scale = tp
+        elif p['name'] in CONN_POOLS:
+            scale = cr
+        else:
+            scale = 1.0
+        if pk or p['err']:
+            rec = max(1, grow(pk, scale, args.headroom, p))
+        else:
+            # not exercised by the workload, nothing tells how small it may get
+            rec = p['avail']
+        rows.append((p['name'], p['size'], p['avail'], pk, percentile(series, 95), p['err'], rec))
+
+    out = {}
+    # per connection send buffer: the segments one connection kept queued, scaled to the
+    # target per connection rate, or the bandwidth delay product when the RTT is known
+    rate_ratio = tp / cr
+    segs = peak('TCP_SEG') / float(conns)
+    snd_segs = int(math.ceil(segs * rate_ratio * args.headroom))
+    if args.rtt_ms:
+        bdp = args.target_mbps * 1e6 / 8 / target_conns * args.rtt_ms / 1000.0
+        snd_segs = max(snd_segs, int(math.ceil(bdp * args.headroom / mss)))
+        wnd_segs = int(math.ceil(bdp * args.headroom / mss))
+        out['TCP_WND'] = max(2, wnd_segs) * mss
+    snd_segs = max(2, snd_segs)
+    if by_name.get('TCP_SEG', (0, {'err': 0}))[1]['err'] or \
+            (tr.cfg.get('TCP_SND_QUEUELEN') and segs >= tr.cfg['TCP_SND_QUEUELEN']):
+        # the queue limit was reached, the sender was held back
+        snd_segs = max(snd_segs, tr.cfg.get('TCP_SND_BUF', 0) // mss + 1)
+    out['TCP_SND_BUF'] = snd_segs * mss
+    out['TCP_SND_QUEUELEN'] = 2 * snd_segs
+    for name, size, avail, pk, p95, err, rec in rows:
+        if name in POOL_OPTION:
+            out[POOL_OPTION[name]] = max(rec, 1)
+    out['MEMP_NUM_TCP_SEG'] = max(out.get('MEMP_NUM_TCP_SEG', 0), out['TCP_SND_QUEUELEN'])
+    out['MEMP_NUM_TCP_PCB'] = max(out.get('MEMP_NUM_TCP_PCB', 0), target_conns)
+    # the table and the RAM change show the sizes that are emitted
+    rows = [r[:6] + (out[POOL_OPTION[r[0]]],) if r[0] in POOL_OPTION else r for r in rows]
+
+    heap_rec = 0
+    if tr.heap:
+        pk = max([tr.heap['max']] + tr.series(None))
+        heap_rec = grow(pk, tp, args.headroom, tr.heap)
+        heap_rec = (heap_rec + HEAP_ROUND - 1) // HEAP_ROUND * HEAP_ROUND
+        out['MEM_MIN_TCP'] = heap_rec
+        out['MEM_SIZE'] = max(heap_rec, 8192) + 512
+        rows.append(('HEAP', 1, tr.heap['avail'], pk, percentile(tr.series(None), 95), tr.heap['err'],
+                     out['MEM_SIZE']))
+    return rows, out, conns, target_conns, tp
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Recommend lwipopts.h sizes from lwip_stats trace dumps')
+    parser.add_argument('infile', nargs='?', default='-', help='captured log with the MEMTLM lines, - for stdin')
+    parser.add_argument('--measured-mbps', type=float, default=1.0, help='throughput while the trace was taken')
+    parser.add_argument('--target-mbps', type=float, help='throughput the product must sustain')
+    parser.add_argument('--measured-conns', type=int, help='connections while the trace was taken, '
+                        'default the TCP_PCB peak')
+    parser.add_argument('--target-conns', type=int, help='connections the product must sustain')
+    parser.add_argument('--rtt-ms', type=float, help='round trip time of the target network, sizes the windows')
+    parser.add_argument('--headroom', type=float, default=1.25, help='margin over the scaled peaks')
+    parser.add_argument('--elf', help='ELF file of the running image, to name the allocation callers')
+    args = parser.parse_args()
+
+    f = sys.stdin if args.infile == '-' else open(args.infile, errors='replace')
+    tr = Trace(f)
+    rows, out, conns, target_conns, tp = recommend(tr, args)
+
+    print('%d samples every %d ms, %d connection(s) measured, target %d, throughput x%.2f'
+          % (len(tr.samples), tr.intv_ms, conns, target_conns, tp))
+    print('%-16s %6s %6s %6s %6s %5s %6s %9s' % ('pool', 'size', 'avail', 'peak', 'p95', 'err', 'rec', 'delta B'))
+    total = 0
+    for name, size, avail, pk, p95, err, rec in rows:
+        delta = (rec - avail) * size
+        total += delta
+        note = ' starved' if err else (' unused, kept' if not pk and avail else '')
+        print('%-16s %6s %6d %6d %6d %5d %6d %+9d%s' % (name, size if name != 'HEAP' else '-', avail, pk, p95,
+                                                       err, rec, delta, note))
+    print('RAM change %+d bytes (pools and heap, pcb and segment sizes as built)' % total)
+
+    if tr.fails:
+        syms = ElfSymbols(args.elf) if args.elf else None
+        print('\nlast allocation failures:')
+        for t, pool, size, caller, task in tr.fails:
+            where = (syms.name(caller) if syms else None) or '0x%x' % caller
+            print('  %10d ms %-14s %5s %-32s %s' % (t, pool, size if pool == 'HEAP' else '', where, task))
+
+    print('\n/* lwipopts.h */')
+    for k in ('TCP_SND_BUF', 'TCP_SND_QUEUELEN', 'TCP_WND', 'MEMP_NUM_TCP_SEG', 'MEMP_NUM_PBUF',
+              'MEMP_NUM_NETBUF', 'MEMP_NUM_NETCONN', 'MEMP_NUM_TCP_PCB', 'MEMP_NUM_UDP_PCB',
+              'MEM_MIN_TCP', 'MEM_SIZE'):
+        if k in out:
+            cur = tr.cfg.get(k)
+            print('#define %-29s %-8d%s' % (k, out[k], '  /* was %d */' % cur if cur is not None else ''))
+
+
+if __name__ == '__main__':
+    main()